@@ -0,0 +1,750 @@
+#ifndef BERRY_CORO_HPP
+#define BERRY_CORO_HPP
+
+/* Lapisan coroutine C++20 (header-only) di atas driver WINEIRC/WINEMATRIX.
+
+   Driver C bersifat blocking, jadi setiap operasi driver dijalankan di
+   event loop driver (thread I/O) lewat strand per handle agar urutan kiriman
+   tetap terjaga, lalu coroutine dilanjutkan di executor work-stealing.
+   Frame coroutine diambil dari pool per-thread yang didaur ulang, sehingga
+   puluhan ribu percakapan bisa berjalan tanpa satu thread OS per percakapan.
+
+   Contoh:
+       berry::executor ex;
+       berry::event_loop io(4);
+       berry::irc_client irc(ex, io, irc_handle);
+       berry::matrix_client matrix(ex, io, matrix_handle);
+       auto relay = [&]() -> berry::task<> {
+           co_await irc.send("halo");
+           co_await matrix.send_message("!room:server", "halo");
+       };
+       berry::spawn(ex, relay());
+
+   Capture lambda coroutine disimpan di objek lambda, jadi lambda harus
+   hidup lebih lama dari task-nya (jangan spawn lambda sementara).
+*/
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <coroutine>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/* Path relatif terhadap include/berry: b2b/ punya irc_driver.h lama sendiri */
+#include "irc/irc_driver.h"
+#include "matrix/matrix_driver.h"
+
+namespace berry {
+
+/* ===================== Pool frame coroutine ===================== */
+
+/* Allocator frame dengan free list per-thread per kelas ukuran (kelipatan 64 byte).
+   Frame yang dibebaskan di thread lain masuk ke cache thread tersebut. */
+class frame_pool {
+public:
+    static constexpr std::size_t granularity = 64;
+    static constexpr std::size_t max_class = 64;        /* Frame s/d 4 KiB di-pool */
+    static constexpr std::size_t max_cached = 4096;     /* Batas frame tersimpan per kelas per thread */
+
+    static void* allocate(std::size_t size) {
+        std::size_t cls = (size + header_size + granularity - 1) / granularity;
+        char* base;
+        if (cls > max_class) {
+            base = static_cast<char*>(::operator new(size + header_size));
+            cls = 0;
+        } else {
+            cache& c = local();
+            if (c.head[cls]) {
+                base = reinterpret_cast<char*>(c.head[cls]);
+                c.head[cls] = c.head[cls]->next;
+                c.count[cls]--;
+            } else {
+                base = static_cast<char*>(::operator new(cls * granularity));
+            }
+        }
+        *reinterpret_cast<std::size_t*>(base) = cls;
+        return base + header_size;
+    }
+
+    static void deallocate(void* p) noexcept {
+        char* base = static_cast<char*>(p) - header_size;
+        std::size_t cls = *reinterpret_cast<std::size_t*>(base);
+        if (cls == 0) {
+            ::operator delete(base);
+            return;
+        }
+        cache& c = local();
+        if (c.count[cls] >= max_cached) {
+            ::operator delete(base);
+            return;
+        }
+        node* n = reinterpret_cast<node*>(base);
+        n->next = c.head[cls];
+        c.head[cls] = n;
+        c.count[cls]++;
+    }
+
+private:
+    static constexpr std::size_t header_size = alignof(std::max_align_t);
+
+    struct node {
+        node* next;
+    };
+
+    struct cache {
+        node* head[max_class + 1] = {};
+        std::size_t count[max_class + 1] = {};
+        ~cache() {
+            for (node* n : head) {
+                while (n) {
+                    node* next = n->next;
+                    ::operator delete(n);
+                    n = next;
+                }
+            }
+        }
+    };
+
+    static cache& local() {
+        thread_local cache c;
+        return c;
+    }
+};
+
+namespace detail {
+
+struct pooled_promise {
+    static void* operator new(std::size_t size) { return frame_pool::allocate(size); }
+    static void operator delete(void* p) noexcept { frame_pool::deallocate(p); }
+};
+
+struct final_awaiter {
+    bool await_ready() const noexcept { return false; }
+    template <typename P>
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<P> h) const noexcept {
+        std::coroutine_handle<> next = h.promise().continuation;
+        return next ? next : std::noop_coroutine();
+    }
+    void await_resume() const noexcept {}
+};
+
+struct task_promise_base : pooled_promise {
+    std::coroutine_handle<> continuation;
+    std::exception_ptr error;
+
+    std::suspend_always initial_suspend() const noexcept { return {}; }
+    final_awaiter final_suspend() const noexcept { return {}; }
+    void unhandled_exception() noexcept { error = std::current_exception(); }
+};
+
+} // namespace detail
+
+/* ===================== task<T> ===================== */
+
+/* Coroutine lazy: mulai berjalan saat di-co_await, lalu melanjutkan
+   pemanggil lewat symmetric transfer. */
+template <typename T = void>
+class task;
+
+namespace detail {
+
+template <typename T>
+struct task_promise : task_promise_base {
+    std::optional<T> value;
+    task<T> get_return_object() noexcept;
+    template <typename U>
+    void return_value(U&& v) { value.emplace(std::forward<U>(v)); }
+    T take() {
+        if (error)
+            std::rethrow_exception(error);
+        return std::move(*value);
+    }
+};
+
+template <>
+struct task_promise<void> : task_promise_base {
+    task<void> get_return_object() noexcept;
+    void return_void() const noexcept {}
+    void take() {
+        if (error)
+            std::rethrow_exception(error);
+    }
+};
+
+} // namespace detail
+
+template <typename T>
+class task {
+public:
+    using promise_type = detail::task_promise<T>;
+    using handle_type = std::coroutine_handle<promise_type>;
+
+    task() noexcept = default;
+    explicit task(handle_type h) noexcept : h_(h) {}
+    task(task&& other) noexcept : h_(std::exchange(other.h_, {})) {}
+    task& operator=(task&& other) noexcept {
+        if (this != &other) {
+            if (h_)
+                h_.destroy();
+            h_ = std::exchange(other.h_, {});
+        }
+        return *this;
+    }
+    task(const task&) = delete;
+    task& operator=(const task&) = delete;
+    ~task() {
+        if (h_)
+            h_.destroy();
+    }
+
+    struct awaiter {
+        handle_type h;
+        bool await_ready() const noexcept { return !h || h.done(); }
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<> caller) noexcept {
+            h.promise().continuation = caller;
+            return h;
+        }
+        T await_resume() {
+            if (!h)
+                throw std::logic_error("co_await pada task kosong");
+            return h.promise().take();
+        }
+    };
+
+    awaiter operator co_await() & noexcept { return awaiter{h_}; }
+    awaiter operator co_await() && noexcept { return awaiter{h_}; }
+
+private:
+    handle_type h_;
+};
+
+namespace detail {
+
+template <typename T>
+task<T> task_promise<T>::get_return_object() noexcept {
+    return task<T>{std::coroutine_handle<task_promise<T>>::from_promise(*this)};
+}
+
+inline task<void> task_promise<void>::get_return_object() noexcept {
+    return task<void>{std::coroutine_handle<task_promise<void>>::from_promise(*this)};
+}
+
+/* Coroutine yang berjalan sendiri dan menghapus frame-nya saat selesai */
+struct detached {
+    struct promise_type : pooled_promise {
+        detached get_return_object() const noexcept { return {}; }
+        std::suspend_never initial_suspend() const noexcept { return {}; }
+        std::suspend_never final_suspend() const noexcept { return {}; }
+        void return_void() const noexcept {}
+        void unhandled_exception() const noexcept { std::terminate(); }
+    };
+};
+
+} // namespace detail
+
+/* ===================== Executor work-stealing ===================== */
+
+class executor {
+public:
+    explicit executor(unsigned threads = std::thread::hardware_concurrency()) {
+        if (threads == 0)
+            threads = 1;
+        for (unsigned i = 0; i < threads; i++)
+            queues_.push_back(std::make_unique<work_queue>());
+        for (unsigned i = 0; i < threads; i++)
+            threads_.emplace_back([this, i] { run(i); });
+    }
+
+    ~executor() { stop(); }
+
+    executor(const executor&) = delete;
+    executor& operator=(const executor&) = delete;
+
+    /* Menjadwalkan coroutine. Dari worker sendiri masuk ke antrian lokal
+       (LIFO, cache-friendly); dari thread luar masuk ke antrian injeksi.
+       Setelah stop() selesai, frame yang di-post langsung dihancurkan. */
+    void post(std::coroutine_handle<> h) {
+        if (current_ == this) {
+            work_queue& q = *queues_[index_];
+            std::lock_guard<std::mutex> lk(q.m);
+            q.items.push_back(h);
+        } else {
+            std::unique_lock<std::mutex> lk(inject_.m);
+            if (drained_) {
+                lk.unlock();
+                h.destroy();
+                return;
+            }
+            inject_.items.push_back(h);
+        }
+        epoch_.fetch_add(1);
+        if (sleepers_.load() > 0) {
+            std::lock_guard<std::mutex> lk(sleep_m_);
+            sleep_cv_.notify_one();
+        }
+    }
+
+    /* co_await ex.schedule() memindahkan coroutine ke salah satu worker */
+    auto schedule() noexcept {
+        struct awaiter {
+            executor& ex;
+            bool await_ready() const noexcept { return false; }
+            void await_suspend(std::coroutine_handle<> h) { ex.post(h); }
+            void await_resume() const noexcept {}
+        };
+        return awaiter{*this};
+    }
+
+    /* Menghentikan worker lalu menghancurkan frame yang masih mengantri.
+       Coroutine yang menunggu frame tersebut tidak dilanjutkan. */
+    void stop() {
+        if (stop_.exchange(true))
+            return;
+        {
+            std::lock_guard<std::mutex> lk(sleep_m_);
+            sleep_cv_.notify_all();
+        }
+        for (std::thread& t : threads_)
+            t.join();
+        std::deque<std::coroutine_handle<>> left;
+        {
+            std::lock_guard<std::mutex> lk(inject_.m);
+            drained_ = true;
+            left.swap(inject_.items);
+        }
+        for (std::unique_ptr<work_queue>& q : queues_)
+            left.insert(left.end(), q->items.begin(), q->items.end());
+        for (std::coroutine_handle<> h : left)
+            h.destroy();
+    }
+
+    std::size_t size() const noexcept { return threads_.size(); }
+
+private:
+    struct work_queue {
+        std::mutex m;
+        std::deque<std::coroutine_handle<>> items;
+    };
+
+    /* wait = false: antrian worker lain yang sedang dikunci dilewati */
+    bool try_pop(std::size_t self, std::coroutine_handle<>& out, bool wait) {
+        {
+            work_queue& q = *queues_[self];
+            std::lock_guard<std::mutex> lk(q.m);
+            if (!q.items.empty()) {
+                out = q.items.back();
+                q.items.pop_back();
+                return true;
+            }
+        }
+        {
+            std::lock_guard<std::mutex> lk(inject_.m);
+            if (!inject_.items.empty()) {
+                out = inject_.items.front();
+                inject_.items.pop_front();
+                return true;
+            }
+        }
+        /* Curi dari ujung depan (item tertua) antrian worker lain */
+        for (std::size_t n = 1; n < queues_.size(); n++) {
+            work_queue& q = *queues_[(self + n) % queues_.size()];
+            std::unique_lock<std::mutex> lk(q.m, std::defer_lock);
+            if (wait)
+                lk.lock();
+            else if (!lk.try_lock())
+                continue;
+            if (!q.items.empty()) {
+                out = q.items.front();
+                q.items.pop_front();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void run(std::size_t self) {
+        current_ = this;
+        index_ = self;
+        std::coroutine_handle<> h;
+        while (!stop_.load()) {
+            /* epoch dibaca sebelum mencari: post() sesudahnya membangunkan worker ini */
+            std::size_t seen = epoch_.load();
+            if (try_pop(self, h, false) || try_pop(self, h, true)) {
+                h.resume();
+                continue;
+            }
+            std::unique_lock<std::mutex> lk(sleep_m_);
+            sleepers_.fetch_add(1);
+            sleep_cv_.wait(lk, [this, seen] { return stop_.load() || epoch_.load() != seen; });
+            sleepers_.fetch_sub(1);
+        }
+        current_ = nullptr;
+    }
+
+    std::vector<std::unique_ptr<work_queue>> queues_;
+    std::vector<std::thread> threads_;
+    work_queue inject_;
+    std::mutex sleep_m_;
+    std::condition_variable sleep_cv_;
+    std::atomic<bool> stop_{false};
+    bool drained_ = false;                  /* Dilindungi inject_.m */
+    std::atomic<std::size_t> epoch_{0};     /* Bertambah setiap ada item baru */
+    std::atomic<std::size_t> sleepers_{0};
+
+    static inline thread_local executor* current_ = nullptr;
+    static inline thread_local std::size_t index_ = 0;
+};
+
+/* Menjalankan task secara terlepas (fire-and-forget) di executor */
+template <typename T>
+void spawn(executor& ex, task<T> t) {
+    [](executor& ex, task<T> t) -> detail::detached {
+        co_await ex.schedule();
+        try {
+            co_await std::move(t);
+        } catch (const std::exception& e) {
+            std::fprintf(stderr, "Task coroutine gagal: %s\n", e.what());
+        } catch (...) {
+            std::fprintf(stderr, "Task coroutine gagal\n");
+        }
+    }(ex, std::move(t));
+}
+
+/* ===================== Event loop driver ===================== */
+
+/* Thread I/O untuk panggilan driver yang blocking (send IRC, HTTP Matrix) */
+class event_loop {
+public:
+    explicit event_loop(unsigned threads = 1) {
+        if (threads == 0)
+            threads = 1;
+        for (unsigned i = 0; i < threads; i++)
+            threads_.emplace_back([this] { run(); });
+    }
+
+    ~event_loop() {
+        {
+            std::lock_guard<std::mutex> lk(m_);
+            stop_ = true;
+        }
+        cv_.notify_all();
+        for (std::thread& t : threads_)
+            t.join();
+    }
+
+    event_loop(const event_loop&) = delete;
+    event_loop& operator=(const event_loop&) = delete;
+
+    void post(std::function<void()> fn) {
+        {
+            std::lock_guard<std::mutex> lk(m_);
+            jobs_.push_back(std::move(fn));
+        }
+        cv_.notify_one();
+    }
+
+private:
+    void run() {
+        for (;;) {
+            std::function<void()> fn;
+            {
+                std::unique_lock<std::mutex> lk(m_);
+                cv_.wait(lk, [this] { return stop_ || !jobs_.empty(); });
+                if (jobs_.empty())
+                    return;
+                fn = std::move(jobs_.front());
+                jobs_.pop_front();
+            }
+            fn();
+        }
+    }
+
+    std::mutex m_;
+    std::condition_variable cv_;
+    std::deque<std::function<void()>> jobs_;
+    std::vector<std::thread> threads_;
+    bool stop_ = false;
+};
+
+/* Menjalankan job satu per satu (berurutan) di atas event_loop multi-thread.
+   Satu strand per handle menjaga urutan kiriman ke satu koneksi. */
+class strand {
+public:
+    explicit strand(event_loop& loop) : loop_(loop) {}
+
+    void post(std::function<void()> fn) {
+        {
+            std::lock_guard<std::mutex> lk(m_);
+            jobs_.push_back(std::move(fn));
+            if (running_)
+                return;
+            running_ = true;
+        }
+        loop_.post([this] { drain(); });
+    }
+
+private:
+    void drain() {
+        for (;;) {
+            std::function<void()> fn;
+            {
+                std::lock_guard<std::mutex> lk(m_);
+                if (jobs_.empty()) {
+                    running_ = false;
+                    return;
+                }
+                fn = std::move(jobs_.front());
+                jobs_.pop_front();
+            }
+            fn();
+        }
+    }
+
+    event_loop& loop_;
+    std::mutex m_;
+    std::deque<std::function<void()>> jobs_;
+    bool running_ = false;
+};
+
+/* Awaitable: jalankan fn di strand, lanjutkan coroutine di executor dengan hasilnya */
+template <typename F>
+auto run_on(strand& s, executor& ex, F fn) {
+    using R = std::invoke_result_t<F&>;
+    struct awaiter {
+        strand& s;
+        executor& ex;
+        F fn;
+        std::optional<R> result;
+
+        bool await_ready() const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<> h) {
+            s.post([this, h] {
+                result.emplace(fn());
+                ex.post(h);
+            });
+        }
+        R await_resume() { return std::move(*result); }
+    };
+    return awaiter{s, ex, std::move(fn), std::nullopt};
+}
+
+/* ===================== Channel ===================== */
+
+/* Antrian multi-producer yang bisa di-co_await; nullopt saat channel ditutup */
+template <typename T>
+class channel {
+public:
+    explicit channel(executor& ex) : ex_(ex) {}
+
+    void push(T value) {
+        std::unique_lock<std::mutex> lk(m_);
+        if (closed_)
+            return;
+        if (!waiters_.empty()) {
+            waiter w = waiters_.front();
+            waiters_.pop_front();
+            w.slot->emplace(std::move(value));
+            lk.unlock();
+            ex_.post(w.h);
+            return;
+        }
+        items_.push_back(std::move(value));
+    }
+
+    void close() {
+        std::deque<waiter> waiters;
+        {
+            std::lock_guard<std::mutex> lk(m_);
+            closed_ = true;
+            waiters.swap(waiters_);
+        }
+        for (waiter& w : waiters)
+            ex_.post(w.h);
+    }
+
+    auto next() {
+        struct awaiter {
+            channel& ch;
+            std::optional<T> slot;
+
+            bool await_ready() const noexcept { return false; }
+            bool await_suspend(std::coroutine_handle<> h) {
+                std::lock_guard<std::mutex> lk(ch.m_);
+                if (!ch.items_.empty()) {
+                    slot.emplace(std::move(ch.items_.front()));
+                    ch.items_.pop_front();
+                    return false;
+                }
+                if (ch.closed_)
+                    return false;
+                ch.waiters_.push_back(waiter{h, &slot});
+                return true;
+            }
+            std::optional<T> await_resume() { return std::move(slot); }
+        };
+        return awaiter{*this, std::nullopt};
+    }
+
+private:
+    struct waiter {
+        std::coroutine_handle<> h;
+        std::optional<T>* slot;
+    };
+
+    executor& ex_;
+    std::mutex m_;
+    std::deque<T> items_;
+    std::deque<waiter> waiters_;
+    bool closed_ = false;
+};
+
+/* ===================== Binding driver ===================== */
+
+class irc_client {
+public:
+    irc_client(executor& ex, event_loop& loop, WINEIRC_handle* handle)
+        : ex_(ex), strand_(loop), handle_(handle) {}
+
+    auto send(std::string message) {
+        return run_on(strand_, ex_, [h = handle_, m = std::move(message)] {
+            return WINEIRC_send_message(h, m.c_str());
+        });
+    }
+
+    auto send_tagged(std::string tags, std::string message) {
+        return run_on(strand_, ex_, [h = handle_, t = std::move(tags), m = std::move(message)] {
+            return WINEIRC_send_tagged_message(h, t.c_str(), m.c_str());
+        });
+    }
+
+    auto join() {
+        return run_on(strand_, ex_, [h = handle_] { return WINEIRC_join_channel(h); });
+    }
+
+    WINEIRC_handle* native_handle() const noexcept { return handle_; }
+
+private:
+    executor& ex_;
+    strand strand_;
+    WINEIRC_handle* handle_;
+};
+
+class matrix_client {
+public:
+    matrix_client(executor& ex, event_loop& loop, WINEMATRIX_handle* handle)
+        : ex_(ex), strand_(loop), handle_(handle) {}
+
+    auto join_room(std::string room_id) {
+        return run_on(strand_, ex_, [h = handle_, r = std::move(room_id)] {
+            return WINEMATRIX_join_room(h, r.c_str());
+        });
+    }
+
+    auto send_message(std::string room_id, std::string message, std::string origin = {}) {
+        return run_on(strand_, ex_, [h = handle_, r = std::move(room_id), m = std::move(message),
+                                     o = std::move(origin)] {
+            return WINEMATRIX_send_message_origin(h, r.c_str(), m.c_str(), o.empty() ? nullptr : o.c_str());
+        });
+    }
+
+    auto send_reply(std::string room_id, std::string event_id, std::string original, std::string reply) {
+        return run_on(strand_, ex_, [h = handle_, r = std::move(room_id), e = std::move(event_id),
+                                     o = std::move(original), m = std::move(reply)] {
+            return WINEMATRIX_send_reply(h, r.c_str(), e.c_str(), o.c_str(), m.c_str());
+        });
+    }
+
+    auto send_reaction(std::string room_id, std::string event_id, std::string reaction) {
+        return run_on(strand_, ex_, [h = handle_, r = std::move(room_id), e = std::move(event_id),
+                                     k = std::move(reaction)] {
+            return WINEMATRIX_send_reaction(h, r.c_str(), e.c_str(), k.c_str());
+        });
+    }
+
+    auto redact_message(std::string room_id, std::string event_id, std::string reason) {
+        return run_on(strand_, ex_, [h = handle_, r = std::move(room_id), e = std::move(event_id),
+                                     why = std::move(reason)] {
+            return WINEMATRIX_redact_message(h, r.c_str(), e.c_str(), why.c_str());
+        });
+    }
+
+    WINEMATRIX_handle* native_handle() const noexcept { return handle_; }
+
+private:
+    executor& ex_;
+    strand strand_;
+    WINEMATRIX_handle* handle_;
+};
+
+/* Satu hasil /sync: body JSON mentah dan token untuk sync berikutnya */
+struct sync_event {
+    std::string next_batch;
+    std::string body;
+};
+
+/* Loop /sync di thread sendiri; hasilnya diambil dengan co_await sync.next_event() */
+class matrix_sync {
+public:
+    matrix_sync(executor& ex, WINEMATRIX_handle* handle, int timeout_ms = 30000, std::string since = {})
+        : events_(ex), handle_(handle), timeout_ms_(timeout_ms), since_(std::move(since)),
+          thread_([this] { run(); }) {}
+
+    ~matrix_sync() {
+        stop_.store(true);
+        thread_.join();
+        events_.close();
+    }
+
+    matrix_sync(const matrix_sync&) = delete;
+    matrix_sync& operator=(const matrix_sync&) = delete;
+
+    auto next_event() { return events_.next(); }
+
+private:
+    void run() {
+        while (!stop_.load()) {
+            char* body = nullptr;
+            char* next = nullptr;
+            if (WINEMATRIX_sync(handle_, since_.empty() ? nullptr : since_.c_str(),
+                                timeout_ms_, &body, &next) == 0) {
+                sync_event ev;
+                ev.body = body;
+                if (next) {
+                    since_ = next;
+                    ev.next_batch = next;
+                }
+                std::free(body);
+                std::free(next);
+                events_.push(std::move(ev));
+            } else {
+                std::this_thread::sleep_for(std::chrono::seconds(2));
+            }
+        }
+    }
+
+    channel<sync_event> events_;
+    WINEMATRIX_handle* handle_;
+    int timeout_ms_;
+    std::string since_;
+    std::atomic<bool> stop_{false};
+    std::thread thread_;
+};
+
+} // namespace berry
+
+#endif // BERRY_CORO_HPP
@@ -0,0 +1,67 @@
+#ifndef WINEB2B_ECHO_FILTER_H
+#define WINEB2B_ECHO_FILTER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Penanda origin pada pesan hasil relay:
+   - IRC: client-only tag IRCv3 (butuh CAP message-tags)
+   - Matrix: field di content event (WINEMATRIX_send_message_origin) */
+#define WINEB2B_ORIGIN_TAG   "+archanaberry.github.io/origin"
+#define WINEB2B_ORIGIN_FIELD "io.github.archanaberry.origin"
+
+/* Filter echo/loop untuk jalur bridge.
+
+   Setiap pesan yang dikirim bridge dicatat sebagai sidik jari
+   (network, target, hash isi) di hash set berjendela waktu. Pesan masuk yang
+   membawa penanda origin, atau yang sidik jarinya masih ada di jendela,
+   dibuang dalam O(1) sebelum ada I/O ke jaringan lain. */
+typedef struct _WINEB2B_echo_filter WINEB2B_echo_filter;
+
+/* Statistik per route (network, target) */
+typedef struct {
+    const char *network;
+    const char *target;
+    uint64_t emitted;       /* Pesan yang dikirim bridge ke route ini */
+    uint64_t suppressed;    /* Pesan masuk yang dibuang sebagai echo */
+} WINEB2B_echo_route;
+
+typedef void (*WINEB2B_echo_route_cb)(const WINEB2B_echo_route* route, void* user);
+
+/* Membuat filter. origin_id = ID unik instance bridge ini,
+   window_ms = lama sidik jari disimpan, capacity = jumlah sidik jari maksimum. */
+WINEB2B_echo_filter* WINEB2B_echo_create(const char* origin_id, unsigned window_ms, size_t capacity);
+
+/* ID origin instance ini (untuk dipasang pada pesan keluar) */
+const char* WINEB2B_echo_origin(const WINEB2B_echo_filter* f);
+
+/* Menyusun string tag IRC berisi origin instance ini ke out */
+int WINEB2B_echo_irc_tags(const WINEB2B_echo_filter* f, char* out, size_t out_len);
+
+/* Mencatat pesan yang baru saja dikirim bridge ke (network, target) */
+void WINEB2B_echo_note(WINEB2B_echo_filter* f, const char* network,
+                       const char* target, const char* body);
+
+/* Memeriksa pesan masuk. origin = nilai penanda origin pada pesan (NULL jika
+   tidak ada). Mengembalikan 1 jika pesan harus dibuang, 0 jika boleh diteruskan. */
+int WINEB2B_echo_check(WINEB2B_echo_filter* f, const char* network,
+                       const char* target, const char* body, const char* origin);
+
+/* Jumlah pesan yang dibuang untuk satu route */
+uint64_t WINEB2B_echo_suppressed(const WINEB2B_echo_filter* f, const char* network, const char* target);
+
+/* Memanggil cb untuk setiap route yang pernah tercatat */
+void WINEB2B_echo_foreach_route(const WINEB2B_echo_filter* f, WINEB2B_echo_route_cb cb, void* user);
+
+/* Membebaskan filter */
+void WINEB2B_echo_free(WINEB2B_echo_filter* f);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // WINEB2B_ECHO_FILTER_H
@@ -0,0 +1,99 @@
+#ifndef WINEB2B_LOG_H
+#define WINEB2B_LOG_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+/* Logger terstruktur asinkron untuk jalur panas driver.
+
+   Pemanggil hanya menyalin argumen mentah (angka, pointer, salinan string)
+   ke ring buffer milik thread-nya sendiri (SPSC, tanpa lock). Format
+   string diparse sekali per call site. Pemformatan dan write() dilakukan
+   thread latar belakang, jadi jalur kirim tidak pernah menunggu I/O log.
+   Jika ring penuh, record dibuang dan dihitung (tidak memblokir).
+
+   Format adalah pasangan key=value (logfmt), misalnya
+       WINEB2B_LOG_DEBUG("matrix", "op=send status=%ld body=%s", status, body);
+   menghasilkan
+       ts=2026-01-01T00:00:00.000000Z level=debug cat=matrix op=send status=200 body="{...}"
+   Nilai %s diberi tanda kutip (dengan escape) bila perlu. Urutan record
+   dijaga per thread; antar thread gunakan ts.
+
+   Level di bawah WINEB2B_LOG_MIN_LEVEL (default INFO, misalnya
+   -DWINEB2B_LOG_MIN_LEVEL=0 untuk semua level) hilang saat kompilasi. */
+
+#define WINEB2B_LOG_LEVEL_TRACE 0
+#define WINEB2B_LOG_LEVEL_DEBUG 1
+#define WINEB2B_LOG_LEVEL_INFO  2
+#define WINEB2B_LOG_LEVEL_WARN  3
+#define WINEB2B_LOG_LEVEL_ERROR 4
+
+#ifndef WINEB2B_LOG_MIN_LEVEL
+#define WINEB2B_LOG_MIN_LEVEL WINEB2B_LOG_LEVEL_INFO
+#endif
+
+#define WINEB2B_LOG_MAX_ARGS 16
+
+/* Satu call site (static di dalam makro); diisi saat pertama dipakai */
+typedef struct {
+    const char *category;
+    const char *fmt;
+    int level;
+    int state;                  /* 0 = belum diparse, 1 = siap, 2 = format langsung */
+    int category_id;
+    int nargs;
+    unsigned char types[WINEB2B_LOG_MAX_ARGS];
+} WINEB2B_log_site;
+
+typedef struct {
+    uint64_t records;           /* Record yang masuk ring */
+    uint64_t dropped;           /* Ring penuh */
+    uint64_t suppressed;        /* Dibuang sampling / rate limit */
+    uint64_t written;           /* Baris yang ditulis ke sink */
+} WINEB2B_log_stats;
+
+/* Level minimum saat runtime (default WINEB2B_LOG_LEVEL_INFO) */
+extern int WINEB2B_log_level;
+
+#define WINEB2B_LOG_AT(lvl, cat, fmt, ...)                                          \
+    do {                                                                            \
+        if ((lvl) >= WINEB2B_LOG_MIN_LEVEL && (lvl) >= WINEB2B_log_level) {         \
+            static WINEB2B_log_site wineb2b_log_site_ = { (cat), (fmt), (lvl), 0, 0, 0, { 0 } }; \
+            WINEB2B_log_write(&wineb2b_log_site_, fmt, ##__VA_ARGS__);              \
+        }                                                                           \
+    } while (0)
+
+#define WINEB2B_LOG_TRACE(cat, fmt, ...) WINEB2B_LOG_AT(WINEB2B_LOG_LEVEL_TRACE, cat, fmt, ##__VA_ARGS__)
+#define WINEB2B_LOG_DEBUG(cat, fmt, ...) WINEB2B_LOG_AT(WINEB2B_LOG_LEVEL_DEBUG, cat, fmt, ##__VA_ARGS__)
+#define WINEB2B_LOG_INFO(cat, fmt, ...)  WINEB2B_LOG_AT(WINEB2B_LOG_LEVEL_INFO, cat, fmt, ##__VA_ARGS__)
+#define WINEB2B_LOG_WARN(cat, fmt, ...)  WINEB2B_LOG_AT(WINEB2B_LOG_LEVEL_WARN, cat, fmt, ##__VA_ARGS__)
+#define WINEB2B_LOG_ERROR(cat, fmt, ...) WINEB2B_LOG_AT(WINEB2B_LOG_LEVEL_ERROR, cat, fmt, ##__VA_ARGS__)
+
+/* Dipanggil lewat makro di atas. fmt harus sama dengan site->fmt */
+void WINEB2B_log_write(WINEB2B_log_site* site, const char* fmt, ...) __attribute__((format(printf, 2, 3)));
+
+/* Mengarahkan output ke file (append). NULL = stderr. 0 jika berhasil */
+int WINEB2B_log_open(const char* path);
+
+/* Sampling dan rate limit per kategori: hanya 1 dari one_in record yang
+   disimpan, dan paling banyak max_per_sec per detik (0 = tanpa batas).
+   Jumlah yang dibuang dilaporkan sebagai record cat=log. 0 jika berhasil */
+int WINEB2B_log_set_sampling(const char* category, unsigned one_in, unsigned max_per_sec);
+
+/* Menunggu semua record yang sudah masuk ring ditulis ke sink */
+void WINEB2B_log_flush(void);
+
+void WINEB2B_log_get_stats(WINEB2B_log_stats* out);
+
+/* Menghentikan thread latar belakang setelah flush. Logger aktif lagi
+   secara otomatis pada record berikutnya */
+void WINEB2B_log_shutdown(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // WINEB2B_LOG_H
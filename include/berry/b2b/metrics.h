@@ -0,0 +1,110 @@
+#ifndef WINEB2B_METRICS_H
+#define WINEB2B_METRICS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Metrik driver per handle dan per proses.
+
+   Setiap handle driver (IRC, Matrix, XMPP) memiliki satu WINEB2B_metrics.
+   Counter dan histogram disimpan per thread: shard dialokasikan saat thread
+   pertama kali menulis ke handle, sehingga jalur panas hanya load+store
+   relaxed ke cache line milik thread sendiri, tanpa lock dan tanpa atomic
+   read-modify-write. Snapshot menjumlahkan semua shard.
+
+   Histogram memakai bucket log-linear ala HDR untuk nilai dalam mikrodetik
+   (8 sub-bucket per pangkat dua, galat relatif <= 12.5%, sampai ~19 jam).
+
+   Semua fungsi pencatat menerima m == NULL (tidak melakukan apa-apa). */
+
+typedef struct _WINEB2B_metrics WINEB2B_metrics;
+
+typedef enum {
+    WINEB2B_METRIC_BYTES_IN,        /* Byte diterima dari jaringan */
+    WINEB2B_METRIC_BYTES_OUT,       /* Byte dikirim ke jaringan */
+    WINEB2B_METRIC_LINES,           /* Baris IRC / stanza XMPP yang diparse */
+    WINEB2B_METRIC_SENDS_QUEUED,    /* Pesan yang diminta dikirim */
+    WINEB2B_METRIC_SENDS_DONE,      /* ... yang sampai ke socket / diterima server */
+    WINEB2B_METRIC_SENDS_FAILED,    /* ... yang gagal (termasuk HTTP status >= 400) */
+    WINEB2B_METRIC_RECONNECTS,
+    WINEB2B_METRIC_HTTP_REQUESTS,
+    WINEB2B_METRIC_HTTP_ERRORS,     /* Gagal transport atau status >= 400 */
+    WINEB2B_METRIC_COUNTERS
+} WINEB2B_metric_counter;
+
+typedef enum {
+    WINEB2B_METRIC_LAG_MS,          /* Lag terakhir (IRC: RTT PING keepalive) */
+    WINEB2B_METRIC_GAUGES
+} WINEB2B_metric_gauge;
+
+typedef enum {
+    WINEB2B_METRIC_HTTP_DNS,        /* Fase HTTP dari CURLINFO_*_TIME_T */
+    WINEB2B_METRIC_HTTP_CONNECT,
+    WINEB2B_METRIC_HTTP_TLS,
+    WINEB2B_METRIC_HTTP_TTFB,
+    WINEB2B_METRIC_HTTP_TOTAL,
+    WINEB2B_METRIC_LAG,
+    WINEB2B_METRIC_HISTOGRAMS
+} WINEB2B_metric_histogram;
+
+#define WINEB2B_METRIC_BUCKETS 272
+
+typedef struct {
+    uint64_t count;
+    uint64_t sum;                   /* Mikrodetik */
+    uint64_t max;
+    uint64_t buckets[WINEB2B_METRIC_BUCKETS];
+} WINEB2B_metrics_histogram;
+
+/* Snapshot nilai satu handle atau satu protokol */
+typedef struct {
+    uint64_t counters[WINEB2B_METRIC_COUNTERS];
+    int64_t gauges[WINEB2B_METRIC_GAUGES];
+    WINEB2B_metrics_histogram hist[WINEB2B_METRIC_HISTOGRAMS];
+} WINEB2B_metrics_values;
+
+/* Mendaftarkan metrik untuk satu handle. protocol misal "irc",
+   instance misal "irc.libera.chat:6697/bot" (label Prometheus) */
+WINEB2B_metrics* WINEB2B_metrics_create(const char* protocol, const char* instance);
+
+/* Menambah counter */
+void WINEB2B_metrics_add(WINEB2B_metrics* m, WINEB2B_metric_counter counter, uint64_t value);
+
+/* Menyetel gauge */
+void WINEB2B_metrics_set(WINEB2B_metrics* m, WINEB2B_metric_gauge gauge, int64_t value);
+
+/* Mencatat satu nilai (mikrodetik) ke histogram */
+void WINEB2B_metrics_record(WINEB2B_metrics* m, WINEB2B_metric_histogram hist, uint64_t usec);
+
+/* Menjumlahkan semua shard handle ke out */
+void WINEB2B_metrics_snapshot(const WINEB2B_metrics* m, WINEB2B_metrics_values* out);
+
+/* Total per proses untuk satu protokol (handle aktif + yang sudah dibebaskan) */
+void WINEB2B_metrics_process(const char* protocol, WINEB2B_metrics_values* out);
+
+/* Nilai kuantil q (0..1) histogram dalam mikrodetik, 0 jika kosong */
+uint64_t WINEB2B_metrics_percentile(const WINEB2B_metrics_values* v, WINEB2B_metric_histogram hist, double q);
+
+/* Semua metrik dalam format teks Prometheus 0.0.4. Bebaskan dengan free() */
+char* WINEB2B_metrics_prometheus(size_t* len);
+
+/* Melayani GET /metrics di 127.0.0.1:port (0 = port acak) dari thread
+   terpisah. Mengembalikan port, -1 jika gagal */
+int WINEB2B_metrics_serve(int port);
+
+/* Menghentikan endpoint dari WINEB2B_metrics_serve */
+void WINEB2B_metrics_serve_stop(void);
+
+/* Melepas metrik handle; nilainya tetap terhitung di total per proses.
+   Tidak boleh ada thread yang masih mencatat ke m */
+void WINEB2B_metrics_free(WINEB2B_metrics* m);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // WINEB2B_METRICS_H
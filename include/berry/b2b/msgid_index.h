@@ -0,0 +1,69 @@
+#ifndef WINEB2B_MSGID_INDEX_H
+#define WINEB2B_MSGID_INDEX_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Panjang maksimum satu ID (msgid IRC atau event_id Matrix), tanpa '\0' */
+#define WINEB2B_MSGID_MAX 127
+
+/* Indeks dua arah antara ID pesan IRC (tag msgid atau ID sintetis) dan
+   event_id Matrix yang dihasilkannya.
+
+   Pemetaan terbaru disimpan di hash dalam memori dengan kapasitas tetap
+   (eviction LRU). Semua pemetaan juga ditulis ke log append-only di disk
+   (<store_path>.log) beserta tabel hash on-disk (<store_path>.idx), sehingga
+   riwayat lama tetap bisa dicari dalam O(1) tanpa menambah pemakaian memori. */
+typedef struct _WINEB2B_msgid_index WINEB2B_msgid_index;
+
+/* Statistik sederhana untuk memantau efektivitas cache */
+typedef struct {
+    size_t   mem_entries;   /* Jumlah entri di memori saat ini */
+    size_t   capacity;      /* Kapasitas maksimum entri di memori */
+    uint64_t mem_hits;      /* Lookup yang terjawab dari memori */
+    uint64_t disk_hits;     /* Lookup yang terjawab dari store di disk */
+    uint64_t misses;        /* Lookup yang tidak ditemukan sama sekali */
+    uint64_t evictions;     /* Entri yang dikeluarkan dari memori (LRU) */
+} WINEB2B_msgid_stats;
+
+/* Membuat indeks. capacity = jumlah entri maksimum di memori.
+   store_path boleh NULL untuk indeks memori saja (tanpa riwayat di disk). */
+WINEB2B_msgid_index* WINEB2B_msgid_index_create(size_t capacity, const char* store_path);
+
+/* Menyimpan pemetaan irc_id <-> matrix_event_id.
+   Pemetaan yang lebih baru menimpa pemetaan lama untuk ID yang sama; ID
+   pasangan lamanya di sisi lain tidak lagi ditemukan (juga dari disk). */
+int WINEB2B_msgid_index_put(WINEB2B_msgid_index* idx, const char* irc_id, const char* matrix_event_id);
+
+/* Mencari event_id Matrix untuk sebuah ID IRC. 0 jika ditemukan, -1 jika tidak */
+int WINEB2B_msgid_index_get_matrix(WINEB2B_msgid_index* idx, const char* irc_id,
+                                   char* out, size_t out_len);
+
+/* Mencari ID IRC untuk sebuah event_id Matrix. 0 jika ditemukan, -1 jika tidak */
+int WINEB2B_msgid_index_get_irc(WINEB2B_msgid_index* idx, const char* matrix_event_id,
+                                char* out, size_t out_len);
+
+/* Membuat ID sintetis yang stabil untuk pesan IRC tanpa tag msgid.
+   Hasilnya berbentuk "~<hex>" dan ditulis ke out (minimal 18 byte). */
+int WINEB2B_msgid_synthetic(char* out, size_t out_len,
+                            const char* network, const char* target,
+                            const char* nick, long timestamp, const char* body);
+
+/* Memaksa data log dan indeks ke disk (fsync) */
+int WINEB2B_msgid_index_sync(WINEB2B_msgid_index* idx);
+
+/* Mengambil statistik indeks */
+void WINEB2B_msgid_index_stats(const WINEB2B_msgid_index* idx, WINEB2B_msgid_stats* out);
+
+/* Menutup store dan membebaskan seluruh memori indeks */
+void WINEB2B_msgid_index_free(WINEB2B_msgid_index* idx);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // WINEB2B_MSGID_INDEX_H
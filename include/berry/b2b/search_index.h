@@ -0,0 +1,101 @@
+#ifndef WINEB2B_SEARCH_INDEX_H
+#define WINEB2B_SEARCH_INDEX_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Indeks full-text untuk riwayat pesan yang dibridge (IRC dan Matrix).
+
+   Pesan masuk ke buffer memori yang langsung bisa dicari. Saat penuh,
+   buffer ditulis oleh thread latar menjadi segmen immutable (file NNNNNNNN.fts
+   di satu direktori, dibaca lewat mmap) berisi kamus term terurut dan posting
+   list per term: ID dokumen delta+varint dan posisi token (untuk frasa),
+   dalam blok 128 dokumen dengan skip entry. Segmen bersebelahan yang
+   ukurannya setingkat digabung di latar (tiered merge), daftar segmen aktif
+   dicatat di file MANIFEST.
+
+   Tokenisasi sadar UTF-8: huruf/angka Latin, Yunani, Sirilik dll. menjadi
+   kata (huruf besar/kecil disamakan untuk Latin-1, Latin Extended-A, Yunani
+   dan Sirilik), tanda baca dan emoji memisahkan kata, setiap aksara CJK
+   (Han, Hiragana, Katakana) menjadi token sendiri, dan kode format IRC
+   (warna ^C, bold, dst.) diabaikan.
+
+   Hasil query selalu dari pesan terbaru ke terlama, sehingga query dengan
+   limit hanya membaca blok posting paling akhir. Aman dipakai dari beberapa
+   thread. */
+typedef struct _WINEB2B_search WINEB2B_search;
+
+/* Konfigurasi indeks. Nilai 0 berarti pakai default */
+typedef struct {
+    unsigned flush_docs;    /* Dokumen per buffer sebelum ditulis ke segmen (default 65536) */
+    unsigned merge_factor;  /* Segmen setingkat yang digabung sekaligus (default 8) */
+} WINEB2B_search_config;
+
+/* Satu pesan yang diindeks */
+typedef struct {
+    const char *network;    /* Misal "irc:irc.libera.chat" atau "matrix:matrix.org" */
+    const char *channel;    /* Channel IRC atau room_id Matrix */
+    const char *sender;     /* Nick atau user_id, boleh NULL */
+    int64_t timestamp;      /* Milidetik sejak epoch */
+    const char *text;
+} WINEB2B_search_doc;
+
+/* Hasil query. String menunjuk ke segmen/buffer dan hanya valid selama callback */
+typedef struct {
+    uint64_t id;            /* ID dokumen, naik menurut urutan masuk */
+    WINEB2B_search_doc doc;
+} WINEB2B_search_hit;
+
+/* Callback untuk setiap hasil. Kembalikan non-0 untuk berhenti.
+   Tidak boleh memanggil WINEB2B_search_add/commit pada indeks yang sama */
+typedef int (*WINEB2B_search_cb)(const WINEB2B_search_hit* hit, void* user);
+
+/* Statistik indeks */
+typedef struct {
+    uint64_t docs;          /* Dokumen terindeks, termasuk yang masih di buffer */
+    size_t buffered;        /* Dokumen di buffer memori yang belum ditulis ke segmen */
+    size_t segments;
+    size_t terms;           /* Jumlah term per segmen dijumlahkan */
+    uint64_t postings_bytes;/* Ukuran posting list terkompresi */
+    uint64_t disk_bytes;    /* Ukuran semua file segmen */
+    uint64_t merges;        /* Merge yang selesai sejak dibuka */
+} WINEB2B_search_stats;
+
+/* Membuka (atau membuat) indeks di direktori dir. config boleh NULL.
+   Mengembalikan NULL jika gagal */
+WINEB2B_search* WINEB2B_search_open(const char* dir, const WINEB2B_search_config* config);
+
+/* Mengindeks satu pesan (channel dan text wajib). Langsung bisa dicari,
+   tetapi baru tahan crash setelah buffernya ditulis ke segmen.
+   Mengembalikan ID dokumen, -1 jika gagal */
+int64_t WINEB2B_search_add(WINEB2B_search* s, const WINEB2B_search_doc* doc);
+
+/* Menulis buffer memori ke segmen dan menunggu sampai selesai.
+   Mengembalikan 0 jika berhasil, -1 jika penulisan gagal */
+int WINEB2B_search_commit(WINEB2B_search* s);
+
+/* Mencari pesan dari yang terbaru. Kata dalam query digabung dengan AND,
+   teks dalam tanda kutip ("kata kata") dicari sebagai frasa, begitu juga
+   deretan aksara CJK tanpa spasi. network dan channel (boleh NULL) membatasi
+   hasil ke jaringan/channel tertentu; channel dibandingkan tanpa membedakan
+   huruf besar/kecil ASCII. Query boleh kosong jika channel diberikan (pesan
+   terbaru di channel). limit 0 berarti tanpa batas.
+   Mengembalikan jumlah hasil yang diberikan ke cb, -1 jika query tidak valid */
+long WINEB2B_search_query(WINEB2B_search* s, const char* query, const char* network, const char* channel,
+                          size_t limit, WINEB2B_search_cb cb, void* user);
+
+/* Mengisi statistik indeks */
+void WINEB2B_search_get_stats(WINEB2B_search* s, WINEB2B_search_stats* out);
+
+/* Menulis buffer, menghentikan thread latar dan menutup indeks */
+void WINEB2B_search_close(WINEB2B_search* s);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // WINEB2B_SEARCH_INDEX_H
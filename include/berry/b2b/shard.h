@@ -0,0 +1,195 @@
+#ifndef WINEB2B_SHARD_H
+#define WINEB2B_SHARD_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Sharding route bridge ke beberapa proses (di satu atau beberapa host).
+
+   Route adalah pasangan (network, channel), misal ("libera", "#archlinux")
+   atau ("matrix", "!abc:server"). Route dibagi dengan consistent hashing:
+   setiap shard menaruh vnodes titik di ring 64-bit, dan route dimiliki
+   shard dengan titik pertama searah jarum jam dari hash route. Shard
+   masuk atau keluar hanya memindahkan sekitar 1/N route.
+
+   Keanggotaan diatur koordinator ringan (WINEB2B_shard_coord) lewat
+   socket Unix atau TCP dengan protokol baris teks. Setiap perubahan
+   anggota menjadi epoch baru yang dijalankan dua fase:
+   - VIEW: anggota menerima ring baru. Pemilik baru meng-acquire route
+     yang didapat (misal JOIN channel) dan menahan item untuknya di
+     antrean; pemilik lama tetap mengirim seperti biasa. Setelah semua
+     acquire selesai anggota menjawab READY.
+   - COMMIT: dikirim setelah semua anggota READY. Pemilik lama me-release
+     route (misal PART) dan setelah selesai mengirim DONE berisi key item
+     yang dikirimnya selama handover. Pemilik baru membuang item antrean
+     dengan key tersebut (salinan yang sudah dikirim pemilik lama) lalu
+     mengirim sisanya berurutan. Salinan yang belum terbaca dari network
+     ditunggu paling lama 2 detik.
+   Jadi selama handover item hanya tertahan sebentar, tidak dibuang dan
+   tidak terkirim ganda, asalkan network mengirim item dengan urutan yang
+   sama ke semua proses dan setiap item punya key unik (misal msgid IRC
+   atau event_id Matrix). Item untuk route milik shard lain diteruskan
+   lewat koordinator.
+
+   Anggota yang mati (koneksi putus atau tidak ada heartbeat) langsung
+   dikeluarkan dari ring dan route-nya diambil alih tanpa menunggu DONE;
+   item yang sedang diproses anggota tersebut hilang. Perubahan anggota
+   baru yang datang di tengah handover route yang sama juga bisa
+   kehilangan item di celah antara PART dan JOIN.
+
+   Nama network/channel/key tidak boleh berisi spasi atau baris baru.
+   Channel IRC dibandingkan apa adanya: normalisasi huruf (casemapping)
+   dilakukan pemanggil. Tidak thread-safe. */
+
+/* Alamat: "unix:/path/ke/socket" atau "tcp:host:port" (port 0 = dipilih kernel) */
+#define WINEB2B_SHARD_ADDR_MAX 128
+
+/* --- Ring consistent hashing --- */
+
+typedef struct _WINEB2B_ring WINEB2B_ring;
+
+WINEB2B_ring* WINEB2B_ring_create(void);
+
+/* Menambah shard dengan vnodes titik (0 = 64). -1 jika id sudah ada */
+int WINEB2B_ring_add(WINEB2B_ring* ring, const char* id, int vnodes);
+
+/* Mengeluarkan shard. -1 jika tidak ada */
+int WINEB2B_ring_remove(WINEB2B_ring* ring, const char* id);
+
+/* ID shard pemilik route, NULL jika ring kosong. Valid sampai ring diubah */
+const char* WINEB2B_ring_owner(const WINEB2B_ring* ring, const char* network, const char* channel);
+
+/* Jumlah shard */
+size_t WINEB2B_ring_size(const WINEB2B_ring* ring);
+
+void WINEB2B_ring_free(WINEB2B_ring* ring);
+
+/* --- Koordinator --- */
+
+typedef struct _WINEB2B_shard_coord WINEB2B_shard_coord;
+
+typedef struct {
+    size_t members;             /* Anggota di view terakhir */
+    uint64_t epoch;             /* Epoch view terakhir */
+    uint64_t committed;         /* Epoch terakhir yang sudah COMMIT */
+    uint64_t joins, leaves, failures;
+    uint64_t forwarded;         /* Item yang diteruskan ke pemilik route */
+    uint64_t unroutable;        /* Item dibuang karena ring kosong */
+    uint64_t max_commit_ms;     /* Waktu VIEW sampai COMMIT terlama */
+} WINEB2B_shard_coord_stats;
+
+/* Mendengarkan di address. Anggota tanpa pesan selama timeout_ms (0 = 3000)
+   dianggap mati, begitu juga anggota yang belum READY setelah timeout_ms.
+   secret wajib untuk "tcp:": anggota harus membuktikan tahu secret yang
+   sama (HMAC atas nonce kedua pihak) sebelum mendapat route. Untuk "unix:"
+   secret boleh NULL; koneksi dari uid lain selalu ditolak */
+WINEB2B_shard_coord* WINEB2B_shard_coord_create(const char* address, int timeout_ms, const char* secret);
+
+/* Alamat sebenarnya (port TCP sudah terisi jika port 0) */
+const char* WINEB2B_shard_coord_address(const WINEB2B_shard_coord* coord);
+
+/* Satu putaran: tunggu hingga timeout_ms, proses semua pesan anggota.
+   0 jika berhasil, -1 jika error */
+int WINEB2B_shard_coord_run(WINEB2B_shard_coord* coord, int timeout_ms);
+
+void WINEB2B_shard_coord_get_stats(const WINEB2B_shard_coord* coord, WINEB2B_shard_coord_stats* out);
+
+void WINEB2B_shard_coord_free(WINEB2B_shard_coord* coord);
+
+/* --- Anggota --- */
+
+typedef struct _WINEB2B_shard WINEB2B_shard;
+
+typedef struct {
+    /* Route menjadi milik shard ini. Kembalikan 0 jika sudah siap, 1 jika
+       masih berjalan (misal JOIN menunggu balasan server); panggil
+       WINEB2B_shard_acquired setelah selesai. READY baru dikirim setelah
+       semua route yang didapat siap */
+    int (*acquire)(const char* network, const char* channel, void* user);
+    /* Route tidak lagi milik shard ini (setelah COMMIT, atau VIEW yang
+       membatalkan acquire sebelumnya). Kembalikan 0 jika sudah selesai, 1
+       jika masih berjalan (misal PART); item yang datang sampai
+       WINEB2B_shard_released dipanggil tetap dikirim ke deliver, kecuali
+       setelah acquire yang dibatalkan (pemilik lain sudah mengirimnya) */
+    int (*release)(const char* network, const char* channel, void* user);
+    /* Item untuk route milik shard ini, berurutan per route. key boleh NULL */
+    void (*deliver)(const char* network, const char* channel, const char* key,
+                    const void* data, size_t len, void* user);
+} WINEB2B_shard_callbacks;
+
+typedef struct {
+    uint64_t epoch;             /* Epoch terakhir yang sudah COMMIT */
+    size_t members;             /* Shard di ring saat ini */
+    size_t routes;              /* Route terdaftar milik shard ini */
+    uint64_t delivered;
+    uint64_t forwarded;         /* Item dikirim ke pemilik lain */
+    uint64_t queued;            /* Item yang sempat diantrekan selama handover */
+    uint64_t duplicates;        /* Item antrean yang dibuang karena sudah dikirim pemilik lama */
+    uint64_t acquired, released;
+    uint64_t max_queue_ms;      /* Waktu antre terlama */
+    size_t queue_len;           /* Item yang sedang diantrekan */
+} WINEB2B_shard_stats;
+
+/* Nilai kembali WINEB2B_shard_submit */
+enum {
+    WINEB2B_SHARD_DELIVERED = 0,
+    WINEB2B_SHARD_QUEUED,
+    WINEB2B_SHARD_FORWARDED
+};
+
+/* Terhubung ke koordinator sebagai anggota id dengan vnodes titik (0 = 64).
+   secret sama dengan milik koordinator (wajib untuk "tcp:"); koordinator
+   juga harus membuktikannya sebelum join selesai. Callback disalin. NULL
+   jika gagal terhubung atau autentikasi gagal */
+WINEB2B_shard* WINEB2B_shard_join(const char* address, const char* id, int vnodes, const char* secret,
+                                  const WINEB2B_shard_callbacks* callbacks, void* user);
+
+/* File descriptor untuk poll di event loop aplikasi (POLLIN) */
+int WINEB2B_shard_fd(const WINEB2B_shard* shard);
+
+/* Satu putaran: tunggu hingga timeout_ms, proses pesan koordinator, kirim
+   heartbeat. 0 jika berhasil, -1 jika koneksi ke koordinator putus */
+int WINEB2B_shard_run(WINEB2B_shard* shard, int timeout_ms);
+
+/* Mendaftarkan route yang dilayani bridge. Route milik shard ini langsung
+   di-acquire saat view berikutnya diterapkan */
+int WINEB2B_shard_add_route(WINEB2B_shard* shard, const char* network, const char* channel);
+
+/* Acquire yang tertunda (acquire mengembalikan 1) sudah selesai. Dipanggil
+   sekali untuk setiap acquire tertunda, sesuai urutan; begitu juga
+   WINEB2B_shard_released untuk release */
+int WINEB2B_shard_acquired(WINEB2B_shard* shard, const char* network, const char* channel);
+
+/* Release yang tertunda (release mengembalikan 1) sudah selesai: tidak ada
+   item lagi dari network untuk route ini */
+int WINEB2B_shard_released(WINEB2B_shard* shard, const char* network, const char* channel);
+
+/* 1 jika route milik shard ini menurut view terakhir */
+int WINEB2B_shard_owns(const WINEB2B_shard* shard, const char* network, const char* channel);
+
+/* Item dari network untuk route: dikirim ke deliver, diantrekan selama
+   handover, atau diteruskan ke pemiliknya. Mengembalikan WINEB2B_SHARD_*,
+   -1 jika gagal */
+int WINEB2B_shard_submit(WINEB2B_shard* shard, const char* network, const char* channel,
+                         const char* key, const void* data, size_t len);
+
+/* Keluar dengan tertib: route diserahkan ke shard lain. Lanjutkan
+   WINEB2B_shard_run sampai WINEB2B_shard_left bernilai 1 */
+int WINEB2B_shard_leave(WINEB2B_shard* shard);
+
+/* 1 jika semua route sudah diserahkan setelah WINEB2B_shard_leave */
+int WINEB2B_shard_left(const WINEB2B_shard* shard);
+
+void WINEB2B_shard_get_stats(const WINEB2B_shard* shard, WINEB2B_shard_stats* out);
+
+void WINEB2B_shard_free(WINEB2B_shard* shard);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // WINEB2B_SHARD_H
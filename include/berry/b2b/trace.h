@@ -0,0 +1,82 @@
+#ifndef WINEB2B_TRACE_H
+#define WINEB2B_TRACE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+/* Trace per pesan lintas hop bridge (opsional, mati secara default).
+
+   Satu trace mengikuti satu pesan: diterima (WINEIRC_keep_alive atau
+   WINEIRC_loop), transformasi (trigger, filter echo), antre di loop kirim,
+   lalu fase HTTP perform_http_request (DNS, connect, TLS, tunggu
+   homeserver, body) dari timing curl. Trace aktif disimpan per thread;
+   driver yang dipanggil dari callback on_line otomatis mencatat span ke
+   trace pesan yang sedang diproses.
+
+   Span disimpan di ring berukuran tetap milik thread pencatat (yang lama
+   ditimpa), jadi memori terbatas walau tracing dibiarkan hidup. Sampling
+   1 dari N pesan; pesan yang tidak disampling hanya membayar satu
+   pemeriksaan variabel thread-local di setiap titik instrumentasi.
+
+   Hasil diekspor sebagai JSON Chrome trace-event (chrome://tracing,
+   Perfetto): satu slice per span, flow antar thread untuk trace yang sama,
+   dan ID trace di args. */
+
+/* Span per thread sebelum yang tertua ditimpa */
+#define WINEB2B_TRACE_SPANS 4096
+
+/* Panjang maksimum detail span (URL, server, target) termasuk '\0' */
+#define WINEB2B_TRACE_DETAIL 48
+
+typedef struct {
+    uint64_t traces;            /* Trace yang dimulai (lolos sampling) */
+    uint64_t spans;             /* Span yang dicatat */
+    uint64_t overwritten;       /* Span yang ditimpa karena ring penuh */
+} WINEB2B_trace_stats;
+
+/* 1 dari N pesan ditrace (0 = mati, 1 = semua). Hanya dibaca */
+extern unsigned WINEB2B_trace_sampling;
+
+/* Trace aktif thread ini, 0 jika tidak ada. Hanya dibaca */
+extern __thread uint64_t WINEB2B_trace_current;
+
+/* Mengatur sampling, lihat WINEB2B_trace_sampling */
+void WINEB2B_trace_set_sampling(unsigned one_in);
+
+/* Memulai trace untuk satu pesan bila lolos sampling dan menjadikannya
+   trace aktif thread ini. Mengembalikan ID trace, 0 jika tidak ditrace */
+uint64_t WINEB2B_trace_begin(void);
+
+/* Mengganti trace aktif thread ini (misal saat pesan diserahkan ke thread
+   lain). Mengembalikan trace aktif sebelumnya */
+uint64_t WINEB2B_trace_adopt(uint64_t trace);
+
+/* Mengakhiri trace aktif thread ini */
+void WINEB2B_trace_end(void);
+
+/* Waktu monotonic dalam nanodetik (satuan start/end span) */
+uint64_t WINEB2B_trace_now(void);
+
+/* Mencatat satu span [start_ns, end_ns) untuk trace (0 = tidak dicatat).
+   cat dan name harus string statis; detail disalin (boleh NULL) */
+void WINEB2B_trace_span(uint64_t trace, const char* cat, const char* name,
+                        uint64_t start_ns, uint64_t end_ns, const char* detail);
+
+/* Menulis semua span yang masih ada di ring ke path sebagai JSON Chrome
+   trace-event. Hanya trace yang rentangnya >= min_us (0 = semua) yang
+   diekspor. Mengembalikan jumlah trace yang ditulis, -1 jika gagal */
+int WINEB2B_trace_export(const char* path, uint64_t min_us);
+
+void WINEB2B_trace_get_stats(WINEB2B_trace_stats* out);
+
+/* Mengosongkan semua ring dan statistik */
+void WINEB2B_trace_reset(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // WINEB2B_TRACE_H
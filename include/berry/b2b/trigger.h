@@ -0,0 +1,51 @@
+#ifndef WINEB2B_TRIGGER_H
+#define WINEB2B_TRIGGER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+
+/* Flag per trigger */
+#define WINEB2B_TRIGGER_NOCASE 0x1   /* Cocokkan tanpa membedakan huruf besar/kecil (ASCII) */
+#define WINEB2B_TRIGGER_WORD   0x2   /* Hanya cocok jika dibatasi non-huruf/angka di kedua sisi */
+
+/* Satu entri tabel trigger */
+typedef struct {
+    const char *pattern;    /* Kata/perintah yang dicari (tidak boleh kosong) */
+    int id;                 /* ID yang dilaporkan saat cocok */
+    unsigned flags;         /* Kombinasi WINEB2B_TRIGGER_* */
+} WINEB2B_trigger_def;
+
+/* Matcher multi-pattern hasil kompilasi (automaton Aho-Corasick dengan
+   tabel transisi padat atas kelas byte). Dibangun sekali dari tabel trigger,
+   lalu setiap body pesan discan dalam satu lintasan: O(panjang + jumlah match). */
+typedef struct _WINEB2B_trigger_set WINEB2B_trigger_set;
+
+/* Callback untuk setiap match; [start, end) adalah posisi byte di teks.
+   Kembalikan non-0 untuk menghentikan scan. */
+typedef int (*WINEB2B_trigger_cb)(int id, size_t start, size_t end, void* user);
+
+/* Mengompilasi tabel trigger. NULL jika gagal */
+WINEB2B_trigger_set* WINEB2B_trigger_compile(const WINEB2B_trigger_def* defs, size_t count);
+
+/* Memindai teks dan memanggil cb untuk setiap match (cb boleh NULL).
+   Mengembalikan jumlah match yang dilaporkan. */
+int WINEB2B_trigger_scan(const WINEB2B_trigger_set* set, const char* text, size_t len,
+                         WINEB2B_trigger_cb cb, void* user);
+
+/* Mengembalikan ID match pertama (paling kiri berakhir), atau -1 jika tidak ada */
+int WINEB2B_trigger_first(const WINEB2B_trigger_set* set, const char* text, size_t len);
+
+/* Jumlah state automaton (untuk statistik/benchmark) */
+size_t WINEB2B_trigger_states(const WINEB2B_trigger_set* set);
+
+/* Membebaskan matcher */
+void WINEB2B_trigger_free(WINEB2B_trigger_set* set);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // WINEB2B_TRIGGER_H
@@ -0,0 +1,94 @@
+#ifndef IRC_DCC_H
+#define IRC_DCC_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Transfer file DCC SEND antar klien IRC, termasuk RESUME/ACCEPT dan DCC
+   pasif (reverse: penerima yang listen, ditandai port 0 dan token).
+
+   Negosiasi berjalan lewat CTCP di PRIVMSG: WINEIRC_dcc_parse membaca
+   teks pesan, WINEIRC_dcc_format membuat baris PRIVMSG lengkap untuk
+   dikirim (misal lewat WINEIRC_loop_send). Data file lewat koneksi TCP
+   langsung ke peer tanpa menyalin ke userspace: pengiriman memakai
+   sendfile() dari file, penerimaan memakai splice() socket -> pipe ->
+   file. Jika fd tidak mendukungnya, transfer jatuh ke read/write biasa.
+   Penerima mengirim ack 32-bit (jumlah byte, network byte order) sesuai
+   protokol DCC; pengirim menunggu ack terakhir sebelum menutup.
+
+   Transfer bersifat blocking (dengan timeout tanpa aktivitas), jadi
+   jalankan di thread atau proses sendiri. File yang diterima ditulis ke
+   fd milik pemanggil dan bisa langsung di-upload sebagai media Matrix
+   dengan WINEMATRIX_upload_media tanpa dimuat ke memori. Aplikasi yang
+   menerima offer dari pengguna sebaiknya membatasi ukuran dan alamat
+   tujuan sebelum terhubung. Hanya IPv4. */
+
+typedef enum {
+    WINEIRC_DCC_SEND = 1,
+    WINEIRC_DCC_RESUME,         /* Penerima meminta lanjut dari posisi */
+    WINEIRC_DCC_ACCEPT          /* Pengirim menyetujui RESUME */
+} WINEIRC_dcc_type;
+
+#define WINEIRC_DCC_NAME_MAX  256
+#define WINEIRC_DCC_TOKEN_MAX 32
+
+typedef struct {
+    WINEIRC_dcc_type type;
+    char filename[WINEIRC_DCC_NAME_MAX];    /* Tanpa direktori */
+    uint32_t ip;                /* SEND: alamat IPv4 (host byte order) */
+    int port;                   /* 0 = DCC pasif */
+    uint64_t size;              /* SEND: ukuran file (0 = tidak diketahui); RESUME/ACCEPT: posisi */
+    char token[WINEIRC_DCC_TOKEN_MAX];      /* Token DCC pasif, "" jika tidak ada */
+} WINEIRC_dcc_message;
+
+/* Membaca CTCP DCC dari teks PRIVMSG (dengan atau tanpa \001). Komponen
+   direktori di nama file dibuang. 0 jika valid, -1 jika bukan DCC yang didukung */
+int WINEIRC_dcc_parse(const char* text, WINEIRC_dcc_message* out);
+
+/* Membuat "PRIVMSG target :\001DCC ...\001\r\n". Nama file berspasi diberi
+   tanda kutip. Mengembalikan panjang, -1 jika buffer tidak cukup */
+int WINEIRC_dcc_format(const WINEIRC_dcc_message* msg, const char* target, char* out, size_t len);
+
+typedef struct _WINEIRC_dcc WINEIRC_dcc;
+
+typedef struct {
+    uint64_t bytes;             /* Byte file yang dipindahkan */
+    unsigned long syscalls;     /* Syscall data: sendfile/splice/read/write/recv/send, termasuk ack */
+    int zero_copy;              /* 1 jika sendfile/splice dipakai */
+    double seconds;             /* Lama transfer sejak koneksi siap */
+} WINEIRC_dcc_stats;
+
+/* Listen di bind_addr (NULL = semua interface) port (0 = dipilih kernel),
+   untuk offer SEND aktif atau jawaban DCC pasif. Koneksi peer diterima
+   saat transfer dimulai */
+WINEIRC_dcc* WINEIRC_dcc_listen(const char* bind_addr, int port);
+
+/* Port listener (untuk offer/jawaban), -1 jika bukan listener */
+int WINEIRC_dcc_port(const WINEIRC_dcc* dcc);
+
+/* Terhubung ke ip:port (dari offer SEND aktif atau jawaban DCC pasif) */
+WINEIRC_dcc* WINEIRC_dcc_connect(uint32_t ip, int port, int timeout_ms);
+
+/* Mengirim fd mulai offset (posisi ACCEPT, 0 jika tidak resume) sampai
+   size byte total. Mengembalikan byte yang terkirim, -1 jika gagal atau
+   peer berhenti sebelum ack terakhir */
+int64_t WINEIRC_dcc_send_file(WINEIRC_dcc* dcc, int fd, uint64_t offset, uint64_t size, int timeout_ms);
+
+/* Menerima ke fd mulai offset (posisi RESUME) sampai size byte total, atau
+   sampai peer menutup jika size 0. fd file ditulis di offset tersebut.
+   Mengembalikan byte yang diterima, -1 jika gagal atau terputus sebelum size */
+int64_t WINEIRC_dcc_receive_file(WINEIRC_dcc* dcc, int fd, uint64_t offset, uint64_t size, int timeout_ms);
+
+void WINEIRC_dcc_get_stats(const WINEIRC_dcc* dcc, WINEIRC_dcc_stats* out);
+
+void WINEIRC_dcc_free(WINEIRC_dcc* dcc);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // IRC_DCC_H
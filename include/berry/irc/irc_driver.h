@@ -6,6 +6,15 @@ extern "C" {
 #endif
 
 #include <sys/types.h>
+#include "irc_sasl.h"
+#include "irc_tls.h"
+#include "irc_parser.h"
+#include "irc_members.h"
+#include "irc_history.h"
+#include "metrics.h"
+#include "search_index.h"
+#include "msgid_index.h"
+#include "echo_filter.h"
 
 /* Tipe return untuk fungsi IRC */
 #define WINEIRCcode int
@@ -19,6 +28,18 @@ typedef struct _WINEIRC_handle {
     char *user;         /* User string (termasuk parameter USER) */
     char *channel;      /* Channel yang akan di-join */
     int is_connected;   /* Status koneksi */
+    WINEIRC_sasl_mechanism sasl_mechanism;  /* SASL saat registrasi, WINEIRC_SASL_NONE jika tidak */
+    char *sasl_account;
+    char *sasl_password;
+    int use_tls;        /* Koneksi memakai TLS (misal port 6697) */
+    WINEIRC_tls *tls;   /* Sesi TLS aktif, NULL jika plaintext atau terputus */
+    WINEIRC_tls_options tls_options;        /* Salinan opsi TLS untuk reconnect */
+    int loop_slot;      /* Slot di WINEIRC_loop, -1 jika tidak dikelola loop */
+    WINEB2B_metrics *metrics;               /* Metrik handle (protokol "irc") */
+    WINEIRC_members *members;               /* Daftar anggota channel, NULL jika tidak dilacak */
+    WINEB2B_search *search;                 /* Indeks pencarian pesan (bukan milik handle), NULL jika tidak diindeks */
+    WINEIRC_history *history;               /* Catch-up CHATHISTORY setelah reconnect, NULL jika tidak aktif */
+    WINEB2B_echo_filter *echo;              /* Filter echo bridge (bukan milik handle), NULL jika tidak dipakai */
 } WINEIRC_handle;
 
 /* Inisialisasi global (jika diperlukan) */
@@ -33,19 +54,100 @@ WINEIRC_handle* WINEIRC_create(const char* server, int port,
                                const char* user,
                                const char* channel);
 
+/* Sama dengan WINEIRC_create, tetapi login lewat SASL (CAP sasl) sebelum
+   registrasi selesai. Mengembalikan NULL jika server menolak autentikasi.
+   Kredensial disalin ke handle sehingga reconnect login ulang dengan SASL */
+WINEIRC_handle* WINEIRC_create_sasl(const char* server, int port,
+                                    const char* nick,
+                                    const char* user,
+                                    const char* channel,
+                                    const WINEIRC_sasl* sasl);
+
+/* Koneksi lewat TLS (tls tidak NULL) dengan SASL opsional (sasl boleh NULL).
+   Sesi TLS dipakai ulang antar handle ke server yang sama saat reconnect */
+WINEIRC_handle* WINEIRC_create_tls(const char* server, int port,
+                                   const char* nick,
+                                   const char* user,
+                                   const char* channel,
+                                   const WINEIRC_tls_options* tls,
+                                   const WINEIRC_sasl* sasl);
+
+/* Membuat handle untuk socket fd yang sudah login dan join (misal diterima
+   dari WINEIRC_handover_receive); tidak ada registrasi atau JOIN yang
+   dikirim. Dengan tls, fd harus sudah memakai kTLS untuk kedua arah:
+   handle->tls tetap NULL dan data dibaca/ditulis langsung di socket.
+   Opsi TLS dan SASL disimpan untuk reconnect. fd dimiliki handle */
+WINEIRC_handle* WINEIRC_create_fd(int fd, const char* server, int port,
+                                  const char* nick,
+                                  const char* user,
+                                  const char* channel,
+                                  const WINEIRC_tls_options* tls,
+                                  const WINEIRC_sasl* sasl);
+
 /* Join channel IRC yang telah dikonfigurasi dalam handle */
 WINEIRCcode WINEIRC_join_channel(WINEIRC_handle* handle);
 
 /* Mengirim pesan ke channel yang sudah di-join */
 WINEIRCcode WINEIRC_send_message(WINEIRC_handle* handle, const char* message);
 
+/* Mengirim pesan dengan tag IRCv3 (format "key=value;key2=value2",
+   nilai sudah di-escape). Tag kosong/NULL sama dengan WINEIRC_send_message */
+WINEIRCcode WINEIRC_send_tagged_message(WINEIRC_handle* handle, const char* tags, const char* message);
+
+/* Mulai melacak anggota channel yang di-join handle ini. Diisi oleh
+   WINEIRC_loop dari setiap baris masuk (sebelum on_line) dan dikosongkan
+   saat reconnect. callbacks boleh NULL; daftar dibaca lewat handle->members */
+WINEIRCcode WINEIRC_track_members(WINEIRC_handle* handle, const WINEIRC_members_callbacks* callbacks,
+                                  void* user_data);
+
+/* Mengaktifkan catch-up pesan yang terlewat setelah reconnect (lihat
+   irc_history.h). CAP batch, server-time dan draft/chathistory diminta saat
+   registrasi (dan langsung jika sudah terhubung). Baris diproses oleh
+   WINEIRC_loop atau WINEIRC_keep_alive; on_batch menerima pesan yang
+   terlewat sekaligus, misal untuk WINEMATRIX_import_messages */
+WINEIRCcode WINEIRC_track_history(WINEIRC_handle* handle, const WINEIRC_history_config* config,
+                                  const WINEIRC_history_callbacks* callbacks, void* user_data);
+
+/* Mengindeks PRIVMSG, NOTICE dan ACTION ke channel yang diterima WINEIRC_loop
+   ke search (network "irc:<server>", waktu dari tag server-time jika ada).
+   Indeks tidak dimiliki handle dan boleh dipakai bersama beberapa handle
+   maupun driver lain; NULL menghentikan pengindeksan */
+WINEIRCcode WINEIRC_index_messages(WINEIRC_handle* handle, WINEB2B_search* search);
+
+/* Memakai filter echo bridge untuk handle ini (network "irc:<server>").
+   Pesan yang dikirim lewat WINEIRC_send_message/WINEIRC_send_tagged_message
+   dicatat sidik jarinya; PRIVMSG/NOTICE channel yang diterima WINEIRC_loop
+   dengan tag WINEB2B_ORIGIN_TAG atau sidik jari yang masih tercatat dibuang
+   sebelum indeks pencarian dan on_line. Filter tidak dimiliki handle dan
+   boleh dipakai bersama driver lain; NULL mematikan filter */
+WINEIRCcode WINEIRC_filter_echoes(WINEIRC_handle* handle, WINEB2B_echo_filter* echo);
+
+/* ID pesan PRIVMSG/NOTICE untuk indeks msgid (msgid_index.h): tag msgid
+   jika ada, jika tidak ID sintetis dari server, target, nick, waktu
+   server-time (atau waktu lokal) dan teks. 0 jika berhasil */
+WINEIRCcode WINEIRC_message_id(const WINEIRC_handle* handle, const WINEIRC_message* msg, char* out, size_t out_len);
+
+/* Membaca data mentah dari server (didekripsi jika TLS). flags seperti
+   recv(): MSG_DONTWAIT dan MSG_PEEK didukung untuk TCP maupun TLS */
+ssize_t WINEIRC_recv(WINEIRC_handle* handle, void* buf, size_t len, int flags);
+
 /* Fungsi keep-alive alternatif: memonitor koneksi
    dan jika koneksi hilang, akan mencoba reconnect dan join kembali */
 WINEIRCcode WINEIRC_keep_alive(WINEIRC_handle* handle);
 
+/* Membuka koneksi baru, login ulang dan join channel (seperti yang dilakukan
+   WINEIRC_keep_alive), misal dari on_close WINEIRC_loop sebelum
+   WINEIRC_loop_add. Daftar anggota dikosongkan dan catch-up CHATHISTORY
+   dimulai setelah JOIN jika dilacak */
+WINEIRCcode WINEIRC_reconnect(WINEIRC_handle* handle);
+
 /* Disconnect dari server IRC */
 WINEIRCcode WINEIRC_disconnect(WINEIRC_handle* handle);
 
+/* Menutup socket tanpa QUIT dan tanpa close_notify TLS. Koneksi ke server
+   tetap hidup jika socket sudah diduplikasi ke proses lain (handover) */
+WINEIRCcode WINEIRC_abandon(WINEIRC_handle* handle);
+
 /* Membebaskan memori dan resource pada handle IRC */
 void WINEIRC_free(WINEIRC_handle* handle);
 
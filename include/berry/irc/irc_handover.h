@@ -0,0 +1,54 @@
+#ifndef IRC_HANDOVER_H
+#define IRC_HANDOVER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include "irc_driver.h"
+#include "irc_loop.h"
+
+/* Upgrade tanpa downtime: proses lama menyerahkan koneksi IRC yang masih
+   hidup ke proses pengganti lewat socket Unix, tanpa QUIT dan reconnect.
+
+   Untuk setiap handle, fd socket dikirim dengan SCM_RIGHTS bersama state
+   sesi: server, nick, user, channel, konfigurasi SASL/TLS (untuk reconnect
+   berikutnya), baris masuk yang belum lengkap dan antrean keluar yang
+   belum terkirim. Data yang datang selama handover tetap di buffer socket
+   kernel dan dibaca proses baru. Penyerahan dua fase: proses baru
+   mengonfirmasi setelah semua handle diterima, lalu proses lama menutup
+   salinan socket-nya dan mengirim DONE; baru setelah itu proses baru mulai
+   membaca. Jika gagal sebelum DONE, handle dikembalikan ke loop proses
+   lama dan proses baru membuang salinannya.
+
+   Handle TLS hanya bisa diserahkan jika kTLS aktif untuk kedua arah (state
+   record ada di kernel); proses baru memakai socket langsung tanpa sesi
+   OpenSSL, sehingga KeyUpdate atau renegosiasi dari server memutus koneksi
+   (on_close, lalu reconnect biasa). Daftar anggota channel, indeks
+   pencarian dan metrik tidak ikut diserahkan; aplikasi memasang ulang
+   (misal WINEIRC_track_members lalu NAMES). Kedua proses harus berjalan
+   dengan uid yang sama. */
+
+/* Proses lama: mendengarkan di path dan menunggu proses baru hingga
+   timeout_ms, lalu menyerahkan handles. Handle di loop dikeluarkan dengan
+   WINEIRC_loop_detach (loop boleh NULL jika tidak ada handle di loop);
+   WINEIRC_loop_run bisa dipanggil selama menunggu. Handle yang diserahkan
+   menjadi tidak terhubung (is_connected = 0) dan boleh di-free tanpa QUIT;
+   handle yang tidak bisa diserahkan (TLS tanpa kTLS, tidak terhubung)
+   dibiarkan. Mengembalikan jumlah handle yang diserahkan, -1 jika gagal */
+int WINEIRC_handover_send(const char* path, WINEIRC_loop* loop, WINEIRC_handle** handles, size_t count,
+                          int timeout_ms);
+
+/* Proses baru: terhubung ke path (dicoba ulang sampai proses lama siap,
+   hingga timeout_ms) dan menerima handle. Setiap handle dibuat dengan
+   WINEIRC_create_fd dan dimasukkan ke loop dengan WINEIRC_loop_attach.
+   *handles adalah array dari malloc (bebaskan dengan free setelah setiap
+   handle di-free). Mengembalikan jumlah handle, -1 jika gagal */
+int WINEIRC_handover_receive(const char* path, WINEIRC_loop* loop, WINEIRC_handle*** handles, int timeout_ms);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // IRC_HANDOVER_H
@@ -0,0 +1,101 @@
+#ifndef IRC_HISTORY_H
+#define IRC_HISTORY_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Mengejar pesan channel yang terlewat selama koneksi putus lewat IRCv3
+   CHATHISTORY (draft/chathistory, batch, server-time, message-tags).
+
+   Pesan PRIVMSG/NOTICE channel yang masuk dicatat sebagai titik terakhir
+   (msgid dan waktu server) per channel. Setelah reconnect, saat NAMES
+   channel selesai (366 untuk JOIN sendiri), modul menyusun
+   "CHATHISTORY AFTER #chan msgid=<id> <limit>" (atau timestamp= jika
+   server tidak memberi msgid, juga sebagai fallback jika msgid ditolak).
+   Jawaban BATCH chathistory dikumpulkan, halaman penuh diminta lanjut, lalu
+   semua pesan yang terlewat diserahkan sekaligus ke on_batch, terurut dan
+   tanpa duplikat (msgid yang sudah terlihat dibuang; tanpa msgid dipakai
+   kunci waktu+nick+teks). Pesan dari nick sendiri tidak ikut.
+
+   Selama catch-up channel berjalan, pesan live channel itu ditahan dan baru
+   dilepas setelah on_batch (dengan duplikat dibuang), sehingga urutan tetap
+   terjaga. FAIL CHATHISTORY atau timeout mengakhiri catch-up dengan pesan
+   yang sudah terkumpul. Baris keluar diambil lewat next_request dan baris
+   live yang dilepas lewat next_released; WINEIRC_loop melakukannya sendiri.
+   Tidak thread-safe. */
+
+typedef struct _WINEIRC_history WINEIRC_history;
+
+#define WINEIRC_HISTORY_MSGID_MAX 128
+
+typedef struct {
+    const char* msgid;          /* Tag msgid, "" jika tidak ada */
+    int64_t time_ms;            /* Tag time (server-time), 0 jika tidak ada */
+    const char* nick;
+    const char* command;        /* "PRIVMSG" atau "NOTICE" */
+    const char* text;           /* Termasuk CTCP ACTION apa adanya */
+} WINEIRC_history_message;
+
+typedef struct {
+    /* Pesan yang terlewat di channel, terurut. String hanya valid selama callback */
+    void (*on_batch)(const char* channel, const WINEIRC_history_message* messages, size_t count,
+                     void* user_data);
+} WINEIRC_history_callbacks;
+
+typedef struct {
+    unsigned page_limit;        /* Pesan per CHATHISTORY (default 100, dibatasi CHATHISTORY=N dari 005) */
+    unsigned max_messages;      /* Batas pesan per catch-up (default 10000) */
+    unsigned dedup_window;      /* Jumlah kunci pesan terakhir yang diingat (default 4096) */
+    int timeout_ms;             /* Batas tunggu tiap halaman (default 10000) */
+} WINEIRC_history_config;
+
+typedef struct {
+    unsigned long requests;     /* CHATHISTORY terkirim */
+    unsigned long catchups;     /* on_batch dipanggil */
+    unsigned long replayed;     /* Pesan yang diserahkan ke on_batch */
+    unsigned long duplicates;   /* Pesan dibuang karena sudah terlihat */
+    unsigned long held;         /* Baris live yang ditahan selama catch-up */
+    unsigned long failures;     /* FAIL CHATHISTORY dan timeout */
+    unsigned long truncated;    /* Catch-up yang berhenti di max_messages */
+} WINEIRC_history_stats;
+
+/* config dan callbacks boleh NULL (default, tanpa callback) */
+WINEIRC_history* WINEIRC_history_create(const char* self_nick, const WINEIRC_history_config* config,
+                                        const WINEIRC_history_callbacks* callbacks, void* user_data);
+
+/* Memproses satu baris mentah (tanpa "\r\n"). Mengembalikan 1 jika baris
+   ditahan atau dibuang modul (anggota BATCH chathistory, pesan live selama
+   catch-up, duplikat) dan tidak boleh diproses pemanggil, 0 jika tidak */
+int WINEIRC_history_feed_line(WINEIRC_history* h, const char* line);
+
+/* Baris berikutnya untuk dikirim ke server (dengan "\r\n"). Panjang, 0 jika
+   tidak ada, -1 jika out terlalu kecil */
+int WINEIRC_history_next_request(WINEIRC_history* h, char* out, size_t out_len);
+
+/* Baris live tertahan berikutnya yang sudah boleh diproses (tanpa "\r\n").
+   Panjang, 0 jika tidak ada, -1 jika out terlalu kecil (baris dibuang) */
+int WINEIRC_history_next_released(WINEIRC_history* h, char* out, size_t out_len);
+
+/* Koneksi putus: catch-up yang berjalan diserahkan sebagian, baris tertahan
+   dibuang (akan diambil lagi lewat CHATHISTORY) dan status CAP dilupakan */
+void WINEIRC_history_disconnected(WINEIRC_history* h);
+
+/* Titik terakhir channel untuk disimpan/dipulihkan antar restart.
+   get: 0 jika ada (msgid boleh ""), -1 jika channel belum pernah terlihat */
+int WINEIRC_history_get_last(const WINEIRC_history* h, const char* channel, char* msgid, size_t msgid_len,
+                             int64_t* time_ms);
+int WINEIRC_history_set_last(WINEIRC_history* h, const char* channel, const char* msgid, int64_t time_ms);
+
+void WINEIRC_history_get_stats(const WINEIRC_history* h, WINEIRC_history_stats* out);
+
+void WINEIRC_history_free(WINEIRC_history* h);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // IRC_HISTORY_H
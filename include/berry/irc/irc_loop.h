@@ -0,0 +1,118 @@
+#ifndef IRC_LOOP_H
+#define IRC_LOOP_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include "irc_driver.h"
+
+/* Event loop untuk banyak koneksi IRC sekaligus (misal ribuan puppet).
+
+   Dua backend dengan API yang sama:
+   - POLL: poll() lalu recv()/send() per koneksi yang siap.
+   - URING: io_uring. Satu multishot recv per koneksi yang mengisi buffer
+     dari ring buffer milik kernel (provided buffer ring), semua send yang
+     antre dikirim sebagai satu batch SQE per putaran, dan PING keepalive
+     dikirim dengan linked timeout sehingga koneksi yang macet dibatalkan
+     oleh kernel. Satu io_uring_enter per putaran untuk submit dan tunggu.
+
+   Baris masuk diteruskan ke callback tanpa "\r\n"; PING dari server
+   dijawab PONG otomatis. Loop membaca socket langsung, jadi handle TLS
+   hanya diterima jika kTLS aktif untuk kedua arah. Loop tidak thread-safe:
+   semua fungsi dipanggil dari thread yang sama. */
+
+typedef enum {
+    WINEIRC_BACKEND_AUTO = 0,   /* URING jika kernel mendukung, selain itu POLL */
+    WINEIRC_BACKEND_POLL,
+    WINEIRC_BACKEND_URING
+} WINEIRC_backend;
+
+typedef struct {
+    /* Satu baris dari server. line boleh diubah selama callback */
+    void (*on_line)(WINEIRC_handle* handle, char* line, void* user_data);
+    /* Koneksi ditutup server atau mati (keepalive). Handle sudah dikeluarkan
+       dari loop saat callback dipanggil; boleh di-free atau di-reconnect */
+    void (*on_close)(WINEIRC_handle* handle, void* user_data);
+} WINEIRC_loop_callbacks;
+
+typedef struct {
+    unsigned long syscalls;     /* Syscall I/O loop: poll/recv/send atau io_uring_enter */
+    unsigned long lines;        /* Baris yang diteruskan ke on_line */
+    unsigned long bytes_in;
+    unsigned long bytes_out;
+    unsigned long sends;        /* Operasi send (syscall atau SQE) */
+    unsigned long pings;        /* PING keepalive yang dikirim */
+    unsigned long dead;         /* Koneksi yang diputus karena keepalive */
+    unsigned long buffer_stalls;/* Multishot recv berhenti karena ring buffer habis */
+} WINEIRC_loop_stats;
+
+/* Sisa koneksi yang dikeluarkan dengan WINEIRC_loop_detach */
+typedef struct {
+    char *in;                   /* Awal baris masuk yang belum lengkap */
+    size_t in_len;
+    char *out;                  /* Antrean yang belum dikirim ke server */
+    size_t out_len;
+} WINEIRC_loop_pending;
+
+typedef struct _WINEIRC_loop WINEIRC_loop;
+
+/* 1 jika kernel mendukung semua fitur io_uring yang dipakai backend URING */
+int WINEIRC_loop_uring_supported(void);
+
+/* Membuat loop. BACKEND_URING gagal (NULL) jika kernel tidak mendukung */
+WINEIRC_loop* WINEIRC_loop_create(WINEIRC_backend backend, const WINEIRC_loop_callbacks* callbacks,
+                                  void* user_data);
+
+/* Backend yang benar-benar dipakai */
+WINEIRC_backend WINEIRC_loop_backend(const WINEIRC_loop* loop);
+
+/* Interval keepalive (ms): koneksi yang diam selama interval dikirimi PING,
+   dan dianggap mati jika tetap diam satu interval lagi. 0 = mati.
+   Default 120000 */
+void WINEIRC_loop_set_keepalive(WINEIRC_loop* loop, int interval_ms);
+
+/* Memasukkan handle yang sudah terhubung (setelah registrasi) ke loop */
+WINEIRCcode WINEIRC_loop_add(WINEIRC_loop* loop, WINEIRC_handle* handle);
+
+/* Mengeluarkan handle dari loop tanpa menutup socket. Wajib dipanggil
+   sebelum WINEIRC_free untuk handle yang masih ada di loop */
+WINEIRCcode WINEIRC_loop_remove(WINEIRC_loop* loop, WINEIRC_handle* handle);
+
+/* Seperti WINEIRC_loop_remove, tetapi sisa baris masuk dan antrean keluar
+   dikembalikan di pending (buffer dari malloc, bebaskan dengan free) agar
+   koneksi bisa dilanjutkan di loop atau proses lain tanpa kehilangan data.
+   URING: mengembalikan 1 selama recv/send masih berjalan di kernel (recv
+   dibatalkan, baris yang sudah masuk tetap ke on_line); panggil
+   WINEIRC_loop_run lalu ulangi. Antrean tidak dikirim lagi sejak panggilan
+   pertama. Tidak boleh dipanggil dari callback loop. 0 jika selesai, -1
+   jika gagal */
+WINEIRCcode WINEIRC_loop_detach(WINEIRC_loop* loop, WINEIRC_handle* handle, WINEIRC_loop_pending* pending);
+
+/* Seperti WINEIRC_loop_add, lalu pending dari WINEIRC_loop_detach dipasang:
+   baris yang belum lengkap disambung dengan data berikutnya dari socket dan
+   antrean dikirim pada WINEIRC_loop_run berikutnya. pending boleh NULL.
+   Untuk handle yang detach-nya belum selesai (mengembalikan 1) dengan
+   pending NULL, detach dibatalkan dan koneksi berjalan lagi seperti biasa */
+WINEIRCcode WINEIRC_loop_attach(WINEIRC_loop* loop, WINEIRC_handle* handle, const WINEIRC_loop_pending* pending);
+
+/* Mengantrekan data (satu atau beberapa baris lengkap dengan "\r\n").
+   Dikirim pada WINEIRC_loop_run berikutnya bersama antrean koneksi lain */
+WINEIRCcode WINEIRC_loop_send(WINEIRC_loop* loop, WINEIRC_handle* handle, const char* data, size_t len);
+
+/* Satu putaran: kirim antrean, tunggu event hingga timeout_ms (-1 = tanpa
+   batas), proses semua baris masuk. Mengembalikan jumlah baris, -1 jika error */
+int WINEIRC_loop_run(WINEIRC_loop* loop, int timeout_ms);
+
+/* Mengambil statistik loop */
+void WINEIRC_loop_get_stats(const WINEIRC_loop* loop, WINEIRC_loop_stats* out);
+
+/* Membebaskan loop. Handle yang masih terdaftar dikeluarkan tanpa on_close */
+void WINEIRC_loop_free(WINEIRC_loop* loop);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // IRC_LOOP_H
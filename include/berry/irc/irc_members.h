@@ -0,0 +1,108 @@
+#ifndef IRC_MEMBERS_H
+#define IRC_MEMBERS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include "irc_parser.h"
+
+/* Daftar anggota channel per koneksi IRC, diperbarui secara inkremental.
+
+   Diisi sekali dari NAMES (353/366) atau WHOX (354/315) saat join, lalu
+   JOIN/PART/QUIT/KICK/NICK/MODE menerapkan perubahan tanpa query ulang.
+   Nick di-intern satu kali per koneksi (dibandingkan sesuai CASEMAPPING
+   dari 005); setiap channel menyimpan anggota sebagai record 8 byte
+   (ID nick + bit mode prefix) di tabel hash, sehingga JOIN/PART/KICK/MODE
+   O(1), NICK O(1) (ID tidak berubah) dan QUIT O(jumlah channel nick itu).
+
+   QUIT dalam BATCH netsplit (IRCv3 batch), atau QUIT beruntun dengan alasan
+   netsplit ("server.a server.b") dari server tanpa batch, ditahan lalu
+   diterapkan sekaligus dengan satu callback on_quit_batch. QUIT tertahan
+   diterapkan saat batch ditutup, atau (tanpa batch) saat baris lain masuk
+   dan pada WINEIRC_members_flush.
+
+   PREFIX, CHANMODES, CHANTYPES dan CASEMAPPING dibaca dari 005; default
+   PREFIX=(ov)@+ dan casemapping rfc1459. Tidak thread-safe. */
+
+typedef struct _WINEIRC_members WINEIRC_members;
+
+/* Token query WHOX yang dikenali: "WHO #chan %tcnf,<token>" */
+#define WINEIRC_MEMBERS_WHOX_TOKEN "152"
+
+typedef enum {
+    WINEIRC_MEMBER_JOIN,
+    WINEIRC_MEMBER_PART,
+    WINEIRC_MEMBER_KICK,
+    WINEIRC_MEMBER_QUIT,        /* channel NULL */
+    WINEIRC_MEMBER_NICK,        /* channel NULL, old_nick = nick lama */
+    WINEIRC_MEMBER_MODE,        /* Bit mode prefix anggota berubah */
+    WINEIRC_MEMBER_SYNCED       /* NAMES/WHOX selesai; nick NULL */
+} WINEIRC_member_event;
+
+typedef struct {
+    /* Satu perubahan. String hanya valid selama callback */
+    void (*on_change)(WINEIRC_member_event event, const char* channel, const char* nick,
+                      const char* old_nick, void* user_data);
+    /* QUIT netsplit yang diterapkan sekaligus (pengganti on_change QUIT) */
+    void (*on_quit_batch)(const char* const* nicks, size_t count, void* user_data);
+} WINEIRC_members_callbacks;
+
+typedef struct {
+    size_t channels;
+    size_t nicks;               /* Nick unik yang di-intern */
+    size_t memberships;         /* Total pasangan (channel, nick) */
+    size_t bytes;               /* Perkiraan memori tabel dan string */
+    unsigned long batched_quits;/* QUIT yang diterapkan lewat batch */
+} WINEIRC_members_stats;
+
+/* Membuat daftar anggota untuk koneksi dengan nick sendiri self_nick */
+WINEIRC_members* WINEIRC_members_create(const char* self_nick, const WINEIRC_members_callbacks* callbacks,
+                                        void* user_data);
+
+/* Menerapkan satu pesan yang sudah diparse */
+void WINEIRC_members_feed(WINEIRC_members* m, const WINEIRC_message* msg);
+
+/* Sama dengan WINEIRC_members_feed untuk baris mentah (tanpa "\r\n").
+   Baris yang tidak relevan (PRIVMSG, dst) dilewati tanpa diparse */
+void WINEIRC_members_feed_line(WINEIRC_members* m, const char* line);
+
+/* Menerapkan QUIT netsplit tertahan di luar BATCH. WINEIRC_loop memanggilnya
+   setelah setiap pembacaan */
+void WINEIRC_members_flush(WINEIRC_members* m);
+
+/* Melupakan semua channel (misal setelah reconnect) */
+void WINEIRC_members_reset(WINEIRC_members* m);
+
+/* Menyusun query WHOX untuk mengisi ulang channel. Panjang hasil, -1 jika out kecil */
+int WINEIRC_members_whox_request(const char* channel, char* out, size_t out_len);
+
+/* 0 jika nick anggota channel (modes diisi bit prefix, boleh NULL), -1 jika tidak */
+int WINEIRC_members_get(const WINEIRC_members* m, const char* channel, const char* nick, unsigned* modes);
+
+/* Jumlah anggota channel (0 jika tidak sedang di channel itu) */
+size_t WINEIRC_members_count(const WINEIRC_members* m, const char* channel);
+
+/* 1 jika NAMES/WHOX channel sudah selesai diterima */
+int WINEIRC_members_synced(const WINEIRC_members* m, const char* channel);
+
+/* 1 jika nick ada di salah satu channel (cek tabrakan nick puppet) */
+int WINEIRC_members_nick_known(const WINEIRC_members* m, const char* nick);
+
+/* Simbol prefix tertinggi dari bit mode (misal '@'), 0 jika tidak ada */
+char WINEIRC_members_prefix(const WINEIRC_members* m, unsigned modes);
+
+/* Memanggil cb untuk setiap anggota channel. Mengembalikan jumlah anggota */
+size_t WINEIRC_members_foreach(const WINEIRC_members* m, const char* channel,
+                               void (*cb)(const char* nick, unsigned modes, void* user_data), void* user_data);
+
+void WINEIRC_members_get_stats(const WINEIRC_members* m, WINEIRC_members_stats* out);
+
+void WINEIRC_members_free(WINEIRC_members* m);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // IRC_MEMBERS_H
@@ -0,0 +1,54 @@
+#ifndef IRC_PARSER_H
+#define IRC_PARSER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Batas sesuai IRCv3 message-tags dan RFC 1459 */
+#define WINEIRC_MAX_TAGS   32
+#define WINEIRC_MAX_PARAMS 15
+#define WINEIRC_LINE_MAX   8704    /* Baris utuh: 8191 byte tag + 512 byte pesan */
+
+/* Satu tag IRCv3 (value NULL jika tag tanpa nilai) */
+typedef struct {
+    const char *key;
+    const char *value;
+} WINEIRC_tag;
+
+/* Hasil parsing satu baris IRC. Semua pointer menunjuk ke dalam buffer baris
+   yang diparse, sehingga hanya valid selama buffer tersebut belum diubah. */
+typedef struct {
+    WINEIRC_tag tags[WINEIRC_MAX_TAGS];
+    int tag_count;
+    const char *prefix;     /* "nick!user@host" atau nama server, NULL jika tidak ada */
+    const char *command;    /* Perintah atau numeric, misal "PRIVMSG" / "353" */
+    const char *params[WINEIRC_MAX_PARAMS];
+    int param_count;        /* Parameter terakhir (trailing) sudah tanpa ':' */
+} WINEIRC_message;
+
+/* Memparse satu baris IRC (tanpa "\r\n") secara in-place.
+   Nilai tag di-unescape langsung di buffer. 0 jika berhasil, -1 jika tidak valid. */
+int WINEIRC_parse_line(char* line, WINEIRC_message* msg);
+
+/* Mencari nilai tag berdasarkan key. Tag tanpa nilai mengembalikan "" */
+const char* WINEIRC_message_tag(const WINEIRC_message* msg, const char* key);
+
+/* Tag time IRCv3 ("2024-01-02T03:04:05.678Z") ke milidetik epoch, 0 jika tidak valid */
+int64_t WINEIRC_server_time(const char* value);
+
+/* Menyalin bagian nick dari prefix "nick!user@host" ke out */
+int WINEIRC_prefix_nick(const char* prefix, char* out, size_t out_len);
+
+/* Meng-escape nilai tag sesuai IRCv3 (';' -> "\:", ' ' -> "\s", dst).
+   Mengembalikan panjang hasil, atau -1 jika out terlalu kecil. */
+int WINEIRC_escape_tag_value(const char* value, char* out, size_t out_len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // IRC_PARSER_H
@@ -0,0 +1,85 @@
+#ifndef IRC_SASL_H
+#define IRC_SASL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+
+/* Mekanisme SASL yang didukung untuk registrasi IRC (IRCv3 sasl) */
+typedef enum {
+    WINEIRC_SASL_NONE = 0,
+    WINEIRC_SASL_PLAIN,
+    WINEIRC_SASL_EXTERNAL,      /* Autentikasi lewat sertifikat klien TLS */
+    WINEIRC_SASL_SCRAM_SHA_256
+} WINEIRC_sasl_mechanism;
+
+/* Kredensial SASL untuk WINEIRC_create_sasl */
+typedef struct {
+    WINEIRC_sasl_mechanism mechanism;
+    const char *account;        /* Nama akun (authcid); tidak dipakai untuk EXTERNAL */
+    const char *password;       /* Tidak dipakai untuk EXTERNAL */
+} WINEIRC_sasl;
+
+/* Nama mekanisme untuk perintah AUTHENTICATE, misal "SCRAM-SHA-256" */
+const char* WINEIRC_sasl_mechanism_name(WINEIRC_sasl_mechanism mechanism);
+
+/* Base64 standar dengan padding. Mengembalikan panjang hasil (tanpa NUL),
+   atau -1 jika buffer tidak cukup */
+int WINEIRC_base64_encode(const unsigned char* in, size_t len, char* out, size_t out_len);
+
+/* Decode base64. Mengembalikan jumlah byte, -1 jika input tidak valid */
+int WINEIRC_base64_decode(const char* in, size_t len, unsigned char* out, size_t out_len);
+
+/* Response SASL PLAIN (RFC 4616) dalam base64: NUL account NUL password */
+int WINEIRC_sasl_plain(const char* account, const char* password, char* out, size_t out_len);
+
+/* Pertukaran SCRAM-SHA-256 (RFC 5802 / RFC 7677) dari sisi klien.
+
+   Bagian mahal SCRAM adalah PBKDF2 atas password (ribuan iterasi).
+   Hasil turunannya (ClientKey dan ServerKey) disimpan di cache dalam
+   proses dengan kunci (password, salt, iterasi), sehingga login ulang
+   dengan salt yang sama, misalnya saat ribuan puppet reconnect setelah
+   netsplit, tidak menjalankan KDF lagi. Password tidak disimpan di cache. */
+typedef struct _WINEIRC_scram WINEIRC_scram;
+
+/* Membuat state SCRAM. nonce NULL = nonce acak (nonce tetap hanya untuk test) */
+WINEIRC_scram* WINEIRC_scram_create(const char* account, const char* password, const char* nonce);
+
+/* client-first-message ("n,,n=user,r=nonce"). Mengembalikan panjang, -1 jika gagal */
+int WINEIRC_scram_client_first(WINEIRC_scram* scram, char* out, size_t out_len);
+
+/* Memproses server-first-message dan menghasilkan client-final-message
+   (dengan proof). -1 jika pesan server tidak valid */
+int WINEIRC_scram_client_final(WINEIRC_scram* scram, const char* server_first, char* out, size_t out_len);
+
+/* Memverifikasi server-final-message ("v=..."). 0 jika tanda tangan server cocok */
+int WINEIRC_scram_verify_server(WINEIRC_scram* scram, const char* server_final);
+
+/* Membebaskan state SCRAM (material kunci dihapus dari memori) */
+void WINEIRC_scram_free(WINEIRC_scram* scram);
+
+/* Statistik cache kunci turunan */
+typedef struct {
+    unsigned long hits;
+    unsigned long misses;
+    unsigned long entries;
+    unsigned long capacity;
+} WINEIRC_scram_cache_stats;
+
+/* Mengatur kapasitas cache (entri); 0 mematikan cache. Default 8192 entri.
+   Isi cache dan statistik dikosongkan. Aman dipanggil dari banyak thread */
+void WINEIRC_scram_cache_configure(size_t entries);
+
+/* Mengosongkan cache dan menghapus material kunci */
+void WINEIRC_scram_cache_clear(void);
+
+/* Mengambil statistik cache */
+void WINEIRC_scram_cache_get_stats(WINEIRC_scram_cache_stats* out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // IRC_SASL_H
@@ -0,0 +1,82 @@
+#ifndef IRC_TLS_H
+#define IRC_TLS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <sys/types.h>
+
+/* Opsi TLS untuk koneksi IRC (biasanya port 6697) */
+typedef struct {
+    int insecure;               /* 1 = tanpa verifikasi sertifikat server (hanya untuk test) */
+    const char *ca_file;        /* CA tambahan (PEM), NULL = CA bawaan sistem */
+    const char *cert_file;      /* Sertifikat klien (PEM) untuk SASL EXTERNAL, NULL jika tidak ada */
+    const char *key_file;       /* Private key sertifikat klien, NULL = sama dengan cert_file */
+    int no_ktls;                /* 1 = jangan serahkan record ke kTLS walaupun kernel mendukung */
+} WINEIRC_tls_options;
+
+/* Satu sesi TLS di atas socket yang sudah terhubung.
+
+   Sesi (session ticket TLS 1.3 / session ID TLS 1.2) disimpan di cache
+   global per host:port, sertifikat klien dan mode verifikasi (insecure /
+   ca_file) dan dipakai semua handle ke server yang sama dengan opsi itu,
+   sehingga reconnect cukup melakukan handshake singkat (resumption).
+   Jika kernel mendukung kTLS, enkripsi record dipindahkan ke kernel
+   setelah handshake: WINEIRC_tls_send langsung memanggil send() pada
+   socket tanpa salinan ke buffer OpenSSL. */
+typedef struct _WINEIRC_tls WINEIRC_tls;
+
+/* Handshake TLS pada fd (blocking). server dipakai untuk SNI dan
+   verifikasi nama host. Mengembalikan NULL jika handshake gagal;
+   fd tidak ditutup */
+WINEIRC_tls* WINEIRC_tls_connect(int fd, const char* server, int port, const WINEIRC_tls_options* options);
+
+/* Mengirim seluruh buffer. Mengembalikan len, atau -1 jika gagal */
+ssize_t WINEIRC_tls_send(WINEIRC_tls* tls, const void* buf, size_t len);
+
+/* Membaca data aplikasi. flags mendukung MSG_PEEK dan MSG_DONTWAIT
+   (errno EAGAIN jika belum ada data). 0 = koneksi ditutup */
+ssize_t WINEIRC_tls_recv(WINEIRC_tls* tls, void* buf, size_t len, int flags);
+
+/* Jumlah byte yang sudah didekripsi tetapi belum dibaca; socket bisa
+   tidak readable walaupun nilai ini > 0 */
+size_t WINEIRC_tls_pending(const WINEIRC_tls* tls);
+
+/* 1 jika handshake terakhir memakai sesi dari cache */
+int WINEIRC_tls_resumed(const WINEIRC_tls* tls);
+
+/* 1 jika pengiriman (tx) / penerimaan (rx) ditangani kTLS */
+int WINEIRC_tls_ktls_tx(const WINEIRC_tls* tls);
+int WINEIRC_tls_ktls_rx(const WINEIRC_tls* tls);
+
+/* Mengirim close_notify dan membebaskan sesi; fd tidak ditutup */
+void WINEIRC_tls_close(WINEIRC_tls* tls);
+
+/* Membebaskan sesi tanpa close_notify, misal karena socket (dengan kTLS)
+   sudah diserahkan ke proses lain; fd tidak ditutup */
+void WINEIRC_tls_abandon(WINEIRC_tls* tls);
+
+/* Statistik global transport TLS */
+typedef struct {
+    unsigned long handshakes;   /* Handshake yang berhasil */
+    unsigned long resumed;      /* Di antaranya yang memakai sesi dari cache */
+    unsigned long ktls_tx;      /* Koneksi dengan kTLS untuk pengiriman */
+    unsigned long ktls_rx;      /* Koneksi dengan kTLS untuk penerimaan */
+    unsigned long cached_sessions;
+} WINEIRC_tls_stats;
+
+void WINEIRC_tls_get_stats(WINEIRC_tls_stats* out);
+
+/* Menghapus semua sesi di cache (misal setelah ganti sertifikat klien) */
+void WINEIRC_tls_flush_sessions(void);
+
+/* Membebaskan context dan cache global (dipanggil dari WINEIRC_global_cleanup) */
+void WINEIRC_tls_cleanup(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // IRC_TLS_H
@@ -6,6 +6,15 @@ extern "C" {
 #endif
 
 #include <stddef.h>
+#include "metrics.h"
+#include "matrix_state.h"
+#include "matrix_store.h"
+#include "matrix_media.h"
+#include "matrix_sliding.h"
+#include "matrix_import.h"
+#include "search_index.h"
+#include "msgid_index.h"
+#include "echo_filter.h"
 
 /* Jika belum didefinisikan, WINEMATRIXcode didefinisikan sebagai macro kosong.
    Macro ini dapat digunakan untuk mengatur visibility export bila diperlukan. */
@@ -24,6 +33,13 @@ typedef struct {
     char *username;       ///< ID pengguna Matrix (contoh: "@user:matrix.org")
     char *password;       ///< Password pengguna
     char *access_token;   ///< Token akses yang didapatkan setelah login
+    WINEB2B_metrics *metrics; ///< Metrik handle (protokol "matrix"), lihat metrics.h
+    WINEMATRIX_state *state;  ///< Cache state room dari /sync, NULL jika tidak dipakai (lihat WINEMATRIX_track_state)
+    WINEMATRIX_store *store;  ///< Event store lokal, NULL jika tidak dipakai (lihat WINEMATRIX_open_store)
+    WINEB2B_search *search;   ///< Indeks pencarian pesan (bukan milik handle), NULL jika tidak dipakai (lihat WINEMATRIX_index_messages)
+    WINEMATRIX_media *media;  ///< Cache media lokal, NULL jika tidak dipakai (lihat WINEMATRIX_open_media_cache)
+    WINEMATRIX_sliding *sliding; ///< Status sliding sync, NULL untuk /sync biasa (lihat WINEMATRIX_use_sliding_sync)
+    WINEB2B_msgid_index *msgids; ///< Indeks ID pesan sumber <-> event_id (bukan milik handle), NULL jika tidak dipakai (lihat WINEMATRIX_map_message_ids)
 } WINEMATRIX_handle;
 
 /**
@@ -87,6 +103,62 @@ int WINEMATRIX_join_room(WINEMATRIX_handle* handle, const char* room_id);
 WINEMATRIXcode
 int WINEMATRIX_send_message(WINEMATRIX_handle* handle, const char* room_id, const char* message);
 
+/**
+ * @brief Mengirim pesan ke room Matrix dengan penanda origin bridge.
+ *
+ * Sama dengan WINEMATRIX_send_message, tetapi menambahkan field
+ * WINEB2B_ORIGIN_FIELD (echo_filter.h) ke content sehingga instance bridge
+ * lain dapat mengenali pesan ini sebagai hasil relay.
+ *
+ * @param handle Pointer ke handle yang valid.
+ * @param room_id ID room tujuan.
+ * @param message Pesan teks yang akan dikirim.
+ * @param origin ID instance bridge (NULL untuk tanpa penanda).
+ * @return int 0 jika berhasil, non-0 jika gagal.
+ */
+WINEMATRIXcode
+int WINEMATRIX_send_message_origin(WINEMATRIX_handle* handle, const char* room_id, const char* message,
+                                   const char* origin);
+
+/**
+ * @brief Mengimpor banyak pesan ke satu room dengan urutan dan waktu asli.
+ *
+ * Untuk pesan yang terkumpul sekaligus (misal catch-up CHATHISTORY IRC
+ * setelah reconnect). Semua request ditulis ke satu koneksi HTTP/1.1
+ * dengan pipelining: sampai config->window request dikirim tanpa menunggu
+ * respons, dan homeserver memprosesnya sesuai urutan kirim, sehingga satu
+ * round trip dibagi banyak pesan tanpa mengubah urutan timeline. Dengan
+ * config->as_token, pesan dikirim sebagai appservice yang menyamar menjadi
+ * user_id puppet dan membawa ts (origin_server_ts asli); join puppet bisa
+ * ikut di pipeline yang sama.
+ *
+ * txnId deterministik dari key pesan, jadi request yang diulang (429, 5xx,
+ * koneksi putus: koneksi dibuka ulang dan request yang belum dijawab
+ * dikirim lagi) maupun import ulang batch yang sama tidak menggandakan
+ * event.
+ *
+ * Urutan hanya dijamin tanpa 429/5xx atau dengan window 1. Saat request
+ * dijawab 429/5xx, request sesudahnya sudah terkirim dan bisa sudah
+ * diterima; jawaban mereka ditunggu (yang berhasil tidak dikirim ulang),
+ * lalu request yang gagal dikirim ulang sendirian sebelum pipeline diisi
+ * lagi sehingga tidak didahului lagi. Pesan yang tetap tampil sesudah
+ * pesan berikutnya dihitung di stats->reordered. Appservice biasanya tidak
+ * dibatasi rate.
+ *
+ * @param handle Pointer ke handle yang valid (homeserver, token jika tanpa as_token).
+ * @param room_id ID room tujuan.
+ * @param messages Pesan terurut.
+ * @param count Jumlah pesan.
+ * @param config Konfigurasi, atau NULL untuk default.
+ * @param stats Output statistik, boleh NULL.
+ * @return long Jumlah pesan yang diterima homeserver, -1 jika argumen tidak valid
+ *         atau homeserver tidak bisa dihubungi.
+ */
+WINEMATRIXcode
+long WINEMATRIX_import_messages(WINEMATRIX_handle* handle, const char* room_id,
+                                const WINEMATRIX_import_message* messages, size_t count,
+                                const WINEMATRIX_import_config* config, WINEMATRIX_import_stats* stats);
+
 /**
  * @brief Mengirim pesan reply dengan mengutip pesan asli.
  *
@@ -134,7 +206,9 @@ int WINEMATRIX_send_reaction(WINEMATRIX_handle* handle, const char* room_id, con
 /**
  * @brief Menyematkan (pin) pesan di room Matrix.
  *
- * Mengakses endpoint state untuk mengatur pinned events.
+ * Event ditambahkan ke daftar m.room.pinned_events yang sudah ada (tidak
+ * menimpanya). Daftar saat ini dibaca dari cache state jika room ada di
+ * cache, jika tidak diambil dulu dari homeserver.
  *
  * @param handle Pointer ke handle yang valid.
  * @param room_id ID room.
@@ -177,6 +251,237 @@ int WINEMATRIX_forward_message(WINEMATRIX_handle* handle,
                                const char* original_event_id,
                                const char* original_message);
 
+/**
+ * @brief Memakai indeks ID pesan untuk fungsi WINEMATRIX_relay_*.
+ *
+ * Event yang dikirim lewat WINEMATRIX_relay_message/WINEMATRIX_relay_reply
+ * dicatat dengan ID pesan sumbernya (msgid IRC atau ID sintetis dari
+ * WINEB2B_msgid_synthetic), sehingga reply, redaction dan reaction yang
+ * datang kemudian dari sisi sumber bisa diarahkan ke event yang benar.
+ * Indeks tidak dimiliki handle dan boleh dipakai bersama driver lain.
+ *
+ * @param handle Pointer ke handle yang valid.
+ * @param msgids Indeks, NULL untuk berhenti mencatat.
+ * @return int 0 jika berhasil, non-0 jika gagal.
+ */
+WINEMATRIXcode
+int WINEMATRIX_map_message_ids(WINEMATRIX_handle* handle, WINEB2B_msgid_index* msgids);
+
+/**
+ * @brief Me-relay pesan dari jaringan lain dan mencatat event_id-nya.
+ *
+ * Sama dengan WINEMATRIX_send_message_origin; jika handle->msgids dipakai,
+ * event_id hasilnya dipetakan ke source_id. Pesan yang di-relay ulang
+ * dengan source_id yang sama (misal edit) memetakan ulang ke event baru.
+ *
+ * @param handle Pointer ke handle yang valid.
+ * @param room_id ID room tujuan.
+ * @param message Pesan teks.
+ * @param origin ID instance bridge (NULL untuk tanpa penanda).
+ * @param source_id ID pesan di jaringan sumber, NULL jika tidak dicatat.
+ * @return int 0 jika berhasil, non-0 jika gagal.
+ */
+WINEMATRIXcode
+int WINEMATRIX_relay_message(WINEMATRIX_handle* handle, const char* room_id, const char* message,
+                             const char* origin, const char* source_id);
+
+/**
+ * @brief Me-relay reply ke pesan yang sebelumnya di-relay.
+ *
+ * Event yang dibalas dicari di handle->msgids dari target_source_id. Jika
+ * tidak ditemukan (indeks tidak dipakai atau pemetaan sudah tidak ada),
+ * reply dikirim sebagai pesan biasa agar isinya tidak hilang.
+ *
+ * @param handle Pointer ke handle yang valid.
+ * @param room_id ID room tujuan.
+ * @param target_source_id ID sumber pesan yang dibalas.
+ * @param original_message Isi pesan yang dibalas (untuk kutipan).
+ * @param reply_message Pesan balasan.
+ * @param origin ID instance bridge (NULL untuk tanpa penanda), juga untuk reply yang dikirim sebagai pesan biasa.
+ * @param source_id ID sumber balasan ini, NULL jika tidak dicatat.
+ * @return int 0 jika berhasil, non-0 jika gagal.
+ */
+WINEMATRIXcode
+int WINEMATRIX_relay_reply(WINEMATRIX_handle* handle, const char* room_id, const char* target_source_id,
+                           const char* original_message, const char* reply_message, const char* origin,
+                           const char* source_id);
+
+/**
+ * @brief Me-relay penghapusan pesan yang sebelumnya di-relay.
+ *
+ * @param handle Pointer ke handle yang valid.
+ * @param room_id ID room.
+ * @param source_id ID sumber pesan yang dihapus.
+ * @param reason Alasan penghapusan.
+ * @return int 0 jika berhasil, non-0 jika gagal atau event tidak ditemukan di handle->msgids.
+ */
+WINEMATRIXcode
+int WINEMATRIX_relay_redact(WINEMATRIX_handle* handle, const char* room_id, const char* source_id,
+                            const char* reason);
+
+/**
+ * @brief Me-relay reaction terhadap pesan yang sebelumnya di-relay.
+ *
+ * @param handle Pointer ke handle yang valid.
+ * @param room_id ID room.
+ * @param target_source_id ID sumber pesan yang direaksikan.
+ * @param reaction Emoji atau string reaction.
+ * @return int 0 jika berhasil, non-0 jika gagal atau event tidak ditemukan di handle->msgids.
+ */
+WINEMATRIXcode
+int WINEMATRIX_relay_reaction(WINEMATRIX_handle* handle, const char* room_id, const char* target_source_id,
+                              const char* reaction);
+
+/**
+ * @brief Melakukan satu kali long-poll /sync.
+ *
+ * Mengakses endpoint /_matrix/client/r0/sync dan mengembalikan body respons
+ * apa adanya (JSON) beserta token next_batch untuk panggilan berikutnya.
+ *
+ * @param handle Pointer ke handle yang valid.
+ * @param since Token next_batch dari sync sebelumnya, NULL untuk initial sync.
+ * @param timeout_ms Lama long-poll di server dalam milidetik.
+ * @param response Output body respons (dialokasikan, bebaskan dengan free()).
+ * @param next_batch Output token next_batch (dialokasikan, boleh NULL).
+ * @return int 0 jika berhasil, non-0 jika gagal.
+ */
+WINEMATRIXcode
+int WINEMATRIX_sync(WINEMATRIX_handle* handle, const char* since, int timeout_ms,
+                    char** response, char** next_batch);
+
+/**
+ * @brief Memakai sliding sync (MSC4186) untuk WINEMATRIX_sync berikutnya.
+ *
+ * WINEMATRIX_sync lalu mengirim POST ke
+ * /_matrix/client/unstable/org.matrix.simplified_msc3575/sync dengan
+ * jendela list saat ini. since diabaikan (posisi disimpan di
+ * handle->sliding), next_batch berisi pos, dan response berisi room dalam
+ * bentuk /sync biasa tanpa next_batch sehingga token since di event store
+ * tidak tertimpa. Selama jendela list yang tumbuh belum mencakup semua
+ * room, request tidak long-poll agar sisa room cepat terisi di sela relay.
+ * Room yang baru masuk jendela membawa timeline terakhirnya (limited,
+ * dengan prev_batch untuk backfill).
+ *
+ * @param handle Pointer ke handle yang valid.
+ * @param lists Konfigurasi list, NULL untuk default (lihat WINEMATRIX_sliding_create).
+ * @param nlists Jumlah list.
+ * @return int 0 jika berhasil, non-0 jika gagal.
+ */
+WINEMATRIXcode
+int WINEMATRIX_use_sliding_sync(WINEMATRIX_handle* handle, const WINEMATRIX_sliding_list* lists, size_t nlists);
+
+/**
+ * @brief Mulai menyimpan state room dari /sync di handle->state.
+ *
+ * Setiap respons WINEMATRIX_sync yang berhasil diterapkan ke cache, jadi
+ * state baru lengkap setelah initial sync (tanpa since).
+ *
+ * @param handle Pointer ke handle yang valid.
+ * @return int 0 jika berhasil, non-0 jika gagal.
+ */
+WINEMATRIXcode
+int WINEMATRIX_track_state(WINEMATRIX_handle* handle);
+
+/**
+ * @brief Membuka event store lokal di handle->store.
+ *
+ * Setiap respons WINEMATRIX_sync yang berhasil ditambahkan ke store. Token
+ * since terakhir tersedia lewat WINEMATRIX_store_since(handle->store) untuk
+ * melanjutkan sync setelah restart.
+ *
+ * @param handle Pointer ke handle yang valid.
+ * @param dir Direktori store.
+ * @return int 0 jika berhasil, non-0 jika gagal.
+ */
+WINEMATRIXcode
+int WINEMATRIX_open_store(WINEMATRIX_handle* handle, const char* dir);
+
+/**
+ * @brief Mengindeks pesan dari /sync ke indeks pencarian.
+ *
+ * Setiap m.room.message di timeline room yang di-join pada respons
+ * WINEMATRIX_sync ditambahkan dengan network "matrix:<host homeserver>",
+ * channel room_id dan waktu origin_server_ts. Edit (m.replace) diindeks
+ * dengan teks barunya. Indeks tidak dimiliki handle dan boleh dipakai
+ * bersama driver lain.
+ *
+ * @param handle Pointer ke handle yang valid.
+ * @param search Indeks tujuan, NULL untuk berhenti mengindeks.
+ * @return int 0 jika berhasil, non-0 jika gagal.
+ */
+WINEMATRIXcode
+int WINEMATRIX_index_messages(WINEMATRIX_handle* handle, WINEB2B_search* search);
+
+/**
+ * @brief Mengisi celah riwayat room di handle->store dari /rooms/{id}/messages.
+ *
+ * Celah dari timeline limited dan awal riwayat room diambil mundur halaman
+ * demi halaman sampai bertemu event yang sudah tersimpan atau awal room.
+ * Beberapa room diproses bersamaan oleh paling banyak config->parallelism
+ * worker (thread pemanggil termasuk); satu room hanya diambil satu worker.
+ * 429 ditunggu sesuai retry_after_ms, 5xx dan gagal transport dicoba ulang.
+ * Room yang belum pernah muncul di /sync dilewati.
+ *
+ * @param handle Pointer ke handle dengan store terbuka.
+ * @param room_ids Daftar room.
+ * @param nrooms Jumlah room.
+ * @param config Konfigurasi, atau NULL untuk default.
+ * @return long Jumlah event yang ditambahkan, -1 jika handle tidak punya store.
+ */
+WINEMATRIXcode
+long WINEMATRIX_backfill(WINEMATRIX_handle* handle, const char* const* room_ids, size_t nrooms,
+                         const WINEMATRIX_backfill_config* config);
+
+/**
+ * @brief Membuka cache media lokal di handle->media.
+ *
+ * @param handle Pointer ke handle yang valid.
+ * @param dir Direktori cache.
+ * @param max_bytes Batas ukuran cache, 0 untuk default 1 GB.
+ * @return int 0 jika berhasil, non-0 jika gagal.
+ */
+WINEMATRIXcode
+int WINEMATRIX_open_media_cache(WINEMATRIX_handle* handle, const char* dir, uint64_t max_bytes);
+
+/**
+ * @brief Mengupload isi file ke /_matrix/media/v3/upload secara streaming.
+ *
+ * Body dibaca dari fd oleh callback curl per blok, tidak pernah dimuat
+ * utuh ke memori. Seluruh isi file (dari offset 0) di-hash SHA-256 lebih
+ * dulu; jika handle->media sudah mengenal isi yang sama, URI mxc yang ada
+ * dikembalikan tanpa request. fd yang tidak bisa di-seek (pipe, socket)
+ * disalin dulu ke file sementara. Setelah berhasil, isi ikut disimpan di
+ * cache sehingga download URI tersebut tidak perlu request. 429, 5xx dan
+ * gagal transport dicoba ulang.
+ *
+ * @param handle Pointer ke handle yang valid.
+ * @param fd Sumber isi media.
+ * @param content_type MIME type, NULL untuk application/octet-stream.
+ * @param filename Nama file untuk homeserver, boleh NULL.
+ * @param content_uri Output URI mxc:// (dialokasikan, bebaskan dengan free()).
+ * @return int 0 jika berhasil, non-0 jika gagal.
+ */
+WINEMATRIXcode
+int WINEMATRIX_upload_media(WINEMATRIX_handle* handle, int fd, const char* content_type, const char* filename,
+                            char** content_uri);
+
+/**
+ * @brief Mengambil media mxc:// lewat cache lokal.
+ *
+ * Jika URI sudah ada di handle->media, file dibuka langsung dari disk.
+ * Jika belum, /_matrix/media/v3/download ditulis langsung ke file di
+ * direktori cache (tanpa buffer memori) sambil di-hash, lalu dimasukkan ke
+ * cache. Membutuhkan cache yang terbuka (WINEMATRIX_open_media_cache).
+ *
+ * @param handle Pointer ke handle yang valid.
+ * @param content_uri URI mxc://server/mediaId.
+ * @param fd Output file descriptor baca-saja di offset 0, tutup dengan close().
+ *           Tetap valid walaupun objeknya kemudian dibuang dari cache.
+ * @return int 0 jika berhasil, non-0 jika gagal.
+ */
+WINEMATRIXcode
+int WINEMATRIX_download_media(WINEMATRIX_handle* handle, const char* content_uri, int* fd);
+
 /**
  * @brief Membebaskan memori yang digunakan oleh handle.
  *
@@ -0,0 +1,120 @@
+#ifndef MATRIX_EPHEMERAL_H
+#define MATRIX_EPHEMERAL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "matrix_driver.h"
+
+/**
+ * @brief Pipeline event ephemeral (typing, read receipt, presence).
+ *
+ * Sinyal dari jaringan lain tidak langsung dikirim ke homeserver, melainkan
+ * disimpan sebagai state yang diinginkan lalu dikirim oleh
+ * WINEMATRIX_ephemeral_poll() saat jatuh tempo:
+ *  - typing start/stop di-debounce per (user, room) dan di-refresh sebelum timeout;
+ *  - read receipt per room digabung dan dikirim berkala lewat /read_markers;
+ *  - presence dibatasi laju, update yang belum terkirim ditimpa update baru.
+ */
+typedef struct _WINEMATRIX_ephemeral WINEMATRIX_ephemeral;
+
+/**
+ * @brief Konfigurasi pipeline ephemeral. Nilai 0 berarti pakai default.
+ */
+typedef struct {
+    unsigned typing_timeout_ms;    ///< Timeout typing di server (default 30000)
+    unsigned typing_debounce_ms;   ///< Jeda sebelum perubahan typing dikirim (default 750)
+    unsigned receipt_interval_ms;  ///< Periode pengiriman read marker (default 2000)
+    unsigned presence_interval_ms; ///< Jarak minimum antar update presence (default 15000)
+} WINEMATRIX_ephemeral_config;
+
+/**
+ * @brief Statistik pipeline ephemeral.
+ */
+typedef struct {
+    uint64_t requests;     ///< HTTP request yang benar-benar dikirim
+    uint64_t coalesced;    ///< Update yang digabung/dibuang tanpa request
+    uint64_t failed;       ///< Request yang gagal
+} WINEMATRIX_ephemeral_stats;
+
+/**
+ * @brief Membuat pipeline ephemeral untuk sebuah handle.
+ *
+ * @param handle Handle Matrix yang sudah login (harus tetap hidup selama pipeline dipakai).
+ * @param config Konfigurasi, atau NULL untuk default.
+ * @return WINEMATRIX_ephemeral* Pipeline baru, NULL jika gagal.
+ */
+WINEMATRIXcode
+WINEMATRIX_ephemeral* WINEMATRIX_ephemeral_create(WINEMATRIX_handle* handle,
+                                                  const WINEMATRIX_ephemeral_config* config);
+
+/**
+ * @brief Mencatat status typing user di room.
+ *
+ * @param eph Pipeline ephemeral.
+ * @param room_id ID room.
+ * @param user_id ID user (puppet appservice), NULL untuk user handle sendiri.
+ * @param typing 1 jika sedang mengetik, 0 jika berhenti.
+ * @return int 0 jika berhasil, -1 jika gagal.
+ */
+WINEMATRIXcode
+int WINEMATRIX_ephemeral_typing(WINEMATRIX_ephemeral* eph, const char* room_id,
+                                const char* user_id, int typing);
+
+/**
+ * @brief Mencatat bahwa event sudah dibaca (read receipt + fully read marker).
+ *
+ * Hanya event terakhir per room yang dikirim pada flush berikutnya.
+ */
+WINEMATRIXcode
+int WINEMATRIX_ephemeral_read(WINEMATRIX_ephemeral* eph, const char* room_id, const char* event_id);
+
+/**
+ * @brief Mencatat presence user handle ("online", "unavailable", "offline").
+ *
+ * @param status_msg Pesan status, boleh NULL.
+ */
+WINEMATRIXcode
+int WINEMATRIX_ephemeral_presence(WINEMATRIX_ephemeral* eph, const char* presence, const char* status_msg);
+
+/**
+ * @brief Mengirim semua update yang sudah jatuh tempo.
+ *
+ * Dipanggil berkala dari loop sync/event loop.
+ *
+ * @return int Jumlah request yang dikirim, -1 jika parameter tidak valid.
+ */
+WINEMATRIXcode
+int WINEMATRIX_ephemeral_poll(WINEMATRIX_ephemeral* eph);
+
+/**
+ * @brief Waktu (ms) sampai ada update yang jatuh tempo, -1 jika tidak ada antrian.
+ */
+WINEMATRIXcode
+long WINEMATRIX_ephemeral_next_due_ms(WINEMATRIX_ephemeral* eph);
+
+/**
+ * @brief Mengirim semua update yang tertunda tanpa menunggu jadwal.
+ */
+WINEMATRIXcode
+int WINEMATRIX_ephemeral_flush(WINEMATRIX_ephemeral* eph);
+
+/**
+ * @brief Mengambil statistik pipeline.
+ */
+WINEMATRIXcode
+void WINEMATRIX_ephemeral_get_stats(const WINEMATRIX_ephemeral* eph, WINEMATRIX_ephemeral_stats* out);
+
+/**
+ * @brief Membebaskan pipeline (update yang tertunda dibuang).
+ */
+WINEMATRIXcode
+void WINEMATRIX_ephemeral_free(WINEMATRIX_ephemeral* eph);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MATRIX_EPHEMERAL_H */
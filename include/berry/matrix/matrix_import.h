@@ -0,0 +1,57 @@
+#ifndef MATRIX_IMPORT_H
+#define MATRIX_IMPORT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Satu pesan untuk WINEMATRIX_import_messages.
+ *
+ * Pesan dikirim sebagai m.room.message. Dengan token appservice, user_id
+ * dan ts_ms diteruskan sebagai parameter query user_id dan ts sehingga
+ * event tampil dari puppet dengan waktu aslinya (misal tag server-time
+ * IRC). txnId diturunkan dari key, jadi import ulang batch yang sama tidak
+ * menggandakan event.
+ */
+typedef struct {
+    const char *user_id;    ///< Puppet pengirim (hanya dengan as_token), NULL = pemilik token
+    const char *body;       ///< Isi pesan
+    const char *msgtype;    ///< NULL = "m.text"
+    int64_t ts_ms;          ///< origin_server_ts yang diminta (hanya dengan as_token), 0 = waktu homeserver
+    const char *key;        ///< ID stabil dari sumber (misal msgid IRC), NULL = dari user_id, ts_ms dan body
+} WINEMATRIX_import_message;
+
+/**
+ * @brief Konfigurasi WINEMATRIX_import_messages.
+ */
+typedef struct {
+    const char *as_token;   ///< Token appservice, NULL = handle->access_token tanpa user_id/ts
+    const char *origin;     ///< ID instance bridge untuk WINEB2B_ORIGIN_FIELD, NULL = tanpa penanda
+    unsigned window;        ///< Request dalam pipeline yang menunggu respons (default 32)
+    unsigned max_retries;   ///< Percobaan ulang per request untuk 429, 5xx dan koneksi putus (default 5)
+    int join_puppets;       ///< 1 = join room sebagai puppet sebelum pesan pertamanya
+} WINEMATRIX_import_config;
+
+/**
+ * @brief Hasil WINEMATRIX_import_messages.
+ */
+typedef struct {
+    size_t sent;            ///< Pesan yang diterima homeserver (termasuk txnId yang sudah pernah dipakai)
+    size_t failed;          ///< Pesan yang ditolak atau gagal setelah max_retries
+    size_t joins;           ///< Join puppet yang berhasil
+    size_t requests;        ///< Request HTTP yang ditulis, termasuk pengulangan
+    size_t retries;
+    size_t reordered;       ///< Pesan yang diulang setelah 429/5xx dan tampil sesudah pesan berikutnya
+    size_t connections;     ///< Koneksi yang dibuka (1 tanpa gangguan)
+    double seconds;
+} WINEMATRIX_import_stats;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MATRIX_IMPORT_H */
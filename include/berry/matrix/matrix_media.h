@@ -0,0 +1,84 @@
+#ifndef MATRIX_MEDIA_H
+#define MATRIX_MEDIA_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef WINEMATRIXcode
+#define WINEMATRIXcode
+#endif
+
+/**
+ * @brief Cache media lokal yang dialamatkan menurut isi (SHA-256).
+ *
+ * Isi media disimpan sebagai file objects/<sha256 hex> di direktori cache,
+ * dan pemetaan sha256 <-> URI mxc:// dicatat di file "uris" (append-only,
+ * satu baris per pemetaan). Dengan ini:
+ *  - upload isi yang sama (dari file atau sumber lain) tidak dikirim lagi,
+ *    URI mxc yang sudah ada dipakai ulang;
+ *  - download URI yang sudah pernah diunduh atau diupload sendiri dibaca
+ *    dari disk tanpa request ke homeserver.
+ *
+ * Total ukuran objek dibatasi max_bytes; objek yang paling lama tidak
+ * dipakai dihapus lebih dulu (LRU, waktu pakai disimpan sebagai mtime file
+ * sehingga urutannya tetap setelah dibuka ulang). Pemetaan URI tetap
+ * tersimpan walaupun objeknya sudah dihapus, jadi upload ulang tetap
+ * dihindari. Request bersamaan untuk isi/URI yang sama digabung menjadi
+ * satu request HTTP.
+ *
+ * Upload dan download berjalan streaming lewat file descriptor (lihat
+ * WINEMATRIX_upload_media dan WINEMATRIX_download_media di matrix_driver.h),
+ * jadi pemakaian memori tidak bergantung pada ukuran media.
+ *
+ * Aman dipakai dari beberapa thread.
+ */
+typedef struct _WINEMATRIX_media WINEMATRIX_media;
+
+/**
+ * @brief Statistik cache media.
+ */
+typedef struct {
+    size_t objects;             ///< File media di cache
+    uint64_t bytes;             ///< Total ukuran objek
+    uint64_t max_bytes;
+    size_t uris;                ///< Pemetaan sha256 <-> mxc:// yang diketahui
+    uint64_t uploads;           ///< Upload yang benar-benar dikirim ke homeserver
+    uint64_t upload_hits;       ///< Upload yang dijawab dari cache (isi sudah pernah diupload)
+    uint64_t downloads;         ///< Download dari homeserver
+    uint64_t download_hits;     ///< Download yang dilayani dari disk
+    uint64_t evictions;
+    uint64_t bytes_uploaded;
+    uint64_t bytes_downloaded;
+} WINEMATRIX_media_stats;
+
+/**
+ * @brief Membuka (atau membuat) cache media di sebuah direktori.
+ *
+ * File sementara sisa crash dihapus dan objek di atas max_bytes langsung
+ * dibuang.
+ *
+ * @param dir Direktori cache, dibuat jika belum ada.
+ * @param max_bytes Batas total ukuran objek, 0 untuk default 1 GB.
+ * @return WINEMATRIX_media* Cache, NULL jika gagal.
+ */
+WINEMATRIXcode
+WINEMATRIX_media* WINEMATRIX_media_open(const char* dir, uint64_t max_bytes);
+
+WINEMATRIXcode
+void WINEMATRIX_media_get_stats(WINEMATRIX_media* media, WINEMATRIX_media_stats* out);
+
+/**
+ * @brief Menutup cache. File descriptor yang sudah diberikan tetap valid.
+ */
+WINEMATRIXcode
+void WINEMATRIX_media_close(WINEMATRIX_media* media);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MATRIX_MEDIA_H */
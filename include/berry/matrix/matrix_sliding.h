@@ -0,0 +1,118 @@
+#ifndef MATRIX_SLIDING_H
+#define MATRIX_SLIDING_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef WINEMATRIXcode
+#define WINEMATRIXcode
+#endif
+
+/**
+ * @brief Status koneksi sliding sync (MSC4186, simplified sliding sync).
+ *
+ * Berbeda dengan /sync biasa yang mengirim semua room sekaligus pada
+ * initial sync, server mengurutkan room menurut aktivitas terakhir dan
+ * hanya mengirim room di jendela (range) setiap list. Setiap list punya
+ * timeline_limit dan required_state sendiri, jadi room teratas bisa
+ * diminta lengkap sementara sisanya cukup ringkas.
+ *
+ * Jendela list yang tumbuh (grow > 0) diperbesar sedikit demi sedikit
+ * pada setiap request sampai mencakup semua room, sehingga room paling
+ * aktif sudah bisa dilayani sejak respons pertama dan sisanya menyusul.
+ *
+ * Modul ini tidak melakukan HTTP: WINEMATRIX_sliding_request membangun
+ * body request dan WINEMATRIX_sliding_apply menerapkan respons lalu
+ * mengubahnya ke bentuk respons /sync biasa (rooms.join.{id}.timeline dan
+ * state), jadi cache state, event store dan indeks pencarian memakai jalur
+ * yang sama. Lihat WINEMATRIX_use_sliding_sync di matrix_driver.h.
+ */
+typedef struct _WINEMATRIX_sliding WINEMATRIX_sliding;
+
+/**
+ * @brief Konfigurasi satu list room.
+ */
+typedef struct {
+    const char *name;                   ///< Nama list (unik)
+    int window;                         ///< Jumlah room teratas pada request pertama, 0 = 20
+    int grow;                           ///< Penambahan jendela per request sampai semua room tercakup, 0 = jendela tetap
+    int timeline_limit;                 ///< Event timeline terakhir per room, 0 = 10
+    const char *const *required_state;  ///< Pasangan type, state_key diakhiri NULL; NULL = nama, topic, create, power level, pinned events dan member lazy
+} WINEMATRIX_sliding_list;
+
+/**
+ * @brief Statistik sliding sync.
+ */
+typedef struct {
+    uint64_t responses;         ///< Respons yang diterapkan
+    uint64_t resets;            ///< Koneksi dimulai ulang (pos tidak dikenal server)
+    size_t rooms;               ///< Room berbeda yang sudah diterima
+    size_t total;               ///< Jumlah room terbesar menurut count list
+    int complete;               ///< Semua jendela yang tumbuh sudah mencakup seluruh room
+} WINEMATRIX_sliding_stats;
+
+/**
+ * @brief Membuat status sliding sync.
+ *
+ * @param lists Konfigurasi list (disalin), NULL untuk default: "active"
+ *              (20 room teratas, timeline 10) dan "all" (mulai 100 room,
+ *              tumbuh 500 per request, timeline 1).
+ * @param nlists Jumlah list.
+ * @return WINEMATRIX_sliding* Status baru, NULL jika gagal.
+ */
+WINEMATRIXcode
+WINEMATRIX_sliding* WINEMATRIX_sliding_create(const WINEMATRIX_sliding_list* lists, size_t nlists);
+
+/**
+ * @brief Membangun body JSON request berikutnya dengan jendela saat ini.
+ *
+ * @return char* Body (bebaskan dengan free()), NULL jika gagal.
+ */
+WINEMATRIXcode
+char* WINEMATRIX_sliding_request(const WINEMATRIX_sliding* sliding);
+
+/**
+ * @brief Token pos untuk query request berikutnya, NULL sebelum respons pertama.
+ */
+WINEMATRIXcode
+const char* WINEMATRIX_sliding_pos(const WINEMATRIX_sliding* sliding);
+
+/**
+ * @brief Menerapkan respons sliding sync.
+ *
+ * pos dan count list disimpan, jendela list yang tumbuh diperbesar untuk
+ * request berikutnya. Room di respons diubah ke bentuk /sync biasa tanpa
+ * next_batch: required_state menjadi state.events, timeline menjadi
+ * timeline.events beserta limited dan prev_batch (token /messages).
+ *
+ * @param sliding Status sliding sync.
+ * @param response Body respons JSON.
+ * @param sync_json Output JSON bentuk /sync (dialokasikan, bebaskan dengan free()), boleh NULL.
+ * @return int Jumlah room di respons, -1 jika respons tidak valid.
+ */
+WINEMATRIXcode
+int WINEMATRIX_sliding_apply(WINEMATRIX_sliding* sliding, const char* response, char** sync_json);
+
+/**
+ * @brief Memulai koneksi dari awal (server menjawab M_UNKNOWN_POS).
+ *
+ * pos dibuang dan jendela kembali ke ukuran awal.
+ */
+WINEMATRIXcode
+void WINEMATRIX_sliding_reset(WINEMATRIX_sliding* sliding);
+
+WINEMATRIXcode
+void WINEMATRIX_sliding_get_stats(const WINEMATRIX_sliding* sliding, WINEMATRIX_sliding_stats* out);
+
+WINEMATRIXcode
+void WINEMATRIX_sliding_free(WINEMATRIX_sliding* sliding);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MATRIX_SLIDING_H */
@@ -0,0 +1,179 @@
+#ifndef MATRIX_STATE_H
+#define MATRIX_STATE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+
+struct json_object;
+
+#ifndef WINEMATRIXcode
+#define WINEMATRIXcode
+#endif
+
+/**
+ * @brief Cache state room Matrix yang diisi dari stream /sync.
+ *
+ * Event state dari bagian state dan timeline setiap room di
+ * rooms.join diterapkan berurutan; room di rooms.leave dilupakan. User ID,
+ * room ID, tipe event, state_key dan display name di-intern ke satu tabel
+ * string bersama, sehingga setiap room hanya menyimpan array datar terurut:
+ *  - anggota: (user, display name, membership) 12 byte per anggota;
+ *  - power level: (user, level) dari m.room.power_levels;
+ *  - state lain (misal m.room.pinned_events): (tipe, state_key, content JSON).
+ *
+ * Query anggota dan state dijawab lokal dengan binary search tanpa request
+ * ke homeserver. Perubahan anggota dalam satu respons /sync digabung ke
+ * array sekaligus. Aman dipakai dari beberapa thread (rwlock): satu thread
+ * sync menulis, thread lain membaca.
+ */
+typedef struct _WINEMATRIX_state WINEMATRIX_state;
+
+/**
+ * @brief Status keanggotaan user di room. Anggota yang leave tidak disimpan.
+ */
+typedef enum {
+    WINEMATRIX_MEMBERSHIP_NONE = 0,
+    WINEMATRIX_MEMBERSHIP_JOIN,
+    WINEMATRIX_MEMBERSHIP_INVITE,
+    WINEMATRIX_MEMBERSHIP_KNOCK,
+    WINEMATRIX_MEMBERSHIP_BAN
+} WINEMATRIX_membership;
+
+/**
+ * @brief Statistik cache state.
+ */
+typedef struct {
+    size_t rooms;
+    size_t members;         ///< Total keanggotaan yang disimpan (join/invite/knock/ban)
+    size_t state_events;    ///< Event state selain m.room.member
+    size_t strings;         ///< String unik di tabel intern
+    size_t bytes;           ///< Perkiraan memori cache
+    unsigned long events;   ///< Event state yang pernah diterapkan
+} WINEMATRIX_state_stats;
+
+/**
+ * @brief Membuat cache state kosong.
+ *
+ * @return WINEMATRIX_state* Cache baru, NULL jika gagal.
+ */
+WINEMATRIXcode
+WINEMATRIX_state* WINEMATRIX_state_create(void);
+
+/**
+ * @brief Menerapkan satu body respons /sync.
+ *
+ * @param st Cache state.
+ * @param sync_json Body respons /sync apa adanya.
+ * @return int Jumlah event state yang diterapkan, -1 jika JSON tidak valid.
+ */
+WINEMATRIXcode
+int WINEMATRIX_state_apply_sync(WINEMATRIX_state* st, const char* sync_json);
+
+/**
+ * @brief Sama dengan WINEMATRIX_state_apply_sync() untuk body yang sudah
+ *        diparse, agar satu respons /sync tidak diparse ulang per konsumen.
+ *
+ * @param st Cache state.
+ * @param root Objek json-c body /sync; tetap milik pemanggil.
+ * @return int Jumlah event state yang diterapkan, -1 jika argumen tidak valid.
+ */
+WINEMATRIXcode
+int WINEMATRIX_state_apply_sync_object(WINEMATRIX_state* st, struct json_object* root);
+
+/**
+ * @brief Menerapkan satu event state (misal setelah PUT state berhasil).
+ *
+ * @param room_id ID room.
+ * @param type Tipe event, misal "m.room.pinned_events".
+ * @param state_key State key ("" untuk sebagian besar state room).
+ * @param content_json Content event sebagai JSON, NULL untuk menghapus entri.
+ * @return int 0 jika berhasil, -1 jika gagal.
+ */
+WINEMATRIXcode
+int WINEMATRIX_state_apply_event(WINEMATRIX_state* st, const char* room_id, const char* type,
+                                 const char* state_key, const char* content_json);
+
+/**
+ * @brief Melupakan semua state room (misal setelah leave).
+ */
+WINEMATRIXcode
+void WINEMATRIX_state_forget_room(WINEMATRIX_state* st, const char* room_id);
+
+/**
+ * @brief 1 jika state room sudah pernah diterima dari /sync.
+ */
+WINEMATRIXcode
+int WINEMATRIX_state_has_room(const WINEMATRIX_state* st, const char* room_id);
+
+/**
+ * @brief Status keanggotaan user di room.
+ */
+WINEMATRIXcode
+WINEMATRIX_membership WINEMATRIX_state_membership(const WINEMATRIX_state* st, const char* room_id,
+                                                  const char* user_id);
+
+/**
+ * @brief Display name user di room.
+ *
+ * @return const char* Display name (valid sampai cache dibebaskan), NULL jika
+ *         user bukan anggota atau tidak memakai display name.
+ */
+WINEMATRIXcode
+const char* WINEMATRIX_state_displayname(const WINEMATRIX_state* st, const char* room_id, const char* user_id);
+
+/**
+ * @brief Power level user di room (users_default jika tidak tercantum, 0 jika
+ *        room belum punya m.room.power_levels).
+ */
+WINEMATRIXcode
+long WINEMATRIX_state_power_level(const WINEMATRIX_state* st, const char* room_id, const char* user_id);
+
+/**
+ * @brief Content JSON event state.
+ *
+ * m.room.member tidak disimpan sebagai JSON; gunakan
+ * WINEMATRIX_state_membership dan WINEMATRIX_state_displayname.
+ *
+ * @return char* Salinan content (bebaskan dengan free()), NULL jika tidak ada.
+ */
+WINEMATRIXcode
+char* WINEMATRIX_state_get(const WINEMATRIX_state* st, const char* room_id, const char* type,
+                           const char* state_key);
+
+/**
+ * @brief Jumlah anggota room dengan membership join.
+ */
+WINEMATRIXcode
+size_t WINEMATRIX_state_joined_count(const WINEMATRIX_state* st, const char* room_id);
+
+/**
+ * @brief Memanggil cb untuk setiap anggota room, terurut menurut ID intern.
+ *
+ * Cache terkunci untuk dibaca selama iterasi; cb tidak boleh menerapkan
+ * event ke cache yang sama.
+ *
+ * @return size_t Jumlah anggota yang disimpan.
+ */
+WINEMATRIXcode
+size_t WINEMATRIX_state_foreach_member(const WINEMATRIX_state* st, const char* room_id,
+                                       void (*cb)(const char* user_id, const char* displayname,
+                                                  WINEMATRIX_membership membership, void* user_data),
+                                       void* user_data);
+
+WINEMATRIXcode
+void WINEMATRIX_state_get_stats(const WINEMATRIX_state* st, WINEMATRIX_state_stats* out);
+
+/**
+ * @brief Membebaskan cache state.
+ */
+WINEMATRIXcode
+void WINEMATRIX_state_free(WINEMATRIX_state* st);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MATRIX_STATE_H */
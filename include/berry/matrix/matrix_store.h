@@ -0,0 +1,173 @@
+#ifndef MATRIX_STORE_H
+#define MATRIX_STORE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+struct json_object;
+
+#ifndef WINEMATRIXcode
+#define WINEMATRIXcode
+#endif
+
+/**
+ * @brief Event store lokal append-only untuk riwayat room Matrix.
+ *
+ * Event disimpan sebagai record di log bersegmen (file NNNNNNNN.seg di satu
+ * direktori) yang di-mmap, sehingga JSON event dibaca langsung dari page
+ * cache tanpa request ke homeserver. Di memori dibangun ulang saat dibuka:
+ *  - indeks per room terurut menurut urutan stream (room_id, order);
+ *  - indeks hash event_id -> record;
+ *  - indeks relasi (reply, edit, reaction, redaction) per event target.
+ *
+ * Event dari /sync ditambahkan dengan order naik. Timeline yang limited
+ * meninggalkan celah (gap) beserta token prev_batch-nya; celah ini dan awal
+ * riwayat room diisi oleh WINEMATRIX_backfill() dari /messages dengan order
+ * turun (seperti stream ordering negatif untuk event backfill di Synapse).
+ * Celah dan token since juga dicatat sebagai record, jadi backfill dapat
+ * dilanjutkan setelah restart. Record yang terpotong di ujung log (crash)
+ * dibuang saat dibuka.
+ *
+ * Aman dipakai dari beberapa thread (rwlock): sync dan backfill menulis,
+ * thread lain membaca.
+ */
+typedef struct _WINEMATRIX_store WINEMATRIX_store;
+
+/**
+ * @brief Konfigurasi backfill. Nilai 0 berarti pakai default.
+ */
+typedef struct {
+    unsigned parallelism;   ///< Maksimum request /messages bersamaan (default 4)
+    unsigned page_limit;    ///< Event per halaman /messages (default 100)
+    unsigned max_pages;     ///< Maksimum halaman per room per panggilan (default tanpa batas)
+    unsigned max_retries;   ///< Percobaan ulang per halaman saat 429/5xx/gagal transport (default 5)
+} WINEMATRIX_backfill_config;
+
+/**
+ * @brief Statistik event store.
+ */
+typedef struct {
+    size_t segments;
+    size_t bytes;           ///< Byte record di semua segmen
+    size_t rooms;
+    size_t events;
+    size_t relations;
+    size_t gaps;            ///< Celah yang belum terisi (termasuk awal riwayat yang belum diketahui)
+    size_t index_bytes;     ///< Perkiraan memori indeks
+} WINEMATRIX_store_stats;
+
+/**
+ * @brief Membuka (atau membuat) event store di sebuah direktori.
+ *
+ * @param dir Direktori segmen, dibuat jika belum ada.
+ * @param segment_bytes Ukuran maksimum satu segmen, 0 untuk default 64 MB.
+ * @return WINEMATRIX_store* Store, NULL jika gagal.
+ */
+WINEMATRIXcode
+WINEMATRIX_store* WINEMATRIX_store_open(const char* dir, size_t segment_bytes);
+
+/**
+ * @brief Menambahkan event timeline dari satu body respons /sync.
+ *
+ * Event yang event_id-nya sudah ada dilewati. Timeline limited mencatat
+ * celah dari prev_batch; next_batch disimpan sebagai token since.
+ *
+ * @return int Jumlah event baru, -1 jika JSON tidak valid atau penulisan gagal.
+ */
+WINEMATRIXcode
+int WINEMATRIX_store_apply_sync(WINEMATRIX_store* store, const char* sync_json);
+
+/**
+ * @brief Sama dengan WINEMATRIX_store_apply_sync() untuk body yang sudah
+ *        diparse (objek tetap milik pemanggil).
+ *
+ * @return int Jumlah event baru, -1 jika argumen tidak valid atau penulisan gagal.
+ */
+WINEMATRIXcode
+int WINEMATRIX_store_apply_sync_object(WINEMATRIX_store* store, struct json_object* root);
+
+/**
+ * @brief Token next_batch terakhir dari /sync yang diterapkan.
+ *
+ * @return const char* Token (valid sampai store ditutup), NULL jika belum ada.
+ */
+WINEMATRIXcode
+const char* WINEMATRIX_store_since(const WINEMATRIX_store* store);
+
+/**
+ * @brief JSON event menurut event_id.
+ *
+ * @return const char* JSON di mmap (valid sampai store ditutup), NULL jika tidak ada.
+ */
+WINEMATRIXcode
+const char* WINEMATRIX_store_get(const WINEMATRIX_store* store, const char* event_id);
+
+/**
+ * @brief Scrollback: event room dari yang terbaru ke yang terlama.
+ *
+ * Iterasi berhenti setelah limit event atau di celah yang belum di-backfill,
+ * sehingga event yang diberikan selalu bersambung.
+ *
+ * @param before_event_id Mulai dari event sebelum event ini, NULL dari yang terbaru.
+ * @param limit Jumlah maksimum event.
+ * @param cb Dipanggil dengan JSON event (valid sampai store ditutup).
+ * @return size_t Jumlah event yang diberikan ke cb.
+ */
+WINEMATRIXcode
+size_t WINEMATRIX_store_messages(const WINEMATRIX_store* store, const char* room_id, const char* before_event_id,
+                                 size_t limit, void (*cb)(const char* event_json, void* user_data),
+                                 void* user_data);
+
+/**
+ * @brief Event yang berelasi dengan sebuah event, yang terbaru dulu.
+ *
+ * Edit terbaru (rel_type "m.replace") adalah event pertama yang diberikan.
+ * rel_type adalah m.relates_to.rel_type ("m.replace" untuk edit,
+ * "m.annotation" untuk reaction, "m.thread"), "m.in_reply_to" untuk reply,
+ * atau "m.room.redaction" untuk redaction.
+ *
+ * @param rel_type Filter tipe relasi, NULL untuk semua.
+ * @return size_t Jumlah event yang diberikan ke cb.
+ */
+WINEMATRIXcode
+size_t WINEMATRIX_store_relations(const WINEMATRIX_store* store, const char* event_id, const char* rel_type,
+                                  void (*cb)(const char* event_json, void* user_data), void* user_data);
+
+/**
+ * @brief Jumlah event room yang tersimpan.
+ */
+WINEMATRIXcode
+size_t WINEMATRIX_store_room_events(const WINEMATRIX_store* store, const char* room_id);
+
+/**
+ * @brief Jumlah celah room yang belum terisi (0 jika riwayat lengkap sampai awal room).
+ */
+WINEMATRIXcode
+size_t WINEMATRIX_store_room_gaps(const WINEMATRIX_store* store, const char* room_id);
+
+WINEMATRIXcode
+void WINEMATRIX_store_get_stats(const WINEMATRIX_store* store, WINEMATRIX_store_stats* out);
+
+/**
+ * @brief Menulis perubahan ke disk (msync).
+ *
+ * @return int 0 jika berhasil, -1 jika gagal.
+ */
+WINEMATRIXcode
+int WINEMATRIX_store_flush(WINEMATRIX_store* store);
+
+/**
+ * @brief Menulis perubahan dan menutup store.
+ */
+WINEMATRIXcode
+void WINEMATRIX_store_close(WINEMATRIX_store* store);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MATRIX_STORE_H */
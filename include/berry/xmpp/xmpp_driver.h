@@ -0,0 +1,148 @@
+#ifndef XMPP_DRIVER_H
+#define XMPP_DRIVER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <sys/types.h>
+#include "xmpp_stream.h"
+#include "xmpp_stanza.h"
+#include "xmpp_sm.h"
+#include "metrics.h"
+
+/* Tipe return untuk fungsi XMPP */
+#define WINEXMPPcode int
+
+struct _WINEXMPP_handle;
+
+/* Callback untuk setiap <message/> yang diterima. from/type/body sudah
+   diambil dari stanza (body NULL jika tidak ada); stanza hanya valid
+   selama callback berjalan. */
+typedef void (*WINEXMPP_message_cb)(struct _WINEXMPP_handle* handle, const char* from,
+                                    const char* type, const char* body,
+                                    const WINEXMPP_stanza* stanza, void* user_data);
+
+/* Satu MUC yang di-join beserta status self-ping (XEP-0410) */
+typedef struct {
+    char *room;             /* JID room, misal room@conference.example.org */
+    char *nick;             /* Nickname di room */
+    long last_seen_ms;      /* Terakhir menerima stanza dari room (CLOCK_MONOTONIC) */
+    long ping_sent_ms;      /* Waktu self-ping yang masih menunggu jawaban, 0 jika tidak ada */
+} WINEXMPP_muc;
+
+/* Statistik sesi */
+typedef struct {
+    unsigned long resumes;          /* Reconnect yang berhasil di-resume (XEP-0198) */
+    unsigned long resume_failures;  /* Resume ditolak server, jatuh ke login penuh */
+    unsigned long retransmitted;    /* Stanza unacked yang dikirim ulang */
+    unsigned long acked;            /* Stanza keluar yang sudah di-ack server */
+    unsigned long self_pings;       /* Self-ping MUC yang dikirim */
+    unsigned long rejoins;          /* Presence join MUC yang dikirim ulang */
+} WINEXMPP_stats;
+
+/* Struktur handle untuk koneksi XMPP */
+typedef struct _WINEXMPP_handle {
+    int socket_fd;          /* Socket descriptor */
+    char *server;           /* Nama/Alamat server XMPP */
+    int port;               /* Port server (biasanya 5222) */
+    char *jid;              /* JID bare akun, misal bot@example.org */
+    char *username;         /* Bagian lokal JID (authcid SASL) */
+    char *domain;           /* Domain JID (atribut to pada stream) */
+    char *password;         /* Password akun */
+    char *resource;         /* Resource yang diminta saat bind */
+    char *bound_jid;        /* Full JID hasil bind dari server */
+    char *room;             /* MUC default untuk WINEXMPP_send_message (terakhir di-join) */
+    char *nick;             /* Nickname di MUC default */
+    int is_connected;       /* Status koneksi (stream siap dipakai) */
+    int state;              /* State negosiasi internal */
+    unsigned long next_id;  /* Counter atribut id stanza keluar */
+    WINEXMPP_parser *parser;
+    WINEXMPP_message_cb on_message;
+    void *user_data;
+    long last_send_ms;      /* Untuk whitespace ping saat idle */
+
+    /* Stream Management (XEP-0198) */
+    WINEXMPP_sm *sm;        /* Counter dan antrean unacked */
+    WINEXMPP_sm *sm_stash;  /* Unacked dari sesi lama saat resume gagal, dikirim ulang setelah bind */
+    char *sm_id;            /* ID sesi dari <enabled resume='true'/>, NULL jika tidak bisa di-resume */
+    int sm_enabled;         /* <enable/> terkirim: stanza keluar dihitung */
+    int sm_active;          /* <enabled/> diterima: stanza masuk dihitung */
+    int sm_since_request;   /* Stanza keluar sejak <r/> terakhir */
+    long sm_request_ms;     /* Waktu <r/> terakhir */
+    int features;           /* Fitur stream setelah autentikasi (internal) */
+    int resumed;            /* Koneksi terakhir melanjutkan sesi lama */
+
+    WINEXMPP_muc *mucs;     /* Semua MUC yang di-join */
+    int muc_count;
+    WINEXMPP_stats stats;
+    WINEB2B_metrics *metrics;   /* Metrik handle (protokol "xmpp") */
+} WINEXMPP_handle;
+
+/* Inisialisasi global (jika diperlukan) */
+WINEXMPPcode WINEXMPP_global_init(void);
+
+/* Cleanup global resources (jika diperlukan) */
+WINEXMPPcode WINEXMPP_global_cleanup(void);
+
+/* Membuat koneksi, membuka stream, login SASL PLAIN, bind resource dan
+   mengirim presence awal. Mengembalikan NULL jika salah satu langkah gagal */
+WINEXMPP_handle* WINEXMPP_create(const char* server, int port,
+                                 const char* jid,
+                                 const char* password,
+                                 const char* resource);
+
+/* Mengatur callback pesan masuk */
+void WINEXMPP_set_message_callback(WINEXMPP_handle* handle, WINEXMPP_message_cb cb, void* user_data);
+
+/* Join MUC (XEP-0045) dengan nickname tertentu, tanpa meminta history */
+WINEXMPPcode WINEXMPP_join_muc(WINEXMPP_handle* handle, const char* room, const char* nick);
+
+/* Mengirim pesan groupchat ke MUC yang sudah di-join */
+WINEXMPPcode WINEXMPP_send_message(WINEXMPP_handle* handle, const char* message);
+
+/* Mengirim pesan ke JID tertentu; type misalnya "chat" atau "groupchat" */
+WINEXMPPcode WINEXMPP_send_message_to(WINEXMPP_handle* handle, const char* to,
+                                      const char* type, const char* message);
+
+/* Mengirim satu stanza XML mentah (sudah di-escape). Jika stream management
+   aktif, stanza dicatat di antrean unacked sebelum dikirim sehingga tetap
+   dikirim ulang setelah resume walaupun send() gagal */
+WINEXMPPcode WINEXMPP_send_raw(WINEXMPP_handle* handle, const char* xml);
+
+/* Meminta ack dari server (<r/>) untuk stanza yang belum di-ack */
+WINEXMPPcode WINEXMPP_request_ack(WINEXMPP_handle* handle);
+
+/* Self-ping MUC (XEP-0410) untuk room tertentu, atau semua room jika NULL.
+   Jawaban diproses di WINEXMPP_poll; room yang ternyata sudah tidak
+   di-join akan di-join ulang tanpa menyentuh room lain */
+WINEXMPPcode WINEXMPP_muc_self_ping(WINEXMPP_handle* handle, const char* room);
+
+/* Menyambung ulang setelah koneksi putus. Jika sesi bisa di-resume
+   (XEP-0198), hanya stanza unacked yang dikirim ulang; jika tidak,
+   login penuh lalu join semua MUC kembali */
+WINEXMPPcode WINEXMPP_reconnect(WINEXMPP_handle* handle);
+
+/* Mengambil statistik sesi */
+void WINEXMPP_get_stats(const WINEXMPP_handle* handle, WINEXMPP_stats* out);
+
+/* Menunggu data hingga timeout_ms dan memproses stanza yang masuk
+   (callback pesan, balasan ping). Mengembalikan jumlah byte yang dibaca,
+   0 jika timeout, -1 jika koneksi terputus atau stream error */
+int WINEXMPP_poll(WINEXMPP_handle* handle, int timeout_ms);
+
+/* Loop keep-alive: memproses stanza, mengirim whitespace ping saat idle,
+   meminta ack, self-ping MUC yang sepi, dan WINEXMPP_reconnect jika koneksi hilang */
+WINEXMPPcode WINEXMPP_keep_alive(WINEXMPP_handle* handle);
+
+/* Menutup stream dan koneksi */
+WINEXMPPcode WINEXMPP_disconnect(WINEXMPP_handle* handle);
+
+/* Membebaskan memori dan resource pada handle XMPP */
+void WINEXMPP_free(WINEXMPP_handle* handle);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // XMPP_DRIVER_H
@@ -0,0 +1,27 @@
+#ifndef XMPP_SASL_H
+#define XMPP_SASL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+
+/* Base64 standar (RFC 4648) dengan padding. Mengembalikan panjang hasil
+   (tanpa NUL), atau -1 jika buffer tidak cukup */
+int WINEXMPP_base64_encode(const unsigned char* in, size_t len, char* out, size_t out_len);
+
+/* Decode base64; whitespace diabaikan. Mengembalikan jumlah byte,
+   atau -1 jika input tidak valid atau buffer tidak cukup */
+int WINEXMPP_base64_decode(const char* in, unsigned char* out, size_t out_len);
+
+/* Initial response SASL PLAIN (RFC 4616) dalam base64:
+   authzid NUL authcid NUL password. authzid boleh NULL. */
+int WINEXMPP_sasl_plain(const char* authzid, const char* authcid, const char* password,
+                        char* out, size_t out_len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // XMPP_SASL_H
@@ -0,0 +1,60 @@
+#ifndef XMPP_SM_H
+#define XMPP_SM_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define WINEXMPP_NS_SM "urn:xmpp:sm:3"
+
+/* State Stream Management (XEP-0198) untuk satu sesi: counter stanza
+   masuk yang sudah ditangani, dan antrean stanza keluar yang belum di-ack.
+   Antrean berupa satu buffer byte kontigu (record panjang + XML) sehingga
+   enqueue/ack tidak melakukan alokasi per stanza setelah buffer cukup besar. */
+typedef struct _WINEXMPP_sm WINEXMPP_sm;
+
+/* Membuat state SM; max_bytes membatasi ukuran antrean unacked (0 = 1 MB) */
+WINEXMPP_sm* WINEXMPP_sm_create(size_t max_bytes);
+
+/* Memulai sesi baru: counter ke 0 dan antrean dikosongkan */
+void WINEXMPP_sm_reset(WINEXMPP_sm* sm);
+
+/* Mencatat stanza keluar. 0 jika tercatat, -1 jika antrean penuh: stanza
+   tetap dihitung (server juga menghitungnya) tapi tidak disimpan, antrean
+   dikosongkan dan sesi tidak bisa di-resume dengan aman lagi sampai
+   WINEXMPP_sm_reset() */
+int WINEXMPP_sm_outbound(WINEXMPP_sm* sm, const char* xml, size_t len);
+
+/* Ack dari server: semua stanza dengan urutan <= h dibuang dari antrean.
+   Mengembalikan jumlah stanza yang di-ack, -1 jika h tidak masuk akal */
+int WINEXMPP_sm_ack(WINEXMPP_sm* sm, uint32_t h);
+
+/* Mencatat satu stanza masuk yang sudah ditangani */
+void WINEXMPP_sm_inbound(WINEXMPP_sm* sm);
+
+/* Nilai h untuk <a/> dan <resume/>: jumlah stanza masuk yang ditangani (mod 2^32) */
+uint32_t WINEXMPP_sm_handled(const WINEXMPP_sm* sm);
+
+/* 1 jika semua stanza unacked masih tersimpan (antrean belum pernah penuh) */
+int WINEXMPP_sm_resumable(const WINEXMPP_sm* sm);
+
+/* Jumlah stanza keluar yang belum di-ack */
+size_t WINEXMPP_sm_unacked(const WINEXMPP_sm* sm);
+
+/* Memanggil cb untuk setiap stanza unacked secara berurutan (untuk
+   retransmisi setelah <resumed/>). cb mengembalikan non-0 untuk berhenti.
+   Mengembalikan jumlah stanza yang dikunjungi. */
+typedef int (*WINEXMPP_sm_cb)(const char* xml, size_t len, void* user);
+size_t WINEXMPP_sm_foreach_unacked(const WINEXMPP_sm* sm, WINEXMPP_sm_cb cb, void* user);
+
+/* Membebaskan state SM */
+void WINEXMPP_sm_free(WINEXMPP_sm* sm);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // XMPP_SM_H
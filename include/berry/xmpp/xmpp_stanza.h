@@ -0,0 +1,54 @@
+#ifndef XMPP_STANZA_H
+#define XMPP_STANZA_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+
+/* Satu atribut elemen. name di-intern oleh parser (atau disalin ke arena
+   jika tabel intern penuh), value disalin ke arena stanza (entity sudah
+   di-decode). */
+typedef struct {
+    const char *name;       /* Nama lengkap seperti tertulis, misal "type" atau "xml:lang" */
+    const char *value;
+} WINEXMPP_attr;
+
+/* Satu elemen XML di dalam stanza. Semua memori milik parser dan hanya
+   valid selama callback stanza berjalan (arena dipakai ulang sesudahnya). */
+typedef struct _WINEXMPP_stanza {
+    const char *name;       /* Nama lokal (tanpa prefix), di-intern bila muat */
+    const char *ns;         /* URI namespace hasil resolusi, di-intern bila muat ("" jika tidak ada) */
+    WINEXMPP_attr *attrs;
+    int attr_count;
+    const char *text;       /* Isi teks langsung elemen ini (gabungan), "" jika kosong */
+    size_t text_len;
+    struct _WINEXMPP_stanza *parent;
+    struct _WINEXMPP_stanza *children;   /* Anak pertama */
+    struct _WINEXMPP_stanza *next;       /* Saudara berikutnya */
+    struct _WINEXMPP_stanza *last_child; /* Untuk append O(1) saat parsing */
+} WINEXMPP_stanza;
+
+/* Nilai atribut, NULL jika tidak ada */
+const char* WINEXMPP_stanza_attr(const WINEXMPP_stanza* s, const char* name);
+
+/* Anak pertama dengan nama (dan namespace, NULL = bebas), NULL jika tidak ada */
+WINEXMPP_stanza* WINEXMPP_stanza_child(const WINEXMPP_stanza* s, const char* name, const char* ns);
+
+/* Teks anak dengan nama tertentu, misal body dari <message/>; NULL jika tidak ada */
+const char* WINEXMPP_stanza_child_text(const WINEXMPP_stanza* s, const char* name);
+
+/* Serialisasi stanza ke XML. Mengembalikan panjang hasil, atau -1 jika
+   buffer tidak cukup. Namespace ditulis sebagai xmlns jika berbeda dari parent. */
+int WINEXMPP_stanza_serialize(const WINEXMPP_stanza* s, char* out, size_t out_len);
+
+/* Meng-escape teks untuk isi elemen/atribut XML (&, <, >, ", ').
+   Mengembalikan panjang hasil, atau -1 jika buffer tidak cukup. */
+int WINEXMPP_escape(const char* in, char* out, size_t out_len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // XMPP_STANZA_H
@@ -0,0 +1,94 @@
+#ifndef XMPP_STREAM_H
+#define XMPP_STREAM_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include "xmpp_stanza.h"
+
+/* Namespace yang sering dipakai */
+#define WINEXMPP_NS_CLIENT   "jabber:client"
+#define WINEXMPP_NS_STREAMS  "http://etherx.jabber.org/streams"
+#define WINEXMPP_NS_SASL     "urn:ietf:params:xml:ns:xmpp-sasl"
+#define WINEXMPP_NS_BIND     "urn:ietf:params:xml:ns:xmpp-bind"
+#define WINEXMPP_NS_SESSION  "urn:ietf:params:xml:ns:xmpp-session"
+#define WINEXMPP_NS_MUC      "http://jabber.org/protocol/muc"
+#define WINEXMPP_NS_MUC_USER "http://jabber.org/protocol/muc#user"
+#define WINEXMPP_NS_PING     "urn:xmpp:ping"
+
+/* Batas bawaan parser, lihat WINEXMPP_parser_set_limits() */
+#define WINEXMPP_MAX_STANZA  (256 * 1024)
+#define WINEXMPP_MAX_DEPTH   32
+
+/* Parser stream XML berbasis push (gaya SAX).
+
+   Data socket dimasukkan potongan demi potongan lewat WINEXMPP_parser_feed()
+   tanpa perlu memperhatikan batas token. Parser tidak membangun DOM untuk
+   seluruh dokumen: hanya satu stanza (anak langsung <stream:stream>) yang
+   dirakit di arena, diserahkan ke callback, lalu arena dipakai ulang.
+   Nama elemen/atribut dan namespace di-intern sehingga alokasi per stanza
+   mendekati nol. Tabel intern dibatasi: setelah penuh, nama baru dari peer
+   disalin ke arena stanza, jadi bandingkan nama dengan strcmp, bukan pointer.
+   Ukuran dan kedalaman satu stanza dibatasi, dan blok arena di atas 64 KB
+   dibebaskan setelah stanza besar selesai. */
+typedef struct _WINEXMPP_parser WINEXMPP_parser;
+
+typedef struct {
+    /* <stream:stream ...> diterima; attrs hanya valid selama callback */
+    void (*stream_start)(void* user, const WINEXMPP_stanza* stream);
+    /* Satu stanza lengkap; hanya valid selama callback */
+    void (*stanza)(void* user, const WINEXMPP_stanza* stanza);
+    /* </stream:stream> diterima */
+    void (*stream_end)(void* user);
+} WINEXMPP_parser_callbacks;
+
+typedef struct {
+    uint64_t bytes;         /* Total byte yang diparse */
+    uint64_t stanzas;       /* Total stanza yang diserahkan */
+    uint64_t allocations;   /* Total malloc/realloc yang dilakukan parser */
+    uint64_t interned;      /* Jumlah string di tabel intern (dibatasi) */
+} WINEXMPP_parser_stats;
+
+/* Membuat parser. user diteruskan ke semua callback */
+WINEXMPP_parser* WINEXMPP_parser_create(const WINEXMPP_parser_callbacks* cb, void* user);
+
+/* Memasukkan potongan data. 0 jika berhasil, -1 jika XML tidak valid */
+int WINEXMPP_parser_feed(WINEXMPP_parser* p, const char* data, size_t len);
+
+/* Mengosongkan state untuk stream baru (misal setelah SASL sukses).
+   Tabel intern dan arena tetap dipakai. */
+void WINEXMPP_parser_reset(WINEXMPP_parser* p);
+
+/* Meng-intern string; pointer hasil tetap valid selama parser hidup.
+   NULL jika tabel intern sudah penuh dan string belum ada di dalamnya */
+const char* WINEXMPP_parser_intern(WINEXMPP_parser* p, const char* s, size_t len);
+
+/* Mengatur batas satu stanza: jumlah byte di wire dan kedalaman elemen
+   (akar stanza = 1). 0 berarti nilai bawaan WINEXMPP_MAX_STANZA /
+   WINEXMPP_MAX_DEPTH. Stanza yang melewati batas membuat feed gagal dengan
+   kondisi "policy-violation". Hanya bisa dipanggil di antara stanza;
+   0 jika berhasil, -1 jika gagal */
+int WINEXMPP_parser_set_limits(WINEXMPP_parser* p, size_t max_stanza, int max_depth);
+
+/* Pesan error terakhir (string statis), NULL jika tidak ada */
+const char* WINEXMPP_parser_error(const WINEXMPP_parser* p);
+
+/* Kondisi stream error RFC 6120 untuk error terakhir: "policy-violation"
+   jika batas terlewati, "not-well-formed" untuk XML rusak, NULL jika tidak
+   ada error. Dipakai untuk <stream:error> sebelum stream ditutup */
+const char* WINEXMPP_parser_condition(const WINEXMPP_parser* p);
+
+/* Mengambil statistik parser */
+void WINEXMPP_parser_get_stats(const WINEXMPP_parser* p, WINEXMPP_parser_stats* out);
+
+/* Membebaskan parser beserta arena dan tabel intern */
+void WINEXMPP_parser_free(WINEXMPP_parser* p);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // XMPP_STREAM_H
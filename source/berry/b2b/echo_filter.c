@@ -0,0 +1,305 @@
+#include "echo_filter.h"
+#include "trace.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* Sidik jari pesan yang dikirim, disimpan dalam ring urut waktu */
+struct fp_entry {
+    uint64_t fp;        /* 0 = sudah dihapus (terpakai oleh echo) */
+    uint64_t expires;   /* Waktu kedaluwarsa (ms, monotonic) */
+};
+
+/* Statistik per route, disimpan di tabel open addressing */
+struct route {
+    uint64_t h;         /* 0 = slot kosong */
+    char *network;
+    char *target;
+    uint64_t emitted;
+    uint64_t suppressed;
+};
+
+struct _WINEB2B_echo_filter {
+    char *origin;
+    uint64_t window_ms;
+
+    /* Ring sidik jari (head = paling lama) */
+    struct fp_entry *ring;
+    size_t ring_cap, ring_head, ring_count;
+
+    /* Hash set: indeks ring + 1 (0 = kosong), linear probing */
+    uint32_t *table;
+    size_t table_mask;
+
+    struct route *routes;
+    size_t route_cap, route_count;
+};
+
+/* --- Fungsi Helper --- */
+static uint64_t now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
+
+static uint64_t hash_str(uint64_t h, const char* s) {
+    /* FNV-1a, termasuk '\0' sebagai pemisah antar field */
+    const unsigned char *p = (const unsigned char*)(s ? s : "");
+    do {
+        h ^= *p;
+        h *= 0x100000001b3ULL;
+    } while (*p++);
+    return h;
+}
+
+static uint64_t route_hash(const char* network, const char* target) {
+    uint64_t h = hash_str(hash_str(0xcbf29ce484222325ULL, network), target);
+    return h ? h : 1;
+}
+
+static uint64_t fingerprint(const char* network, const char* target, const char* body) {
+    uint64_t h = hash_str(route_hash(network, target), body);
+    return h ? h : 1;
+}
+
+static int valid_origin(const char* s) {
+    /* Origin dipakai apa adanya di tag IRC dan string JSON */
+    if (!*s)
+        return 0;
+    for (; *s; s++) {
+        if (!((*s >= 'a' && *s <= 'z') || (*s >= 'A' && *s <= 'Z') ||
+              (*s >= '0' && *s <= '9') || *s == '.' || *s == '-' || *s == '_' || *s == ':'))
+            return 0;
+    }
+    return 1;
+}
+
+/* --- Hash set sidik jari --- */
+
+static void table_delete(WINEB2B_echo_filter* f, size_t ring_idx) {
+    size_t i = f->ring[ring_idx].fp & f->table_mask;
+    while (f->table[i] != ring_idx + 1) {
+        if (f->table[i] == 0)
+            return;
+        i = (i + 1) & f->table_mask;
+    }
+    /* Backward-shift deletion agar rantai probing tetap utuh tanpa tombstone */
+    size_t j = i;
+    for (;;) {
+        j = (j + 1) & f->table_mask;
+        if (f->table[j] == 0)
+            break;
+        size_t home = f->ring[f->table[j] - 1].fp & f->table_mask;
+        int movable = (i <= j) ? (home <= i || home > j) : (home <= i && home > j);
+        if (movable) {
+            f->table[i] = f->table[j];
+            i = j;
+        }
+    }
+    f->table[i] = 0;
+}
+
+static void ring_pop(WINEB2B_echo_filter* f) {
+    if (f->ring[f->ring_head].fp)
+        table_delete(f, f->ring_head);
+    f->ring_head = (f->ring_head + 1) % f->ring_cap;
+    f->ring_count--;
+}
+
+static void expire(WINEB2B_echo_filter* f, uint64_t now) {
+    while (f->ring_count > 0) {
+        struct fp_entry *e = &f->ring[f->ring_head];
+        if (e->fp && e->expires > now)
+            break;
+        ring_pop(f);
+    }
+}
+
+/* --- Tabel route --- */
+
+static struct route* route_get(WINEB2B_echo_filter* f, const char* network, const char* target, int create) {
+    uint64_t h = route_hash(network, target);
+    size_t mask = f->route_cap - 1;
+    for (size_t i = h & mask;; i = (i + 1) & mask) {
+        struct route *r = &f->routes[i];
+        if (r->h == 0) {
+            if (!create)
+                return NULL;
+            break;
+        }
+        if (r->h == h && strcmp(r->network, network) == 0 && strcmp(r->target, target) == 0)
+            return r;
+    }
+
+    /* Route baru: perbesar tabel dulu jika load factor > 0.7 */
+    if ((f->route_count + 1) * 10 > f->route_cap * 7) {
+        size_t new_cap = f->route_cap * 2;
+        struct route *grown = calloc(new_cap, sizeof(struct route));
+        if (!grown)
+            return NULL;
+        for (size_t i = 0; i < f->route_cap; i++) {
+            if (f->routes[i].h == 0)
+                continue;
+            size_t j = f->routes[i].h & (new_cap - 1);
+            while (grown[j].h != 0)
+                j = (j + 1) & (new_cap - 1);
+            grown[j] = f->routes[i];
+        }
+        free(f->routes);
+        f->routes = grown;
+        f->route_cap = new_cap;
+        mask = new_cap - 1;
+    }
+    size_t i = h & mask;
+    while (f->routes[i].h != 0)
+        i = (i + 1) & mask;
+    struct route *r = &f->routes[i];
+    r->network = strdup(network);
+    r->target = strdup(target);
+    if (!r->network || !r->target) {
+        free(r->network);
+        free(r->target);
+        r->network = r->target = NULL;
+        return NULL;
+    }
+    r->h = h;
+    r->emitted = r->suppressed = 0;
+    f->route_count++;
+    return r;
+}
+
+/* --- API publik --- */
+
+WINEB2B_echo_filter* WINEB2B_echo_create(const char* origin_id, unsigned window_ms, size_t capacity) {
+    if (!origin_id || !valid_origin(origin_id) || capacity == 0 || capacity > (1u << 30)) {
+        fprintf(stderr, "Error: origin bridge tidak valid\n");
+        return NULL;
+    }
+    WINEB2B_echo_filter *f = calloc(1, sizeof(WINEB2B_echo_filter));
+    if (!f)
+        return NULL;
+    size_t table_size = 16;
+    while (table_size < capacity * 2)
+        table_size <<= 1;
+    f->origin = strdup(origin_id);
+    f->window_ms = window_ms;
+    f->ring_cap = capacity;
+    f->ring = calloc(capacity, sizeof(struct fp_entry));
+    f->table = calloc(table_size, sizeof(uint32_t));
+    f->table_mask = table_size - 1;
+    f->route_cap = 16;
+    f->routes = calloc(f->route_cap, sizeof(struct route));
+    if (!f->origin || !f->ring || !f->table || !f->routes) {
+        WINEB2B_echo_free(f);
+        return NULL;
+    }
+    return f;
+}
+
+const char* WINEB2B_echo_origin(const WINEB2B_echo_filter* f) {
+    return f ? f->origin : NULL;
+}
+
+int WINEB2B_echo_irc_tags(const WINEB2B_echo_filter* f, char* out, size_t out_len) {
+    if (!f || !out)
+        return -1;
+    int len = snprintf(out, out_len, "%s=%s", WINEB2B_ORIGIN_TAG, f->origin);
+    return (len < 0 || (size_t)len >= out_len) ? -1 : 0;
+}
+
+void WINEB2B_echo_note(WINEB2B_echo_filter* f, const char* network,
+                       const char* target, const char* body) {
+    if (!f || !network || !target || !body)
+        return;
+    uint64_t now = now_ms();
+    expire(f, now);
+    if (f->ring_count == f->ring_cap)
+        ring_pop(f);
+
+    size_t idx = (f->ring_head + f->ring_count) % f->ring_cap;
+    f->ring[idx].fp = fingerprint(network, target, body);
+    f->ring[idx].expires = now + f->window_ms;
+    f->ring_count++;
+
+    size_t i = f->ring[idx].fp & f->table_mask;
+    while (f->table[i] != 0)
+        i = (i + 1) & f->table_mask;
+    f->table[i] = (uint32_t)(idx + 1);
+
+    struct route *r = route_get(f, network, target, 1);
+    if (r)
+        r->emitted++;
+}
+
+int WINEB2B_echo_check(WINEB2B_echo_filter* f, const char* network,
+                       const char* target, const char* body, const char* origin) {
+    if (!f || !network || !target || !body)
+        return 0;
+    uint64_t trace = WINEB2B_trace_current;
+    uint64_t start = trace ? WINEB2B_trace_now() : 0;
+    int drop = 0;
+
+    /* Pesan yang sudah distempel bridge mana pun tidak direlay lagi */
+    if (origin && *origin) {
+        drop = 1;
+    } else {
+        uint64_t now = now_ms();
+        expire(f, now);
+        uint64_t fp = fingerprint(network, target, body);
+        for (size_t i = fp & f->table_mask; f->table[i] != 0; i = (i + 1) & f->table_mask) {
+            size_t idx = f->table[i] - 1;
+            if (f->ring[idx].fp == fp) {
+                /* Satu kiriman hanya menekan satu echo */
+                table_delete(f, idx);
+                f->ring[idx].fp = 0;
+                drop = 1;
+                break;
+            }
+        }
+    }
+
+    if (drop) {
+        struct route *r = route_get(f, network, target, 1);
+        if (r)
+            r->suppressed++;
+    }
+    if (trace)
+        WINEB2B_trace_span(trace, "b2b", drop ? "b2b.echo_drop" : "b2b.echo_check", start, WINEB2B_trace_now(), network);
+    return drop;
+}
+
+uint64_t WINEB2B_echo_suppressed(const WINEB2B_echo_filter* f, const char* network, const char* target) {
+    if (!f || !network || !target)
+        return 0;
+    struct route *r = route_get((WINEB2B_echo_filter*)f, network, target, 0);
+    return r ? r->suppressed : 0;
+}
+
+void WINEB2B_echo_foreach_route(const WINEB2B_echo_filter* f, WINEB2B_echo_route_cb cb, void* user) {
+    if (!f || !cb)
+        return;
+    for (size_t i = 0; i < f->route_cap; i++) {
+        const struct route *r = &f->routes[i];
+        if (r->h == 0)
+            continue;
+        WINEB2B_echo_route info = { r->network, r->target, r->emitted, r->suppressed };
+        cb(&info, user);
+    }
+}
+
+void WINEB2B_echo_free(WINEB2B_echo_filter* f) {
+    if (!f)
+        return;
+    if (f->routes) {
+        for (size_t i = 0; i < f->route_cap; i++) {
+            free(f->routes[i].network);
+            free(f->routes[i].target);
+        }
+    }
+    free(f->routes);
+    free(f->origin);
+    free(f->ring);
+    free(f->table);
+    free(f);
+}
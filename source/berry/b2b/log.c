@@ -0,0 +1,701 @@
+#include "log.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <pthread.h>
+
+#define RING_SIZE       (256 * 1024)    /* Per thread, pangkat dua */
+#define RECORD_MAX      2048            /* Header + argumen satu record */
+#define STRING_MAX      1024            /* Salinan satu argumen %s */
+#define OUT_BUF_SIZE    (64 * 1024)
+#define MAX_CATEGORIES  64
+#define DRAIN_MS        10
+
+#define WRAP_FLAG       0x80000000u     /* Sisa ring sampai akhir dilewati */
+#define TRUNC_FLAG      0x8000u         /* String argumen dipotong */
+
+enum { T_INT = 1, T_LONG, T_LLONG, T_DOUBLE, T_STR, T_PTR };
+enum { SITE_NEW, SITE_READY, SITE_EAGER };
+
+struct record {
+    uint32_t size;                      /* Termasuk header, kelipatan 8 */
+    uint32_t tid;
+    const WINEB2B_log_site *site;
+    uint64_t ts_ns;
+};
+
+/* Ring SPSC: thread pemilik menulis head, thread drain menulis tail */
+struct ring {
+    uint64_t head __attribute__((aligned(64)));
+    uint64_t records, dropped;
+    uint64_t tail __attribute__((aligned(64)));
+    uint32_t tid;
+    int dead;                           /* Thread pemilik sudah keluar */
+    struct ring *next;
+    char buf[RING_SIZE] __attribute__((aligned(64)));
+};
+
+struct category {
+    char name[32];
+    unsigned one_in;
+    unsigned max_per_sec;
+    uint64_t seen;
+    int64_t window;
+    uint32_t in_window;
+    uint64_t suppressed;
+    uint64_t reported;                  /* suppressed yang sudah dilaporkan */
+};
+
+int WINEB2B_log_level = WINEB2B_LOG_LEVEL_INFO;
+
+static pthread_mutex_t registry_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t drain_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t wake = PTHREAD_COND_INITIALIZER;
+static struct ring *rings;
+static struct category categories[MAX_CATEGORIES];
+static int ncategories;
+static pthread_key_t ring_key;
+static pthread_once_t key_once = PTHREAD_ONCE_INIT;
+static __thread struct ring *my_ring;
+static uint32_t next_tid;
+
+static pthread_t drain_thread;
+static int running;
+static int stopping;
+static int atexit_registered;
+static int sink_fd = 2;
+
+/* Total dari ring yang sudah dibebaskan */
+static uint64_t retired_records, retired_dropped;
+static uint64_t written;
+
+static const char *const level_names[] = { "trace", "debug", "info", "warn", "error" };
+
+/* --- Parse format per call site --- */
+
+/* Mengisi types[] dari fmt; -1 jika ada konversi yang tidak bisa ditunda */
+static int parse_format(WINEB2B_log_site* site) {
+    int n = 0;
+    for (const char *p = site->fmt; *p; p++) {
+        if (*p != '%')
+            continue;
+        p++;
+        if (*p == '%')
+            continue;
+        while (*p && strchr("-+ #0'", *p))
+            p++;
+        while (*p >= '0' && *p <= '9')
+            p++;
+        if (*p == '.') {
+            p++;
+            while (*p >= '0' && *p <= '9')
+                p++;
+        }
+        if (*p == '*')
+            return -1;
+        int longs = 0, half = 0;
+        for (;; p++) {
+            if (*p == 'l')
+                longs++;
+            else if (*p == 'z' || *p == 't' || *p == 'j')
+                longs = 1;
+            else if (*p == 'h')
+                half = 1;
+            else
+                break;
+        }
+        int type;
+        switch (*p) {
+        case 'd': case 'i': case 'u': case 'o': case 'x': case 'X':
+            type = longs == 0 || half ? T_INT : longs == 1 ? T_LONG : T_LLONG;
+            break;
+        case 'c':
+            type = longs ? 0 : T_INT;
+            break;
+        case 'e': case 'E': case 'f': case 'F': case 'g': case 'G': case 'a': case 'A':
+            type = T_DOUBLE;
+            break;
+        case 's':
+            type = longs ? 0 : T_STR;
+            break;
+        case 'p':
+            type = T_PTR;
+            break;
+        default:    /* %n, %L..., wide char, atau format rusak */
+            type = 0;
+        }
+        if (!type || n == WINEB2B_LOG_MAX_ARGS)
+            return -1;
+        site->types[n++] = (unsigned char)type;
+    }
+    site->nargs = n;
+    return 0;
+}
+
+static int find_category(const char* name, int create) {
+    for (int i = 0; i < ncategories; i++)
+        if (strcmp(categories[i].name, name) == 0)
+            return i;
+    if (!create || ncategories == MAX_CATEGORIES)
+        return -1;
+    struct category *c = &categories[ncategories];
+    memset(c, 0, sizeof(*c));
+    snprintf(c->name, sizeof(c->name), "%s", name);
+    return ncategories++;
+}
+
+static int prepare_site(WINEB2B_log_site* site) {
+    pthread_mutex_lock(&registry_lock);
+    int state = site->state;
+    if (state == SITE_NEW) {
+        site->category_id = find_category(site->category ? site->category : "", 1);
+        state = parse_format(site) == 0 ? SITE_READY : SITE_EAGER;
+        __atomic_store_n(&site->state, state, __ATOMIC_RELEASE);
+    }
+    pthread_mutex_unlock(&registry_lock);
+    return state;
+}
+
+/* --- Thread latar belakang --- */
+
+static void drain(void);
+
+static void* drain_main(void* arg) {
+    (void)arg;
+    pthread_mutex_lock(&registry_lock);
+    while (!stopping) {
+        struct timespec ts;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        ts.tv_nsec += DRAIN_MS * 1000000L;
+        if (ts.tv_nsec >= 1000000000L) {
+            ts.tv_sec++;
+            ts.tv_nsec -= 1000000000L;
+        }
+        pthread_cond_timedwait(&wake, &registry_lock, &ts);
+        pthread_mutex_unlock(&registry_lock);
+        drain();
+        pthread_mutex_lock(&registry_lock);
+    }
+    pthread_mutex_unlock(&registry_lock);
+    return NULL;
+}
+
+static void at_exit(void) {
+    WINEB2B_log_shutdown();
+}
+
+/* Dipanggil dengan registry_lock dipegang */
+static void start_locked(void) {
+    if (running)
+        return;
+    stopping = 0;
+    if (pthread_create(&drain_thread, NULL, drain_main, NULL) != 0)
+        return;
+    __atomic_store_n(&running, 1, __ATOMIC_RELEASE);
+    if (!atexit_registered) {
+        atexit_registered = 1;
+        atexit(at_exit);
+    }
+}
+
+static void ring_release(void* arg) {
+    struct ring *r = arg;
+    __atomic_store_n(&r->dead, 1, __ATOMIC_RELEASE);
+}
+
+static void make_key(void) {
+    pthread_key_create(&ring_key, ring_release);
+}
+
+static struct ring* attach_ring(void) {
+    pthread_once(&key_once, make_key);
+    struct ring *r = aligned_alloc(64, sizeof(struct ring));
+    if (!r)
+        return NULL;
+    r->head = r->tail = 0;
+    r->records = r->dropped = 0;
+    r->dead = 0;
+    pthread_mutex_lock(&registry_lock);
+    r->tid = ++next_tid;
+    r->next = rings;
+    rings = r;
+    start_locked();
+    pthread_mutex_unlock(&registry_lock);
+    pthread_setspecific(ring_key, r);
+    my_ring = r;
+    return r;
+}
+
+/* --- Jalur panas --- */
+
+/* Sampling dan rate limit kategori; 0 jika record dibuang. Dipanggil
+   sebelum timestamp diambil agar record yang dibuang tetap murah */
+static int admit(int id) {
+    if (id < 0)
+        return 1;
+    struct category *c = &categories[id];
+    unsigned one_in = __atomic_load_n(&c->one_in, __ATOMIC_RELAXED);
+    unsigned max = __atomic_load_n(&c->max_per_sec, __ATOMIC_RELAXED);
+    if (one_in <= 1 && max == 0)
+        return 1;
+    if (one_in > 1 && __atomic_fetch_add(&c->seen, 1, __ATOMIC_RELAXED) % one_in != 0)
+        goto drop;
+    if (max) {
+        struct timespec ts;
+        clock_gettime(CLOCK_REALTIME_COARSE, &ts);
+        int64_t sec = (int64_t)ts.tv_sec;
+        int64_t window = __atomic_load_n(&c->window, __ATOMIC_RELAXED);
+        if (window != sec && __atomic_compare_exchange_n(&c->window, &window, sec, 0,
+                                                         __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+            __atomic_store_n(&c->in_window, 0, __ATOMIC_RELAXED);
+        if (__atomic_fetch_add(&c->in_window, 1, __ATOMIC_RELAXED) >= max)
+            goto drop;
+    }
+    return 1;
+drop:
+    __atomic_fetch_add(&c->suppressed, 1, __ATOMIC_RELAXED);
+    return 0;
+}
+
+static void ring_push(struct ring* r, const void* rec, uint32_t size) {
+    uint64_t head = r->head;
+    uint64_t tail = __atomic_load_n(&r->tail, __ATOMIC_ACQUIRE);
+    size_t off = (size_t)(head & (RING_SIZE - 1));
+    size_t pad = off + size > RING_SIZE ? RING_SIZE - off : 0;
+    if (RING_SIZE - (head - tail) < pad + size) {
+        __atomic_store_n(&r->dropped, r->dropped + 1, __ATOMIC_RELAXED);
+        return;
+    }
+    if (pad) {
+        uint32_t marker = WRAP_FLAG | (uint32_t)pad;
+        memcpy(r->buf + off, &marker, sizeof(marker));
+        off = 0;
+    }
+    memcpy(r->buf + off, rec, size);
+    __atomic_store_n(&r->records, r->records + 1, __ATOMIC_RELAXED);
+    __atomic_store_n(&r->head, head + pad + size, __ATOMIC_RELEASE);
+}
+
+void WINEB2B_log_write(WINEB2B_log_site* site, const char* fmt, ...) {
+    int state = __atomic_load_n(&site->state, __ATOMIC_ACQUIRE);
+    if (state == SITE_NEW)
+        state = prepare_site(site);
+
+    if (!admit(site->category_id))
+        return;
+    struct ring *r = my_ring ? my_ring : attach_ring();
+    if (!r)
+        return;
+    if (!__atomic_load_n(&running, __ATOMIC_RELAXED)) {
+        pthread_mutex_lock(&registry_lock);
+        start_locked();
+        pthread_mutex_unlock(&registry_lock);
+    }
+
+    union {
+        struct record hdr;
+        char bytes[RECORD_MAX];
+    } rec;
+    size_t len = sizeof(struct record);
+    va_list ap;
+    va_start(ap, fmt);
+    if (state == SITE_EAGER) {
+        int n = vsnprintf(rec.bytes + len, RECORD_MAX - len, site->fmt, ap);
+        len += n < 0 ? 0 : (size_t)n >= RECORD_MAX - len ? RECORD_MAX - len - 1 : (size_t)n;
+        rec.bytes[len++] = '\0';
+    } else {
+        for (int i = 0; i < site->nargs; i++) {
+            switch (site->types[i]) {
+            case T_INT: {
+                long long v = va_arg(ap, int);
+                memcpy(rec.bytes + len, &v, 8);
+                len += 8;
+                break;
+            }
+            case T_LONG: {
+                long long v = va_arg(ap, long);
+                memcpy(rec.bytes + len, &v, 8);
+                len += 8;
+                break;
+            }
+            case T_LLONG: {
+                long long v = va_arg(ap, long long);
+                memcpy(rec.bytes + len, &v, 8);
+                len += 8;
+                break;
+            }
+            case T_DOUBLE: {
+                double v = va_arg(ap, double);
+                memcpy(rec.bytes + len, &v, 8);
+                len += 8;
+                break;
+            }
+            case T_PTR: {
+                void *v = va_arg(ap, void*);
+                memcpy(rec.bytes + len, &v, sizeof(v));
+                len += 8;
+                break;
+            }
+            case T_STR: {
+                const char *s = va_arg(ap, const char*);
+                if (!s)
+                    s = "(null)";
+                /* Sisakan ruang untuk argumen sesudahnya (paling banyak 8 byte) */
+                long avail = (long)(RECORD_MAX - len) - 2 - (long)(site->nargs - i - 1) * 10;
+                size_t room = avail < 0 ? 0 : avail > STRING_MAX ? STRING_MAX : (size_t)avail;
+                /* Satu lintasan: menyalin sambil mencari NUL */
+                char *dst = rec.bytes + len + 2;
+                char *end = memccpy(dst, s, '\0', room);
+                size_t n = end ? (size_t)(end - dst) - 1 : room;
+                uint16_t hdr = (uint16_t)(!end && s[room] ? n | TRUNC_FLAG : n);
+                memcpy(rec.bytes + len, &hdr, 2);
+                len += 2 + n;
+                break;
+            }
+            }
+        }
+    }
+    va_end(ap);
+
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    rec.hdr.size = (uint32_t)((len + 7) & ~(size_t)7);
+    rec.hdr.tid = r->tid;
+    rec.hdr.site = site;
+    rec.hdr.ts_ns = (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+    ring_push(r, &rec, rec.hdr.size);
+}
+
+/* --- Pemformatan (thread drain) --- */
+
+struct out {
+    char buf[OUT_BUF_SIZE];
+    size_t len;
+};
+
+static struct out out;
+static int64_t cached_sec = -1;
+static char cached_time[32];
+
+static void out_flush(void) {
+    size_t off = 0;
+    while (off < out.len) {
+        ssize_t n = write(sink_fd, out.buf + off, out.len - off);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            break;
+        off += (size_t)n;
+    }
+    out.len = 0;
+}
+
+static void out_put(const char* s, size_t n) {
+    if (out.len + n > sizeof(out.buf))
+        out_flush();
+    if (n > sizeof(out.buf))
+        n = sizeof(out.buf);
+    memcpy(out.buf + out.len, s, n);
+    out.len += n;
+}
+
+static void out_str(const char* s) {
+    out_put(s, strlen(s));
+}
+
+/* Nilai logfmt: dikutip jika kosong atau mengandung spasi, '"', '=' atau kontrol */
+static void out_value(const char* s, size_t n) {
+    int quote = n == 0;
+    for (size_t i = 0; i < n && !quote; i++) {
+        unsigned char ch = (unsigned char)s[i];
+        quote = ch <= ' ' || ch == '"' || ch == '=' || ch == 0x7f;
+    }
+    if (!quote) {
+        out_put(s, n);
+        return;
+    }
+    out_put("\"", 1);
+    for (size_t i = 0; i < n; i++) {
+        unsigned char ch = (unsigned char)s[i];
+        char esc[8];
+        if (ch == '"' || ch == '\\') {
+            esc[0] = '\\';
+            esc[1] = (char)ch;
+            out_put(esc, 2);
+        } else if (ch == '\n') {
+            out_put("\\n", 2);
+        } else if (ch == '\r') {
+            out_put("\\r", 2);
+        } else if (ch == '\t') {
+            out_put("\\t", 2);
+        } else if (ch < ' ' || ch == 0x7f) {
+            snprintf(esc, sizeof(esc), "\\x%02x", ch);
+            out_put(esc, 4);
+        } else {
+            out_put((const char*)&s[i], 1);
+        }
+    }
+    out_put("\"", 1);
+}
+
+static void out_prefix(uint64_t ts_ns, int level, const char* category) {
+    int64_t sec = (int64_t)(ts_ns / 1000000000ULL);
+    if (sec != cached_sec) {
+        time_t t = (time_t)sec;
+        struct tm tm;
+        gmtime_r(&t, &tm);
+        strftime(cached_time, sizeof(cached_time), "%Y-%m-%dT%H:%M:%S", &tm);
+        cached_sec = sec;
+    }
+    char head[128];
+    int n = snprintf(head, sizeof(head), "ts=%s.%06uZ level=%s cat=", cached_time,
+                     (unsigned)(ts_ns % 1000000000ULL / 1000),
+                     level_names[level < 0 ? 0 : level > 4 ? 4 : level]);
+    out_put(head, (size_t)n);
+    out_str(category && *category ? category : "-");
+}
+
+/* Menyusun ulang pesan: setiap konversi diformat dengan spesifikasinya
+   sendiri. %s tepat setelah '=' ditulis sebagai nilai logfmt */
+static void format_record(const struct record* rec) {
+    const WINEB2B_log_site *site = rec->site;
+    const char *args = (const char*)(rec + 1);
+    out_prefix(rec->ts_ns, site->level, site->category);
+    out_put(" ", 1);
+    if (site->state == SITE_EAGER) {
+        out_str(args);
+        out_put("\n", 1);
+        return;
+    }
+    const char *p = site->fmt;
+    int arg = 0;
+    while (*p) {
+        const char *pct = strchr(p, '%');
+        if (!pct) {
+            out_str(p);
+            break;
+        }
+        out_put(p, (size_t)(pct - p));
+        if (pct[1] == '%') {
+            out_put("%", 1);
+            p = pct + 2;
+            continue;
+        }
+        const char *end = pct + 1;
+        while (*end && !strchr("diouxXceEfFgGaAsp", *end))
+            end++;
+        char spec[32];
+        size_t speclen = (size_t)(end - pct + 1);
+        if (!*end || speclen >= sizeof(spec) || arg >= site->nargs)
+            break;
+        memcpy(spec, pct, speclen);
+        spec[speclen] = '\0';
+
+        char tmp[STRING_MAX + 64];
+        int n = 0;
+        long long iv;
+        double dv;
+        void *pv;
+        switch (site->types[arg++]) {
+        case T_INT:
+            memcpy(&iv, args, 8);
+            n = snprintf(tmp, sizeof(tmp), spec, (int)iv);
+            args += 8;
+            break;
+        case T_LONG:
+            memcpy(&iv, args, 8);
+            n = snprintf(tmp, sizeof(tmp), spec, (long)iv);
+            args += 8;
+            break;
+        case T_LLONG:
+            memcpy(&iv, args, 8);
+            n = snprintf(tmp, sizeof(tmp), spec, iv);
+            args += 8;
+            break;
+        case T_DOUBLE:
+            memcpy(&dv, args, 8);
+            n = snprintf(tmp, sizeof(tmp), spec, dv);
+            args += 8;
+            break;
+        case T_PTR:
+            memcpy(&pv, args, sizeof(pv));
+            n = snprintf(tmp, sizeof(tmp), spec, pv);
+            args += 8;
+            break;
+        case T_STR: {
+            uint16_t hdr;
+            memcpy(&hdr, args, 2);
+            size_t slen = hdr & ~TRUNC_FLAG;
+            char s[STRING_MAX + 4];
+            memcpy(s, args + 2, slen);
+            if (hdr & TRUNC_FLAG) {
+                memcpy(s + slen, "...", 3);
+                slen += 3;
+            }
+            s[slen] = '\0';
+            args += 2 + (hdr & ~TRUNC_FLAG);
+            n = snprintf(tmp, sizeof(tmp), spec, s);
+            if (n >= (int)sizeof(tmp))
+                n = (int)sizeof(tmp) - 1;
+            if (n > 0 && pct > site->fmt && pct[-1] == '=') {
+                out_value(tmp, (size_t)n);
+                n = 0;
+            }
+            break;
+        }
+        }
+        if (n >= (int)sizeof(tmp))
+            n = (int)sizeof(tmp) - 1;
+        if (n > 0)
+            out_put(tmp, (size_t)n);
+        p = end + 1;
+    }
+    out_put("\n", 1);
+}
+
+/* Melaporkan record yang dibuang sampling/rate limit sejak drain terakhir */
+static void report_suppressed(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    uint64_t ts_ns = (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+    for (int i = 0; i < ncategories; i++) {
+        struct category *c = &categories[i];
+        uint64_t s = __atomic_load_n(&c->suppressed, __ATOMIC_RELAXED);
+        if (s == c->reported)
+            continue;
+        char line[128];
+        out_prefix(ts_ns, WINEB2B_LOG_LEVEL_WARN, "log");
+        int n = snprintf(line, sizeof(line), " event=suppressed category=%s count=%llu\n", c->name,
+                         (unsigned long long)(s - c->reported));
+        out_put(line, (size_t)n);
+        c->reported = s;
+        written++;
+    }
+}
+
+static void drain(void) {
+    pthread_mutex_lock(&drain_lock);
+    pthread_mutex_lock(&registry_lock);
+    struct ring *list = rings;
+    pthread_mutex_unlock(&registry_lock);
+
+    /* Ring baru selalu ditambahkan di depan, jadi iterasi dari list aman
+       tanpa lock; hanya drain (di bawah drain_lock) yang menghapus ring */
+    for (struct ring *r = list; r; r = r->next) {
+        uint64_t tail = r->tail;
+        uint64_t head = __atomic_load_n(&r->head, __ATOMIC_ACQUIRE);
+        while (tail < head) {
+            const char *p = r->buf + (tail & (RING_SIZE - 1));
+            uint32_t size;
+            memcpy(&size, p, sizeof(size));
+            if (size & WRAP_FLAG) {
+                tail += size & ~WRAP_FLAG;
+                continue;
+            }
+            format_record((const struct record*)p);
+            written++;
+            tail += size;
+        }
+        __atomic_store_n(&r->tail, tail, __ATOMIC_RELEASE);
+    }
+    pthread_mutex_lock(&registry_lock);
+    report_suppressed();
+    /* Ring milik thread yang sudah keluar dan sudah kosong dibebaskan */
+    for (struct ring **pp = &rings; *pp;) {
+        struct ring *r = *pp;
+        if (__atomic_load_n(&r->dead, __ATOMIC_ACQUIRE) &&
+            __atomic_load_n(&r->head, __ATOMIC_ACQUIRE) == r->tail) {
+            *pp = r->next;
+            retired_records += r->records;
+            retired_dropped += r->dropped;
+            free(r);
+        } else {
+            pp = &r->next;
+        }
+    }
+    pthread_mutex_unlock(&registry_lock);
+    out_flush();
+    pthread_mutex_unlock(&drain_lock);
+}
+
+/* --- API --- */
+
+int WINEB2B_log_open(const char* path) {
+    int fd = 2;
+    if (path) {
+        fd = open(path, O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+        if (fd < 0) {
+            perror("Error: membuka file log");
+            return -1;
+        }
+    }
+    pthread_mutex_lock(&drain_lock);
+    out_flush();
+    if (sink_fd != 2)
+        close(sink_fd);
+    sink_fd = fd;
+    pthread_mutex_unlock(&drain_lock);
+    return 0;
+}
+
+int WINEB2B_log_set_sampling(const char* category, unsigned one_in, unsigned max_per_sec) {
+    if (!category)
+        return -1;
+    pthread_mutex_lock(&registry_lock);
+    int id = find_category(category, 1);
+    if (id >= 0) {
+        __atomic_store_n(&categories[id].one_in, one_in, __ATOMIC_RELAXED);
+        __atomic_store_n(&categories[id].max_per_sec, max_per_sec, __ATOMIC_RELAXED);
+    }
+    pthread_mutex_unlock(&registry_lock);
+    if (id < 0) {
+        fprintf(stderr, "Error: kategori log penuh\n");
+        return -1;
+    }
+    return 0;
+}
+
+void WINEB2B_log_flush(void) {
+    drain();
+}
+
+void WINEB2B_log_get_stats(WINEB2B_log_stats* out_stats) {
+    if (!out_stats)
+        return;
+    memset(out_stats, 0, sizeof(*out_stats));
+    pthread_mutex_lock(&registry_lock);
+    out_stats->records = retired_records;
+    out_stats->dropped = retired_dropped;
+    for (const struct ring *r = rings; r; r = r->next) {
+        out_stats->records += __atomic_load_n(&r->records, __ATOMIC_RELAXED);
+        out_stats->dropped += __atomic_load_n(&r->dropped, __ATOMIC_RELAXED);
+    }
+    for (int i = 0; i < ncategories; i++)
+        out_stats->suppressed += __atomic_load_n(&categories[i].suppressed, __ATOMIC_RELAXED);
+    pthread_mutex_unlock(&registry_lock);
+    pthread_mutex_lock(&drain_lock);
+    out_stats->written = written;
+    pthread_mutex_unlock(&drain_lock);
+}
+
+void WINEB2B_log_shutdown(void) {
+    pthread_mutex_lock(&registry_lock);
+    int was_running = running;
+    if (was_running) {
+        stopping = 1;
+        pthread_cond_signal(&wake);
+    }
+    pthread_mutex_unlock(&registry_lock);
+    if (was_running) {
+        pthread_join(drain_thread, NULL);
+        pthread_mutex_lock(&registry_lock);
+        __atomic_store_n(&running, 0, __ATOMIC_RELEASE);
+        pthread_mutex_unlock(&registry_lock);
+    }
+    drain();
+}
@@ -0,0 +1,645 @@
+#include "metrics.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <unistd.h>
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#define MAX_SHARDS    64        /* Thread ke-64 dst. berbagi shard terakhir */
+#define MAX_EXP       35        /* Pangkat dua terbesar dengan bucket sendiri */
+#define MAX_PROTOCOLS 8
+
+/* Satu shard per (handle, thread); counter di cache line sendiri */
+struct shard {
+    uint64_t counters[WINEB2B_METRIC_COUNTERS];
+    WINEB2B_metrics_histogram *hist[WINEB2B_METRIC_HISTOGRAMS];    /* Dialokasikan saat dipakai */
+} __attribute__((aligned(64)));
+
+struct _WINEB2B_metrics {
+    char *protocol;
+    char *instance;
+    struct shard *shards[MAX_SHARDS];
+    int64_t gauges[WINEB2B_METRIC_GAUGES];
+    WINEB2B_metrics *prev, *next;
+};
+
+/* Total handle yang sudah dibebaskan, per protokol */
+struct retired {
+    char protocol[16];
+    WINEB2B_metrics_values values;
+};
+
+static pthread_mutex_t registry_lock = PTHREAD_MUTEX_INITIALIZER;
+static WINEB2B_metrics *registry;
+static struct retired retired[MAX_PROTOCOLS];
+static int nretired;
+
+static int next_slot;
+static __thread int thread_slot = -1;
+static __thread int thread_shared;     /* Shard dipakai bersama: perlu atomic RMW */
+
+static const struct {
+    const char *name;
+    const char *help;
+} counter_info[WINEB2B_METRIC_COUNTERS] = {
+    { "bytes_in",      "Byte diterima dari jaringan." },
+    { "bytes_out",     "Byte dikirim ke jaringan." },
+    { "lines",         "Baris IRC atau stanza XMPP yang diparse." },
+    { "sends_queued",  "Pesan yang diminta dikirim." },
+    { "sends_done",    "Pesan yang terkirim." },
+    { "sends_failed",  "Pesan yang gagal dikirim." },
+    { "reconnects",    "Reconnect ke server." },
+    { "http_requests", "Request HTTP." },
+    { "http_errors",   "Request HTTP yang gagal atau berstatus >= 400." },
+};
+
+static const struct {
+    const char *name;
+    const char *help;
+} gauge_info[WINEB2B_METRIC_GAUGES] = {
+    { "lag_ms", "Lag terakhir dalam milidetik." },
+};
+
+static const struct {
+    const char *name;
+    const char *help;
+} hist_info[WINEB2B_METRIC_HISTOGRAMS] = {
+    { "http_dns_seconds",     "Durasi resolusi DNS per request HTTP." },
+    { "http_connect_seconds", "Durasi koneksi TCP per request HTTP." },
+    { "http_tls_seconds",     "Durasi handshake TLS per request HTTP." },
+    { "http_ttfb_seconds",    "Waktu sampai byte pertama respons HTTP." },
+    { "http_total_seconds",   "Durasi total request HTTP." },
+    { "lag_seconds",          "Lag (IRC: RTT PING keepalive)." },
+};
+
+/* Batas bucket histogram Prometheus (mikrodetik) */
+static const uint64_t prom_le_us[] = {
+    100, 250, 500, 1000, 2500, 5000, 10000, 25000, 50000,
+    100000, 250000, 500000, 1000000, 2500000, 5000000, 10000000,
+};
+
+/* --- Bucket HDR --- */
+
+static unsigned bucket_of(uint64_t v) {
+    if (v < 8)
+        return (unsigned)v;
+    unsigned e = 63 - (unsigned)__builtin_clzll(v);
+    if (e > MAX_EXP)
+        return WINEB2B_METRIC_BUCKETS - 1;
+    return 8 + (e - 3) * 8 + (unsigned)((v >> (e - 3)) & 7);
+}
+
+/* Nilai terbesar yang masuk bucket i */
+static uint64_t bucket_upper(unsigned i) {
+    if (i < 8)
+        return i;
+    unsigned e = (i - 8) / 8 + 3, sub = (i - 8) % 8;
+    return ((uint64_t)(9 + sub) << (e - 3)) - 1;
+}
+
+/* --- Jalur panas --- */
+
+static int assign_slot(void) {
+    int slot = __atomic_fetch_add(&next_slot, 1, __ATOMIC_RELAXED);
+    if (slot >= MAX_SHARDS - 1) {
+        slot = MAX_SHARDS - 1;
+        thread_shared = 1;
+    }
+    thread_slot = slot;
+    return slot;
+}
+
+/* Penulis tunggal cukup load+store; shard bersama memakai fetch_add */
+static inline void bump(uint64_t* p, uint64_t v) {
+    if (thread_shared)
+        __atomic_fetch_add(p, v, __ATOMIC_RELAXED);
+    else
+        __atomic_store_n(p, __atomic_load_n(p, __ATOMIC_RELAXED) + v, __ATOMIC_RELAXED);
+}
+
+static struct shard* install_shard(WINEB2B_metrics* m, int slot) {
+    struct shard *s = aligned_alloc(64, sizeof(struct shard));
+    if (!s)
+        return NULL;
+    memset(s, 0, sizeof(*s));
+    struct shard *expected = NULL;
+    if (!__atomic_compare_exchange_n(&m->shards[slot], &expected, s, 0, __ATOMIC_RELEASE, __ATOMIC_ACQUIRE)) {
+        free(s);
+        return expected;
+    }
+    return s;
+}
+
+static inline struct shard* shard_for(WINEB2B_metrics* m) {
+    int slot = thread_slot >= 0 ? thread_slot : assign_slot();
+    struct shard *s = __atomic_load_n(&m->shards[slot], __ATOMIC_ACQUIRE);
+    return s ? s : install_shard(m, slot);
+}
+
+void WINEB2B_metrics_add(WINEB2B_metrics* m, WINEB2B_metric_counter counter, uint64_t value) {
+    if (!m || (unsigned)counter >= WINEB2B_METRIC_COUNTERS)
+        return;
+    struct shard *s = shard_for(m);
+    if (s)
+        bump(&s->counters[counter], value);
+}
+
+void WINEB2B_metrics_set(WINEB2B_metrics* m, WINEB2B_metric_gauge gauge, int64_t value) {
+    if (!m || (unsigned)gauge >= WINEB2B_METRIC_GAUGES)
+        return;
+    __atomic_store_n(&m->gauges[gauge], value, __ATOMIC_RELAXED);
+}
+
+void WINEB2B_metrics_record(WINEB2B_metrics* m, WINEB2B_metric_histogram hist, uint64_t usec) {
+    if (!m || (unsigned)hist >= WINEB2B_METRIC_HISTOGRAMS)
+        return;
+    struct shard *s = shard_for(m);
+    if (!s)
+        return;
+    WINEB2B_metrics_histogram *h = __atomic_load_n(&s->hist[hist], __ATOMIC_ACQUIRE);
+    if (!h) {
+        WINEB2B_metrics_histogram *fresh = calloc(1, sizeof(*fresh));
+        if (!fresh)
+            return;
+        if (!__atomic_compare_exchange_n(&s->hist[hist], &h, fresh, 0, __ATOMIC_RELEASE, __ATOMIC_ACQUIRE))
+            free(fresh);
+        else
+            h = fresh;
+    }
+    bump(&h->count, 1);
+    bump(&h->sum, usec);
+    bump(&h->buckets[bucket_of(usec)], 1);
+    uint64_t max = __atomic_load_n(&h->max, __ATOMIC_RELAXED);
+    while (usec > max &&
+           !__atomic_compare_exchange_n(&h->max, &max, usec, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        ;
+}
+
+/* --- Registrasi dan snapshot --- */
+
+WINEB2B_metrics* WINEB2B_metrics_create(const char* protocol, const char* instance) {
+    WINEB2B_metrics *m = calloc(1, sizeof(WINEB2B_metrics));
+    if (!m)
+        return NULL;
+    m->protocol = strdup(protocol ? protocol : "");
+    m->instance = strdup(instance ? instance : "");
+    if (!m->protocol || !m->instance) {
+        free(m->protocol);
+        free(m->instance);
+        free(m);
+        return NULL;
+    }
+    pthread_mutex_lock(&registry_lock);
+    m->next = registry;
+    if (registry)
+        registry->prev = m;
+    registry = m;
+    pthread_mutex_unlock(&registry_lock);
+    return m;
+}
+
+static void add_histogram(WINEB2B_metrics_histogram* out, const WINEB2B_metrics_histogram* h) {
+    out->count += __atomic_load_n(&h->count, __ATOMIC_RELAXED);
+    out->sum += __atomic_load_n(&h->sum, __ATOMIC_RELAXED);
+    uint64_t max = __atomic_load_n(&h->max, __ATOMIC_RELAXED);
+    if (max > out->max)
+        out->max = max;
+    for (unsigned b = 0; b < WINEB2B_METRIC_BUCKETS; b++)
+        out->buckets[b] += __atomic_load_n(&h->buckets[b], __ATOMIC_RELAXED);
+}
+
+static void accumulate(const WINEB2B_metrics* m, WINEB2B_metrics_values* out) {
+    for (int i = 0; i < MAX_SHARDS; i++) {
+        const struct shard *s = __atomic_load_n(&m->shards[i], __ATOMIC_ACQUIRE);
+        if (!s)
+            continue;
+        for (int c = 0; c < WINEB2B_METRIC_COUNTERS; c++)
+            out->counters[c] += __atomic_load_n(&s->counters[c], __ATOMIC_RELAXED);
+        for (int h = 0; h < WINEB2B_METRIC_HISTOGRAMS; h++) {
+            const WINEB2B_metrics_histogram *hist = __atomic_load_n(&s->hist[h], __ATOMIC_ACQUIRE);
+            if (hist)
+                add_histogram(&out->hist[h], hist);
+        }
+    }
+}
+
+void WINEB2B_metrics_snapshot(const WINEB2B_metrics* m, WINEB2B_metrics_values* out) {
+    if (!out)
+        return;
+    memset(out, 0, sizeof(*out));
+    if (!m)
+        return;
+    accumulate(m, out);
+    for (int g = 0; g < WINEB2B_METRIC_GAUGES; g++)
+        out->gauges[g] = __atomic_load_n(&m->gauges[g], __ATOMIC_RELAXED);
+}
+
+static void merge_values(WINEB2B_metrics_values* out, const WINEB2B_metrics_values* v) {
+    for (int c = 0; c < WINEB2B_METRIC_COUNTERS; c++)
+        out->counters[c] += v->counters[c];
+    for (int h = 0; h < WINEB2B_METRIC_HISTOGRAMS; h++)
+        add_histogram(&out->hist[h], &v->hist[h]);
+}
+
+static struct retired* find_retired(const char* protocol, int create) {
+    for (int i = 0; i < nretired; i++)
+        if (strcmp(retired[i].protocol, protocol) == 0)
+            return &retired[i];
+    if (!create || nretired == MAX_PROTOCOLS)
+        return NULL;
+    struct retired *r = &retired[nretired++];
+    memset(r, 0, sizeof(*r));
+    snprintf(r->protocol, sizeof(r->protocol), "%s", protocol);
+    return r;
+}
+
+/* Dipanggil dengan registry_lock dipegang. Gauge per proses = nilai terbesar */
+static void process_values(const char* protocol, WINEB2B_metrics_values* out) {
+    memset(out, 0, sizeof(*out));
+    const struct retired *r = find_retired(protocol, 0);
+    if (r)
+        merge_values(out, &r->values);
+    for (const WINEB2B_metrics *m = registry; m; m = m->next) {
+        if (strcmp(m->protocol, protocol) != 0)
+            continue;
+        accumulate(m, out);
+        for (int g = 0; g < WINEB2B_METRIC_GAUGES; g++) {
+            int64_t v = __atomic_load_n(&m->gauges[g], __ATOMIC_RELAXED);
+            if (v > out->gauges[g])
+                out->gauges[g] = v;
+        }
+    }
+}
+
+void WINEB2B_metrics_process(const char* protocol, WINEB2B_metrics_values* out) {
+    if (!protocol || !out)
+        return;
+    pthread_mutex_lock(&registry_lock);
+    process_values(protocol, out);
+    pthread_mutex_unlock(&registry_lock);
+}
+
+uint64_t WINEB2B_metrics_percentile(const WINEB2B_metrics_values* v, WINEB2B_metric_histogram hist, double q) {
+    if (!v || (unsigned)hist >= WINEB2B_METRIC_HISTOGRAMS || v->hist[hist].count == 0)
+        return 0;
+    const WINEB2B_metrics_histogram *h = &v->hist[hist];
+    uint64_t rank = (uint64_t)(q * (double)h->count + 0.5);
+    if (rank < 1)
+        rank = 1;
+    uint64_t seen = 0;
+    for (unsigned b = 0; b < WINEB2B_METRIC_BUCKETS; b++) {
+        seen += h->buckets[b];
+        if (seen >= rank) {
+            uint64_t upper = bucket_upper(b);
+            return upper < h->max ? upper : h->max;
+        }
+    }
+    return h->max;
+}
+
+void WINEB2B_metrics_free(WINEB2B_metrics* m) {
+    if (!m)
+        return;
+    pthread_mutex_lock(&registry_lock);
+    struct retired *r = find_retired(m->protocol, 1);
+    if (r)
+        accumulate(m, &r->values);
+    if (m->prev)
+        m->prev->next = m->next;
+    else
+        registry = m->next;
+    if (m->next)
+        m->next->prev = m->prev;
+    pthread_mutex_unlock(&registry_lock);
+    for (int i = 0; i < MAX_SHARDS; i++) {
+        if (!m->shards[i])
+            continue;
+        for (int h = 0; h < WINEB2B_METRIC_HISTOGRAMS; h++)
+            free(m->shards[i]->hist[h]);
+        free(m->shards[i]);
+    }
+    free(m->protocol);
+    free(m->instance);
+    free(m);
+}
+
+/* --- Format Prometheus --- */
+
+struct text {
+    char *p;
+    size_t len, cap;
+    int failed;
+};
+
+static void emit(struct text* t, const char* fmt, ...) {
+    if (t->failed)
+        return;
+    for (;;) {
+        va_list ap;
+        va_start(ap, fmt);
+        int n = vsnprintf(t->p + t->len, t->cap - t->len, fmt, ap);
+        va_end(ap);
+        if (n < 0) {
+            t->failed = 1;
+            return;
+        }
+        if ((size_t)n < t->cap - t->len) {
+            t->len += (size_t)n;
+            return;
+        }
+        size_t cap = t->cap * 2 + (size_t)n;
+        char *p = realloc(t->p, cap);
+        if (!p) {
+            t->failed = 1;
+            return;
+        }
+        t->p = p;
+        t->cap = cap;
+    }
+}
+
+/* Nilai label dengan escape \\, \" dan \n */
+static void emit_label(struct text* t, const char* s) {
+    for (; *s; s++) {
+        if (*s == '\\' || *s == '"')
+            emit(t, "\\%c", *s);
+        else if (*s == '\n')
+            emit(t, "\\n");
+        else
+            emit(t, "%c", *s);
+    }
+}
+
+static void emit_labels(struct text* t, const char* protocol, const char* instance) {
+    emit(t, "{protocol=\"");
+    emit_label(t, protocol);
+    if (instance) {
+        emit(t, "\",instance=\"");
+        emit_label(t, instance);
+    }
+    emit(t, "\"");
+}
+
+/* Daftar protokol unik dari handle aktif dan yang sudah dibebaskan */
+static int list_protocols(const char** out, int max) {
+    int n = 0;
+    for (int i = 0; i < nretired && n < max; i++)
+        out[n++] = retired[i].protocol;
+    for (const WINEB2B_metrics *m = registry; m && n < max; m = m->next) {
+        int seen = 0;
+        for (int i = 0; i < n && !seen; i++)
+            seen = strcmp(out[i], m->protocol) == 0;
+        if (!seen)
+            out[n++] = m->protocol;
+    }
+    return n;
+}
+
+/* Per proses: histogram Prometheus dengan bucket le tetap (dihitung dari
+   bucket HDR, jadi batasnya sendiri juga berselisih <= 12.5%) */
+static void emit_histogram(struct text* t, const char* protocol, int h, const WINEB2B_metrics_histogram* hist) {
+    uint64_t cumulative = 0;
+    unsigned b = 0;
+    for (size_t i = 0; i < sizeof(prom_le_us) / sizeof(prom_le_us[0]); i++) {
+        while (b < WINEB2B_METRIC_BUCKETS && bucket_upper(b) <= prom_le_us[i])
+            cumulative += hist->buckets[b++];
+        emit(t, "wineberry_%s_bucket", hist_info[h].name);
+        emit_labels(t, protocol, NULL);
+        emit(t, ",le=\"%g\"} %llu\n", prom_le_us[i] / 1e6, (unsigned long long)cumulative);
+    }
+    emit(t, "wineberry_%s_bucket", hist_info[h].name);
+    emit_labels(t, protocol, NULL);
+    emit(t, ",le=\"+Inf\"} %llu\n", (unsigned long long)hist->count);
+    emit(t, "wineberry_%s_sum", hist_info[h].name);
+    emit_labels(t, protocol, NULL);
+    emit(t, "} %.6f\n", hist->sum / 1e6);
+    emit(t, "wineberry_%s_count", hist_info[h].name);
+    emit_labels(t, protocol, NULL);
+    emit(t, "} %llu\n", (unsigned long long)hist->count);
+}
+
+/* Per handle: summary dengan kuantil dari histogram HDR */
+static void emit_summary(struct text* t, const WINEB2B_metrics* m, int h, const WINEB2B_metrics_values* v) {
+    static const double quantiles[] = { 0.5, 0.9, 0.99 };
+    for (size_t i = 0; i < sizeof(quantiles) / sizeof(quantiles[0]); i++) {
+        emit(t, "wineberry_handle_%s", hist_info[h].name);
+        emit_labels(t, m->protocol, m->instance);
+        emit(t, ",quantile=\"%g\"} %.6f\n", quantiles[i],
+             WINEB2B_metrics_percentile(v, (WINEB2B_metric_histogram)h, quantiles[i]) / 1e6);
+    }
+    emit(t, "wineberry_handle_%s_sum", hist_info[h].name);
+    emit_labels(t, m->protocol, m->instance);
+    emit(t, "} %.6f\n", v->hist[h].sum / 1e6);
+    emit(t, "wineberry_handle_%s_count", hist_info[h].name);
+    emit_labels(t, m->protocol, m->instance);
+    emit(t, "} %llu\n", (unsigned long long)v->hist[h].count);
+}
+
+char* WINEB2B_metrics_prometheus(size_t* len) {
+    struct text t = { malloc(16384), 0, 16384, 0 };
+    if (!t.p)
+        return NULL;
+    t.p[0] = '\0';
+
+    pthread_mutex_lock(&registry_lock);
+    const char *protocols[MAX_PROTOCOLS + 16];
+    int nproto = list_protocols(protocols, (int)(sizeof(protocols) / sizeof(protocols[0])));
+    int nhandles = 0;
+    for (const WINEB2B_metrics *m = registry; m; m = m->next)
+        nhandles++;
+    WINEB2B_metrics_values *proc = calloc((size_t)nproto + 1, sizeof(WINEB2B_metrics_values));
+    WINEB2B_metrics_values *handles = calloc((size_t)nhandles + 1, sizeof(WINEB2B_metrics_values));
+    const WINEB2B_metrics **order = calloc((size_t)nhandles + 1, sizeof(WINEB2B_metrics*));
+    if (!proc || !handles || !order) {
+        pthread_mutex_unlock(&registry_lock);
+        free(proc);
+        free(handles);
+        free(order);
+        free(t.p);
+        return NULL;
+    }
+    for (int i = 0; i < nproto; i++)
+        process_values(protocols[i], &proc[i]);
+    int k = 0;
+    for (const WINEB2B_metrics *m = registry; m; m = m->next, k++) {
+        order[k] = m;
+        WINEB2B_metrics_snapshot(m, &handles[k]);
+    }
+
+    for (int c = 0; c < WINEB2B_METRIC_COUNTERS; c++) {
+        emit(&t, "# HELP wineberry_%s_total %s\n# TYPE wineberry_%s_total counter\n",
+             counter_info[c].name, counter_info[c].help, counter_info[c].name);
+        for (int i = 0; i < nproto; i++) {
+            emit(&t, "wineberry_%s_total", counter_info[c].name);
+            emit_labels(&t, protocols[i], NULL);
+            emit(&t, "} %llu\n", (unsigned long long)proc[i].counters[c]);
+        }
+        emit(&t, "# HELP wineberry_handle_%s_total %s\n# TYPE wineberry_handle_%s_total counter\n",
+             counter_info[c].name, counter_info[c].help, counter_info[c].name);
+        for (int i = 0; i < nhandles; i++) {
+            emit(&t, "wineberry_handle_%s_total", counter_info[c].name);
+            emit_labels(&t, order[i]->protocol, order[i]->instance);
+            emit(&t, "} %llu\n", (unsigned long long)handles[i].counters[c]);
+        }
+    }
+    for (int g = 0; g < WINEB2B_METRIC_GAUGES; g++) {
+        emit(&t, "# HELP wineberry_handle_%s %s\n# TYPE wineberry_handle_%s gauge\n",
+             gauge_info[g].name, gauge_info[g].help, gauge_info[g].name);
+        for (int i = 0; i < nhandles; i++) {
+            emit(&t, "wineberry_handle_%s", gauge_info[g].name);
+            emit_labels(&t, order[i]->protocol, order[i]->instance);
+            emit(&t, "} %lld\n", (long long)handles[i].gauges[g]);
+        }
+    }
+    for (int h = 0; h < WINEB2B_METRIC_HISTOGRAMS; h++) {
+        emit(&t, "# HELP wineberry_%s %s\n# TYPE wineberry_%s histogram\n",
+             hist_info[h].name, hist_info[h].help, hist_info[h].name);
+        for (int i = 0; i < nproto; i++)
+            if (proc[i].hist[h].count)
+                emit_histogram(&t, protocols[i], h, &proc[i].hist[h]);
+        emit(&t, "# HELP wineberry_handle_%s %s\n# TYPE wineberry_handle_%s summary\n",
+             hist_info[h].name, hist_info[h].help, hist_info[h].name);
+        for (int i = 0; i < nhandles; i++)
+            if (handles[i].hist[h].count)
+                emit_summary(&t, order[i], h, &handles[i]);
+    }
+    pthread_mutex_unlock(&registry_lock);
+
+    free(proc);
+    free(handles);
+    free(order);
+    if (t.failed) {
+        free(t.p);
+        return NULL;
+    }
+    if (len)
+        *len = t.len;
+    return t.p;
+}
+
+/* --- Endpoint HTTP --- */
+
+static pthread_t serve_thread;
+static int serve_fd = -1;
+static int serve_pipe[2] = { -1, -1 };
+
+static void write_full(int fd, const char* p, size_t len) {
+    while (len > 0) {
+        ssize_t n = send(fd, p, len, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return;
+        p += n;
+        len -= (size_t)n;
+    }
+}
+
+static void serve_client(int fd) {
+    char req[4096];
+    size_t used = 0;
+    struct pollfd pfd = { .fd = fd, .events = POLLIN };
+    while (used < sizeof(req) - 1 && poll(&pfd, 1, 1000) > 0) {
+        ssize_t n = recv(fd, req + used, sizeof(req) - 1 - used, 0);
+        if (n <= 0)
+            break;
+        used += (size_t)n;
+        req[used] = '\0';
+        if (strstr(req, "\r\n\r\n"))
+            break;
+    }
+    req[used] = '\0';
+
+    char head[256];
+    if (strncmp(req, "GET /metrics ", 13) != 0 && strncmp(req, "GET /metrics?", 13) != 0) {
+        static const char nf[] = "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+        write_full(fd, nf, sizeof(nf) - 1);
+        return;
+    }
+    size_t len = 0;
+    char *body = WINEB2B_metrics_prometheus(&len);
+    if (!body) {
+        static const char err[] = "HTTP/1.1 500 Internal Server Error\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+        write_full(fd, err, sizeof(err) - 1);
+        return;
+    }
+    int hlen = snprintf(head, sizeof(head),
+                        "HTTP/1.1 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\n"
+                        "Content-Length: %zu\r\nConnection: close\r\n\r\n", len);
+    write_full(fd, head, (size_t)hlen);
+    write_full(fd, body, len);
+    free(body);
+}
+
+static void* serve_main(void* arg) {
+    (void)arg;
+    struct pollfd pfds[2] = { { .fd = serve_fd, .events = POLLIN }, { .fd = serve_pipe[0], .events = POLLIN } };
+    for (;;) {
+        if (poll(pfds, 2, -1) < 0) {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+        if (pfds[1].revents)
+            break;
+        if (pfds[0].revents & POLLIN) {
+            int fd = accept(serve_fd, NULL, NULL);
+            if (fd >= 0) {
+                serve_client(fd);
+                close(fd);
+            }
+        }
+    }
+    return NULL;
+}
+
+int WINEB2B_metrics_serve(int port) {
+    if (serve_fd >= 0)
+        return -1;
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        perror("Error: socket metrics");
+        return -1;
+    }
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    struct sockaddr_in addr;
+    socklen_t alen = sizeof(addr);
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons((unsigned short)port);
+    if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0 || listen(fd, 16) != 0 ||
+        getsockname(fd, (struct sockaddr*)&addr, &alen) != 0 || pipe(serve_pipe) != 0) {
+        perror("Error: endpoint metrics");
+        close(fd);
+        return -1;
+    }
+    serve_fd = fd;
+    if (pthread_create(&serve_thread, NULL, serve_main, NULL) != 0) {
+        close(serve_fd);
+        close(serve_pipe[0]);
+        close(serve_pipe[1]);
+        serve_fd = serve_pipe[0] = serve_pipe[1] = -1;
+        return -1;
+    }
+    return ntohs(addr.sin_port);
+}
+
+void WINEB2B_metrics_serve_stop(void) {
+    if (serve_fd < 0)
+        return;
+    ssize_t n = write(serve_pipe[1], "x", 1);
+    (void)n;
+    pthread_join(serve_thread, NULL);
+    close(serve_fd);
+    close(serve_pipe[0]);
+    close(serve_pipe[1]);
+    serve_fd = serve_pipe[0] = serve_pipe[1] = -1;
+}
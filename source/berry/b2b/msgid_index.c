@@ -0,0 +1,571 @@
+#include "msgid_index.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#define NIL UINT32_MAX
+
+/* Seed hash berbeda untuk tiap arah agar kedua arah bisa berbagi satu tabel di disk */
+#define SEED_IRC    0xcbf29ce484222325ULL
+#define SEED_MATRIX 0x84222325cbf29ce4ULL
+
+/* Format on-disk */
+#define LOG_MAGIC   0x44494d42u               /* "BMID" */
+#define IDX_MAGIC   0x3158444944494d42ULL     /* "BMIDIDX1" */
+#define IDX_HEADER  32
+#define IDX_MIN_SLOTS 1024
+
+/* --- Struktur internal --- */
+
+/* Satu entri di memori. Ukuran tetap supaya pemakaian memori bisa diprediksi
+   (capacity * sizeof(struct entry)), tanpa alokasi per pesan. */
+struct entry {
+    uint64_t h_irc, h_mx;        /* Hash tiap sisi */
+    uint32_t lru_prev, lru_next; /* Daftar LRU (head = paling baru) */
+    uint32_t chain_irc;          /* Rantai bucket sisi IRC (juga free list) */
+    uint32_t chain_mx;           /* Rantai bucket sisi Matrix */
+    char irc[WINEB2B_MSGID_MAX + 1];
+    char mx[WINEB2B_MSGID_MAX + 1];
+};
+
+/* Header record di log append-only, diikuti irc_len + mx_len byte ID */
+struct log_record {
+    uint32_t magic;
+    uint16_t irc_len;
+    uint16_t mx_len;
+};
+
+/* Satu slot tabel hash di file indeks; off1 = offset record + 1 (0 = kosong) */
+struct idx_slot {
+    uint64_t hash;
+    uint64_t off1;
+};
+
+/* Tabel hash open addressing (linear probing) di disk */
+struct disk_table {
+    int fd;
+    uint64_t slots;    /* Selalu pangkat dua */
+    uint64_t used;
+};
+
+struct _WINEB2B_msgid_index {
+    struct entry *entries;
+    size_t capacity;
+    size_t count;
+    uint32_t *bucket_irc;
+    uint32_t *bucket_mx;
+    uint32_t bucket_mask;
+    uint32_t lru_head, lru_tail;
+    uint32_t free_head;
+
+    /* Store di disk (log_fd < 0 jika tidak dipakai) */
+    int log_fd;
+    uint64_t log_end;
+    struct disk_table table;
+    char *log_path;
+    char *idx_path;
+
+    WINEB2B_msgid_stats stats;
+};
+
+/* --- Fungsi Helper: hash FNV-1a 64-bit --- */
+static uint64_t hash_bytes(uint64_t h, const void* data, size_t len) {
+    const unsigned char *p = data;
+    for (size_t i = 0; i < len; i++) {
+        h ^= p[i];
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+static uint64_t hash_id(const char* id, uint64_t seed) {
+    uint64_t h = hash_bytes(seed, id, strlen(id));
+    return h ? h : 1;
+}
+
+static int copy_out(const char* src, char* out, size_t out_len) {
+    size_t len = strlen(src);
+    if (!out || out_len <= len)
+        return -1;
+    memcpy(out, src, len + 1);
+    return 0;
+}
+
+/* ===================== Bagian memori (hash + LRU) ===================== */
+
+static uint32_t mem_find(WINEB2B_msgid_index* idx, uint64_t h, const char* id, int is_irc) {
+    uint32_t i = is_irc ? idx->bucket_irc[h & idx->bucket_mask]
+                        : idx->bucket_mx[h & idx->bucket_mask];
+    while (i != NIL) {
+        struct entry *e = &idx->entries[i];
+        if (is_irc) {
+            if (e->h_irc == h && strcmp(e->irc, id) == 0)
+                return i;
+            i = e->chain_irc;
+        } else {
+            if (e->h_mx == h && strcmp(e->mx, id) == 0)
+                return i;
+            i = e->chain_mx;
+        }
+    }
+    return NIL;
+}
+
+static void lru_unlink(WINEB2B_msgid_index* idx, uint32_t i) {
+    struct entry *e = &idx->entries[i];
+    if (e->lru_prev != NIL)
+        idx->entries[e->lru_prev].lru_next = e->lru_next;
+    else
+        idx->lru_head = e->lru_next;
+    if (e->lru_next != NIL)
+        idx->entries[e->lru_next].lru_prev = e->lru_prev;
+    else
+        idx->lru_tail = e->lru_prev;
+}
+
+static void lru_push_front(WINEB2B_msgid_index* idx, uint32_t i) {
+    struct entry *e = &idx->entries[i];
+    e->lru_prev = NIL;
+    e->lru_next = idx->lru_head;
+    if (idx->lru_head != NIL)
+        idx->entries[idx->lru_head].lru_prev = i;
+    idx->lru_head = i;
+    if (idx->lru_tail == NIL)
+        idx->lru_tail = i;
+}
+
+static void chain_remove(WINEB2B_msgid_index* idx, uint32_t i, int is_irc) {
+    struct entry *e = &idx->entries[i];
+    uint32_t *link = is_irc ? &idx->bucket_irc[e->h_irc & idx->bucket_mask]
+                            : &idx->bucket_mx[e->h_mx & idx->bucket_mask];
+    while (*link != NIL) {
+        if (*link == i) {
+            *link = is_irc ? e->chain_irc : e->chain_mx;
+            return;
+        }
+        link = is_irc ? &idx->entries[*link].chain_irc : &idx->entries[*link].chain_mx;
+    }
+}
+
+static void mem_remove(WINEB2B_msgid_index* idx, uint32_t i) {
+    chain_remove(idx, i, 1);
+    chain_remove(idx, i, 0);
+    lru_unlink(idx, i);
+    idx->entries[i].chain_irc = idx->free_head;
+    idx->free_head = i;
+    idx->count--;
+}
+
+/* Menyisipkan pemetaan ke memori. Jika promote != 0 (hasil baca dari disk),
+   pemetaan di memori yang sudah ada untuk salah satu sisi tidak ditimpa
+   karena memori selalu memegang versi yang paling baru. */
+static void mem_insert(WINEB2B_msgid_index* idx, const char* irc_id, uint64_t h_irc,
+                       const char* mx_id, uint64_t h_mx, int promote) {
+    uint32_t old_irc = mem_find(idx, h_irc, irc_id, 1);
+    uint32_t old_mx = mem_find(idx, h_mx, mx_id, 0);
+    if (promote && (old_irc != NIL || old_mx != NIL))
+        return;
+    if (old_irc != NIL)
+        mem_remove(idx, old_irc);
+    if (old_mx != NIL && old_mx != old_irc)
+        mem_remove(idx, old_mx);
+
+    if (idx->free_head == NIL) {
+        mem_remove(idx, idx->lru_tail);
+        idx->stats.evictions++;
+    }
+    uint32_t i = idx->free_head;
+    struct entry *e = &idx->entries[i];
+    idx->free_head = e->chain_irc;
+
+    e->h_irc = h_irc;
+    e->h_mx = h_mx;
+    strcpy(e->irc, irc_id);
+    strcpy(e->mx, mx_id);
+    e->chain_irc = idx->bucket_irc[h_irc & idx->bucket_mask];
+    idx->bucket_irc[h_irc & idx->bucket_mask] = i;
+    e->chain_mx = idx->bucket_mx[h_mx & idx->bucket_mask];
+    idx->bucket_mx[h_mx & idx->bucket_mask] = i;
+    lru_push_front(idx, i);
+    idx->count++;
+}
+
+/* ===================== Bagian disk (log + indeks hash) ===================== */
+
+/* Membaca record log pada offset tertentu. Mengembalikan ukuran record
+   atau -1 jika record rusak/terpotong. */
+static long log_read(int fd, uint64_t off, char* irc, char* mx) {
+    struct log_record rec;
+    if (pread(fd, &rec, sizeof(rec), (off_t)off) != (ssize_t)sizeof(rec))
+        return -1;
+    if (rec.magic != LOG_MAGIC || rec.irc_len == 0 || rec.mx_len == 0 ||
+        rec.irc_len > WINEB2B_MSGID_MAX || rec.mx_len > WINEB2B_MSGID_MAX)
+        return -1;
+    char buf[2 * WINEB2B_MSGID_MAX];
+    size_t len = (size_t)rec.irc_len + rec.mx_len;
+    if (pread(fd, buf, len, (off_t)(off + sizeof(rec))) != (ssize_t)len)
+        return -1;
+    memcpy(irc, buf, rec.irc_len);
+    irc[rec.irc_len] = '\0';
+    memcpy(mx, buf + rec.irc_len, rec.mx_len);
+    mx[rec.mx_len] = '\0';
+    return (long)(sizeof(rec) + len);
+}
+
+static int slot_read(struct disk_table* t, uint64_t i, struct idx_slot* s) {
+    off_t pos = IDX_HEADER + (off_t)(i * sizeof(*s));
+    ssize_t n = pread(t->fd, s, sizeof(*s), pos);
+    if (n == 0) {
+        /* Area yang belum pernah ditulis dianggap slot kosong */
+        s->hash = 0;
+        s->off1 = 0;
+        return 0;
+    }
+    return n == (ssize_t)sizeof(*s) ? 0 : -1;
+}
+
+static int slot_write(struct disk_table* t, uint64_t i, const struct idx_slot* s) {
+    off_t pos = IDX_HEADER + (off_t)(i * sizeof(*s));
+    return pwrite(t->fd, s, sizeof(*s), pos) == (ssize_t)sizeof(*s) ? 0 : -1;
+}
+
+static int table_write_header(struct disk_table* t, uint64_t log_indexed) {
+    uint64_t hdr[4] = { IDX_MAGIC, t->slots, t->used, log_indexed };
+    return pwrite(t->fd, hdr, sizeof(hdr), 0) == (ssize_t)sizeof(hdr) ? 0 : -1;
+}
+
+/* Menyisipkan (hash -> offset) ke tabel. Jika slot dengan ID yang sama sudah
+   ada, offset-nya diperbarui ke record yang lebih baru. */
+static int table_insert(struct disk_table* t, int log_fd, uint64_t hash, uint64_t off,
+                        const char* id, int is_irc) {
+    uint64_t mask = t->slots - 1;
+    struct idx_slot s;
+    char irc[WINEB2B_MSGID_MAX + 1], mx[WINEB2B_MSGID_MAX + 1];
+
+    for (uint64_t i = hash & mask, probes = 0; probes < t->slots; i = (i + 1) & mask, probes++) {
+        if (slot_read(t, i, &s) != 0)
+            return -1;
+        if (s.off1 == 0) {
+            s.hash = hash;
+            s.off1 = off + 1;
+            t->used++;
+            return slot_write(t, i, &s);
+        }
+        if (s.hash == hash && log_read(log_fd, s.off1 - 1, irc, mx) > 0 &&
+            strcmp(is_irc ? irc : mx, id) == 0) {
+            s.off1 = off + 1;
+            return slot_write(t, i, &s);
+        }
+    }
+    return -1;
+}
+
+static int table_lookup(struct disk_table* t, int log_fd, uint64_t hash, const char* id,
+                        int is_irc, char* irc, char* mx) {
+    uint64_t mask = t->slots - 1;
+    struct idx_slot s;
+    for (uint64_t i = hash & mask, probes = 0; probes < t->slots; i = (i + 1) & mask, probes++) {
+        if (slot_read(t, i, &s) != 0 || s.off1 == 0)
+            return -1;
+        if (s.hash == hash && log_read(log_fd, s.off1 - 1, irc, mx) > 0 &&
+            strcmp(is_irc ? irc : mx, id) == 0)
+            return 0;
+    }
+    return -1;
+}
+
+/* Mengindeks semua record log dari offset 'from' sampai akhir record valid.
+   Mengembalikan offset akhir record valid terakhir. */
+static uint64_t table_index_log(struct disk_table* t, int log_fd, uint64_t from) {
+    char irc[WINEB2B_MSGID_MAX + 1], mx[WINEB2B_MSGID_MAX + 1];
+    uint64_t off = from;
+    long len;
+    while ((len = log_read(log_fd, off, irc, mx)) > 0) {
+        table_insert(t, log_fd, hash_id(irc, SEED_IRC), off, irc, 1);
+        table_insert(t, log_fd, hash_id(mx, SEED_MATRIX), off, mx, 0);
+        off += (uint64_t)len;
+    }
+    return off;
+}
+
+/* Membangun ulang file indeks dengan jumlah slot baru dari isi log */
+static int table_rebuild(WINEB2B_msgid_index* idx, uint64_t slots) {
+    size_t tmp_len = strlen(idx->idx_path) + 5;
+    char *tmp_path = malloc(tmp_len);
+    if (!tmp_path)
+        return -1;
+    snprintf(tmp_path, tmp_len, "%s.tmp", idx->idx_path);
+
+    struct disk_table t = { -1, slots, 0 };
+    t.fd = open(tmp_path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (t.fd < 0 || ftruncate(t.fd, IDX_HEADER + (off_t)(slots * sizeof(struct idx_slot))) != 0) {
+        perror("Error membuat indeks msgid");
+        if (t.fd >= 0)
+            close(t.fd);
+        free(tmp_path);
+        return -1;
+    }
+    table_index_log(&t, idx->log_fd, 0);
+    if (table_write_header(&t, idx->log_end) != 0 || rename(tmp_path, idx->idx_path) != 0) {
+        perror("Error menyimpan indeks msgid");
+        close(t.fd);
+        unlink(tmp_path);
+        free(tmp_path);
+        return -1;
+    }
+    free(tmp_path);
+    if (idx->table.fd >= 0)
+        close(idx->table.fd);
+    idx->table = t;
+    return 0;
+}
+
+static int disk_open(WINEB2B_msgid_index* idx, const char* store_path) {
+    size_t len = strlen(store_path) + 5;
+    idx->log_path = malloc(len);
+    idx->idx_path = malloc(len);
+    if (!idx->log_path || !idx->idx_path)
+        return -1;
+    snprintf(idx->log_path, len, "%s.log", store_path);
+    snprintf(idx->idx_path, len, "%s.idx", store_path);
+
+    idx->log_fd = open(idx->log_path, O_RDWR | O_CREAT, 0644);
+    if (idx->log_fd < 0) {
+        perror("Error membuka log msgid");
+        return -1;
+    }
+
+    /* Coba pakai indeks yang sudah ada; jika tidak valid, bangun ulang */
+    uint64_t hdr[4] = { 0, 0, 0, 0 };
+    uint64_t indexed = 0;
+    idx->table.fd = open(idx->idx_path, O_RDWR);
+    if (idx->table.fd >= 0 &&
+        pread(idx->table.fd, hdr, sizeof(hdr), 0) == (ssize_t)sizeof(hdr) &&
+        hdr[0] == IDX_MAGIC && hdr[1] >= IDX_MIN_SLOTS && (hdr[1] & (hdr[1] - 1)) == 0) {
+        idx->table.slots = hdr[1];
+        idx->table.used = hdr[2];
+        indexed = hdr[3];
+    } else {
+        if (idx->table.fd >= 0)
+            close(idx->table.fd);
+        idx->table.fd = -1;
+    }
+
+    if (idx->table.fd < 0) {
+        /* Log harus discan dari awal untuk menemukan akhir record valid */
+        char irc[WINEB2B_MSGID_MAX + 1], mx[WINEB2B_MSGID_MAX + 1];
+        long rec_len;
+        uint64_t end = 0, records = 0;
+        while ((rec_len = log_read(idx->log_fd, end, irc, mx)) > 0) {
+            end += (uint64_t)rec_len;
+            records++;
+        }
+        idx->log_end = end;
+        uint64_t slots = IDX_MIN_SLOTS;
+        while (slots * 7 < records * 2 * 10)
+            slots <<= 1;
+        if (table_rebuild(idx, slots) != 0)
+            return -1;
+    } else {
+        /* Indeks hanya perlu mengejar record yang ditulis setelah header terakhir */
+        idx->log_end = table_index_log(&idx->table, idx->log_fd, indexed);
+    }
+
+    /* Buang sisa record yang terpotong (misal karena crash saat menulis) */
+    struct stat st;
+    if (fstat(idx->log_fd, &st) == 0 && (uint64_t)st.st_size > idx->log_end) {
+        if (ftruncate(idx->log_fd, (off_t)idx->log_end) != 0)
+            perror("Error memotong log msgid");
+    }
+    return table_write_header(&idx->table, idx->log_end);
+}
+
+static int disk_append(WINEB2B_msgid_index* idx, const char* irc_id, uint64_t h_irc,
+                       const char* mx_id, uint64_t h_mx) {
+    /* Jaga load factor tabel di bawah 0.7 */
+    if ((idx->table.used + 2) * 10 > idx->table.slots * 7) {
+        if (table_rebuild(idx, idx->table.slots * 2) != 0)
+            return -1;
+    }
+
+    char buf[sizeof(struct log_record) + 2 * WINEB2B_MSGID_MAX];
+    struct log_record rec = { LOG_MAGIC, (uint16_t)strlen(irc_id), (uint16_t)strlen(mx_id) };
+    memcpy(buf, &rec, sizeof(rec));
+    memcpy(buf + sizeof(rec), irc_id, rec.irc_len);
+    memcpy(buf + sizeof(rec) + rec.irc_len, mx_id, rec.mx_len);
+    size_t len = sizeof(rec) + rec.irc_len + rec.mx_len;
+
+    if (pwrite(idx->log_fd, buf, len, (off_t)idx->log_end) != (ssize_t)len) {
+        perror("Error menulis log msgid");
+        return -1;
+    }
+    uint64_t off = idx->log_end;
+    idx->log_end += len;
+    if (table_insert(&idx->table, idx->log_fd, h_irc, off, irc_id, 1) != 0 ||
+        table_insert(&idx->table, idx->log_fd, h_mx, off, mx_id, 0) != 0) {
+        fprintf(stderr, "Error memperbarui indeks msgid\n");
+        return -1;
+    }
+    return 0;
+}
+
+/* ===================== API publik ===================== */
+
+WINEB2B_msgid_index* WINEB2B_msgid_index_create(size_t capacity, const char* store_path) {
+    if (capacity == 0 || capacity >= NIL)
+        return NULL;
+    WINEB2B_msgid_index* idx = calloc(1, sizeof(WINEB2B_msgid_index));
+    if (!idx)
+        return NULL;
+    idx->log_fd = -1;
+    idx->table.fd = -1;
+
+    uint32_t buckets = 16;
+    while (buckets < capacity && buckets < (1u << 31))
+        buckets <<= 1;
+    idx->capacity = capacity;
+    idx->bucket_mask = buckets - 1;
+    idx->entries = malloc(capacity * sizeof(struct entry));
+    idx->bucket_irc = malloc(buckets * sizeof(uint32_t));
+    idx->bucket_mx = malloc(buckets * sizeof(uint32_t));
+    if (!idx->entries || !idx->bucket_irc || !idx->bucket_mx) {
+        WINEB2B_msgid_index_free(idx);
+        return NULL;
+    }
+    memset(idx->bucket_irc, 0xff, buckets * sizeof(uint32_t));
+    memset(idx->bucket_mx, 0xff, buckets * sizeof(uint32_t));
+    for (size_t i = 0; i < capacity; i++)
+        idx->entries[i].chain_irc = (i + 1 < capacity) ? (uint32_t)(i + 1) : NIL;
+    idx->free_head = 0;
+    idx->lru_head = idx->lru_tail = NIL;
+
+    if (store_path && disk_open(idx, store_path) != 0) {
+        WINEB2B_msgid_index_free(idx);
+        return NULL;
+    }
+    return idx;
+}
+
+int WINEB2B_msgid_index_put(WINEB2B_msgid_index* idx, const char* irc_id, const char* matrix_event_id) {
+    if (!idx || !irc_id || !matrix_event_id)
+        return -1;
+    size_t irc_len = strlen(irc_id), mx_len = strlen(matrix_event_id);
+    if (irc_len == 0 || mx_len == 0 || irc_len > WINEB2B_MSGID_MAX || mx_len > WINEB2B_MSGID_MAX)
+        return -1;
+
+    uint64_t h_irc = hash_id(irc_id, SEED_IRC);
+    uint64_t h_mx = hash_id(matrix_event_id, SEED_MATRIX);
+    mem_insert(idx, irc_id, h_irc, matrix_event_id, h_mx, 0);
+    if (idx->log_fd >= 0)
+        return disk_append(idx, irc_id, h_irc, matrix_event_id, h_mx);
+    return 0;
+}
+
+/* Record (irc, mx) dari disk hanya berlaku jika ID sisi lainnya masih
+   menunjuk ke pasangan yang sama. Setelah pemetaan ulang (misal irc -> mx2),
+   record lama (irc, mx1) tetap ada di log dan di slot mx1, tetapi irc sudah
+   menunjuk ke record yang lebih baru, sehingga mx1 tidak lagi dipetakan */
+static int disk_current(WINEB2B_msgid_index* idx, const char* irc, const char* mx, int found_by_irc) {
+    const char *other = found_by_irc ? mx : irc;
+    uint64_t h = hash_id(other, found_by_irc ? SEED_MATRIX : SEED_IRC);
+    uint32_t i = mem_find(idx, h, other, !found_by_irc);
+    if (i != NIL)
+        return strcmp(found_by_irc ? idx->entries[i].irc : idx->entries[i].mx, found_by_irc ? irc : mx) == 0;
+    char cur_irc[WINEB2B_MSGID_MAX + 1], cur_mx[WINEB2B_MSGID_MAX + 1];
+    return table_lookup(&idx->table, idx->log_fd, h, other, !found_by_irc, cur_irc, cur_mx) == 0 &&
+           strcmp(cur_irc, irc) == 0 && strcmp(cur_mx, mx) == 0;
+}
+
+static int index_get(WINEB2B_msgid_index* idx, const char* id, int is_irc, char* out, size_t out_len) {
+    if (!idx || !id)
+        return -1;
+    uint64_t h = hash_id(id, is_irc ? SEED_IRC : SEED_MATRIX);
+    uint32_t i = mem_find(idx, h, id, is_irc);
+    if (i != NIL) {
+        lru_unlink(idx, i);
+        lru_push_front(idx, i);
+        idx->stats.mem_hits++;
+        return copy_out(is_irc ? idx->entries[i].mx : idx->entries[i].irc, out, out_len);
+    }
+
+    char irc[WINEB2B_MSGID_MAX + 1], mx[WINEB2B_MSGID_MAX + 1];
+    if (idx->log_fd >= 0 && table_lookup(&idx->table, idx->log_fd, h, id, is_irc, irc, mx) == 0 &&
+        disk_current(idx, irc, mx, is_irc)) {
+        /* Naikkan ke memori agar lookup berikutnya (edit/reply beruntun) cepat */
+        mem_insert(idx, irc, hash_id(irc, SEED_IRC), mx, hash_id(mx, SEED_MATRIX), 1);
+        idx->stats.disk_hits++;
+        return copy_out(is_irc ? mx : irc, out, out_len);
+    }
+    idx->stats.misses++;
+    return -1;
+}
+
+int WINEB2B_msgid_index_get_matrix(WINEB2B_msgid_index* idx, const char* irc_id,
+                                   char* out, size_t out_len) {
+    return index_get(idx, irc_id, 1, out, out_len);
+}
+
+int WINEB2B_msgid_index_get_irc(WINEB2B_msgid_index* idx, const char* matrix_event_id,
+                                char* out, size_t out_len) {
+    return index_get(idx, matrix_event_id, 0, out, out_len);
+}
+
+int WINEB2B_msgid_synthetic(char* out, size_t out_len,
+                            const char* network, const char* target,
+                            const char* nick, long timestamp, const char* body) {
+    if (!out || out_len < 18)
+        return -1;
+    const char *parts[4] = { network, target, nick, body };
+    uint64_t h = SEED_IRC;
+    for (int i = 0; i < 4; i++) {
+        const char *s = parts[i] ? parts[i] : "";
+        h = hash_bytes(h, s, strlen(s) + 1);
+        if (i == 2)
+            h = hash_bytes(h, &timestamp, sizeof(timestamp));
+    }
+    snprintf(out, out_len, "~%016llx", (unsigned long long)h);
+    return 0;
+}
+
+int WINEB2B_msgid_index_sync(WINEB2B_msgid_index* idx) {
+    if (!idx)
+        return -1;
+    if (idx->log_fd < 0)
+        return 0;
+    if (fsync(idx->log_fd) != 0 || table_write_header(&idx->table, idx->log_end) != 0 ||
+        fsync(idx->table.fd) != 0) {
+        perror("Error sinkronisasi store msgid");
+        return -1;
+    }
+    return 0;
+}
+
+void WINEB2B_msgid_index_stats(const WINEB2B_msgid_index* idx, WINEB2B_msgid_stats* out) {
+    if (!idx || !out)
+        return;
+    *out = idx->stats;
+    out->mem_entries = idx->count;
+    out->capacity = idx->capacity;
+}
+
+void WINEB2B_msgid_index_free(WINEB2B_msgid_index* idx) {
+    if (!idx)
+        return;
+    if (idx->table.fd >= 0) {
+        table_write_header(&idx->table, idx->log_end);
+        close(idx->table.fd);
+    }
+    if (idx->log_fd >= 0)
+        close(idx->log_fd);
+    free(idx->log_path);
+    free(idx->idx_path);
+    free(idx->entries);
+    free(idx->bucket_irc);
+    free(idx->bucket_mx);
+    free(idx);
+}
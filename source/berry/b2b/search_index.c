@@ -0,0 +1,1713 @@
+#include "search_index.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#define SEG_MAGIC        "WBFTS01"
+#define DEFAULT_FLUSH    65536
+#define DEFAULT_MERGE    8
+#define BLOCK            128           /* Dokumen per blok posting (satu skip entry) */
+#define MAX_TOKEN        64            /* Byte per token, sisanya dipotong */
+#define MAX_FIELD        255           /* Byte nama network/channel di term filter */
+#define MAX_QUERY_TERMS  16
+#define MAX_PHRASE_TOKENS 64
+#define NO_DOC           UINT32_MAX
+#define MAX_SEG_DOCS     0x7fffffffu
+
+/* Term filter diawali byte yang tidak pernah dihasilkan tokenizer */
+#define TERM_CHANNEL     '\x01'
+#define TERM_NETWORK     '\x02'
+
+/* --- Format segmen (little-endian, dibaca langsung dari mmap) ---
+
+   header | blob dokumen | offset dokumen (u64 x ndocs+1) | posting |
+   skip entry | kamus term | string term
+
+   Posting satu term: aliran dokumen (varint delta ID, varint jumlah posisi)
+   lalu aliran posisi (varint delta posisi per dokumen). Setiap blok BLOCK
+   dokumen punya skip entry berisi ID terakhir dan offset awal blok di kedua
+   aliran, sehingga blok bisa didekode sendiri-sendiri dan dilompati. */
+
+struct seg_header {
+    char magic[8];
+    uint64_t base;          /* ID global dokumen lokal 0 */
+    uint32_t ndocs, nterms;
+    uint64_t nskips;
+    uint64_t blob_off, offs_off, postings_off, skips_off, terms_off, strings_off;
+    uint64_t size;
+};
+
+struct seg_term {
+    uint64_t docs_off, pos_off;     /* Relatif terhadap postings_off */
+    uint32_t str_off, len;
+    uint32_t df;                    /* Jumlah dokumen */
+    uint32_t skip;                  /* Indeks skip entry blok pertama */
+};
+
+struct seg_skip {
+    uint32_t last_doc;              /* ID lokal dokumen terakhir di blok */
+    uint32_t docs_off, pos_off;     /* Relatif terhadap awal aliran term */
+};
+
+/* Record dokumen di blob, diikuti network, channel, sender, text (masing-masing
+   diakhiri NUL) dan padding ke kelipatan 8 */
+struct doc_rec {
+    int64_t timestamp;
+    uint32_t text_len;
+    uint16_t network_len, channel_len, sender_len;
+    uint16_t pad[3];
+};
+
+/* Segmen yang di-mmap. refs dipegang daftar segmen dan query yang sedang berjalan */
+struct seg {
+    int refs;
+    int dead;               /* Sudah digantikan merge: file dihapus saat ref terakhir lepas */
+    unsigned seq;
+    char *path;
+    const uint8_t *map;
+    size_t size;
+    const struct seg_header *h;
+    const uint64_t *offs;
+    const uint8_t *blob, *postings;
+    const struct seg_skip *skips;
+    const struct seg_term *terms;
+    const char *strings;
+};
+
+/* --- Buffer memori (segmen yang belum ditulis) --- */
+
+struct mem_term {
+    uint64_t hash;
+    uint32_t str_off, len;
+    uint32_t *docs, *begin, *pos;   /* begin[i]..begin[i+1] = posisi dokumen ke-i */
+    uint32_t ndocs, npos, docs_cap, pos_cap;
+};
+
+struct builder {
+    int refs;
+    uint64_t base;
+    uint32_t ndocs;
+    uint8_t *blob;
+    size_t blob_len, blob_cap;
+    uint64_t *offs;
+    size_t offs_cap;
+    struct mem_term *terms;
+    uint32_t nterms, terms_cap;
+    uint32_t *table;                /* Indeks term + 1, 0 = kosong */
+    uint32_t table_cap;             /* Selalu pangkat dua */
+    char *strs;
+    size_t strs_len, strs_cap;
+    uint32_t cur_doc;               /* Dokumen yang sedang ditokenisasi */
+    int failed;
+};
+
+struct _WINEB2B_search {
+    char *dir;
+    unsigned flush_docs, merge_factor;
+
+    pthread_rwlock_t active_lock;   /* Melindungi active; diambil sebelum lock */
+    struct builder *active;
+
+    pthread_mutex_t lock;           /* Melindungi daftar segmen, frozen dan status thread */
+    pthread_cond_t wake, done;
+    struct builder *frozen;         /* Buffer penuh yang sedang ditulis thread latar */
+    struct seg **segs;
+    size_t nsegs, segs_cap;
+    unsigned next_seq;
+    uint64_t merges;
+    int flush_failed;
+    int stop;
+    pthread_t worker;
+};
+
+/* --- Utilitas --- */
+
+static uint64_t hash_bytes(const char* s, size_t len) {
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < len; i++) {
+        h ^= (unsigned char)s[i];
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+static int term_cmp(const char* a, uint32_t alen, const char* b, uint32_t blen) {
+    int c = memcmp(a, b, alen < blen ? alen : blen);
+    if (c)
+        return c;
+    return alen < blen ? -1 : alen > blen;
+}
+
+static int grow(void** p, uint32_t* cap, size_t need, size_t elem) {
+    if (need <= *cap)
+        return 0;
+    size_t n = *cap ? (size_t)*cap * 2 : 4;
+    while (n < need)
+        n *= 2;
+    if (n > UINT32_MAX)
+        return -1;
+    void *q = realloc(*p, n * elem);
+    if (!q)
+        return -1;
+    *p = q;
+    *cap = (uint32_t)n;
+    return 0;
+}
+
+static int grow_bytes(void** p, size_t* cap, size_t need) {
+    if (need <= *cap)
+        return 0;
+    size_t n = *cap ? *cap * 2 : 4096;
+    while (n < need)
+        n *= 2;
+    void *q = realloc(*p, n);
+    if (!q)
+        return -1;
+    *p = q;
+    *cap = n;
+    return 0;
+}
+
+static inline uint8_t* put_varint(uint8_t* p, uint32_t v) {
+    while (v >= 0x80) {
+        *p++ = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    *p++ = (uint8_t)v;
+    return p;
+}
+
+static inline uint32_t get_varint(const uint8_t** pp) {
+    const uint8_t *p = *pp;
+    uint32_t v = *p & 0x7f;
+    if (*p++ & 0x80) {
+        int shift = 7;
+        do {
+            v |= (uint32_t)(*p & 0x7f) << shift;
+            shift += 7;
+        } while (*p++ & 0x80);
+    }
+    *pp = p;
+    return v;
+}
+
+/* --- Tokenizer --- */
+
+/* Dipanggil untuk setiap token (sudah dilipat ke huruf kecil). joined non-0
+   jika token menempel langsung pada token sebelumnya (deret CJK).
+   Kembalikan non-0 untuk berhenti */
+typedef int (*token_fn)(const char* tok, size_t len, uint32_t pos, int joined, void* user);
+
+/* Mendekode satu codepoint; mengembalikan panjangnya, cp = -1 jika UTF-8 tidak valid */
+static size_t utf8_decode(const unsigned char* s, size_t len, int32_t* cp) {
+    unsigned char c = s[0];
+    size_t n;
+    int32_t v, min;
+    if (c < 0x80) {
+        *cp = c;
+        return 1;
+    } else if (c >= 0xc2 && c < 0xe0) {
+        n = 2; v = c & 0x1f; min = 0x80;
+    } else if (c >= 0xe0 && c < 0xf0) {
+        n = 3; v = c & 0x0f; min = 0x800;
+    } else if (c >= 0xf0 && c < 0xf5) {
+        n = 4; v = c & 0x07; min = 0x10000;
+    } else {
+        *cp = -1;
+        return 1;
+    }
+    if (n > len) {
+        *cp = -1;
+        return 1;
+    }
+    for (size_t i = 1; i < n; i++) {
+        if ((s[i] & 0xc0) != 0x80) {
+            *cp = -1;
+            return 1;
+        }
+        v = (v << 6) | (s[i] & 0x3f);
+    }
+    if (v < min || v > 0x10ffff || (v >= 0xd800 && v <= 0xdfff)) {
+        *cp = -1;
+        return 1;
+    }
+    *cp = v;
+    return n;
+}
+
+static size_t utf8_encode(uint32_t c, char* out) {
+    if (c < 0x80) {
+        out[0] = (char)c;
+        return 1;
+    } else if (c < 0x800) {
+        out[0] = (char)(0xc0 | (c >> 6));
+        out[1] = (char)(0x80 | (c & 0x3f));
+        return 2;
+    } else if (c < 0x10000) {
+        out[0] = (char)(0xe0 | (c >> 12));
+        out[1] = (char)(0x80 | ((c >> 6) & 0x3f));
+        out[2] = (char)(0x80 | (c & 0x3f));
+        return 3;
+    }
+    out[0] = (char)(0xf0 | (c >> 18));
+    out[1] = (char)(0x80 | ((c >> 12) & 0x3f));
+    out[2] = (char)(0x80 | ((c >> 6) & 0x3f));
+    out[3] = (char)(0x80 | (c & 0x3f));
+    return 4;
+}
+
+/* Huruf kecil untuk ASCII, Latin-1, Latin Extended-A, Yunani dan Sirilik */
+static uint32_t fold(uint32_t c) {
+    if (c < 0x80)
+        return (c >= 'A' && c <= 'Z') ? c + 32 : c;
+    if (c >= 0xc0 && c <= 0xde && c != 0xd7)
+        return c + 32;
+    if ((c >= 0x100 && c <= 0x137) || (c >= 0x14a && c <= 0x177))
+        return c | 1;
+    if ((c >= 0x139 && c <= 0x148) || (c >= 0x179 && c <= 0x17e))
+        return (c & 1) ? c + 1 : c;
+    if (c >= 0x391 && c <= 0x3ab && c != 0x3a2)
+        return c + 32;
+    if (c == 0x3c2)
+        return 0x3c3;   /* Sigma akhir */
+    if (c >= 0x410 && c <= 0x42f)
+        return c + 32;
+    if (c >= 0x400 && c <= 0x40f)
+        return c + 80;
+    return c;
+}
+
+/* Tanda baca, simbol dan emoji non-ASCII memisahkan kata */
+static int is_separator(uint32_t c) {
+    return (c >= 0x80 && c <= 0xbf) || c == 0xd7 || c == 0xf7 ||
+           (c >= 0x2000 && c <= 0x2bff) || (c >= 0x3000 && c <= 0x303f) ||
+           (c >= 0xfe30 && c <= 0xfe4f) || c == 0xfeff ||
+           (c >= 0xff00 && c <= 0xff0f) || (c >= 0xff1a && c <= 0xff20) ||
+           (c >= 0xff3b && c <= 0xff40) || (c >= 0xff5b && c <= 0xff65) ||
+           (c >= 0x1f000 && c <= 0x1faff);
+}
+
+/* Aksara tanpa spasi antar kata: setiap karakter menjadi token */
+static int is_cjk(uint32_t c) {
+    return (c >= 0x3040 && c <= 0x30ff) || (c >= 0x3400 && c <= 0x4dbf) ||
+           (c >= 0x4e00 && c <= 0x9fff) || (c >= 0xf900 && c <= 0xfaff) ||
+           (c >= 0x20000 && c <= 0x2ffff);
+}
+
+static int color_digit(char c, int hex) {
+    if (c >= '0' && c <= '9')
+        return 1;
+    return hex && ((c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F'));
+}
+
+/* Panjang kode warna IRC setelah ^C (angka) atau ^D (hex) */
+static size_t color_len(const char* s, size_t len, int hex) {
+    size_t max = hex ? 6 : 2, i = 0, n;
+    for (n = 0; i < len && n < max; i++, n++)
+        if (!color_digit(s[i], hex))
+            break;
+    if (n > 0 && i + 1 < len && s[i] == ',') {
+        size_t j = i + 1;
+        for (n = 0; j < len && n < max; j++, n++)
+            if (!color_digit(s[j], hex))
+                break;
+        if (n > 0)
+            i = j;
+    }
+    return i;
+}
+
+static int is_word_ascii(int c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9');
+}
+
+/* Memecah teks menjadi token dan memanggil fn untuk masing-masing.
+   Mengembalikan jumlah token */
+static uint32_t tokenize(const char* text, size_t len, token_fn fn, void* user) {
+    char tok[MAX_TOKEN + 4];
+    size_t tlen = 0, i = 0;
+    uint32_t pos = 0;
+    int adjacent = 0;       /* Belum ada pemisah sejak token terakhir */
+    int word_joined = 0;
+
+#define FLUSH_WORD()                                                \
+    do {                                                            \
+        if (tlen) {                                                 \
+            if (fn(tok, tlen, pos++, word_joined, user))            \
+                return pos;                                         \
+            tlen = 0;                                               \
+            adjacent = 1;                                           \
+        }                                                           \
+    } while (0)
+
+    while (i < len) {
+        int32_t cp;
+        size_t n = utf8_decode((const unsigned char*)text + i, len - i, &cp);
+        if (cp == 0x03 || cp == 0x04) {
+            /* Kode warna IRC: angka setelahnya bukan bagian teks */
+            FLUSH_WORD();
+            adjacent = 0;
+            i += 1 + color_len(text + i + 1, len - i - 1, cp == 0x04);
+            continue;
+        }
+        int word = cp >= 0x80 ? !is_separator((uint32_t)cp) : (cp >= 0 && is_word_ascii(cp));
+        if (!word) {
+            FLUSH_WORD();
+            adjacent = 0;
+        } else if (is_cjk((uint32_t)cp)) {
+            FLUSH_WORD();
+            char ch[4];
+            size_t clen = utf8_encode((uint32_t)cp, ch);
+            if (fn(ch, clen, pos++, adjacent, user))
+                return pos;
+            adjacent = 1;
+        } else {
+            if (!tlen)
+                word_joined = adjacent;
+            if (tlen + 4 <= MAX_TOKEN)
+                tlen += utf8_encode(fold((uint32_t)cp), tok + tlen);
+        }
+        i += n;
+    }
+    FLUSH_WORD();
+#undef FLUSH_WORD
+    return pos;
+}
+
+/* Term filter: prefiks diikuti nama dengan huruf besar/kecil ASCII disamakan */
+static uint32_t filter_term(char* out, char prefix, const char* name) {
+    uint32_t len = 0;
+    out[len++] = prefix;
+    for (; *name && len <= MAX_FIELD; name++) {
+        char c = *name;
+        out[len++] = (c >= 'A' && c <= 'Z') ? (char)(c + 32) : c;
+    }
+    return len;
+}
+
+/* --- Buffer memori --- */
+
+static struct builder* builder_new(uint64_t base) {
+    struct builder *b = calloc(1, sizeof(*b));
+    if (!b)
+        return NULL;
+    b->refs = 1;
+    b->base = base;
+    b->table_cap = 1024;
+    b->table = calloc(b->table_cap, sizeof(uint32_t));
+    b->offs_cap = 1024;
+    b->offs = malloc(b->offs_cap * sizeof(uint64_t));
+    if (!b->table || !b->offs) {
+        free(b->table);
+        free(b->offs);
+        free(b);
+        return NULL;
+    }
+    b->offs[0] = 0;
+    return b;
+}
+
+static void builder_free(struct builder* b) {
+    if (!b)
+        return;
+    for (uint32_t i = 0; i < b->nterms; i++) {
+        free(b->terms[i].docs);
+        free(b->terms[i].begin);
+        free(b->terms[i].pos);
+    }
+    free(b->terms);
+    free(b->table);
+    free(b->strs);
+    free(b->blob);
+    free(b->offs);
+    free(b);
+}
+
+/* Dipanggil dengan s->lock */
+static void builder_unref(struct builder* b) {
+    if (b && --b->refs == 0)
+        builder_free(b);
+}
+
+static const struct mem_term* builder_find(const struct builder* b, const char* s, uint32_t len) {
+    uint64_t h = hash_bytes(s, len);
+    uint32_t mask = b->table_cap - 1;
+    for (uint32_t i = (uint32_t)h & mask; b->table[i]; i = (i + 1) & mask) {
+        const struct mem_term *t = &b->terms[b->table[i] - 1];
+        if (t->hash == h && t->len == len && memcmp(b->strs + t->str_off, s, len) == 0)
+            return t;
+    }
+    return NULL;
+}
+
+static int builder_rehash(struct builder* b) {
+    uint32_t cap = b->table_cap * 2, mask = cap - 1;
+    uint32_t *table = calloc(cap, sizeof(uint32_t));
+    if (!table)
+        return -1;
+    for (uint32_t t = 0; t < b->nterms; t++) {
+        uint32_t i = (uint32_t)b->terms[t].hash & mask;
+        while (table[i])
+            i = (i + 1) & mask;
+        table[i] = t + 1;
+    }
+    free(b->table);
+    b->table = table;
+    b->table_cap = cap;
+    return 0;
+}
+
+static struct mem_term* builder_term(struct builder* b, const char* s, uint32_t len) {
+    if ((b->nterms + 1) * 2 > b->table_cap && builder_rehash(b) != 0)
+        return NULL;
+    uint64_t h = hash_bytes(s, len);
+    uint32_t mask = b->table_cap - 1, i;
+    for (i = (uint32_t)h & mask; b->table[i]; i = (i + 1) & mask) {
+        struct mem_term *t = &b->terms[b->table[i] - 1];
+        if (t->hash == h && t->len == len && memcmp(b->strs + t->str_off, s, len) == 0)
+            return t;
+    }
+    if (grow((void**)&b->terms, &b->terms_cap, b->nterms + 1, sizeof(struct mem_term)) != 0 ||
+        grow_bytes((void**)&b->strs, &b->strs_cap, b->strs_len + len) != 0)
+        return NULL;
+    struct mem_term *t = &b->terms[b->nterms];
+    memset(t, 0, sizeof(*t));
+    t->hash = h;
+    t->str_off = (uint32_t)b->strs_len;
+    t->len = len;
+    memcpy(b->strs + b->strs_len, s, len);
+    b->strs_len += len;
+    b->table[i] = ++b->nterms;
+    return t;
+}
+
+static int term_add(struct mem_term* t, uint32_t doc, uint32_t pos) {
+    if (!t->ndocs || t->docs[t->ndocs - 1] != doc) {
+        if (t->ndocs == t->docs_cap) {
+            uint32_t cap = t->docs_cap ? t->docs_cap * 2 : 2;
+            uint32_t *docs = realloc(t->docs, cap * sizeof(uint32_t));
+            if (!docs)
+                return -1;
+            t->docs = docs;
+            uint32_t *begin = realloc(t->begin, (cap + 1) * sizeof(uint32_t));
+            if (!begin)
+                return -1;
+            t->begin = begin;
+            t->docs_cap = cap;
+        }
+        t->begin[t->ndocs] = t->npos;
+        t->docs[t->ndocs++] = doc;
+    }
+    if (grow((void**)&t->pos, &t->pos_cap, t->npos + 1, sizeof(uint32_t)) != 0)
+        return -1;
+    t->pos[t->npos++] = pos;
+    t->begin[t->ndocs] = t->npos;
+    return 0;
+}
+
+static int index_token(const char* tok, size_t len, uint32_t pos, int joined, void* user) {
+    struct builder *b = user;
+    (void)joined;
+    struct mem_term *t = builder_term(b, tok, (uint32_t)len);
+    if (!t || term_add(t, b->cur_doc, pos) != 0)
+        b->failed = 1;
+    return 0;
+}
+
+static size_t field_len(const char* s, size_t max) {
+    size_t n = s ? strlen(s) : 0;
+    return n > max ? max : n;
+}
+
+/* Menambahkan dokumen ke buffer. Mengembalikan ID lokal, -1 jika gagal */
+static int64_t builder_add(struct builder* b, const WINEB2B_search_doc* doc) {
+    size_t nl = field_len(doc->network, UINT16_MAX), cl = field_len(doc->channel, UINT16_MAX);
+    size_t sl = field_len(doc->sender, UINT16_MAX), tl = field_len(doc->text, UINT32_MAX);
+    size_t need = (sizeof(struct doc_rec) + nl + cl + sl + tl + 4 + 7) & ~(size_t)7;
+    if (grow_bytes((void**)&b->blob, &b->blob_cap, b->blob_len + need) != 0)
+        return -1;
+    if (b->ndocs + 2 > b->offs_cap) {
+        uint64_t *offs = realloc(b->offs, b->offs_cap * 2 * sizeof(uint64_t));
+        if (!offs)
+            return -1;
+        b->offs = offs;
+        b->offs_cap *= 2;
+    }
+    uint8_t *rec = b->blob + b->blob_len;
+    memset(rec, 0, need);
+    struct doc_rec *r = (struct doc_rec*)rec;
+    r->timestamp = doc->timestamp;
+    r->text_len = (uint32_t)tl;
+    r->network_len = (uint16_t)nl;
+    r->channel_len = (uint16_t)cl;
+    r->sender_len = (uint16_t)sl;
+    char *p = (char*)(r + 1);
+    if (nl)
+        memcpy(p, doc->network, nl);
+    p += nl + 1;
+    memcpy(p, doc->channel, cl);
+    p += cl + 1;
+    if (sl)
+        memcpy(p, doc->sender, sl);
+    p += sl + 1;
+    memcpy(p, doc->text, tl);
+
+    b->cur_doc = b->ndocs;
+    b->failed = 0;
+    tokenize(doc->text, tl, index_token, b);
+    char term[MAX_FIELD + 2];
+    index_token(term, filter_term(term, TERM_CHANNEL, doc->channel), 0, 0, b);
+    if (doc->network)
+        index_token(term, filter_term(term, TERM_NETWORK, doc->network), 0, 0, b);
+
+    b->blob_len += need;
+    b->offs[++b->ndocs] = b->blob_len;
+    if (b->failed) {
+        fprintf(stderr, "Error: memori habis saat mengindeks pesan\n");
+        return -1;
+    }
+    return b->cur_doc;
+}
+
+/* --- Segmen --- */
+
+static char* seg_path(const char* dir, unsigned seq, const char* ext) {
+    size_t len = strlen(dir) + 32;
+    char *path = malloc(len);
+    if (path)
+        snprintf(path, len, "%s/%08u.%s", dir, seq, ext);
+    return path;
+}
+
+static int seg_valid(const struct seg_header* h, size_t size) {
+    if (memcmp(h->magic, SEG_MAGIC, sizeof(h->magic)) != 0 || h->size != size)
+        return 0;
+    if (h->blob_off < sizeof(*h) || h->offs_off < h->blob_off || h->offs_off % 8 ||
+        h->offs_off + ((uint64_t)h->ndocs + 1) * sizeof(uint64_t) > h->postings_off)
+        return 0;
+    if (h->skips_off < h->postings_off || h->skips_off % 8 ||
+        h->skips_off + h->nskips * sizeof(struct seg_skip) > h->terms_off || h->terms_off % 8 ||
+        h->terms_off + (uint64_t)h->nterms * sizeof(struct seg_term) > h->strings_off ||
+        h->strings_off > size)
+        return 0;
+    return 1;
+}
+
+static struct seg* seg_open(const char* dir, unsigned seq) {
+    char *path = seg_path(dir, seq, "fts");
+    if (!path)
+        return NULL;
+    int fd = open(path, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        fprintf(stderr, "Error: gagal membuka segmen %s: %s\n", path, strerror(errno));
+        if (fd >= 0)
+            close(fd);
+        free(path);
+        return NULL;
+    }
+    void *map = MAP_FAILED;
+    if ((size_t)st.st_size >= sizeof(struct seg_header))
+        map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED || !seg_valid(map, (size_t)st.st_size)) {
+        fprintf(stderr, "Error: segmen %s rusak\n", path);
+        if (map != MAP_FAILED)
+            munmap(map, (size_t)st.st_size);
+        free(path);
+        return NULL;
+    }
+    struct seg *g = calloc(1, sizeof(*g));
+    if (!g) {
+        munmap(map, (size_t)st.st_size);
+        free(path);
+        return NULL;
+    }
+    g->refs = 1;
+    g->seq = seq;
+    g->path = path;
+    g->map = map;
+    g->size = (size_t)st.st_size;
+    g->h = map;
+    g->blob = g->map + g->h->blob_off;
+    g->offs = (const uint64_t*)(g->map + g->h->offs_off);
+    g->postings = g->map + g->h->postings_off;
+    g->skips = (const struct seg_skip*)(g->map + g->h->skips_off);
+    g->terms = (const struct seg_term*)(g->map + g->h->terms_off);
+    g->strings = (const char*)(g->map + g->h->strings_off);
+    return g;
+}
+
+/* Dipanggil dengan s->lock (atau setelah thread latar berhenti) */
+static void seg_unref(struct seg* g) {
+    if (!g || --g->refs > 0)
+        return;
+    munmap((void*)g->map, g->size);
+    if (g->dead)
+        unlink(g->path);
+    free(g->path);
+    free(g);
+}
+
+static const struct seg_term* seg_find(const struct seg* g, const char* s, uint32_t len) {
+    uint32_t lo = 0, hi = g->h->nterms;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        const struct seg_term *t = &g->terms[mid];
+        int c = term_cmp(g->strings + t->str_off, t->len, s, len);
+        if (c == 0)
+            return t;
+        if (c < 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return NULL;
+}
+
+/* --- Penulisan segmen --- */
+
+struct buf {
+    uint8_t *data;
+    size_t len, cap;
+};
+
+struct writer {
+    FILE *f;
+    char *tmp, *path;
+    uint64_t off;
+    int failed;
+    struct seg_header h;
+    struct seg_term *terms;
+    uint32_t nterms, terms_cap;
+    struct seg_skip *skips;
+    uint32_t nskips, skips_cap;
+    char *strs;
+    size_t strs_len, strs_cap;
+    struct buf d, p;        /* Aliran dokumen dan posisi term yang sedang ditulis */
+    uint32_t prev, in_block;
+};
+
+/* Bagian blob dokumen yang disalin ke segmen baru */
+struct doc_part {
+    const uint8_t *blob;
+    const uint64_t *offs;
+    uint32_t ndocs;
+};
+
+static void writer_write(struct writer* w, const void* data, size_t len) {
+    if (!w->failed && len && fwrite(data, 1, len, w->f) != len)
+        w->failed = 1;
+    w->off += len;
+}
+
+static void writer_align(struct writer* w) {
+    static const char zero[8];
+    writer_write(w, zero, (8 - w->off % 8) % 8);
+}
+
+static int writer_open(struct writer* w, const char* dir, unsigned seq, uint64_t base) {
+    memset(w, 0, sizeof(*w));
+    w->tmp = seg_path(dir, seq, "tmp");
+    w->path = seg_path(dir, seq, "fts");
+    w->f = w->tmp ? fopen(w->tmp, "wb") : NULL;
+    if (!w->f || !w->path) {
+        fprintf(stderr, "Error: gagal membuat segmen %s: %s\n", w->tmp ? w->tmp : dir, strerror(errno));
+        free(w->tmp);
+        free(w->path);
+        return -1;
+    }
+    w->h.base = base;
+    writer_write(w, &w->h, sizeof(w->h));
+    return 0;
+}
+
+static void writer_release(struct writer* w) {
+    free(w->terms);
+    free(w->skips);
+    free(w->strs);
+    free(w->d.data);
+    free(w->p.data);
+    free(w->tmp);
+    free(w->path);
+}
+
+static void writer_abort(struct writer* w) {
+    fclose(w->f);
+    unlink(w->tmp);
+    writer_release(w);
+}
+
+static void writer_docs(struct writer* w, const struct doc_part* parts, size_t nparts) {
+    uint64_t chunk[512], shift = 0;
+    size_t n = 0;
+    w->h.blob_off = w->off;
+    for (size_t i = 0; i < nparts; i++)
+        writer_write(w, parts[i].blob, parts[i].offs[parts[i].ndocs]);
+    writer_align(w);
+    w->h.offs_off = w->off;
+    for (size_t i = 0; i < nparts; i++) {
+        for (uint32_t j = 0; j < parts[i].ndocs; j++) {
+            chunk[n++] = parts[i].offs[j] + shift;
+            if (n == sizeof(chunk) / sizeof(chunk[0])) {
+                writer_write(w, chunk, sizeof(chunk));
+                n = 0;
+            }
+        }
+        shift += parts[i].offs[parts[i].ndocs];
+        w->h.ndocs += parts[i].ndocs;
+    }
+    chunk[n++] = shift;
+    writer_write(w, chunk, n * sizeof(uint64_t));
+    w->h.postings_off = w->off;
+}
+
+static int buf_reserve(struct buf* b, size_t extra) {
+    return grow_bytes((void**)&b->data, &b->cap, b->len + extra);
+}
+
+static void writer_term_begin(struct writer* w, const char* s, uint32_t len) {
+    if (grow((void**)&w->terms, &w->terms_cap, w->nterms + 1, sizeof(struct seg_term)) != 0 ||
+        grow_bytes((void**)&w->strs, &w->strs_cap, w->strs_len + len) != 0) {
+        w->failed = 1;
+        return;
+    }
+    struct seg_term *t = &w->terms[w->nterms++];
+    memset(t, 0, sizeof(*t));
+    t->str_off = (uint32_t)w->strs_len;
+    t->len = len;
+    t->skip = w->nskips;
+    memcpy(w->strs + w->strs_len, s, len);
+    w->strs_len += len;
+    w->d.len = w->p.len = 0;
+    w->prev = NO_DOC;
+    w->in_block = 0;
+}
+
+static void writer_add(struct writer* w, uint32_t doc, const uint32_t* pos, uint32_t npos) {
+    if (w->failed)
+        return;
+    if (w->in_block == 0) {
+        if (grow((void**)&w->skips, &w->skips_cap, w->nskips + 1, sizeof(struct seg_skip)) != 0) {
+            w->failed = 1;
+            return;
+        }
+        struct seg_skip *sk = &w->skips[w->nskips++];
+        sk->docs_off = (uint32_t)w->d.len;
+        sk->pos_off = (uint32_t)w->p.len;
+    }
+    if (buf_reserve(&w->d, 10) != 0 || buf_reserve(&w->p, (size_t)npos * 5) != 0) {
+        w->failed = 1;
+        return;
+    }
+    uint8_t *q = put_varint(w->d.data + w->d.len, doc - w->prev);
+    w->d.len = (size_t)(put_varint(q, npos) - w->d.data);
+    q = w->p.data + w->p.len;
+    for (uint32_t i = 0, last = 0; i < npos; i++) {
+        q = put_varint(q, pos[i] - last);
+        last = pos[i];
+    }
+    w->p.len = (size_t)(q - w->p.data);
+    if (w->d.len > UINT32_MAX || w->p.len > UINT32_MAX)
+        w->failed = 1;
+    w->prev = doc;
+    w->terms[w->nterms - 1].df++;
+    if (++w->in_block == BLOCK) {
+        w->skips[w->nskips - 1].last_doc = doc;
+        w->in_block = 0;
+    }
+}
+
+static void writer_term_end(struct writer* w) {
+    if (w->failed)
+        return;
+    struct seg_term *t = &w->terms[w->nterms - 1];
+    if (w->in_block)
+        w->skips[w->nskips - 1].last_doc = w->prev;
+    t->docs_off = w->off - w->h.postings_off;
+    writer_write(w, w->d.data, w->d.len);
+    t->pos_off = w->off - w->h.postings_off;
+    writer_write(w, w->p.data, w->p.len);
+}
+
+static struct seg* writer_finish(struct writer* w, const char* dir, unsigned seq) {
+    writer_align(w);
+    w->h.skips_off = w->off;
+    w->h.nskips = w->nskips;
+    writer_write(w, w->skips, (size_t)w->nskips * sizeof(struct seg_skip));
+    writer_align(w);
+    w->h.terms_off = w->off;
+    w->h.nterms = w->nterms;
+    writer_write(w, w->terms, (size_t)w->nterms * sizeof(struct seg_term));
+    w->h.strings_off = w->off;
+    writer_write(w, w->strs, w->strs_len);
+    w->h.size = w->off;
+    memcpy(w->h.magic, SEG_MAGIC, sizeof(w->h.magic));
+    if (w->failed || fseek(w->f, 0, SEEK_SET) != 0 || fwrite(&w->h, sizeof(w->h), 1, w->f) != 1 ||
+        fflush(w->f) != 0 || fsync(fileno(w->f)) != 0) {
+        fprintf(stderr, "Error: gagal menulis segmen %s: %s\n", w->tmp, strerror(errno));
+        writer_abort(w);
+        return NULL;
+    }
+    fclose(w->f);
+    if (rename(w->tmp, w->path) != 0) {
+        perror("rename");
+        unlink(w->tmp);
+        writer_release(w);
+        return NULL;
+    }
+    writer_release(w);
+    return seg_open(dir, seq);
+}
+
+struct sort_term {
+    const char *s;
+    uint32_t len, idx;
+};
+
+static int sort_term_cmp(const void* a, const void* b) {
+    const struct sort_term *x = a, *y = b;
+    return term_cmp(x->s, x->len, y->s, y->len);
+}
+
+/* Menulis buffer yang sudah dibekukan menjadi segmen */
+static struct seg* write_builder(const char* dir, unsigned seq, const struct builder* b) {
+    struct writer w;
+    if (writer_open(&w, dir, seq, b->base) != 0)
+        return NULL;
+    struct doc_part part = { b->blob, b->offs, b->ndocs };
+    writer_docs(&w, &part, 1);
+    struct sort_term *order = malloc((b->nterms ? b->nterms : 1) * sizeof(*order));
+    if (!order) {
+        writer_abort(&w);
+        return NULL;
+    }
+    for (uint32_t i = 0; i < b->nterms; i++) {
+        order[i].s = b->strs + b->terms[i].str_off;
+        order[i].len = b->terms[i].len;
+        order[i].idx = i;
+    }
+    qsort(order, b->nterms, sizeof(*order), sort_term_cmp);
+    for (uint32_t i = 0; i < b->nterms && !w.failed; i++) {
+        const struct mem_term *t = &b->terms[order[i].idx];
+        writer_term_begin(&w, order[i].s, t->len);
+        for (uint32_t d = 0; d < t->ndocs; d++)
+            writer_add(&w, t->docs[d], t->pos + t->begin[d], t->begin[d + 1] - t->begin[d]);
+        writer_term_end(&w);
+    }
+    free(order);
+    return writer_finish(&w, dir, seq);
+}
+
+/* --- Kursor posting list ---
+
+   Kursor bergerak mundur (dokumen terbaru dulu). Posting buffer memori
+   dibaca langsung sebagai satu blok; posting segmen didekode per blok. */
+
+struct cursor {
+    const struct seg *seg;          /* NULL untuk buffer memori */
+    const struct seg_term *st;
+    uint32_t df, nblocks;
+    int block;                      /* Blok yang terdekode, -1 jika belum ada */
+    const uint32_t *docs, *begin, *pos;
+    uint32_t n;                     /* Dokumen di blok */
+    uint32_t i;                     /* Posisi kursor di blok */
+    uint32_t docs_buf[BLOCK], begin_buf[BLOCK + 1];
+    uint32_t *pos_buf;
+    size_t pos_cap;
+};
+
+static void cursor_seg(struct cursor* c, const struct seg* g, const struct seg_term* st) {
+    c->seg = g;
+    c->st = st;
+    c->df = st->df;
+    c->nblocks = (st->df + BLOCK - 1) / BLOCK;
+    c->block = -1;
+    c->n = c->i = 0;
+}
+
+static void cursor_mem(struct cursor* c, const struct mem_term* t) {
+    c->seg = NULL;
+    c->st = NULL;
+    c->df = t->ndocs;
+    c->nblocks = 1;
+    c->block = 0;
+    c->docs = t->docs;
+    c->begin = t->begin;
+    c->pos = t->pos;
+    c->n = t->ndocs;
+    c->i = t->ndocs - 1;
+}
+
+static void decode_block(struct cursor* c, uint32_t b) {
+    const struct seg_skip *sk = &c->seg->skips[c->st->skip + b];
+    const uint8_t *p = c->seg->postings + c->st->docs_off + sk->docs_off;
+    uint32_t n = b + 1 < c->nblocks ? BLOCK : c->df - b * BLOCK;
+    uint32_t doc = b ? sk[-1].last_doc : NO_DOC, total = 0;
+    c->begin_buf[0] = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        doc += get_varint(&p);
+        c->docs_buf[i] = doc;
+        total += get_varint(&p);
+        c->begin_buf[i + 1] = total;
+    }
+    c->block = (int)b;
+    c->n = n;
+    c->i = n - 1;
+    c->docs = c->docs_buf;
+    c->begin = c->begin_buf;
+    c->pos = NULL;
+}
+
+/* Posisi blok didekode hanya saat frasa perlu diperiksa di blok ini */
+static void decode_positions(struct cursor* c) {
+    uint32_t total = c->begin_buf[c->n];
+    if (total > c->pos_cap) {
+        uint32_t *buf = realloc(c->pos_buf, total * sizeof(uint32_t));
+        if (!buf)
+            return;     /* pos NULL: frasa dianggap tidak cocok */
+        c->pos_buf = buf;
+        c->pos_cap = total;
+    }
+    const struct seg_skip *sk = &c->seg->skips[c->st->skip + (uint32_t)c->block];
+    const uint8_t *p = c->seg->postings + c->st->pos_off + sk->pos_off;
+    for (uint32_t i = 0, k = 0; i < c->n; i++) {
+        uint32_t last = 0;
+        for (; k < c->begin_buf[i + 1]; k++) {
+            last += get_varint(&p);
+            c->pos_buf[k] = last;
+        }
+    }
+    c->pos = c->pos_buf;
+}
+
+/* Pindah ke dokumen terbesar <= target. Target tidak pernah naik selama
+   satu lintasan. Mengembalikan ID lokal, NO_DOC jika habis */
+static uint32_t cursor_seek(struct cursor* c, uint32_t target) {
+    if (c->block < 0 || c->docs[0] > target) {
+        uint32_t hi = c->block < 0 ? c->nblocks : (uint32_t)c->block;
+        if (!c->seg || hi == 0)
+            return NO_DOC;
+        /* Blok pertama yang dokumen terakhirnya >= target */
+        const struct seg_skip *sk = &c->seg->skips[c->st->skip];
+        uint32_t lo = 0, h = hi;
+        while (lo < h) {
+            uint32_t mid = lo + (h - lo) / 2;
+            if (sk[mid].last_doc < target)
+                lo = mid + 1;
+            else
+                h = mid;
+        }
+        uint32_t b = lo == hi ? hi - 1 : lo;
+        decode_block(c, b);
+        if (c->docs[0] > target) {
+            if (b == 0)
+                return NO_DOC;
+            decode_block(c, b - 1);
+            return c->docs[c->i];
+        }
+    }
+    if (c->docs[c->i] <= target)
+        return c->docs[c->i];
+    uint32_t lo = 0, hi = c->i;
+    while (lo < hi) {
+        uint32_t mid = (lo + hi + 1) / 2;
+        if (c->docs[mid] <= target)
+            lo = mid;
+        else
+            hi = mid - 1;
+    }
+    c->i = lo;
+    return c->docs[lo];
+}
+
+static const uint32_t* cursor_positions(struct cursor* c, uint32_t* n) {
+    if (!c->pos && c->seg)
+        decode_positions(c);
+    if (!c->pos) {
+        *n = 0;
+        return NULL;
+    }
+    *n = c->begin[c->i + 1] - c->begin[c->i];
+    return c->pos + c->begin[c->i];
+}
+
+/* --- Query --- */
+
+struct qterm {
+    uint32_t len;
+    char str[MAX_FIELD + 2];
+};
+
+struct query {
+    struct qterm terms[MAX_QUERY_TERMS];
+    unsigned nterms;
+    uint8_t tokens[MAX_PHRASE_TOKENS];  /* Indeks term untuk setiap token frasa */
+    unsigned ntokens;
+    struct {
+        uint8_t first, count;
+    } phrases[MAX_PHRASE_TOKENS / 2];
+    unsigned nphrases;
+    unsigned group;                     /* Awal frasa yang sedang dibentuk */
+    int quoted, error;
+};
+
+static int query_term(struct query* q, const char* s, uint32_t len) {
+    for (unsigned i = 0; i < q->nterms; i++)
+        if (q->terms[i].len == len && memcmp(q->terms[i].str, s, len) == 0)
+            return (int)i;
+    if (q->nterms == MAX_QUERY_TERMS) {
+        q->error = 1;
+        return -1;
+    }
+    struct qterm *t = &q->terms[q->nterms];
+    memcpy(t->str, s, len);
+    t->len = len;
+    return (int)q->nterms++;
+}
+
+static void query_close_group(struct query* q) {
+    unsigned count = q->ntokens - q->group;
+    if (count >= 2) {
+        q->phrases[q->nphrases].first = (uint8_t)q->group;
+        q->phrases[q->nphrases].count = (uint8_t)count;
+        q->nphrases++;
+    } else {
+        q->ntokens = q->group;
+    }
+    q->group = q->ntokens;
+}
+
+static int query_token(const char* tok, size_t len, uint32_t pos, int joined, void* user) {
+    struct query *q = user;
+    (void)pos;
+    int t = query_term(q, tok, (uint32_t)len);
+    if (t < 0)
+        return 1;
+    if (!q->quoted && !joined)
+        query_close_group(q);
+    if (q->ntokens == MAX_PHRASE_TOKENS) {
+        q->error = 1;
+        return 1;
+    }
+    q->tokens[q->ntokens++] = (uint8_t)t;
+    return 0;
+}
+
+static int query_parse(struct query* q, const char* text, const char* network, const char* channel) {
+    memset(q, 0, sizeof(*q));
+    for (const char *p = text; p;) {
+        const char *quote = strchr(p, '"');
+        tokenize(p, quote ? (size_t)(quote - p) : strlen(p), query_token, q);
+        if (q->error)
+            return -1;
+        query_close_group(q);
+        q->quoted = !q->quoted;
+        p = quote ? quote + 1 : NULL;
+    }
+    char term[MAX_FIELD + 2];
+    if (channel && query_term(q, term, filter_term(term, TERM_CHANNEL, channel)) < 0)
+        return -1;
+    if (network && query_term(q, term, filter_term(term, TERM_NETWORK, network)) < 0)
+        return -1;
+    return q->nterms ? 0 : -1;
+}
+
+struct eval {
+    const struct query *q;
+    size_t limit;
+    long hits;
+    WINEB2B_search_cb cb;
+    void *user;
+    int stop;
+    struct cursor cur[MAX_QUERY_TERMS];
+    unsigned order[MAX_QUERY_TERMS];
+};
+
+static int sorted_contains(const uint32_t* a, uint32_t n, uint32_t v) {
+    uint32_t lo = 0, hi = n;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (a[mid] == v)
+            return 1;
+        if (a[mid] < v)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return 0;
+}
+
+/* Semua frasa muncul di dokumen tempat kursor berada */
+static int phrases_match(struct eval* e) {
+    const struct query *q = e->q;
+    for (unsigned f = 0; f < q->nphrases; f++) {
+        const uint8_t *tok = q->tokens + q->phrases[f].first;
+        unsigned count = q->phrases[f].count;
+        uint32_t n0;
+        const uint32_t *p0 = cursor_positions(&e->cur[tok[0]], &n0);
+        int found = 0;
+        for (uint32_t k = 0; k < n0 && !found; k++) {
+            found = 1;
+            for (unsigned j = 1; j < count && found; j++) {
+                uint32_t nj;
+                const uint32_t *pj = cursor_positions(&e->cur[tok[j]], &nj);
+                found = sorted_contains(pj, nj, p0[k] + j);
+            }
+        }
+        if (!found)
+            return 0;
+    }
+    return 1;
+}
+
+static void emit(struct eval* e, uint64_t id, const uint8_t* rec) {
+    const struct doc_rec *r = (const struct doc_rec*)rec;
+    const char *p = (const char*)(r + 1);
+    WINEB2B_search_hit hit;
+    hit.id = id;
+    hit.doc.timestamp = r->timestamp;
+    hit.doc.network = p;
+    p += r->network_len + 1;
+    hit.doc.channel = p;
+    p += r->channel_len + 1;
+    hit.doc.sender = p;
+    p += r->sender_len + 1;
+    hit.doc.text = p;
+    e->hits++;
+    if (e->cb && e->cb(&hit, e->user))
+        e->stop = 1;
+    if (e->limit && (size_t)e->hits >= e->limit)
+        e->stop = 1;
+}
+
+/* Irisan semua term di satu segmen/buffer, dari dokumen terbaru. Kursor
+   dengan df terkecil memimpin, yang lain melompat ke dokumennya */
+static void eval_source(struct eval* e, const struct seg* g, const struct builder* b) {
+    const struct query *q = e->q;
+    unsigned n = q->nterms;
+    for (unsigned i = 0; i < n; i++) {
+        const struct qterm *t = &q->terms[i];
+        if (g) {
+            const struct seg_term *st = seg_find(g, t->str, t->len);
+            if (!st)
+                return;
+            cursor_seg(&e->cur[i], g, st);
+        } else {
+            const struct mem_term *mt = builder_find(b, t->str, t->len);
+            if (!mt)
+                return;
+            cursor_mem(&e->cur[i], mt);
+        }
+        unsigned j = i;
+        for (; j > 0 && e->cur[e->order[j - 1]].df > e->cur[i].df; j--)
+            e->order[j] = e->order[j - 1];
+        e->order[j] = i;
+    }
+    uint64_t base = g ? g->h->base : b->base;
+    const uint8_t *blob = g ? g->blob : b->blob;
+    const uint64_t *offs = g ? g->offs : b->offs;
+    struct cursor *lead = &e->cur[e->order[0]];
+    uint32_t doc = cursor_seek(lead, NO_DOC);
+    while (doc != NO_DOC && !e->stop) {
+        uint32_t next = doc;
+        for (unsigned k = 1; k < n && next == doc; k++) {
+            next = cursor_seek(&e->cur[e->order[k]], doc);
+            if (next == NO_DOC)
+                return;
+        }
+        if (next < doc) {
+            doc = cursor_seek(lead, next);
+            continue;
+        }
+        if (!q->nphrases || phrases_match(e))
+            emit(e, base + doc, blob + offs[doc]);
+        if (doc == 0)
+            break;
+        doc = cursor_seek(lead, doc - 1);
+    }
+}
+
+/* --- Merge dan thread latar --- */
+
+/* Menggabungkan segmen bersebelahan menjadi satu segmen baru */
+static struct seg* merge_segments(WINEB2B_search* s, struct seg* const* run, size_t n, unsigned seq) {
+    struct writer w;
+    if (writer_open(&w, s->dir, seq, run[0]->h->base) != 0)
+        return NULL;
+    struct doc_part parts[n];
+    size_t head[n];
+    for (size_t i = 0; i < n; i++) {
+        parts[i].blob = run[i]->blob;
+        parts[i].offs = run[i]->offs;
+        parts[i].ndocs = run[i]->h->ndocs;
+        head[i] = 0;
+    }
+    writer_docs(&w, parts, n);
+    struct cursor *c = calloc(1, sizeof(*c));
+    if (!c) {
+        writer_abort(&w);
+        return NULL;
+    }
+    for (unsigned count = 0; !w.failed; count++) {
+        const char *min = NULL;
+        uint32_t min_len = 0;
+        for (size_t i = 0; i < n; i++) {
+            if (head[i] == run[i]->h->nterms)
+                continue;
+            const struct seg_term *t = &run[i]->terms[head[i]];
+            const char *str = run[i]->strings + t->str_off;
+            if (!min || term_cmp(str, t->len, min, min_len) < 0) {
+                min = str;
+                min_len = t->len;
+            }
+        }
+        if (!min)
+            break;
+        if ((count & 1023) == 0 && __atomic_load_n(&s->stop, __ATOMIC_RELAXED)) {
+            free(c->pos_buf);
+            free(c);
+            writer_abort(&w);
+            return NULL;
+        }
+        writer_term_begin(&w, min, min_len);
+        for (size_t i = 0; i < n; i++) {
+            if (head[i] == run[i]->h->nterms)
+                continue;
+            const struct seg_term *t = &run[i]->terms[head[i]];
+            if (term_cmp(run[i]->strings + t->str_off, t->len, min, min_len) != 0)
+                continue;
+            uint32_t shift = (uint32_t)(run[i]->h->base - run[0]->h->base);
+            cursor_seg(c, run[i], t);
+            for (uint32_t b = 0; b < c->nblocks && !w.failed; b++) {
+                decode_block(c, b);
+                decode_positions(c);
+                if (!c->pos) {
+                    w.failed = 1;
+                    break;
+                }
+                for (uint32_t j = 0; j < c->n; j++)
+                    writer_add(&w, c->docs[j] + shift, c->pos + c->begin[j], c->begin[j + 1] - c->begin[j]);
+            }
+            head[i]++;
+        }
+        writer_term_end(&w);
+    }
+    free(c->pos_buf);
+    free(c);
+    return writer_finish(&w, s->dir, seq);
+}
+
+/* Menulis daftar segmen ke MANIFEST secara atomik */
+static int write_manifest(const WINEB2B_search* s, struct seg* const* segs, size_t n) {
+    size_t len = strlen(s->dir) + 32;
+    char tmp[len], path[len];
+    snprintf(tmp, len, "%s/MANIFEST.tmp", s->dir);
+    snprintf(path, len, "%s/MANIFEST", s->dir);
+    FILE *f = fopen(tmp, "w");
+    if (!f) {
+        perror("fopen MANIFEST");
+        return -1;
+    }
+    for (size_t i = 0; i < n; i++)
+        fprintf(f, "%08u\n", segs[i]->seq);
+    if (fflush(f) != 0 || fsync(fileno(f)) != 0 || fclose(f) != 0 || rename(tmp, path) != 0) {
+        perror("MANIFEST");
+        unlink(tmp);
+        return -1;
+    }
+    return 0;
+}
+
+static int seg_level(const WINEB2B_search* s, uint32_t ndocs) {
+    uint64_t cap = (uint64_t)s->flush_docs * s->merge_factor;
+    int level = 0;
+    while (ndocs >= cap) {
+        cap *= s->merge_factor;
+        level++;
+    }
+    return level;
+}
+
+/* Mencari merge_factor segmen bersebelahan setingkat, tingkat terendah dulu.
+   Dipanggil dengan s->lock */
+static int merge_candidate(const WINEB2B_search* s, size_t* first) {
+    size_t m = s->merge_factor;
+    int best = -1;
+    for (size_t i = 0; i + m <= s->nsegs; i++) {
+        int level = seg_level(s, s->segs[i]->h->ndocs);
+        uint64_t docs = s->segs[i]->h->ndocs;
+        size_t j = 1;
+        for (; j < m && seg_level(s, s->segs[i + j]->h->ndocs) == level; j++)
+            docs += s->segs[i + j]->h->ndocs;
+        if (j == m && docs <= MAX_SEG_DOCS && (best < 0 || level < best)) {
+            best = level;
+            *first = i;
+        }
+    }
+    return best >= 0;
+}
+
+/* Dipanggil dengan s->lock. Mengganti segs[first, first+count) dengan g */
+static int install_segment(WINEB2B_search* s, size_t first, size_t count, struct seg* g) {
+    size_t n = s->nsegs - count + 1;
+    if (n > s->segs_cap) {
+        size_t cap = s->segs_cap ? s->segs_cap * 2 : 16;
+        struct seg **segs = realloc(s->segs, cap * sizeof(*segs));
+        if (!segs)
+            return -1;
+        s->segs = segs;
+        s->segs_cap = cap;
+    }
+    struct seg *next[n];
+    memcpy(next, s->segs, first * sizeof(*next));
+    next[first] = g;
+    memcpy(next + first + 1, s->segs + first + count, (s->nsegs - first - count) * sizeof(*next));
+    if (write_manifest(s, next, n) != 0)
+        return -1;
+    for (size_t i = first; i < first + count; i++) {
+        s->segs[i]->dead = 1;
+        seg_unref(s->segs[i]);
+    }
+    memcpy(s->segs, next, n * sizeof(*next));
+    s->nsegs = n;
+    return 0;
+}
+
+static void* worker_main(void* arg) {
+    WINEB2B_search *s = arg;
+    int merge_failed = 0;
+    size_t first = 0;
+    pthread_mutex_lock(&s->lock);
+    for (;;) {
+        while (!s->frozen && !s->stop && (merge_failed || !merge_candidate(s, &first)))
+            pthread_cond_wait(&s->wake, &s->lock);
+
+        if (s->frozen) {
+            struct builder *b = s->frozen;
+            unsigned seq = s->next_seq++;
+            pthread_mutex_unlock(&s->lock);
+            struct seg *g = write_builder(s->dir, seq, b);
+            pthread_mutex_lock(&s->lock);
+            if (g && install_segment(s, s->nsegs, 0, g) == 0) {
+                s->frozen = NULL;
+                builder_unref(b);
+                s->flush_failed = 0;
+                merge_failed = 0;
+            } else {
+                if (g) {
+                    g->dead = 1;
+                    seg_unref(g);
+                }
+                s->flush_failed = 1;
+                pthread_cond_broadcast(&s->done);
+                if (s->stop)
+                    break;
+                /* Dicoba lagi sedetik kemudian; buffer tetap bisa dicari */
+                struct timespec ts;
+                clock_gettime(CLOCK_REALTIME, &ts);
+                ts.tv_sec += 1;
+                pthread_cond_timedwait(&s->wake, &s->lock, &ts);
+            }
+            pthread_cond_broadcast(&s->done);
+            continue;
+        }
+        if (s->stop)
+            break;
+
+        size_t n = s->merge_factor;
+        struct seg *run[n];
+        for (size_t i = 0; i < n; i++) {
+            run[i] = s->segs[first + i];
+            run[i]->refs++;
+        }
+        unsigned seq = s->next_seq++;
+        pthread_mutex_unlock(&s->lock);
+        struct seg *g = merge_segments(s, run, n, seq);
+        pthread_mutex_lock(&s->lock);
+        /* Hanya thread ini yang mengubah daftar segmen, jadi first masih berlaku */
+        if (g && install_segment(s, first, n, g) == 0) {
+            s->merges++;
+        } else {
+            if (g) {
+                g->dead = 1;
+                seg_unref(g);
+            }
+            if (!s->stop) {
+                fprintf(stderr, "Error: merge segmen indeks gagal, dicoba lagi setelah flush berikutnya\n");
+                merge_failed = 1;
+            }
+        }
+        for (size_t i = 0; i < n; i++)
+            seg_unref(run[i]);
+    }
+    pthread_mutex_unlock(&s->lock);
+    return NULL;
+}
+
+/* --- API --- */
+
+static int seg_loaded(const WINEB2B_search* s, unsigned seq) {
+    for (size_t i = 0; i < s->nsegs; i++)
+        if (s->segs[i]->seq == seq)
+            return 1;
+    return 0;
+}
+
+/* Membaca MANIFEST lalu menghapus segmen/tmp sisa yang tidak terdaftar */
+static int load_segments(WINEB2B_search* s) {
+    size_t len = strlen(s->dir) + 32;
+    char path[len];
+    snprintf(path, len, "%s/MANIFEST", s->dir);
+    FILE *f = fopen(path, "r");
+    unsigned seq;
+    if (f) {
+        while (fscanf(f, "%u", &seq) == 1) {
+            struct seg *g = seg_open(s->dir, seq);
+            struct seg **segs = realloc(s->segs, (s->nsegs + 1) * sizeof(*segs));
+            if (segs)
+                s->segs = segs;
+            if (!g || !segs) {
+                seg_unref(g);
+                fclose(f);
+                return -1;
+            }
+            s->segs[s->nsegs++] = g;
+            s->segs_cap = s->nsegs;
+            if (s->nsegs > 1) {
+                const struct seg_header *prev = s->segs[s->nsegs - 2]->h;
+                if (g->h->base != prev->base + prev->ndocs) {
+                    fprintf(stderr, "Error: segmen %s tidak bersambung\n", g->path);
+                    fclose(f);
+                    return -1;
+                }
+            }
+            if (seq >= s->next_seq)
+                s->next_seq = seq + 1;
+        }
+        fclose(f);
+    }
+    DIR *d = opendir(s->dir);
+    if (!d)
+        return -1;
+    struct dirent *ent;
+    while ((ent = readdir(d)) != NULL) {
+        char ext[4];
+        if (sscanf(ent->d_name, "%8u.%3s", &seq, ext) != 2 || (strcmp(ext, "fts") && strcmp(ext, "tmp")))
+            continue;
+        if (seq >= s->next_seq)
+            s->next_seq = seq + 1;
+        if (!seg_loaded(s, seq) || strcmp(ext, "tmp") == 0) {
+            snprintf(path, len, "%s/%s", s->dir, ent->d_name);
+            unlink(path);
+        }
+    }
+    closedir(d);
+    return 0;
+}
+
+WINEB2B_search* WINEB2B_search_open(const char* dir, const WINEB2B_search_config* config) {
+    if (!dir)
+        return NULL;
+    if (mkdir(dir, 0755) != 0 && errno != EEXIST) {
+        perror("mkdir");
+        return NULL;
+    }
+    WINEB2B_search *s = calloc(1, sizeof(*s));
+    if (!s)
+        return NULL;
+    s->dir = strdup(dir);
+    s->flush_docs = config && config->flush_docs ? config->flush_docs : DEFAULT_FLUSH;
+    s->merge_factor = config && config->merge_factor ? config->merge_factor : DEFAULT_MERGE;
+    if (s->merge_factor < 2)
+        s->merge_factor = 2;
+    pthread_rwlock_init(&s->active_lock, NULL);
+    pthread_mutex_init(&s->lock, NULL);
+    pthread_cond_init(&s->wake, NULL);
+    pthread_cond_init(&s->done, NULL);
+
+    uint64_t base = 0;
+    if (!s->dir || load_segments(s) != 0)
+        goto fail;
+    if (s->nsegs)
+        base = s->segs[s->nsegs - 1]->h->base + s->segs[s->nsegs - 1]->h->ndocs;
+    s->active = builder_new(base);
+    if (!s->active)
+        goto fail;
+    if (pthread_create(&s->worker, NULL, worker_main, s) != 0) {
+        fprintf(stderr, "Error: gagal membuat thread indeks\n");
+        goto fail;
+    }
+    return s;
+
+fail:
+    for (size_t i = 0; i < s->nsegs; i++)
+        seg_unref(s->segs[i]);
+    free(s->segs);
+    builder_free(s->active);
+    pthread_rwlock_destroy(&s->active_lock);
+    pthread_mutex_destroy(&s->lock);
+    pthread_cond_destroy(&s->wake);
+    pthread_cond_destroy(&s->done);
+    free(s->dir);
+    free(s);
+    return NULL;
+}
+
+/* Menyerahkan buffer aktif ke thread latar. Dipanggil dengan active_lock (tulis) */
+static int freeze(WINEB2B_search* s) {
+    struct builder *next = builder_new(s->active->base + s->active->ndocs);
+    if (!next)
+        return -1;
+    pthread_mutex_lock(&s->lock);
+    while (s->frozen && !s->flush_failed)
+        pthread_cond_wait(&s->done, &s->lock);
+    if (s->frozen) {
+        /* Penulisan gagal: buffer aktif terus tumbuh sampai disk pulih */
+        pthread_mutex_unlock(&s->lock);
+        builder_free(next);
+        return -1;
+    }
+    s->frozen = s->active;
+    s->active = next;
+    pthread_cond_signal(&s->wake);
+    pthread_mutex_unlock(&s->lock);
+    return 0;
+}
+
+int64_t WINEB2B_search_add(WINEB2B_search* s, const WINEB2B_search_doc* doc) {
+    if (!s || !doc || !doc->channel || !doc->text)
+        return -1;
+    pthread_rwlock_wrlock(&s->active_lock);
+    int64_t id = builder_add(s->active, doc);
+    if (id >= 0)
+        id += (int64_t)s->active->base;
+    if (s->active->ndocs >= s->flush_docs)
+        freeze(s);
+    pthread_rwlock_unlock(&s->active_lock);
+    return id;
+}
+
+int WINEB2B_search_commit(WINEB2B_search* s) {
+    if (!s)
+        return -1;
+    int ret = 0;
+    pthread_rwlock_wrlock(&s->active_lock);
+    if (s->active->ndocs && freeze(s) != 0)
+        ret = -1;
+    pthread_rwlock_unlock(&s->active_lock);
+    pthread_mutex_lock(&s->lock);
+    while (s->frozen && !s->flush_failed)
+        pthread_cond_wait(&s->done, &s->lock);
+    if (s->frozen)
+        ret = -1;
+    pthread_mutex_unlock(&s->lock);
+    return ret;
+}
+
+long WINEB2B_search_query(WINEB2B_search* s, const char* query, const char* network, const char* channel,
+                          size_t limit, WINEB2B_search_cb cb, void* user) {
+    struct query q;
+    if (!s || query_parse(&q, query, network, channel) != 0)
+        return -1;
+    struct eval *e = calloc(1, sizeof(*e));
+    if (!e)
+        return -1;
+    e->q = &q;
+    e->limit = limit;
+    e->cb = cb;
+    e->user = user;
+
+    /* Buffer aktif dibaca di bawah active_lock; snapshot segmen diambil
+       sebelum lock dilepas supaya buffer yang dibekukan tidak terbaca dua kali */
+    pthread_rwlock_rdlock(&s->active_lock);
+    if (s->active->ndocs)
+        eval_source(e, NULL, s->active);
+    pthread_mutex_lock(&s->lock);
+    struct builder *frozen = s->frozen;
+    if (frozen)
+        frozen->refs++;
+    size_t n = s->nsegs;
+    struct seg **snap = n ? malloc(n * sizeof(*snap)) : NULL;
+    if (snap) {
+        memcpy(snap, s->segs, n * sizeof(*snap));
+        for (size_t i = 0; i < n; i++)
+            snap[i]->refs++;
+    } else {
+        n = 0;
+    }
+    pthread_mutex_unlock(&s->lock);
+    pthread_rwlock_unlock(&s->active_lock);
+
+    if (frozen && !e->stop)
+        eval_source(e, NULL, frozen);
+    for (size_t i = n; i-- > 0 && !e->stop;)
+        eval_source(e, snap[i], NULL);
+
+    pthread_mutex_lock(&s->lock);
+    builder_unref(frozen);
+    for (size_t i = 0; i < n; i++)
+        seg_unref(snap[i]);
+    pthread_mutex_unlock(&s->lock);
+    free(snap);
+    long hits = e->hits;
+    for (unsigned i = 0; i < MAX_QUERY_TERMS; i++)
+        free(e->cur[i].pos_buf);
+    free(e);
+    return hits;
+}
+
+void WINEB2B_search_get_stats(WINEB2B_search* s, WINEB2B_search_stats* out) {
+    if (!out)
+        return;
+    memset(out, 0, sizeof(*out));
+    if (!s)
+        return;
+    pthread_rwlock_rdlock(&s->active_lock);
+    pthread_mutex_lock(&s->lock);
+    for (size_t i = 0; i < s->nsegs; i++) {
+        const struct seg_header *h = s->segs[i]->h;
+        out->docs += h->ndocs;
+        out->terms += h->nterms;
+        out->postings_bytes += h->skips_off - h->postings_off;
+        out->disk_bytes += h->size;
+    }
+    out->segments = s->nsegs;
+    out->buffered = s->active->ndocs + (s->frozen ? s->frozen->ndocs : 0);
+    out->docs += out->buffered;
+    out->merges = s->merges;
+    pthread_mutex_unlock(&s->lock);
+    pthread_rwlock_unlock(&s->active_lock);
+}
+
+void WINEB2B_search_close(WINEB2B_search* s) {
+    if (!s)
+        return;
+    if (WINEB2B_search_commit(s) != 0)
+        fprintf(stderr, "Error: pesan di buffer indeks tidak tersimpan\n");
+    pthread_mutex_lock(&s->lock);
+    __atomic_store_n(&s->stop, 1, __ATOMIC_RELAXED);
+    pthread_cond_broadcast(&s->wake);
+    pthread_mutex_unlock(&s->lock);
+    pthread_join(s->worker, NULL);
+    for (size_t i = 0; i < s->nsegs; i++)
+        seg_unref(s->segs[i]);
+    free(s->segs);
+    builder_free(s->frozen);
+    builder_free(s->active);
+    pthread_rwlock_destroy(&s->active_lock);
+    pthread_mutex_destroy(&s->lock);
+    pthread_cond_destroy(&s->wake);
+    pthread_cond_destroy(&s->done);
+    free(s->dir);
+    free(s);
+}
@@ -0,0 +1,1686 @@
+#define _GNU_SOURCE
+#include "shard.h"
+#include "log.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <openssl/crypto.h>
+#include <openssl/evp.h>
+#include <openssl/hmac.h>
+#include <openssl/rand.h>
+
+#define DEFAULT_VNODES      64
+#define DEFAULT_TIMEOUT_MS  3000
+#define HEARTBEAT_MS        500
+#define CUT_WAIT_MS         2000
+#define RECENT_MAX          1024
+#define RECENT_KEY_MAX      63
+#define ID_MAX              63
+#define FRAME_MAX           (16 * 1024 * 1024)
+#define NONCE_LEN           16
+#define NONCE_HEX           (NONCE_LEN * 2)
+#define MAC_HEX             64
+
+static long now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000L + ts.tv_nsec / 1000000;
+}
+
+/* FNV-1a 64 bit, diakhiri finalizer splitmix64 supaya titik vnode tersebar rata */
+static uint64_t fnv(uint64_t h, const void* data, size_t len) {
+    const unsigned char *p = data;
+    for (size_t i = 0; i < len; i++)
+        h = (h ^ p[i]) * 1099511628211ull;
+    return h;
+}
+
+static uint64_t mix(uint64_t h) {
+    h ^= h >> 30;
+    h *= 0xbf58476d1ce4e5b9ull;
+    h ^= h >> 27;
+    h *= 0x94d049bb133111ebull;
+    return h ^ (h >> 31);
+}
+
+static uint64_t route_hash(const char* network, const char* channel) {
+    uint64_t h = fnv(14695981039346656037ull, network, strlen(network) + 1);
+    return mix(fnv(h, channel, strlen(channel)));
+}
+
+/* Token protokol: tidak kosong, tanpa spasi dan kontrol */
+static int valid_token(const char* s) {
+    if (!s || !*s || strlen(s) > 1024)
+        return 0;
+    for (; *s; s++)
+        if ((unsigned char)*s <= ' ')
+            return 0;
+    return 1;
+}
+
+/* --- Ring --- */
+
+struct point {
+    uint64_t hash;
+    uint32_t shard;
+};
+
+struct _WINEB2B_ring {
+    char **ids;
+    int *vnodes;
+    size_t n, cap;
+    struct point *points;
+    size_t npoints;
+};
+
+static const WINEB2B_ring *sort_ring;
+
+static int point_cmp(const void* a, const void* b) {
+    const struct point *x = a, *y = b;
+    if (x->hash != y->hash)
+        return x->hash < y->hash ? -1 : 1;
+    /* Tabrakan hash: urutan tetap sama di semua proses */
+    return strcmp(sort_ring->ids[x->shard], sort_ring->ids[y->shard]);
+}
+
+static int ring_rebuild(WINEB2B_ring* ring) {
+    size_t total = 0;
+    for (size_t i = 0; i < ring->n; i++)
+        total += (size_t)ring->vnodes[i];
+    struct point *points = total ? malloc(total * sizeof(struct point)) : NULL;
+    if (total && !points)
+        return -1;
+    size_t k = 0;
+    for (size_t i = 0; i < ring->n; i++) {
+        char name[ID_MAX + 16];
+        for (int v = 0; v < ring->vnodes[i]; v++) {
+            int len = snprintf(name, sizeof(name), "%s#%d", ring->ids[i], v);
+            points[k].hash = mix(fnv(14695981039346656037ull, name, (size_t)len));
+            points[k++].shard = (uint32_t)i;
+        }
+    }
+    if (total) {
+        sort_ring = ring;
+        qsort(points, total, sizeof(struct point), point_cmp);
+    }
+    free(ring->points);
+    ring->points = points;
+    ring->npoints = total;
+    return 0;
+}
+
+WINEB2B_ring* WINEB2B_ring_create(void) {
+    return calloc(1, sizeof(WINEB2B_ring));
+}
+
+int WINEB2B_ring_add(WINEB2B_ring* ring, const char* id, int vnodes) {
+    if (!ring || !valid_token(id) || strlen(id) > ID_MAX)
+        return -1;
+    for (size_t i = 0; i < ring->n; i++)
+        if (strcmp(ring->ids[i], id) == 0)
+            return -1;
+    if (ring->n == ring->cap) {
+        size_t cap = ring->cap ? ring->cap * 2 : 8;
+        char **ids = realloc(ring->ids, cap * sizeof(char*));
+        if (!ids)
+            return -1;
+        ring->ids = ids;
+        int *v = realloc(ring->vnodes, cap * sizeof(int));
+        if (!v)
+            return -1;
+        ring->vnodes = v;
+        ring->cap = cap;
+    }
+    ring->ids[ring->n] = strdup(id);
+    if (!ring->ids[ring->n])
+        return -1;
+    ring->vnodes[ring->n++] = vnodes > 0 ? vnodes : DEFAULT_VNODES;
+    if (ring_rebuild(ring) != 0) {
+        free(ring->ids[--ring->n]);
+        return -1;
+    }
+    return 0;
+}
+
+int WINEB2B_ring_remove(WINEB2B_ring* ring, const char* id) {
+    if (!ring || !id)
+        return -1;
+    for (size_t i = 0; i < ring->n; i++) {
+        if (strcmp(ring->ids[i], id) != 0)
+            continue;
+        free(ring->ids[i]);
+        memmove(&ring->ids[i], &ring->ids[i + 1], (ring->n - i - 1) * sizeof(char*));
+        memmove(&ring->vnodes[i], &ring->vnodes[i + 1], (ring->n - i - 1) * sizeof(int));
+        ring->n--;
+        return ring_rebuild(ring);
+    }
+    return -1;
+}
+
+const char* WINEB2B_ring_owner(const WINEB2B_ring* ring, const char* network, const char* channel) {
+    if (!ring || !ring->npoints || !network || !channel)
+        return NULL;
+    uint64_t h = route_hash(network, channel);
+    /* Titik pertama dengan hash >= h, memutar ke titik pertama */
+    size_t lo = 0, hi = ring->npoints;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (ring->points[mid].hash < h)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    if (lo == ring->npoints)
+        lo = 0;
+    return ring->ids[ring->points[lo].shard];
+}
+
+static int ring_has(const WINEB2B_ring* ring, const char* id) {
+    for (size_t i = 0; ring && i < ring->n; i++)
+        if (strcmp(ring->ids[i], id) == 0)
+            return 1;
+    return 0;
+}
+
+size_t WINEB2B_ring_size(const WINEB2B_ring* ring) {
+    return ring ? ring->n : 0;
+}
+
+void WINEB2B_ring_free(WINEB2B_ring* ring) {
+    if (!ring)
+        return;
+    for (size_t i = 0; i < ring->n; i++)
+        free(ring->ids[i]);
+    free(ring->ids);
+    free(ring->vnodes);
+    free(ring->points);
+    free(ring);
+}
+
+/* --- Koneksi: frame baris, FWD diikuti payload biner ---
+
+   Anggota -> koordinator:
+     HELLO <id> <vnodes> [<nonce> <mac>]     READY <epoch>       PING        BYE
+     FWD <network> <channel> <key|-> <len>\n<data>
+     DONE <network> <channel> <key|->   (pemilik lama selesai, key terakhir yang dikirimnya)
+   Koordinator -> anggota:
+     AUTH <nonce>       WELCOME <mac>       (hanya dengan shared secret)
+     VIEW <epoch> <n> <id> <vnodes> ...      COMMIT <epoch>
+     FWD dan DONE (dirutekan ke pemilik route)       GONE <id>       ERR <alasan>
+
+   Dengan shared secret koordinator mengirim AUTH begitu koneksi diterima.
+   HELLO membawa nonce anggota dan HMAC-SHA256(secret, "member|nonce
+   koordinator|nonce anggota|id"); koordinator membalas WELCOME dengan
+   HMAC "coord|..." yang sama sebelum frame lain, jadi kedua pihak
+   membuktikan tahu secret dan balasan lama tidak bisa diputar ulang */
+
+struct conn {
+    int fd;
+    char *in;
+    size_t in_len, in_off, in_cap;
+    char *out;
+    size_t out_len, out_off, out_cap;
+    long last_in_ms;
+};
+
+static void conn_close(struct conn* c) {
+    if (c->fd >= 0)
+        close(c->fd);
+    c->fd = -1;
+    free(c->in);
+    free(c->out);
+    c->in = c->out = NULL;
+    c->in_len = c->in_off = c->in_cap = c->out_len = c->out_off = c->out_cap = 0;
+}
+
+static int conn_flush(struct conn* c) {
+    while (c->out_off < c->out_len) {
+        ssize_t n = send(c->fd, c->out + c->out_off, c->out_len - c->out_off, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                return 0;
+            return -1;
+        }
+        c->out_off += (size_t)n;
+    }
+    c->out_off = c->out_len = 0;
+    return 0;
+}
+
+static int conn_append(struct conn* c, const void* data, size_t len) {
+    if (c->out_off > 0 && c->out_off == c->out_len)
+        c->out_off = c->out_len = 0;
+    if (c->out_len + len > c->out_cap) {
+        if (c->out_off > 0) {
+            memmove(c->out, c->out + c->out_off, c->out_len - c->out_off);
+            c->out_len -= c->out_off;
+            c->out_off = 0;
+        }
+        size_t cap = c->out_cap ? c->out_cap : 4096;
+        while (c->out_len + len > cap)
+            cap *= 2;
+        if (cap != c->out_cap) {
+            char *out = realloc(c->out, cap);
+            if (!out)
+                return -1;
+            c->out = out;
+            c->out_cap = cap;
+        }
+    }
+    memcpy(c->out + c->out_len, data, len);
+    c->out_len += len;
+    return 0;
+}
+
+static int conn_printf(struct conn* c, const char* fmt, ...) __attribute__((format(printf, 2, 3)));
+static int conn_printf(struct conn* c, const char* fmt, ...) {
+    char buf[512];
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(buf, sizeof(buf), fmt, ap);
+    va_end(ap);
+    if (n < 0 || n >= (int)sizeof(buf))
+        return -1;
+    return conn_append(c, buf, (size_t)n);
+}
+
+static int conn_fwd(struct conn* c, const char* network, const char* channel, const char* key,
+                    const void* data, size_t len) {
+    if (conn_printf(c, "FWD %s %s %s %zu\n", network, channel, key ? key : "-", len) != 0)
+        return -1;
+    return len ? conn_append(c, data, len) : 0;
+}
+
+/* DONE dengan daftar key dipisah spasi. from hanya dari koordinator */
+static int conn_done(struct conn* c, const char* network, const char* channel, const char* from,
+                     const char* wait, const char* keys, size_t klen) {
+    if (conn_printf(c, "DONE %s %s %s%s%s %zu\n", network, channel, from ? from : "", from ? " " : "",
+                    wait && wait[0] ? wait : "-", klen) != 0)
+        return -1;
+    return klen ? conn_append(c, keys, klen) : 0;
+}
+
+/* Membaca semua data yang tersedia. -1 jika koneksi putus */
+static int conn_read(struct conn* c) {
+    for (;;) {
+        if (c->in_off > 0 && c->in_off == c->in_len)
+            c->in_off = c->in_len = 0;
+        if (c->in_cap - c->in_len < 4096) {
+            if (c->in_off > 0) {
+                memmove(c->in, c->in + c->in_off, c->in_len - c->in_off);
+                c->in_len -= c->in_off;
+                c->in_off = 0;
+            }
+            if (c->in_cap - c->in_len < 4096) {
+                size_t cap = c->in_cap ? c->in_cap * 2 : 16384;
+                char *in = realloc(c->in, cap);
+                if (!in)
+                    return -1;
+                c->in = in;
+                c->in_cap = cap;
+            }
+        }
+        ssize_t n = recv(c->fd, c->in + c->in_len, c->in_cap - c->in_len, 0);
+        if (n > 0) {
+            c->in_len += (size_t)n;
+            c->last_in_ms = now_ms();
+            continue;
+        }
+        if (n == 0)
+            return -1;
+        if (errno == EINTR)
+            continue;
+        return errno == EAGAIN || errno == EWOULDBLOCK ? 0 : -1;
+    }
+}
+
+/* Frame lengkap berikutnya. line sudah diakhiri '\0'; payload hanya untuk FWD
+   dan DONE (panjangnya kata terakhir baris).
+   0 jika belum lengkap, -1 jika frame tidak valid */
+static int conn_frame(struct conn* c, char** line, const char** payload, size_t* plen) {
+    char *start = c->in + c->in_off;
+    size_t avail = c->in_len - c->in_off;
+    char *nl = avail ? memchr(start, '\n', avail) : NULL;
+    if (!nl)
+        return avail > FRAME_MAX ? -1 : 0;
+    size_t size = (size_t)(nl - start) + 1;
+    *payload = NULL;
+    *plen = 0;
+    if ((avail >= 4 && memcmp(start, "FWD ", 4) == 0) || (avail >= 5 && memcmp(start, "DONE ", 5) == 0)) {
+        const char *p = nl;
+        while (p > start && p[-1] != ' ')
+            p--;
+        char *end;
+        unsigned long len = strtoul(p, &end, 10);
+        if (end != nl || len > FRAME_MAX)
+            return -1;
+        if (avail - size < len)
+            return 0;
+        *payload = nl + 1;
+        *plen = len;
+        size += len;
+    }
+    *nl = '\0';
+    *line = start;
+    c->in_off += size;
+    return 1;
+}
+
+static int set_nonblock(int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    return flags < 0 ? -1 : fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+}
+
+/* "unix:/path" atau "tcp:host:port" ke sockaddr */
+static int parse_address(const char* address, struct sockaddr_storage* ss, socklen_t* len, int* family) {
+    memset(ss, 0, sizeof(*ss));
+    if (strncmp(address, "unix:", 5) == 0) {
+        struct sockaddr_un *un = (struct sockaddr_un*)ss;
+        if (strlen(address + 5) == 0 || strlen(address + 5) >= sizeof(un->sun_path))
+            return -1;
+        un->sun_family = AF_UNIX;
+        strcpy(un->sun_path, address + 5);
+        *len = sizeof(struct sockaddr_un);
+        *family = AF_UNIX;
+        return 0;
+    }
+    if (strncmp(address, "tcp:", 4) != 0)
+        return -1;
+    char host[WINEB2B_SHARD_ADDR_MAX];
+    snprintf(host, sizeof(host), "%s", address + 4);
+    char *colon = strrchr(host, ':');
+    if (!colon)
+        return -1;
+    *colon = '\0';
+    struct addrinfo hints = { 0 }, *res;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_NUMERICSERV;
+    if (getaddrinfo(host[0] ? host : NULL, colon + 1, &hints, &res) != 0)
+        return -1;
+    memcpy(ss, res->ai_addr, res->ai_addrlen);
+    *len = res->ai_addrlen;
+    *family = res->ai_family;
+    freeaddrinfo(res);
+    return 0;
+}
+
+/* Socket unix hanya menerima proses dengan uid yang sama */
+static int same_user(int fd) {
+    struct ucred cred;
+    socklen_t len = sizeof(cred);
+    if (getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &cred, &len) != 0 || cred.uid != geteuid()) {
+        fprintf(stderr, "Error: koneksi shard dari uid berbeda ditolak\n");
+        return 0;
+    }
+    return 1;
+}
+
+static void to_hex(const unsigned char* data, size_t len, char* out) {
+    static const char digits[] = "0123456789abcdef";
+    for (size_t i = 0; i < len; i++) {
+        out[i * 2] = digits[data[i] >> 4];
+        out[i * 2 + 1] = digits[data[i] & 15];
+    }
+    out[len * 2] = '\0';
+}
+
+static int make_nonce(char out[NONCE_HEX + 1]) {
+    unsigned char raw[NONCE_LEN];
+    if (RAND_bytes(raw, sizeof(raw)) != 1)
+        return -1;
+    to_hex(raw, sizeof(raw), out);
+    return 0;
+}
+
+/* HMAC-SHA256(secret, "<role>|<nonce koordinator>|<nonce anggota>|<id>") dalam hex */
+static void auth_mac(const char* secret, const char* role, const char* coord_nonce,
+                     const char* member_nonce, const char* id, char out[MAC_HEX + 1]) {
+    char msg[256];
+    int n = snprintf(msg, sizeof(msg), "%s|%s|%s|%s", role, coord_nonce, member_nonce, id);
+    unsigned char md[EVP_MAX_MD_SIZE];
+    unsigned int md_len = 0;
+    HMAC(EVP_sha256(), secret, (int)strlen(secret), (const unsigned char*)msg, (size_t)n, md, &md_len);
+    to_hex(md, md_len, out);
+}
+
+static int mac_equal(const char* a, const char* b) {
+    return a && strlen(a) == MAC_HEX && CRYPTO_memcmp(a, b, MAC_HEX) == 0;
+}
+
+static void secret_free(char* secret) {
+    if (!secret)
+        return;
+    OPENSSL_cleanse(secret, strlen(secret));
+    free(secret);
+}
+
+/* --- Koordinator --- */
+
+struct member {
+    struct conn c;
+    char id[ID_MAX + 1];            /* Kosong sebelum HELLO */
+    char nonce[NONCE_HEX + 1];      /* Nonce AUTH, kosong tanpa secret */
+    int vnodes;
+    int leaving;                    /* BYE diterima: keluar dari ring, tetap terhubung sampai selesai menyerahkan route */
+    int closing;                    /* Ditutup setelah output terkirim */
+    uint64_t ready;
+};
+
+struct _WINEB2B_shard_coord {
+    int lfd;
+    char address[WINEB2B_SHARD_ADDR_MAX];
+    char *unix_path;
+    char *secret;                   /* NULL: tanpa autentikasi (hanya unix) */
+    int timeout_ms;
+    struct member **members;
+    size_t n, cap;
+    WINEB2B_ring *ring;             /* Ring view terakhir, dipakai merutekan FWD */
+    char *view, *committed_view;    /* Baris VIEW terakhir dan yang terakhir COMMIT */
+    int dirty;                      /* Keanggotaan berubah, perlu view baru */
+    long view_ms;
+    WINEB2B_shard_coord_stats stats;
+};
+
+WINEB2B_shard_coord* WINEB2B_shard_coord_create(const char* address, int timeout_ms, const char* secret) {
+    struct sockaddr_storage ss;
+    socklen_t len;
+    int family;
+    if (!address || parse_address(address, &ss, &len, &family) != 0) {
+        fprintf(stderr, "Alamat koordinator tidak valid: %s\n", address ? address : "(null)");
+        return NULL;
+    }
+    if (secret && !*secret)
+        secret = NULL;
+    if (family != AF_UNIX && !secret) {
+        fprintf(stderr, "Error: koordinator shard %s butuh shared secret\n", address);
+        return NULL;
+    }
+    WINEB2B_shard_coord *coord = calloc(1, sizeof(WINEB2B_shard_coord));
+    if (!coord)
+        return NULL;
+    coord->lfd = -1;
+    coord->timeout_ms = timeout_ms > 0 ? timeout_ms : DEFAULT_TIMEOUT_MS;
+    coord->ring = WINEB2B_ring_create();
+    coord->secret = secret ? strdup(secret) : NULL;
+    coord->lfd = socket(family, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (!coord->ring || (secret && !coord->secret) || coord->lfd < 0) {
+        WINEB2B_shard_coord_free(coord);
+        return NULL;
+    }
+    if (family == AF_UNIX) {
+        coord->unix_path = strdup(((struct sockaddr_un*)&ss)->sun_path);
+        unlink(coord->unix_path);
+    } else {
+        int one = 1;
+        setsockopt(coord->lfd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    }
+    if (bind(coord->lfd, (struct sockaddr*)&ss, len) != 0 || listen(coord->lfd, 64) != 0 ||
+        set_nonblock(coord->lfd) != 0) {
+        fprintf(stderr, "Koordinator shard gagal listen di %s: %s\n", address, strerror(errno));
+        WINEB2B_shard_coord_free(coord);
+        return NULL;
+    }
+    snprintf(coord->address, sizeof(coord->address), "%s", address);
+    if (family != AF_UNIX) {
+        /* Port 0: tulis ulang alamat dengan port yang dipilih kernel */
+        struct sockaddr_storage bound;
+        socklen_t blen = sizeof(bound);
+        getsockname(coord->lfd, (struct sockaddr*)&bound, &blen);
+        int port = ntohs(family == AF_INET6 ? ((struct sockaddr_in6*)&bound)->sin6_port
+                                            : ((struct sockaddr_in*)&bound)->sin_port);
+        char *colon = strrchr(coord->address, ':');
+        snprintf(colon + 1, sizeof(coord->address) - (size_t)(colon + 1 - coord->address), "%d", port);
+    }
+    return coord;
+}
+
+const char* WINEB2B_shard_coord_address(const WINEB2B_shard_coord* coord) {
+    return coord ? coord->address : NULL;
+}
+
+static struct member* coord_find(WINEB2B_shard_coord* coord, const char* id) {
+    for (size_t i = 0; i < coord->n; i++)
+        if (!coord->members[i]->closing && strcmp(coord->members[i]->id, id) == 0)
+            return coord->members[i];
+    return NULL;
+}
+
+/* Anggota mati atau melanggar protokol: keluar dari ring tanpa penyerahan */
+static void coord_drop(WINEB2B_shard_coord* coord, struct member* m, const char* reason) {
+    if (m->closing)
+        return;
+    m->closing = 1;
+    m->c.out_len = m->c.out_off = 0;
+    if (!m->id[0])
+        return;
+    if (!m->leaving) {
+        WINEB2B_LOG_WARN("shard", "event=member_lost id=%s reason=%s", m->id, reason);
+        coord->stats.failures++;
+        coord->dirty = 1;
+    }
+    /* Anggota yang menunggu DONE darinya tidak perlu menunggu lagi */
+    for (size_t i = 0; i < coord->n; i++) {
+        struct member *o = coord->members[i];
+        if (o->id[0] && !o->closing)
+            conn_printf(&o->c, "GONE %s\n", m->id);
+    }
+}
+
+/* Mengirim VIEW epoch baru ke semua anggota, termasuk yang sedang keluar */
+static void coord_new_view(WINEB2B_shard_coord* coord) {
+    WINEB2B_ring *ring = WINEB2B_ring_create();
+    if (!ring)
+        return;
+    size_t count = 0, size = 64;
+    for (size_t i = 0; i < coord->n; i++) {
+        struct member *m = coord->members[i];
+        if (m->id[0] && !m->leaving && !m->closing) {
+            WINEB2B_ring_add(ring, m->id, m->vnodes);
+            count++;
+            size += strlen(m->id) + 16;
+        }
+    }
+    char *line = malloc(size);
+    if (!line) {
+        WINEB2B_ring_free(ring);
+        return;
+    }
+    WINEB2B_ring_free(coord->ring);
+    coord->ring = ring;
+    coord->dirty = 0;
+    coord->stats.epoch++;
+    coord->stats.members = count;
+    coord->view_ms = now_ms();
+    size_t len = (size_t)snprintf(line, size, "VIEW %llu %zu", (unsigned long long)coord->stats.epoch, count);
+    for (size_t i = 0; i < coord->n; i++) {
+        struct member *m = coord->members[i];
+        if (m->id[0] && !m->leaving && !m->closing)
+            len += (size_t)snprintf(line + len, size - len, " %s %d", m->id, m->vnodes);
+    }
+    line[len++] = '\n';
+    for (size_t i = 0; i < coord->n; i++) {
+        struct member *m = coord->members[i];
+        if (m->id[0] && !m->closing)
+            conn_append(&m->c, line, len);
+    }
+    line[len] = '\0';
+    if (coord->view != coord->committed_view)
+        free(coord->view);
+    coord->view = line;
+    WINEB2B_LOG_INFO("shard", "event=view epoch=%llu members=%zu", (unsigned long long)coord->stats.epoch, count);
+}
+
+/* COMMIT setelah semua anggota READY untuk epoch terakhir */
+static void coord_try_commit(WINEB2B_shard_coord* coord) {
+    if (coord->stats.committed == coord->stats.epoch)
+        return;
+    for (size_t i = 0; i < coord->n; i++) {
+        struct member *m = coord->members[i];
+        if (m->id[0] && !m->closing && m->ready != coord->stats.epoch)
+            return;
+    }
+    coord->stats.committed = coord->stats.epoch;
+    if (coord->committed_view != coord->view)
+        free(coord->committed_view);
+    coord->committed_view = coord->view;
+    uint64_t ms = (uint64_t)(now_ms() - coord->view_ms);
+    if (ms > coord->stats.max_commit_ms)
+        coord->stats.max_commit_ms = ms;
+    for (size_t i = 0; i < coord->n; i++) {
+        struct member *m = coord->members[i];
+        if (!m->id[0] || m->closing)
+            continue;
+        conn_printf(&m->c, "COMMIT %llu\n", (unsigned long long)coord->stats.epoch);
+    }
+    WINEB2B_LOG_INFO("shard", "event=commit epoch=%llu ms=%llu", (unsigned long long)coord->stats.epoch,
+                     (unsigned long long)ms);
+}
+
+static void coord_frame(WINEB2B_shard_coord* coord, struct member* m, char* line,
+                        const char* payload, size_t plen) {
+    char *save = NULL, *cmd = strtok_r(line, " ", &save);
+    if (!cmd)
+        return;
+    if (strcmp(cmd, "HELLO") == 0) {
+        char *id = strtok_r(NULL, " ", &save), *vnodes = strtok_r(NULL, " ", &save);
+        char *nonce = strtok_r(NULL, " ", &save), *mac = strtok_r(NULL, " ", &save);
+        if (m->id[0] || !valid_token(id) || strlen(id) > ID_MAX) {
+            conn_printf(&m->c, "ERR invalid hello\n");
+            coord_drop(coord, m, "invalid_hello");
+            return;
+        }
+        char expect[MAC_HEX + 1];
+        if (coord->secret) {
+            int ok = valid_token(nonce) && strlen(nonce) <= NONCE_HEX * 2;
+            if (ok) {
+                auth_mac(coord->secret, "member", m->nonce, nonce, id, expect);
+                ok = mac_equal(mac, expect);
+            }
+            if (!ok) {
+                WINEB2B_LOG_WARN("shard", "event=auth_failed id=%s", id);
+                conn_printf(&m->c, "ERR auth failed\n");
+                m->closing = 1;
+                return;
+            }
+        }
+        if (coord_find(coord, id)) {
+            conn_printf(&m->c, "ERR duplicate id\n");
+            m->closing = 1;
+            return;
+        }
+        snprintf(m->id, sizeof(m->id), "%s", id);
+        m->vnodes = vnodes && atoi(vnodes) > 0 ? atoi(vnodes) : DEFAULT_VNODES;
+        if (coord->secret) {
+            auth_mac(coord->secret, "coord", m->nonce, nonce, id, expect);
+            conn_printf(&m->c, "WELCOME %s\n", expect);
+        }
+        /* Ring yang sedang berlaku: anggota baru perlu tahu pemilik lama
+           setiap route untuk menunggu DONE-nya */
+        if (coord->committed_view) {
+            conn_append(&m->c, coord->committed_view, strlen(coord->committed_view));
+            conn_printf(&m->c, "COMMIT %llu\n", (unsigned long long)coord->stats.committed);
+        }
+        coord->stats.joins++;
+        coord->dirty = 1;
+        WINEB2B_LOG_INFO("shard", "event=member_join id=%s vnodes=%d", m->id, m->vnodes);
+    } else if (!m->id[0]) {
+        coord_drop(coord, m, "no_hello");
+    } else if (strcmp(cmd, "READY") == 0) {
+        char *epoch = strtok_r(NULL, " ", &save);
+        if (epoch)
+            m->ready = strtoull(epoch, NULL, 10);
+    } else if (strcmp(cmd, "BYE") == 0) {
+        if (!m->leaving) {
+            m->leaving = 1;
+            coord->stats.leaves++;
+            coord->dirty = 1;
+            WINEB2B_LOG_INFO("shard", "event=member_leave id=%s", m->id);
+        }
+    } else if (strcmp(cmd, "FWD") == 0 || strcmp(cmd, "DONE") == 0) {
+        char *net = strtok_r(NULL, " ", &save), *chan = strtok_r(NULL, " ", &save);
+        char *key = strtok_r(NULL, " ", &save);
+        if (!net || !chan || !key)
+            return;
+        /* Dirutekan dengan view terakhir: pemilik baru sudah menerima VIEW
+           yang sama lebih dulu di koneksinya, jadi pasti setuju */
+        const char *owner = WINEB2B_ring_owner(coord->ring, net, chan);
+        struct member *dst = owner ? coord_find(coord, owner) : NULL;
+        if (!dst) {
+            if (cmd[0] == 'F')
+                coord->stats.unroutable++;
+            return;
+        }
+        if (cmd[0] == 'D') {
+            /* DONE net chan wait len: penerima hanya menerima DONE dari
+               pemilik lama yang ditunggunya, jadi pengirimnya disertakan */
+            conn_done(&dst->c, net, chan, m->id, strcmp(key, "-") ? key : NULL, payload, plen);
+            return;
+        }
+        conn_fwd(&dst->c, net, chan, strcmp(key, "-") ? key : NULL, payload, plen);
+        coord->stats.forwarded++;
+    }
+}
+
+int WINEB2B_shard_coord_run(WINEB2B_shard_coord* coord, int timeout_ms) {
+    if (!coord)
+        return -1;
+    struct pollfd *fds = malloc((coord->n + 1) * sizeof(struct pollfd));
+    if (!fds)
+        return -1;
+    size_t n = coord->n;
+    fds[0].fd = coord->lfd;
+    fds[0].events = POLLIN;
+    for (size_t i = 0; i < n; i++) {
+        fds[i + 1].fd = coord->members[i]->c.fd;
+        fds[i + 1].events = POLLIN | (coord->members[i]->c.out_len > coord->members[i]->c.out_off ? POLLOUT : 0);
+    }
+    if (timeout_ms < 0 || timeout_ms > HEARTBEAT_MS)
+        timeout_ms = HEARTBEAT_MS;
+    if (poll(fds, n + 1, timeout_ms) < 0 && errno != EINTR) {
+        free(fds);
+        return -1;
+    }
+    long now = now_ms();
+    for (size_t i = 0; i < n; i++) {
+        struct member *m = coord->members[i];
+        if (m->closing || !(fds[i + 1].revents & (POLLIN | POLLHUP | POLLERR)))
+            continue;
+        /* Frame yang sudah lengkap tetap diproses sebelum anggota dibuang */
+        int lost = conn_read(&m->c) != 0, r = 0;
+        char *line;
+        const char *payload;
+        size_t plen;
+        while (!m->closing && (r = conn_frame(&m->c, &line, &payload, &plen)) > 0)
+            coord_frame(coord, m, line, payload, plen);
+        if (lost || r < 0)
+            coord_drop(coord, m, "disconnected");
+    }
+    free(fds);
+
+    /* Anggota baru */
+    for (;;) {
+        int fd = accept4(coord->lfd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0)
+            break;
+        if (coord->unix_path && !same_user(fd)) {
+            close(fd);
+            continue;
+        }
+        if (coord->n == coord->cap) {
+            size_t cap = coord->cap ? coord->cap * 2 : 8;
+            struct member **members = realloc(coord->members, cap * sizeof(struct member*));
+            if (!members) {
+                close(fd);
+                break;
+            }
+            coord->members = members;
+            coord->cap = cap;
+        }
+        struct member *m = calloc(1, sizeof(struct member));
+        if (!m || (coord->secret && make_nonce(m->nonce) != 0)) {
+            free(m);
+            close(fd);
+            continue;
+        }
+        m->c.fd = fd;
+        m->c.last_in_ms = now;
+        if (coord->secret)
+            conn_printf(&m->c, "AUTH %s\n", m->nonce);
+        coord->members[coord->n++] = m;
+    }
+
+    for (size_t i = 0; i < coord->n; i++) {
+        struct member *m = coord->members[i];
+        if (m->closing)
+            continue;
+        if (now - m->c.last_in_ms > coord->timeout_ms)
+            coord_drop(coord, m, "timeout");
+        else if (m->id[0] && coord->stats.committed != coord->stats.epoch && !coord->dirty &&
+                 m->ready != coord->stats.epoch && now - coord->view_ms > coord->timeout_ms)
+            coord_drop(coord, m, "ready_timeout");
+    }
+    if (coord->dirty)
+        coord_new_view(coord);
+    coord_try_commit(coord);
+
+    /* Kirim antrean, tutup anggota yang selesai */
+    size_t k = 0;
+    for (size_t i = 0; i < coord->n; i++) {
+        struct member *m = coord->members[i];
+        if (conn_flush(&m->c) != 0 && !m->closing)
+            coord_drop(coord, m, "send_failed");
+        if (m->closing && (m->c.out_len == m->c.out_off || conn_flush(&m->c) != 0)) {
+            conn_close(&m->c);
+            free(m);
+            continue;
+        }
+        coord->members[k++] = m;
+    }
+    coord->n = k;
+    return 0;
+}
+
+void WINEB2B_shard_coord_get_stats(const WINEB2B_shard_coord* coord, WINEB2B_shard_coord_stats* out) {
+    if (!out)
+        return;
+    memset(out, 0, sizeof(*out));
+    if (coord)
+        *out = coord->stats;
+}
+
+void WINEB2B_shard_coord_free(WINEB2B_shard_coord* coord) {
+    if (!coord)
+        return;
+    for (size_t i = 0; i < coord->n; i++) {
+        conn_close(&coord->members[i]->c);
+        free(coord->members[i]);
+    }
+    free(coord->members);
+    if (coord->lfd >= 0)
+        close(coord->lfd);
+    if (coord->unix_path) {
+        unlink(coord->unix_path);
+        free(coord->unix_path);
+    }
+    secret_free(coord->secret);
+    WINEB2B_ring_free(coord->ring);
+    if (coord->committed_view != coord->view)
+        free(coord->committed_view);
+    free(coord->view);
+    free(coord);
+}
+/* --- Anggota ---
+
+   Penyerahan route dari pemilik lama A ke pemilik baru B:
+   1. VIEW: B meng-acquire (JOIN) lalu menahan semua item route di antrean;
+      A tetap mengirim ke deliver seperti biasa.
+   2. COMMIT (berarti JOIN B sudah berlaku): A me-release (PART). Setelah
+      release selesai A tidak menerima item lagi, lalu mengirim DONE
+      dengan key item yang dikirimnya sejak VIEW, ditambah yang masih ada
+      di recent (item yang sudah dibaca A sebelum VIEW diterapkan).
+   3. B membuang item antrean dengan key tersebut (sudah dikirim A) dan
+      mengirim sisanya berurutan. Jika item network pertama B ada di DONE,
+      B menunggu sampai key terakhir DONE terbaca; jika tidak, item itu
+      datang setelah PART A dan tidak ada salinan lagi.
+   Karena network mengirim urutan yang sama ke A dan B, setiap item
+   dikirim tepat sekali dan berurutan. Tanpa key, semua antrean B dikirim.
+   Jika A mati (GONE), B langsung mengirim antreannya saat COMMIT.
+   Jika VIEW berikutnya memindahkan route ke C sebelum B selesai, B
+   membuang salinan network sampai PART-nya selesai (C juga menerimanya)
+   dan mengirim DONE tanpa key; bila B masih menunggu A, DONE itu
+   meminta C menunggu DONE dari A. */
+
+enum { ROUTE_NONE, ROUTE_OWNED, ROUTE_GAINING, ROUTE_LOSING, ROUTE_RELEASING, ROUTE_ABANDONING };
+
+struct item {
+    struct item *next;
+    char *key;
+    int forwarded;                  /* Dari shard lain, bukan salinan network sendiri */
+    size_t len;
+    long queued_ms;
+    char data[];
+};
+
+struct route {
+    char *network, *channel;
+    int state;
+    /* acquire/release yang mengembalikan 1 dan belum selesai. Dihitung,
+       bukan flag: selesainya datang berurutan (misal balasan JOIN lalu
+       PART lalu JOIN), dan READY harus menunggu acquire terakhir */
+    int acquiring, releasing;
+    char prev[ID_MAX + 1];          /* Pemilik lama yang ditunggu DONE-nya, kosong jika tidak ada */
+    int done;                       /* DONE dari prev sudah diterima */
+    char done_from[ID_MAX + 1];     /* Pengirim DONE yang disimpan di cut */
+    char *cut;                      /* Key yang sudah dikirim pemilik lama (DONE), dipisah spasi */
+    size_t cut_len;
+    long cut_deadline;              /* Batas menunggu salinan key cut terbaca dari network */
+    char *seen;                     /* Key yang kita kirim sejak route LOSING, dipisah spasi */
+    size_t seen_len, seen_cap;
+    int seed;                       /* Baru LOSING: seen diisi dari recent */
+    struct item *queue, *queue_tail;
+};
+
+struct _WINEB2B_shard {
+    struct conn c;
+    char id[ID_MAX + 1];
+    WINEB2B_shard_callbacks cb;
+    void *user;
+    WINEB2B_ring *current;          /* Ring epoch yang sudah COMMIT */
+    WINEB2B_ring *next;             /* Ring VIEW yang menunggu COMMIT, NULL jika tidak ada */
+    uint64_t view_epoch;
+    int ready_sent;
+    struct route *routes;
+    size_t nroutes, routes_cap;
+    size_t *index;                  /* Open addressing: indeks route + 1, 0 = kosong */
+    size_t index_cap;
+    char (*gone)[ID_MAX + 1];       /* Anggota yang mati atau sudah keluar */
+    size_t ngone;
+    long last_ping_ms;
+    long cut_deadline;              /* Batas cut_deadline route terdekat, 0 = tidak ada */
+    /* Key terakhir yang dikirim ke deliver di semua route. Item yang sudah
+       kita kirim sebelum VIEW diterapkan bisa juga diterima pemilik baru */
+    struct {
+        size_t route;               /* Indeks route + 1, 0 = kosong */
+        char key[RECENT_KEY_MAX + 1];
+    } recent[RECENT_MAX];
+    size_t recent_pos;
+    int leaving;
+    WINEB2B_shard_stats stats;
+};
+
+static int is_mine(const WINEB2B_shard* shard, const WINEB2B_ring* ring, const char* network,
+                   const char* channel) {
+    const char *owner = WINEB2B_ring_owner(ring, network, channel);
+    return owner && strcmp(owner, shard->id) == 0;
+}
+
+static const WINEB2B_ring* latest(const WINEB2B_shard* shard) {
+    return shard->next ? shard->next : shard->current;
+}
+
+static int is_gone(const WINEB2B_shard* shard, const char* id) {
+    for (size_t i = 0; i < shard->ngone; i++)
+        if (strcmp(shard->gone[i], id) == 0)
+            return 1;
+    return 0;
+}
+
+static struct route* route_find(const WINEB2B_shard* shard, const char* network, const char* channel) {
+    if (!shard->index_cap)
+        return NULL;
+    size_t mask = shard->index_cap - 1;
+    for (size_t j = route_hash(network, channel) & mask; shard->index[j]; j = (j + 1) & mask) {
+        struct route *r = &shard->routes[shard->index[j] - 1];
+        if (strcmp(r->network, network) == 0 && strcmp(r->channel, channel) == 0)
+            return r;
+    }
+    return NULL;
+}
+
+static int index_rebuild(WINEB2B_shard* shard, size_t cap) {
+    size_t *index = calloc(cap, sizeof(size_t));
+    if (!index)
+        return -1;
+    for (size_t i = 0; i < shard->nroutes; i++) {
+        size_t j = route_hash(shard->routes[i].network, shard->routes[i].channel) & (cap - 1);
+        while (index[j])
+            j = (j + 1) & (cap - 1);
+        index[j] = i + 1;
+    }
+    free(shard->index);
+    shard->index = index;
+    shard->index_cap = cap;
+    return 0;
+}
+
+static void item_free(struct item* it) {
+    free(it->key);
+    free(it);
+}
+
+static int forward(WINEB2B_shard* shard, const char* network, const char* channel, const char* key,
+                   const void* data, size_t len) {
+    if (conn_fwd(&shard->c, network, channel, key, data, len) != 0)
+        return -1;
+    shard->stats.forwarded++;
+    return WINEB2B_SHARD_FORWARDED;
+}
+
+/* Daftar key dipisah spasi */
+static int keys_add(char** keys, size_t* len, size_t* cap, const char* key) {
+    size_t n = strlen(key) + 1;
+    if (*len + n + 1 > *cap) {
+        size_t c = *cap ? *cap * 2 : 256;
+        while (c < *len + n + 1)
+            c *= 2;
+        char *k = realloc(*keys, c);
+        if (!k)
+            return -1;
+        *keys = k;
+        *cap = c;
+    }
+    if (*len)
+        (*keys)[(*len)++] = ' ';
+    memcpy(*keys + *len, key, n);
+    *len += n - 1;
+    return 0;
+}
+
+static int keys_has(const char* keys, size_t len, const char* key) {
+    size_t n = strlen(key);
+    for (const char *p = keys, *end = keys + len; p < end;) {
+        const char *sp = memchr(p, ' ', (size_t)(end - p));
+        size_t m = sp ? (size_t)(sp - p) : (size_t)(end - p);
+        if (m == n && memcmp(p, key, n) == 0)
+            return 1;
+        p += m + 1;
+    }
+    return 0;
+}
+
+static void deliver(WINEB2B_shard* shard, struct route* r, const char* network, const char* channel,
+                    const char* key, const void* data, size_t len) {
+    if (r && key) {
+        if (r->state == ROUTE_LOSING || r->state == ROUTE_RELEASING)
+            keys_add(&r->seen, &r->seen_len, &r->seen_cap, key);
+        if (strlen(key) <= RECENT_KEY_MAX) {
+            shard->recent[shard->recent_pos].route = (size_t)(r - shard->routes) + 1;
+            strcpy(shard->recent[shard->recent_pos].key, key);
+            shard->recent_pos = (shard->recent_pos + 1) % RECENT_MAX;
+        }
+    }
+    shard->stats.delivered++;
+    if (shard->cb.deliver)
+        shard->cb.deliver(network, channel, key, data, len, shard->user);
+}
+
+static int enqueue(WINEB2B_shard* shard, struct route* r, const char* key, const void* data, size_t len,
+                   int forwarded) {
+    struct item *it = malloc(sizeof(struct item) + len);
+    if (!it)
+        return -1;
+    it->next = NULL;
+    it->key = key ? strdup(key) : NULL;
+    it->forwarded = forwarded;
+    it->len = len;
+    it->queued_ms = now_ms();
+    if (len)
+        memcpy(it->data, data, len);
+    if (key && !it->key) {
+        free(it);
+        return -1;
+    }
+    if (r->queue_tail)
+        r->queue_tail->next = it;
+    else
+        r->queue = it;
+    r->queue_tail = it;
+    shard->stats.queued++;
+    shard->stats.queue_len++;
+    return WINEB2B_SHARD_QUEUED;
+}
+
+static void handover_reset(struct route* r) {
+    free(r->cut);
+    r->cut = NULL;
+    r->cut_len = 0;
+    r->prev[0] = '\0';
+    r->done_from[0] = '\0';
+    r->done = 0;
+}
+
+/* Mengirim antrean route yang baru didapat. Salinan network yang key-nya
+   ada di DONE sudah dikirim pemilik lama dan dibuang */
+static void route_flush(WINEB2B_shard* shard, struct route* r) {
+    int cutting = r->cut && r->done;
+    long now = now_ms();
+    r->state = ROUTE_OWNED;
+    shard->stats.routes++;
+    while (r->queue) {
+        struct item *it = r->queue;
+        r->queue = it->next;
+        shard->stats.queue_len--;
+        if ((uint64_t)(now - it->queued_ms) > shard->stats.max_queue_ms)
+            shard->stats.max_queue_ms = (uint64_t)(now - it->queued_ms);
+        if (cutting && !it->forwarded && it->key && keys_has(r->cut, r->cut_len, it->key)) {
+            shard->stats.duplicates++;
+        } else {
+            deliver(shard, r, r->network, r->channel, it->key, it->data, it->len);
+        }
+        item_free(it);
+    }
+    r->queue_tail = NULL;
+    handover_reset(r);
+}
+
+/* 1 jika salinan item yang dikirim pemilik lama mungkin belum terbaca dari
+   network. Item network pertama di antrean yang tidak ada di DONE datang
+   setelah release pemilik lama, jadi semua salinan sudah terbaca begitu
+   key terakhir DONE terlihat. Tanpa item network belum bisa dipastikan */
+static int cut_pending(const struct route* r) {
+    const struct item *it = r->queue;
+    while (it && (it->forwarded || !it->key))
+        it = it->next;
+    if (!it)
+        return 1;
+    if (!keys_has(r->cut, r->cut_len, it->key))
+        return 0;
+    const char *last = r->cut + r->cut_len;
+    while (last > r->cut && last[-1] != ' ')
+        last--;
+    size_t n = (size_t)(r->cut + r->cut_len - last);
+    for (; it; it = it->next)
+        if (!it->forwarded && it->key && strlen(it->key) == n && memcmp(it->key, last, n) == 0)
+            return 0;
+    return 1;
+}
+
+/* Antrean dikirim setelah COMMIT dan DONE pemilik lama, dan setelah semua
+   salinan item yang dikirimnya terbaca (paling lama CUT_WAIT_MS) */
+static void route_try_flush(WINEB2B_shard* shard, struct route* r) {
+    if (shard->next || r->state != ROUTE_GAINING || (r->prev[0] && !r->done))
+        return;
+    if (r->done && r->cut && now_ms() < r->cut_deadline && cut_pending(r)) {
+        if (!shard->cut_deadline || r->cut_deadline < shard->cut_deadline)
+            shard->cut_deadline = r->cut_deadline;
+        return;
+    }
+    route_flush(shard, r);
+}
+
+/* Route yang sedang didapat dibatalkan VIEW berikutnya: salinan network
+   dibuang sampai release selesai (pemilik sebenarnya juga menerimanya),
+   item dari shard lain diteruskan lagi, dan pemilik berikutnya tidak
+   perlu menunggu kita, tapi tetap menunggu pemilik lama yang kita tunggu */
+static void route_abandon(WINEB2B_shard* shard, struct route* r) {
+    char wait[ID_MAX + 1], *cut = NULL;
+    size_t cut_len = 0;
+    while (r->queue) {
+        struct item *it = r->queue;
+        r->queue = it->next;
+        shard->stats.queue_len--;
+        if (it->forwarded)
+            forward(shard, r->network, r->channel, it->key, it->data, it->len);
+        item_free(it);
+    }
+    r->queue_tail = NULL;
+    /* Sudah menerima DONE: teruskan key-nya ke pemilik berikutnya */
+    snprintf(wait, sizeof(wait), "%s", r->done ? "" : r->prev);
+    if (r->done && r->cut) {
+        cut = r->cut;
+        cut_len = r->cut_len;
+        r->cut = NULL;
+    }
+    handover_reset(r);
+    shard->stats.released++;
+    if (shard->cb.release && shard->cb.release(r->network, r->channel, shard->user) == 1)
+        r->releasing++;
+    r->state = r->releasing ? ROUTE_ABANDONING : ROUTE_NONE;
+    conn_done(&shard->c, r->network, r->channel, NULL, wait, cut, cut_len);
+    free(cut);
+}
+
+static void try_ready(WINEB2B_shard* shard) {
+    if (!shard->next || shard->ready_sent)
+        return;
+    for (size_t i = 0; i < shard->nroutes; i++)
+        if (shard->routes[i].state == ROUTE_GAINING && shard->routes[i].acquiring)
+            return;
+    conn_printf(&shard->c, "READY %llu\n", (unsigned long long)shard->view_epoch);
+    shard->ready_sent = 1;
+}
+
+/* Mulai menahan item route; prev = pemilik lama yang harus mengirim DONE */
+static void route_gain(WINEB2B_shard* shard, struct route* r, const char* prev) {
+    r->state = ROUTE_GAINING;
+    r->seen_len = 0;
+    handover_reset(r);
+    snprintf(r->prev, sizeof(r->prev), "%s", prev && strcmp(prev, shard->id) && !is_gone(shard, prev) ? prev : "");
+    shard->stats.acquired++;
+    if (shard->cb.acquire && shard->cb.acquire(r->network, r->channel, shard->user) == 1)
+        r->acquiring++;
+}
+
+/* Release pemilik lama selesai: tidak ada item lagi dari network */
+static void route_released(WINEB2B_shard* shard, struct route* r) {
+    r->state = ROUTE_NONE;
+    conn_done(&shard->c, r->network, r->channel, NULL, NULL, r->seen, r->seen_len);
+    r->seen_len = 0;
+}
+
+static void apply_view(WINEB2B_shard* shard, uint64_t epoch, WINEB2B_ring* ring) {
+    WINEB2B_ring_free(shard->next);
+    shard->next = ring;
+    shard->view_epoch = epoch;
+    shard->ready_sent = 0;
+    /* ID yang muncul lagi (misal proses di-restart) tidak lagi dianggap mati */
+    for (size_t i = 0; i < shard->ngone;)
+        if (ring_has(ring, shard->gone[i]))
+            memmove(shard->gone[i], shard->gone[--shard->ngone], sizeof(shard->gone[i]));
+        else
+            i++;
+    for (size_t i = 0; i < shard->nroutes; i++) {
+        struct route *r = &shard->routes[i];
+        int will = is_mine(shard, ring, r->network, r->channel);
+        switch (r->state) {
+        case ROUTE_OWNED:
+            if (!will) {
+                r->state = ROUTE_LOSING;
+                r->seen_len = 0;
+                r->seed = 1;
+            }
+            break;
+        case ROUTE_LOSING:
+            if (will)
+                r->state = ROUTE_OWNED;
+            break;
+        case ROUTE_GAINING:
+            if (!will)
+                route_abandon(shard, r);
+            break;
+        case ROUTE_RELEASING:
+        case ROUTE_ABANDONING:
+            /* Kembali ke sini sebelum PART selesai: didapat ulang dari pemilik sekarang */
+            if (will)
+                route_gain(shard, r, WINEB2B_ring_owner(shard->current, r->network, r->channel));
+            break;
+        default:
+            if (will)
+                route_gain(shard, r, WINEB2B_ring_owner(shard->current, r->network, r->channel));
+            break;
+        }
+    }
+    for (size_t i = 0; i < RECENT_MAX; i++) {
+        size_t j = (shard->recent_pos + i) % RECENT_MAX, k = shard->recent[j].route;
+        if (k && shard->routes[k - 1].seed && shard->routes[k - 1].state == ROUTE_LOSING)
+            keys_add(&shard->routes[k - 1].seen, &shard->routes[k - 1].seen_len,
+                     &shard->routes[k - 1].seen_cap, shard->recent[j].key);
+    }
+    for (size_t i = 0; i < shard->nroutes; i++)
+        shard->routes[i].seed = 0;
+    try_ready(shard);
+}
+
+static void apply_commit(WINEB2B_shard* shard, uint64_t epoch) {
+    if (!shard->next || epoch != shard->view_epoch)
+        return;
+    WINEB2B_ring_free(shard->current);
+    shard->current = shard->next;
+    shard->next = NULL;
+    shard->stats.epoch = epoch;
+    shard->stats.members = WINEB2B_ring_size(shard->current);
+    shard->stats.routes = 0;
+    for (size_t i = 0; i < shard->nroutes; i++) {
+        struct route *r = &shard->routes[i];
+        if (r->state == ROUTE_OWNED) {
+            shard->stats.routes++;
+        } else if (r->state == ROUTE_LOSING) {
+            r->state = ROUTE_RELEASING;
+            shard->stats.released++;
+            if (shard->cb.release && shard->cb.release(r->network, r->channel, shard->user) == 1)
+                r->releasing++;
+            if (!r->releasing)
+                route_released(shard, r);
+        } else if (r->state == ROUTE_GAINING) {
+            route_try_flush(shard, r);
+        }
+    }
+}
+
+/* DONE dari from; wait = pemilik lama yang masih ditunggu from (from
+   membatalkan acquire-nya). DONE dari anggota lain disimpan karena bisa
+   tiba sebelum DONE yang mengarahkan ke pengirimnya */
+static void cut_set(struct route* r, const char* keys, size_t len) {
+    free(r->cut);
+    r->cut = len ? malloc(len + 1) : NULL;
+    r->cut_len = r->cut ? len : 0;
+    if (r->cut) {
+        memcpy(r->cut, keys, len);
+        r->cut[len] = '\0';
+    }
+}
+
+static void apply_done(WINEB2B_shard* shard, const char* network, const char* channel, const char* from,
+                       const char* wait, const char* keys, size_t klen) {
+    struct route *r = route_find(shard, network, channel);
+    if (!r || r->state != ROUTE_GAINING || r->done || !from)
+        return;
+    if (strcmp(from, r->prev) != 0 || (wait && valid_token(wait) && strlen(wait) <= ID_MAX &&
+                                       strcmp(wait, shard->id) != 0 && !is_gone(shard, wait))) {
+        if (strcmp(from, r->prev) == 0) {
+            snprintf(r->prev, sizeof(r->prev), "%s", wait);
+            r->done = strcmp(r->done_from, wait) == 0;
+        } else if (strlen(from) <= ID_MAX) {
+            cut_set(r, keys, klen);
+            snprintf(r->done_from, sizeof(r->done_from), "%s", from);
+        }
+    } else {
+        cut_set(r, keys, klen);
+        r->done = 1;
+    }
+    r->cut_deadline = now_ms() + CUT_WAIT_MS;
+    route_try_flush(shard, r);
+}
+
+static void apply_gone(WINEB2B_shard* shard, const char* id) {
+    if (!valid_token(id) || strlen(id) > ID_MAX || strcmp(id, shard->id) == 0 || is_gone(shard, id))
+        return;
+    char (*gone)[ID_MAX + 1] = realloc(shard->gone, (shard->ngone + 1) * sizeof(*gone));
+    if (!gone)
+        return;
+    shard->gone = gone;
+    snprintf(shard->gone[shard->ngone++], ID_MAX + 1, "%s", id);
+    for (size_t i = 0; i < shard->nroutes; i++) {
+        struct route *r = &shard->routes[i];
+        if (r->state != ROUTE_GAINING || strcmp(r->prev, id) != 0)
+            continue;
+        r->prev[0] = '\0';
+        route_try_flush(shard, r);
+    }
+}
+
+static WINEB2B_ring* parse_view(char** save) {
+    WINEB2B_ring *ring = WINEB2B_ring_create();
+    char *count = strtok_r(NULL, " ", save);
+    if (!ring || !count)
+        goto fail;
+    for (long n = atol(count); n > 0; n--) {
+        char *id = strtok_r(NULL, " ", save), *vnodes = strtok_r(NULL, " ", save);
+        if (!id || !vnodes || WINEB2B_ring_add(ring, id, atoi(vnodes)) != 0)
+            goto fail;
+    }
+    return ring;
+fail:
+    WINEB2B_ring_free(ring);
+    return NULL;
+}
+
+/* Item untuk route: dikirim, ditahan selama penyerahan, atau diteruskan */
+static int route_item(WINEB2B_shard* shard, const char* network, const char* channel, const char* key,
+                      const void* data, size_t len, int forwarded) {
+    struct route *r = route_find(shard, network, channel);
+    if (r && r->state == ROUTE_GAINING) {
+        int q = enqueue(shard, r, key, data, len, forwarded);
+        if (q >= 0 && !forwarded && key && r->done && r->cut)
+            route_try_flush(shard, r);
+        return q;
+    }
+    /* Salinan network juga diterima pemiliknya */
+    if (r && r->state == ROUTE_ABANDONING)
+        return forwarded ? forward(shard, network, channel, key, data, len) : WINEB2B_SHARD_DELIVERED;
+    if (r && r->state != ROUTE_NONE) {
+        deliver(shard, r, network, channel, key, data, len);
+        return WINEB2B_SHARD_DELIVERED;
+    }
+    /* Koordinator merutekan FWD dengan view yang sama, jadi route ini milik kita */
+    if (forwarded || is_mine(shard, latest(shard), network, channel)) {
+        deliver(shard, NULL, network, channel, key, data, len);
+        return WINEB2B_SHARD_DELIVERED;
+    }
+    return forward(shard, network, channel, key, data, len);
+}
+
+static void shard_frame(WINEB2B_shard* shard, char* line, const char* payload, size_t plen) {
+    char *save = NULL, *cmd = strtok_r(line, " ", &save);
+    if (!cmd)
+        return;
+    if (strcmp(cmd, "VIEW") == 0) {
+        char *epoch = strtok_r(NULL, " ", &save);
+        WINEB2B_ring *ring = epoch ? parse_view(&save) : NULL;
+        if (ring)
+            apply_view(shard, strtoull(epoch, NULL, 10), ring);
+    } else if (strcmp(cmd, "COMMIT") == 0) {
+        char *epoch = strtok_r(NULL, " ", &save);
+        if (epoch)
+            apply_commit(shard, strtoull(epoch, NULL, 10));
+    } else if (strcmp(cmd, "FWD") == 0 || strcmp(cmd, "DONE") == 0) {
+        char *net = strtok_r(NULL, " ", &save), *chan = strtok_r(NULL, " ", &save);
+        char *key = strtok_r(NULL, " ", &save);
+        if (!net || !chan || !key)
+            return;
+        if (strcmp(key, "-") == 0)
+            key = NULL;
+        /* DONE net chan from wait len: key berisi from */
+        if (cmd[0] == 'F') {
+            route_item(shard, net, chan, key, payload, plen, 1);
+        } else {
+            char *wait = strtok_r(NULL, " ", &save);
+            apply_done(shard, net, chan, key, wait && strcmp(wait, "-") ? wait : NULL, payload, plen);
+        }
+    } else if (strcmp(cmd, "GONE") == 0) {
+        apply_gone(shard, strtok_r(NULL, " ", &save));
+    } else if (strcmp(cmd, "ERR") == 0) {
+        fprintf(stderr, "Koordinator shard menolak %s: %s\n", shard->id, save ? save : "");
+    }
+}
+
+/* Satu baris dari koordinator sebelum deadline, untuk handshake */
+static char* read_line(WINEB2B_shard* shard, long deadline) {
+    for (;;) {
+        char *line;
+        const char *payload;
+        size_t plen;
+        int r = conn_frame(&shard->c, &line, &payload, &plen);
+        if (r > 0 && !payload)
+            return line;
+        long left = deadline - now_ms();
+        if (r != 0 || left <= 0)
+            return NULL;
+        struct pollfd pfd = { shard->c.fd, POLLIN, 0 };
+        if ((poll(&pfd, 1, (int)left) < 0 && errno != EINTR) || conn_read(&shard->c) != 0)
+            return NULL;
+    }
+}
+
+/* AUTH -> HELLO bertanda tangan -> WELCOME. Frame sesudah WELCOME (view
+   yang sedang berlaku) tetap di buffer untuk WINEB2B_shard_run */
+static int shard_auth(WINEB2B_shard* shard, const char* secret, int vnodes) {
+    long deadline = now_ms() + DEFAULT_TIMEOUT_MS;
+    char *line = read_line(shard, deadline);
+    if (!line || strncmp(line, "AUTH ", 5) != 0 || !valid_token(line + 5) || strlen(line + 5) > NONCE_HEX * 2) {
+        fprintf(stderr, "Error: koordinator shard tidak meminta autentikasi\n");
+        return -1;
+    }
+    char coord_nonce[NONCE_HEX * 2 + 1], nonce[NONCE_HEX + 1], mac[MAC_HEX + 1];
+    snprintf(coord_nonce, sizeof(coord_nonce), "%s", line + 5);
+    if (make_nonce(nonce) != 0)
+        return -1;
+    auth_mac(secret, "member", coord_nonce, nonce, shard->id, mac);
+    if (conn_printf(&shard->c, "HELLO %s %d %s %s\n", shard->id, vnodes, nonce, mac) != 0 ||
+        conn_flush(&shard->c) != 0)
+        return -1;
+    line = read_line(shard, deadline);
+    if (line && strncmp(line, "ERR ", 4) == 0) {
+        fprintf(stderr, "Error: koordinator shard menolak %s: %s\n", shard->id, line + 4);
+        return -1;
+    }
+    auth_mac(secret, "coord", coord_nonce, nonce, shard->id, mac);
+    if (!line || strncmp(line, "WELCOME ", 8) != 0 || !mac_equal(line + 8, mac)) {
+        fprintf(stderr, "Error: koordinator shard gagal membuktikan shared secret\n");
+        return -1;
+    }
+    return 0;
+}
+
+WINEB2B_shard* WINEB2B_shard_join(const char* address, const char* id, int vnodes, const char* secret,
+                                  const WINEB2B_shard_callbacks* callbacks, void* user) {
+    struct sockaddr_storage ss;
+    socklen_t len;
+    int family;
+    if (!address || !valid_token(id) || strlen(id) > ID_MAX || parse_address(address, &ss, &len, &family) != 0)
+        return NULL;
+    if (secret && !*secret)
+        secret = NULL;
+    if (family != AF_UNIX && !secret) {
+        fprintf(stderr, "Error: koordinator shard %s butuh shared secret\n", address);
+        return NULL;
+    }
+    int fd = socket(family, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+        return NULL;
+    if (connect(fd, (struct sockaddr*)&ss, len) != 0 || set_nonblock(fd) != 0) {
+        fprintf(stderr, "Gagal terhubung ke koordinator shard %s: %s\n", address, strerror(errno));
+        close(fd);
+        return NULL;
+    }
+    if (family == AF_UNIX && !same_user(fd)) {
+        close(fd);
+        return NULL;
+    }
+    WINEB2B_shard *shard = calloc(1, sizeof(WINEB2B_shard));
+    if (!shard) {
+        close(fd);
+        return NULL;
+    }
+    shard->c.fd = fd;
+    snprintf(shard->id, sizeof(shard->id), "%s", id);
+    if (callbacks)
+        shard->cb = *callbacks;
+    shard->user = user;
+    shard->last_ping_ms = now_ms();
+    vnodes = vnodes > 0 ? vnodes : DEFAULT_VNODES;
+    int r;
+    if (secret)
+        r = shard_auth(shard, secret, vnodes);
+    else
+        r = conn_printf(&shard->c, "HELLO %s %d\n", id, vnodes) != 0 || conn_flush(&shard->c) != 0 ? -1 : 0;
+    if (r != 0) {
+        WINEB2B_shard_free(shard);
+        return NULL;
+    }
+    return shard;
+}
+
+int WINEB2B_shard_fd(const WINEB2B_shard* shard) {
+    return shard ? shard->c.fd : -1;
+}
+
+int WINEB2B_shard_run(WINEB2B_shard* shard, int timeout_ms) {
+    if (!shard || shard->c.fd < 0)
+        return -1;
+    long now = now_ms();
+    if (now - shard->last_ping_ms >= HEARTBEAT_MS) {
+        conn_printf(&shard->c, "PING\n");
+        shard->last_ping_ms = now;
+    }
+    if (conn_flush(&shard->c) != 0)
+        goto lost;
+    struct pollfd pfd = { shard->c.fd, POLLIN | (shard->c.out_len > shard->c.out_off ? POLLOUT : 0), 0 };
+    if (timeout_ms < 0 || timeout_ms > HEARTBEAT_MS)
+        timeout_ms = HEARTBEAT_MS;
+    if (poll(&pfd, 1, timeout_ms) < 0 && errno != EINTR)
+        goto lost;
+    /* Buffer bisa sudah berisi frame sisa handshake */
+    int lost = (pfd.revents & (POLLIN | POLLHUP | POLLERR)) && conn_read(&shard->c) != 0, r;
+    char *line;
+    const char *payload;
+    size_t plen;
+    while ((r = conn_frame(&shard->c, &line, &payload, &plen)) > 0)
+        shard_frame(shard, line, payload, plen);
+    if (lost || r < 0)
+        goto lost;
+    if (shard->cut_deadline && now_ms() >= shard->cut_deadline) {
+        shard->cut_deadline = 0;
+        for (size_t i = 0; i < shard->nroutes; i++)
+            if (shard->routes[i].state == ROUTE_GAINING && shard->routes[i].done)
+                route_try_flush(shard, &shard->routes[i]);
+    }
+    if (conn_flush(&shard->c) != 0)
+        goto lost;
+    return 0;
+lost:
+    conn_close(&shard->c);
+    return -1;
+}
+
+int WINEB2B_shard_add_route(WINEB2B_shard* shard, const char* network, const char* channel) {
+    if (!shard || !valid_token(network) || !valid_token(channel))
+        return -1;
+    if (route_find(shard, network, channel))
+        return 0;
+    if (shard->nroutes == shard->routes_cap) {
+        size_t cap = shard->routes_cap ? shard->routes_cap * 2 : 64;
+        struct route *routes = realloc(shard->routes, cap * sizeof(struct route));
+        if (!routes)
+            return -1;
+        shard->routes = routes;
+        shard->routes_cap = cap;
+    }
+    struct route *r = &shard->routes[shard->nroutes];
+    memset(r, 0, sizeof(*r));
+    r->network = strdup(network);
+    r->channel = strdup(channel);
+    if (!r->network || !r->channel) {
+        free(r->network);
+        free(r->channel);
+        return -1;
+    }
+    shard->nroutes++;
+    if (shard->nroutes * 2 > shard->index_cap) {
+        if (index_rebuild(shard, shard->index_cap ? shard->index_cap * 2 : 128) != 0) {
+            shard->nroutes--;
+            free(r->network);
+            free(r->channel);
+            return -1;
+        }
+    } else {
+        size_t j = route_hash(network, channel) & (shard->index_cap - 1);
+        while (shard->index[j])
+            j = (j + 1) & (shard->index_cap - 1);
+        shard->index[j] = shard->nroutes;
+    }
+    /* Route milik kita yang belum pernah dilayani siapa pun: langsung dikirim */
+    if (shard->current && is_mine(shard, shard->current, network, channel)) {
+        r->state = shard->next && !is_mine(shard, shard->next, network, channel) ? ROUTE_LOSING : ROUTE_OWNED;
+        shard->stats.routes++;
+        shard->stats.acquired++;
+        if (shard->cb.acquire && shard->cb.acquire(network, channel, shard->user) == 1)
+            r->acquiring++;
+    } else if (shard->next && is_mine(shard, shard->next, network, channel)) {
+        route_gain(shard, r, WINEB2B_ring_owner(shard->current, network, channel));
+    }
+    return 0;
+}
+
+int WINEB2B_shard_acquired(WINEB2B_shard* shard, const char* network, const char* channel) {
+    struct route *r = shard && network && channel ? route_find(shard, network, channel) : NULL;
+    if (!r)
+        return -1;
+    if (r->acquiring > 0) {
+        r->acquiring--;
+        try_ready(shard);
+    }
+    return 0;
+}
+
+int WINEB2B_shard_released(WINEB2B_shard* shard, const char* network, const char* channel) {
+    struct route *r = shard && network && channel ? route_find(shard, network, channel) : NULL;
+    if (!r)
+        return -1;
+    if (r->releasing > 0 && --r->releasing == 0) {
+        if (r->state == ROUTE_RELEASING)
+            route_released(shard, r);
+        else if (r->state == ROUTE_ABANDONING)
+            r->state = ROUTE_NONE;
+    }
+    return 0;
+}
+
+int WINEB2B_shard_owns(const WINEB2B_shard* shard, const char* network, const char* channel) {
+    return shard && network && channel && is_mine(shard, latest(shard), network, channel);
+}
+
+int WINEB2B_shard_submit(WINEB2B_shard* shard, const char* network, const char* channel,
+                         const char* key, const void* data, size_t len) {
+    if (!shard || shard->c.fd < 0 || !valid_token(network) || !valid_token(channel) ||
+        (key && !valid_token(key)) || (len && !data))
+        return -1;
+    int r = route_item(shard, network, channel, key, data, len, 0);
+    if (r == WINEB2B_SHARD_FORWARDED && conn_flush(&shard->c) != 0)
+        return -1;
+    return r;
+}
+
+int WINEB2B_shard_leave(WINEB2B_shard* shard) {
+    if (!shard || shard->c.fd < 0)
+        return -1;
+    if (!shard->leaving) {
+        shard->leaving = 1;
+        conn_printf(&shard->c, "BYE\n");
+    }
+    return conn_flush(&shard->c);
+}
+
+int WINEB2B_shard_left(const WINEB2B_shard* shard) {
+    if (!shard || !shard->leaving || shard->next || ring_has(shard->current, shard->id) ||
+        shard->c.out_len > shard->c.out_off)
+        return 0;
+    for (size_t i = 0; i < shard->nroutes; i++)
+        if (shard->routes[i].state != ROUTE_NONE)
+            return 0;
+    return 1;
+}
+
+void WINEB2B_shard_get_stats(const WINEB2B_shard* shard, WINEB2B_shard_stats* out) {
+    if (!out)
+        return;
+    memset(out, 0, sizeof(*out));
+    if (shard)
+        *out = shard->stats;
+}
+
+void WINEB2B_shard_free(WINEB2B_shard* shard) {
+    if (!shard)
+        return;
+    conn_close(&shard->c);
+    for (size_t i = 0; i < shard->nroutes; i++) {
+        struct route *r = &shard->routes[i];
+        while (r->queue) {
+            struct item *it = r->queue;
+            r->queue = it->next;
+            item_free(it);
+        }
+        free(r->network);
+        free(r->channel);
+        free(r->cut);
+        free(r->seen);
+    }
+    free(shard->routes);
+    free(shard->index);
+    free(shard->gone);
+    WINEB2B_ring_free(shard->current);
+    WINEB2B_ring_free(shard->next);
+    free(shard);
+}
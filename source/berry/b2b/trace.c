@@ -0,0 +1,302 @@
+#define _GNU_SOURCE
+#include "trace.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/syscall.h>
+
+struct span {
+    uint64_t trace;
+    uint64_t start_ns, end_ns;
+    const char *cat, *name;
+    uint32_t tid;
+    char detail[WINEB2B_TRACE_DETAIL];
+};
+
+/* Ring span milik satu thread. Lock hanya diperebutkan saat ekspor */
+struct buffer {
+    pthread_mutex_t lock;
+    uint64_t head;                      /* Total span yang pernah ditulis */
+    uint64_t overwritten;
+    uint32_t tid;
+    int dead;                           /* Thread pemilik sudah keluar; boleh dipakai ulang */
+    char thread_name[16];
+    struct buffer *next;
+    struct span spans[WINEB2B_TRACE_SPANS];
+};
+
+unsigned WINEB2B_trace_sampling;
+__thread uint64_t WINEB2B_trace_current;
+
+static pthread_mutex_t registry_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct buffer *buffers;
+static pthread_key_t buffer_key;
+static pthread_once_t key_once = PTHREAD_ONCE_INIT;
+static __thread struct buffer *my_buffer;
+static __thread unsigned sample_count;
+static uint64_t next_trace;
+static uint64_t traces_started;
+
+/* --- Ring per thread --- */
+
+static void buffer_release(void* arg) {
+    struct buffer *b = arg;
+    pthread_mutex_lock(&b->lock);
+    b->dead = 1;
+    pthread_mutex_unlock(&b->lock);
+}
+
+static void make_key(void) {
+    pthread_key_create(&buffer_key, buffer_release);
+}
+
+/* Ring thread yang sudah keluar dipakai ulang; span lamanya tetap bisa
+   diekspor sampai tertimpa (tid disimpan per span) */
+static struct buffer* attach(void) {
+    pthread_once(&key_once, make_key);
+    pthread_mutex_lock(&registry_lock);
+    struct buffer *b = buffers;
+    while (b && !b->dead)
+        b = b->next;
+    if (!b) {
+        b = calloc(1, sizeof(struct buffer));
+        if (!b) {
+            pthread_mutex_unlock(&registry_lock);
+            return NULL;
+        }
+        pthread_mutex_init(&b->lock, NULL);
+        b->next = buffers;
+        buffers = b;
+    }
+    pthread_mutex_lock(&b->lock);
+    b->dead = 0;
+    b->tid = (uint32_t)syscall(SYS_gettid);
+    if (pthread_getname_np(pthread_self(), b->thread_name, sizeof(b->thread_name)) != 0)
+        b->thread_name[0] = '\0';
+    pthread_mutex_unlock(&b->lock);
+    pthread_mutex_unlock(&registry_lock);
+    pthread_setspecific(buffer_key, b);
+    my_buffer = b;
+    return b;
+}
+
+/* --- API pencatat --- */
+
+void WINEB2B_trace_set_sampling(unsigned one_in) {
+    __atomic_store_n(&WINEB2B_trace_sampling, one_in, __ATOMIC_RELAXED);
+}
+
+uint64_t WINEB2B_trace_begin(void) {
+    unsigned one_in = __atomic_load_n(&WINEB2B_trace_sampling, __ATOMIC_RELAXED);
+    if (one_in == 0)
+        return 0;
+    uint64_t id = 0;
+    if (++sample_count >= one_in) {
+        sample_count = 0;
+        id = __atomic_add_fetch(&next_trace, 1, __ATOMIC_RELAXED);
+        __atomic_add_fetch(&traces_started, 1, __ATOMIC_RELAXED);
+    }
+    WINEB2B_trace_current = id;
+    return id;
+}
+
+uint64_t WINEB2B_trace_adopt(uint64_t trace) {
+    uint64_t prev = WINEB2B_trace_current;
+    WINEB2B_trace_current = trace;
+    return prev;
+}
+
+void WINEB2B_trace_end(void) {
+    WINEB2B_trace_current = 0;
+}
+
+uint64_t WINEB2B_trace_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+void WINEB2B_trace_span(uint64_t trace, const char* cat, const char* name,
+                        uint64_t start_ns, uint64_t end_ns, const char* detail) {
+    if (!trace)
+        return;
+    struct buffer *b = my_buffer ? my_buffer : attach();
+    if (!b)
+        return;
+    pthread_mutex_lock(&b->lock);
+    if (b->head >= WINEB2B_TRACE_SPANS)
+        b->overwritten++;
+    struct span *s = &b->spans[b->head % WINEB2B_TRACE_SPANS];
+    s->trace = trace;
+    s->start_ns = start_ns;
+    s->end_ns = end_ns > start_ns ? end_ns : start_ns;
+    s->cat = cat;
+    s->name = name;
+    s->tid = b->tid;
+    if (detail) {
+        size_t n = strnlen(detail, sizeof(s->detail) - 1);
+        memcpy(s->detail, detail, n);
+        s->detail[n] = '\0';
+    } else {
+        s->detail[0] = '\0';
+    }
+    b->head++;
+    pthread_mutex_unlock(&b->lock);
+}
+
+/* --- Ekspor Chrome trace-event --- */
+
+static int cmp_span(const void* a, const void* b) {
+    const struct span *x = a, *y = b;
+    if (x->trace != y->trace)
+        return x->trace < y->trace ? -1 : 1;
+    if (x->start_ns != y->start_ns)
+        return x->start_ns < y->start_ns ? -1 : 1;
+    /* Span induk (lebih panjang) lebih dulu */
+    return x->end_ns > y->end_ns ? -1 : x->end_ns < y->end_ns;
+}
+
+static void write_json_string(FILE* f, const char* s) {
+    fputc('"', f);
+    for (; *s; s++) {
+        unsigned char c = (unsigned char)*s;
+        if (c == '"' || c == '\\')
+            fprintf(f, "\\%c", c);
+        else if (c < 0x20)
+            fprintf(f, "\\u%04x", c);
+        else
+            fputc(c, f);
+    }
+    fputc('"', f);
+}
+
+/* Menyalin span yang masih ada di semua ring ke *out. -1 jika gagal */
+static int collect(struct span** out, size_t* count_out) {
+    pthread_mutex_lock(&registry_lock);
+    size_t cap = 0;
+    for (struct buffer *b = buffers; b; b = b->next)
+        cap += WINEB2B_TRACE_SPANS;
+    struct span *all = malloc((cap ? cap : 1) * sizeof(struct span));
+    size_t n = 0;
+    for (struct buffer *b = buffers; b && all; b = b->next) {
+        pthread_mutex_lock(&b->lock);
+        uint64_t count = b->head < WINEB2B_TRACE_SPANS ? b->head : WINEB2B_TRACE_SPANS;
+        for (uint64_t i = b->head - count; i < b->head; i++)
+            all[n++] = b->spans[i % WINEB2B_TRACE_SPANS];
+        pthread_mutex_unlock(&b->lock);
+    }
+    pthread_mutex_unlock(&registry_lock);
+    *out = all;
+    *count_out = n;
+    return all ? 0 : -1;
+}
+
+static void write_thread_names(FILE* f, int pid, int* first) {
+    pthread_mutex_lock(&registry_lock);
+    for (struct buffer *b = buffers; b; b = b->next) {
+        pthread_mutex_lock(&b->lock);
+        if (!b->dead && b->thread_name[0]) {
+            fprintf(f, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%u,\"args\":{\"name\":",
+                    *first ? "" : ",", pid, b->tid);
+            write_json_string(f, b->thread_name);
+            fputs("}}", f);
+            *first = 0;
+        }
+        pthread_mutex_unlock(&b->lock);
+    }
+    pthread_mutex_unlock(&registry_lock);
+}
+
+int WINEB2B_trace_export(const char* path, uint64_t min_us) {
+    FILE *f = fopen(path, "w");
+    if (!f) {
+        perror("Error: fopen trace");
+        return -1;
+    }
+    struct span *all;
+    size_t n;
+    if (collect(&all, &n) != 0) {
+        fclose(f);
+        return -1;
+    }
+    qsort(all, n, sizeof(struct span), cmp_span);
+
+    int pid = (int)getpid();
+    int first = 1;
+    int written = 0;
+    uint64_t flow_id = 0;
+    fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[", f);
+    write_thread_names(f, pid, &first);
+    for (size_t i = 0; i < n;) {
+        size_t j = i;
+        uint64_t start = all[i].start_ns, end = all[i].end_ns;
+        while (j < n && all[j].trace == all[i].trace) {
+            if (all[j].end_ns > end)
+                end = all[j].end_ns;
+            j++;
+        }
+        if (end - start < min_us * 1000) {
+            i = j;
+            continue;
+        }
+        for (size_t k = i; k < j; k++) {
+            const struct span *s = &all[k];
+            fprintf(f, "%s\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,"
+                    "\"pid\":%d,\"tid\":%u,\"args\":{\"trace\":\"%016llx\"",
+                    first ? "" : ",", s->name, s->cat, s->start_ns / 1e3, (s->end_ns - s->start_ns) / 1e3,
+                    pid, s->tid, (unsigned long long)s->trace);
+            if (s->detail[0]) {
+                fputs(",\"detail\":", f);
+                write_json_string(f, s->detail);
+            }
+            fputs("}}", f);
+            first = 0;
+            /* Pesan berpindah thread: panah dari span sebelumnya */
+            if (k > i && all[k - 1].tid != s->tid) {
+                const struct span *p = &all[k - 1];
+                flow_id++;
+                fprintf(f, ",\n{\"name\":\"relay\",\"cat\":\"trace\",\"ph\":\"s\",\"id\":%llu,\"ts\":%.3f,\"pid\":%d,\"tid\":%u}",
+                        (unsigned long long)flow_id, p->start_ns / 1e3, pid, p->tid);
+                fprintf(f, ",\n{\"name\":\"relay\",\"cat\":\"trace\",\"ph\":\"f\",\"bp\":\"e\",\"id\":%llu,\"ts\":%.3f,\"pid\":%d,\"tid\":%u}",
+                        (unsigned long long)flow_id, s->start_ns / 1e3, pid, s->tid);
+            }
+        }
+        written++;
+        i = j;
+    }
+    fputs("\n]}\n", f);
+    free(all);
+    if (fclose(f) != 0) {
+        perror("Error: menulis trace");
+        return -1;
+    }
+    return written;
+}
+
+void WINEB2B_trace_get_stats(WINEB2B_trace_stats* out) {
+    memset(out, 0, sizeof(*out));
+    out->traces = __atomic_load_n(&traces_started, __ATOMIC_RELAXED);
+    pthread_mutex_lock(&registry_lock);
+    for (struct buffer *b = buffers; b; b = b->next) {
+        pthread_mutex_lock(&b->lock);
+        out->spans += b->head;
+        out->overwritten += b->overwritten;
+        pthread_mutex_unlock(&b->lock);
+    }
+    pthread_mutex_unlock(&registry_lock);
+}
+
+void WINEB2B_trace_reset(void) {
+    pthread_mutex_lock(&registry_lock);
+    for (struct buffer *b = buffers; b; b = b->next) {
+        pthread_mutex_lock(&b->lock);
+        b->head = 0;
+        b->overwritten = 0;
+        pthread_mutex_unlock(&b->lock);
+    }
+    pthread_mutex_unlock(&registry_lock);
+    __atomic_store_n(&traces_started, 0, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,228 @@
+#include "trigger.h"
+#include "trace.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+struct pattern {
+    char *text;         /* Pattern asli (untuk verifikasi mode case-sensitive) */
+    size_t len;
+    int id;
+    unsigned flags;
+    int32_t next;       /* Pattern lain yang berakhir di state yang sama */
+};
+
+struct _WINEB2B_trigger_set {
+    uint8_t cls[256];       /* Byte -> kelas (huruf besar dilipat ke kecil) */
+    uint32_t nclasses;
+    int32_t *delta;         /* states * nclasses */
+    int32_t *out;           /* Pattern pertama yang berakhir tepat di state, -1 jika tidak ada */
+    int32_t *dict;          /* State fail terdekat yang punya output, -1 jika tidak ada */
+    size_t nstates;
+    struct pattern *patterns;
+    size_t npatterns;
+};
+
+/* --- Fungsi Helper --- */
+static unsigned char fold(unsigned char c) {
+    return (c >= 'A' && c <= 'Z') ? (unsigned char)(c + 32) : c;
+}
+
+static int is_word_byte(unsigned char c) {
+    /* Byte >= 0x80 dianggap bagian kata agar huruf UTF-8 tidak memotong kata */
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+           (c >= '0' && c <= '9') || c == '_' || c >= 0x80;
+}
+
+static int verify(const struct pattern* p, const unsigned char* text, size_t len,
+                  size_t start, size_t end) {
+    if (!(p->flags & WINEB2B_TRIGGER_NOCASE) && memcmp(text + start, p->text, p->len) != 0)
+        return 0;
+    if (p->flags & WINEB2B_TRIGGER_WORD) {
+        if (start > 0 && is_word_byte(text[start - 1]))
+            return 0;
+        if (end < len && is_word_byte(text[end]))
+            return 0;
+    }
+    return 1;
+}
+
+/* --- Kompilasi --- */
+WINEB2B_trigger_set* WINEB2B_trigger_compile(const WINEB2B_trigger_def* defs, size_t count) {
+    if (!defs || count == 0)
+        return NULL;
+    WINEB2B_trigger_set *set = calloc(1, sizeof(WINEB2B_trigger_set));
+    if (!set)
+        return NULL;
+    set->patterns = calloc(count, sizeof(struct pattern));
+    if (!set->patterns)
+        goto fail;
+    set->npatterns = count;
+
+    /* Kelas byte: satu kelas per byte (terlipat) yang muncul di pattern, 0 = lainnya */
+    size_t max_states = 1;
+    for (size_t i = 0; i < count; i++) {
+        const char *s = defs[i].pattern;
+        if (!s || !*s) {
+            fprintf(stderr, "Error: pattern trigger kosong (id %d)\n", defs[i].id);
+            goto fail;
+        }
+        set->patterns[i].text = strdup(s);
+        if (!set->patterns[i].text)
+            goto fail;
+        set->patterns[i].len = strlen(s);
+        set->patterns[i].id = defs[i].id;
+        set->patterns[i].flags = defs[i].flags;
+        set->patterns[i].next = -1;
+        max_states += set->patterns[i].len;
+        for (const unsigned char *p = (const unsigned char*)s; *p; p++) {
+            unsigned char f = fold(*p);
+            if (!set->cls[f])
+                set->cls[f] = (uint8_t)++set->nclasses;
+        }
+    }
+    set->nclasses++;
+    for (int c = 'A'; c <= 'Z'; c++)
+        set->cls[c] = set->cls[c + 32];
+
+    size_t nc = set->nclasses;
+    set->delta = malloc(max_states * nc * sizeof(int32_t));
+    set->out = malloc(max_states * sizeof(int32_t));
+    set->dict = malloc(max_states * sizeof(int32_t));
+    int32_t *fail = malloc(max_states * sizeof(int32_t));
+    int32_t *queue = malloc(max_states * sizeof(int32_t));
+    if (!set->delta || !set->out || !set->dict || !fail || !queue) {
+        free(fail);
+        free(queue);
+        goto fail;
+    }
+    memset(set->delta, 0xff, max_states * nc * sizeof(int32_t));
+    set->nstates = 1;
+    set->out[0] = -1;
+
+    /* Trie dari pattern yang sudah dilipat */
+    for (size_t i = 0; i < count; i++) {
+        int32_t s = 0;
+        for (const unsigned char *p = (const unsigned char*)set->patterns[i].text; *p; p++) {
+            int32_t *t = &set->delta[(size_t)s * nc + set->cls[*p]];
+            if (*t < 0) {
+                *t = (int32_t)set->nstates;
+                set->out[set->nstates] = -1;
+                set->nstates++;
+            }
+            s = *t;
+        }
+        set->patterns[i].next = set->out[s];
+        set->out[s] = (int32_t)i;
+    }
+
+    /* BFS: hitung fail link dan lengkapi tabel transisi (DFA penuh) */
+    size_t qh = 0, qt = 0;
+    fail[0] = 0;
+    set->dict[0] = -1;
+    for (size_t c = 0; c < nc; c++) {
+        int32_t t = set->delta[c];
+        if (t < 0) {
+            set->delta[c] = 0;
+        } else {
+            fail[t] = 0;
+            set->dict[t] = -1;
+            queue[qt++] = t;
+        }
+    }
+    while (qh < qt) {
+        int32_t s = queue[qh++];
+        for (size_t c = 0; c < nc; c++) {
+            int32_t *t = &set->delta[(size_t)s * nc + c];
+            int32_t via_fail = set->delta[(size_t)fail[s] * nc + c];
+            if (*t < 0) {
+                *t = via_fail;
+            } else {
+                fail[*t] = via_fail;
+                set->dict[*t] = set->out[via_fail] >= 0 ? via_fail : set->dict[via_fail];
+                queue[qt++] = *t;
+            }
+        }
+    }
+    free(fail);
+    free(queue);
+    return set;
+
+fail:
+    WINEB2B_trigger_free(set);
+    return NULL;
+}
+
+/* --- Scan --- */
+static int scan(const WINEB2B_trigger_set* set, const char* text, size_t len,
+                WINEB2B_trigger_cb cb, void* user) {
+    const unsigned char *t = (const unsigned char*)text;
+    const int32_t *delta = set->delta;
+    const uint8_t *cls = set->cls;
+    size_t nc = set->nclasses;
+    int32_t s = 0;
+    int matches = 0;
+
+    for (size_t i = 0; i < len; i++) {
+        s = delta[(size_t)s * nc + cls[t[i]]];
+        if (set->out[s] < 0 && set->dict[s] < 0)
+            continue;
+        for (int32_t o = set->out[s] >= 0 ? s : set->dict[s]; o >= 0; o = set->dict[o]) {
+            for (int32_t p = set->out[o]; p >= 0; p = set->patterns[p].next) {
+                const struct pattern *pat = &set->patterns[p];
+                size_t end = i + 1, start = end - pat->len;
+                if (!verify(pat, t, len, start, end))
+                    continue;
+                matches++;
+                if (cb && cb(pat->id, start, end, user))
+                    return matches;
+            }
+        }
+    }
+    return matches;
+}
+
+int WINEB2B_trigger_scan(const WINEB2B_trigger_set* set, const char* text, size_t len,
+                         WINEB2B_trigger_cb cb, void* user) {
+    if (!set || !text)
+        return 0;
+    uint64_t trace = WINEB2B_trace_current;
+    if (!trace)
+        return scan(set, text, len, cb, user);
+    uint64_t start = WINEB2B_trace_now();
+    int matches = scan(set, text, len, cb, user);
+    WINEB2B_trace_span(trace, "b2b", "b2b.trigger", start, WINEB2B_trace_now(), NULL);
+    return matches;
+}
+
+static int stop_first(int id, size_t start, size_t end, void* user) {
+    (void)start;
+    (void)end;
+    *(int*)user = id;
+    return 1;
+}
+
+int WINEB2B_trigger_first(const WINEB2B_trigger_set* set, const char* text, size_t len) {
+    int id = -1;
+    WINEB2B_trigger_scan(set, text, len, stop_first, &id);
+    return id;
+}
+
+size_t WINEB2B_trigger_states(const WINEB2B_trigger_set* set) {
+    return set ? set->nstates : 0;
+}
+
+void WINEB2B_trigger_free(WINEB2B_trigger_set* set) {
+    if (!set)
+        return;
+    if (set->patterns) {
+        for (size_t i = 0; i < set->npatterns; i++)
+            free(set->patterns[i].text);
+    }
+    free(set->patterns);
+    free(set->delta);
+    free(set->out);
+    free(set->dict);
+    free(set);
+}
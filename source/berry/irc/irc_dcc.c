@@ -0,0 +1,555 @@
+#define _GNU_SOURCE
+#include "irc_dcc.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <time.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/sendfile.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+
+#define SEND_CHUNK  (16 * 1024 * 1024)  /* Byte per sendfile/splice ke socket */
+#define PIPE_SIZE   (1024 * 1024)       /* Kapasitas pipe untuk splice socket -> file */
+#define COPY_BUF    (256 * 1024)        /* Fallback read/write */
+
+struct _WINEIRC_dcc {
+    int lfd;                    /* Listener, -1 setelah peer diterima */
+    int fd;                     /* Koneksi data, -1 sebelum peer diterima */
+    int port;
+    unsigned char ack[4];       /* Ack masuk yang belum lengkap (pengirim) */
+    size_t ack_len;
+    uint32_t last_ack;
+    WINEIRC_dcc_stats stats;
+};
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* --- CTCP --- */
+
+static int parse_u64(const char* s, uint64_t max, uint64_t* out) {
+    if (*s < '0' || *s > '9')
+        return -1;
+    char *end;
+    errno = 0;
+    unsigned long long v = strtoull(s, &end, 10);
+    if (errno || *end || v > max)
+        return -1;
+    *out = v;
+    return 0;
+}
+
+/* Alamat SEND: bilangan 32-bit (standar) atau IPv4 bertitik (sebagian klien) */
+static int parse_ip(const char* s, uint32_t* out) {
+    struct in_addr addr;
+    uint64_t v;
+    if (strchr(s, '.')) {
+        if (inet_pton(AF_INET, s, &addr) != 1)
+            return -1;
+        *out = ntohl(addr.s_addr);
+        return 0;
+    }
+    if (parse_u64(s, UINT32_MAX, &v) != 0)
+        return -1;
+    *out = (uint32_t)v;
+    return 0;
+}
+
+/* Token berikutnya dipisah spasi; nama file boleh diapit tanda kutip */
+static char* next_token(char** p, int quoted) {
+    while (**p == ' ')
+        (*p)++;
+    if (!**p)
+        return NULL;
+    char *start = *p;
+    if (quoted && *start == '"') {
+        char *end = strchr(++start, '"');
+        if (!end)
+            return NULL;
+        *end = '\0';
+        *p = end + 1;
+        return start;
+    }
+    char *end = strchr(start, ' ');
+    if (end) {
+        *end = '\0';
+        *p = end + 1;
+    } else {
+        *p = start + strlen(start);
+    }
+    return start;
+}
+
+int WINEIRC_dcc_parse(const char* text, WINEIRC_dcc_message* out) {
+    if (!text || !out)
+        return -1;
+    char buf[1024];
+    if (*text == '\001')
+        text++;
+    size_t len = strcspn(text, "\001\r\n");
+    if (len >= sizeof(buf))
+        return -1;
+    memcpy(buf, text, len);
+    buf[len] = '\0';
+    memset(out, 0, sizeof(*out));
+
+    char *p = buf, *dcc = next_token(&p, 0), *type = next_token(&p, 0);
+    if (!dcc || !type || strcasecmp(dcc, "DCC") != 0)
+        return -1;
+    if (strcasecmp(type, "SEND") == 0)
+        out->type = WINEIRC_DCC_SEND;
+    else if (strcasecmp(type, "RESUME") == 0)
+        out->type = WINEIRC_DCC_RESUME;
+    else if (strcasecmp(type, "ACCEPT") == 0)
+        out->type = WINEIRC_DCC_ACCEPT;
+    else
+        return -1;
+
+    char *name = next_token(&p, 1);
+    if (!name)
+        return -1;
+    /* Nama dari peer tidak boleh menunjuk direktori lain */
+    char *base = name;
+    for (char *c = name; *c; c++)
+        if (*c == '/' || *c == '\\')
+            base = c + 1;
+    if (!*base || strcmp(base, ".") == 0 || strcmp(base, "..") == 0 || strlen(base) >= sizeof(out->filename))
+        return -1;
+    strcpy(out->filename, base);
+
+    uint64_t port;
+    char *field;
+    if (out->type == WINEIRC_DCC_SEND) {
+        if (!(field = next_token(&p, 0)) || parse_ip(field, &out->ip) != 0)
+            return -1;
+    }
+    if (!(field = next_token(&p, 0)) || parse_u64(field, 65535, &port) != 0)
+        return -1;
+    out->port = (int)port;
+    /* Ukuran boleh tidak ada di SEND lama */
+    if ((field = next_token(&p, 0)) != NULL) {
+        if (parse_u64(field, UINT64_MAX, &out->size) != 0)
+            return -1;
+    } else if (out->type != WINEIRC_DCC_SEND) {
+        return -1;
+    }
+    if ((field = next_token(&p, 0)) != NULL) {
+        if (strlen(field) >= sizeof(out->token))
+            return -1;
+        strcpy(out->token, field);
+    }
+    /* DCC pasif tanpa token tidak bisa dicocokkan dengan jawabannya */
+    if (out->type == WINEIRC_DCC_SEND && out->port == 0 && !out->token[0])
+        return -1;
+    return 0;
+}
+
+int WINEIRC_dcc_format(const WINEIRC_dcc_message* msg, const char* target, char* out, size_t len) {
+    if (!msg || !target || !out || !msg->filename[0])
+        return -1;
+    for (const char *c = msg->filename; *c; c++)
+        if ((unsigned char)*c < 0x20 || *c == '"')
+            return -1;
+    for (const char *c = msg->token; *c; c++)
+        if ((unsigned char)*c <= 0x20)
+            return -1;
+    const char *q = strchr(msg->filename, ' ') ? "\"" : "";
+    char tok[WINEIRC_DCC_TOKEN_MAX + 1] = "";
+    if (msg->token[0])
+        snprintf(tok, sizeof(tok), " %s", msg->token);
+    int n;
+    switch (msg->type) {
+    case WINEIRC_DCC_SEND:
+        n = snprintf(out, len, "PRIVMSG %s :\001DCC SEND %s%s%s %u %d %llu%s\001\r\n", target, q,
+                     msg->filename, q, msg->ip, msg->port, (unsigned long long)msg->size, tok);
+        break;
+    case WINEIRC_DCC_RESUME:
+    case WINEIRC_DCC_ACCEPT:
+        n = snprintf(out, len, "PRIVMSG %s :\001DCC %s %s%s%s %d %llu%s\001\r\n", target,
+                     msg->type == WINEIRC_DCC_RESUME ? "RESUME" : "ACCEPT", q, msg->filename, q,
+                     msg->port, (unsigned long long)msg->size, tok);
+        break;
+    default:
+        return -1;
+    }
+    return n < 0 || (size_t)n >= len ? -1 : n;
+}
+
+/* --- Koneksi --- */
+
+static WINEIRC_dcc* dcc_new(void) {
+    WINEIRC_dcc *dcc = calloc(1, sizeof(WINEIRC_dcc));
+    if (!dcc)
+        return NULL;
+    dcc->lfd = dcc->fd = dcc->port = -1;
+    return dcc;
+}
+
+static int wait_fd(int fd, short events, int timeout_ms) {
+    struct pollfd pfd = { fd, events, 0 };
+    int n;
+    while ((n = poll(&pfd, 1, timeout_ms)) < 0 && errno == EINTR)
+        ;
+    if (n == 0)
+        fprintf(stderr, "Error: timeout transfer DCC\n");
+    return n > 0 ? 0 : -1;
+}
+
+WINEIRC_dcc* WINEIRC_dcc_listen(const char* bind_addr, int port) {
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((uint16_t)port);
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    if (bind_addr && inet_pton(AF_INET, bind_addr, &addr.sin_addr) != 1) {
+        fprintf(stderr, "Error: alamat DCC tidak valid: %s\n", bind_addr);
+        return NULL;
+    }
+    WINEIRC_dcc *dcc = dcc_new();
+    if (!dcc)
+        return NULL;
+    int one = 1;
+    socklen_t alen = sizeof(addr);
+    dcc->lfd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (dcc->lfd < 0 || setsockopt(dcc->lfd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one)) != 0 ||
+        bind(dcc->lfd, (struct sockaddr*)&addr, sizeof(addr)) != 0 || listen(dcc->lfd, 1) != 0 ||
+        getsockname(dcc->lfd, (struct sockaddr*)&addr, &alen) != 0) {
+        perror("Error: listen DCC");
+        WINEIRC_dcc_free(dcc);
+        return NULL;
+    }
+    dcc->port = ntohs(addr.sin_port);
+    return dcc;
+}
+
+int WINEIRC_dcc_port(const WINEIRC_dcc* dcc) {
+    return dcc && dcc->lfd >= 0 ? dcc->port : -1;
+}
+
+WINEIRC_dcc* WINEIRC_dcc_connect(uint32_t ip, int port, int timeout_ms) {
+    if (port <= 0 || port > 65535)
+        return NULL;
+    WINEIRC_dcc *dcc = dcc_new();
+    if (!dcc)
+        return NULL;
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((uint16_t)port);
+    addr.sin_addr.s_addr = htonl(ip);
+    dcc->fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (dcc->fd < 0) {
+        WINEIRC_dcc_free(dcc);
+        return NULL;
+    }
+    int err = 0;
+    socklen_t elen = sizeof(err);
+    if (connect(dcc->fd, (struct sockaddr*)&addr, sizeof(addr)) != 0 &&
+        (errno != EINPROGRESS || wait_fd(dcc->fd, POLLOUT, timeout_ms) != 0 ||
+         getsockopt(dcc->fd, SOL_SOCKET, SO_ERROR, &err, &elen) != 0 || err != 0)) {
+        fprintf(stderr, "Error: koneksi DCC ke port %d gagal: %s\n", port, strerror(err ? err : errno));
+        WINEIRC_dcc_free(dcc);
+        return NULL;
+    }
+    return dcc;
+}
+
+/* Listener: peer pertama yang terhubung menjadi koneksi data */
+static int accept_peer(WINEIRC_dcc* dcc, int timeout_ms) {
+    if (dcc->fd >= 0)
+        return 0;
+    if (dcc->lfd < 0 || wait_fd(dcc->lfd, POLLIN, timeout_ms) != 0)
+        return -1;
+    dcc->fd = accept4(dcc->lfd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (dcc->fd < 0)
+        return -1;
+    close(dcc->lfd);
+    dcc->lfd = -1;
+    return 0;
+}
+
+/* --- Pengirim --- */
+
+/* Membaca ack yang sudah ada tanpa menunggu. -1 jika peer menutup */
+static int read_acks(WINEIRC_dcc* dcc) {
+    for (;;) {
+        unsigned char buf[256];
+        ssize_t n = recv(dcc->fd, buf, sizeof(buf), MSG_DONTWAIT);
+        dcc->stats.syscalls++;
+        if (n == 0)
+            return -1;
+        if (n < 0)
+            return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR ? 0 : -1;
+        for (ssize_t i = 0; i < n; i++) {
+            dcc->ack[dcc->ack_len++] = buf[i];
+            if (dcc->ack_len == 4) {
+                uint32_t v;
+                memcpy(&v, dcc->ack, 4);
+                dcc->last_ack = ntohl(v);
+                dcc->ack_len = 0;
+            }
+        }
+    }
+}
+
+static ssize_t send_copy(WINEIRC_dcc* dcc, int fd, off_t* pos, size_t chunk, int seekable, char* buf,
+                         int timeout_ms) {
+    if (chunk > COPY_BUF)
+        chunk = COPY_BUF;
+    ssize_t n = seekable ? pread(fd, buf, chunk, *pos) : read(fd, buf, chunk);
+    dcc->stats.syscalls++;
+    if (n <= 0)
+        return n;
+    for (ssize_t off = 0; off < n; ) {
+        ssize_t w = send(dcc->fd, buf + off, (size_t)(n - off), MSG_NOSIGNAL);
+        dcc->stats.syscalls++;
+        if (w < 0) {
+            if (errno == EINTR)
+                continue;
+            if ((errno != EAGAIN && errno != EWOULDBLOCK) || wait_fd(dcc->fd, POLLOUT, timeout_ms) != 0)
+                return -1;
+            continue;
+        }
+        off += w;
+    }
+    *pos += n;
+    return n;
+}
+
+int64_t WINEIRC_dcc_send_file(WINEIRC_dcc* dcc, int fd, uint64_t offset, uint64_t size, int timeout_ms) {
+    struct stat st;
+    if (!dcc || fd < 0 || offset > size || fstat(fd, &st) != 0)
+        return -1;
+    int seekable = S_ISREG(st.st_mode) || S_ISBLK(st.st_mode);
+    /* Pipe tidak bisa di-seek: resume hanya dari file */
+    if (!seekable && offset > 0)
+        return -1;
+    if (accept_peer(dcc, timeout_ms) != 0)
+        return -1;
+
+    /* sendfile untuk file, splice untuk pipe, read/send jika keduanya tidak didukung */
+    enum { MODE_SENDFILE, MODE_SPLICE, MODE_COPY } mode = S_ISFIFO(st.st_mode) ? MODE_SPLICE : MODE_SENDFILE;
+    char *buf = NULL;
+    double start = now_sec();
+    off_t pos = (off_t)offset;
+    dcc->stats.zero_copy = 1;
+    while ((uint64_t)pos < size) {
+        if (read_acks(dcc) != 0)
+            break;
+        size_t chunk = size - (uint64_t)pos > SEND_CHUNK ? SEND_CHUNK : (size_t)(size - (uint64_t)pos);
+        ssize_t n;
+        if (mode == MODE_SENDFILE) {
+            n = sendfile(dcc->fd, fd, &pos, chunk);
+        } else if (mode == MODE_SPLICE) {
+            n = splice(fd, NULL, dcc->fd, NULL, chunk, SPLICE_F_MOVE | SPLICE_F_MORE | SPLICE_F_NONBLOCK);
+            if (n > 0)
+                pos += n;
+        } else {
+            n = send_copy(dcc, fd, &pos, chunk, seekable, buf, timeout_ms);
+        }
+        if (mode != MODE_COPY)
+            dcc->stats.syscalls++;
+        if (n > 0)
+            continue;
+        if (n == 0)
+            break;      /* File lebih pendek dari size */
+        if (mode != MODE_COPY && (errno == EINVAL || errno == ENOSYS) && !buf) {
+            buf = malloc(COPY_BUF);
+            if (!buf)
+                break;
+            mode = MODE_COPY;
+            dcc->stats.zero_copy = 0;
+            continue;
+        }
+        if (errno == EINTR)
+            continue;
+        /* Pipe kosong atau socket penuh: tunggu keduanya (ack juga dibaca) */
+        if (errno != EAGAIN && errno != EWOULDBLOCK)
+            break;
+        struct pollfd pfd[2] = { { dcc->fd, POLLOUT, 0 }, { fd, POLLIN, 0 } };
+        int r = poll(pfd, mode == MODE_SPLICE ? 2 : 1, timeout_ms);
+        if (r == 0) {
+            fprintf(stderr, "Error: timeout transfer DCC\n");
+            break;
+        }
+        if (r < 0 && errno != EINTR)
+            break;
+    }
+    free(buf);
+    dcc->stats.bytes = (uint64_t)pos - offset;
+    dcc->stats.seconds = now_sec() - start;
+    if ((uint64_t)pos < size)
+        return -1;
+
+    /* Penerima sudah menulis semua byte jika ack terakhir sama dengan size.
+       Klien tanpa ack cukup menutup koneksi */
+    while (dcc->last_ack != (uint32_t)size) {
+        if (wait_fd(dcc->fd, POLLIN, timeout_ms) != 0)
+            return -1;
+        if (read_acks(dcc) != 0)
+            break;
+    }
+    dcc->stats.seconds = now_sec() - start;
+    return (int64_t)dcc->stats.bytes;
+}
+
+/* --- Penerima --- */
+
+/* Ack posisi (32 bit bawah); ack yang tidak muat di buffer socket dilewati,
+   ack berikutnya mencakupnya. Ack terakhir ditunggu sampai terkirim */
+static int send_ack(WINEIRC_dcc* dcc, uint64_t pos, int final, int timeout_ms) {
+    uint32_t v = htonl((uint32_t)pos);
+    for (;;) {
+        ssize_t n = send(dcc->fd, &v, sizeof(v), MSG_DONTWAIT | MSG_NOSIGNAL);
+        dcc->stats.syscalls++;
+        if (n == (ssize_t)sizeof(v))
+            return 0;
+        if (n >= 0)
+            return -1;  /* Ack terpotong: aliran ack tidak lagi sinkron */
+        if (errno == EINTR)
+            continue;
+        if (errno != EAGAIN && errno != EWOULDBLOCK)
+            return -1;
+        if (!final)
+            return 0;
+        if (wait_fd(dcc->fd, POLLOUT, timeout_ms) != 0)
+            return -1;
+    }
+}
+
+int64_t WINEIRC_dcc_receive_file(WINEIRC_dcc* dcc, int fd, uint64_t offset, uint64_t size, int timeout_ms) {
+    struct stat st;
+    if (!dcc || fd < 0 || (size > 0 && offset > size) || fstat(fd, &st) != 0)
+        return -1;
+    int fifo = S_ISFIFO(st.st_mode);
+    if (fifo && offset > 0)
+        return -1;
+    if (accept_peer(dcc, timeout_ms) != 0)
+        return -1;
+
+    /* splice butuh pipe di salah satu sisi: socket -> pipe -> file */
+    int pipefd[2] = { -1, -1 };
+    char *buf = NULL;
+    if (!fifo) {
+        if (pipe2(pipefd, O_CLOEXEC) == 0)
+            fcntl(pipefd[1], F_SETPIPE_SZ, PIPE_SIZE);
+        else
+            pipefd[0] = pipefd[1] = -1;
+    }
+    int zero_copy = fifo || pipefd[0] >= 0;
+    double start = now_sec();
+    loff_t pos = (loff_t)offset;
+    int eof = 0, ok = 1;
+    while (ok && (size == 0 || (uint64_t)pos < size)) {
+        size_t want = size ? (size - (uint64_t)pos > PIPE_SIZE ? PIPE_SIZE : (size_t)(size - (uint64_t)pos))
+                           : PIPE_SIZE;
+        ssize_t n;
+        if (zero_copy) {
+            n = splice(dcc->fd, NULL, fifo ? fd : pipefd[1], NULL, want,
+                       SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+        } else {
+            if (!buf && !(buf = malloc(COPY_BUF)))
+                break;
+            n = recv(dcc->fd, buf, want > COPY_BUF ? COPY_BUF : want, MSG_DONTWAIT);
+        }
+        dcc->stats.syscalls++;
+        if (n == 0) {
+            eof = 1;
+            break;
+        }
+        if (n < 0) {
+            if (zero_copy && errno == EINVAL) {
+                /* Socket atau fd tidak mendukung splice */
+                zero_copy = 0;
+                continue;
+            }
+            if (errno == EINTR)
+                continue;
+            ok = (errno == EAGAIN || errno == EWOULDBLOCK) && wait_fd(dcc->fd, POLLIN, timeout_ms) == 0;
+            continue;
+        }
+        /* Isi pipe dipindahkan ke file pada posisi pos */
+        for (ssize_t left = n; ok && left > 0; ) {
+            ssize_t w;
+            if (fifo)
+                w = left;
+            else if (zero_copy)
+                w = splice(pipefd[0], NULL, fd, &pos, (size_t)left, SPLICE_F_MOVE);
+            else
+                w = pwrite(fd, buf + (n - left), (size_t)left, pos);
+            if (!fifo)
+                dcc->stats.syscalls++;
+            if (w < 0 && errno == EINTR)
+                continue;
+            if (w < 0 && errno == EINVAL && zero_copy && !fifo) {
+                /* File tidak mendukung splice (misal O_APPEND): isi pipe
+                   dipindah lewat buffer, sisa transfer tanpa splice */
+                if (!buf && !(buf = malloc(COPY_BUF))) {
+                    ok = 0;
+                    break;
+                }
+                w = read(pipefd[0], buf, (size_t)left > COPY_BUF ? COPY_BUF : (size_t)left);
+                if (w > 0 && pwrite(fd, buf, (size_t)w, pos) != w)
+                    w = -1;
+                dcc->stats.syscalls += 2;
+                if (w <= 0) {
+                    ok = 0;
+                    break;
+                }
+                pos += w;
+                left -= w;
+                if (!left)
+                    zero_copy = 0;
+                continue;
+            }
+            if (w <= 0) {
+                ok = 0;
+                break;
+            }
+            if (fifo || !zero_copy)
+                pos += w;
+            left -= w;
+        }
+        if (ok)
+            ok = send_ack(dcc, (uint64_t)pos, size && (uint64_t)pos == size, timeout_ms) == 0;
+    }
+    if (pipefd[0] >= 0) {
+        close(pipefd[0]);
+        close(pipefd[1]);
+    }
+    free(buf);
+    dcc->stats.zero_copy = zero_copy;
+    dcc->stats.bytes = (uint64_t)pos - offset;
+    dcc->stats.seconds = now_sec() - start;
+    if (!ok || (size && (uint64_t)pos < size) || (!size && !eof))
+        return -1;
+    return (int64_t)dcc->stats.bytes;
+}
+
+void WINEIRC_dcc_get_stats(const WINEIRC_dcc* dcc, WINEIRC_dcc_stats* out) {
+    if (!out)
+        return;
+    memset(out, 0, sizeof(*out));
+    if (dcc)
+        *out = dcc->stats;
+}
+
+void WINEIRC_dcc_free(WINEIRC_dcc* dcc) {
+    if (!dcc)
+        return;
+    if (dcc->lfd >= 0)
+        close(dcc->lfd);
+    if (dcc->fd >= 0)
+        close(dcc->fd);
+    free(dcc);
+}
@@ -1,4 +1,7 @@
 #include "irc_driver.h"
+#include "irc_parser.h"
+#include "log.h"
+#include "trace.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -9,6 +12,12 @@
 #include <sys/socket.h>
 #include <sys/types.h>
 #include <sys/time.h>
+#include <poll.h>
+#include <time.h>
+#include <openssl/crypto.h>
+
+#define SASL_TIMEOUT_MS 15000
+#define SASL_CHUNK      400     /* Panjang maksimum satu potongan AUTHENTICATE */
 
 /* --- Global Init & Cleanup --- */
 
@@ -19,6 +28,7 @@ WINEIRCcode WINEIRC_global_init(void) {
 }
 
 WINEIRCcode WINEIRC_global_cleanup(void) {
+    WINEIRC_tls_cleanup();
     return 0;
 }
 
@@ -51,12 +61,336 @@ static int create_connection(const char* server, int port) {
     return sockfd;
 }
 
+/* --- Fungsi Helper: Transport (TCP biasa atau TLS) --- */
+static int open_transport(WINEIRC_handle* handle) {
+    handle->socket_fd = create_connection(handle->server, handle->port);
+    if (handle->socket_fd < 0)
+        return -1;
+    if (handle->use_tls) {
+        handle->tls = WINEIRC_tls_connect(handle->socket_fd, handle->server, handle->port, &handle->tls_options);
+        if (!handle->tls) {
+            close(handle->socket_fd);
+            handle->socket_fd = -1;
+            return -1;
+        }
+    }
+    handle->is_connected = 1;
+    return 0;
+}
+
+static void close_transport(WINEIRC_handle* handle) {
+    WINEIRC_tls_close(handle->tls);
+    handle->tls = NULL;
+    if (handle->socket_fd >= 0)
+        close(handle->socket_fd);
+    handle->socket_fd = -1;
+    handle->is_connected = 0;
+}
+
+/* Mengirim seluruh buffer; -1 jika gagal */
+static ssize_t transport_send(WINEIRC_handle* handle, const void* buf, size_t len) {
+    if (handle->tls) {
+        ssize_t n = WINEIRC_tls_send(handle->tls, buf, len);
+        if (n > 0)
+            WINEB2B_metrics_add(handle->metrics, WINEB2B_METRIC_BYTES_OUT, (uint64_t)n);
+        return n;
+    }
+    const char *p = buf;
+    size_t off = 0;
+    while (off < len) {
+        ssize_t n = send(handle->socket_fd, p + off, len - off, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+        off += (size_t)n;
+    }
+    WINEB2B_metrics_add(handle->metrics, WINEB2B_METRIC_BYTES_OUT, len);
+    return (ssize_t)len;
+}
+
+static ssize_t transport_recv(WINEIRC_handle* handle, void* buf, size_t len, int flags) {
+    ssize_t n = handle->tls ? WINEIRC_tls_recv(handle->tls, buf, len, flags)
+                            : recv(handle->socket_fd, buf, len, flags);
+    /* MSG_PEEK tidak mengonsumsi data; byte dihitung saat dibaca sungguhan */
+    if (n > 0 && !(flags & MSG_PEEK))
+        WINEB2B_metrics_add(handle->metrics, WINEB2B_METRIC_BYTES_IN, (uint64_t)n);
+    return n;
+}
+
+static int send_line(WINEIRC_handle* handle, const char* line) {
+    return transport_send(handle, line, strlen(line)) < 0 ? -1 : 0;
+}
+
+static long now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000L + ts.tv_nsec / 1000000L;
+}
+
+/* --- Fungsi Helper: Membaca satu baris selama registrasi ---
+     Data diintip dulu (MSG_PEEK) dan hanya byte sampai '\n' yang diambil,
+     sehingga baris sesudah registrasi tetap di socket untuk aplikasi.
+     Baris yang lebih panjang dari buffer dipotong. */
+static int recv_line(WINEIRC_handle* handle, char* line, size_t len, long deadline_ms) {
+    size_t used = 0;
+    char chunk[512];
+    while (1) {
+        long left = deadline_ms - now_ms();
+        if (left <= 0) {
+            fprintf(stderr, "Error: timeout menunggu balasan server\n");
+            return -1;
+        }
+        /* Data TLS yang sudah didekripsi tidak membuat socket readable */
+        if (WINEIRC_tls_pending(handle->tls) == 0) {
+            struct pollfd pfd = { handle->socket_fd, POLLIN, 0 };
+            if (poll(&pfd, 1, (int)left) <= 0)
+                continue;
+        }
+        ssize_t n = transport_recv(handle, chunk, sizeof(chunk), MSG_PEEK);
+        if (n <= 0) {
+            if (n < 0 && errno == EINTR)
+                continue;
+            return -1;
+        }
+        char *nl = memchr(chunk, '\n', (size_t)n);
+        size_t take = nl ? (size_t)(nl - chunk) + 1 : (size_t)n;
+        if (transport_recv(handle, chunk, take, 0) != (ssize_t)take)
+            return -1;
+        size_t copy = take < len - 1 - used ? take : len - 1 - used;
+        memcpy(line + used, chunk, copy);
+        used += copy;
+        if (nl) {
+            while (used > 0 && (line[used - 1] == '\n' || line[used - 1] == '\r'))
+                used--;
+            line[used] = '\0';
+            return (int)used;
+        }
+    }
+}
+
+/* Mengecek apakah daftar capability (dipisah spasi) memuat cap, termasuk "cap=nilai" */
+static int has_cap(const char* caps, const char* cap) {
+    size_t len = strlen(cap);
+    for (const char *p = caps; *p; ) {
+        size_t tok = strcspn(p, " ");
+        if (tok >= len && strncmp(p, cap, len) == 0 && (tok == len || p[len] == '='))
+            return 1;
+        p += tok;
+        while (*p == ' ')
+            p++;
+    }
+    return 0;
+}
+
+/* Mengirim response AUTHENTICATE (base64) dalam potongan 400 karakter.
+   Response kosong atau yang panjangnya kelipatan 400 diakhiri "+" */
+static int send_authenticate(WINEIRC_handle* handle, const char* b64) {
+    char buffer[SASL_CHUNK + 32];
+    size_t len = strlen(b64);
+    for (size_t off = 0; ; off += SASL_CHUNK) {
+        size_t chunk = len - off > SASL_CHUNK ? SASL_CHUNK : len - off;
+        if (chunk == 0)
+            snprintf(buffer, sizeof(buffer), "AUTHENTICATE +\r\n");
+        else
+            snprintf(buffer, sizeof(buffer), "AUTHENTICATE %.*s\r\n", (int)chunk, b64 + off);
+        if (send_line(handle, buffer) != 0)
+            return -1;
+        if (chunk < SASL_CHUNK)
+            return 0;
+    }
+}
+
+/* Satu langkah SCRAM; challenge adalah pesan server yang sudah di-decode */
+static int scram_step(WINEIRC_handle* handle, WINEIRC_scram* scram, int* step, const char* challenge) {
+    char msg[1024], b64[1400];
+    int n;
+    switch ((*step)++) {
+    case 0:
+        n = WINEIRC_scram_client_first(scram, msg, sizeof(msg));
+        break;
+    case 1:
+        n = WINEIRC_scram_client_final(scram, challenge, msg, sizeof(msg));
+        break;
+    case 2:
+        /* server-final: tanda tangan server harus cocok sebelum login diterima */
+        if (WINEIRC_scram_verify_server(scram, challenge) != 0)
+            return -1;
+        return send_authenticate(handle, "");
+    default:
+        return -1;
+    }
+    if (n < 0 || WINEIRC_base64_encode((const unsigned char*)msg, (size_t)n, b64, sizeof(b64)) < 0)
+        return -1;
+    return send_authenticate(handle, b64);
+}
+
+/* --- Fungsi Helper: Negosiasi SASL (IRCv3 sasl) ---
+     Dipanggil setelah CAP REQ :sasl, NICK dan USER terkirim; selesai saat
+     server mengirim 903. PING dijawab selama menunggu. */
+static int negotiate_sasl(WINEIRC_handle* handle) {
+    const char *mech = WINEIRC_sasl_mechanism_name(handle->sasl_mechanism);
+    WINEIRC_scram *scram = NULL;
+    char line[1024], buffer[600];
+    char challenge[2048];
+    size_t challenge_len = 0;
+    int step = 0, result = -1;
+    long deadline = now_ms() + SASL_TIMEOUT_MS;
+
+    if (handle->sasl_mechanism == WINEIRC_SASL_SCRAM_SHA_256) {
+        scram = WINEIRC_scram_create(handle->sasl_account, handle->sasl_password, NULL);
+        if (!scram)
+            return -1;
+    }
+
+    while (recv_line(handle, line, sizeof(line), deadline) >= 0) {
+        WINEIRC_message msg;
+        if (WINEIRC_parse_line(line, &msg) != 0)
+            continue;
+        const char *last = msg.param_count > 0 ? msg.params[msg.param_count - 1] : "";
+
+        if (strcmp(msg.command, "PING") == 0) {
+            snprintf(buffer, sizeof(buffer), "PONG :%s\r\n", last);
+            if (send_line(handle, buffer) != 0)
+                break;
+        } else if (strcmp(msg.command, "CAP") == 0 && msg.param_count >= 3) {
+            if (strcmp(msg.params[1], "ACK") == 0 && has_cap(last, "sasl")) {
+                snprintf(buffer, sizeof(buffer), "AUTHENTICATE %s\r\n", mech);
+                if (send_line(handle, buffer) != 0)
+                    break;
+            } else if (strcmp(msg.params[1], "NAK") == 0 && has_cap(last, "sasl")) {
+                fprintf(stderr, "Error: server tidak mendukung SASL\n");
+                break;
+            }
+        } else if (strcmp(msg.command, "AUTHENTICATE") == 0 && msg.param_count >= 1) {
+            /* Challenge panjang dikirim per 400 karakter */
+            size_t len = strlen(msg.params[0]);
+            if (strcmp(msg.params[0], "+") != 0) {
+                if (challenge_len + len >= sizeof(challenge))
+                    break;
+                memcpy(challenge + challenge_len, msg.params[0], len);
+                challenge_len += len;
+            }
+            if (len == SASL_CHUNK)
+                continue;
+
+            int rc;
+            if (handle->sasl_mechanism == WINEIRC_SASL_PLAIN) {
+                char b64[1400];
+                rc = WINEIRC_sasl_plain(handle->sasl_account, handle->sasl_password, b64, sizeof(b64));
+                if (rc >= 0)
+                    rc = send_authenticate(handle, b64);
+                OPENSSL_cleanse(b64, sizeof(b64));
+            } else if (handle->sasl_mechanism == WINEIRC_SASL_EXTERNAL) {
+                rc = send_authenticate(handle, "");
+            } else {
+                unsigned char decoded[sizeof(challenge)];
+                int n = challenge_len ? WINEIRC_base64_decode(challenge, challenge_len,
+                                                              decoded, sizeof(decoded) - 1) : 0;
+                if (n < 0) {
+                    rc = -1;
+                } else {
+                    decoded[n] = '\0';
+                    rc = scram_step(handle, scram, &step, (const char*)decoded);
+                }
+            }
+            challenge_len = 0;
+            if (rc != 0) {
+                send_line(handle, "AUTHENTICATE *\r\n");
+                fprintf(stderr, "Error: pertukaran SASL %s gagal\n", mech);
+                break;
+            }
+        } else if (strcmp(msg.command, "903") == 0) {
+            /* SCRAM hanya diterima jika server juga sudah membuktikan dirinya */
+            if (!scram || step == 3)
+                result = 0;
+            else
+                fprintf(stderr, "Error: server tidak mengirim server-final SCRAM\n");
+            break;
+        } else if (strcmp(msg.command, "902") == 0 || strcmp(msg.command, "904") == 0 ||
+                   strcmp(msg.command, "905") == 0 || strcmp(msg.command, "906") == 0 ||
+                   strcmp(msg.command, "907") == 0 || strcmp(msg.command, "908") == 0) {
+            fprintf(stderr, "Error: SASL %s ditolak (%s): %s\n", mech, msg.command, last);
+            break;
+        } else if (strcmp(msg.command, "ERROR") == 0) {
+            fprintf(stderr, "Error: server menutup koneksi: %s\n", last);
+            break;
+        }
+    }
+    WINEIRC_scram_free(scram);
+    return result;
+}
+
+static void request_history_caps(WINEIRC_handle* handle) {
+    send_line(handle, "CAP REQ :batch\r\n");
+    send_line(handle, "CAP REQ :server-time\r\n");
+    send_line(handle, "CAP REQ :draft/chathistory\r\n");
+}
+
+/* --- Fungsi Helper: Mengirim urutan registrasi (CAP, NICK, USER) ---
+     CAP message-tags diminta agar pesan hasil relay bisa membawa tag
+     origin; server yang tidak mendukung CAP cukup mengabaikannya.
+     Dengan catch-up history, batch, server-time dan draft/chathistory
+     diminta satu per satu agar NAK salah satunya tidak menolak yang lain.
+     Jika SASL dikonfigurasi, CAP END baru dikirim setelah login berhasil. */
+static int send_registration(WINEIRC_handle* handle) {
+    char buffer[512];
+    int sasl = handle->sasl_mechanism != WINEIRC_SASL_NONE;
+    snprintf(buffer, sizeof(buffer), "CAP REQ :message-tags\r\n");
+    send_line(handle, buffer);
+    if (sasl) {
+        /* Diminta terpisah: NAK untuk message-tags tidak ikut menolak sasl */
+        snprintf(buffer, sizeof(buffer), "CAP REQ :sasl\r\n");
+        send_line(handle, buffer);
+    }
+    if (handle->history)
+        request_history_caps(handle);
+    snprintf(buffer, sizeof(buffer), "NICK %s\r\n", handle->nick);
+    send_line(handle, buffer);
+    snprintf(buffer, sizeof(buffer), "USER %s 0 * :%s\r\n", handle->user, handle->user);
+    send_line(handle, buffer);
+    if (sasl && negotiate_sasl(handle) != 0)
+        return -1;
+    snprintf(buffer, sizeof(buffer), "CAP END\r\n");
+    send_line(handle, buffer);
+    return 0;
+}
+
 /* --- Membuat Handle IRC dan Melakukan Login serta Join Channel --- */
 WINEIRC_handle* WINEIRC_create(const char* server, int port,
                                const char* nick,
                                const char* user,
                                const char* channel) {
-    WINEIRC_handle* handle = malloc(sizeof(WINEIRC_handle));
+    return WINEIRC_create_tls(server, port, nick, user, channel, NULL, NULL);
+}
+
+WINEIRC_handle* WINEIRC_create_sasl(const char* server, int port,
+                                    const char* nick,
+                                    const char* user,
+                                    const char* channel,
+                                    const WINEIRC_sasl* sasl) {
+    return WINEIRC_create_tls(server, port, nick, user, channel, NULL, sasl);
+}
+
+static char* dup_or_null(const char* s) {
+    return s ? strdup(s) : NULL;
+}
+
+/* Alokasi handle dan salinan konfigurasi, tanpa membuka koneksi */
+static WINEIRC_handle* handle_new(const char* server, int port,
+                                  const char* nick,
+                                  const char* user,
+                                  const char* channel,
+                                  const WINEIRC_tls_options* tls,
+                                  const WINEIRC_sasl* sasl) {
+    if (sasl && sasl->mechanism != WINEIRC_SASL_NONE &&
+        (!WINEIRC_sasl_mechanism_name(sasl->mechanism) ||
+         (sasl->mechanism != WINEIRC_SASL_EXTERNAL && (!sasl->account || !sasl->password)))) {
+        fprintf(stderr, "Error: konfigurasi SASL tidak valid\n");
+        return NULL;
+    }
+    WINEIRC_handle* handle = calloc(1, sizeof(WINEIRC_handle));
     if (!handle)
         return NULL;
 
@@ -66,20 +400,47 @@ WINEIRC_handle* WINEIRC_create(const char* server, int port,
     handle->user = strdup(user);
     handle->channel = strdup(channel);
     handle->is_connected = 0;
+    handle->socket_fd = -1;
+    handle->loop_slot = -1;
+    char instance[512];
+    snprintf(instance, sizeof(instance), "%s:%d/%s", server, port, nick);
+    handle->metrics = WINEB2B_metrics_create("irc", instance);
+    if (sasl && sasl->mechanism != WINEIRC_SASL_NONE) {
+        handle->sasl_mechanism = sasl->mechanism;
+        handle->sasl_account = dup_or_null(sasl->account);
+        handle->sasl_password = dup_or_null(sasl->password);
+    }
+    if (tls) {
+        /* Salinan opsi TLS agar reconnect tidak bergantung pada memori pemanggil */
+        handle->use_tls = 1;
+        handle->tls_options = *tls;
+        handle->tls_options.ca_file = dup_or_null(tls->ca_file);
+        handle->tls_options.cert_file = dup_or_null(tls->cert_file);
+        handle->tls_options.key_file = dup_or_null(tls->key_file);
+    }
+    return handle;
+}
+
+WINEIRC_handle* WINEIRC_create_tls(const char* server, int port,
+                                   const char* nick,
+                                   const char* user,
+                                   const char* channel,
+                                   const WINEIRC_tls_options* tls,
+                                   const WINEIRC_sasl* sasl) {
+    WINEIRC_handle* handle = handle_new(server, port, nick, user, channel, tls, sasl);
+    if (!handle)
+        return NULL;
 
-    handle->socket_fd = create_connection(server, port);
-    if (handle->socket_fd < 0) {
+    if (open_transport(handle) != 0) {
         WINEIRC_free(handle);
         return NULL;
     }
-    handle->is_connected = 1;
 
-    /* Kirim perintah login IRC: NICK dan USER dengan parameter lengkap */
-    char buffer[512];
-    snprintf(buffer, sizeof(buffer), "NICK %s\r\n", nick);
-    send(handle->socket_fd, buffer, strlen(buffer), 0);
-    snprintf(buffer, sizeof(buffer), "USER %s 0 * :%s\r\n", user, user);
-    send(handle->socket_fd, buffer, strlen(buffer), 0);
+    /* Kirim perintah login IRC: CAP/SASL, NICK dan USER dengan parameter lengkap */
+    if (send_registration(handle) != 0) {
+        WINEIRC_free(handle);
+        return NULL;
+    }
 
     /* Langsung join ke channel */
     WINEIRC_join_channel(handle);
@@ -87,32 +448,142 @@ WINEIRC_handle* WINEIRC_create(const char* server, int port,
     return handle;
 }
 
+/* --- Membuat Handle dari Socket yang Sudah Login (handover) --- */
+WINEIRC_handle* WINEIRC_create_fd(int fd, const char* server, int port,
+                                  const char* nick,
+                                  const char* user,
+                                  const char* channel,
+                                  const WINEIRC_tls_options* tls,
+                                  const WINEIRC_sasl* sasl) {
+    if (fd < 0)
+        return NULL;
+    WINEIRC_handle* handle = handle_new(server, port, nick, user, channel, tls, sasl);
+    if (!handle)
+        return NULL;
+    handle->socket_fd = fd;
+    handle->is_connected = 1;
+    return handle;
+}
+
 /* --- Mengirim Perintah JOIN ke Channel --- */
 WINEIRCcode WINEIRC_join_channel(WINEIRC_handle* handle) {
     if (!handle || !handle->is_connected)
         return -1;
     char buffer[512];
     snprintf(buffer, sizeof(buffer), "JOIN %s\r\n", handle->channel);
-    if (send(handle->socket_fd, buffer, strlen(buffer), 0) < 0) {
+    if (send_line(handle, buffer) != 0) {
         perror("Error mengirim perintah JOIN");
         return -1;
     }
     return 0;
 }
 
+/* Mencatat pesan keluar di filter echo agar pantulannya tidak direlay lagi */
+static void note_echo(WINEIRC_handle* handle, const char* message) {
+    if (!handle->echo)
+        return;
+    char network[300];
+    snprintf(network, sizeof(network), "irc:%s", handle->server ? handle->server : "");
+    WINEB2B_echo_note(handle->echo, network, handle->channel, message);
+}
+
 /* --- Mengirim Pesan ke Channel IRC --- */
 WINEIRCcode WINEIRC_send_message(WINEIRC_handle* handle, const char* message) {
     if (!handle || !handle->is_connected)
         return -1;
     char buffer[512];
     snprintf(buffer, sizeof(buffer), "PRIVMSG %s :%s\r\n", handle->channel, message);
-    if (send(handle->socket_fd, buffer, strlen(buffer), 0) < 0) {
+    WINEB2B_metrics_add(handle->metrics, WINEB2B_METRIC_SENDS_QUEUED, 1);
+    uint64_t trace = WINEB2B_trace_current;
+    uint64_t start = trace ? WINEB2B_trace_now() : 0;
+    if (send_line(handle, buffer) != 0) {
+        WINEB2B_metrics_add(handle->metrics, WINEB2B_METRIC_SENDS_FAILED, 1);
         perror("Error mengirim pesan");
         return -1;
     }
+    WINEB2B_metrics_add(handle->metrics, WINEB2B_METRIC_SENDS_DONE, 1);
+    note_echo(handle, message);
+    if (trace)
+        WINEB2B_trace_span(trace, "irc", "irc.send", start, WINEB2B_trace_now(), handle->channel);
     return 0;
 }
 
+/* --- Mengirim Pesan dengan Tag IRCv3 (client-only tag, butuh CAP message-tags) --- */
+WINEIRCcode WINEIRC_send_tagged_message(WINEIRC_handle* handle, const char* tags, const char* message) {
+    if (!handle || !handle->is_connected)
+        return -1;
+    if (!tags || !*tags)
+        return WINEIRC_send_message(handle, message);
+    /* Bagian tag boleh sampai 4094 byte di luar batas 512 byte pesan */
+    char buffer[4608];
+    int len = snprintf(buffer, sizeof(buffer), "@%s PRIVMSG %s :%s\r\n", tags, handle->channel, message);
+    if (len < 0 || (size_t)len >= sizeof(buffer)) {
+        fprintf(stderr, "Error: pesan bertag terlalu panjang\n");
+        return -1;
+    }
+    WINEB2B_metrics_add(handle->metrics, WINEB2B_METRIC_SENDS_QUEUED, 1);
+    if (transport_send(handle, buffer, len) < 0) {
+        WINEB2B_metrics_add(handle->metrics, WINEB2B_METRIC_SENDS_FAILED, 1);
+        perror("Error mengirim pesan");
+        return -1;
+    }
+    WINEB2B_metrics_add(handle->metrics, WINEB2B_METRIC_SENDS_DONE, 1);
+    note_echo(handle, message);
+    return 0;
+}
+
+/* --- Fungsi Helper: Membuka koneksi baru, login ulang (termasuk SASL)
+     dan join channel dengan perintah USER yang lengkap --- */
+static int reconnect(WINEIRC_handle* handle) {
+    close_transport(handle);
+    WINEIRC_history_disconnected(handle->history);
+    WINEB2B_metrics_add(handle->metrics, WINEB2B_METRIC_RECONNECTS, 1);
+    /* Dengan TLS, sesi dari koneksi sebelumnya membuat handshake ini singkat */
+    if (open_transport(handle) != 0)
+        return -1;
+    if (send_registration(handle) != 0) {
+        close_transport(handle);
+        return -1;
+    }
+    /* Channel di-join ulang; daftar anggota diisi lagi dari NAMES dan
+       pesan yang terlewat diminta setelah NAMES selesai */
+    WINEIRC_members_reset(handle->members);
+    WINEIRC_join_channel(handle);
+    return 0;
+}
+
+WINEIRCcode WINEIRC_reconnect(WINEIRC_handle* handle) {
+    if (!handle)
+        return -1;
+    return reconnect(handle);
+}
+
+/* Baris lengkap di keep_alive diteruskan ke catch-up history; permintaan
+   CHATHISTORY langsung dikirim, baris live yang dilepas tidak dipakai */
+static void keep_alive_history(WINEIRC_handle* handle, char* pending, size_t* pending_len, size_t cap,
+                               const char* data, size_t len) {
+    char out[WINEIRC_LINE_MAX];
+    if (*pending_len + len > cap)
+        *pending_len = 0;   /* Baris terlalu panjang: dibuang */
+    memcpy(pending + *pending_len, data, len);
+    *pending_len += len;
+    char *start = pending, *end = pending + *pending_len, *nl;
+    while ((nl = memchr(start, '\n', (size_t)(end - start))) != NULL) {
+        *nl = '\0';
+        if (nl > start && nl[-1] == '\r')
+            nl[-1] = '\0';
+        if (*start)
+            WINEIRC_history_feed_line(handle->history, start);
+        start = nl + 1;
+    }
+    *pending_len = (size_t)(end - start);
+    memmove(pending, start, *pending_len);
+    while (WINEIRC_history_next_request(handle->history, out, sizeof(out)) > 0)
+        send_line(handle, out);
+    while (WINEIRC_history_next_released(handle->history, out, sizeof(out)) != 0)
+        ;
+}
+
 /* --- Fungsi Keep-Alive Alternatif ---
      Fungsi ini memonitor koneksi menggunakan select().
      Jika koneksi terputus (misal karena tidak ada reply terhadap PING),
@@ -129,6 +600,8 @@ WINEIRCcode WINEIRC_keep_alive(WINEIRC_handle* handle) {
     fd_set read_fds;
     struct timeval tv;
     int n;
+    char *lines = handle->history ? malloc(WINEIRC_LINE_MAX) : NULL;
+    size_t lines_len = 0;
 
     while (1) {
         FD_ZERO(&read_fds);
@@ -136,7 +609,11 @@ WINEIRCcode WINEIRC_keep_alive(WINEIRC_handle* handle) {
         tv.tv_sec = 10;   /* Timeout tiap 10 detik */
         tv.tv_usec = 0;
 
-        n = select(handle->socket_fd + 1, &read_fds, NULL, NULL, &tv);
+        /* Data TLS yang sudah didekripsi tidak terlihat oleh select() */
+        if (WINEIRC_tls_pending(handle->tls) > 0)
+            n = 1;
+        else
+            n = select(handle->socket_fd + 1, &read_fds, NULL, NULL, &tv);
         if (n < 0) {
             perror("select error");
             break;
@@ -144,40 +621,41 @@ WINEIRCcode WINEIRC_keep_alive(WINEIRC_handle* handle) {
             /* Timeout: tidak ada data diterima, lanjutkan monitoring */
             continue;
         } else {
-            if (FD_ISSET(handle->socket_fd, &read_fds)) {
-                int bytes = recv(handle->socket_fd, buffer, sizeof(buffer) - 1, 0);
+            if (FD_ISSET(handle->socket_fd, &read_fds) || WINEIRC_tls_pending(handle->tls) > 0) {
+                /* Setiap pembacaan dianggap satu pesan untuk trace */
+                uint64_t trace = WINEB2B_trace_begin();
+                uint64_t start = trace ? WINEB2B_trace_now() : 0;
+                int bytes = transport_recv(handle, buffer, sizeof(buffer) - 1, 0);
                 if (bytes <= 0) {
-                    /* Koneksi terputus, lakukan reconnect */
-                    fprintf(stderr, "Koneksi hilang. Mencoba reconnect...\n");
-                    close(handle->socket_fd);
-                    handle->is_connected = 0;
-                    /* Coba reconnect */
-                    handle->socket_fd = create_connection(handle->server, handle->port);
-                    if (handle->socket_fd < 0) {
-                        fprintf(stderr, "Reconnect gagal. Coba lagi dalam 5 detik...\n");
+                    WINEB2B_trace_end();
+                    /* Koneksi terputus, lakukan reconnect sampai berhasil */
+                    WINEB2B_LOG_WARN("irc", "event=disconnected server=%s action=reconnect", handle->server);
+                    while (reconnect(handle) != 0) {
+                        WINEB2B_LOG_WARN("irc", "event=reconnect_failed server=%s retry_s=5", handle->server);
                         sleep(5);
-                        continue;
                     }
-                    handle->is_connected = 1;
-                    /* Login ulang dan join channel dengan perintah USER yang lengkap */
-                    char init_cmd[512];
-                    snprintf(init_cmd, sizeof(init_cmd), "NICK %s\r\n", handle->nick);
-                    send(handle->socket_fd, init_cmd, strlen(init_cmd), 0);
-                    snprintf(init_cmd, sizeof(init_cmd), "USER %s 0 * :%s\r\n", handle->user, handle->user);
-                    send(handle->socket_fd, init_cmd, strlen(init_cmd), 0);
-                    WINEIRC_join_channel(handle);
+                    lines_len = 0;
                     continue;
                 }
                 buffer[bytes] = '\0';
+                if (lines)
+                    keep_alive_history(handle, lines, &lines_len, WINEIRC_LINE_MAX, buffer, (size_t)bytes);
+                uint64_t received = trace ? WINEB2B_trace_now() : 0;
+                if (trace)
+                    WINEB2B_trace_span(trace, "irc", "irc.recv", start, received, handle->server);
                 /* Jika pesan dimulai dengan PING, abaikan (tanpa membalas) */
                 if (strncmp(buffer, "PING", 4) == 0) {
-                    fprintf(stdout, "Terima PING (diabaikan): %s", buffer);
+                    WINEB2B_LOG_DEBUG("irc", "event=ping_ignored server=%s line=%s", handle->server, buffer);
                 } else {
-                    fprintf(stdout, "Server: %s", buffer);
+                    WINEB2B_LOG_DEBUG("irc", "event=rx server=%s bytes=%d data=%s", handle->server, bytes, buffer);
                 }
+                if (trace)
+                    WINEB2B_trace_span(trace, "irc", "irc.handle", received, WINEB2B_trace_now(), NULL);
+                WINEB2B_trace_end();
             }
         }
     }
+    free(lines);
     return 0;
 }
 
@@ -188,13 +666,93 @@ WINEIRCcode WINEIRC_disconnect(WINEIRC_handle* handle) {
     if (handle->is_connected) {
         char buffer[512];
         snprintf(buffer, sizeof(buffer), "QUIT\r\n");
-        send(handle->socket_fd, buffer, strlen(buffer), 0);
-        close(handle->socket_fd);
-        handle->is_connected = 0;
+        send_line(handle, buffer);
+        close_transport(handle);
     }
     return 0;
 }
 
+/* --- Melepas Socket tanpa QUIT (handover ke proses lain) --- */
+WINEIRCcode WINEIRC_abandon(WINEIRC_handle* handle) {
+    if (!handle)
+        return -1;
+    WINEIRC_tls_abandon(handle->tls);
+    handle->tls = NULL;
+    close_transport(handle);
+    return 0;
+}
+
+/* --- Pelacakan Anggota Channel --- */
+WINEIRCcode WINEIRC_track_members(WINEIRC_handle* handle, const WINEIRC_members_callbacks* callbacks,
+                                  void* user_data) {
+    if (!handle)
+        return -1;
+    WINEIRC_members *members = WINEIRC_members_create(handle->nick, callbacks, user_data);
+    if (!members) {
+        fprintf(stderr, "Error: gagal membuat daftar anggota channel\n");
+        return -1;
+    }
+    WINEIRC_members_free(handle->members);
+    handle->members = members;
+    return 0;
+}
+
+/* --- Catch-up Pesan Setelah Reconnect --- */
+WINEIRCcode WINEIRC_track_history(WINEIRC_handle* handle, const WINEIRC_history_config* config,
+                                  const WINEIRC_history_callbacks* callbacks, void* user_data) {
+    if (!handle)
+        return -1;
+    WINEIRC_history *history = WINEIRC_history_create(handle->nick, config, callbacks, user_data);
+    if (!history) {
+        fprintf(stderr, "Error: gagal membuat pelacak history channel\n");
+        return -1;
+    }
+    WINEIRC_history_free(handle->history);
+    handle->history = history;
+    if (handle->is_connected)
+        request_history_caps(handle);
+    return 0;
+}
+
+/* --- Indeks Pencarian Pesan --- */
+WINEIRCcode WINEIRC_index_messages(WINEIRC_handle* handle, WINEB2B_search* search) {
+    if (!handle)
+        return -1;
+    handle->search = search;
+    return 0;
+}
+
+/* --- Filter echo bridge --- */
+WINEIRCcode WINEIRC_filter_echoes(WINEIRC_handle* handle, WINEB2B_echo_filter* echo) {
+    if (!handle)
+        return -1;
+    handle->echo = echo;
+    return 0;
+}
+
+/* --- ID pesan untuk indeks msgid --- */
+WINEIRCcode WINEIRC_message_id(const WINEIRC_handle* handle, const WINEIRC_message* msg, char* out, size_t out_len) {
+    if (!handle || !msg || !out || msg->param_count < 2)
+        return -1;
+    const char *msgid = WINEIRC_message_tag(msg, "msgid");
+    if (msgid && *msgid && strlen(msgid) <= WINEB2B_MSGID_MAX)
+        return (size_t)snprintf(out, out_len, "%s", msgid) < out_len ? 0 : -1;
+    char nick[64] = "";
+    if (msg->prefix)
+        WINEIRC_prefix_nick(msg->prefix, nick, sizeof(nick));
+    int64_t time_ms = WINEIRC_server_time(WINEIRC_message_tag(msg, "time"));
+    if (time_ms == 0)
+        time_ms = (int64_t)time(NULL) * 1000;
+    return WINEB2B_msgid_synthetic(out, out_len, handle->server, msg->params[0], nick, (long)time_ms, msg->params[1]);
+}
+
+/* --- Membaca Data dari Server (TCP biasa atau TLS) --- */
+ssize_t WINEIRC_recv(WINEIRC_handle* handle, void* buf, size_t len, int flags) {
+    if (!handle || !handle->is_connected)
+        return -1;
+    return transport_recv(handle, buf, len, flags);
+}
+
 /* --- Membebaskan Resource Handle IRC --- */
 void WINEIRC_free(WINEIRC_handle* handle) {
     if (!handle)
@@ -202,9 +760,21 @@ void WINEIRC_free(WINEIRC_handle* handle) {
     if (handle->is_connected) {
         WINEIRC_disconnect(handle);
     }
+    close_transport(handle);
     free(handle->server);
     free(handle->nick);
     free(handle->user);
     free(handle->channel);
+    free(handle->sasl_account);
+    if (handle->sasl_password) {
+        OPENSSL_cleanse(handle->sasl_password, strlen(handle->sasl_password));
+        free(handle->sasl_password);
+    }
+    free((char*)handle->tls_options.ca_file);
+    free((char*)handle->tls_options.cert_file);
+    free((char*)handle->tls_options.key_file);
+    WINEB2B_metrics_free(handle->metrics);
+    WINEIRC_members_free(handle->members);
+    WINEIRC_history_free(handle->history);
     free(handle);
 }
\ No newline at end of file
@@ -0,0 +1,452 @@
+#define _GNU_SOURCE
+#include "irc_handover.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <errno.h>
+#include <poll.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <openssl/crypto.h>
+
+#define HANDOVER_MAGIC   0x57424831u     /* "WBH1": hello dan header record */
+#define HANDOVER_ACK     0x57424841u
+#define HANDOVER_DONE    0x57424844u
+#define HANDOVER_MAX     (1u << 20)      /* Handle per handover */
+#define FIELD_NULL       UINT32_MAX
+#define FIELD_MAX        (1u << 26)      /* Satu field (antrean keluar) */
+#define CONNECT_RETRY_MS 10
+
+enum { F_SERVER, F_NICK, F_USER, F_CHANNEL, F_ACCOUNT, F_PASSWORD,
+       F_CA_FILE, F_CERT_FILE, F_KEY_FILE, F_IN, F_OUT, F_COUNT };
+
+enum { FLAG_TLS = 1, FLAG_INSECURE = 2, FLAG_NO_KTLS = 4 };
+
+/* Kedua proses di host yang sama: urutan byte native */
+struct hello {
+    uint32_t magic;
+    uint32_t count;
+};
+
+/* Dikirim bersama fd (SCM_RIGHTS), diikuti isi field berurutan */
+struct record {
+    uint32_t magic;
+    uint32_t flags;
+    int32_t port;
+    int32_t sasl_mechanism;
+    uint32_t len[F_COUNT];      /* FIELD_NULL = NULL */
+};
+
+static long now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000L + ts.tv_nsec / 1000000;
+}
+
+static long deadline_after(int timeout_ms) {
+    return timeout_ms < 0 ? -1 : now_ms() + timeout_ms;
+}
+
+/* Menunggu events pada fd sampai deadline (-1 = tanpa batas) */
+static int wait_fd(int fd, short events, long deadline) {
+    for (;;) {
+        int left = -1;
+        if (deadline >= 0) {
+            long ms = deadline - now_ms();
+            if (ms <= 0)
+                return -1;
+            left = (int)ms;
+        }
+        struct pollfd pfd = { fd, events, 0 };
+        int n = poll(&pfd, 1, left);
+        if (n > 0)
+            return 0;
+        if (n < 0 && errno != EINTR)
+            return -1;
+    }
+}
+
+static int write_full(int fd, const void* buf, size_t len, long deadline) {
+    const char *p = buf;
+    while (len > 0) {
+        ssize_t n = send(fd, p, len, MSG_DONTWAIT | MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            if ((errno != EAGAIN && errno != EWOULDBLOCK) || wait_fd(fd, POLLOUT, deadline) != 0)
+                return -1;
+            continue;
+        }
+        p += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+static int read_full(int fd, void* buf, size_t len, long deadline) {
+    char *p = buf;
+    while (len > 0) {
+        ssize_t n = recv(fd, p, len, MSG_DONTWAIT);
+        if (n == 0)
+            return -1;
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            if ((errno != EAGAIN && errno != EWOULDBLOCK) || wait_fd(fd, POLLIN, deadline) != 0)
+                return -1;
+            continue;
+        }
+        p += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+/* State sesi hanya diserahkan ke proses dengan uid yang sama */
+static int same_user(int fd) {
+    struct ucred cred;
+    socklen_t len = sizeof(cred);
+    if (getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &cred, &len) != 0 || cred.uid != geteuid()) {
+        fprintf(stderr, "Error: proses handover dengan uid berbeda ditolak\n");
+        return 0;
+    }
+    return 1;
+}
+
+static int unix_addr(const char* path, struct sockaddr_un* addr) {
+    memset(addr, 0, sizeof(*addr));
+    addr->sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr->sun_path)) {
+        fprintf(stderr, "Error: path socket handover terlalu panjang: %s\n", path);
+        return -1;
+    }
+    strcpy(addr->sun_path, path);
+    return 0;
+}
+
+/* --- Proses lama --- */
+
+enum { ITEM_IN_LOOP, ITEM_DETACHING, ITEM_DETACHED, ITEM_STANDALONE };
+
+struct item {
+    WINEIRC_handle *handle;
+    int state;
+    WINEIRC_loop_pending pending;
+};
+
+/* Loop membaca socket langsung; TLS hanya bisa diserahkan jika record di kTLS */
+static int transferable(const WINEIRC_loop* loop, const WINEIRC_handle* h) {
+    if (!h || !h->is_connected || h->socket_fd < 0 || (h->loop_slot >= 0 && !loop))
+        return 0;
+    return !h->tls || (WINEIRC_tls_ktls_tx(h->tls) && WINEIRC_tls_ktls_rx(h->tls) &&
+                       WINEIRC_tls_pending(h->tls) == 0);
+}
+
+static int send_record(int fd, const struct item* it, long deadline) {
+    const WINEIRC_handle *h = it->handle;
+    const char *data[F_COUNT] = {
+        h->server, h->nick, h->user, h->channel, h->sasl_account, h->sasl_password,
+        h->tls_options.ca_file, h->tls_options.cert_file, h->tls_options.key_file,
+        it->pending.in, it->pending.out
+    };
+    struct record rec;
+    memset(&rec, 0, sizeof(rec));
+    rec.magic = HANDOVER_MAGIC;
+    rec.flags = (h->use_tls ? FLAG_TLS : 0) | (h->tls_options.insecure ? FLAG_INSECURE : 0) |
+                (h->tls_options.no_ktls ? FLAG_NO_KTLS : 0);
+    rec.port = h->port;
+    rec.sasl_mechanism = (int32_t)h->sasl_mechanism;
+    for (int i = 0; i < F_COUNT; i++) {
+        size_t len = i == F_IN ? it->pending.in_len : i == F_OUT ? it->pending.out_len :
+                     data[i] ? strlen(data[i]) : FIELD_NULL;
+        if (len != FIELD_NULL && len > FIELD_MAX)
+            return -1;
+        rec.len[i] = (uint32_t)len;
+    }
+
+    /* fd menempel pada byte pertama header; sisa header dikirim biasa */
+    char control[CMSG_SPACE(sizeof(int))];
+    memset(control, 0, sizeof(control));
+    struct iovec iov = { &rec, sizeof(rec) };
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(cmsg), &h->socket_fd, sizeof(int));
+    ssize_t n;
+    while ((n = sendmsg(fd, &msg, MSG_DONTWAIT | MSG_NOSIGNAL)) < 0) {
+        if (errno != EINTR && ((errno != EAGAIN && errno != EWOULDBLOCK) || wait_fd(fd, POLLOUT, deadline) != 0))
+            return -1;
+    }
+    if (write_full(fd, (char*)&rec + n, sizeof(rec) - (size_t)n, deadline) != 0)
+        return -1;
+    for (int i = 0; i < F_COUNT; i++)
+        if (rec.len[i] != FIELD_NULL && write_full(fd, data[i], rec.len[i], deadline) != 0)
+            return -1;
+    return 0;
+}
+
+int WINEIRC_handover_send(const char* path, WINEIRC_loop* loop, WINEIRC_handle** handles, size_t count,
+                          int timeout_ms) {
+    struct sockaddr_un addr;
+    if (!path || (!handles && count > 0) || count > HANDOVER_MAX || unix_addr(path, &addr) != 0)
+        return -1;
+    long deadline = deadline_after(timeout_ms);
+
+    /* Socket hanya bisa dibuka pemilik (umask saat bind) */
+    int lfd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (lfd < 0) {
+        perror("Error: socket handover");
+        return -1;
+    }
+    unlink(path);
+    mode_t mask = umask(077);
+    int rc = bind(lfd, (struct sockaddr*)&addr, sizeof(addr));
+    umask(mask);
+    if (rc != 0 || listen(lfd, 1) != 0) {
+        perror("Error: listen socket handover");
+        close(lfd);
+        return -1;
+    }
+    int fd = -1;
+    if (wait_fd(lfd, POLLIN, deadline) == 0)
+        fd = accept4(lfd, NULL, NULL, SOCK_CLOEXEC);
+    close(lfd);
+    unlink(path);
+    if (fd < 0) {
+        fprintf(stderr, "Error: proses pengganti tidak terhubung ke %s\n", path);
+        return -1;
+    }
+    if (!same_user(fd)) {
+        close(fd);
+        return -1;
+    }
+
+    struct item *items = calloc(count ? count : 1, sizeof(struct item));
+    if (!items) {
+        close(fd);
+        return -1;
+    }
+    size_t n = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (!transferable(loop, handles[i]))
+            continue;
+        items[n].handle = handles[i];
+        items[n].state = handles[i]->loop_slot >= 0 ? ITEM_IN_LOOP : ITEM_STANDALONE;
+        n++;
+    }
+
+    /* Keluarkan dari loop. URING butuh beberapa putaran sampai recv batal
+       dan send yang sedang berjalan selesai */
+    int ok = 1;
+    for (;;) {
+        int busy = 0;
+        for (size_t i = 0; i < n && ok; i++) {
+            struct item *it = &items[i];
+            if (it->state != ITEM_IN_LOOP && it->state != ITEM_DETACHING)
+                continue;
+            rc = WINEIRC_loop_detach(loop, it->handle, &it->pending);
+            if (rc == 0)
+                it->state = ITEM_DETACHED;
+            else if (rc == 1)
+                it->state = ITEM_DETACHING, busy = 1;
+            else
+                ok = 0;
+        }
+        if (!ok || !busy)
+            break;
+        if (deadline >= 0 && now_ms() >= deadline) {
+            fprintf(stderr, "Error: timeout menunggu I/O loop sebelum handover\n");
+            ok = 0;
+            break;
+        }
+        WINEIRC_loop_run(loop, CONNECT_RETRY_MS);
+    }
+
+    /* Semua record dikirim, lalu tunggu konfirmasi sebelum DONE */
+    if (ok) {
+        struct hello hello = { HANDOVER_MAGIC, (uint32_t)n };
+        ok = write_full(fd, &hello, sizeof(hello), deadline) == 0;
+        for (size_t i = 0; i < n && ok; i++)
+            ok = send_record(fd, &items[i], deadline) == 0;
+        uint32_t ack[2];
+        if (ok)
+            ok = read_full(fd, ack, sizeof(ack), deadline) == 0 && ack[0] == HANDOVER_ACK && ack[1] == n;
+        uint32_t done = HANDOVER_DONE;
+        if (ok)
+            ok = write_full(fd, &done, sizeof(done), deadline) == 0;
+        if (!ok)
+            fprintf(stderr, "Error: handover ke proses pengganti gagal\n");
+    }
+    close(fd);
+
+    for (size_t i = 0; i < n; i++) {
+        struct item *it = &items[i];
+        if (ok) {
+            /* Socket hidup di proses baru; salinan di sini ditutup tanpa QUIT */
+            WINEIRC_abandon(it->handle);
+        } else if (it->state == ITEM_DETACHED) {
+            WINEIRC_loop_attach(loop, it->handle, &it->pending);
+        } else if (it->state == ITEM_DETACHING) {
+            WINEIRC_loop_attach(loop, it->handle, NULL);
+        }
+        free(it->pending.in);
+        free(it->pending.out);
+    }
+    free(items);
+    return ok ? (int)n : -1;
+}
+
+/* --- Proses baru --- */
+
+static int connect_unix(const char* path, long deadline) {
+    struct sockaddr_un addr;
+    if (unix_addr(path, &addr) != 0)
+        return -1;
+    for (;;) {
+        int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0)
+            return -1;
+        if (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) == 0)
+            return fd;
+        int err = errno;
+        close(fd);
+        /* Proses lama belum mendengarkan */
+        if ((err != ENOENT && err != ECONNREFUSED) || (deadline >= 0 && now_ms() >= deadline)) {
+            fprintf(stderr, "Error: gagal terhubung ke socket handover %s: %s\n", path, strerror(err));
+            return -1;
+        }
+        usleep(CONNECT_RETRY_MS * 1000);
+    }
+}
+
+static void free_fields(char** fields) {
+    for (int i = 0; i < F_COUNT; i++) {
+        if (fields[i] && i == F_PASSWORD)
+            OPENSSL_cleanse(fields[i], strlen(fields[i]));
+        free(fields[i]);
+    }
+}
+
+static int recv_record(int fd, long deadline, WINEIRC_handle** out, WINEIRC_loop_pending* pending) {
+    struct record rec;
+    char control[CMSG_SPACE(sizeof(int))];
+    struct iovec iov = { &rec, sizeof(rec) };
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    ssize_t n;
+    while ((n = recvmsg(fd, &msg, MSG_DONTWAIT | MSG_CMSG_CLOEXEC)) < 0) {
+        if (errno != EINTR && ((errno != EAGAIN && errno != EWOULDBLOCK) || wait_fd(fd, POLLIN, deadline) != 0))
+            return -1;
+    }
+    int sock = -1;
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    if (cmsg && cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS &&
+        cmsg->cmsg_len == CMSG_LEN(sizeof(int)))
+        memcpy(&sock, CMSG_DATA(cmsg), sizeof(int));
+    if (sock < 0 || n == 0 || (msg.msg_flags & MSG_CTRUNC) ||
+        read_full(fd, (char*)&rec + n, sizeof(rec) - (size_t)n, deadline) != 0 || rec.magic != HANDOVER_MAGIC) {
+        if (sock >= 0)
+            close(sock);
+        return -1;
+    }
+
+    char *fields[F_COUNT] = { NULL };
+    int ok = 1;
+    for (int i = 0; i < F_COUNT && ok; i++) {
+        if (rec.len[i] == FIELD_NULL)
+            continue;
+        fields[i] = rec.len[i] <= FIELD_MAX ? malloc(rec.len[i] + 1) : NULL;
+        ok = fields[i] && read_full(fd, fields[i], rec.len[i], deadline) == 0;
+        if (ok)
+            fields[i][rec.len[i]] = '\0';
+    }
+    WINEIRC_handle *h = NULL;
+    if (ok && fields[F_SERVER] && fields[F_NICK] && fields[F_USER] && fields[F_CHANNEL]) {
+        WINEIRC_tls_options tls = { (rec.flags & FLAG_INSECURE) != 0, fields[F_CA_FILE], fields[F_CERT_FILE],
+                                    fields[F_KEY_FILE], (rec.flags & FLAG_NO_KTLS) != 0 };
+        WINEIRC_sasl sasl = { (WINEIRC_sasl_mechanism)rec.sasl_mechanism, fields[F_ACCOUNT], fields[F_PASSWORD] };
+        h = WINEIRC_create_fd(sock, fields[F_SERVER], rec.port, fields[F_NICK], fields[F_USER], fields[F_CHANNEL],
+                              (rec.flags & FLAG_TLS) ? &tls : NULL,
+                              rec.sasl_mechanism != WINEIRC_SASL_NONE ? &sasl : NULL);
+    }
+    if (!h) {
+        close(sock);
+        free_fields(fields);
+        return -1;
+    }
+    pending->in = fields[F_IN];
+    pending->in_len = fields[F_IN] ? rec.len[F_IN] : 0;
+    pending->out = fields[F_OUT];
+    pending->out_len = fields[F_OUT] ? rec.len[F_OUT] : 0;
+    fields[F_IN] = fields[F_OUT] = NULL;
+    free_fields(fields);
+    *out = h;
+    return 0;
+}
+
+int WINEIRC_handover_receive(const char* path, WINEIRC_loop* loop, WINEIRC_handle*** handles, int timeout_ms) {
+    if (!path || !loop || !handles)
+        return -1;
+    *handles = NULL;
+    long deadline = deadline_after(timeout_ms);
+    int fd = connect_unix(path, deadline);
+    if (fd < 0)
+        return -1;
+    struct hello hello;
+    if (!same_user(fd) || read_full(fd, &hello, sizeof(hello), deadline) != 0 ||
+        hello.magic != HANDOVER_MAGIC || hello.count > HANDOVER_MAX) {
+        close(fd);
+        return -1;
+    }
+
+    WINEIRC_handle **list = calloc(hello.count ? hello.count : 1, sizeof(WINEIRC_handle*));
+    WINEIRC_loop_pending *pending = calloc(hello.count ? hello.count : 1, sizeof(WINEIRC_loop_pending));
+    size_t n = 0;
+    int ok = list && pending;
+    while (ok && n < hello.count) {
+        ok = recv_record(fd, deadline, &list[n], &pending[n]) == 0;
+        if (ok)
+            n++;
+    }
+    /* Socket baru dibaca setelah proses lama melepas salinannya (DONE) */
+    uint32_t ack[2] = { HANDOVER_ACK, hello.count }, done = 0;
+    ok = ok && write_full(fd, ack, sizeof(ack), deadline) == 0 &&
+         read_full(fd, &done, sizeof(done), deadline) == 0 && done == HANDOVER_DONE;
+    close(fd);
+    if (!ok)
+        fprintf(stderr, "Error: menerima handover dari %s gagal\n", path);
+
+    for (size_t i = 0; i < n; i++) {
+        if (!ok) {
+            /* Proses lama tetap memakai koneksinya */
+            WINEIRC_abandon(list[i]);
+            WINEIRC_free(list[i]);
+        } else if (WINEIRC_loop_attach(loop, list[i], &pending[i]) != 0) {
+            fprintf(stderr, "Error: handle %s dari handover tidak bisa dimasukkan ke loop\n", list[i]->nick);
+        }
+        free(pending[i].in);
+        free(pending[i].out);
+    }
+    free(pending);
+    if (!ok) {
+        free(list);
+        return -1;
+    }
+    *handles = list;
+    return (int)n;
+}
@@ -0,0 +1,671 @@
+#include "irc_history.h"
+#include "irc_parser.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+
+#define NICK_MAX       128
+#define REF_MAX        32
+
+/* Pesan yang terkumpul dari BATCH: satu alokasi untuk semua string */
+struct entry {
+    char *msgid, *nick, *command, *text;
+    int64_t time_ms;
+};
+
+struct channel {
+    char *name;
+    char last_msgid[WINEIRC_HISTORY_MSGID_MAX];
+    int64_t last_time;
+    int known;                  /* Titik terakhir sudah ada */
+    int synced;                 /* 366 untuk JOIN sendiri sudah diterima di koneksi ini */
+    /* Catch-up yang berjalan */
+    int pending;
+    int by_timestamp;           /* Halaman diminta dengan timestamp= (msgid ditolak/tidak ada) */
+    char batch[REF_MAX];        /* Referensi BATCH aktif, "" jika belum dibuka */
+    long deadline;
+    unsigned page_count;        /* Anggota batch di halaman ini */
+    char cursor_msgid[WINEIRC_HISTORY_MSGID_MAX];   /* Pesan terakhir yang diterima (termasuk dari nick sendiri) */
+    int64_t cursor_time;
+    struct entry *acc;
+    size_t nacc, acc_cap;
+};
+
+/* Antrean string FIFO */
+struct queue {
+    char **items;
+    size_t *chans;              /* Hanya untuk baris tertahan: indeks channel */
+    size_t head, len, cap;
+};
+
+struct _WINEIRC_history {
+    WINEIRC_history_callbacks cb;
+    void *user_data;
+    WINEIRC_history_config cfg;
+    char self[NICK_MAX];
+    /* Status per koneksi */
+    int cap_chathistory, cap_batch;
+    unsigned server_limit;      /* CHATHISTORY=N dari 005, 0 = tidak disebut */
+    int msgid_refs;             /* MSGREFTYPES memuat msgid (default ya) */
+    struct channel *chans;
+    size_t nchans;
+    size_t npending;
+    struct queue requests, held, released;
+    /* Deduplikasi: kunci 64-bit di tabel open addressing, dibuang FIFO */
+    uint64_t *seen;
+    size_t seen_mask;
+    uint64_t *ring;
+    size_t ring_head, ring_len;
+    WINEIRC_history_stats stats;
+};
+
+static long now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000L + ts.tv_nsec / 1000000;
+}
+
+static int64_t wall_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static void format_time(int64_t ms, char* out, size_t len) {
+    time_t sec = (time_t)(ms / 1000);
+    struct tm tm;
+    gmtime_r(&sec, &tm);
+    char base[32];
+    strftime(base, sizeof(base), "%Y-%m-%dT%H:%M:%S", &tm);
+    snprintf(out, len, "%s.%03dZ", base, (int)(ms % 1000));
+}
+
+/* --- Antrean --- */
+
+static int queue_push(struct queue* q, char* item, size_t chan) {
+    if (q->head > 0 && q->head == q->len) {
+        q->head = q->len = 0;
+    }
+    if (q->len == q->cap) {
+        size_t cap = q->cap ? q->cap * 2 : 16;
+        char **items = realloc(q->items, cap * sizeof(*items));
+        if (!items)
+            return -1;
+        q->items = items;
+        size_t *chans = realloc(q->chans, cap * sizeof(*chans));
+        if (!chans)
+            return -1;
+        q->chans = chans;
+        q->cap = cap;
+    }
+    q->items[q->len] = item;
+    q->chans[q->len] = chan;
+    q->len++;
+    return 0;
+}
+
+static void queue_clear(struct queue* q) {
+    for (size_t i = q->head; i < q->len; i++)
+        free(q->items[i]);
+    q->head = q->len = 0;
+}
+
+static void queue_free(struct queue* q) {
+    queue_clear(q);
+    free(q->items);
+    free(q->chans);
+}
+
+/* Mengambil item terdepan ke out; panjang, 0 jika kosong, -1 jika out kecil */
+static int queue_pop(struct queue* q, char* out, size_t out_len) {
+    if (q->head == q->len)
+        return 0;
+    char *item = q->items[q->head++];
+    size_t n = strlen(item);
+    int ret = -1;
+    if (n < out_len) {
+        memcpy(out, item, n + 1);
+        ret = (int)n;
+    }
+    free(item);
+    return ret;
+}
+
+/* --- Deduplikasi --- */
+
+static uint64_t fnv(uint64_t h, const char* s, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        h ^= (unsigned char)s[i];
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+/* Kunci pesan: channel + msgid, atau channel + waktu + nick + teks jika
+   tanpa msgid. 0 jika tidak bisa dibedakan (tanpa msgid dan waktu) */
+static uint64_t message_key(const char* channel, const char* msgid, int64_t time_ms, const char* nick,
+                            const char* text) {
+    uint64_t h = 14695981039346656037ULL;
+    for (const char *p = channel; *p; p++) {
+        char c = (*p >= 'A' && *p <= 'Z') ? (char)(*p + 32) : *p;
+        h = fnv(h, &c, 1);
+    }
+    if (msgid && *msgid) {
+        h = fnv(h, "\0m", 2);
+        h = fnv(h, msgid, strlen(msgid));
+    } else if (time_ms) {
+        h = fnv(h, "\0t", 2);
+        h = fnv(h, (const char*)&time_ms, sizeof(time_ms));
+        h = fnv(h, nick, strlen(nick) + 1);
+        h = fnv(h, text, strlen(text));
+    } else {
+        return 0;
+    }
+    return h ? h : 1;
+}
+
+static int seen_has(const WINEIRC_history* h, uint64_t key) {
+    for (size_t i = key & h->seen_mask; h->seen[i]; i = (i + 1) & h->seen_mask)
+        if (h->seen[i] == key)
+            return 1;
+    return 0;
+}
+
+/* Hapus dengan backward shift agar rantai probing tetap utuh */
+static void seen_remove(WINEIRC_history* h, uint64_t key) {
+    size_t i = key & h->seen_mask;
+    while (h->seen[i] && h->seen[i] != key)
+        i = (i + 1) & h->seen_mask;
+    if (!h->seen[i])
+        return;
+    size_t j = i;
+    for (;;) {
+        j = (j + 1) & h->seen_mask;
+        if (!h->seen[j])
+            break;
+        size_t k = h->seen[j] & h->seen_mask;
+        if ((j > i && (k <= i || k > j)) || (j < i && k <= i && k > j)) {
+            h->seen[i] = h->seen[j];
+            i = j;
+        }
+    }
+    h->seen[i] = 0;
+}
+
+static void seen_add(WINEIRC_history* h, uint64_t key) {
+    if (!key || seen_has(h, key))
+        return;
+    size_t window = h->cfg.dedup_window;
+    if (h->ring_len == window) {
+        seen_remove(h, h->ring[h->ring_head]);
+        h->ring_head = (h->ring_head + 1) % window;
+        h->ring_len--;
+    }
+    h->ring[(h->ring_head + h->ring_len) % window] = key;
+    h->ring_len++;
+    size_t i = key & h->seen_mask;
+    while (h->seen[i])
+        i = (i + 1) & h->seen_mask;
+    h->seen[i] = key;
+}
+
+/* --- Channel --- */
+
+static struct channel* find_channel(WINEIRC_history* h, const char* name) {
+    for (size_t i = 0; i < h->nchans; i++)
+        if (strcasecmp(h->chans[i].name, name) == 0)
+            return &h->chans[i];
+    return NULL;
+}
+
+static struct channel* get_channel(WINEIRC_history* h, const char* name) {
+    struct channel *ch = find_channel(h, name);
+    if (ch)
+        return ch;
+    struct channel *chans = realloc(h->chans, (h->nchans + 1) * sizeof(*chans));
+    if (!chans)
+        return NULL;
+    h->chans = chans;
+    ch = &chans[h->nchans];
+    memset(ch, 0, sizeof(*ch));
+    ch->name = strdup(name);
+    if (!ch->name)
+        return NULL;
+    h->nchans++;
+    return ch;
+}
+
+static void set_ref(char* msgid_out, int64_t* time_out, const char* msgid, int64_t time_ms) {
+    if (msgid && strlen(msgid) < WINEIRC_HISTORY_MSGID_MAX)
+        strcpy(msgid_out, msgid);
+    else
+        msgid_out[0] = '\0';
+    *time_out = time_ms;
+}
+
+static unsigned page_limit(const WINEIRC_history* h) {
+    unsigned limit = h->cfg.page_limit;
+    if (h->server_limit && limit > h->server_limit)
+        limit = h->server_limit;
+    return limit;
+}
+
+/* Meminta halaman berikutnya setelah kursor. -1 jika tidak ada titik acuan */
+static int request_page(WINEIRC_history* h, struct channel* ch) {
+    char ref[WINEIRC_HISTORY_MSGID_MAX + 16];
+    if (ch->cursor_msgid[0] && !ch->by_timestamp && h->msgid_refs) {
+        snprintf(ref, sizeof(ref), "msgid=%s", ch->cursor_msgid);
+    } else if (ch->cursor_time) {
+        char iso[40];
+        format_time(ch->cursor_time, iso, sizeof(iso));
+        snprintf(ref, sizeof(ref), "timestamp=%s", iso);
+        ch->by_timestamp = 1;
+    } else {
+        return -1;
+    }
+    char line[512];
+    snprintf(line, sizeof(line), "CHATHISTORY AFTER %s %s %u\r\n", ch->name, ref, page_limit(h));
+    char *copy = strdup(line);
+    if (!copy || queue_push(&h->requests, copy, 0) != 0) {
+        free(copy);
+        return -1;
+    }
+    ch->batch[0] = '\0';
+    ch->page_count = 0;
+    ch->deadline = now_ms() + h->cfg.timeout_ms;
+    h->stats.requests++;
+    return 0;
+}
+
+/* Pesan live channel: 1 jika duplikat (dibuang), 0 jika baru (titik terakhir diperbarui) */
+static int note_live(WINEIRC_history* h, struct channel* ch, const WINEIRC_message* msg) {
+    const char *msgid = WINEIRC_message_tag(msg, "msgid");
+    int64_t t = WINEIRC_server_time(WINEIRC_message_tag(msg, "time"));
+    char nick[NICK_MAX] = "";
+    WINEIRC_prefix_nick(msg->prefix, nick, sizeof(nick));
+    uint64_t key = message_key(ch->name, msgid, t, nick, msg->params[1]);
+    if (key && seen_has(h, key)) {
+        h->stats.duplicates++;
+        return 1;
+    }
+    seen_add(h, key);
+    set_ref(ch->last_msgid, &ch->last_time, msgid, t ? t : wall_ms());
+    ch->known = 1;
+    return 0;
+}
+
+/* Baris tertahan dilepas setelah catch-up channel selesai */
+static void release_held(WINEIRC_history* h, size_t chan) {
+    struct queue *q = &h->held;
+    size_t keep = q->head;
+    for (size_t i = q->head; i < q->len; i++) {
+        char *line = q->items[i];
+        if (q->chans[i] != chan) {
+            q->items[keep] = line;
+            q->chans[keep++] = q->chans[i];
+            continue;
+        }
+        char copy[strlen(line) + 1];
+        strcpy(copy, line);
+        WINEIRC_message msg;
+        if (WINEIRC_parse_line(copy, &msg) == 0 && note_live(h, &h->chans[chan], &msg)) {
+            free(line);
+            continue;
+        }
+        if (queue_push(&h->released, line, 0) != 0)
+            free(line);
+    }
+    q->len = keep;
+}
+
+/* Menyerahkan pesan terkumpul (tanpa duplikat) ke on_batch dan melepas baris tertahan */
+static void finish(WINEIRC_history* h, struct channel* ch) {
+    WINEIRC_history_message *out = malloc((ch->nacc ? ch->nacc : 1) * sizeof(*out));
+    size_t count = 0;
+    for (size_t i = 0; i < ch->nacc; i++) {
+        struct entry *e = &ch->acc[i];
+        uint64_t key = message_key(ch->name, e->msgid, e->time_ms, e->nick, e->text);
+        if (key && seen_has(h, key)) {
+            h->stats.duplicates++;
+            continue;
+        }
+        seen_add(h, key);
+        if (out)
+            out[count++] = (WINEIRC_history_message){ e->msgid, e->time_ms, e->nick, e->command, e->text };
+    }
+    if (ch->cursor_msgid[0] || ch->cursor_time) {
+        set_ref(ch->last_msgid, &ch->last_time, ch->cursor_msgid, ch->cursor_time);
+        ch->known = 1;
+    }
+    if (count > 0) {
+        h->stats.catchups++;
+        h->stats.replayed += count;
+        if (h->cb.on_batch)
+            h->cb.on_batch(ch->name, out, count, h->user_data);
+    }
+    free(out);
+    for (size_t i = 0; i < ch->nacc; i++)
+        free(ch->acc[i].msgid);
+    free(ch->acc);
+    ch->acc = NULL;
+    ch->nacc = ch->acc_cap = 0;
+    ch->pending = 0;
+    ch->batch[0] = '\0';
+    h->npending--;
+    release_held(h, (size_t)(ch - h->chans));
+}
+
+static void start_catchup(WINEIRC_history* h, struct channel* ch) {
+    if (ch->pending || !ch->known || !h->cap_chathistory || !h->cap_batch)
+        return;
+    set_ref(ch->cursor_msgid, &ch->cursor_time, ch->last_msgid, ch->last_time);
+    ch->by_timestamp = 0;
+    if (request_page(h, ch) != 0)
+        return;
+    ch->pending = 1;
+    h->npending++;
+}
+
+static void accumulate(WINEIRC_history* h, struct channel* ch, const WINEIRC_message* msg) {
+    ch->page_count++;
+    if (msg->param_count < 2 || !msg->prefix ||
+        (strcmp(msg->command, "PRIVMSG") != 0 && strcmp(msg->command, "NOTICE") != 0))
+        return;
+    const char *msgid = WINEIRC_message_tag(msg, "msgid");
+    int64_t t = WINEIRC_server_time(WINEIRC_message_tag(msg, "time"));
+    if (msgid || t)
+        set_ref(ch->cursor_msgid, &ch->cursor_time, msgid, t ? t : ch->cursor_time);
+    char nick[NICK_MAX] = "";
+    WINEIRC_prefix_nick(msg->prefix, nick, sizeof(nick));
+    if (strcasecmp(nick, h->self) == 0 || ch->nacc >= h->cfg.max_messages)
+        return;
+    if (ch->nacc == ch->acc_cap) {
+        size_t cap = ch->acc_cap ? ch->acc_cap * 2 : 64;
+        struct entry *acc = realloc(ch->acc, cap * sizeof(*acc));
+        if (!acc)
+            return;
+        ch->acc = acc;
+        ch->acc_cap = cap;
+    }
+    if (!msgid)
+        msgid = "";
+    size_t lm = strlen(msgid) + 1, ln = strlen(nick) + 1, lc = strlen(msg->command) + 1;
+    size_t lt = strlen(msg->params[1]) + 1;
+    char *buf = malloc(lm + ln + lc + lt);
+    if (!buf)
+        return;
+    struct entry *e = &ch->acc[ch->nacc++];
+    e->msgid = memcpy(buf, msgid, lm);
+    e->nick = memcpy(buf + lm, nick, ln);
+    e->command = memcpy(buf + lm + ln, msg->command, lc);
+    e->text = memcpy(buf + lm + ln + lc, msg->params[1], lt);
+    e->time_ms = t;
+}
+
+static struct channel* channel_by_batch(WINEIRC_history* h, const char* ref) {
+    for (size_t i = 0; i < h->nchans; i++)
+        if (h->chans[i].pending && h->chans[i].batch[0] && strcmp(h->chans[i].batch, ref) == 0)
+            return &h->chans[i];
+    return NULL;
+}
+
+static void end_page(WINEIRC_history* h, struct channel* ch) {
+    ch->batch[0] = '\0';
+    if (ch->nacc >= h->cfg.max_messages) {
+        h->stats.truncated++;
+        finish(h, ch);
+    } else if (ch->page_count >= page_limit(h) && request_page(h, ch) == 0) {
+        return;
+    } else {
+        finish(h, ch);
+    }
+}
+
+static void check_timeouts(WINEIRC_history* h) {
+    long now = now_ms();
+    for (size_t i = 0; i < h->nchans && h->npending; i++) {
+        if (h->chans[i].pending && now >= h->chans[i].deadline) {
+            h->stats.failures++;
+            finish(h, &h->chans[i]);
+        }
+    }
+}
+
+static void parse_caps(WINEIRC_history* h, const char* list) {
+    char copy[512];
+    snprintf(copy, sizeof(copy), "%s", list);
+    char *save = NULL;
+    for (char *cap = strtok_r(copy, " ", &save); cap; cap = strtok_r(NULL, " ", &save)) {
+        int on = cap[0] != '-';
+        if (!on)
+            cap++;
+        if (strcmp(cap, "draft/chathistory") == 0 || strcmp(cap, "chathistory") == 0)
+            h->cap_chathistory = on;
+        else if (strcmp(cap, "batch") == 0)
+            h->cap_batch = on;
+    }
+}
+
+static void parse_isupport(WINEIRC_history* h, const WINEIRC_message* msg) {
+    for (int i = 1; i < msg->param_count - 1; i++) {
+        const char *p = msg->params[i];
+        if (strncmp(p, "CHATHISTORY=", 12) == 0)
+            h->server_limit = (unsigned)strtoul(p + 12, NULL, 10);
+        else if (strncmp(p, "MSGREFTYPES=", 12) == 0)
+            h->msgid_refs = strstr(p + 12, "msgid") != NULL;
+    }
+}
+
+/* --- API --- */
+
+WINEIRC_history* WINEIRC_history_create(const char* self_nick, const WINEIRC_history_config* config,
+                                        const WINEIRC_history_callbacks* callbacks, void* user_data) {
+    WINEIRC_history *h = calloc(1, sizeof(*h));
+    if (!h)
+        return NULL;
+    if (config)
+        h->cfg = *config;
+    if (!h->cfg.page_limit)
+        h->cfg.page_limit = 100;
+    if (!h->cfg.max_messages)
+        h->cfg.max_messages = 10000;
+    if (!h->cfg.dedup_window)
+        h->cfg.dedup_window = 4096;
+    if (h->cfg.timeout_ms <= 0)
+        h->cfg.timeout_ms = 10000;
+    if (callbacks)
+        h->cb = *callbacks;
+    h->user_data = user_data;
+    snprintf(h->self, sizeof(h->self), "%s", self_nick ? self_nick : "");
+    h->msgid_refs = 1;
+    size_t slots = 16;
+    while (slots < (size_t)h->cfg.dedup_window * 2)
+        slots *= 2;
+    h->seen = calloc(slots, sizeof(*h->seen));
+    h->ring = malloc(h->cfg.dedup_window * sizeof(*h->ring));
+    if (!h->seen || !h->ring) {
+        WINEIRC_history_free(h);
+        return NULL;
+    }
+    h->seen_mask = slots - 1;
+    return h;
+}
+
+int WINEIRC_history_feed_line(WINEIRC_history* h, const char* line) {
+    if (!h || !line)
+        return 0;
+    if (h->npending)
+        check_timeouts(h);
+    /* Hanya baris yang relevan yang diparse */
+    if (line[0] != '@' && !strstr(line, " PRIVMSG ") && !strstr(line, " NOTICE ") && !strstr(line, " CAP ") &&
+        !strstr(line, " 366 ") && !strstr(line, " 005 ") && !strstr(line, "BATCH ") && strncmp(line, "FAIL ", 5) != 0)
+        return 0;
+    size_t len = strlen(line);
+    if (len >= WINEIRC_LINE_MAX)
+        return 0;
+    char copy[len + 1];
+    memcpy(copy, line, len + 1);
+    WINEIRC_message msg;
+    if (WINEIRC_parse_line(copy, &msg) != 0)
+        return 0;
+    const char *cmd = msg.command;
+
+    const char *batch = WINEIRC_message_tag(&msg, "batch");
+    if (batch) {
+        struct channel *ch = channel_by_batch(h, batch);
+        if (ch) {
+            accumulate(h, ch, &msg);
+            return 1;
+        }
+    }
+    if (strcmp(cmd, "PRIVMSG") == 0 || strcmp(cmd, "NOTICE") == 0) {
+        if (msg.param_count < 2 || !msg.prefix || !msg.params[0][0] || !strchr("#&+!", msg.params[0][0]))
+            return 0;
+        struct channel *ch = get_channel(h, msg.params[0]);
+        if (!ch)
+            return 0;
+        if (ch->pending) {
+            char *held = strdup(line);
+            if (held && queue_push(&h->held, held, (size_t)(ch - h->chans)) == 0) {
+                h->stats.held++;
+                return 1;
+            }
+            free(held);
+        }
+        return note_live(h, ch, &msg);
+    }
+    if (strcmp(cmd, "BATCH") == 0 && msg.param_count >= 1) {
+        const char *ref = msg.params[0];
+        if (ref[0] == '+' && msg.param_count >= 3 &&
+            (strcmp(msg.params[1], "chathistory") == 0 || strcmp(msg.params[1], "draft/chathistory") == 0)) {
+            struct channel *ch = find_channel(h, msg.params[2]);
+            if (ch && ch->pending && !ch->batch[0]) {
+                snprintf(ch->batch, sizeof(ch->batch), "%s", ref + 1);
+                return 1;
+            }
+        } else if (ref[0] == '-') {
+            struct channel *ch = channel_by_batch(h, ref + 1);
+            if (ch) {
+                end_page(h, ch);
+                return 1;
+            }
+        }
+        return 0;
+    }
+    if (strcmp(cmd, "366") == 0 && msg.param_count >= 2) {
+        struct channel *ch = get_channel(h, msg.params[1]);
+        if (ch && !ch->synced) {
+            ch->synced = 1;
+            start_catchup(h, ch);
+        }
+        return 0;
+    }
+    if (strcmp(cmd, "CAP") == 0 && msg.param_count >= 3) {
+        if (strcmp(msg.params[1], "ACK") == 0 || strcmp(msg.params[1], "NEW") == 0)
+            parse_caps(h, msg.params[msg.param_count - 1]);
+        return 0;
+    }
+    if (strcmp(cmd, "005") == 0) {
+        parse_isupport(h, &msg);
+        return 0;
+    }
+    if (strcmp(cmd, "FAIL") == 0 && msg.param_count >= 2 && strcmp(msg.params[0], "CHATHISTORY") == 0) {
+        /* Konteks FAIL biasanya memuat subcommand dan target */
+        struct channel *ch = NULL;
+        for (int i = 2; i < msg.param_count && !ch; i++)
+            ch = find_channel(h, msg.params[i]);
+        for (size_t i = 0; i < h->nchans && (!ch || !ch->pending); i++)
+            if (h->chans[i].pending && !h->chans[i].batch[0])
+                ch = &h->chans[i];
+        if (!ch || !ch->pending)
+            return 0;
+        /* msgid acuan tidak dikenal server (misal sudah terhapus): ulangi dengan waktu */
+        if (!ch->by_timestamp && ch->cursor_time) {
+            ch->by_timestamp = 1;
+            if (request_page(h, ch) == 0)
+                return 1;
+        }
+        h->stats.failures++;
+        finish(h, ch);
+        return 1;
+    }
+    return 0;
+}
+
+int WINEIRC_history_next_request(WINEIRC_history* h, char* out, size_t out_len) {
+    return h ? queue_pop(&h->requests, out, out_len) : 0;
+}
+
+int WINEIRC_history_next_released(WINEIRC_history* h, char* out, size_t out_len) {
+    return h ? queue_pop(&h->released, out, out_len) : 0;
+}
+
+void WINEIRC_history_disconnected(WINEIRC_history* h) {
+    if (!h)
+        return;
+    /* Baris tertahan akan datang lagi lewat CHATHISTORY koneksi berikutnya */
+    queue_clear(&h->held);
+    queue_clear(&h->requests);
+    for (size_t i = 0; i < h->nchans; i++) {
+        if (h->chans[i].pending)
+            finish(h, &h->chans[i]);
+        h->chans[i].synced = 0;
+    }
+    h->cap_chathistory = h->cap_batch = 0;
+    h->server_limit = 0;
+    h->msgid_refs = 1;
+}
+
+int WINEIRC_history_get_last(const WINEIRC_history* h, const char* channel, char* msgid, size_t msgid_len,
+                             int64_t* time_ms) {
+    if (!h || !channel)
+        return -1;
+    for (size_t i = 0; i < h->nchans; i++) {
+        const struct channel *ch = &h->chans[i];
+        if (ch->known && strcasecmp(ch->name, channel) == 0) {
+            if (msgid && msgid_len)
+                snprintf(msgid, msgid_len, "%s", ch->last_msgid);
+            if (time_ms)
+                *time_ms = ch->last_time;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+int WINEIRC_history_set_last(WINEIRC_history* h, const char* channel, const char* msgid, int64_t time_ms) {
+    if (!h || !channel)
+        return -1;
+    struct channel *ch = get_channel(h, channel);
+    if (!ch)
+        return -1;
+    set_ref(ch->last_msgid, &ch->last_time, msgid, time_ms);
+    ch->known = ch->last_msgid[0] || time_ms;
+    return 0;
+}
+
+void WINEIRC_history_get_stats(const WINEIRC_history* h, WINEIRC_history_stats* out) {
+    if (!h || !out)
+        return;
+    *out = h->stats;
+}
+
+void WINEIRC_history_free(WINEIRC_history* h) {
+    if (!h)
+        return;
+    for (size_t i = 0; i < h->nchans; i++) {
+        for (size_t j = 0; j < h->chans[i].nacc; j++)
+            free(h->chans[i].acc[j].msgid);
+        free(h->chans[i].acc);
+        free(h->chans[i].name);
+    }
+    free(h->chans);
+    queue_free(&h->requests);
+    queue_free(&h->held);
+    queue_free(&h->released);
+    free(h->seen);
+    free(h->ring);
+    free(h);
+}
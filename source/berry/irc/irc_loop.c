@@ -0,0 +1,1169 @@
+#include "irc_loop.h"
+#include "trace.h"
+#include "irc_parser.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <errno.h>
+#include <poll.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+
+#define DEFAULT_KEEPALIVE_MS 120000
+#define KEEPALIVE_PING       "PING :wineberry-keepalive\r\n"
+
+#define URING_SQ_ENTRIES 1024
+#define URING_CQ_ENTRIES 8192
+#define URING_BUF_COUNT  1024       /* Harus pangkat dua */
+#define URING_BUF_SIZE   4096
+#define URING_BGID       0
+
+/* user_data SQE: [generasi:32][slot:24][operasi:8] */
+enum { OP_RECV = 1, OP_SEND, OP_LINK_TIMEOUT, OP_CANCEL };
+
+struct conn {
+    WINEIRC_handle *handle;     /* NULL setelah dikeluarkan dari loop */
+    int fd;
+    unsigned slot;
+    uint32_t gen;
+    int closing;                /* Dikeluarkan, menunggu CQE terakhir (URING) */
+    int detaching;              /* WINEIRC_loop_detach berjalan: recv tidak di-arm ulang, antrean ditahan */
+    char in[WINEIRC_LINE_MAX];  /* Baris masuk; batasnya sama dengan jalur blocking */
+    size_t in_len;
+    char *out;                  /* Antrean yang belum diserahkan ke kernel */
+    size_t out_len, out_off, out_cap;
+    char *inflight;             /* URING: buffer yang sedang dikirim kernel */
+    size_t inflight_len, inflight_off, inflight_cap;
+    unsigned out_msgs;          /* Pesan WINEIRC_loop_send di out (metrik sends_done/failed) */
+    unsigned inflight_msgs;     /* ... di inflight */
+    int send_busy;
+    int recv_armed;
+    int pending_ops;            /* URING: SQE yang CQE terakhirnya belum diterima */
+    int dirty;                  /* Sudah ada di daftar flush */
+    int ping_linked;            /* Send berikutnya membawa PING keepalive */
+    long last_rx_ms;
+    long ping_sent_ms;          /* 0 jika tidak menunggu balasan PING */
+    uint64_t rx_ns;             /* Trace: waktu data terakhir diterima */
+    uint64_t out_trace;         /* Trace: pesan pertama yang ditrace di out */
+    uint64_t out_trace_ns;      /* ... sejak kapan antre */
+    uint64_t send_trace;        /* ... yang sudah diserahkan ke kernel */
+    uint64_t send_trace_ns;
+};
+
+struct uring {
+    int fd;
+    void *ring_ptr;
+    size_t ring_sz;
+    struct io_uring_sqe *sqes;
+    size_t sqes_sz;
+    unsigned *sq_head, *sq_tail, *sq_array, sq_mask, sq_entries;
+    unsigned *cq_head, *cq_tail, cq_mask;
+    struct io_uring_cqe *cqes;
+    unsigned sq_local_tail;
+    unsigned to_submit;
+    struct io_uring_buf_ring *br;
+    size_t br_sz;
+    char *bufs;
+    unsigned short br_tail;
+    struct __kernel_timespec ping_ts;
+};
+
+struct _WINEIRC_loop {
+    WINEIRC_backend backend;
+    WINEIRC_loop_callbacks cb;
+    void *user_data;
+    struct conn **conns;
+    unsigned nconns, conns_cap;
+    unsigned *free_slots;
+    unsigned nfree;
+    unsigned *dirty;
+    unsigned ndirty, dirty_cap;
+    int keepalive_ms;
+    long next_keepalive_ms;
+    struct pollfd *pfds;
+    struct conn **pfd_conn;
+    uint32_t *pfd_gen;
+    unsigned pfd_cap;
+    struct uring ring;
+    int lines;                  /* Baris pada putaran ini */
+    WINEIRC_loop_stats stats;
+};
+
+static long now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000L + ts.tv_nsec / 1000000;
+}
+
+/* --- io_uring: syscall mentah (tanpa liburing) --- */
+
+static int sys_uring_setup(unsigned entries, struct io_uring_params* p) {
+    return (int)syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int sys_uring_enter(int fd, unsigned submit, unsigned min_complete, unsigned flags,
+                           void* arg, size_t argsz) {
+    return (int)syscall(__NR_io_uring_enter, fd, submit, min_complete, flags, arg, argsz);
+}
+
+static int sys_uring_register(int fd, unsigned opcode, void* arg, unsigned nr_args) {
+    return (int)syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+}
+
+static void uring_destroy(struct uring* r) {
+    if (r->fd >= 0)
+        close(r->fd);
+    if (r->sqes)
+        munmap(r->sqes, r->sqes_sz);
+    if (r->ring_ptr)
+        munmap(r->ring_ptr, r->ring_sz);
+    if (r->br)
+        munmap(r->br, r->br_sz);
+    free(r->bufs);
+    memset(r, 0, sizeof(*r));
+    r->fd = -1;
+}
+
+/* Mengembalikan buffer ke ring; terlihat oleh kernel setelah uring_publish_bufs */
+static void uring_recycle_buf(struct uring* r, unsigned short bid) {
+    struct io_uring_buf *b = &r->br->bufs[r->br_tail & (URING_BUF_COUNT - 1)];
+    b->addr = (uint64_t)(uintptr_t)(r->bufs + (size_t)bid * URING_BUF_SIZE);
+    b->len = URING_BUF_SIZE;
+    b->bid = bid;
+    r->br_tail++;
+}
+
+static void uring_publish_bufs(struct uring* r) {
+    __atomic_store_n(&r->br->tail, r->br_tail, __ATOMIC_RELEASE);
+}
+
+static int uring_init(struct uring* r) {
+    memset(r, 0, sizeof(*r));
+    r->fd = -1;
+
+    struct io_uring_params p;
+    memset(&p, 0, sizeof(p));
+    p.flags = IORING_SETUP_CQSIZE | IORING_SETUP_SUBMIT_ALL | IORING_SETUP_COOP_TASKRUN;
+    p.cq_entries = URING_CQ_ENTRIES;
+    int fd = sys_uring_setup(URING_SQ_ENTRIES, &p);
+    if (fd < 0 && errno == EINVAL) {
+        /* Kernel lama: tanpa flag opsional */
+        memset(&p, 0, sizeof(p));
+        p.flags = IORING_SETUP_CQSIZE;
+        p.cq_entries = URING_CQ_ENTRIES;
+        fd = sys_uring_setup(URING_SQ_ENTRIES, &p);
+    }
+    if (fd < 0)
+        return -1;
+    r->fd = fd;
+    if (!(p.features & IORING_FEAT_SINGLE_MMAP) || !(p.features & IORING_FEAT_NODROP) ||
+        !(p.features & IORING_FEAT_EXT_ARG))
+        goto fail;
+
+    size_t sq_sz = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    size_t cq_sz = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    r->ring_sz = sq_sz > cq_sz ? sq_sz : cq_sz;
+    void *ring = mmap(NULL, r->ring_sz, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                      fd, IORING_OFF_SQ_RING);
+    if (ring == MAP_FAILED)
+        goto fail;
+    r->ring_ptr = ring;
+    r->sqes_sz = p.sq_entries * sizeof(struct io_uring_sqe);
+    void *sqes = mmap(NULL, r->sqes_sz, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                      fd, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED)
+        goto fail;
+    r->sqes = sqes;
+
+    char *base = ring;
+    r->sq_head = (unsigned*)(base + p.sq_off.head);
+    r->sq_tail = (unsigned*)(base + p.sq_off.tail);
+    r->sq_mask = *(unsigned*)(base + p.sq_off.ring_mask);
+    r->sq_entries = *(unsigned*)(base + p.sq_off.ring_entries);
+    r->sq_array = (unsigned*)(base + p.sq_off.array);
+    for (unsigned i = 0; i < r->sq_entries; i++)
+        r->sq_array[i] = i;
+    r->sq_local_tail = *r->sq_tail;
+    r->cq_head = (unsigned*)(base + p.cq_off.head);
+    r->cq_tail = (unsigned*)(base + p.cq_off.tail);
+    r->cq_mask = *(unsigned*)(base + p.cq_off.ring_mask);
+    r->cqes = (struct io_uring_cqe*)(base + p.cq_off.cqes);
+
+    /* Ring buffer untuk multishot recv: kernel memilih buffer sendiri saat
+       data datang, sehingga koneksi yang diam tidak memegang memori */
+    r->br_sz = URING_BUF_COUNT * sizeof(struct io_uring_buf);
+    void *br = mmap(NULL, r->br_sz, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (br == MAP_FAILED)
+        goto fail;
+    r->br = br;
+    r->bufs = malloc((size_t)URING_BUF_COUNT * URING_BUF_SIZE);
+    if (!r->bufs)
+        goto fail;
+    struct io_uring_buf_reg reg;
+    memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = (uint64_t)(uintptr_t)r->br;
+    reg.ring_entries = URING_BUF_COUNT;
+    reg.bgid = URING_BGID;
+    if (sys_uring_register(fd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0)
+        goto fail;
+    for (unsigned i = 0; i < URING_BUF_COUNT; i++)
+        uring_recycle_buf(r, (unsigned short)i);
+    uring_publish_bufs(r);
+    return 0;
+fail:
+    uring_destroy(r);
+    return -1;
+}
+
+/* Submit SQE yang sudah diisi. Mengembalikan jumlah yang diterima kernel */
+static int uring_submit(struct uring* r, unsigned min_complete, int timeout_ms, unsigned long* syscalls) {
+    __atomic_store_n(r->sq_tail, r->sq_local_tail, __ATOMIC_RELEASE);
+    struct io_uring_getevents_arg arg;
+    struct __kernel_timespec ts;
+    memset(&arg, 0, sizeof(arg));
+    if (timeout_ms >= 0) {
+        ts.tv_sec = timeout_ms / 1000;
+        ts.tv_nsec = (long long)(timeout_ms % 1000) * 1000000;
+        arg.ts = (uint64_t)(uintptr_t)&ts;
+    }
+    unsigned flags = IORING_ENTER_EXT_ARG | (min_complete ? IORING_ENTER_GETEVENTS : 0);
+    int ret = sys_uring_enter(r->fd, r->to_submit, min_complete, flags, &arg, sizeof(arg));
+    (*syscalls)++;
+    if (ret > 0)
+        r->to_submit -= (unsigned)ret > r->to_submit ? r->to_submit : (unsigned)ret;
+    return ret;
+}
+
+/* Mengambil n SQE berurutan (untuk rantai IOSQE_IO_LINK), submit dulu jika SQ penuh */
+static struct io_uring_sqe* uring_get_sqes(struct uring* r, unsigned n, unsigned long* syscalls) {
+    unsigned head = __atomic_load_n(r->sq_head, __ATOMIC_ACQUIRE);
+    if (r->sq_entries - (r->sq_local_tail - head) < n) {
+        if (uring_submit(r, 0, -1, syscalls) < 0 && errno != EBUSY)
+            return NULL;
+        head = __atomic_load_n(r->sq_head, __ATOMIC_ACQUIRE);
+        if (r->sq_entries - (r->sq_local_tail - head) < n)
+            return NULL;
+    }
+    struct io_uring_sqe *first = &r->sqes[r->sq_local_tail & r->sq_mask];
+    for (unsigned i = 0; i < n; i++) {
+        memset(&r->sqes[r->sq_local_tail & r->sq_mask], 0, sizeof(struct io_uring_sqe));
+        r->sq_local_tail++;
+        r->to_submit++;
+    }
+    return first;
+}
+
+static struct io_uring_sqe* uring_next_sqe(struct uring* r, struct io_uring_sqe* sqe) {
+    return &r->sqes[((unsigned)(sqe - r->sqes) + 1) & r->sq_mask];
+}
+
+static uint64_t op_data(const struct conn* c, int op) {
+    return ((uint64_t)c->gen << 32) | ((uint64_t)c->slot << 8) | (uint64_t)op;
+}
+
+/* --- Koneksi --- */
+
+static void release_slot(WINEIRC_loop* loop, struct conn* c) {
+    c->closing = 0;
+    c->detaching = 0;
+    c->dirty = 0;
+    c->in_len = 0;
+    c->out_len = c->out_off = 0;
+    c->inflight_len = c->inflight_off = 0;
+    c->out_msgs = c->inflight_msgs = 0;
+    c->out_trace = c->send_trace = 0;
+    c->send_busy = c->recv_armed = c->pending_ops = 0;
+    c->gen++;
+    loop->free_slots[loop->nfree++] = c->slot;
+}
+
+static void mark_dirty(WINEIRC_loop* loop, struct conn* c) {
+    if (c->dirty)
+        return;
+    if (loop->ndirty == loop->dirty_cap) {
+        unsigned cap = loop->dirty_cap ? loop->dirty_cap * 2 : 64;
+        unsigned *d = realloc(loop->dirty, cap * sizeof(unsigned));
+        if (!d)
+            return;
+        loop->dirty = d;
+        loop->dirty_cap = cap;
+    }
+    loop->dirty[loop->ndirty++] = c->slot;
+    c->dirty = 1;
+}
+
+static int queue_out(WINEIRC_loop* loop, struct conn* c, const char* data, size_t len) {
+    if (c->out_off > 0 && c->out_off == c->out_len)
+        c->out_len = c->out_off = 0;
+    if (c->out_len + len > c->out_cap) {
+        if (c->out_off > 0) {
+            memmove(c->out, c->out + c->out_off, c->out_len - c->out_off);
+            c->out_len -= c->out_off;
+            c->out_off = 0;
+        }
+        if (c->out_len + len > c->out_cap) {
+            size_t cap = c->out_cap ? c->out_cap : 1024;
+            while (cap < c->out_len + len)
+                cap *= 2;
+            char *p = realloc(c->out, cap);
+            if (!p)
+                return -1;
+            c->out = p;
+            c->out_cap = cap;
+        }
+    }
+    memcpy(c->out + c->out_len, data, len);
+    c->out_len += len;
+    mark_dirty(loop, c);
+    return 0;
+}
+
+/* Mengeluarkan koneksi dari loop. URING: operasi yang masih berjalan
+   dibatalkan dan slot baru dipakai ulang setelah CQE terakhirnya */
+static void drop_conn(WINEIRC_loop* loop, struct conn* c, int notify) {
+    WINEIRC_handle *handle = c->handle;
+    if (!handle)
+        return;
+    handle->loop_slot = -1;
+    WINEB2B_metrics_add(handle->metrics, WINEB2B_METRIC_SENDS_FAILED, c->out_msgs + c->inflight_msgs);
+    c->out_msgs = c->inflight_msgs = 0;
+    c->handle = NULL;
+    c->closing = 1;
+    if (loop->backend == WINEIRC_BACKEND_URING) {
+        int targets[2] = { c->recv_armed ? OP_RECV : 0, c->send_busy ? OP_SEND : 0 };
+        for (int i = 0; i < 2; i++) {
+            if (!targets[i])
+                continue;
+            struct io_uring_sqe *sqe = uring_get_sqes(&loop->ring, 1, &loop->stats.syscalls);
+            if (!sqe)
+                continue;
+            sqe->opcode = IORING_OP_ASYNC_CANCEL;
+            sqe->fd = -1;
+            sqe->addr = op_data(c, targets[i]);
+            sqe->user_data = op_data(c, OP_CANCEL);
+            c->pending_ops++;
+        }
+        if (c->pending_ops == 0)
+            release_slot(loop, c);
+    } else {
+        release_slot(loop, c);
+    }
+    if (notify && loop->cb.on_close)
+        loop->cb.on_close(handle, loop->user_data);
+}
+
+/* --- Trace --- */
+
+/* "PRIVMSG #chan" dari baris (tanpa tag dan prefix) untuk detail span */
+static void line_summary(const char* line, char* out, size_t len) {
+    if (*line == '@' && (line = strchr(line, ' ')) != NULL)
+        line++;
+    if (line && *line == ':' && (line = strchr(line, ' ')) != NULL)
+        line++;
+    size_t n = 0;
+    int words = 0;
+    for (; line && *line && n + 1 < len; line++) {
+        if (*line == ' ' && ++words == 2)
+            break;
+        out[n++] = *line;
+    }
+    out[n] = '\0';
+}
+
+/* Antrean out diserahkan ke kernel: waktu tunggu menjadi span irc.queue */
+static void trace_send_start(struct conn* c) {
+    if (!c->out_trace || c->send_trace)
+        return;
+    uint64_t now = WINEB2B_trace_now();
+    WINEB2B_trace_span(c->out_trace, "irc", "irc.queue", c->out_trace_ns, now, c->handle->nick);
+    c->send_trace = c->out_trace;
+    c->send_trace_ns = now;
+    c->out_trace = 0;
+}
+
+static void trace_send_done(struct conn* c) {
+    if (!c->send_trace)
+        return;
+    WINEB2B_trace_span(c->send_trace, "irc", "irc.send", c->send_trace_ns, WINEB2B_trace_now(), c->handle->nick);
+    c->send_trace = 0;
+}
+
+/* Waktu tag server-time ("2026-01-02T03:04:05.678Z") dalam milidetik,
+   atau waktu sekarang jika tag tidak ada/tidak valid */
+static int64_t server_time_ms(const char* value) {
+    int y, mo, d, h, mi, s, ms = 0;
+    if (value && sscanf(value, "%d-%d-%dT%d:%d:%d.%dZ", &y, &mo, &d, &h, &mi, &s, &ms) >= 6 && mo >= 1 && mo <= 12) {
+        /* Jumlah hari sejak 1970-01-01 (kalender Gregorian proleptik) */
+        y -= mo <= 2;
+        int64_t era = (y >= 0 ? y : y - 399) / 400;
+        int64_t yoe = y - era * 400;
+        int64_t doy = (153 * (mo + (mo > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+        int64_t days = era * 146097 + yoe * 365 + yoe / 4 - yoe / 100 + doy - 719468;
+        return ((days * 24 + h) * 60 + mi) * 60000 + (int64_t)s * 1000 + ms;
+    }
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/* PRIVMSG/NOTICE ke channel (termasuk CTCP ACTION) masuk ke handle->search */
+static void index_line(WINEIRC_handle* handle, const char* line) {
+    if (!strstr(line, " PRIVMSG ") && !strstr(line, " NOTICE "))
+        return;
+    size_t len = strlen(line);
+    char copy[len + 1];
+    memcpy(copy, line, len + 1);
+    WINEIRC_message msg;
+    if (WINEIRC_parse_line(copy, &msg) != 0 || !msg.prefix || msg.param_count < 2 ||
+        (strcmp(msg.command, "PRIVMSG") != 0 && strcmp(msg.command, "NOTICE") != 0) ||
+        !msg.params[0][0] || !strchr("#&+!", msg.params[0][0]))
+        return;
+    char *text = (char*)msg.params[1];
+    if (text[0] == '\x01') {
+        if (strncmp(text + 1, "ACTION ", 7) != 0)
+            return;     /* CTCP lain bukan percakapan */
+        text += 8;
+        char *end = strchr(text, '\x01');
+        if (end)
+            *end = '\0';
+    }
+    char nick[128], network[300];
+    WINEIRC_prefix_nick(msg.prefix, nick, sizeof(nick));
+    snprintf(network, sizeof(network), "irc:%s", handle->server ? handle->server : "");
+    WINEB2B_search_doc doc = { network, msg.params[0], nick, server_time_ms(WINEIRC_message_tag(&msg, "time")), text };
+    WINEB2B_search_add(handle->search, &doc);
+}
+
+/* PRIVMSG/NOTICE channel yang merupakan pantulan relay bridge (lihat WINEIRC_filter_echoes) */
+static int is_echo(WINEIRC_handle* handle, const char* line) {
+    if (!strstr(line, " PRIVMSG ") && !strstr(line, " NOTICE "))
+        return 0;
+    size_t len = strlen(line);
+    char copy[len + 1];
+    memcpy(copy, line, len + 1);
+    WINEIRC_message msg;
+    if (WINEIRC_parse_line(copy, &msg) != 0 || msg.param_count < 2 ||
+        (strcmp(msg.command, "PRIVMSG") != 0 && strcmp(msg.command, "NOTICE") != 0) ||
+        !msg.params[0][0] || !strchr("#&+!", msg.params[0][0]))
+        return 0;
+    char network[300];
+    snprintf(network, sizeof(network), "irc:%s", handle->server ? handle->server : "");
+    return WINEB2B_echo_check(handle->echo, network, msg.params[0], msg.params[1],
+                              WINEIRC_message_tag(&msg, WINEB2B_ORIGIN_TAG));
+}
+
+/* Baris biasa: daftar anggota, filter echo, indeks pencarian lalu on_line */
+static void process_line(WINEIRC_loop* loop, struct conn* c, char* line) {
+    /* Daftar anggota sudah terbaru saat on_line dipanggil */
+    if (c->handle->members)
+        WINEIRC_members_feed_line(c->handle->members, line);
+    if (!loop->cb.on_line && !c->handle->echo) {
+        if (c->handle->search)
+            index_line(c->handle, line);
+        return;
+    }
+    /* Filter echo dan driver yang dipanggil dari on_line mencatat ke trace pesan ini */
+    uint64_t trace = WINEB2B_trace_begin();
+    uint64_t start = 0;
+    char summary[WINEB2B_TRACE_DETAIL];
+    if (trace) {
+        start = WINEB2B_trace_now();
+        WINEB2B_trace_span(trace, "irc", "irc.recv", c->rx_ns ? c->rx_ns : start, start, c->handle->server);
+        line_summary(line, summary, sizeof(summary));
+    }
+    /* Pantulan pesan yang dikirim bridge tidak diindeks dan tidak diteruskan */
+    if (!c->handle->echo || !is_echo(c->handle, line)) {
+        if (c->handle->search)
+            index_line(c->handle, line);
+        if (loop->cb.on_line)
+            loop->cb.on_line(c->handle, line, loop->user_data);
+    }
+    if (trace)
+        WINEB2B_trace_span(trace, "irc", "irc.dispatch", start, WINEB2B_trace_now(), summary);
+    WINEB2B_trace_end();
+}
+
+/* Permintaan CHATHISTORY dikirim, baris live yang ditahan selama catch-up
+   diproses setelah on_batch */
+static void drain_history(WINEIRC_loop* loop, struct conn* c) {
+    char out[WINEIRC_LINE_MAX];
+    int n;
+    while (c->handle && c->handle->history &&
+           (n = WINEIRC_history_next_request(c->handle->history, out, sizeof(out))) > 0)
+        queue_out(loop, c, out, (size_t)n);
+    while (c->handle && c->handle->history &&
+           (n = WINEIRC_history_next_released(c->handle->history, out, sizeof(out))) != 0)
+        if (n > 0)
+            process_line(loop, c, out);
+}
+
+static void dispatch_line(WINEIRC_loop* loop, struct conn* c, char* line) {
+    WINEB2B_metrics_add(c->handle->metrics, WINEB2B_METRIC_LINES, 1);
+    if (strncmp(line, "PING ", 5) == 0) {
+        queue_out(loop, c, "PONG ", 5);
+        queue_out(loop, c, line + 5, strlen(line + 5));
+        queue_out(loop, c, "\r\n", 2);
+        return;
+    }
+    loop->lines++;
+    loop->stats.lines++;
+    if (!c->handle->history) {
+        process_line(loop, c, line);
+        return;
+    }
+    /* Anggota BATCH chathistory dan baris yang ditahan tidak diproses di sini */
+    if (!WINEIRC_history_feed_line(c->handle->history, line))
+        process_line(loop, c, line);
+    drain_history(loop, c);
+}
+
+/* Memecah c->in menjadi baris; sisa baris yang belum lengkap disimpan */
+static void consume_lines(WINEIRC_loop* loop, struct conn* c) {
+    char *start = c->in, *end = c->in + c->in_len, *nl;
+    while (c->handle && (nl = memchr(start, '\n', (size_t)(end - start))) != NULL) {
+        *nl = '\0';
+        if (nl > start && nl[-1] == '\r')
+            nl[-1] = '\0';
+        if (*start)
+            dispatch_line(loop, c, start);
+        start = nl + 1;
+    }
+    if (c->handle && c->handle->members)
+        WINEIRC_members_flush(c->handle->members);
+    size_t rest = (size_t)(end - start);
+    if (!c->handle || rest == sizeof(c->in))
+        rest = 0;   /* Terputus saat callback, atau baris terlalu panjang: dibuang */
+    memmove(c->in, start, rest);
+    c->in_len = rest;
+}
+
+/* Data masuk: jika PING keepalive sedang menunggu, selisihnya dicatat sebagai lag */
+static void note_rx(WINEIRC_loop* loop, struct conn* c, size_t len) {
+    c->last_rx_ms = now_ms();
+    if (WINEB2B_trace_sampling)
+        c->rx_ns = WINEB2B_trace_now();
+    loop->stats.bytes_in += len;
+    WINEB2B_metrics_add(c->handle->metrics, WINEB2B_METRIC_BYTES_IN, len);
+    if (c->ping_sent_ms) {
+        long lag = c->last_rx_ms - c->ping_sent_ms;
+        WINEB2B_metrics_record(c->handle->metrics, WINEB2B_METRIC_LAG, (uint64_t)lag * 1000);
+        WINEB2B_metrics_set(c->handle->metrics, WINEB2B_METRIC_LAG_MS, lag);
+        c->ping_sent_ms = 0;
+    }
+}
+
+static void feed(WINEIRC_loop* loop, struct conn* c, const char* data, size_t len) {
+    note_rx(loop, c, len);
+    while (len > 0 && c->handle) {
+        size_t n = sizeof(c->in) - c->in_len;
+        if (n > len)
+            n = len;
+        memcpy(c->in + c->in_len, data, n);
+        c->in_len += n;
+        data += n;
+        len -= n;
+        consume_lines(loop, c);
+    }
+}
+
+static void check_keepalive(WINEIRC_loop* loop, long now) {
+    for (unsigned i = 0; i < loop->nconns; i++) {
+        struct conn *c = loop->conns[i];
+        if (!c->handle || c->detaching)
+            continue;
+        if (c->ping_sent_ms) {
+            if (now - c->ping_sent_ms >= loop->keepalive_ms) {
+                loop->stats.dead++;
+                drop_conn(loop, c, 1);
+            }
+        } else if (now - c->last_rx_ms >= loop->keepalive_ms) {
+            queue_out(loop, c, KEEPALIVE_PING, sizeof(KEEPALIVE_PING) - 1);
+            c->ping_sent_ms = now;
+            c->ping_linked = 1;
+            loop->stats.pings++;
+        }
+    }
+}
+
+/* --- Backend URING --- */
+
+static int uring_arm_recv(WINEIRC_loop* loop, struct conn* c) {
+    struct io_uring_sqe *sqe = uring_get_sqes(&loop->ring, 1, &loop->stats.syscalls);
+    if (!sqe)
+        return -1;
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = c->fd;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = URING_BGID;
+    sqe->user_data = op_data(c, OP_RECV);
+    c->recv_armed = 1;
+    c->pending_ops++;
+    return 0;
+}
+
+/* Send dari inflight; PING keepalive diberi linked timeout sehingga kernel
+   membatalkan send yang tertahan (buffer socket penuh) setelah interval */
+static int uring_prep_send(WINEIRC_loop* loop, struct conn* c) {
+    struct uring *r = &loop->ring;
+    int linked = c->ping_linked && loop->keepalive_ms > 0;
+    struct io_uring_sqe *sqe = uring_get_sqes(r, linked ? 2 : 1, &loop->stats.syscalls);
+    if (!sqe)
+        return -1;
+    sqe->opcode = IORING_OP_SEND;
+    sqe->fd = c->fd;
+    sqe->addr = (uint64_t)(uintptr_t)(c->inflight + c->inflight_off);
+    sqe->len = (unsigned)(c->inflight_len - c->inflight_off);
+    sqe->msg_flags = MSG_NOSIGNAL;
+    sqe->user_data = op_data(c, OP_SEND);
+    c->send_busy = 1;
+    c->pending_ops++;
+    loop->stats.sends++;
+    if (linked) {
+        sqe->flags |= IOSQE_IO_LINK;
+        struct io_uring_sqe *t = uring_next_sqe(r, sqe);
+        t->opcode = IORING_OP_LINK_TIMEOUT;
+        t->fd = -1;
+        t->addr = (uint64_t)(uintptr_t)&r->ping_ts;
+        t->len = 1;
+        t->user_data = op_data(c, OP_LINK_TIMEOUT);
+        c->pending_ops++;
+        c->ping_linked = 0;
+    }
+    return 0;
+}
+
+/* Semua antrean yang menunggu menjadi SQE; dikirim bersama pada satu io_uring_enter */
+static void uring_flush(WINEIRC_loop* loop) {
+    for (unsigned i = 0; i < loop->ndirty; i++) {
+        struct conn *c = loop->conns[loop->dirty[i]];
+        c->dirty = 0;
+        if (!c->handle || c->send_busy || c->detaching || c->out_len == 0)
+            continue;
+        /* Tukar buffer: out menjadi inflight tanpa menyalin */
+        char *p = c->inflight;
+        size_t cap = c->inflight_cap;
+        c->inflight = c->out;
+        c->inflight_cap = c->out_cap;
+        c->inflight_len = c->out_len;
+        c->inflight_off = 0;
+        c->inflight_msgs = c->out_msgs;
+        c->out_msgs = 0;
+        trace_send_start(c);
+        c->out = p;
+        c->out_cap = cap;
+        c->out_len = c->out_off = 0;
+        if (uring_prep_send(loop, c) != 0)
+            drop_conn(loop, c, 1);
+    }
+    loop->ndirty = 0;
+}
+
+static void uring_handle_cqe(WINEIRC_loop* loop, const struct io_uring_cqe* cqe) {
+    struct uring *r = &loop->ring;
+    int op = (int)(cqe->user_data & 0xff);
+    unsigned slot = (unsigned)((cqe->user_data >> 8) & 0xffffff);
+    uint32_t gen = (uint32_t)(cqe->user_data >> 32);
+    struct conn *c = slot < loop->nconns ? loop->conns[slot] : NULL;
+    int has_buf = op == OP_RECV && (cqe->flags & IORING_CQE_F_BUFFER);
+    unsigned short bid = (unsigned short)(cqe->flags >> IORING_CQE_BUFFER_SHIFT);
+
+    if (!c || c->gen != gen) {
+        if (has_buf)
+            uring_recycle_buf(r, bid);
+        return;
+    }
+
+    switch (op) {
+    case OP_RECV:
+        if (has_buf) {
+            if (cqe->res > 0 && c->handle)
+                feed(loop, c, r->bufs + (size_t)bid * URING_BUF_SIZE, (size_t)cqe->res);
+            uring_recycle_buf(r, bid);
+        }
+        if (!(cqe->flags & IORING_CQE_F_MORE)) {
+            /* Multishot berhenti: re-arm jika hanya kehabisan buffer */
+            c->recv_armed = 0;
+            c->pending_ops--;
+            if (c->handle) {
+                if (cqe->res == -ENOBUFS)
+                    loop->stats.buffer_stalls++;
+                if (c->detaching) {
+                    /* WINEIRC_loop_detach: tidak di-arm ulang. Data berikutnya
+                       (atau EOF) tetap di socket untuk pemilik berikutnya */
+                } else if (cqe->res > 0 || cqe->res == -ENOBUFS || cqe->res == -ECANCELED) {
+                    /* ECANCELED: detach yang dibatalkan WINEIRC_loop_attach */
+                    if (uring_arm_recv(loop, c) != 0)
+                        drop_conn(loop, c, 1);
+                } else {
+                    drop_conn(loop, c, 1);
+                }
+            }
+        }
+        break;
+    case OP_SEND:
+        c->send_busy = 0;
+        c->pending_ops--;
+        if (!c->handle)
+            break;
+        if (cqe->res < 0) {
+            if (c->detaching)
+                break;  /* Socket rusak: pemilik berikutnya mendapat error yang sama */
+            if (cqe->res == -ECANCELED)
+                loop->stats.dead++;     /* Dibatalkan linked timeout */
+            drop_conn(loop, c, 1);
+            break;
+        }
+        loop->stats.bytes_out += (unsigned long)cqe->res;
+        WINEB2B_metrics_add(c->handle->metrics, WINEB2B_METRIC_BYTES_OUT, (uint64_t)cqe->res);
+        c->inflight_off += (size_t)cqe->res;
+        if (c->inflight_off < c->inflight_len) {
+            if (uring_prep_send(loop, c) != 0)
+                drop_conn(loop, c, 1);
+            break;
+        }
+        WINEB2B_metrics_add(c->handle->metrics, WINEB2B_METRIC_SENDS_DONE, c->inflight_msgs);
+        c->inflight_msgs = 0;
+        trace_send_done(c);
+        if (c->out_len > 0)
+            mark_dirty(loop, c);
+        break;
+    default:    /* OP_LINK_TIMEOUT, OP_CANCEL */
+        c->pending_ops--;
+        break;
+    }
+
+    if (c->closing && c->pending_ops == 0)
+        release_slot(loop, c);
+}
+
+static int uring_run(WINEIRC_loop* loop, int timeout_ms) {
+    struct uring *r = &loop->ring;
+    uring_flush(loop);
+
+    unsigned head = *r->cq_head;
+    int ready = head != __atomic_load_n(r->cq_tail, __ATOMIC_ACQUIRE);
+    if (r->to_submit > 0 || !ready) {
+        int ret = uring_submit(r, ready ? 0 : 1, timeout_ms, &loop->stats.syscalls);
+        if (ret < 0 && errno != ETIME && errno != EINTR && errno != EBUSY) {
+            perror("Error: io_uring_enter");
+            return -1;
+        }
+    }
+
+    unsigned tail = __atomic_load_n(r->cq_tail, __ATOMIC_ACQUIRE);
+    while (head != tail) {
+        uring_handle_cqe(loop, &r->cqes[head & r->cq_mask]);
+        head++;
+        if (head == tail) {
+            /* CQE baru mungkin sudah masuk selama callback */
+            __atomic_store_n(r->cq_head, head, __ATOMIC_RELEASE);
+            tail = __atomic_load_n(r->cq_tail, __ATOMIC_ACQUIRE);
+        }
+    }
+    __atomic_store_n(r->cq_head, head, __ATOMIC_RELEASE);
+    uring_publish_bufs(r);
+    return 0;
+}
+
+/* --- Backend POLL --- */
+
+static void poll_flush_conn(WINEIRC_loop* loop, struct conn* c) {
+    if (c->handle)
+        trace_send_start(c);
+    while (c->handle && c->out_off < c->out_len) {
+        ssize_t n = send(c->fd, c->out + c->out_off, c->out_len - c->out_off, MSG_DONTWAIT | MSG_NOSIGNAL);
+        loop->stats.syscalls++;
+        loop->stats.sends++;
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+                drop_conn(loop, c, 1);
+            return;     /* EAGAIN: dilanjutkan saat POLLOUT */
+        }
+        loop->stats.bytes_out += (unsigned long)n;
+        WINEB2B_metrics_add(c->handle->metrics, WINEB2B_METRIC_BYTES_OUT, (uint64_t)n);
+        c->out_off += (size_t)n;
+    }
+    if (c->handle && c->out_off == c->out_len) {
+        WINEB2B_metrics_add(c->handle->metrics, WINEB2B_METRIC_SENDS_DONE, c->out_msgs);
+        c->out_msgs = 0;
+        trace_send_done(c);
+        c->out_len = c->out_off = 0;
+    }
+}
+
+static void poll_flush(WINEIRC_loop* loop) {
+    for (unsigned i = 0; i < loop->ndirty; i++) {
+        struct conn *c = loop->conns[loop->dirty[i]];
+        c->dirty = 0;
+        poll_flush_conn(loop, c);
+    }
+    loop->ndirty = 0;
+}
+
+static int poll_run(WINEIRC_loop* loop, int timeout_ms) {
+    poll_flush(loop);
+
+    if (loop->pfd_cap < loop->nconns) {
+        unsigned cap = loop->nconns;
+        struct pollfd *p = realloc(loop->pfds, cap * sizeof(struct pollfd));
+        if (p)
+            loop->pfds = p;
+        struct conn **pc = realloc(loop->pfd_conn, cap * sizeof(struct conn*));
+        if (pc)
+            loop->pfd_conn = pc;
+        uint32_t *pg = realloc(loop->pfd_gen, cap * sizeof(uint32_t));
+        if (pg)
+            loop->pfd_gen = pg;
+        if (!p || !pc || !pg)
+            return -1;
+        loop->pfd_cap = cap;
+    }
+    nfds_t nfds = 0;
+    for (unsigned i = 0; i < loop->nconns; i++) {
+        struct conn *c = loop->conns[i];
+        if (!c->handle)
+            continue;
+        loop->pfds[nfds].fd = c->fd;
+        loop->pfds[nfds].events = POLLIN | (c->out_off < c->out_len ? POLLOUT : 0);
+        loop->pfds[nfds].revents = 0;
+        loop->pfd_conn[nfds] = c;
+        loop->pfd_gen[nfds] = c->gen;
+        nfds++;
+    }
+
+    int n = poll(loop->pfds, nfds, timeout_ms);
+    loop->stats.syscalls++;
+    if (n < 0) {
+        if (errno == EINTR)
+            return 0;
+        perror("Error: poll");
+        return -1;
+    }
+
+    for (nfds_t i = 0; i < nfds && n > 0; i++) {
+        struct pollfd *pfd = &loop->pfds[i];
+        if (!pfd->revents)
+            continue;
+        n--;
+        struct conn *c = loop->pfd_conn[i];
+        /* Koneksi bisa sudah dikeluarkan oleh callback sebelumnya */
+        if (!c->handle || c->gen != loop->pfd_gen[i])
+            continue;
+        if (pfd->revents & POLLOUT)
+            poll_flush_conn(loop, c);
+        if (!c->handle || !(pfd->revents & (POLLIN | POLLHUP | POLLERR)))
+            continue;
+        ssize_t r = recv(c->fd, c->in + c->in_len, sizeof(c->in) - c->in_len, MSG_DONTWAIT);
+        loop->stats.syscalls++;
+        if (r > 0) {
+            note_rx(loop, c, (size_t)r);
+            c->in_len += (size_t)r;
+            consume_lines(loop, c);
+        } else if (r == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+            drop_conn(loop, c, 1);
+        }
+    }
+    return 0;
+}
+
+/* --- API Publik --- */
+
+int WINEIRC_loop_uring_supported(void) {
+    static int supported = -1;
+    if (supported >= 0)
+        return supported;
+
+    /* Uji nyata: multishot recv dengan ring buffer di atas socketpair */
+    supported = 0;
+    struct uring r;
+    if (uring_init(&r) != 0)
+        return supported;
+    int sv[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) == 0) {
+        unsigned long syscalls = 0;
+        struct io_uring_sqe *sqe = uring_get_sqes(&r, 1, &syscalls);
+        sqe->opcode = IORING_OP_RECV;
+        sqe->fd = sv[0];
+        sqe->ioprio = IORING_RECV_MULTISHOT;
+        sqe->flags = IOSQE_BUFFER_SELECT;
+        sqe->buf_group = URING_BGID;
+        sqe->user_data = 1;
+        if (uring_submit(&r, 0, -1, &syscalls) == 1 && send(sv[1], "x", 1, 0) == 1 &&
+            (uring_submit(&r, 1, 1000, &syscalls) >= 0 || errno == ETIME)) {
+            unsigned head = *r.cq_head;
+            if (head != __atomic_load_n(r.cq_tail, __ATOMIC_ACQUIRE)) {
+                struct io_uring_cqe *cqe = &r.cqes[head & r.cq_mask];
+                supported = cqe->res == 1 && (cqe->flags & IORING_CQE_F_MORE) &&
+                            (cqe->flags & IORING_CQE_F_BUFFER);
+            }
+        }
+        close(sv[0]);
+        close(sv[1]);
+    }
+    uring_destroy(&r);
+    return supported;
+}
+
+WINEIRC_loop* WINEIRC_loop_create(WINEIRC_backend backend, const WINEIRC_loop_callbacks* callbacks,
+                                  void* user_data) {
+    if (backend == WINEIRC_BACKEND_AUTO)
+        backend = WINEIRC_loop_uring_supported() ? WINEIRC_BACKEND_URING : WINEIRC_BACKEND_POLL;
+    if (backend == WINEIRC_BACKEND_URING && !WINEIRC_loop_uring_supported()) {
+        fprintf(stderr, "Error: kernel tidak mendukung backend io_uring\n");
+        return NULL;
+    }
+
+    WINEIRC_loop *loop = calloc(1, sizeof(WINEIRC_loop));
+    if (!loop)
+        return NULL;
+    loop->backend = backend;
+    if (callbacks)
+        loop->cb = *callbacks;
+    loop->user_data = user_data;
+    loop->ring.fd = -1;
+    if (backend == WINEIRC_BACKEND_URING && uring_init(&loop->ring) != 0) {
+        perror("Error: io_uring_setup");
+        free(loop);
+        return NULL;
+    }
+    WINEIRC_loop_set_keepalive(loop, DEFAULT_KEEPALIVE_MS);
+    return loop;
+}
+
+WINEIRC_backend WINEIRC_loop_backend(const WINEIRC_loop* loop) {
+    return loop ? loop->backend : WINEIRC_BACKEND_AUTO;
+}
+
+void WINEIRC_loop_set_keepalive(WINEIRC_loop* loop, int interval_ms) {
+    if (!loop)
+        return;
+    loop->keepalive_ms = interval_ms > 0 ? interval_ms : 0;
+    loop->next_keepalive_ms = now_ms() + (loop->keepalive_ms ? loop->keepalive_ms / 4 + 1 : 0);
+    loop->ring.ping_ts.tv_sec = loop->keepalive_ms / 1000;
+    loop->ring.ping_ts.tv_nsec = (long long)(loop->keepalive_ms % 1000) * 1000000;
+}
+
+WINEIRCcode WINEIRC_loop_add(WINEIRC_loop* loop, WINEIRC_handle* handle) {
+    if (!loop || !handle || !handle->is_connected || handle->socket_fd < 0 || handle->loop_slot >= 0)
+        return -1;
+    /* Loop membaca socket langsung; TLS hanya bisa jika record ditangani kTLS */
+    if (handle->tls && (!WINEIRC_tls_ktls_tx(handle->tls) || !WINEIRC_tls_ktls_rx(handle->tls) ||
+                        WINEIRC_tls_pending(handle->tls) > 0)) {
+        fprintf(stderr, "Error: handle TLS tanpa kTLS tidak bisa dikelola loop\n");
+        return -1;
+    }
+
+    unsigned slot;
+    if (loop->nfree > 0) {
+        slot = loop->free_slots[--loop->nfree];
+    } else {
+        if (loop->nconns >= 0xffffff)
+            return -1;
+        if (loop->nconns == loop->conns_cap) {
+            unsigned cap = loop->conns_cap ? loop->conns_cap * 2 : 64;
+            struct conn **conns = realloc(loop->conns, cap * sizeof(struct conn*));
+            if (!conns)
+                return -1;
+            loop->conns = conns;
+            unsigned *free_slots = realloc(loop->free_slots, cap * sizeof(unsigned));
+            if (!free_slots)
+                return -1;
+            loop->free_slots = free_slots;
+            loop->conns_cap = cap;
+        }
+        struct conn *c = calloc(1, sizeof(struct conn));
+        if (!c)
+            return -1;
+        c->slot = loop->nconns;
+        loop->conns[loop->nconns] = c;
+        slot = loop->nconns++;
+    }
+
+    struct conn *c = loop->conns[slot];
+    c->handle = handle;
+    c->fd = handle->socket_fd;
+    c->last_rx_ms = now_ms();
+    c->ping_sent_ms = 0;
+    c->ping_linked = 0;
+    handle->loop_slot = (int)slot;
+    if (loop->backend == WINEIRC_BACKEND_URING && uring_arm_recv(loop, c) != 0) {
+        c->handle = NULL;
+        handle->loop_slot = -1;
+        release_slot(loop, c);
+        return -1;
+    }
+    return 0;
+}
+
+static struct conn* find_conn(WINEIRC_loop* loop, WINEIRC_handle* handle) {
+    if (!loop || !handle || handle->loop_slot < 0 || (unsigned)handle->loop_slot >= loop->nconns)
+        return NULL;
+    struct conn *c = loop->conns[handle->loop_slot];
+    return c->handle == handle ? c : NULL;
+}
+
+WINEIRCcode WINEIRC_loop_remove(WINEIRC_loop* loop, WINEIRC_handle* handle) {
+    struct conn *c = find_conn(loop, handle);
+    if (!c)
+        return -1;
+    drop_conn(loop, c, 0);
+    return 0;
+}
+
+WINEIRCcode WINEIRC_loop_detach(WINEIRC_loop* loop, WINEIRC_handle* handle, WINEIRC_loop_pending* pending) {
+    struct conn *c = find_conn(loop, handle);
+    if (!c || !pending)
+        return -1;
+    if (loop->backend == WINEIRC_BACKEND_URING) {
+        if (c->recv_armed && !c->detaching) {
+            struct io_uring_sqe *sqe = uring_get_sqes(&loop->ring, 1, &loop->stats.syscalls);
+            if (!sqe)
+                return -1;
+            sqe->opcode = IORING_OP_ASYNC_CANCEL;
+            sqe->fd = -1;
+            sqe->addr = op_data(c, OP_RECV);
+            sqe->user_data = op_data(c, OP_CANCEL);
+            c->pending_ops++;
+        }
+        c->detaching = 1;
+        /* Send yang sudah di kernel diselesaikan dulu; sisa out ikut diserahkan */
+        if (c->recv_armed || c->send_busy)
+            return 1;
+    }
+
+    /* consume_lines hanya menyisakan baris yang belum lengkap di in */
+    size_t out_len = c->out_len - c->out_off;
+    char *in = malloc(c->in_len + 1), *out = malloc(out_len + 1);
+    if (!in || !out) {
+        free(in);
+        free(out);
+        return -1;
+    }
+    memcpy(in, c->in, c->in_len);
+    memcpy(out, c->out + c->out_off, out_len);
+    pending->in = in;
+    pending->in_len = c->in_len;
+    pending->out = out;
+    pending->out_len = out_len;
+    /* Pesan di antrean diserahkan, bukan gagal */
+    c->out_msgs = 0;
+    c->out_trace = 0;
+    drop_conn(loop, c, 0);
+    return 0;
+}
+
+WINEIRCcode WINEIRC_loop_attach(WINEIRC_loop* loop, WINEIRC_handle* handle, const WINEIRC_loop_pending* pending) {
+    struct conn *c = find_conn(loop, handle);
+    if (c && c->detaching && !pending) {
+        /* Membatalkan detach yang belum selesai */
+        c->detaching = 0;
+        if (!c->recv_armed && uring_arm_recv(loop, c) != 0) {
+            drop_conn(loop, c, 1);
+            return -1;
+        }
+        if (c->out_off < c->out_len)
+            mark_dirty(loop, c);
+        return 0;
+    }
+    if (pending && pending->in_len >= WINEIRC_LINE_MAX)
+        return -1;
+    if (WINEIRC_loop_add(loop, handle) != 0)
+        return -1;
+    if (!pending)
+        return 0;
+    c = loop->conns[handle->loop_slot];
+    memcpy(c->in, pending->in, pending->in_len);
+    c->in_len = pending->in_len;
+    if (pending->out_len > 0 && queue_out(loop, c, pending->out, pending->out_len) != 0) {
+        drop_conn(loop, c, 0);
+        return -1;
+    }
+    return 0;
+}
+
+WINEIRCcode WINEIRC_loop_send(WINEIRC_loop* loop, WINEIRC_handle* handle, const char* data, size_t len) {
+    struct conn *c = find_conn(loop, handle);
+    if (!c || !data)
+        return -1;
+    WINEB2B_metrics_add(handle->metrics, WINEB2B_METRIC_SENDS_QUEUED, 1);
+    if (queue_out(loop, c, data, len) != 0) {
+        WINEB2B_metrics_add(handle->metrics, WINEB2B_METRIC_SENDS_FAILED, 1);
+        return -1;
+    }
+    c->out_msgs++;
+    if (WINEB2B_trace_current && !c->out_trace) {
+        /* Hanya pesan pertama yang ditrace per batch antrean */
+        c->out_trace = WINEB2B_trace_current;
+        c->out_trace_ns = WINEB2B_trace_now();
+    }
+    return 0;
+}
+
+int WINEIRC_loop_run(WINEIRC_loop* loop, int timeout_ms) {
+    if (!loop)
+        return -1;
+    loop->lines = 0;
+
+    int wait = timeout_ms;
+    if (loop->keepalive_ms > 0) {
+        long now = now_ms();
+        if (now >= loop->next_keepalive_ms) {
+            check_keepalive(loop, now);
+            loop->next_keepalive_ms = now + loop->keepalive_ms / 4 + 1;
+        }
+        long until = loop->next_keepalive_ms - now;
+        if (wait < 0 || wait > until)
+            wait = (int)until;
+    }
+
+    int ret = loop->backend == WINEIRC_BACKEND_URING ? uring_run(loop, wait) : poll_run(loop, wait);
+    return ret < 0 ? -1 : loop->lines;
+}
+
+void WINEIRC_loop_get_stats(const WINEIRC_loop* loop, WINEIRC_loop_stats* out) {
+    if (!loop || !out)
+        return;
+    *out = loop->stats;
+}
+
+void WINEIRC_loop_free(WINEIRC_loop* loop) {
+    if (!loop)
+        return;
+    if (loop->backend == WINEIRC_BACKEND_URING) {
+        /* Batalkan semua operasi dan tunggu CQE-nya: kernel tidak boleh lagi
+           menulis ke buffer yang akan dibebaskan */
+        for (unsigned i = 0; i < loop->nconns; i++)
+            drop_conn(loop, loop->conns[i], 0);
+        for (int round = 0; round < 100; round++) {
+            int pending = 0;
+            for (unsigned i = 0; i < loop->nconns; i++)
+                pending += loop->conns[i]->pending_ops;
+            if (!pending || uring_run(loop, 10) != 0)
+                break;
+        }
+        uring_destroy(&loop->ring);
+    }
+    for (unsigned i = 0; i < loop->nconns; i++) {
+        struct conn *c = loop->conns[i];
+        if (c->handle)
+            c->handle->loop_slot = -1;
+        free(c->out);
+        free(c->inflight);
+        free(c);
+    }
+    free(loop->conns);
+    free(loop->free_slots);
+    free(loop->dirty);
+    free(loop->pfds);
+    free(loop->pfd_conn);
+    free(loop->pfd_gen);
+    free(loop);
+}
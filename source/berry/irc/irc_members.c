@@ -0,0 +1,955 @@
+#include "irc_members.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#define MAX_PREFIXES  8
+#define NICK_MAX      128
+#define LINE_MAX_LEN  8704       /* 8191 byte tag + 512 byte pesan */
+#define NONE          UINT32_MAX
+
+enum { KIND_NICK, KIND_CHANNEL };
+
+struct nick {
+    char *name;                 /* NULL = slot bebas */
+    uint32_t hash;
+    uint32_t nchans, chans_cap;
+    uint32_t *chans;            /* ID channel tempat nick ini berada */
+    int pending;                /* Menunggu di batch QUIT */
+};
+
+/* Record anggota: 8 byte per (channel, nick) */
+struct member {
+    uint32_t nick;              /* ID nick + 1, 0 = kosong */
+    uint8_t modes;              /* Bit i = prefix ke-i dari PREFIX (0 = tertinggi) */
+    uint8_t gen;                /* Generasi NAMES/WHOX terakhir yang memuat anggota ini */
+};
+
+struct channel {
+    char *name;                 /* NULL = slot bebas */
+    uint32_t hash;
+    struct member *slots;       /* Open addressing, linear probing */
+    uint32_t mask, count;
+    uint8_t gen;
+    int listing;                /* NAMES/WHOX sedang diterima */
+    int synced;
+};
+
+/* Indeks nama -> ID (ID + 1 di slot, 0 = kosong) */
+struct index {
+    uint32_t *slots;
+    uint32_t mask, count;
+};
+
+struct _WINEIRC_members {
+    WINEIRC_members_callbacks cb;
+    void *user_data;
+    char *self;
+    unsigned char fold[256];
+    char prefix_modes[MAX_PREFIXES + 1];
+    char prefix_chars[MAX_PREFIXES + 1];
+    int nprefix;
+    char chanmodes[4][64];      /* Tipe A, B, C, D dari CHANMODES */
+    char chantypes[16];
+    struct nick *nicks;
+    uint32_t nnicks, nicks_cap;
+    uint32_t *free_nicks;
+    uint32_t nfree_nicks;
+    struct channel *chans;
+    uint32_t nchans, chans_cap;
+    struct index nick_index, chan_index;
+    uint32_t *pending;          /* ID nick yang QUIT-nya ditahan */
+    size_t npending, pending_cap;
+    char batch_ref[64];         /* BATCH netsplit yang sedang terbuka */
+    unsigned long batched_quits;
+    char line[LINE_MAX_LEN];
+};
+
+/* --- Casemapping dan hash --- */
+
+static void set_casemapping(WINEIRC_members* m, const char* mapping) {
+    for (int c = 0; c < 256; c++)
+        m->fold[c] = (unsigned char)(c >= 'A' && c <= 'Z' ? c + 32 : c);
+    if (strcmp(mapping, "ascii") == 0)
+        return;
+    m->fold['['] = '{';
+    m->fold[']'] = '}';
+    m->fold['\\'] = '|';
+    if (strcmp(mapping, "strict-rfc1459") != 0)
+        m->fold['~'] = '^';
+}
+
+static uint32_t hash_name(const WINEIRC_members* m, const char* s) {
+    uint32_t h = 2166136261u;
+    for (; *s; s++)
+        h = (h ^ m->fold[(unsigned char)*s]) * 16777619u;
+    return h;
+}
+
+static int name_eq(const WINEIRC_members* m, const char* a, const char* b) {
+    for (; *a && *b; a++, b++)
+        if (m->fold[(unsigned char)*a] != m->fold[(unsigned char)*b])
+            return 0;
+    return *a == *b;
+}
+
+static uint32_t mix(uint32_t id) {
+    return id * 2654435761u;
+}
+
+/* --- Indeks nama --- */
+
+static struct index* index_of(WINEIRC_members* m, int kind) {
+    return kind == KIND_NICK ? &m->nick_index : &m->chan_index;
+}
+
+static void key_of(const WINEIRC_members* m, int kind, uint32_t id, const char** name, uint32_t* hash) {
+    if (kind == KIND_NICK) {
+        *name = m->nicks[id].name;
+        *hash = m->nicks[id].hash;
+    } else {
+        *name = m->chans[id].name;
+        *hash = m->chans[id].hash;
+    }
+}
+
+static uint32_t index_find(const WINEIRC_members* m, int kind, const char* name) {
+    const struct index *idx = kind == KIND_NICK ? &m->nick_index : &m->chan_index;
+    if (!idx->slots)
+        return NONE;
+    uint32_t hash = hash_name(m, name);
+    for (uint32_t i = hash & idx->mask; idx->slots[i]; i = (i + 1) & idx->mask) {
+        const char *key;
+        uint32_t h;
+        key_of(m, kind, idx->slots[i] - 1, &key, &h);
+        if (h == hash && name_eq(m, key, name))
+            return idx->slots[i] - 1;
+    }
+    return NONE;
+}
+
+static void index_place(WINEIRC_members* m, int kind, struct index* idx, uint32_t id) {
+    const char *key;
+    uint32_t h;
+    key_of(m, kind, id, &key, &h);
+    uint32_t i = h & idx->mask;
+    while (idx->slots[i])
+        i = (i + 1) & idx->mask;
+    idx->slots[i] = id + 1;
+}
+
+static int index_insert(WINEIRC_members* m, int kind, uint32_t id) {
+    struct index *idx = index_of(m, kind);
+    if (!idx->slots || (idx->count + 1) * 4 > (idx->mask + 1) * 3) {
+        uint32_t cap = idx->slots ? (idx->mask + 1) * 2 : 16;
+        uint32_t *old = idx->slots, old_cap = idx->slots ? idx->mask + 1 : 0;
+        idx->slots = calloc(cap, sizeof(uint32_t));
+        if (!idx->slots) {
+            idx->slots = old;
+            return -1;
+        }
+        idx->mask = cap - 1;
+        for (uint32_t i = 0; i < old_cap; i++)
+            if (old[i])
+                index_place(m, kind, idx, old[i] - 1);
+        free(old);
+    }
+    index_place(m, kind, idx, id);
+    idx->count++;
+    return 0;
+}
+
+static void index_remove(WINEIRC_members* m, int kind, uint32_t id) {
+    struct index *idx = index_of(m, kind);
+    const char *key;
+    uint32_t h;
+    key_of(m, kind, id, &key, &h);
+    uint32_t i = h & idx->mask;
+    while (idx->slots[i] && idx->slots[i] != id + 1)
+        i = (i + 1) & idx->mask;
+    if (!idx->slots[i])
+        return;
+    /* Backward shift: entri sesudahnya dimundurkan agar probing tetap utuh */
+    for (uint32_t j = (i + 1) & idx->mask; idx->slots[j]; j = (j + 1) & idx->mask) {
+        key_of(m, kind, idx->slots[j] - 1, &key, &h);
+        uint32_t home = h & idx->mask;
+        if (((j - home) & idx->mask) >= ((j - i) & idx->mask)) {
+            idx->slots[i] = idx->slots[j];
+            i = j;
+        }
+    }
+    idx->slots[i] = 0;
+    idx->count--;
+}
+
+static void index_rebuild(WINEIRC_members* m, int kind) {
+    struct index *idx = index_of(m, kind);
+    if (!idx->slots)
+        return;
+    memset(idx->slots, 0, (idx->mask + 1) * sizeof(uint32_t));
+    uint32_t n = kind == KIND_NICK ? m->nnicks : m->nchans;
+    for (uint32_t id = 0; id < n; id++) {
+        if (kind == KIND_NICK && m->nicks[id].name)
+            m->nicks[id].hash = hash_name(m, m->nicks[id].name);
+        else if (kind == KIND_CHANNEL && m->chans[id].name)
+            m->chans[id].hash = hash_name(m, m->chans[id].name);
+        else
+            continue;
+        index_place(m, kind, idx, id);
+    }
+}
+
+/* --- Nick --- */
+
+static uint32_t nick_intern(WINEIRC_members* m, const char* name) {
+    uint32_t id = index_find(m, KIND_NICK, name);
+    if (id != NONE)
+        return id;
+    if (m->nfree_nicks > 0) {
+        id = m->free_nicks[--m->nfree_nicks];
+    } else {
+        if (m->nnicks == m->nicks_cap) {
+            uint32_t cap = m->nicks_cap ? m->nicks_cap * 2 : 64;
+            struct nick *n = realloc(m->nicks, cap * sizeof(struct nick));
+            uint32_t *f = realloc(m->free_nicks, cap * sizeof(uint32_t));
+            if (n)
+                m->nicks = n;
+            if (f)
+                m->free_nicks = f;
+            if (!n || !f)
+                return NONE;
+            m->nicks_cap = cap;
+        }
+        id = m->nnicks++;
+    }
+    struct nick *n = &m->nicks[id];
+    memset(n, 0, sizeof(*n));
+    n->name = strdup(name);
+    n->hash = hash_name(m, name);
+    if (!n->name || index_insert(m, KIND_NICK, id) != 0) {
+        free(n->name);
+        n->name = NULL;
+        m->free_nicks[m->nfree_nicks++] = id;
+        return NONE;
+    }
+    return id;
+}
+
+static void nick_release_if_unused(WINEIRC_members* m, uint32_t id) {
+    struct nick *n = &m->nicks[id];
+    if (!n->name || n->nchans > 0 || n->pending)
+        return;
+    index_remove(m, KIND_NICK, id);
+    free(n->name);
+    free(n->chans);
+    memset(n, 0, sizeof(*n));
+    m->free_nicks[m->nfree_nicks++] = id;
+}
+
+static int nick_add_chan(struct nick* n, uint32_t cid) {
+    if (n->nchans == n->chans_cap) {
+        uint32_t cap = n->chans_cap ? n->chans_cap * 2 : 2;
+        uint32_t *c = realloc(n->chans, cap * sizeof(uint32_t));
+        if (!c)
+            return -1;
+        n->chans = c;
+        n->chans_cap = cap;
+    }
+    n->chans[n->nchans++] = cid;
+    return 0;
+}
+
+static void nick_remove_chan(struct nick* n, uint32_t cid) {
+    for (uint32_t i = 0; i < n->nchans; i++) {
+        if (n->chans[i] == cid) {
+            n->chans[i] = n->chans[--n->nchans];
+            return;
+        }
+    }
+}
+
+/* Nick dari prefix "nick!user@host" */
+static int prefix_nick(const WINEIRC_message* msg, char* out) {
+    return msg->prefix ? WINEIRC_prefix_nick(msg->prefix, out, NICK_MAX) : -1;
+}
+
+/* --- Anggota channel --- */
+
+static struct member* member_find(const struct channel* ch, uint32_t nid) {
+    if (!ch->slots)
+        return NULL;
+    for (uint32_t i = mix(nid) & ch->mask; ch->slots[i].nick; i = (i + 1) & ch->mask)
+        if (ch->slots[i].nick == nid + 1)
+            return &ch->slots[i];
+    return NULL;
+}
+
+static void member_place(struct member* slots, uint32_t mask, struct member rec) {
+    uint32_t i = mix(rec.nick - 1) & mask;
+    while (slots[i].nick)
+        i = (i + 1) & mask;
+    slots[i] = rec;
+}
+
+/* 1 jika anggota baru, 0 jika sudah ada (mode diganti), -1 jika gagal */
+static int member_add(WINEIRC_members* m, uint32_t cid, uint32_t nid, unsigned modes) {
+    struct channel *ch = &m->chans[cid];
+    struct member *rec = member_find(ch, nid);
+    if (rec) {
+        rec->modes = (uint8_t)modes;
+        rec->gen = ch->gen;
+        return 0;
+    }
+    if (!ch->slots || (ch->count + 1) * 4 > (ch->mask + 1) * 3) {
+        uint32_t cap = ch->slots ? (ch->mask + 1) * 2 : 8;
+        struct member *slots = calloc(cap, sizeof(struct member));
+        if (!slots)
+            return -1;
+        for (uint32_t i = 0; ch->slots && i <= ch->mask; i++)
+            if (ch->slots[i].nick)
+                member_place(slots, cap - 1, ch->slots[i]);
+        free(ch->slots);
+        ch->slots = slots;
+        ch->mask = cap - 1;
+    }
+    if (nick_add_chan(&m->nicks[nid], cid) != 0)
+        return -1;
+    struct member r = { nid + 1, (uint8_t)modes, ch->gen };
+    member_place(ch->slots, ch->mask, r);
+    ch->count++;
+    return 1;
+}
+
+/* Menghapus slot tanpa menyentuh daftar channel milik nick */
+static void member_delete_slot(struct channel* ch, struct member* rec) {
+    uint32_t i = (uint32_t)(rec - ch->slots);
+    for (uint32_t j = (i + 1) & ch->mask; ch->slots[j].nick; j = (j + 1) & ch->mask) {
+        uint32_t home = mix(ch->slots[j].nick - 1) & ch->mask;
+        if (((j - home) & ch->mask) >= ((j - i) & ch->mask)) {
+            ch->slots[i] = ch->slots[j];
+            i = j;
+        }
+    }
+    ch->slots[i].nick = 0;
+    ch->count--;
+}
+
+static int member_remove(WINEIRC_members* m, uint32_t cid, uint32_t nid) {
+    struct member *rec = member_find(&m->chans[cid], nid);
+    if (!rec)
+        return -1;
+    member_delete_slot(&m->chans[cid], rec);
+    nick_remove_chan(&m->nicks[nid], cid);
+    return 0;
+}
+
+/* --- Channel --- */
+
+static uint32_t chan_create(WINEIRC_members* m, const char* name) {
+    uint32_t cid = index_find(m, KIND_CHANNEL, name);
+    if (cid != NONE)
+        return cid;
+    for (cid = 0; cid < m->nchans && m->chans[cid].name; cid++)
+        ;
+    if (cid == m->nchans) {
+        if (m->nchans == m->chans_cap) {
+            uint32_t cap = m->chans_cap ? m->chans_cap * 2 : 8;
+            struct channel *c = realloc(m->chans, cap * sizeof(struct channel));
+            if (!c)
+                return NONE;
+            m->chans = c;
+            m->chans_cap = cap;
+        }
+        m->nchans++;
+    }
+    struct channel *ch = &m->chans[cid];
+    memset(ch, 0, sizeof(*ch));
+    ch->name = strdup(name);
+    ch->hash = hash_name(m, name);
+    if (!ch->name || index_insert(m, KIND_CHANNEL, cid) != 0) {
+        free(ch->name);
+        ch->name = NULL;
+        return NONE;
+    }
+    return cid;
+}
+
+static void chan_drop(WINEIRC_members* m, uint32_t cid) {
+    struct channel *ch = &m->chans[cid];
+    for (uint32_t i = 0; ch->slots && i <= ch->mask; i++) {
+        if (!ch->slots[i].nick)
+            continue;
+        uint32_t nid = ch->slots[i].nick - 1;
+        nick_remove_chan(&m->nicks[nid], cid);
+        nick_release_if_unused(m, nid);
+    }
+    index_remove(m, KIND_CHANNEL, cid);
+    free(ch->slots);
+    free(ch->name);
+    memset(ch, 0, sizeof(*ch));
+}
+
+/* --- Callback --- */
+
+static void notify(WINEIRC_members* m, WINEIRC_member_event ev, const char* channel, const char* nick,
+                   const char* old_nick) {
+    if (m->cb.on_change)
+        m->cb.on_change(ev, channel, nick, old_nick, m->user_data);
+}
+
+/* --- QUIT --- */
+
+static void quit_remove(WINEIRC_members* m, uint32_t nid) {
+    struct nick *n = &m->nicks[nid];
+    for (uint32_t i = 0; i < n->nchans; i++) {
+        struct channel *ch = &m->chans[n->chans[i]];
+        struct member *rec = member_find(ch, nid);
+        if (rec)
+            member_delete_slot(ch, rec);
+    }
+    n->nchans = 0;
+}
+
+static void apply_pending(WINEIRC_members* m) {
+    if (m->npending == 0)
+        return;
+    const char **names = malloc(m->npending * sizeof(char*));
+    for (size_t i = 0; i < m->npending; i++) {
+        quit_remove(m, m->pending[i]);
+        if (names)
+            names[i] = m->nicks[m->pending[i]].name;
+    }
+    if (names && m->cb.on_quit_batch) {
+        m->cb.on_quit_batch(names, m->npending, m->user_data);
+    } else {
+        for (size_t i = 0; i < m->npending; i++)
+            notify(m, WINEIRC_MEMBER_QUIT, NULL, m->nicks[m->pending[i]].name, NULL);
+    }
+    free(names);
+    for (size_t i = 0; i < m->npending; i++) {
+        m->nicks[m->pending[i]].pending = 0;
+        nick_release_if_unused(m, m->pending[i]);
+    }
+    m->batched_quits += m->npending;
+    m->npending = 0;
+}
+
+/* Alasan QUIT netsplit klasik: "server.a server.b" */
+static int netsplit_reason(const char* reason) {
+    const char *sp = strchr(reason, ' ');
+    if (!sp || sp == reason || strchr(sp + 1, ' ') || !sp[1])
+        return 0;
+    const char *dot = memchr(reason, '.', (size_t)(sp - reason));
+    return dot && strchr(sp + 1, '.') != NULL;
+}
+
+static void handle_quit(WINEIRC_members* m, const WINEIRC_message* msg) {
+    char nick[NICK_MAX];
+    if (prefix_nick(msg, nick) != 0)
+        return;
+    uint32_t nid = index_find(m, KIND_NICK, nick);
+    if (nid == NONE)
+        return;
+    const char *batch = WINEIRC_message_tag(msg, "batch");
+    const char *reason = msg->param_count > 0 ? msg->params[0] : "";
+    int batched = m->batch_ref[0] ? batch && strcmp(batch, m->batch_ref) == 0 : netsplit_reason(reason);
+    if (batched) {
+        if (m->nicks[nid].pending)
+            return;
+        if (m->npending == m->pending_cap) {
+            size_t cap = m->pending_cap ? m->pending_cap * 2 : 64;
+            uint32_t *p = realloc(m->pending, cap * sizeof(uint32_t));
+            if (!p) {
+                batched = 0;
+            } else {
+                m->pending = p;
+                m->pending_cap = cap;
+            }
+        }
+        if (batched) {
+            m->nicks[nid].pending = 1;
+            m->pending[m->npending++] = nid;
+            return;
+        }
+    }
+    quit_remove(m, nid);
+    notify(m, WINEIRC_MEMBER_QUIT, NULL, m->nicks[nid].name, NULL);
+    nick_release_if_unused(m, nid);
+}
+
+static void handle_batch(WINEIRC_members* m, const WINEIRC_message* msg) {
+    if (msg->param_count < 1)
+        return;
+    const char *ref = msg->params[0];
+    if (ref[0] == '+' && msg->param_count >= 2 && strcmp(msg->params[1], "netsplit") == 0 && !m->batch_ref[0]) {
+        apply_pending(m);
+        snprintf(m->batch_ref, sizeof(m->batch_ref), "%s", ref + 1);
+    } else if (ref[0] == '-' && m->batch_ref[0] && strcmp(ref + 1, m->batch_ref) == 0) {
+        apply_pending(m);
+        m->batch_ref[0] = '\0';
+    }
+}
+
+/* --- JOIN / PART / KICK / NICK --- */
+
+static int is_self(const WINEIRC_members* m, const char* nick) {
+    return m->self && name_eq(m, m->self, nick);
+}
+
+static void handle_join(WINEIRC_members* m, const WINEIRC_message* msg) {
+    char nick[NICK_MAX];
+    if (msg->param_count < 1 || prefix_nick(msg, nick) != 0)
+        return;
+    int self = is_self(m, nick);
+    uint32_t nid = index_find(m, KIND_NICK, nick);
+    if (nid != NONE && m->nicks[nid].pending)
+        apply_pending(m);
+    char channels[512];
+    snprintf(channels, sizeof(channels), "%s", msg->params[0]);
+    for (char *save = NULL, *name = strtok_r(channels, ",", &save); name; name = strtok_r(NULL, ",", &save)) {
+        uint32_t cid = self ? chan_create(m, name) : index_find(m, KIND_CHANNEL, name);
+        if (cid == NONE)
+            continue;
+        nid = nick_intern(m, nick);
+        if (nid == NONE)
+            return;
+        if (member_add(m, cid, nid, 0) == 1)
+            notify(m, WINEIRC_MEMBER_JOIN, m->chans[cid].name, nick, NULL);
+    }
+}
+
+static void leave(WINEIRC_members* m, WINEIRC_member_event ev, const char* channel, const char* nick) {
+    uint32_t cid = index_find(m, KIND_CHANNEL, channel);
+    if (cid == NONE)
+        return;
+    if (is_self(m, nick)) {
+        notify(m, ev, m->chans[cid].name, nick, NULL);
+        chan_drop(m, cid);
+        return;
+    }
+    uint32_t nid = index_find(m, KIND_NICK, nick);
+    if (nid == NONE || member_remove(m, cid, nid) != 0)
+        return;
+    notify(m, ev, m->chans[cid].name, m->nicks[nid].name, NULL);
+    nick_release_if_unused(m, nid);
+}
+
+static void handle_part(WINEIRC_members* m, const WINEIRC_message* msg) {
+    char nick[NICK_MAX];
+    if (msg->param_count < 1 || prefix_nick(msg, nick) != 0)
+        return;
+    char channels[512];
+    snprintf(channels, sizeof(channels), "%s", msg->params[0]);
+    for (char *save = NULL, *name = strtok_r(channels, ",", &save); name; name = strtok_r(NULL, ",", &save))
+        leave(m, WINEIRC_MEMBER_PART, name, nick);
+}
+
+static void handle_kick(WINEIRC_members* m, const WINEIRC_message* msg) {
+    if (msg->param_count < 2)
+        return;
+    char victims[512];
+    snprintf(victims, sizeof(victims), "%s", msg->params[1]);
+    for (char *save = NULL, *nick = strtok_r(victims, ",", &save); nick; nick = strtok_r(NULL, ",", &save))
+        leave(m, WINEIRC_MEMBER_KICK, msg->params[0], nick);
+}
+
+static void handle_nick(WINEIRC_members* m, const WINEIRC_message* msg) {
+    char old[NICK_MAX];
+    if (msg->param_count < 1 || prefix_nick(msg, old) != 0)
+        return;
+    const char *new_nick = msg->params[0];
+    if (is_self(m, old)) {
+        char *s = strdup(new_nick);
+        if (s) {
+            free(m->self);
+            m->self = s;
+        }
+    }
+    uint32_t nid = index_find(m, KIND_NICK, old);
+    if (nid == NONE)
+        return;
+    char *name = strdup(new_nick);
+    if (!name)
+        return;
+    /* ID tetap, jadi record anggota di semua channel tidak perlu disentuh */
+    index_remove(m, KIND_NICK, nid);
+    free(m->nicks[nid].name);
+    m->nicks[nid].name = name;
+    m->nicks[nid].hash = hash_name(m, name);
+    index_insert(m, KIND_NICK, nid);
+    notify(m, WINEIRC_MEMBER_NICK, NULL, name, old);
+}
+
+/* --- MODE --- */
+
+static int prefix_bit(char c, const char* set) {
+    const char *p = c ? strchr(set, c) : NULL;
+    return p ? (int)(p - set) : -1;
+}
+
+static void handle_mode(WINEIRC_members* m, const WINEIRC_message* msg) {
+    if (msg->param_count < 2)
+        return;
+    uint32_t cid = index_find(m, KIND_CHANNEL, msg->params[0]);
+    if (cid == NONE)
+        return;
+    int arg = 2, adding = 1;
+    for (const char *p = msg->params[1]; *p; p++) {
+        if (*p == '+' || *p == '-') {
+            adding = *p == '+';
+            continue;
+        }
+        int bit = prefix_bit(*p, m->prefix_modes);
+        if (bit < 0) {
+            /* Mode lain: hanya perlu tahu apakah memakai parameter */
+            if (strchr(m->chanmodes[0], *p) || strchr(m->chanmodes[1], *p) ||
+                (adding && strchr(m->chanmodes[2], *p)))
+                arg++;
+            continue;
+        }
+        if (arg >= msg->param_count)
+            break;
+        uint32_t nid = index_find(m, KIND_NICK, msg->params[arg++]);
+        struct member *rec = nid == NONE ? NULL : member_find(&m->chans[cid], nid);
+        if (!rec)
+            continue;
+        uint8_t modes = adding ? rec->modes | (1u << bit) : rec->modes & ~(1u << bit);
+        if (modes != rec->modes) {
+            rec->modes = modes;
+            notify(m, WINEIRC_MEMBER_MODE, m->chans[cid].name, m->nicks[nid].name, NULL);
+        }
+    }
+}
+
+/* --- Registrasi dan ISUPPORT --- */
+
+static void handle_isupport(WINEIRC_members* m, const WINEIRC_message* msg) {
+    for (int i = 1; i < msg->param_count - 1; i++) {
+        const char *t = msg->params[i];
+        if (strncmp(t, "PREFIX=(", 8) == 0) {
+            const char *close = strchr(t + 8, ')');
+            size_t n = close ? (size_t)(close - (t + 8)) : 0;
+            if (n == 0 || n > MAX_PREFIXES || strlen(close + 1) != n)
+                continue;
+            memcpy(m->prefix_modes, t + 8, n);
+            m->prefix_modes[n] = '\0';
+            memcpy(m->prefix_chars, close + 1, n);
+            m->prefix_chars[n] = '\0';
+            m->nprefix = (int)n;
+        } else if (strncmp(t, "CHANMODES=", 10) == 0) {
+            const char *p = t + 10;
+            for (int type = 0; type < 4; type++) {
+                size_t n = strcspn(p, ",");
+                snprintf(m->chanmodes[type], sizeof(m->chanmodes[type]), "%.*s", (int)n, p);
+                p += n;
+                if (*p == ',')
+                    p++;
+            }
+        } else if (strncmp(t, "CHANTYPES=", 10) == 0) {
+            snprintf(m->chantypes, sizeof(m->chantypes), "%s", t + 10);
+        } else if (strncmp(t, "CASEMAPPING=", 12) == 0) {
+            set_casemapping(m, t + 12);
+            index_rebuild(m, KIND_NICK);
+            index_rebuild(m, KIND_CHANNEL);
+        }
+    }
+}
+
+/* --- NAMES / WHOX --- */
+
+/* entry dari NAMES, atau nick dengan flags dari WHOX (flags NULL untuk NAMES) */
+static void list_member(WINEIRC_members* m, const char* channel, const char* entry, const char* flags) {
+    uint32_t cid = index_find(m, KIND_CHANNEL, channel);
+    if (cid == NONE)
+        return;
+    struct channel *ch = &m->chans[cid];
+    if (!ch->listing) {
+        ch->listing = 1;
+        ch->gen++;
+    }
+    unsigned modes = 0;
+    char nick[NICK_MAX];
+    if (flags) {
+        /* Flag WHOX: H/G, '*' (IRCop), lalu simbol prefix */
+        for (const char *f = flags; *f; f++) {
+            int bit = prefix_bit(*f, m->prefix_chars);
+            if (bit >= 0)
+                modes |= 1u << bit;
+        }
+        snprintf(nick, sizeof(nick), "%s", entry);
+    } else {
+        /* multi-prefix: "@+nick", userhost-in-names: "nick!user@host" */
+        int bit;
+        while ((bit = prefix_bit(*entry, m->prefix_chars)) >= 0) {
+            modes |= 1u << bit;
+            entry++;
+        }
+        size_t n = strcspn(entry, "!");
+        if (n == 0 || n >= sizeof(nick))
+            return;
+        memcpy(nick, entry, n);
+        nick[n] = '\0';
+    }
+    uint32_t nid = nick_intern(m, nick);
+    if (nid != NONE)
+        member_add(m, cid, nid, modes);
+}
+
+static void end_of_list(WINEIRC_members* m, const char* channel) {
+    uint32_t cid = index_find(m, KIND_CHANNEL, channel);
+    if (cid == NONE || !m->chans[cid].listing)
+        return;
+    struct channel *ch = &m->chans[cid];
+    /* Anggota yang tidak muncul di daftar terbaru sudah keluar */
+    for (uint32_t i = 0; i <= ch->mask; i++) {
+        while (ch->slots[i].nick && ch->slots[i].gen != ch->gen) {
+            uint32_t nid = ch->slots[i].nick - 1;
+            member_delete_slot(ch, &ch->slots[i]);
+            nick_remove_chan(&m->nicks[nid], cid);
+            nick_release_if_unused(m, nid);
+        }
+    }
+    ch->listing = 0;
+    ch->synced = 1;
+    notify(m, WINEIRC_MEMBER_SYNCED, ch->name, NULL, NULL);
+}
+
+static void handle_names(WINEIRC_members* m, const WINEIRC_message* msg) {
+    /* 353 <me> <=|*|@> <channel> :<names>, beberapa server tanpa tipe */
+    if (msg->param_count < 3)
+        return;
+    const char *channel = msg->params[msg->param_count - 2];
+    char names[LINE_MAX_LEN];
+    snprintf(names, sizeof(names), "%s", msg->params[msg->param_count - 1]);
+    for (char *save = NULL, *entry = strtok_r(names, " ", &save); entry; entry = strtok_r(NULL, " ", &save))
+        list_member(m, channel, entry, NULL);
+}
+
+static void handle_whox(WINEIRC_members* m, const WINEIRC_message* msg) {
+    /* 354 <me> <token> <channel> <nick> <flags> */
+    if (msg->param_count < 5 || strcmp(msg->params[1], WINEIRC_MEMBERS_WHOX_TOKEN) != 0)
+        return;
+    if (strlen(msg->params[3]) >= NICK_MAX)
+        return;
+    list_member(m, msg->params[2], msg->params[3], msg->params[4]);
+}
+
+/* --- API --- */
+
+WINEIRC_members* WINEIRC_members_create(const char* self_nick, const WINEIRC_members_callbacks* callbacks,
+                                        void* user_data) {
+    WINEIRC_members *m = calloc(1, sizeof(WINEIRC_members));
+    if (!m)
+        return NULL;
+    if (callbacks)
+        m->cb = *callbacks;
+    m->user_data = user_data;
+    m->self = self_nick ? strdup(self_nick) : NULL;
+    set_casemapping(m, "rfc1459");
+    strcpy(m->prefix_modes, "ov");
+    strcpy(m->prefix_chars, "@+");
+    m->nprefix = 2;
+    strcpy(m->chanmodes[0], "beI");
+    strcpy(m->chanmodes[1], "k");
+    strcpy(m->chanmodes[2], "l");
+    strcpy(m->chanmodes[3], "imnpst");
+    strcpy(m->chantypes, "#&");
+    return m;
+}
+
+void WINEIRC_members_feed(WINEIRC_members* m, const WINEIRC_message* msg) {
+    if (!m || !msg || !msg->command)
+        return;
+    const char *cmd = msg->command;
+    int quit = strcmp(cmd, "QUIT") == 0;
+    /* QUIT netsplit tanpa BATCH berakhir pada baris pertama yang bukan QUIT */
+    if (m->npending && !m->batch_ref[0] && !quit)
+        apply_pending(m);
+
+    if (quit)
+        handle_quit(m, msg);
+    else if (strcmp(cmd, "JOIN") == 0)
+        handle_join(m, msg);
+    else if (strcmp(cmd, "PART") == 0)
+        handle_part(m, msg);
+    else if (strcmp(cmd, "KICK") == 0)
+        handle_kick(m, msg);
+    else if (strcmp(cmd, "NICK") == 0)
+        handle_nick(m, msg);
+    else if (strcmp(cmd, "MODE") == 0)
+        handle_mode(m, msg);
+    else if (strcmp(cmd, "BATCH") == 0)
+        handle_batch(m, msg);
+    else if (strcmp(cmd, "353") == 0)
+        handle_names(m, msg);
+    else if (strcmp(cmd, "366") == 0 || strcmp(cmd, "315") == 0) {
+        if (msg->param_count >= 2)
+            end_of_list(m, msg->params[1]);
+    } else if (strcmp(cmd, "354") == 0)
+        handle_whox(m, msg);
+    else if (strcmp(cmd, "005") == 0)
+        handle_isupport(m, msg);
+    else if (strcmp(cmd, "001") == 0 && msg->param_count >= 1) {
+        char *s = strdup(msg->params[0]);
+        if (s) {
+            free(m->self);
+            m->self = s;
+        }
+    }
+}
+
+/* Perintah yang mengubah daftar anggota; selain ini tidak perlu diparse */
+static int relevant(const char* cmd, size_t len) {
+    static const char *const cmds[] = {
+        "JOIN", "PART", "QUIT", "KICK", "NICK", "MODE", "BATCH", "001", "005", "353", "366", "354", "315"
+    };
+    for (size_t i = 0; i < sizeof(cmds) / sizeof(cmds[0]); i++)
+        if (strlen(cmds[i]) == len && memcmp(cmds[i], cmd, len) == 0)
+            return 1;
+    return 0;
+}
+
+void WINEIRC_members_feed_line(WINEIRC_members* m, const char* line) {
+    if (!m || !line)
+        return;
+    const char *p = line;
+    if (*p == '@' && (p = strchr(p, ' ')) != NULL)
+        p++;
+    if (p && *p == ':' && (p = strchr(p, ' ')) != NULL)
+        p++;
+    if (!p)
+        return;
+    size_t len = strcspn(p, " ");
+    if (!relevant(p, len)) {
+        if (m->npending && !m->batch_ref[0])
+            apply_pending(m);
+        return;
+    }
+    size_t n = strlen(line);
+    if (n >= sizeof(m->line))
+        return;
+    memcpy(m->line, line, n + 1);
+    WINEIRC_message msg;
+    if (WINEIRC_parse_line(m->line, &msg) == 0)
+        WINEIRC_members_feed(m, &msg);
+}
+
+void WINEIRC_members_flush(WINEIRC_members* m) {
+    if (m && !m->batch_ref[0])
+        apply_pending(m);
+}
+
+void WINEIRC_members_reset(WINEIRC_members* m) {
+    if (!m)
+        return;
+    for (size_t i = 0; i < m->npending; i++) {
+        m->nicks[m->pending[i]].pending = 0;
+        nick_release_if_unused(m, m->pending[i]);
+    }
+    m->npending = 0;
+    m->batch_ref[0] = '\0';
+    for (uint32_t cid = 0; cid < m->nchans; cid++)
+        if (m->chans[cid].name)
+            chan_drop(m, cid);
+}
+
+int WINEIRC_members_whox_request(const char* channel, char* out, size_t out_len) {
+    int n = snprintf(out, out_len, "WHO %s %%tcnf,%s\r\n", channel, WINEIRC_MEMBERS_WHOX_TOKEN);
+    return n < 0 || (size_t)n >= out_len ? -1 : n;
+}
+
+int WINEIRC_members_get(const WINEIRC_members* m, const char* channel, const char* nick, unsigned* modes) {
+    if (!m || !channel || !nick)
+        return -1;
+    uint32_t cid = index_find(m, KIND_CHANNEL, channel);
+    uint32_t nid = cid == NONE ? NONE : index_find(m, KIND_NICK, nick);
+    const struct member *rec = nid == NONE ? NULL : member_find(&m->chans[cid], nid);
+    if (!rec)
+        return -1;
+    if (modes)
+        *modes = rec->modes;
+    return 0;
+}
+
+size_t WINEIRC_members_count(const WINEIRC_members* m, const char* channel) {
+    uint32_t cid = m && channel ? index_find(m, KIND_CHANNEL, channel) : NONE;
+    return cid == NONE ? 0 : m->chans[cid].count;
+}
+
+int WINEIRC_members_synced(const WINEIRC_members* m, const char* channel) {
+    uint32_t cid = m && channel ? index_find(m, KIND_CHANNEL, channel) : NONE;
+    return cid != NONE && m->chans[cid].synced;
+}
+
+int WINEIRC_members_nick_known(const WINEIRC_members* m, const char* nick) {
+    uint32_t nid = m && nick ? index_find(m, KIND_NICK, nick) : NONE;
+    return nid != NONE && m->nicks[nid].nchans > 0;
+}
+
+char WINEIRC_members_prefix(const WINEIRC_members* m, unsigned modes) {
+    for (int i = 0; m && i < m->nprefix; i++)
+        if (modes & (1u << i))
+            return m->prefix_chars[i];
+    return 0;
+}
+
+size_t WINEIRC_members_foreach(const WINEIRC_members* m, const char* channel,
+                               void (*cb)(const char* nick, unsigned modes, void* user_data), void* user_data) {
+    uint32_t cid = m && channel ? index_find(m, KIND_CHANNEL, channel) : NONE;
+    if (cid == NONE)
+        return 0;
+    const struct channel *ch = &m->chans[cid];
+    for (uint32_t i = 0; cb && ch->slots && i <= ch->mask; i++)
+        if (ch->slots[i].nick)
+            cb(m->nicks[ch->slots[i].nick - 1].name, ch->slots[i].modes, user_data);
+    return ch->count;
+}
+
+void WINEIRC_members_get_stats(const WINEIRC_members* m, WINEIRC_members_stats* out) {
+    memset(out, 0, sizeof(*out));
+    if (!m)
+        return;
+    out->bytes = sizeof(*m) + m->nicks_cap * (sizeof(struct nick) + sizeof(uint32_t)) +
+                 m->chans_cap * sizeof(struct channel) + m->pending_cap * sizeof(uint32_t);
+    if (m->nick_index.slots)
+        out->bytes += (m->nick_index.mask + 1) * sizeof(uint32_t);
+    if (m->chan_index.slots)
+        out->bytes += (m->chan_index.mask + 1) * sizeof(uint32_t);
+    for (uint32_t id = 0; id < m->nnicks; id++) {
+        if (!m->nicks[id].name)
+            continue;
+        out->nicks++;
+        out->bytes += strlen(m->nicks[id].name) + 1 + m->nicks[id].chans_cap * sizeof(uint32_t);
+    }
+    for (uint32_t cid = 0; cid < m->nchans; cid++) {
+        const struct channel *ch = &m->chans[cid];
+        if (!ch->name)
+            continue;
+        out->channels++;
+        out->memberships += ch->count;
+        out->bytes += strlen(ch->name) + 1 + (ch->slots ? (ch->mask + 1) * sizeof(struct member) : 0);
+    }
+    out->batched_quits = m->batched_quits;
+}
+
+void WINEIRC_members_free(WINEIRC_members* m) {
+    if (!m)
+        return;
+    for (uint32_t id = 0; id < m->nnicks; id++) {
+        free(m->nicks[id].name);
+        free(m->nicks[id].chans);
+    }
+    for (uint32_t cid = 0; cid < m->nchans; cid++) {
+        free(m->chans[cid].name);
+        free(m->chans[cid].slots);
+    }
+    free(m->nicks);
+    free(m->free_nicks);
+    free(m->chans);
+    free(m->nick_index.slots);
+    free(m->chan_index.slots);
+    free(m->pending);
+    free(m->self);
+    free(m);
+}
@@ -0,0 +1,158 @@
+#include "irc_parser.h"
+#include <stdio.h>
+#include <string.h>
+
+/* --- Fungsi Helper: unescape nilai tag IRCv3 secara in-place --- */
+static void unescape_tag_value(char* value) {
+    char *r = value, *w = value;
+    while (*r) {
+        if (*r == '\\') {
+            r++;
+            switch (*r) {
+            case ':':  *w++ = ';';  break;
+            case 's':  *w++ = ' ';  break;
+            case 'r':  *w++ = '\r'; break;
+            case 'n':  *w++ = '\n'; break;
+            case '\0': goto done;   /* Backslash di akhir dibuang */
+            default:   *w++ = *r;   break;
+            }
+            r++;
+        } else {
+            *w++ = *r++;
+        }
+    }
+done:
+    *w = '\0';
+}
+
+static char* skip_spaces(char* p) {
+    while (*p == ' ')
+        p++;
+    return p;
+}
+
+/* --- Parsing Baris IRC --- */
+int WINEIRC_parse_line(char* line, WINEIRC_message* msg) {
+    if (!line || !msg)
+        return -1;
+    memset(msg, 0, sizeof(*msg));
+    char *p = line;
+
+    /* Tag IRCv3: @key=value;key2;... */
+    if (*p == '@') {
+        char *end = strchr(p, ' ');
+        if (!end)
+            return -1;
+        *end = '\0';
+        char *tag = p + 1;
+        while (tag && *tag) {
+            char *next = strchr(tag, ';');
+            if (next)
+                *next++ = '\0';
+            if (msg->tag_count < WINEIRC_MAX_TAGS) {
+                char *eq = strchr(tag, '=');
+                WINEIRC_tag *t = &msg->tags[msg->tag_count++];
+                t->key = tag;
+                t->value = NULL;
+                if (eq) {
+                    *eq = '\0';
+                    unescape_tag_value(eq + 1);
+                    t->value = eq + 1;
+                }
+            }
+            tag = next;
+        }
+        p = skip_spaces(end + 1);
+    }
+
+    /* Prefix: :nick!user@host */
+    if (*p == ':') {
+        char *end = strchr(p, ' ');
+        if (!end)
+            return -1;
+        *end = '\0';
+        msg->prefix = p + 1;
+        p = skip_spaces(end + 1);
+    }
+
+    if (*p == '\0')
+        return -1;
+    msg->command = p;
+    p = strchr(p, ' ');
+
+    /* Parameter, dengan parameter trailing setelah " :" */
+    while (p) {
+        *p = '\0';
+        p = skip_spaces(p + 1);
+        if (*p == '\0')
+            break;
+        if (*p == ':' || msg->param_count == WINEIRC_MAX_PARAMS - 1) {
+            msg->params[msg->param_count++] = (*p == ':') ? p + 1 : p;
+            break;
+        }
+        msg->params[msg->param_count++] = p;
+        p = strchr(p, ' ');
+    }
+    return 0;
+}
+
+const char* WINEIRC_message_tag(const WINEIRC_message* msg, const char* key) {
+    if (!msg || !key)
+        return NULL;
+    for (int i = 0; i < msg->tag_count; i++) {
+        if (strcmp(msg->tags[i].key, key) == 0)
+            return msg->tags[i].value ? msg->tags[i].value : "";
+    }
+    return NULL;
+}
+
+int64_t WINEIRC_server_time(const char* value) {
+    int y, mo, d, h, mi, s, ms = 0;
+    if (!value || sscanf(value, "%d-%d-%dT%d:%d:%d.%dZ", &y, &mo, &d, &h, &mi, &s, &ms) < 6 || mo < 1 || mo > 12)
+        return 0;
+    /* Hari sejak epoch dari tanggal sipil (tanpa timegm/TZ) */
+    y -= mo <= 2;
+    int64_t era = (y >= 0 ? y : y - 399) / 400;
+    int64_t yoe = y - era * 400;
+    int64_t doy = (153 * (mo + (mo > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    int64_t days = era * 146097 + yoe * 365 + yoe / 4 - yoe / 100 + doy - 719468;
+    return ((days * 24 + h) * 60 + mi) * 60000 + (int64_t)s * 1000 + ms;
+}
+
+int WINEIRC_prefix_nick(const char* prefix, char* out, size_t out_len) {
+    if (!prefix || !out || out_len == 0)
+        return -1;
+    size_t len = strcspn(prefix, "!@");
+    if (len >= out_len)
+        return -1;
+    memcpy(out, prefix, len);
+    out[len] = '\0';
+    return 0;
+}
+
+int WINEIRC_escape_tag_value(const char* value, char* out, size_t out_len) {
+    size_t w = 0;
+    for (const char *r = value; *r; r++) {
+        const char *esc = NULL;
+        switch (*r) {
+        case ';':  esc = "\\:";  break;
+        case ' ':  esc = "\\s";  break;
+        case '\\': esc = "\\\\"; break;
+        case '\r': esc = "\\r";  break;
+        case '\n': esc = "\\n";  break;
+        }
+        size_t need = esc ? 2 : 1;
+        if (w + need >= out_len)
+            return -1;
+        if (esc) {
+            out[w++] = esc[0];
+            out[w++] = esc[1];
+        } else {
+            out[w++] = *r;
+        }
+    }
+    if (w >= out_len)
+        return -1;
+    out[w] = '\0';
+    return (int)w;
+}
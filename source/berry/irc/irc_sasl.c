@@ -0,0 +1,394 @@
+#include "irc_sasl.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <openssl/crypto.h>
+#include <openssl/evp.h>
+#include <openssl/hmac.h>
+#include <openssl/rand.h>
+#include <openssl/sha.h>
+
+#define KEY_LEN          SHA256_DIGEST_LENGTH
+#define CACHE_WAYS       4
+#define CACHE_DEFAULT    8192
+#define MAX_ITERATIONS   10000000
+#define MAX_SALT         256
+
+/* --- Cache kunci turunan (set-associative 4-way, LRU per set) --- */
+struct cache_entry {
+    unsigned char id[KEY_LEN];          /* SHA-256(password, salt, iterasi) */
+    unsigned char client_key[KEY_LEN];
+    unsigned char server_key[KEY_LEN];
+    uint64_t stamp;                     /* 0 = kosong */
+};
+
+static struct {
+    pthread_mutex_t lock;
+    struct cache_entry *entries;
+    size_t sets;
+    size_t capacity;                    /* Kapasitas yang diminta; 0 = cache mati */
+    uint64_t clock;
+    unsigned long hits;
+    unsigned long misses;
+    unsigned long used;
+} cache = { PTHREAD_MUTEX_INITIALIZER, NULL, 0, CACHE_DEFAULT, 0, 0, 0, 0 };
+
+/* Harus dipanggil dengan lock dipegang */
+static int cache_ensure(void) {
+    if (cache.entries || cache.capacity == 0)
+        return cache.entries ? 0 : -1;
+    size_t sets = 1;
+    while (sets * CACHE_WAYS < cache.capacity)
+        sets *= 2;
+    cache.entries = calloc(sets * CACHE_WAYS, sizeof(struct cache_entry));
+    if (!cache.entries)
+        return -1;
+    cache.sets = sets;
+    return 0;
+}
+
+static void cache_wipe(void) {
+    if (cache.entries) {
+        OPENSSL_cleanse(cache.entries, cache.sets * CACHE_WAYS * sizeof(struct cache_entry));
+        free(cache.entries);
+    }
+    cache.entries = NULL;
+    cache.sets = 0;
+    cache.used = 0;
+}
+
+static int cache_lookup(const unsigned char* id, unsigned char* client_key, unsigned char* server_key) {
+    int found = 0;
+    pthread_mutex_lock(&cache.lock);
+    if (cache_ensure() != 0) {
+        pthread_mutex_unlock(&cache.lock);
+        return 0;
+    }
+    uint64_t h;
+    memcpy(&h, id, sizeof(h));
+    struct cache_entry *set = &cache.entries[(h & (cache.sets - 1)) * CACHE_WAYS];
+    for (int w = 0; w < CACHE_WAYS; w++) {
+        if (set[w].stamp && CRYPTO_memcmp(set[w].id, id, KEY_LEN) == 0) {
+            memcpy(client_key, set[w].client_key, KEY_LEN);
+            memcpy(server_key, set[w].server_key, KEY_LEN);
+            set[w].stamp = ++cache.clock;
+            found = 1;
+            break;
+        }
+    }
+    if (found)
+        cache.hits++;
+    else
+        cache.misses++;
+    pthread_mutex_unlock(&cache.lock);
+    return found;
+}
+
+static void cache_store(const unsigned char* id, const unsigned char* client_key, const unsigned char* server_key) {
+    pthread_mutex_lock(&cache.lock);
+    if (cache_ensure() == 0) {
+        uint64_t h;
+        memcpy(&h, id, sizeof(h));
+        struct cache_entry *set = &cache.entries[(h & (cache.sets - 1)) * CACHE_WAYS];
+        struct cache_entry *victim = &set[0];
+        for (int w = 0; w < CACHE_WAYS; w++) {
+            if (!set[w].stamp || CRYPTO_memcmp(set[w].id, id, KEY_LEN) == 0) {
+                victim = &set[w];
+                break;
+            }
+            if (set[w].stamp < victim->stamp)
+                victim = &set[w];
+        }
+        if (!victim->stamp)
+            cache.used++;
+        memcpy(victim->id, id, KEY_LEN);
+        memcpy(victim->client_key, client_key, KEY_LEN);
+        memcpy(victim->server_key, server_key, KEY_LEN);
+        victim->stamp = ++cache.clock;
+    }
+    pthread_mutex_unlock(&cache.lock);
+}
+
+void WINEIRC_scram_cache_configure(size_t entries) {
+    pthread_mutex_lock(&cache.lock);
+    cache_wipe();
+    cache.capacity = entries;
+    cache.hits = cache.misses = 0;
+    pthread_mutex_unlock(&cache.lock);
+}
+
+void WINEIRC_scram_cache_clear(void) {
+    pthread_mutex_lock(&cache.lock);
+    cache_wipe();
+    cache.hits = cache.misses = 0;
+    pthread_mutex_unlock(&cache.lock);
+}
+
+void WINEIRC_scram_cache_get_stats(WINEIRC_scram_cache_stats* out) {
+    if (!out)
+        return;
+    pthread_mutex_lock(&cache.lock);
+    out->hits = cache.hits;
+    out->misses = cache.misses;
+    out->entries = cache.used;
+    out->capacity = cache.sets ? cache.sets * CACHE_WAYS : cache.capacity;
+    pthread_mutex_unlock(&cache.lock);
+}
+
+/* --- SCRAM --- */
+struct _WINEIRC_scram {
+    char *username;                     /* saslname yang sudah di-escape */
+    char *password;
+    char nonce[48];
+    char *client_first_bare;
+    char *auth_message;
+    unsigned char server_key[KEY_LEN];
+    int stage;                          /* 0 awal, 1 client-first, 2 client-final, 3 terverifikasi */
+};
+
+const char* WINEIRC_sasl_mechanism_name(WINEIRC_sasl_mechanism mechanism) {
+    switch (mechanism) {
+    case WINEIRC_SASL_PLAIN:         return "PLAIN";
+    case WINEIRC_SASL_EXTERNAL:      return "EXTERNAL";
+    case WINEIRC_SASL_SCRAM_SHA_256: return "SCRAM-SHA-256";
+    default:                         return NULL;
+    }
+}
+
+int WINEIRC_base64_encode(const unsigned char* in, size_t len, char* out, size_t out_len) {
+    if (!out || (len + 2) / 3 * 4 + 1 > out_len)
+        return -1;
+    return EVP_EncodeBlock((unsigned char*)out, in, (int)len);
+}
+
+int WINEIRC_base64_decode(const char* in, size_t len, unsigned char* out, size_t out_len) {
+    if (!in || !out || len % 4 != 0 || len / 4 * 3 > out_len)
+        return -1;
+    int n = EVP_DecodeBlock(out, (const unsigned char*)in, (int)len);
+    if (n < 0)
+        return -1;
+    /* EVP_DecodeBlock menghitung byte padding sebagai 0 */
+    if (len >= 1 && in[len - 1] == '=')
+        n--;
+    if (len >= 2 && in[len - 2] == '=')
+        n--;
+    return n;
+}
+
+int WINEIRC_sasl_plain(const char* account, const char* password, char* out, size_t out_len) {
+    if (!account || !password)
+        return -1;
+    size_t alen = strlen(account), plen = strlen(password), len = alen + plen + 2;
+    unsigned char *raw = malloc(len);
+    if (!raw)
+        return -1;
+    raw[0] = '\0';
+    memcpy(raw + 1, account, alen);
+    raw[alen + 1] = '\0';
+    memcpy(raw + alen + 2, password, plen);
+    int n = WINEIRC_base64_encode(raw, len, out, out_len);
+    OPENSSL_cleanse(raw, len);
+    free(raw);
+    return n;
+}
+
+/* saslname: '=' -> "=3D", ',' -> "=2C" (RFC 5802 5.1) */
+static char* escape_saslname(const char* s) {
+    char *out = malloc(strlen(s) * 3 + 1), *w = out;
+    if (!out)
+        return NULL;
+    for (; *s; s++) {
+        if (*s == '=') {
+            memcpy(w, "=3D", 3);
+            w += 3;
+        } else if (*s == ',') {
+            memcpy(w, "=2C", 3);
+            w += 3;
+        } else {
+            *w++ = *s;
+        }
+    }
+    *w = '\0';
+    return out;
+}
+
+WINEIRC_scram* WINEIRC_scram_create(const char* account, const char* password, const char* nonce) {
+    if (!account || !password)
+        return NULL;
+    WINEIRC_scram *scram = calloc(1, sizeof(WINEIRC_scram));
+    if (!scram)
+        return NULL;
+    scram->username = escape_saslname(account);
+    scram->password = strdup(password);
+    if (!scram->username || !scram->password) {
+        WINEIRC_scram_free(scram);
+        return NULL;
+    }
+    if (nonce) {
+        snprintf(scram->nonce, sizeof(scram->nonce), "%s", nonce);
+    } else {
+        unsigned char raw[24];
+        if (RAND_bytes(raw, sizeof(raw)) != 1) {
+            WINEIRC_scram_free(scram);
+            return NULL;
+        }
+        /* Base64 tidak mengandung ',' sehingga aman sebagai nilai atribut */
+        EVP_EncodeBlock((unsigned char*)scram->nonce, raw, sizeof(raw));
+    }
+    return scram;
+}
+
+int WINEIRC_scram_client_first(WINEIRC_scram* scram, char* out, size_t out_len) {
+    if (!scram || !out || scram->stage != 0)
+        return -1;
+    size_t bare_len = strlen(scram->username) + strlen(scram->nonce) + 6;
+    scram->client_first_bare = malloc(bare_len + 1);
+    if (!scram->client_first_bare)
+        return -1;
+    snprintf(scram->client_first_bare, bare_len + 1, "n=%s,r=%s", scram->username, scram->nonce);
+    int n = snprintf(out, out_len, "n,,%s", scram->client_first_bare);
+    if (n < 0 || (size_t)n >= out_len)
+        return -1;
+    scram->stage = 1;
+    return n;
+}
+
+static void hmac(const unsigned char* key, const void* data, size_t len, unsigned char* out) {
+    unsigned int out_len = KEY_LEN;
+    HMAC(EVP_sha256(), key, KEY_LEN, data, len, out, &out_len);
+}
+
+/* ClientKey/ServerKey dari cache, atau PBKDF2 lalu disimpan */
+static int derive_keys(const char* password, const unsigned char* salt, size_t salt_len, unsigned iterations,
+                       unsigned char* client_key, unsigned char* server_key) {
+    unsigned char id[KEY_LEN], iter_be[4] = {
+        (unsigned char)(iterations >> 24), (unsigned char)(iterations >> 16),
+        (unsigned char)(iterations >> 8), (unsigned char)iterations
+    };
+    EVP_MD_CTX *ctx = EVP_MD_CTX_new();
+    if (!ctx)
+        return -1;
+    int ok = EVP_DigestInit_ex(ctx, EVP_sha256(), NULL) &&
+             EVP_DigestUpdate(ctx, password, strlen(password) + 1) &&
+             EVP_DigestUpdate(ctx, salt, salt_len) &&
+             EVP_DigestUpdate(ctx, iter_be, sizeof(iter_be)) &&
+             EVP_DigestFinal_ex(ctx, id, NULL);
+    EVP_MD_CTX_free(ctx);
+    if (!ok)
+        return -1;
+    if (cache_lookup(id, client_key, server_key))
+        return 0;
+
+    unsigned char salted[KEY_LEN];
+    if (PKCS5_PBKDF2_HMAC(password, (int)strlen(password), salt, (int)salt_len, (int)iterations,
+                          EVP_sha256(), KEY_LEN, salted) != 1)
+        return -1;
+    hmac(salted, "Client Key", 10, client_key);
+    hmac(salted, "Server Key", 10, server_key);
+    OPENSSL_cleanse(salted, sizeof(salted));
+    cache_store(id, client_key, server_key);
+    OPENSSL_cleanse(id, sizeof(id));
+    return 0;
+}
+
+int WINEIRC_scram_client_final(WINEIRC_scram* scram, const char* server_first, char* out, size_t out_len) {
+    if (!scram || !server_first || !out || scram->stage != 1)
+        return -1;
+
+    /* server-first-message: r=<nonce>,s=<salt>,i=<iterasi>[,ekstensi] */
+    const char *nonce = NULL, *salt = NULL, *iter = NULL;
+    size_t nonce_len = 0, salt_len = 0;
+    for (const char *p = server_first; *p; ) {
+        const char *end = strchr(p, ',');
+        size_t len = end ? (size_t)(end - p) : strlen(p);
+        if (len >= 2 && p[1] == '=') {
+            if (p[0] == 'r') { nonce = p + 2; nonce_len = len - 2; }
+            else if (p[0] == 's') { salt = p + 2; salt_len = len - 2; }
+            else if (p[0] == 'i') { iter = p + 2; }
+            else if (p[0] == 'm') return -1;    /* Ekstensi wajib tidak didukung */
+        }
+        p += len + (end ? 1 : 0);
+    }
+    size_t cnonce_len = strlen(scram->nonce);
+    if (!nonce || !salt || !iter || nonce_len <= cnonce_len || strncmp(nonce, scram->nonce, cnonce_len) != 0) {
+        fprintf(stderr, "Error: server-first SCRAM tidak valid\n");
+        return -1;
+    }
+    char *end;
+    unsigned long iterations = strtoul(iter, &end, 10);
+    if (iterations == 0 || iterations > MAX_ITERATIONS || (*end && *end != ',')) {
+        fprintf(stderr, "Error: jumlah iterasi SCRAM tidak valid\n");
+        return -1;
+    }
+    unsigned char salt_raw[MAX_SALT];
+    int salt_raw_len = WINEIRC_base64_decode(salt, salt_len, salt_raw, sizeof(salt_raw));
+    if (salt_raw_len <= 0)
+        return -1;
+
+    unsigned char client_key[KEY_LEN], stored_key[KEY_LEN], signature[KEY_LEN], proof[KEY_LEN];
+    if (derive_keys(scram->password, salt_raw, (size_t)salt_raw_len, (unsigned)iterations,
+                    client_key, scram->server_key) != 0)
+        return -1;
+    SHA256(client_key, KEY_LEN, stored_key);
+
+    /* AuthMessage = client-first-bare "," server-first "," client-final-without-proof */
+    size_t am_len = strlen(scram->client_first_bare) + strlen(server_first) + nonce_len + 12;
+    free(scram->auth_message);
+    scram->auth_message = malloc(am_len);
+    if (!scram->auth_message)
+        return -1;
+    snprintf(scram->auth_message, am_len, "%s,%s,c=biws,r=%.*s",
+             scram->client_first_bare, server_first, (int)nonce_len, nonce);
+    hmac(stored_key, scram->auth_message, strlen(scram->auth_message), signature);
+    for (int i = 0; i < KEY_LEN; i++)
+        proof[i] = client_key[i] ^ signature[i];
+
+    char proof_b64[64];
+    WINEIRC_base64_encode(proof, KEY_LEN, proof_b64, sizeof(proof_b64));
+    OPENSSL_cleanse(client_key, sizeof(client_key));
+    OPENSSL_cleanse(stored_key, sizeof(stored_key));
+    int n = snprintf(out, out_len, "c=biws,r=%.*s,p=%s", (int)nonce_len, nonce, proof_b64);
+    if (n < 0 || (size_t)n >= out_len)
+        return -1;
+    scram->stage = 2;
+    return n;
+}
+
+int WINEIRC_scram_verify_server(WINEIRC_scram* scram, const char* server_final) {
+    if (!scram || !server_final || scram->stage != 2)
+        return -1;
+    if (strncmp(server_final, "e=", 2) == 0) {
+        fprintf(stderr, "Error: server menolak SCRAM: %s\n", server_final + 2);
+        return -1;
+    }
+    if (strncmp(server_final, "v=", 2) != 0)
+        return -1;
+    const char *v = server_final + 2;
+    size_t len = strcspn(v, ",");
+    unsigned char got[KEY_LEN + 4], expected[KEY_LEN];
+    if (WINEIRC_base64_decode(v, len, got, sizeof(got)) != KEY_LEN)
+        return -1;
+    hmac(scram->server_key, scram->auth_message, strlen(scram->auth_message), expected);
+    if (CRYPTO_memcmp(got, expected, KEY_LEN) != 0) {
+        fprintf(stderr, "Error: tanda tangan server SCRAM tidak cocok\n");
+        return -1;
+    }
+    scram->stage = 3;
+    return 0;
+}
+
+void WINEIRC_scram_free(WINEIRC_scram* scram) {
+    if (!scram)
+        return;
+    if (scram->password) {
+        OPENSSL_cleanse(scram->password, strlen(scram->password));
+        free(scram->password);
+    }
+    free(scram->username);
+    free(scram->client_first_bare);
+    free(scram->auth_message);
+    OPENSSL_cleanse(scram->server_key, sizeof(scram->server_key));
+    free(scram);
+}
@@ -0,0 +1,386 @@
+#include "irc_tls.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <openssl/err.h>
+#include <openssl/ssl.h>
+#include <openssl/x509v3.h>
+
+struct _WINEIRC_tls {
+    int fd;
+    SSL *ssl;
+    char *cache_key;        /* "host:port|cert_file|verifikasi" */
+    int resumed;
+    int ktls_tx;
+    int ktls_rx;
+};
+
+/* --- Context dan cache sesi global ---
+     Satu SSL_CTX untuk semua koneksi. Sesi disimpan per host:port,
+     sertifikat klien (agar identitas EXTERNAL tidak tertukar) dan cara
+     verifikasi (insecure atau ca_file): resumption melewati pemeriksaan
+     sertifikat, jadi sesi dari handshake yang tidak diverifikasi atau
+     diverifikasi dengan CA lain tidak boleh dipakai handle yang lebih
+     ketat. Server biasanya menerima ticket yang sama berulang kali. */
+struct session_entry {
+    char *key;
+    SSL_SESSION *session;
+};
+
+static pthread_mutex_t tls_lock = PTHREAD_MUTEX_INITIALIZER;
+static SSL_CTX *ctx;
+static struct session_entry *sessions;
+static size_t session_count;
+static WINEIRC_tls_stats tls_stats;
+
+/* Store CA per ca_file; memuat bundle CA sistem mahal sehingga dibuat sekali */
+struct store_entry {
+    char *ca_file;
+    X509_STORE *store;
+};
+static struct store_entry *stores;
+static size_t store_count;
+
+static int on_new_session(SSL* ssl, SSL_SESSION* session) {
+    WINEIRC_tls *tls = SSL_get_app_data(ssl);
+    if (!tls || !SSL_SESSION_is_resumable(session))
+        return 0;
+    /* Hanya sesi yang lolos verifikasi yang disimpan untuk handle terverifikasi */
+    if (SSL_get_verify_mode(ssl) != SSL_VERIFY_NONE && SSL_get_verify_result(ssl) != X509_V_OK)
+        return 0;
+    pthread_mutex_lock(&tls_lock);
+    for (size_t i = 0; i < session_count; i++) {
+        if (strcmp(sessions[i].key, tls->cache_key) == 0) {
+            SSL_SESSION_free(sessions[i].session);
+            sessions[i].session = session;
+            pthread_mutex_unlock(&tls_lock);
+            return 1;
+        }
+    }
+    struct session_entry *grown = realloc(sessions, (session_count + 1) * sizeof(*sessions));
+    char *key = strdup(tls->cache_key);
+    if (!grown || !key) {
+        if (grown)
+            sessions = grown;
+        free(key);
+        pthread_mutex_unlock(&tls_lock);
+        return 0;
+    }
+    sessions = grown;
+    sessions[session_count].key = key;
+    sessions[session_count].session = session;
+    session_count++;
+    pthread_mutex_unlock(&tls_lock);
+    return 1;   /* Referensi sesi sekarang milik cache */
+}
+
+static SSL_SESSION* lookup_session(const char* key) {
+    SSL_SESSION *session = NULL;
+    pthread_mutex_lock(&tls_lock);
+    for (size_t i = 0; i < session_count; i++) {
+        if (strcmp(sessions[i].key, key) == 0) {
+            session = sessions[i].session;
+            SSL_SESSION_up_ref(session);
+            break;
+        }
+    }
+    pthread_mutex_unlock(&tls_lock);
+    return session;
+}
+
+/* Harus dipanggil dengan tls_lock dipegang */
+static void ctx_init(void) {
+    ctx = SSL_CTX_new(TLS_client_method());
+    if (!ctx)
+        return;
+    SSL_CTX_set_min_proto_version(ctx, TLS1_2_VERSION);
+    SSL_CTX_set_default_verify_paths(ctx);
+    /* Banyak server IRC menutup koneksi tanpa close_notify */
+    SSL_CTX_set_options(ctx, SSL_OP_IGNORE_UNEXPECTED_EOF);
+#ifdef SSL_OP_ENABLE_KTLS
+    SSL_CTX_set_options(ctx, SSL_OP_ENABLE_KTLS);
+#endif
+    SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+    SSL_CTX_sess_set_new_cb(ctx, on_new_session);
+}
+
+/* Mengembalikan store dengan referensi baru, atau NULL jika gagal dimuat */
+static X509_STORE* get_store(const char* ca_file) {
+    X509_STORE *store = NULL;
+    pthread_mutex_lock(&tls_lock);
+    for (size_t i = 0; i < store_count; i++) {
+        if (strcmp(stores[i].ca_file, ca_file) == 0) {
+            store = stores[i].store;
+            X509_STORE_up_ref(store);
+            pthread_mutex_unlock(&tls_lock);
+            return store;
+        }
+    }
+    store = X509_STORE_new();
+    struct store_entry *grown = realloc(stores, (store_count + 1) * sizeof(*stores));
+    char *name = strdup(ca_file);
+    if (grown)
+        stores = grown;
+    if (!store || !grown || !name || X509_STORE_set_default_paths(store) != 1 ||
+        X509_STORE_load_file(store, ca_file) != 1) {
+        X509_STORE_free(store);
+        free(name);
+        pthread_mutex_unlock(&tls_lock);
+        return NULL;
+    }
+    stores[store_count].ca_file = name;
+    stores[store_count].store = store;
+    store_count++;
+    X509_STORE_up_ref(store);
+    pthread_mutex_unlock(&tls_lock);
+    return store;
+}
+
+static void print_ssl_error(const char* what) {
+    unsigned long err = ERR_get_error();
+    char msg[256];
+    if (err) {
+        ERR_error_string_n(err, msg, sizeof(msg));
+        fprintf(stderr, "Error: %s: %s\n", what, msg);
+    } else {
+        fprintf(stderr, "Error: %s\n", what);
+    }
+    ERR_clear_error();
+}
+
+/* --- Handshake --- */
+WINEIRC_tls* WINEIRC_tls_connect(int fd, const char* server, int port, const WINEIRC_tls_options* options) {
+    WINEIRC_tls_options defaults = { 0 };
+    if (!options)
+        options = &defaults;
+    if (fd < 0 || !server)
+        return NULL;
+    pthread_mutex_lock(&tls_lock);
+    if (!ctx)
+        ctx_init();
+    SSL_CTX *shared = ctx;
+    if (shared)
+        SSL_CTX_up_ref(shared);
+    pthread_mutex_unlock(&tls_lock);
+    if (!shared)
+        return NULL;
+
+    WINEIRC_tls *tls = calloc(1, sizeof(WINEIRC_tls));
+    if (!tls) {
+        SSL_CTX_free(shared);
+        return NULL;
+    }
+    tls->fd = fd;
+    const char *verify = options->insecure ? "insecure" : options->ca_file ? options->ca_file : "";
+    size_t key_len = strlen(server) + (options->cert_file ? strlen(options->cert_file) : 0) + strlen(verify) + 24;
+    tls->cache_key = malloc(key_len);
+    tls->ssl = SSL_new(shared);
+    SSL_CTX_free(shared);   /* SSL memegang referensinya sendiri */
+    if (!tls->cache_key || !tls->ssl)
+        goto fail;
+    /* Mode verifikasi ikut di kunci: "insecure", "ca:<ca_file>" atau "ca:" (CA sistem) */
+    snprintf(tls->cache_key, key_len, "%s:%d|%s|%s%s", server, port, options->cert_file ? options->cert_file : "",
+             options->insecure ? "" : "ca:", verify);
+    SSL_set_fd(tls->ssl, fd);
+    SSL_set_app_data(tls->ssl, tls);
+
+    /* SNI hanya untuk nama host; alamat IP dicocokkan dengan SAN IP */
+    unsigned char addr[16];
+    int is_ip = inet_pton(AF_INET, server, addr) == 1 || inet_pton(AF_INET6, server, addr) == 1;
+    if (!is_ip)
+        SSL_set_tlsext_host_name(tls->ssl, server);
+    if (options->insecure) {
+        SSL_set_verify(tls->ssl, SSL_VERIFY_NONE, NULL);
+    } else {
+        SSL_set_verify(tls->ssl, SSL_VERIFY_PEER, NULL);
+        if (is_ip)
+            X509_VERIFY_PARAM_set1_ip_asc(SSL_get0_param(tls->ssl), server);
+        else
+            SSL_set1_host(tls->ssl, server);
+        if (options->ca_file) {
+            X509_STORE *store = get_store(options->ca_file);
+            if (!store) {
+                print_ssl_error("gagal memuat CA TLS");
+                goto fail;
+            }
+            SSL_set1_verify_cert_store(tls->ssl, store);
+            X509_STORE_free(store);
+        }
+    }
+    if (options->cert_file) {
+        const char *key_file = options->key_file ? options->key_file : options->cert_file;
+        if (SSL_use_certificate_chain_file(tls->ssl, options->cert_file) != 1 ||
+            SSL_use_PrivateKey_file(tls->ssl, key_file, SSL_FILETYPE_PEM) != 1) {
+            print_ssl_error("gagal memuat sertifikat klien");
+            goto fail;
+        }
+    }
+#ifdef SSL_OP_ENABLE_KTLS
+    if (options->no_ktls)
+        SSL_clear_options(tls->ssl, SSL_OP_ENABLE_KTLS);
+#endif
+
+    SSL_SESSION *session = lookup_session(tls->cache_key);
+    if (session) {
+        SSL_set_session(tls->ssl, session);
+        SSL_SESSION_free(session);
+    }
+    if (SSL_connect(tls->ssl) != 1) {
+        print_ssl_error("handshake TLS gagal");
+        goto fail;
+    }
+    tls->resumed = SSL_session_reused(tls->ssl);
+    tls->ktls_tx = BIO_get_ktls_send(SSL_get_wbio(tls->ssl));
+    tls->ktls_rx = BIO_get_ktls_recv(SSL_get_rbio(tls->ssl));
+
+    pthread_mutex_lock(&tls_lock);
+    tls_stats.handshakes++;
+    tls_stats.resumed += tls->resumed;
+    tls_stats.ktls_tx += tls->ktls_tx;
+    tls_stats.ktls_rx += tls->ktls_rx;
+    pthread_mutex_unlock(&tls_lock);
+    return tls;
+
+fail:
+    SSL_free(tls->ssl);
+    free(tls->cache_key);
+    free(tls);
+    return NULL;
+}
+
+/* --- I/O --- */
+ssize_t WINEIRC_tls_send(WINEIRC_tls* tls, const void* buf, size_t len) {
+    if (!tls)
+        return -1;
+    const char *p = buf;
+    size_t off = 0;
+    while (off < len) {
+        if (tls->ktls_tx) {
+            /* Kernel yang membungkus data menjadi record TLS */
+            ssize_t n = send(tls->fd, p + off, len - off, MSG_NOSIGNAL);
+            if (n < 0) {
+                if (errno == EINTR)
+                    continue;
+                perror("Error mengirim (kTLS)");
+                return -1;
+            }
+            off += (size_t)n;
+        } else {
+            size_t written;
+            if (SSL_write_ex(tls->ssl, p + off, len - off, &written) != 1) {
+                print_ssl_error("gagal mengirim data TLS");
+                return -1;
+            }
+            off += written;
+        }
+    }
+    return (ssize_t)len;
+}
+
+ssize_t WINEIRC_tls_recv(WINEIRC_tls* tls, void* buf, size_t len, int flags) {
+    if (!tls)
+        return -1;
+    int restore = -1;
+    if ((flags & MSG_DONTWAIT) && SSL_pending(tls->ssl) == 0) {
+        int fl = fcntl(tls->fd, F_GETFL);
+        if (fl >= 0 && !(fl & O_NONBLOCK) && fcntl(tls->fd, F_SETFL, fl | O_NONBLOCK) == 0)
+            restore = fl;
+    }
+    size_t got = 0;
+    int ok = (flags & MSG_PEEK) ? SSL_peek_ex(tls->ssl, buf, len, &got)
+                                : SSL_read_ex(tls->ssl, buf, len, &got);
+    int err = ok == 1 ? SSL_ERROR_NONE : SSL_get_error(tls->ssl, ok);
+    if (restore >= 0)
+        fcntl(tls->fd, F_SETFL, restore);
+
+    switch (err) {
+    case SSL_ERROR_NONE:
+        return (ssize_t)got;
+    case SSL_ERROR_ZERO_RETURN:
+        return 0;
+    case SSL_ERROR_WANT_READ:
+    case SSL_ERROR_WANT_WRITE:
+        errno = EAGAIN;
+        return -1;
+    default:
+        print_ssl_error("gagal membaca data TLS");
+        return -1;
+    }
+}
+
+size_t WINEIRC_tls_pending(const WINEIRC_tls* tls) {
+    return tls ? (size_t)SSL_pending(tls->ssl) : 0;
+}
+
+int WINEIRC_tls_resumed(const WINEIRC_tls* tls) {
+    return tls ? tls->resumed : 0;
+}
+
+int WINEIRC_tls_ktls_tx(const WINEIRC_tls* tls) {
+    return tls ? tls->ktls_tx : 0;
+}
+
+int WINEIRC_tls_ktls_rx(const WINEIRC_tls* tls) {
+    return tls ? tls->ktls_rx : 0;
+}
+
+void WINEIRC_tls_close(WINEIRC_tls* tls) {
+    if (!tls)
+        return;
+    SSL_shutdown(tls->ssl);
+    ERR_clear_error();
+    SSL_free(tls->ssl);
+    free(tls->cache_key);
+    free(tls);
+}
+
+void WINEIRC_tls_abandon(WINEIRC_tls* tls) {
+    if (!tls)
+        return;
+    /* Quiet shutdown: SSL_shutdown di WINEIRC_tls_close tidak menulis apa pun */
+    SSL_set_quiet_shutdown(tls->ssl, 1);
+    WINEIRC_tls_close(tls);
+}
+
+/* --- Statistik dan cleanup --- */
+void WINEIRC_tls_get_stats(WINEIRC_tls_stats* out) {
+    if (!out)
+        return;
+    pthread_mutex_lock(&tls_lock);
+    *out = tls_stats;
+    out->cached_sessions = session_count;
+    pthread_mutex_unlock(&tls_lock);
+}
+
+void WINEIRC_tls_flush_sessions(void) {
+    pthread_mutex_lock(&tls_lock);
+    for (size_t i = 0; i < session_count; i++) {
+        SSL_SESSION_free(sessions[i].session);
+        free(sessions[i].key);
+    }
+    free(sessions);
+    sessions = NULL;
+    session_count = 0;
+    pthread_mutex_unlock(&tls_lock);
+}
+
+void WINEIRC_tls_cleanup(void) {
+    WINEIRC_tls_flush_sessions();
+    /* Koneksi yang masih terbuka memegang referensi context sendiri */
+    pthread_mutex_lock(&tls_lock);
+    for (size_t i = 0; i < store_count; i++) {
+        X509_STORE_free(stores[i].store);
+        free(stores[i].ca_file);
+    }
+    free(stores);
+    stores = NULL;
+    store_count = 0;
+    SSL_CTX_free(ctx);
+    ctx = NULL;
+    pthread_mutex_unlock(&tls_lock);
+}
@@ -1,22 +1,26 @@
 #include "matrix_driver.h"
+#include "matrix_internal.h"
+#include "log.h"
+#include "trace.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <curl/curl.h>
+#include <json-c/json.h>
 #include <time.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <openssl/rand.h>
 
 /* Format URL untuk berbagai operasi Matrix */
 #define LOGIN_URL_FORMAT "%s/_matrix/client/r0/login"
 #define JOIN_URL_FORMAT  "%s/_matrix/client/r0/join/%s?access_token=%s"
-#define SEND_URL_FORMAT  "%s/_matrix/client/r0/rooms/%s/send/m.room.message/%ld?access_token=%s"
+#define SEND_URL_FORMAT  "%s/_matrix/client/r0/rooms/%s/send/m.room.message/%s?access_token=%s"
 #define STATE_PIN_URL_FORMAT "%s/_matrix/client/r0/rooms/%s/state/m.room.pinned_events?access_token=%s"
-#define REDACT_URL_FORMAT "%s/_matrix/client/r0/rooms/%s/redact/%s/%ld?access_token=%s"
-
-/* Struktur untuk menampung respons dari libcurl */
-struct MemoryStruct {
-    char *memory;
-    size_t size;
-};
+#define REDACT_URL_FORMAT "%s/_matrix/client/r0/rooms/%s/redact/%s/%s?access_token=%s"
+#define SYNC_URL_FORMAT  "%s/_matrix/client/r0/sync?access_token=%s&timeout=%d"
+#define SLIDING_SYNC_URL_FORMAT "%s/_matrix/client/unstable/org.matrix.simplified_msc3575/sync?access_token=%s&timeout=%d"
 
 /**
  * @brief Callback untuk menulis data yang diterima oleh libcurl ke memori.
@@ -60,16 +64,107 @@ void WINEMATRIX_global_cleanup(void) {
 }
 
 /**
- * @brief Fungsi helper untuk melakukan HTTP request dengan libcurl.
+ * @brief Mencatat fase dan ukuran satu request curl ke metrik handle.
+ *
+ * Waktu CURLINFO_*_TIME_T bersifat kumulatif sejak awal request, sehingga
+ * durasi tiap fase adalah selisih dengan fase sebelumnya.
+ */
+static void record_http_metrics(WINEB2B_metrics *metrics, CURL *curl, CURLcode res, long status)
+{
+    if (!metrics)
+        return;
+    curl_off_t dns = 0, connect = 0, appconnect = 0, ttfb = 0, total = 0;
+    curl_off_t up = 0, down = 0;
+    long request_size = 0, header_size = 0;
+    curl_easy_getinfo(curl, CURLINFO_NAMELOOKUP_TIME_T, &dns);
+    curl_easy_getinfo(curl, CURLINFO_CONNECT_TIME_T, &connect);
+    curl_easy_getinfo(curl, CURLINFO_APPCONNECT_TIME_T, &appconnect);
+    curl_easy_getinfo(curl, CURLINFO_STARTTRANSFER_TIME_T, &ttfb);
+    curl_easy_getinfo(curl, CURLINFO_TOTAL_TIME_T, &total);
+    curl_easy_getinfo(curl, CURLINFO_SIZE_UPLOAD_T, &up);
+    curl_easy_getinfo(curl, CURLINFO_SIZE_DOWNLOAD_T, &down);
+    curl_easy_getinfo(curl, CURLINFO_REQUEST_SIZE, &request_size);
+    curl_easy_getinfo(curl, CURLINFO_HEADER_SIZE, &header_size);
+
+    WINEB2B_metrics_add(metrics, WINEB2B_METRIC_HTTP_REQUESTS, 1);
+    if (res != CURLE_OK || status >= 400)
+        WINEB2B_metrics_add(metrics, WINEB2B_METRIC_HTTP_ERRORS, 1);
+    WINEB2B_metrics_add(metrics, WINEB2B_METRIC_BYTES_OUT, (uint64_t)(up + request_size));
+    WINEB2B_metrics_add(metrics, WINEB2B_METRIC_BYTES_IN, (uint64_t)(down + header_size));
+    WINEB2B_metrics_record(metrics, WINEB2B_METRIC_HTTP_DNS, (uint64_t)dns);
+    if (connect >= dns)
+        WINEB2B_metrics_record(metrics, WINEB2B_METRIC_HTTP_CONNECT, (uint64_t)(connect - dns));
+    if (appconnect > connect)
+        WINEB2B_metrics_record(metrics, WINEB2B_METRIC_HTTP_TLS, (uint64_t)(appconnect - connect));
+    if (ttfb > 0)
+        WINEB2B_metrics_record(metrics, WINEB2B_METRIC_HTTP_TTFB, (uint64_t)ttfb);
+    WINEB2B_metrics_record(metrics, WINEB2B_METRIC_HTTP_TOTAL, (uint64_t)total);
+}
+
+/**
+ * @brief Mencatat fase request sebagai span trace dari timing curl.
  *
- * @param url URL tujuan request.
- * @param json_data Data JSON (jika ada) yang akan dikirim.
- * @param http_method Metode HTTP ("POST" atau "PUT").
- * @param chunk Pointer ke struktur MemoryStruct untuk menyimpan respons.
- * @return int 0 jika berhasil, -1 jika terjadi kesalahan.
+ * Detail span berisi method dan path tanpa query (access_token tidak
+ * ikut tersimpan). Fase: dns, connect, tls, wait (request terkirim sampai
+ * byte pertama respons, termasuk pemrosesan homeserver) dan body.
  */
-static int perform_http_request(const char *url, const char *json_data, const char *http_method, struct MemoryStruct *chunk)
+static void record_http_trace(uint64_t trace, CURL *curl, const char *method, const char *url, uint64_t start)
 {
+    curl_off_t dns = 0, connect = 0, appconnect = 0, pretransfer = 0, ttfb = 0, total = 0;
+    curl_easy_getinfo(curl, CURLINFO_NAMELOOKUP_TIME_T, &dns);
+    curl_easy_getinfo(curl, CURLINFO_CONNECT_TIME_T, &connect);
+    curl_easy_getinfo(curl, CURLINFO_APPCONNECT_TIME_T, &appconnect);
+    curl_easy_getinfo(curl, CURLINFO_PRETRANSFER_TIME_T, &pretransfer);
+    curl_easy_getinfo(curl, CURLINFO_STARTTRANSFER_TIME_T, &ttfb);
+    curl_easy_getinfo(curl, CURLINFO_TOTAL_TIME_T, &total);
+
+    char detail[WINEB2B_TRACE_DETAIL];
+    const char *path = strstr(url, "://");
+    path = path ? strchr(path + 3, '/') : NULL;
+    snprintf(detail, sizeof(detail), "%s %.*s", method, path ? (int)strcspn(path, "?") : 0, path ? path : "");
+
+    /* Timing curl dalam mikrodetik sejak awal transfer */
+    uint64_t end = start + (uint64_t)total * 1000;
+    WINEB2B_trace_span(trace, "matrix", "matrix.http", start, end, detail);
+    if (dns > 0)
+        WINEB2B_trace_span(trace, "http", "http.dns", start, start + (uint64_t)dns * 1000, NULL);
+    if (connect > dns)
+        WINEB2B_trace_span(trace, "http", "http.connect", start + (uint64_t)dns * 1000,
+                           start + (uint64_t)connect * 1000, NULL);
+    if (appconnect > connect)
+        WINEB2B_trace_span(trace, "http", "http.tls", start + (uint64_t)connect * 1000,
+                           start + (uint64_t)appconnect * 1000, NULL);
+    if (ttfb > pretransfer)
+        WINEB2B_trace_span(trace, "http", "http.wait", start + (uint64_t)pretransfer * 1000,
+                           start + (uint64_t)ttfb * 1000, NULL);
+    if (ttfb > 0 && total > ttfb)
+        WINEB2B_trace_span(trace, "http", "http.body", start + (uint64_t)ttfb * 1000, end, NULL);
+}
+
+/**
+ * @brief Mencatat hasil pengiriman pesan: gagal jika request gagal atau
+ *        homeserver menjawab dengan status >= 400 (misal 429).
+ */
+static void count_send(WINEMATRIX_handle *handle, int ret, const struct MemoryStruct *chunk)
+{
+    int ok = ret == 0 && chunk->status > 0 && chunk->status < 400;
+    WINEB2B_metrics_add(handle->metrics, ok ? WINEB2B_METRIC_SENDS_DONE : WINEB2B_METRIC_SENDS_FAILED, 1);
+}
+
+/* Metrik dan trace request yang dijalankan di luar perform_http_request (lihat matrix_internal.h) */
+void record_http_request(WINEB2B_metrics *metrics, CURL *curl, CURLcode res, long status, const char *method,
+                         const char *url, uint64_t trace_start)
+{
+    record_http_metrics(metrics, curl, res, status);
+    if (trace_start)
+        record_http_trace(WINEB2B_trace_current, curl, method, url, trace_start);
+}
+
+/* Fungsi helper untuk melakukan HTTP request (lihat matrix_internal.h) */
+int perform_http_request(WINEB2B_metrics *metrics, const char *url, const char *json_data, const char *http_method,
+                         struct MemoryStruct *chunk)
+{
+    chunk->status = 0;
     CURL *curl = curl_easy_init();
     if (!curl) {
         fprintf(stderr, "Gagal inisialisasi curl handle\n");
@@ -91,7 +186,13 @@ static int perform_http_request(const char *url, const char *json_data, const ch
     curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteMemoryCallback);
     curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void *)chunk);
     
+    uint64_t trace = WINEB2B_trace_current;
+    uint64_t start = trace ? WINEB2B_trace_now() : 0;
     CURLcode res = curl_easy_perform(curl);
+    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &chunk->status);
+    record_http_metrics(metrics, curl, res, chunk->status);
+    if (trace)
+        record_http_trace(trace, curl, http_method, url, start);
     curl_slist_free_all(headers);
     curl_easy_cleanup(curl);
     
@@ -102,17 +203,64 @@ static int perform_http_request(const char *url, const char *json_data, const ch
     return 0;
 }
 
+/* Panjang maksimum transaction ID: prefiks 16 hex + '.' + penghitung */
+#define TXN_ID_SIZE 40
+
+static char txn_prefix[17];
+static pthread_once_t txn_once = PTHREAD_ONCE_INIT;
+
+/* Prefiks acak per proses; tanpa RNG pakai pid dan waktu dalam ns */
+static void txn_prefix_fill(void)
+{
+    unsigned char raw[8];
+    if (RAND_bytes(raw, sizeof(raw)) != 1) {
+        struct timespec ts;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        uint64_t v = ((uint64_t)getpid() << 40) ^ ((uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec);
+        memcpy(raw, &v, sizeof(raw));
+    }
+    for (size_t i = 0; i < sizeof(raw); i++)
+        snprintf(txn_prefix + 2 * i, 3, "%02x", raw[i]);
+}
+
+/* Proses anak hasil fork mewarisi prefiks dan penghitung induk: buat prefiks baru */
+static void txn_prefix_init(void)
+{
+    txn_prefix_fill();
+    pthread_atfork(NULL, NULL, txn_prefix_fill);
+}
+
 /**
- * @brief Fungsi sederhana untuk mengekstrak access_token dari respons JSON.
+ * @brief Membuat transaction ID unik untuk endpoint send/redact.
  *
- * Parsing dilakukan secara sederhana dengan mencari key "access_token".
+ * Homeserver menganggap request dengan txnId yang sama sebagai retry dan
+ * mengembalikan event yang sama, sehingga ID tidak boleh berulang, juga
+ * terhadap ID yang dikirim proses sebelumnya sebelum restart.
  *
- * @param response Respons JSON dari login.
- * @return char* Token yang dialokasikan secara dinamis, atau NULL jika tidak ditemukan.
+ * @param out Buffer hasil, minimal TXN_ID_SIZE byte.
+ * @param size Ukuran buffer.
  */
-static char* parse_access_token(const char* response)
+static void next_txn_id(char* out, size_t size)
 {
-    const char *key = "\"access_token\":\"";
+    static uint64_t counter = 0;
+    pthread_once(&txn_once, txn_prefix_init);
+    snprintf(out, size, "%s.%llu", txn_prefix,
+             (unsigned long long)__atomic_add_fetch(&counter, 1, __ATOMIC_RELAXED));
+}
+
+/**
+ * @brief Fungsi sederhana untuk mengekstrak field string dari respons JSON.
+ *
+ * Parsing dilakukan secara sederhana dengan mencari pola "key":"...".
+ *
+ * @param response Respons JSON.
+ * @param field Nama field yang dicari.
+ * @return char* Nilai yang dialokasikan secara dinamis, atau NULL jika tidak ditemukan.
+ */
+static char* parse_string_field(const char* response, const char* field)
+{
+    char key[64];
+    snprintf(key, sizeof(key), "\"%s\":\"", field);
     char *start = strstr(response, key);
     if (!start)
         return NULL;
@@ -140,6 +288,18 @@ WINEMATRIX_handle* WINEMATRIX_create(const char* homeserver, const char* usernam
     handle->username = strdup(username);
     handle->password = strdup(password);
     handle->access_token = NULL;
+    handle->state = NULL;
+    handle->store = NULL;
+    handle->search = NULL;
+    handle->media = NULL;
+    handle->sliding = NULL;
+    handle->msgids = NULL;
+    size_t instance_len = strlen(username) + strlen(homeserver) + 2;
+    char *instance = malloc(instance_len);
+    if (instance)
+        snprintf(instance, instance_len, "%s@%s", username, homeserver);
+    handle->metrics = WINEB2B_metrics_create("matrix", instance ? instance : username);
+    free(instance);
     
     /* Buat URL login */
     size_t url_len = strlen(homeserver) + 100;
@@ -158,7 +318,7 @@ WINEMATRIX_handle* WINEMATRIX_create(const char* homeserver, const char* usernam
     chunk.memory = malloc(1);
     chunk.size = 0;
     
-    if (perform_http_request(login_url, json_data, "POST", &chunk) != 0) {
+    if (perform_http_request(handle->metrics, login_url, json_data, "POST", &chunk) != 0) {
         free(login_url);
         free(json_data);
         free(chunk.memory);
@@ -167,7 +327,7 @@ WINEMATRIX_handle* WINEMATRIX_create(const char* homeserver, const char* usernam
     }
     
     /* Parse access token dari respons login */
-    handle->access_token = parse_access_token(chunk.memory);
+    handle->access_token = parse_string_field(chunk.memory, "access_token");
     if (!handle->access_token) {
         fprintf(stderr, "Gagal mengambil access token dari respons login\n");
         free(login_url);
@@ -197,7 +357,7 @@ int WINEMATRIX_join_room(WINEMATRIX_handle* handle, const char* room_id)
     chunk.memory = malloc(1);
     chunk.size = 0;
     
-    if (perform_http_request(join_url, "{}", "POST", &chunk) != 0) {
+    if (perform_http_request(handle->metrics, join_url, "{}", "POST", &chunk) != 0) {
         free(join_url);
         free(chunk.memory);
         return -1;
@@ -218,49 +378,105 @@ int WINEMATRIX_join_room(WINEMATRIX_handle* handle, const char* room_id)
 /* Mengirim pesan ke room Matrix */
 WINEMATRIXcode
 int WINEMATRIX_send_message(WINEMATRIX_handle* handle, const char* room_id, const char* message)
+{
+    return WINEMATRIX_send_message_origin(handle, room_id, message, NULL);
+}
+
+/**
+ * @brief Mengambil event_id dari respons send yang berhasil.
+ *
+ * @return char* event_id (dialokasikan), NULL jika status gagal atau tidak ada.
+ */
+static char* response_event_id(const struct MemoryStruct *chunk)
+{
+    if (chunk->status < 200 || chunk->status >= 300 || chunk->size == 0)
+        return NULL;
+    return parse_string_field(chunk->memory, "event_id");
+}
+
+/**
+ * @brief Content m.text dengan json-c, sehingga teks dari jaringan lain
+ * (kutip, backslash, kontrol) tidak bisa merusak atau menambah key.
+ *
+ * @param body Isi pesan.
+ * @param origin ID instance bridge untuk WINEB2B_ORIGIN_FIELD, NULL = tanpa penanda.
+ * @param reply_to event_id yang dibalas (m.in_reply_to), NULL = bukan reply.
+ * @return json_object* Content (bebaskan dengan json_object_put).
+ */
+static json_object* text_content(const char* body, const char* origin, const char* reply_to)
+{
+    json_object *content = json_object_new_object();
+    json_object_object_add(content, "msgtype", json_object_new_string("m.text"));
+    json_object_object_add(content, "body", json_object_new_string(body));
+    if (origin)
+        json_object_object_add(content, WINEB2B_ORIGIN_FIELD, json_object_new_string(origin));
+    if (reply_to) {
+        json_object *in_reply_to = json_object_new_object(), *relates_to = json_object_new_object();
+        json_object_object_add(in_reply_to, "event_id", json_object_new_string(reply_to));
+        json_object_object_add(relates_to, "m.in_reply_to", in_reply_to);
+        json_object_object_add(content, "m.relates_to", relates_to);
+    }
+    return content;
+}
+
+/* Mengirim m.text dengan penanda origin opsional; event_id hasilnya ke *event_id jika tidak NULL */
+static int send_text(WINEMATRIX_handle* handle, const char* room_id, const char* message, const char* origin,
+                     char** event_id)
 {
     if (!handle || !handle->access_token)
         return -1;
-    long txn_id = (long)time(NULL);
-    size_t url_len = strlen(handle->homeserver) + strlen(room_id) + strlen(handle->access_token) + 100;
+    char txn_id[TXN_ID_SIZE];
+    next_txn_id(txn_id, sizeof(txn_id));
+    size_t url_len = strlen(handle->homeserver) + strlen(room_id) + strlen(handle->access_token) + TXN_ID_SIZE + 100;
     char *send_url = malloc(url_len);
     snprintf(send_url, url_len, SEND_URL_FORMAT, handle->homeserver, room_id, txn_id, handle->access_token);
     
-    size_t json_len = strlen(message) + 150;
-    char *json_data = malloc(json_len);
-    snprintf(json_data, json_len,
-             "{ \"msgtype\": \"m.text\", \"body\": \"%s\" }",
-             message);
+    json_object *content = text_content(message, origin, NULL);
+    const char *json_data = json_object_to_json_string_ext(content, JSON_C_TO_STRING_PLAIN);
     
     struct MemoryStruct chunk;
     chunk.memory = malloc(1);
     chunk.size = 0;
     
-    if (perform_http_request(send_url, json_data, "PUT", &chunk) != 0) {
+    WINEB2B_metrics_add(handle->metrics, WINEB2B_METRIC_SENDS_QUEUED, 1);
+    int ret = perform_http_request(handle->metrics, send_url, json_data, "PUT", &chunk);
+    count_send(handle, ret, &chunk);
+    if (ret != 0) {
         free(send_url);
-        free(json_data);
+        json_object_put(content);
         free(chunk.memory);
         return -1;
     }
     
-    printf("Respons pengiriman: %s\n", chunk.memory);
+    WINEB2B_LOG_DEBUG("matrix", "op=send status=%ld body=%s", chunk.status, chunk.memory);
+    if (event_id)
+        *event_id = response_event_id(&chunk);
     
     free(send_url);
-    free(json_data);
+    json_object_put(content);
     free(chunk.memory);
     return 0;
 }
 
-/* Mengirim pesan reply dengan mengutip pesan asli */
+/* Mengirim pesan ke room Matrix dengan penanda origin bridge di content */
 WINEMATRIXcode
-int WINEMATRIX_send_reply(WINEMATRIX_handle* handle, const char* room_id, const char* original_event_id,
-                            const char* original_message, const char* reply_message)
+int WINEMATRIX_send_message_origin(WINEMATRIX_handle* handle, const char* room_id, const char* message,
+                                   const char* origin)
+{
+    return send_text(handle, room_id, message, origin, NULL);
+}
+
+/* Reply dengan kutipan pesan asli dan penanda origin opsional; event_id hasilnya ke *event_id jika tidak NULL */
+static int send_reply_text(WINEMATRIX_handle* handle, const char* room_id, const char* original_event_id,
+                           const char* original_message, const char* reply_message, const char* origin,
+                           char** event_id)
 {
     if (!handle || !handle->access_token)
         return -1;
         
-    long txn_id = (long)time(NULL);
-    size_t url_len = strlen(handle->homeserver) + strlen(room_id) + strlen(handle->access_token) + 100;
+    char txn_id[TXN_ID_SIZE];
+    next_txn_id(txn_id, sizeof(txn_id));
+    size_t url_len = strlen(handle->homeserver) + strlen(room_id) + strlen(handle->access_token) + TXN_ID_SIZE + 100;
     char *send_url = malloc(url_len);
     snprintf(send_url, url_len, SEND_URL_FORMAT, handle->homeserver, room_id, txn_id, handle->access_token);
     
@@ -271,28 +487,36 @@ int WINEMATRIX_send_reply(WINEMATRIX_handle* handle, const char* room_id, const
              "> %s\n\n%s",
              original_message, reply_message);
     
-    size_t json_len = body_len + strlen(original_event_id) + 150;
-    char *json_data = malloc(json_len);
-    snprintf(json_data, json_len,
-             "{ \"msgtype\": \"m.text\", \"body\": \"%s\", "
-             "\"m.relates_to\": { \"m.in_reply_to\": { \"event_id\": \"%s\" } } }",
-             body, original_event_id);
+    json_object *content = text_content(body, origin, original_event_id);
+    const char *json_data = json_object_to_json_string_ext(content, JSON_C_TO_STRING_PLAIN);
     
     struct MemoryStruct chunk;
     chunk.memory = malloc(1);
     chunk.size = 0;
     
-    int ret = perform_http_request(send_url, json_data, "PUT", &chunk);
+    WINEB2B_metrics_add(handle->metrics, WINEB2B_METRIC_SENDS_QUEUED, 1);
+    int ret = perform_http_request(handle->metrics, send_url, json_data, "PUT", &chunk);
+    count_send(handle, ret, &chunk);
     
-    printf("Respons reply: %s\n", chunk.memory);
+    WINEB2B_LOG_DEBUG("matrix", "op=reply status=%ld body=%s", chunk.status, chunk.memory);
+    if (event_id && ret == 0)
+        *event_id = response_event_id(&chunk);
     
     free(send_url);
-    free(json_data);
+    json_object_put(content);
     free(body);
     free(chunk.memory);
     return ret;
 }
 
+/* Mengirim pesan reply dengan mengutip pesan asli */
+WINEMATRIXcode
+int WINEMATRIX_send_reply(WINEMATRIX_handle* handle, const char* room_id, const char* original_event_id,
+                            const char* original_message, const char* reply_message)
+{
+    return send_reply_text(handle, room_id, original_event_id, original_message, reply_message, NULL, NULL);
+}
+
 /* Mengirim pesan direct message (DM) ke room DM yang sudah ada */
 WINEMATRIXcode
 int WINEMATRIX_send_direct_message(WINEMATRIX_handle* handle, const char* dm_room_id, const char* message)
@@ -307,13 +531,14 @@ int WINEMATRIX_send_reaction(WINEMATRIX_handle* handle, const char* room_id, con
 {
     if (!handle || !handle->access_token)
         return -1;
-    long txn_id = (long)time(NULL);
+    char txn_id[TXN_ID_SIZE];
+    next_txn_id(txn_id, sizeof(txn_id));
     
     /* Endpoint untuk reaction dengan tipe event m.reaction */
-    size_t url_len = strlen(handle->homeserver) + strlen(room_id) + strlen(handle->access_token) + 100;
+    size_t url_len = strlen(handle->homeserver) + strlen(room_id) + strlen(handle->access_token) + TXN_ID_SIZE + 100;
     char *send_url = malloc(url_len);
     snprintf(send_url, url_len,
-             "%s/_matrix/client/r0/rooms/%s/send/m.reaction/%ld?access_token=%s",
+             "%s/_matrix/client/r0/rooms/%s/send/m.reaction/%s?access_token=%s",
              handle->homeserver, room_id, txn_id, handle->access_token);
     
     size_t json_len = strlen(target_event_id) + strlen(reaction) + 150;
@@ -326,9 +551,11 @@ int WINEMATRIX_send_reaction(WINEMATRIX_handle* handle, const char* room_id, con
     chunk.memory = malloc(1);
     chunk.size = 0;
     
-    int ret = perform_http_request(send_url, json_data, "PUT", &chunk);
+    WINEB2B_metrics_add(handle->metrics, WINEB2B_METRIC_SENDS_QUEUED, 1);
+    int ret = perform_http_request(handle->metrics, send_url, json_data, "PUT", &chunk);
+    count_send(handle, ret, &chunk);
     
-    printf("Respons reaction: %s\n", chunk.memory);
+    WINEB2B_LOG_DEBUG("matrix", "op=reaction status=%ld body=%s", chunk.status, chunk.memory);
     
     free(send_url);
     free(json_data);
@@ -336,6 +563,42 @@ int WINEMATRIX_send_reaction(WINEMATRIX_handle* handle, const char* room_id, con
     return ret;
 }
 
+/**
+ * @brief Mengambil content m.room.pinned_events saat ini.
+ *
+ * Dari cache state jika event-nya ada di cache, jika tidak lewat GET state
+ * ke homeserver. Room tanpa pinned events menghasilkan content kosong.
+ *
+ * @return json_object* Content (bebaskan dengan json_object_put), NULL jika gagal dibaca.
+ */
+static json_object* current_pinned(WINEMATRIX_handle* handle, const char* room_id, const char* pin_url)
+{
+    /* Hanya event yang ada di cache yang dipercaya: room yang dikenal cache
+       belum tentu membawa pinned events (misal required_state sliding sync),
+       dan menganggapnya kosong akan menghapus semua pin lama */
+    char *cached = handle->state ? WINEMATRIX_state_get(handle->state, room_id, "m.room.pinned_events", "") : NULL;
+    if (cached) {
+        json_object *content = json_tokener_parse(cached);
+        free(cached);
+        if (content)
+            return content;
+    }
+    struct MemoryStruct chunk;
+    chunk.memory = malloc(1);
+    chunk.size = 0;
+    json_object *content = NULL;
+    if (perform_http_request(handle->metrics, pin_url, NULL, "GET", &chunk) == 0) {
+        if (chunk.status == 404)
+            content = json_object_new_object();
+        else if (chunk.status >= 200 && chunk.status < 300 && chunk.size > 0)
+            content = json_tokener_parse(chunk.memory);
+    }
+    if (!content)
+        fprintf(stderr, "Error: gagal membaca pinned events room %s (status %ld)\n", room_id, chunk.status);
+    free(chunk.memory);
+    return content;
+}
+
 /* Menyematkan (pin) pesan di room Matrix */
 WINEMATRIXcode
 int WINEMATRIX_pin_message(WINEMATRIX_handle* handle, const char* room_id, const char* event_id)
@@ -346,20 +609,42 @@ int WINEMATRIX_pin_message(WINEMATRIX_handle* handle, const char* room_id, const
     char *pin_url = malloc(url_len);
     snprintf(pin_url, url_len, STATE_PIN_URL_FORMAT, handle->homeserver, room_id, handle->access_token);
     
-    size_t json_len = strlen(event_id) + 100;
-    char *json_data = malloc(json_len);
-    snprintf(json_data, json_len, "{ \"pinned\": [ \"%s\" ] }", event_id);
+    /* Daftar lama dipertahankan: event baru ditambahkan di akhir */
+    json_object *content = current_pinned(handle, room_id, pin_url);
+    if (!content) {
+        free(pin_url);
+        return -1;
+    }
+    json_object *pinned;
+    if (!json_object_object_get_ex(content, "pinned", &pinned) || !json_object_is_type(pinned, json_type_array)) {
+        pinned = json_object_new_array();
+        json_object_object_add(content, "pinned", pinned);
+    }
+    size_t count = json_object_array_length(pinned);
+    for (size_t i = 0; i < count; i++) {
+        const char *id = json_object_get_string(json_object_array_get_idx(pinned, i));
+        if (id && strcmp(id, event_id) == 0) {
+            /* Sudah dipin, tidak perlu request */
+            json_object_put(content);
+            free(pin_url);
+            return 0;
+        }
+    }
+    json_object_array_add(pinned, json_object_new_string(event_id));
+    const char *json_data = json_object_to_json_string_ext(content, JSON_C_TO_STRING_PLAIN);
     
     struct MemoryStruct chunk;
     chunk.memory = malloc(1);
     chunk.size = 0;
     
-    int ret = perform_http_request(pin_url, json_data, "PUT", &chunk);
+    int ret = perform_http_request(handle->metrics, pin_url, json_data, "PUT", &chunk);
+    if (ret == 0 && chunk.status < 400 && handle->state)
+        WINEMATRIX_state_apply_event(handle->state, room_id, "m.room.pinned_events", "", json_data);
     
-    printf("Respons pin: %s\n", chunk.memory);
+    WINEB2B_LOG_DEBUG("matrix", "op=pin status=%ld body=%s", chunk.status, chunk.memory);
     
     free(pin_url);
-    free(json_data);
+    json_object_put(content);
     free(chunk.memory);
     return ret;
 }
@@ -370,8 +655,9 @@ int WINEMATRIX_redact_message(WINEMATRIX_handle* handle, const char* room_id, co
 {
     if (!handle || !handle->access_token)
         return -1;
-    long txn_id = (long)time(NULL);
-    size_t url_len = strlen(handle->homeserver) + strlen(room_id) + strlen(event_id) + strlen(handle->access_token) + 150;
+    char txn_id[TXN_ID_SIZE];
+    next_txn_id(txn_id, sizeof(txn_id));
+    size_t url_len = strlen(handle->homeserver) + strlen(room_id) + strlen(event_id) + strlen(handle->access_token) + TXN_ID_SIZE + 150;
     char *redact_url = malloc(url_len);
     snprintf(redact_url, url_len, REDACT_URL_FORMAT, handle->homeserver, room_id, event_id, txn_id, handle->access_token);
     
@@ -383,9 +669,9 @@ int WINEMATRIX_redact_message(WINEMATRIX_handle* handle, const char* room_id, co
     chunk.memory = malloc(1);
     chunk.size = 0;
     
-    int ret = perform_http_request(redact_url, json_data, "POST", &chunk);
+    int ret = perform_http_request(handle->metrics, redact_url, json_data, "POST", &chunk);
     
-    printf("Respons redact: %s\n", chunk.memory);
+    WINEB2B_LOG_DEBUG("matrix", "op=redact status=%ld body=%s", chunk.status, chunk.memory);
     
     free(redact_url);
     free(json_data);
@@ -403,8 +689,9 @@ int WINEMATRIX_forward_message(WINEMATRIX_handle* handle,
 {
     if (!handle || !handle->access_token)
         return -1;
-    long txn_id = (long)time(NULL);
-    size_t url_len = strlen(handle->homeserver) + strlen(dest_room_id) + strlen(handle->access_token) + 100;
+    char txn_id[TXN_ID_SIZE];
+    next_txn_id(txn_id, sizeof(txn_id));
+    size_t url_len = strlen(handle->homeserver) + strlen(dest_room_id) + strlen(handle->access_token) + TXN_ID_SIZE + 100;
     char *send_url = malloc(url_len);
     snprintf(send_url, url_len, SEND_URL_FORMAT, handle->homeserver, dest_room_id, txn_id, handle->access_token);
     
@@ -425,9 +712,11 @@ int WINEMATRIX_forward_message(WINEMATRIX_handle* handle,
     chunk.memory = malloc(1);
     chunk.size = 0;
     
-    int ret = perform_http_request(send_url, json_data, "PUT", &chunk);
+    WINEB2B_metrics_add(handle->metrics, WINEB2B_METRIC_SENDS_QUEUED, 1);
+    int ret = perform_http_request(handle->metrics, send_url, json_data, "PUT", &chunk);
+    count_send(handle, ret, &chunk);
     
-    printf("Respons forward: %s\n", chunk.memory);
+    WINEB2B_LOG_DEBUG("matrix", "op=forward status=%ld body=%s", chunk.status, chunk.memory);
     
     free(send_url);
     free(json_data);
@@ -436,6 +725,318 @@ int WINEMATRIX_forward_message(WINEMATRIX_handle* handle,
     return ret;
 }
 
+/* Memakai indeks ID pesan untuk fungsi relay */
+WINEMATRIXcode
+int WINEMATRIX_map_message_ids(WINEMATRIX_handle* handle, WINEB2B_msgid_index* msgids)
+{
+    if (!handle)
+        return -1;
+    handle->msgids = msgids;
+    return 0;
+}
+
+/* Mencatat source_id -> event_id hasil relay, lalu membebaskan event_id */
+static void map_relayed(WINEMATRIX_handle* handle, const char* source_id, char* event_id)
+{
+    if (handle->msgids && source_id && event_id &&
+        WINEB2B_msgid_index_put(handle->msgids, source_id, event_id) != 0)
+        fprintf(stderr, "Error: gagal mencatat ID pesan %s -> %s\n", source_id, event_id);
+    free(event_id);
+}
+
+/* Mencari event_id untuk ID pesan sumber di handle->msgids */
+static int lookup_relayed(WINEMATRIX_handle* handle, const char* source_id, char* event_id, size_t len)
+{
+    if (!handle || !handle->msgids || !source_id)
+        return -1;
+    return WINEB2B_msgid_index_get_matrix(handle->msgids, source_id, event_id, len);
+}
+
+/* Me-relay pesan dari jaringan lain dan mencatat event_id-nya */
+WINEMATRIXcode
+int WINEMATRIX_relay_message(WINEMATRIX_handle* handle, const char* room_id, const char* message,
+                             const char* origin, const char* source_id)
+{
+    char *event_id = NULL;
+    int ret = send_text(handle, room_id, message, origin, handle && handle->msgids ? &event_id : NULL);
+    if (ret == 0)
+        map_relayed(handle, source_id, event_id);
+    else
+        free(event_id);
+    return ret;
+}
+
+/* Me-relay reply ke pesan yang sebelumnya di-relay */
+WINEMATRIXcode
+int WINEMATRIX_relay_reply(WINEMATRIX_handle* handle, const char* room_id, const char* target_source_id,
+                           const char* original_message, const char* reply_message, const char* origin,
+                           const char* source_id)
+{
+    char target[WINEB2B_MSGID_MAX + 1];
+    if (lookup_relayed(handle, target_source_id, target, sizeof(target)) != 0)
+        return WINEMATRIX_relay_message(handle, room_id, reply_message, origin, source_id);
+    char *event_id = NULL;
+    int ret = send_reply_text(handle, room_id, target, original_message, reply_message, origin, &event_id);
+    if (ret == 0)
+        map_relayed(handle, source_id, event_id);
+    else
+        free(event_id);
+    return ret;
+}
+
+/* Me-relay penghapusan pesan yang sebelumnya di-relay */
+WINEMATRIXcode
+int WINEMATRIX_relay_redact(WINEMATRIX_handle* handle, const char* room_id, const char* source_id,
+                            const char* reason)
+{
+    char event_id[WINEB2B_MSGID_MAX + 1];
+    if (lookup_relayed(handle, source_id, event_id, sizeof(event_id)) != 0)
+        return -1;
+    return WINEMATRIX_redact_message(handle, room_id, event_id, reason);
+}
+
+/* Me-relay reaction terhadap pesan yang sebelumnya di-relay */
+WINEMATRIXcode
+int WINEMATRIX_relay_reaction(WINEMATRIX_handle* handle, const char* room_id, const char* target_source_id,
+                              const char* reaction)
+{
+    char event_id[WINEB2B_MSGID_MAX + 1];
+    if (lookup_relayed(handle, target_source_id, event_id, sizeof(event_id)) != 0)
+        return -1;
+    return WINEMATRIX_send_reaction(handle, room_id, event_id, reaction);
+}
+
+/* m.room.message dari timeline room yang di-join masuk ke handle->search */
+static void index_sync(WINEMATRIX_handle* handle, json_object* root)
+{
+    json_object *rooms, *join;
+    if (json_object_object_get_ex(root, "rooms", &rooms) && json_object_object_get_ex(rooms, "join", &join)) {
+        const char *host = strstr(handle->homeserver, "://");
+        char network[300];
+        snprintf(network, sizeof(network), "matrix:%s", host ? host + 3 : handle->homeserver);
+        struct json_object_iterator it = json_object_iter_begin(join), end = json_object_iter_end(join);
+        for (; !json_object_iter_equal(&it, &end); json_object_iter_next(&it)) {
+            json_object *timeline, *events;
+            if (!json_object_object_get_ex(json_object_iter_peek_value(&it), "timeline", &timeline) ||
+                !json_object_object_get_ex(timeline, "events", &events))
+                continue;
+            size_t n = json_object_array_length(events);
+            for (size_t i = 0; i < n; i++) {
+                json_object *ev = json_object_array_get_idx(events, i), *type, *content, *body, *sender, *ts, *edit;
+                if (!json_object_object_get_ex(ev, "type", &type) ||
+                    strcmp(json_object_get_string(type), "m.room.message") != 0 ||
+                    !json_object_object_get_ex(ev, "content", &content))
+                    continue;
+                /* Edit diindeks dengan teks barunya */
+                if (json_object_object_get_ex(content, "m.new_content", &edit))
+                    content = edit;
+                if (!json_object_object_get_ex(content, "body", &body) || !json_object_is_type(body, json_type_string))
+                    continue;
+                WINEB2B_search_doc doc = {
+                    network, json_object_iter_peek_name(&it),
+                    json_object_object_get_ex(ev, "sender", &sender) ? json_object_get_string(sender) : NULL,
+                    json_object_object_get_ex(ev, "origin_server_ts", &ts) ? json_object_get_int64(ts) : 0,
+                    json_object_get_string(body)
+                };
+                WINEB2B_search_add(handle->search, &doc);
+            }
+        }
+    }
+}
+
+/* Respons /sync (atau hasil konversi sliding sync) diparse sekali lalu
+   diteruskan ke cache state, store dan indeks */
+static void apply_sync(WINEMATRIX_handle* handle, const char* sync_json)
+{
+    if (!handle->state && !handle->store && !handle->search)
+        return;
+    json_object *root = json_tokener_parse(sync_json);
+    if (!root) {
+        fprintf(stderr, "Error: respons /sync bukan JSON yang valid\n");
+        return;
+    }
+    if (handle->state)
+        WINEMATRIX_state_apply_sync_object(handle->state, root);
+    if (handle->store)
+        WINEMATRIX_store_apply_sync_object(handle->store, root);
+    if (handle->search)
+        index_sync(handle, root);
+    json_object_put(root);
+}
+
+/**
+ * @brief Satu request sliding sync dengan jendela saat ini.
+ *
+ * Selama jendela belum mencakup semua room, request tidak menunggu
+ * (timeout 0) agar sisa room cepat terisi; sesudahnya long-poll biasa.
+ * M_UNKNOWN_POS memulai koneksi dari awal sekali.
+ */
+static int sliding_sync(WINEMATRIX_handle* handle, int timeout_ms, char** response, char** next_batch)
+{
+    WINEMATRIX_sliding_stats st;
+    WINEMATRIX_sliding_get_stats(handle->sliding, &st);
+    if (!st.complete)
+        timeout_ms = 0;
+
+    for (int attempt = 0; attempt < 2; attempt++) {
+        const char *pos = WINEMATRIX_sliding_pos(handle->sliding);
+        char *escaped = pos ? curl_easy_escape(NULL, pos, 0) : NULL;
+        size_t url_len = strlen(handle->homeserver) + strlen(handle->access_token) +
+                         (escaped ? strlen(escaped) : 0) + 200;
+        char *url = malloc(url_len);
+        char *body = WINEMATRIX_sliding_request(handle->sliding);
+        if (!url || !body) {
+            curl_free(escaped);
+            free(url);
+            free(body);
+            return -1;
+        }
+        int len = snprintf(url, url_len, SLIDING_SYNC_URL_FORMAT, handle->homeserver, handle->access_token, timeout_ms);
+        if (escaped)
+            snprintf(url + len, url_len - len, "&pos=%s", escaped);
+        curl_free(escaped);
+
+        struct MemoryStruct chunk;
+        chunk.memory = malloc(1);
+        chunk.size = 0;
+        int ret = perform_http_request(handle->metrics, url, body, "POST", &chunk);
+        free(url);
+        free(body);
+        if (ret != 0 || chunk.size == 0) {
+            free(chunk.memory);
+            return -1;
+        }
+        if (chunk.status == 400 && strstr(chunk.memory, "M_UNKNOWN_POS") && attempt == 0) {
+            WINEB2B_LOG_INFO("matrix", "op=sliding_sync pos=%s reset", pos);
+            WINEMATRIX_sliding_reset(handle->sliding);
+            free(chunk.memory);
+            continue;
+        }
+        char *sync_json = NULL;
+        if (chunk.status >= 300 || WINEMATRIX_sliding_apply(handle->sliding, chunk.memory, &sync_json) < 0) {
+            fprintf(stderr, "Gagal sliding sync. Respons: %s\n", chunk.memory);
+            free(chunk.memory);
+            return -1;
+        }
+        free(chunk.memory);
+        apply_sync(handle, sync_json);
+        if (next_batch)
+            *next_batch = strdup(WINEMATRIX_sliding_pos(handle->sliding));
+        *response = sync_json;
+        return 0;
+    }
+    return -1;
+}
+
+/* Melakukan satu kali long-poll /sync */
+WINEMATRIXcode
+int WINEMATRIX_sync(WINEMATRIX_handle* handle, const char* since, int timeout_ms,
+                    char** response, char** next_batch)
+{
+    if (!handle || !handle->access_token || !response)
+        return -1;
+    *response = NULL;
+    if (next_batch)
+        *next_batch = NULL;
+    if (handle->sliding)
+        return sliding_sync(handle, timeout_ms, response, next_batch);
+
+    size_t url_len = strlen(handle->homeserver) + strlen(handle->access_token) +
+                     (since ? strlen(since) : 0) + 150;
+    char *sync_url = malloc(url_len);
+    int len = snprintf(sync_url, url_len, SYNC_URL_FORMAT, handle->homeserver, handle->access_token, timeout_ms);
+    if (since && *since)
+        snprintf(sync_url + len, url_len - len, "&since=%s", since);
+
+    struct MemoryStruct chunk;
+    chunk.memory = malloc(1);
+    chunk.size = 0;
+
+    if (perform_http_request(handle->metrics, sync_url, NULL, "GET", &chunk) != 0 || chunk.size == 0) {
+        free(sync_url);
+        free(chunk.memory);
+        return -1;
+    }
+    free(sync_url);
+
+    if (strstr(chunk.memory, "\"errcode\"") && !strstr(chunk.memory, "\"next_batch\"")) {
+        fprintf(stderr, "Gagal sync. Respons: %s\n", chunk.memory);
+        free(chunk.memory);
+        return -1;
+    }
+    if (next_batch)
+        *next_batch = parse_string_field(chunk.memory, "next_batch");
+    apply_sync(handle, chunk.memory);
+    *response = chunk.memory;
+    return 0;
+}
+
+/* Beralih ke sliding sync untuk WINEMATRIX_sync berikutnya */
+WINEMATRIXcode
+int WINEMATRIX_use_sliding_sync(WINEMATRIX_handle* handle, const WINEMATRIX_sliding_list* lists, size_t nlists)
+{
+    if (!handle)
+        return -1;
+    WINEMATRIX_sliding *sliding = WINEMATRIX_sliding_create(lists, nlists);
+    if (!sliding) {
+        fprintf(stderr, "Gagal membuat status sliding sync\n");
+        return -1;
+    }
+    WINEMATRIX_sliding_free(handle->sliding);
+    handle->sliding = sliding;
+    return 0;
+}
+
+/* Mengindeks pesan dari /sync ke indeks pencarian */
+WINEMATRIXcode
+int WINEMATRIX_index_messages(WINEMATRIX_handle* handle, WINEB2B_search* search)
+{
+    if (!handle)
+        return -1;
+    handle->search = search;
+    return 0;
+}
+
+/* Mulai menyimpan state room dari /sync */
+WINEMATRIXcode
+int WINEMATRIX_track_state(WINEMATRIX_handle* handle)
+{
+    if (!handle)
+        return -1;
+    if (handle->state)
+        return 0;
+    handle->state = WINEMATRIX_state_create();
+    if (!handle->state) {
+        fprintf(stderr, "Gagal membuat cache state room\n");
+        return -1;
+    }
+    return 0;
+}
+
+/* Membuka event store lokal yang diisi dari /sync */
+WINEMATRIXcode
+int WINEMATRIX_open_store(WINEMATRIX_handle* handle, const char* dir)
+{
+    if (!handle || !dir)
+        return -1;
+    if (handle->store)
+        return 0;
+    handle->store = WINEMATRIX_store_open(dir, 0);
+    return handle->store ? 0 : -1;
+}
+
+/* Membuka cache media lokal untuk upload/download */
+WINEMATRIXcode
+int WINEMATRIX_open_media_cache(WINEMATRIX_handle* handle, const char* dir, uint64_t max_bytes)
+{
+    if (!handle || !dir)
+        return -1;
+    if (handle->media)
+        return 0;
+    handle->media = WINEMATRIX_media_open(dir, max_bytes);
+    return handle->media ? 0 : -1;
+}
+
 /* Membebaskan memori yang digunakan oleh handle */
 WINEMATRIXcode
 void WINEMATRIX_free(WINEMATRIX_handle* handle)
@@ -447,5 +1048,10 @@ void WINEMATRIX_free(WINEMATRIX_handle* handle)
     free(handle->password);
     if (handle->access_token)
         free(handle->access_token);
+    WINEB2B_metrics_free(handle->metrics);
+    WINEMATRIX_state_free(handle->state);
+    WINEMATRIX_store_close(handle->store);
+    WINEMATRIX_media_close(handle->media);
+    WINEMATRIX_sliding_free(handle->sliding);
     free(handle);
 }
\ No newline at end of file
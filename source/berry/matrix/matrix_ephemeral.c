@@ -0,0 +1,502 @@
+#include "matrix_ephemeral.h"
+#include "matrix_internal.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <json-c/json.h>
+
+/* Format URL untuk event ephemeral */
+#define TYPING_URL_FORMAT      "%s/_matrix/client/r0/rooms/%s/typing/%s?access_token=%s"
+#define READ_MARKERS_URL_FORMAT "%s/_matrix/client/r0/rooms/%s/read_markers?access_token=%s"
+#define PRESENCE_URL_FORMAT    "%s/_matrix/client/r0/presence/%s/status?access_token=%s"
+
+enum item_kind { ITEM_TYPING, ITEM_RECEIPT };
+
+/* Satu state ephemeral: typing per (user, room) atau receipt per room */
+struct item {
+    uint64_t h;
+    char *key;
+    enum item_kind kind;
+    char *room;
+    char *user;          /* Hanya untuk typing */
+    char *event_id;      /* Receipt tertunda (NULL jika tidak ada) */
+    int want, sent;      /* State typing yang diinginkan / terakhir dikirim */
+    uint64_t changed_at; /* Kapan 'want' terakhir berubah */
+    uint64_t touched_at; /* Kapan typing(1) terakhir diterima */
+    uint64_t sent_at;
+    int queued;
+};
+
+struct _WINEMATRIX_ephemeral {
+    WINEMATRIX_handle *handle;
+    WINEMATRIX_ephemeral_config cfg;
+
+    struct item **items;
+    size_t item_count, item_cap;
+    uint32_t *index;            /* Indeks item + 1, 0 = kosong */
+    size_t index_mask;
+
+    struct item **queue;        /* Item yang masih perlu diproses */
+    size_t queue_len, queue_cap;
+
+    uint64_t last_receipt_flush;
+
+    /* Presence: satu slot tertunda, update baru menimpa yang lama */
+    char *presence, *status_msg;
+    char *sent_presence, *sent_status;
+    int presence_pending;
+    uint64_t presence_sent_at;
+
+    WINEMATRIX_ephemeral_stats stats;
+};
+
+/* --- Fungsi Helper --- */
+static uint64_t now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
+
+static uint64_t hash_key(const char* s) {
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (; *s; s++) {
+        h ^= (unsigned char)*s;
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+static int str_eq(const char* a, const char* b) {
+    if (!a || !b)
+        return a == b;
+    return strcmp(a, b) == 0;
+}
+
+/* Mengirim request dan memeriksa errcode di respons */
+static int send_request(WINEMATRIX_ephemeral* eph, const char* url, const char* json, const char* method) {
+    struct MemoryStruct chunk;
+    chunk.memory = malloc(1);
+    chunk.size = 0;
+    int ret = perform_http_request(eph->handle->metrics, url, json, method, &chunk);
+    if (ret == 0 && chunk.memory && strstr(chunk.memory, "\"errcode\"")) {
+        fprintf(stderr, "Gagal mengirim event ephemeral. Respons: %s\n", chunk.memory);
+        ret = -1;
+    }
+    free(chunk.memory);
+    eph->stats.requests++;
+    if (ret != 0)
+        eph->stats.failed++;
+    return ret;
+}
+
+/* --- Tabel item --- */
+
+static int index_grow(WINEMATRIX_ephemeral* eph) {
+    size_t size = (eph->index_mask + 1) * 2;
+    uint32_t *index = calloc(size, sizeof(uint32_t));
+    if (!index)
+        return -1;
+    for (size_t i = 0; i < eph->item_count; i++) {
+        size_t j = eph->items[i]->h & (size - 1);
+        while (index[j])
+            j = (j + 1) & (size - 1);
+        index[j] = (uint32_t)(i + 1);
+    }
+    free(eph->index);
+    eph->index = index;
+    eph->index_mask = size - 1;
+    return 0;
+}
+
+static struct item* item_get(WINEMATRIX_ephemeral* eph, enum item_kind kind,
+                             const char* room, const char* user) {
+    size_t key_len = strlen(room) + (user ? strlen(user) : 0) + 4;
+    char *key = malloc(key_len);
+    if (!key)
+        return NULL;
+    snprintf(key, key_len, "%c\x1f%s\x1f%s", kind == ITEM_TYPING ? 't' : 'r', room, user ? user : "");
+    uint64_t h = hash_key(key);
+
+    size_t i = h & eph->index_mask;
+    for (; eph->index[i]; i = (i + 1) & eph->index_mask) {
+        struct item *it = eph->items[eph->index[i] - 1];
+        if (it->h == h && strcmp(it->key, key) == 0) {
+            free(key);
+            return it;
+        }
+    }
+
+    struct item *it = calloc(1, sizeof(struct item));
+    if (!it) {
+        free(key);
+        return NULL;
+    }
+    it->h = h;
+    it->key = key;
+    it->kind = kind;
+    it->room = strdup(room);
+    it->user = user ? strdup(user) : NULL;
+    if (!it->room || (user && !it->user))
+        goto fail;
+
+    if (eph->item_count == eph->item_cap) {
+        size_t cap = eph->item_cap ? eph->item_cap * 2 : 16;
+        struct item **items = realloc(eph->items, cap * sizeof(struct item*));
+        if (!items)
+            goto fail;
+        eph->items = items;
+        eph->item_cap = cap;
+    }
+    eph->items[eph->item_count++] = it;
+    if (eph->item_count * 10 > (eph->index_mask + 1) * 7) {
+        if (index_grow(eph) != 0) {
+            eph->item_count--;
+            goto fail;
+        }
+    } else {
+        eph->index[i] = (uint32_t)eph->item_count;
+    }
+    return it;
+
+fail:
+    free(it->key);
+    free(it->room);
+    free(it->user);
+    free(it);
+    return NULL;
+}
+
+static int enqueue(WINEMATRIX_ephemeral* eph, struct item* it) {
+    if (it->queued)
+        return 0;
+    if (eph->queue_len == eph->queue_cap) {
+        size_t cap = eph->queue_cap ? eph->queue_cap * 2 : 16;
+        struct item **queue = realloc(eph->queue, cap * sizeof(struct item*));
+        if (!queue)
+            return -1;
+        eph->queue = queue;
+        eph->queue_cap = cap;
+    }
+    eph->queue[eph->queue_len++] = it;
+    it->queued = 1;
+    return 0;
+}
+
+/* --- Pengiriman --- */
+
+static int send_typing(WINEMATRIX_ephemeral* eph, struct item* it, int typing) {
+    WINEMATRIX_handle *h = eph->handle;
+    const char *user = it->user ? it->user : h->username;
+    size_t url_len = strlen(h->homeserver) + strlen(it->room) + 2 * strlen(user) +
+                     strlen(h->access_token) + 150;
+    char *url = malloc(url_len);
+    if (!url)
+        return -1;
+    int len = snprintf(url, url_len, TYPING_URL_FORMAT, h->homeserver, it->room, user, h->access_token);
+    /* Puppet appservice: masquerade sebagai user lain */
+    if (it->user && strcmp(it->user, h->username) != 0)
+        snprintf(url + len, url_len - len, "&user_id=%s", it->user);
+
+    char json[96];
+    if (typing)
+        snprintf(json, sizeof(json), "{ \"typing\": true, \"timeout\": %u }", eph->cfg.typing_timeout_ms);
+    else
+        snprintf(json, sizeof(json), "{ \"typing\": false }");
+    int ret = send_request(eph, url, json, "PUT");
+    free(url);
+    return ret;
+}
+
+static int send_receipt(WINEMATRIX_ephemeral* eph, struct item* it) {
+    WINEMATRIX_handle *h = eph->handle;
+    size_t url_len = strlen(h->homeserver) + strlen(it->room) + strlen(h->access_token) + 100;
+    char *url = malloc(url_len);
+    json_object *content = json_object_new_object();
+    if (!url || !content) {
+        free(url);
+        json_object_put(content);
+        return -1;
+    }
+    snprintf(url, url_len, READ_MARKERS_URL_FORMAT, h->homeserver, it->room, h->access_token);
+    json_object_object_add(content, "m.fully_read", json_object_new_string(it->event_id));
+    json_object_object_add(content, "m.read", json_object_new_string(it->event_id));
+    int ret = send_request(eph, url, json_object_to_json_string_ext(content, JSON_C_TO_STRING_PLAIN), "POST");
+    free(url);
+    json_object_put(content);
+    return ret;
+}
+
+static int send_presence(WINEMATRIX_ephemeral* eph) {
+    WINEMATRIX_handle *h = eph->handle;
+    size_t url_len = strlen(h->homeserver) + strlen(h->username) + strlen(h->access_token) + 100;
+    char *url = malloc(url_len);
+    json_object *content = json_object_new_object();
+    if (!url || !content) {
+        free(url);
+        json_object_put(content);
+        return -1;
+    }
+    snprintf(url, url_len, PRESENCE_URL_FORMAT, h->homeserver, h->username, h->access_token);
+    /* status_msg datang dari jaringan lain: json-c yang meng-escape kutip dan backslash */
+    json_object_object_add(content, "presence", json_object_new_string(eph->presence));
+    if (eph->status_msg)
+        json_object_object_add(content, "status_msg", json_object_new_string(eph->status_msg));
+    int ret = send_request(eph, url, json_object_to_json_string_ext(content, JSON_C_TO_STRING_PLAIN), "PUT");
+    free(url);
+    json_object_put(content);
+    return ret;
+}
+
+/* Memproses satu item typing. Mengembalikan 1 jika item masih perlu antrian. */
+static int process_typing(WINEMATRIX_ephemeral* eph, struct item* it, uint64_t now, int force, int* sent) {
+    const WINEMATRIX_ephemeral_config *cfg = &eph->cfg;
+
+    /* Server sudah menghapus status typing setelah timeout */
+    if (it->sent && now - it->sent_at >= cfg->typing_timeout_ms)
+        it->sent = 0;
+
+    if (it->want != it->sent) {
+        if (force || now - it->changed_at >= cfg->typing_debounce_ms) {
+            if (send_typing(eph, it, it->want) == 0) {
+                it->sent = it->want;
+                it->sent_at = now;
+            } else {
+                it->changed_at = now; /* Coba lagi setelah jeda debounce */
+            }
+            (*sent)++;
+        }
+    } else if (it->want && now - it->sent_at >= cfg->typing_timeout_ms / 2) {
+        if (now - it->touched_at < cfg->typing_timeout_ms / 2) {
+            /* Masih mengetik: refresh sebelum server menganggap selesai */
+            if (send_typing(eph, it, 1) == 0)
+                it->sent_at = now;
+            (*sent)++;
+        } else {
+            /* Tidak ada sinyal lagi dari jaringan asal: anggap berhenti */
+            it->want = 0;
+            it->changed_at = now;
+        }
+    }
+    return it->want || it->want != it->sent;
+}
+
+static int run_queue(WINEMATRIX_ephemeral* eph, int force) {
+    if (!eph)
+        return -1;
+    uint64_t now = now_ms();
+    int sent = 0;
+    int receipts_due = force || now - eph->last_receipt_flush >= eph->cfg.receipt_interval_ms;
+    size_t keep = 0;
+
+    for (size_t i = 0; i < eph->queue_len; i++) {
+        struct item *it = eph->queue[i];
+        int again;
+        if (it->kind == ITEM_TYPING) {
+            again = process_typing(eph, it, now, force, &sent);
+        } else {
+            again = it->event_id != NULL;
+            if (again && receipts_due) {
+                if (send_receipt(eph, it) == 0) {
+                    free(it->event_id);
+                    it->event_id = NULL;
+                    again = 0;
+                }
+                sent++;
+            }
+        }
+        if (again)
+            eph->queue[keep++] = it;
+        else
+            it->queued = 0;
+    }
+    eph->queue_len = keep;
+    if (receipts_due)
+        eph->last_receipt_flush = now;
+
+    if (eph->presence_pending &&
+        (force || now - eph->presence_sent_at >= eph->cfg.presence_interval_ms)) {
+        if (send_presence(eph) == 0) {
+            free(eph->sent_presence);
+            free(eph->sent_status);
+            eph->sent_presence = eph->presence;
+            eph->sent_status = eph->status_msg;
+            eph->presence = eph->status_msg = NULL;
+            eph->presence_pending = 0;
+        }
+        eph->presence_sent_at = now;
+        sent++;
+    }
+    return sent;
+}
+
+/* --- API publik --- */
+
+WINEMATRIXcode
+WINEMATRIX_ephemeral* WINEMATRIX_ephemeral_create(WINEMATRIX_handle* handle,
+                                                  const WINEMATRIX_ephemeral_config* config)
+{
+    if (!handle || !handle->access_token)
+        return NULL;
+    WINEMATRIX_ephemeral *eph = calloc(1, sizeof(WINEMATRIX_ephemeral));
+    if (!eph)
+        return NULL;
+    eph->handle = handle;
+    if (config)
+        eph->cfg = *config;
+    if (!eph->cfg.typing_timeout_ms)
+        eph->cfg.typing_timeout_ms = 30000;
+    if (!eph->cfg.typing_debounce_ms)
+        eph->cfg.typing_debounce_ms = 750;
+    if (!eph->cfg.receipt_interval_ms)
+        eph->cfg.receipt_interval_ms = 2000;
+    if (!eph->cfg.presence_interval_ms)
+        eph->cfg.presence_interval_ms = 15000;
+
+    eph->index_mask = 63;
+    eph->index = calloc(eph->index_mask + 1, sizeof(uint32_t));
+    if (!eph->index) {
+        free(eph);
+        return NULL;
+    }
+    eph->last_receipt_flush = now_ms();
+    return eph;
+}
+
+WINEMATRIXcode
+int WINEMATRIX_ephemeral_typing(WINEMATRIX_ephemeral* eph, const char* room_id,
+                                const char* user_id, int typing)
+{
+    if (!eph || !room_id)
+        return -1;
+    struct item *it = item_get(eph, ITEM_TYPING, room_id, user_id);
+    if (!it)
+        return -1;
+    uint64_t now = now_ms();
+    typing = typing ? 1 : 0;
+    if (typing)
+        it->touched_at = now;
+    if (it->want == typing) {
+        eph->stats.coalesced++;
+        return 0;
+    }
+    /* Start lalu stop sebelum start terkirim: keduanya dibuang */
+    if (!typing && !it->sent)
+        eph->stats.coalesced++;
+    it->want = typing;
+    it->changed_at = now;
+    return enqueue(eph, it);
+}
+
+WINEMATRIXcode
+int WINEMATRIX_ephemeral_read(WINEMATRIX_ephemeral* eph, const char* room_id, const char* event_id)
+{
+    if (!eph || !room_id || !event_id)
+        return -1;
+    struct item *it = item_get(eph, ITEM_RECEIPT, room_id, NULL);
+    if (!it)
+        return -1;
+    char *copy = strdup(event_id);
+    if (!copy)
+        return -1;
+    if (it->event_id) {
+        /* Receipt lama di antrian digantikan yang lebih baru */
+        free(it->event_id);
+        eph->stats.coalesced++;
+    }
+    it->event_id = copy;
+    return enqueue(eph, it);
+}
+
+WINEMATRIXcode
+int WINEMATRIX_ephemeral_presence(WINEMATRIX_ephemeral* eph, const char* presence, const char* status_msg)
+{
+    if (!eph || !presence)
+        return -1;
+    if (eph->presence_pending)
+        eph->stats.coalesced++;
+    free(eph->presence);
+    free(eph->status_msg);
+    eph->presence = eph->status_msg = NULL;
+    eph->presence_pending = 0;
+
+    /* Sama dengan yang terakhir dikirim: tidak perlu request */
+    if (str_eq(presence, eph->sent_presence) && str_eq(status_msg, eph->sent_status))
+        return 0;
+    eph->presence = strdup(presence);
+    eph->status_msg = status_msg ? strdup(status_msg) : NULL;
+    if (!eph->presence || (status_msg && !eph->status_msg))
+        return -1;
+    eph->presence_pending = 1;
+    return 0;
+}
+
+WINEMATRIXcode
+int WINEMATRIX_ephemeral_poll(WINEMATRIX_ephemeral* eph)
+{
+    return run_queue(eph, 0);
+}
+
+WINEMATRIXcode
+int WINEMATRIX_ephemeral_flush(WINEMATRIX_ephemeral* eph)
+{
+    return run_queue(eph, 1);
+}
+
+WINEMATRIXcode
+long WINEMATRIX_ephemeral_next_due_ms(WINEMATRIX_ephemeral* eph)
+{
+    if (!eph)
+        return -1;
+    uint64_t now = now_ms();
+    long best = -1;
+#define CONSIDER(due) do { \
+        uint64_t d_ = (due); \
+        long w_ = d_ > now ? (long)(d_ - now) : 0; \
+        if (best < 0 || w_ < best) best = w_; \
+    } while (0)
+
+    for (size_t i = 0; i < eph->queue_len; i++) {
+        struct item *it = eph->queue[i];
+        if (it->kind == ITEM_RECEIPT)
+            CONSIDER(eph->last_receipt_flush + eph->cfg.receipt_interval_ms);
+        else if (it->want != it->sent)
+            CONSIDER(it->changed_at + eph->cfg.typing_debounce_ms);
+        else
+            CONSIDER(it->sent_at + eph->cfg.typing_timeout_ms / 2);
+    }
+    if (eph->presence_pending)
+        CONSIDER(eph->presence_sent_at + eph->cfg.presence_interval_ms);
+#undef CONSIDER
+    return best;
+}
+
+WINEMATRIXcode
+void WINEMATRIX_ephemeral_get_stats(const WINEMATRIX_ephemeral* eph, WINEMATRIX_ephemeral_stats* out)
+{
+    if (eph && out)
+        *out = eph->stats;
+}
+
+WINEMATRIXcode
+void WINEMATRIX_ephemeral_free(WINEMATRIX_ephemeral* eph)
+{
+    if (!eph)
+        return;
+    for (size_t i = 0; i < eph->item_count; i++) {
+        struct item *it = eph->items[i];
+        free(it->key);
+        free(it->room);
+        free(it->user);
+        free(it->event_id);
+        free(it);
+    }
+    free(eph->items);
+    free(eph->index);
+    free(eph->queue);
+    free(eph->presence);
+    free(eph->status_msg);
+    free(eph->sent_presence);
+    free(eph->sent_status);
+    free(eph);
+}
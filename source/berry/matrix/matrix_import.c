@@ -0,0 +1,573 @@
+#define _GNU_SOURCE
+#include "matrix_driver.h"
+#include "matrix_internal.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <stdarg.h>
+#include <errno.h>
+#include <poll.h>
+#include <time.h>
+#include <curl/curl.h>
+#include <json-c/json.h>
+
+#define DEFAULT_WINDOW      32
+#define MAX_RETRIES         5
+#define IO_TIMEOUT_MS       30000           /* Tanpa aktivitas di koneksi pipeline */
+#define CONNECT_TIMEOUT_S   10L
+#define RECV_CHUNK          16384
+#define MAX_HEADER          16384
+
+enum { OP_JOIN, OP_SEND };
+
+/* Satu request di pipeline: join puppet atau kirim pesan */
+struct op {
+    int kind;
+    size_t msg;                 /* Indeks pesan (join: pesan pertama puppet) */
+    unsigned attempts;
+    int done;                   /* Sudah dijawab final (berhasil, ditolak atau percobaan habis) */
+    int overtaken;              /* Didahului request sesudahnya setelah 429/5xx */
+    uint64_t sent_us;           /* Waktu request mulai ditulis */
+};
+
+struct pipeline {
+    WINEMATRIX_handle *handle;
+    const WINEMATRIX_import_message *msgs;
+    WINEMATRIX_import_config cfg;
+    const char *room_id;
+    const char *token;
+    int masquerade;             /* Token appservice: user_id dan ts dikirim */
+    char host[256];             /* host[:port] untuk header Host */
+    char prefix[256];           /* Path dasar homeserver tanpa '/' akhir */
+    char *room;                 /* room_id ter-escape */
+    CURL *curl;
+    curl_socket_t fd;
+    struct op *ops;
+    size_t nops;
+    size_t next_ack;            /* Op pertama yang belum done */
+    size_t next_recv;           /* Op berikutnya yang menunggu respons di koneksi ini */
+    size_t next_send;
+    /* 429/5xx: request sesudahnya yang sudah terkirim ditunggu dulu
+       jawabannya, lalu pengiriman diulang dari op gagal pertama dengan
+       window 1 sampai op itu (hold - 1) selesai */
+    int draining;
+    long drain_delay;
+    size_t hold;
+    char *out;
+    size_t out_len, out_off, out_cap;
+    char *in;                   /* Selalu diakhiri '\0' di in[in_len] */
+    size_t in_len, in_cap;
+    WINEMATRIX_import_stats stats;
+};
+
+static uint64_t now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + (uint64_t)ts.tv_nsec / 1000;
+}
+
+static void sleep_ms(long ms) {
+    struct timespec ts = { ms / 1000, (ms % 1000) * 1000000L };
+    while (nanosleep(&ts, &ts) != 0 && errno == EINTR)
+        ;
+}
+
+/* txnId dari room dan key pesan (FNV-1a 64-bit), sama untuk pesan yang sama */
+static void txn_id(const char* room_id, const WINEMATRIX_import_message* m, char* out, size_t size) {
+    uint64_t h = 14695981039346656037ULL;
+    const char *parts[4] = { room_id, m->key, NULL, NULL };
+    char ts[32];
+    if (!m->key) {
+        snprintf(ts, sizeof(ts), "%lld", (long long)m->ts_ms);
+        parts[1] = m->user_id ? m->user_id : "";
+        parts[2] = ts;
+        parts[3] = m->body;
+    }
+    for (int i = 0; i < 4 && parts[i]; i++) {
+        for (const char *c = parts[i]; *c; c++) {
+            h ^= (unsigned char)*c;
+            h *= 1099511628211ULL;
+        }
+        h ^= 0xff;
+        h *= 1099511628211ULL;
+    }
+    snprintf(out, size, "imp%016llx", (unsigned long long)h);
+}
+
+/* URL homeserver -> header Host dan path dasar */
+static int split_homeserver(struct pipeline* p, const char* url) {
+    const char *host = strstr(url, "://");
+    if (!host)
+        return -1;
+    host += 3;
+    size_t hlen = strcspn(host, "/");
+    if (hlen == 0 || hlen >= sizeof(p->host))
+        return -1;
+    memcpy(p->host, host, hlen);
+    p->host[hlen] = '\0';
+    snprintf(p->prefix, sizeof(p->prefix), "%s", host + hlen);
+    size_t plen = strlen(p->prefix);
+    while (plen > 0 && p->prefix[plen - 1] == '/')
+        p->prefix[--plen] = '\0';
+    return 0;
+}
+
+/* --- Membangun request --- */
+
+static int out_reserve(struct pipeline* p, size_t extra) {
+    if (p->out_len + extra <= p->out_cap)
+        return 0;
+    size_t cap = p->out_cap ? p->out_cap : 65536;
+    while (cap < p->out_len + extra)
+        cap *= 2;
+    char *out = realloc(p->out, cap);
+    if (!out)
+        return -1;
+    p->out = out;
+    p->out_cap = cap;
+    return 0;
+}
+
+static int out_printf(struct pipeline* p, const char* fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(NULL, 0, fmt, ap);
+    va_end(ap);
+    if (n < 0 || out_reserve(p, (size_t)n + 1) != 0)
+        return -1;
+    va_start(ap, fmt);
+    vsnprintf(p->out + p->out_len, (size_t)n + 1, fmt, ap);
+    va_end(ap);
+    p->out_len += (size_t)n;
+    return 0;
+}
+
+static int append_request(struct pipeline* p, struct op* op) {
+    const WINEMATRIX_import_message *m = &p->msgs[op->msg];
+    char *user = p->masquerade && m->user_id ? curl_easy_escape(NULL, m->user_id, 0) : NULL;
+    int ret;
+    if (op->kind == OP_JOIN) {
+        ret = out_printf(p, "POST %s/_matrix/client/v3/rooms/%s/join?user_id=%s HTTP/1.1\r\n"
+                            "Host: %s\r\nAuthorization: Bearer %s\r\nContent-Type: application/json\r\n"
+                            "Content-Length: 2\r\n\r\n{}",
+                         p->prefix, p->room, user ? user : "", p->host, p->token);
+    } else {
+        char txn[32], query[512] = "";
+        txn_id(p->room_id, m, txn, sizeof(txn));
+        if (p->masquerade) {
+            size_t q = 0;
+            if (user)
+                q += (size_t)snprintf(query + q, sizeof(query) - q, "?user_id=%s", user);
+            if (m->ts_ms > 0 && q < sizeof(query))
+                snprintf(query + q, sizeof(query) - q, "%cts=%lld", q ? '&' : '?', (long long)m->ts_ms);
+        }
+        json_object *content = json_object_new_object();
+        json_object_object_add(content, "msgtype", json_object_new_string(m->msgtype ? m->msgtype : "m.text"));
+        json_object_object_add(content, "body", json_object_new_string(m->body ? m->body : ""));
+        if (p->cfg.origin)
+            json_object_object_add(content, WINEB2B_ORIGIN_FIELD, json_object_new_string(p->cfg.origin));
+        size_t blen;
+        const char *body = json_object_to_json_string_length(content, JSON_C_TO_STRING_PLAIN, &blen);
+        ret = out_printf(p, "PUT %s/_matrix/client/v3/rooms/%s/send/m.room.message/%s%s HTTP/1.1\r\n"
+                            "Host: %s\r\nAuthorization: Bearer %s\r\nContent-Type: application/json\r\n"
+                            "Content-Length: %zu\r\n\r\n%s",
+                         p->prefix, p->room, txn, query, p->host, p->token, blen, body);
+        json_object_put(content);
+    }
+    curl_free(user);
+    op->sent_us = now_us();
+    p->stats.requests++;
+    return ret;
+}
+
+/* Urutan request: join puppet tepat sebelum pesan pertamanya, lalu pesan */
+static int build_ops(struct pipeline* p, size_t count) {
+    p->ops = malloc(count * 2 * sizeof(struct op));
+    const char **joined = NULL;
+    size_t njoined = 0;
+    int join = p->masquerade && p->cfg.join_puppets;
+    if (join)
+        joined = malloc(count * sizeof(*joined));
+    if (!p->ops || (join && !joined)) {
+        free(joined);
+        return -1;
+    }
+    for (size_t i = 0; i < count; i++) {
+        const char *user = p->msgs[i].user_id;
+        if (join && user) {
+            size_t j = 0;
+            while (j < njoined && strcmp(joined[j], user) != 0)
+                j++;
+            if (j == njoined) {
+                joined[njoined++] = user;
+                p->ops[p->nops++] = (struct op){ OP_JOIN, i, 0, 0, 0, 0 };
+            }
+        }
+        p->ops[p->nops++] = (struct op){ OP_SEND, i, 0, 0, 0, 0 };
+    }
+    free(joined);
+    return 0;
+}
+
+/* --- Koneksi --- */
+
+/* Menutup koneksi; request yang belum dijawab dikirim ulang di koneksi berikutnya */
+static void drop_connection(struct pipeline* p) {
+    if (p->curl)
+        curl_easy_cleanup(p->curl);
+    p->curl = NULL;
+    p->out_len = p->out_off = 0;
+    p->in_len = 0;
+    p->draining = 0;
+    p->next_send = p->next_recv = p->next_ack;
+}
+
+static int open_connection(struct pipeline* p) {
+    drop_connection(p);
+    CURL *curl = curl_easy_init();
+    if (!curl)
+        return -1;
+    curl_easy_setopt(curl, CURLOPT_URL, p->handle->homeserver);
+    curl_easy_setopt(curl, CURLOPT_CONNECT_ONLY, 1L);
+    curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, CONNECT_TIMEOUT_S);
+    uint64_t start = now_us();
+    CURLcode res = curl_easy_perform(curl);
+    curl_socket_t fd = CURL_SOCKET_BAD;
+    if (res == CURLE_OK)
+        res = curl_easy_getinfo(curl, CURLINFO_ACTIVESOCKET, &fd);
+    if (res != CURLE_OK || fd == CURL_SOCKET_BAD) {
+        fprintf(stderr, "Error: import gagal terhubung ke homeserver: %s\n", curl_easy_strerror(res));
+        WINEB2B_metrics_add(p->handle->metrics, WINEB2B_METRIC_HTTP_ERRORS, 1);
+        curl_easy_cleanup(curl);
+        return -1;
+    }
+    WINEB2B_metrics_record(p->handle->metrics, WINEB2B_METRIC_HTTP_CONNECT, now_us() - start);
+    if (p->stats.connections++ > 0)
+        WINEB2B_metrics_add(p->handle->metrics, WINEB2B_METRIC_RECONNECTS, 1);
+    p->curl = curl;
+    p->fd = fd;
+    return 0;
+}
+
+/* --- Respons --- */
+
+/* Satu respons lengkap di awal buf. 1 jika lengkap, 0 jika perlu data lagi, -1 jika rusak */
+static int parse_response(const char* buf, size_t len, long* status, size_t* consumed, int* close_after) {
+    const char *end = memmem(buf, len, "\r\n\r\n", 4);
+    if (!end)
+        return len > MAX_HEADER ? -1 : 0;
+    if (sscanf(buf, "HTTP/%*d.%*d %ld", status) != 1)
+        return -1;
+    size_t head = (size_t)(end - buf) + 4;
+    long clen = -1;
+    int chunked = 0;
+    *close_after = 0;
+    for (const char *line = strstr(buf, "\r\n") + 2; line < end; line = strstr(line, "\r\n") + 2) {
+        if (strncasecmp(line, "Content-Length:", 15) == 0)
+            clen = strtol(line + 15, NULL, 10);
+        else if (strncasecmp(line, "Transfer-Encoding:", 18) == 0)
+            chunked = strncasecmp(line + 18 + strspn(line + 18, " "), "chunked", 7) == 0;
+        else if (strncasecmp(line, "Connection:", 11) == 0)
+            *close_after = strncasecmp(line + 11 + strspn(line + 11, " "), "close", 5) == 0;
+    }
+    if (chunked) {
+        size_t pos = head;
+        for (;;) {
+            const char *crlf = memmem(buf + pos, len - pos, "\r\n", 2);
+            if (!crlf)
+                return 0;
+            size_t size = strtoul(buf + pos, NULL, 16);
+            pos = (size_t)(crlf - buf) + 2;
+            if (size == 0) {
+                /* Tanpa trailer: "\r\n"; dengan trailer: sampai baris kosong */
+                if (len - pos >= 2 && memcmp(buf + pos, "\r\n", 2) == 0) {
+                    *consumed = pos + 2;
+                    return 1;
+                }
+                const char *fin = memmem(buf + pos, len - pos, "\r\n\r\n", 4);
+                if (!fin)
+                    return 0;
+                *consumed = (size_t)(fin - buf) + 4;
+                return 1;
+            }
+            if (pos + size + 2 > len)
+                return 0;
+            pos += size + 2;
+        }
+    }
+    if (clen < 0) {
+        /* Body sampai koneksi ditutup tidak dipakai untuk pipelining */
+        clen = 0;
+        if (*status >= 200 && *status != 204 && *status != 304)
+            *close_after = 1;
+    }
+    if (head + (size_t)clen > len)
+        return 0;
+    *consumed = head + (size_t)clen;
+    return 1;
+}
+
+static long retry_after(const char* response, size_t len) {
+    const char *p = memmem(response, len, "\"retry_after_ms\"", 16);
+    if (!p)
+        return 1000;
+    p = strchr(p + 16, ':');
+    return p ? strtol(p + 1, NULL, 10) : 1000;
+}
+
+static long backoff(unsigned attempt) {
+    return 100L << (attempt < 5 ? attempt : 5);
+}
+
+/* Jawaban final untuk op; next_ack melewati op yang sudah done */
+static void finish_op(struct pipeline* p, struct op* op, int ok) {
+    op->done = 1;
+    if (ok && op->kind == OP_SEND) {
+        p->stats.sent++;
+        if (op->overtaken)
+            p->stats.reordered++;
+        WINEB2B_metrics_add(p->handle->metrics, WINEB2B_METRIC_SENDS_DONE, 1);
+    } else if (ok) {
+        p->stats.joins++;
+    } else if (op->kind == OP_SEND) {
+        p->stats.failed++;
+        WINEB2B_metrics_add(p->handle->metrics, WINEB2B_METRIC_SENDS_FAILED, 1);
+    }
+    while (p->next_ack < p->nops && p->ops[p->next_ack].done)
+        p->next_ack++;
+}
+
+/* Satu percobaan op gagal sementara. 0 jika masih boleh dicoba lagi */
+static int fail_attempt(struct pipeline* p, struct op* op) {
+    if (++op->attempts > p->cfg.max_retries) {
+        finish_op(p, op, 0);
+        return -1;
+    }
+    p->stats.retries++;
+    return 0;
+}
+
+/* Koneksi gagal: dicoba lagi dari op pertama yang belum done di koneksi
+   baru setelah delay, atau op itu dianggap gagal jika percobaan habis */
+static void retry_op(struct pipeline* p, long delay) {
+    if (fail_attempt(p, &p->ops[p->next_ack]) != 0)
+        delay = 0;
+    drop_connection(p);
+    if (delay > 0)
+        sleep_ms(delay);
+}
+
+/* Memproses respons yang sudah lengkap. 0 jika perlu menunggu data lagi,
+   selain itu status pipeline berubah (koneksi ditutup atau pengiriman ulang
+   siap dimulai) */
+static int consume_responses(struct pipeline* p) {
+    size_t off = 0;
+    if (!p->in)
+        return 0;
+    while (p->next_recv < p->next_send) {
+        long status = 0;
+        size_t consumed = 0;
+        int close_after = 0;
+        int r = parse_response(p->in + off, p->in_len - off, &status, &consumed, &close_after);
+        if (r == 0)
+            break;
+        if (r < 0) {
+            retry_op(p, backoff(p->ops[p->next_ack].attempts));
+            return -1;
+        }
+        if (status == 100) {
+            off += consumed;
+            continue;
+        }
+        struct op *op = &p->ops[p->next_recv];
+        WINEB2B_metrics *metrics = p->handle->metrics;
+        WINEB2B_metrics_add(metrics, WINEB2B_METRIC_HTTP_REQUESTS, 1);
+        WINEB2B_metrics_add(metrics, WINEB2B_METRIC_BYTES_IN, consumed);
+        WINEB2B_metrics_record(metrics, WINEB2B_METRIC_HTTP_TOTAL, now_us() - op->sent_us);
+        if (status >= 400)
+            WINEB2B_metrics_add(metrics, WINEB2B_METRIC_HTTP_ERRORS, 1);
+        if (status == 429 || status >= 500) {
+            /* Request sesudahnya mungkin sudah diproses. Jawabannya
+               ditunggu supaya yang berhasil tidak dikirim ulang */
+            long delay = status == 429 ? retry_after(p->in + off, consumed) : backoff(op->attempts);
+            if (!p->draining) {
+                p->draining = 1;
+                p->drain_delay = 0;
+                p->hold = p->next_recv + 1;
+            }
+            if (delay > p->drain_delay)
+                p->drain_delay = delay;
+            fail_attempt(p, op);
+        } else {
+            int ok = status >= 200 && status < 300;
+            /* Op gagal sebelumnya yang masih akan dikirim ulang sudah didahului */
+            if (ok && p->draining)
+                for (size_t i = p->hold - 1; i < p->next_recv; i++)
+                    if (!p->ops[i].done)
+                        p->ops[i].overtaken = 1;
+            finish_op(p, op, ok);
+        }
+        p->next_recv++;
+        while (p->next_recv < p->next_send && p->ops[p->next_recv].done)
+            p->next_recv++;
+        off += consumed;
+        if (close_after) {
+            long delay = p->draining ? p->drain_delay : 0;
+            drop_connection(p);
+            if (delay > 0)
+                sleep_ms(delay);
+            return -1;
+        }
+    }
+    memmove(p->in, p->in + off, p->in_len - off);
+    p->in_len -= off;
+    p->in[p->in_len] = '\0';
+    if (p->draining && p->next_recv == p->next_send) {
+        /* Semua jawaban sudah masuk: ulangi dari op gagal pertama di koneksi yang sama */
+        p->draining = 0;
+        p->next_send = p->next_recv = p->next_ack;
+        if (p->drain_delay > 0)
+            sleep_ms(p->drain_delay);
+        return 1;
+    }
+    return 0;
+}
+
+/* Satu putaran I/O: menulis request tertunda dan membaca respons.
+   1 jika ada kemajuan, 0 jika perlu menunggu socket, -1 jika koneksi putus */
+static int pump(struct pipeline* p) {
+    int progress = 0;
+    while (p->out_off < p->out_len) {
+        size_t n = 0;
+        CURLcode res = curl_easy_send(p->curl, p->out + p->out_off, p->out_len - p->out_off, &n);
+        if (res == CURLE_AGAIN)
+            break;
+        if (res != CURLE_OK)
+            return -1;
+        p->out_off += n;
+        WINEB2B_metrics_add(p->handle->metrics, WINEB2B_METRIC_BYTES_OUT, n);
+        progress = 1;
+    }
+    if (p->out_off == p->out_len)
+        p->out_off = p->out_len = 0;
+    for (;;) {
+        if (p->in_cap - p->in_len < RECV_CHUNK + 1) {
+            size_t cap = p->in_cap ? p->in_cap * 2 : RECV_CHUNK * 4;
+            char *in = realloc(p->in, cap);
+            if (!in)
+                return -1;
+            p->in = in;
+            p->in_cap = cap;
+        }
+        size_t n = 0;
+        CURLcode res = curl_easy_recv(p->curl, p->in + p->in_len, RECV_CHUNK, &n);
+        if (res == CURLE_AGAIN)
+            break;
+        if (res != CURLE_OK || n == 0)
+            return -1;
+        p->in_len += n;
+        p->in[p->in_len] = '\0';
+        progress = 1;
+    }
+    return progress;
+}
+
+static void free_pipeline(struct pipeline* p) {
+    if (p->curl)
+        curl_easy_cleanup(p->curl);
+    curl_free(p->room);
+    free(p->ops);
+    free(p->out);
+    free(p->in);
+}
+
+/* Mengimpor pesan lewat pipeline HTTP/1.1 (lihat matrix_driver.h) */
+WINEMATRIXcode
+long WINEMATRIX_import_messages(WINEMATRIX_handle* handle, const char* room_id,
+                                const WINEMATRIX_import_message* messages, size_t count,
+                                const WINEMATRIX_import_config* config, WINEMATRIX_import_stats* stats) {
+    if (stats)
+        memset(stats, 0, sizeof(*stats));
+    if (!handle || !handle->homeserver || !room_id || (!messages && count > 0))
+        return -1;
+    if (count == 0)
+        return 0;
+    struct pipeline p;
+    memset(&p, 0, sizeof(p));
+    p.handle = handle;
+    p.msgs = messages;
+    p.room_id = room_id;
+    if (config)
+        p.cfg = *config;
+    if (!p.cfg.window)
+        p.cfg.window = DEFAULT_WINDOW;
+    if (!config || !config->max_retries)
+        p.cfg.max_retries = MAX_RETRIES;
+    p.masquerade = p.cfg.as_token != NULL;
+    p.token = p.masquerade ? p.cfg.as_token : handle->access_token;
+    if (!p.token || split_homeserver(&p, handle->homeserver) != 0) {
+        fprintf(stderr, "Error: import membutuhkan homeserver dan token yang valid\n");
+        return -1;
+    }
+    p.room = curl_easy_escape(NULL, room_id, 0);
+    if (!p.room || build_ops(&p, count) != 0) {
+        free_pipeline(&p);
+        return -1;
+    }
+    WINEB2B_metrics_add(handle->metrics, WINEB2B_METRIC_SENDS_QUEUED, count);
+
+    uint64_t start = now_us();
+    long result = 0;
+    while (p.next_ack < p.nops) {
+        if (!p.curl && open_connection(&p) != 0) {
+            struct op *op = &p.ops[p.next_ack];
+            if (++op->attempts > p.cfg.max_retries) {
+                result = -1;
+                break;
+            }
+            sleep_ms(backoff(op->attempts));
+            continue;
+        }
+        /* Isi pipeline sampai window request belum dijawab. Setelah 429/5xx
+           op gagal dikirim sendiri dulu supaya tidak didahului lagi */
+        size_t window = p.next_ack < p.hold ? 1 : p.cfg.window;
+        while (!p.draining && p.next_send < p.nops && p.next_send - p.next_recv < window) {
+            /* Sudah diterima sebelum pengulangan: dilewati */
+            if (p.ops[p.next_send].done) {
+                if (p.next_recv == p.next_send)
+                    p.next_recv++;
+                p.next_send++;
+                continue;
+            }
+            if (append_request(&p, &p.ops[p.next_send]) != 0)
+                break;
+            p.next_send++;
+        }
+        int progress = pump(&p);
+        if (progress < 0) {
+            if (p.next_recv < p.next_send)
+                retry_op(&p, backoff(p.ops[p.next_ack].attempts));
+            else
+                drop_connection(&p);
+            continue;
+        }
+        if (consume_responses(&p) != 0 || progress)
+            continue;
+        struct pollfd pfd = { p.fd, POLLIN | (p.out_len > p.out_off ? POLLOUT : 0), 0 };
+        int n = poll(&pfd, 1, IO_TIMEOUT_MS);
+        if (n == 0)
+            retry_op(&p, 0);    /* Homeserver tidak menjawab: koneksi baru */
+        else if (n < 0 && errno != EINTR)
+            retry_op(&p, backoff(p.ops[p.next_ack].attempts));
+    }
+    p.stats.seconds = (double)(now_us() - start) / 1e6;
+    if (result == 0)
+        result = (long)p.stats.sent;
+    else
+        p.stats.failed += count - p.stats.sent - p.stats.failed;
+    if (stats)
+        *stats = p.stats;
+    free_pipeline(&p);
+    return result;
+}
@@ -0,0 +1,45 @@
+#ifndef MATRIX_INTERNAL_H
+#define MATRIX_INTERNAL_H
+
+/* Header internal untuk modul-modul di source/berry/matrix.
+   Tidak diekspor sebagai API publik. */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <curl/curl.h>
+#include "metrics.h"
+
+/* Struktur untuk menampung respons dari libcurl */
+struct MemoryStruct {
+    char *memory;
+    size_t size;
+    long status;    /* Status HTTP respons, 0 jika gagal di transport */
+};
+
+/**
+ * @brief Fungsi helper untuk melakukan HTTP request dengan libcurl.
+ *
+ * Durasi fase request (DNS, connect, TLS, byte pertama, total), byte
+ * masuk/keluar dan jumlah request/error dicatat ke metrics.
+ *
+ * @param metrics Metrik handle (boleh NULL).
+ * @param url URL tujuan request.
+ * @param json_data Data JSON (jika ada) yang akan dikirim.
+ * @param http_method Metode HTTP ("GET", "POST" atau "PUT").
+ * @param chunk Pointer ke struktur MemoryStruct untuk menyimpan respons.
+ * @return int 0 jika berhasil, -1 jika terjadi kesalahan.
+ */
+int perform_http_request(WINEB2B_metrics *metrics, const char *url, const char *json_data, const char *http_method, struct MemoryStruct *chunk);
+
+/**
+ * @brief Mencatat satu request curl yang sudah selesai ke metrik dan trace.
+ *
+ * Dipakai request yang tidak lewat perform_http_request (misal media yang
+ * streaming dengan callback sendiri).
+ *
+ * @param trace_start Waktu mulai dari WINEB2B_trace_now(), 0 jika tidak di-trace.
+ */
+void record_http_request(WINEB2B_metrics *metrics, CURL *curl, CURLcode res, long status, const char *method,
+                         const char *url, uint64_t trace_start);
+
+#endif /* MATRIX_INTERNAL_H */
@@ -0,0 +1,1069 @@
+#define _GNU_SOURCE
+#include "matrix_media.h"
+#include "matrix_driver.h"
+#include "matrix_internal.h"
+#include "trace.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/stat.h>
+#include <curl/curl.h>
+#include <json-c/json.h>
+#include <openssl/evp.h>
+
+#define UPLOAD_URL_FORMAT   "%s/_matrix/media/v3/upload?access_token=%s"
+#define DOWNLOAD_URL_FORMAT "%s/_matrix/media/v3/download/%s/%s?access_token=%s"
+
+#define DEFAULT_MAX_BYTES   (1ULL << 30)
+#define IO_CHUNK            (128 * 1024)    /* Buffer baca/salin per operasi */
+#define MAX_RETRIES         5
+#define MAX_ERROR_BODY      4096            /* Body respons error yang disimpan (retry_after_ms) */
+#define SHA_LEN             32
+#define HEX_LEN             (SHA_LEN * 2)
+#define OBJECTS_DIR         "objects"
+#define URIS_FILE           "uris"
+
+/* Satu file media di cache */
+struct object {
+    unsigned char sha[SHA_LEN];
+    uint64_t size;
+    int64_t used;               /* mtime file (ns), hanya untuk mengurutkan saat dibuka */
+    struct object *prev, *next; /* LRU, head = paling baru dipakai */
+    struct object *hnext;
+};
+
+/* Pemetaan sha256 <-> URI mxc, satu entri di dua tabel hash */
+struct uri {
+    unsigned char sha[SHA_LEN];
+    struct uri *uri_next, *sha_next;
+    char text[];
+};
+
+/* Upload/download yang sedang berjalan; request lain untuk kunci yang sama menunggu */
+struct inflight {
+    struct inflight *next;
+    char key[];                 /* "u<sha hex>" atau "d<mxc uri>" */
+};
+
+struct _WINEMATRIX_media {
+    char *objdir;
+    int uris_fd;
+    pthread_mutex_t lock;
+    pthread_cond_t done;
+    struct object **objects;
+    size_t objects_cap;
+    struct object *head, *tail;
+    struct uri **by_uri, **by_sha;
+    size_t uris_cap;
+    struct inflight *inflight;
+    WINEMATRIX_media_stats stats;
+};
+
+/* --- Hash dan tabel --- */
+
+static size_t sha_hash(const unsigned char* sha) {
+    size_t h;
+    memcpy(&h, sha, sizeof(h));
+    return h;
+}
+
+static size_t str_hash(const char* s) {
+    size_t h = 1469598103934665603ULL;
+    while (*s)
+        h = (h ^ (unsigned char)*s++) * 1099511628211ULL;
+    return h;
+}
+
+static void to_hex(const unsigned char* sha, char* out) {
+    static const char digits[] = "0123456789abcdef";
+    for (int i = 0; i < SHA_LEN; i++) {
+        out[2 * i] = digits[sha[i] >> 4];
+        out[2 * i + 1] = digits[sha[i] & 15];
+    }
+    out[HEX_LEN] = '\0';
+}
+
+static int from_hex(const char* hex, unsigned char* sha) {
+    for (int i = 0; i < HEX_LEN; i++) {
+        char c = hex[i];
+        int v = c >= '0' && c <= '9' ? c - '0' : c >= 'a' && c <= 'f' ? c - 'a' + 10 : -1;
+        if (v < 0)
+            return -1;
+        if (i & 1)
+            sha[i / 2] |= (unsigned char)v;
+        else
+            sha[i / 2] = (unsigned char)(v << 4);
+    }
+    return 0;
+}
+
+static struct object* object_find(WINEMATRIX_media* m, const unsigned char* sha) {
+    struct object *o = m->objects[sha_hash(sha) & (m->objects_cap - 1)];
+    while (o && memcmp(o->sha, sha, SHA_LEN) != 0)
+        o = o->hnext;
+    return o;
+}
+
+static int object_insert(WINEMATRIX_media* m, struct object* o) {
+    if (m->stats.objects + 1 > m->objects_cap) {
+        size_t cap = m->objects_cap * 2;
+        struct object **table = calloc(cap, sizeof(*table));
+        if (!table)
+            return -1;
+        for (size_t i = 0; i < m->objects_cap; i++) {
+            for (struct object *p = m->objects[i], *next; p; p = next) {
+                next = p->hnext;
+                p->hnext = table[sha_hash(p->sha) & (cap - 1)];
+                table[sha_hash(p->sha) & (cap - 1)] = p;
+            }
+        }
+        free(m->objects);
+        m->objects = table;
+        m->objects_cap = cap;
+    }
+    struct object **slot = &m->objects[sha_hash(o->sha) & (m->objects_cap - 1)];
+    o->hnext = *slot;
+    *slot = o;
+    m->stats.objects++;
+    m->stats.bytes += o->size;
+    return 0;
+}
+
+static void lru_unlink(WINEMATRIX_media* m, struct object* o) {
+    if (o->prev)
+        o->prev->next = o->next;
+    else
+        m->head = o->next;
+    if (o->next)
+        o->next->prev = o->prev;
+    else
+        m->tail = o->prev;
+    o->prev = o->next = NULL;
+}
+
+static void lru_push_front(WINEMATRIX_media* m, struct object* o) {
+    o->prev = NULL;
+    o->next = m->head;
+    if (m->head)
+        m->head->prev = o;
+    else
+        m->tail = o;
+    m->head = o;
+}
+
+static void object_path(const WINEMATRIX_media* m, const unsigned char* sha, char* path, size_t size) {
+    char hex[HEX_LEN + 1];
+    to_hex(sha, hex);
+    snprintf(path, size, "%s/%s", m->objdir, hex);
+}
+
+/* Mengeluarkan objek dari tabel dan LRU. unlink_file 0 jika file sudah tidak ada */
+static void object_remove(WINEMATRIX_media* m, struct object* o, int unlink_file) {
+    struct object **slot = &m->objects[sha_hash(o->sha) & (m->objects_cap - 1)];
+    while (*slot != o)
+        slot = &(*slot)->hnext;
+    *slot = o->hnext;
+    lru_unlink(m, o);
+    if (unlink_file) {
+        char path[4096];
+        object_path(m, o->sha, path, sizeof(path));
+        unlink(path);
+    }
+    m->stats.objects--;
+    m->stats.bytes -= o->size;
+    free(o);
+}
+
+/* Membuang objek yang paling lama tidak dipakai sampai di bawah batas. keep tidak dibuang */
+static void evict(WINEMATRIX_media* m, const struct object* keep) {
+    while (m->stats.bytes > m->stats.max_bytes && m->tail && m->tail != keep) {
+        object_remove(m, m->tail, 1);
+        m->stats.evictions++;
+    }
+    /* Objek yang sendirian lebih besar dari batas juga dibuang; fd yang sudah dibuka tetap valid */
+    if (keep && m->stats.bytes > m->stats.max_bytes && m->tail == keep) {
+        object_remove(m, m->tail, 1);
+        m->stats.evictions++;
+    }
+}
+
+static struct uri* uri_find(const WINEMATRIX_media* m, const char* text) {
+    struct uri *u = m->by_uri[str_hash(text) & (m->uris_cap - 1)];
+    while (u && strcmp(u->text, text) != 0)
+        u = u->uri_next;
+    return u;
+}
+
+static struct uri* uri_find_sha(const WINEMATRIX_media* m, const unsigned char* sha) {
+    struct uri *u = m->by_sha[sha_hash(sha) & (m->uris_cap - 1)];
+    while (u && memcmp(u->sha, sha, SHA_LEN) != 0)
+        u = u->sha_next;
+    return u;
+}
+
+static int uri_insert(WINEMATRIX_media* m, const unsigned char* sha, const char* text) {
+    if (m->stats.uris + 1 > m->uris_cap) {
+        size_t cap = m->uris_cap * 2;
+        struct uri **by_uri = calloc(cap, sizeof(*by_uri)), **by_sha = calloc(cap, sizeof(*by_sha));
+        if (!by_uri || !by_sha) {
+            free(by_uri);
+            free(by_sha);
+            return -1;
+        }
+        for (size_t i = 0; i < m->uris_cap; i++) {
+            for (struct uri *u = m->by_uri[i], *next; u; u = next) {
+                next = u->uri_next;
+                u->uri_next = by_uri[str_hash(u->text) & (cap - 1)];
+                by_uri[str_hash(u->text) & (cap - 1)] = u;
+                u->sha_next = by_sha[sha_hash(u->sha) & (cap - 1)];
+                by_sha[sha_hash(u->sha) & (cap - 1)] = u;
+            }
+        }
+        free(m->by_uri);
+        free(m->by_sha);
+        m->by_uri = by_uri;
+        m->by_sha = by_sha;
+        m->uris_cap = cap;
+    }
+    size_t len = strlen(text);
+    struct uri *u = malloc(sizeof(*u) + len + 1);
+    if (!u)
+        return -1;
+    memcpy(u->sha, sha, SHA_LEN);
+    memcpy(u->text, text, len + 1);
+    struct uri **slot = &m->by_uri[str_hash(text) & (m->uris_cap - 1)];
+    u->uri_next = *slot;
+    *slot = u;
+    slot = &m->by_sha[sha_hash(sha) & (m->uris_cap - 1)];
+    u->sha_next = *slot;
+    *slot = u;
+    m->stats.uris++;
+    return 0;
+}
+
+/* Mencatat pemetaan baru ke file uris (satu write per baris) lalu ke tabel */
+static int uri_record(WINEMATRIX_media* m, const unsigned char* sha, const char* text) {
+    if (uri_find(m, text))
+        return 0;
+    char line[HEX_LEN + 2];
+    to_hex(sha, line);
+    size_t len = strlen(text);
+    char *rec = malloc(HEX_LEN + len + 3);
+    if (!rec)
+        return -1;
+    memcpy(rec, line, HEX_LEN);
+    rec[HEX_LEN] = ' ';
+    memcpy(rec + HEX_LEN + 1, text, len);
+    rec[HEX_LEN + 1 + len] = '\n';
+    ssize_t n;
+    do
+        n = write(m->uris_fd, rec, HEX_LEN + len + 2);
+    while (n < 0 && errno == EINTR);
+    free(rec);
+    if (n != (ssize_t)(HEX_LEN + len + 2)) {
+        perror("Gagal menulis pemetaan media");
+        return -1;
+    }
+    return uri_insert(m, sha, text);
+}
+
+/* --- Permintaan bersamaan untuk kunci yang sama --- */
+
+/* Menunggu request lain dengan kunci yang sama selesai. Dipanggil dengan lock */
+static void inflight_wait(WINEMATRIX_media* m, const char* key) {
+    for (;;) {
+        struct inflight *f = m->inflight;
+        while (f && strcmp(f->key, key) != 0)
+            f = f->next;
+        if (!f)
+            return;
+        pthread_cond_wait(&m->done, &m->lock);
+    }
+}
+
+static struct inflight* inflight_add(WINEMATRIX_media* m, const char* key) {
+    size_t len = strlen(key);
+    struct inflight *f = malloc(sizeof(*f) + len + 1);
+    if (!f)
+        return NULL;
+    memcpy(f->key, key, len + 1);
+    f->next = m->inflight;
+    m->inflight = f;
+    return f;
+}
+
+static void inflight_done(WINEMATRIX_media* m, struct inflight* f) {
+    if (!f)
+        return;
+    pthread_mutex_lock(&m->lock);
+    struct inflight **p = &m->inflight;
+    while (*p != f)
+        p = &(*p)->next;
+    *p = f->next;
+    pthread_cond_broadcast(&m->done);
+    pthread_mutex_unlock(&m->lock);
+    free(f);
+}
+
+/* --- Membuka cache --- */
+
+static int load_uris(WINEMATRIX_media* m, const char* path) {
+    m->uris_fd = open(path, O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0600);
+    if (m->uris_fd < 0) {
+        perror("Gagal membuka pemetaan media");
+        return -1;
+    }
+    FILE *fp = fdopen(dup(m->uris_fd), "r");
+    if (!fp)
+        return -1;
+    char *line = NULL;
+    size_t cap = 0;
+    ssize_t len;
+    off_t valid = 0;
+    int ret = 0;
+    while (ret == 0 && (len = getline(&line, &cap, fp)) > 0) {
+        /* Baris terakhir tanpa newline berasal dari write yang terpotong */
+        if (line[len - 1] != '\n')
+            break;
+        valid += len;
+        line[len - 1] = '\0';
+        unsigned char sha[SHA_LEN];
+        if (len < HEX_LEN + 2 + 6 || line[HEX_LEN] != ' ' || from_hex(line, sha) != 0 ||
+            strncmp(line + HEX_LEN + 1, "mxc://", 6) != 0)
+            continue;
+        if (!uri_find(m, line + HEX_LEN + 1))
+            ret = uri_insert(m, sha, line + HEX_LEN + 1);
+    }
+    free(line);
+    fclose(fp);
+    if (ret == 0 && ftruncate(m->uris_fd, valid) != 0)
+        ret = -1;
+    return ret;
+}
+
+static int cmp_used_desc(const void* a, const void* b) {
+    const struct object *x = *(struct object* const*)a, *y = *(struct object* const*)b;
+    return x->used < y->used ? 1 : x->used > y->used ? -1 : 0;
+}
+
+static int load_objects(WINEMATRIX_media* m) {
+    DIR *d = opendir(m->objdir);
+    if (!d)
+        return -1;
+    struct object **list = NULL;
+    size_t n = 0, cap = 0;
+    int ret = 0;
+    struct dirent *e;
+    while (ret == 0 && (e = readdir(d)) != NULL) {
+        if (strncmp(e->d_name, "tmp.", 4) == 0) {
+            /* Upload/download yang terputus */
+            unlinkat(dirfd(d), e->d_name, 0);
+            continue;
+        }
+        unsigned char sha[SHA_LEN];
+        struct stat st;
+        if (strlen(e->d_name) != HEX_LEN || from_hex(e->d_name, sha) != 0 ||
+            fstatat(dirfd(d), e->d_name, &st, 0) != 0 || !S_ISREG(st.st_mode))
+            continue;
+        if (n == cap) {
+            cap = cap ? cap * 2 : 64;
+            struct object **p = realloc(list, cap * sizeof(*list));
+            if (!p) {
+                ret = -1;
+                break;
+            }
+            list = p;
+        }
+        struct object *o = calloc(1, sizeof(*o));
+        if (!o) {
+            ret = -1;
+            break;
+        }
+        memcpy(o->sha, sha, SHA_LEN);
+        o->size = (uint64_t)st.st_size;
+        o->used = (int64_t)st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec;
+        list[n++] = o;
+    }
+    closedir(d);
+    if (n > 1)
+        qsort(list, n, sizeof(*list), cmp_used_desc);
+    for (size_t i = 0; i < n; i++) {
+        if (ret == 0 && object_insert(m, list[i]) == 0) {
+            list[i]->prev = m->tail;
+            if (m->tail)
+                m->tail->next = list[i];
+            else
+                m->head = list[i];
+            m->tail = list[i];
+        } else {
+            ret = -1;
+            free(list[i]);
+        }
+    }
+    free(list);
+    return ret;
+}
+
+/* Membuka (atau membuat) cache media */
+WINEMATRIXcode
+WINEMATRIX_media* WINEMATRIX_media_open(const char* dir, uint64_t max_bytes)
+{
+    WINEMATRIX_media *m = calloc(1, sizeof(*m));
+    size_t dir_len = strlen(dir);
+    char *uris_path = malloc(dir_len + sizeof(URIS_FILE) + 1);
+    if (!m || !uris_path) {
+        free(m);
+        free(uris_path);
+        return NULL;
+    }
+    snprintf(uris_path, dir_len + sizeof(URIS_FILE) + 1, "%s/%s", dir, URIS_FILE);
+    m->objdir = malloc(dir_len + sizeof(OBJECTS_DIR) + 1);
+    m->uris_fd = -1;
+    m->objects_cap = m->uris_cap = 64;
+    m->objects = calloc(m->objects_cap, sizeof(*m->objects));
+    m->by_uri = calloc(m->uris_cap, sizeof(*m->by_uri));
+    m->by_sha = calloc(m->uris_cap, sizeof(*m->by_sha));
+    m->stats.max_bytes = max_bytes ? max_bytes : DEFAULT_MAX_BYTES;
+    pthread_mutex_init(&m->lock, NULL);
+    pthread_cond_init(&m->done, NULL);
+    if (!m->objdir || !m->objects || !m->by_uri || !m->by_sha) {
+        free(uris_path);
+        WINEMATRIX_media_close(m);
+        return NULL;
+    }
+    snprintf(m->objdir, dir_len + sizeof(OBJECTS_DIR) + 1, "%s/%s", dir, OBJECTS_DIR);
+    if ((mkdir(dir, 0700) != 0 && errno != EEXIST) || (mkdir(m->objdir, 0700) != 0 && errno != EEXIST)) {
+        fprintf(stderr, "Error: gagal membuat direktori cache media %s: %s\n", dir, strerror(errno));
+        free(uris_path);
+        WINEMATRIX_media_close(m);
+        return NULL;
+    }
+    int ret = load_uris(m, uris_path);
+    free(uris_path);
+    if (ret != 0 || load_objects(m) != 0) {
+        fprintf(stderr, "Error: gagal memuat cache media %s\n", dir);
+        WINEMATRIX_media_close(m);
+        return NULL;
+    }
+    evict(m, NULL);
+    return m;
+}
+
+WINEMATRIXcode
+void WINEMATRIX_media_get_stats(WINEMATRIX_media* media, WINEMATRIX_media_stats* out)
+{
+    pthread_mutex_lock(&media->lock);
+    *out = media->stats;
+    pthread_mutex_unlock(&media->lock);
+}
+
+/* Menutup cache */
+WINEMATRIXcode
+void WINEMATRIX_media_close(WINEMATRIX_media* media)
+{
+    if (!media)
+        return;
+    for (struct object *o = media->head, *next; o; o = next) {
+        next = o->next;
+        free(o);
+    }
+    for (size_t i = 0; media->by_uri && i < media->uris_cap; i++) {
+        for (struct uri *u = media->by_uri[i], *next; u; u = next) {
+            next = u->uri_next;
+            free(u);
+        }
+    }
+    if (media->uris_fd >= 0)
+        close(media->uris_fd);
+    pthread_mutex_destroy(&media->lock);
+    pthread_cond_destroy(&media->done);
+    free(media->objects);
+    free(media->by_uri);
+    free(media->by_sha);
+    free(media->objdir);
+    free(media);
+}
+
+/* --- Akses objek --- */
+
+/* mtime menyimpan urutan LRU untuk pembukaan berikutnya. Waktu diisi sendiri:
+   UTIME_NOW memakai jam kasar kernel sehingga pemakaian berdekatan bisa seri */
+static void mark_used(int fd) {
+    struct timespec times[2] = { { 0, UTIME_OMIT }, { 0, 0 } };
+    clock_gettime(CLOCK_REALTIME, &times[1]);
+    futimens(fd, times);
+}
+
+/* Membuka objek untuk dibaca dan menandainya baru dipakai. Dipanggil dengan lock.
+   -1 jika objek tidak ada (file yang hilang dari luar dikeluarkan dari cache) */
+static int object_open(WINEMATRIX_media* m, struct object* o) {
+    char path[4096];
+    object_path(m, o->sha, path, sizeof(path));
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        object_remove(m, o, 0);
+        return -1;
+    }
+    mark_used(fd);
+    lru_unlink(m, o);
+    lru_push_front(m, o);
+    return fd;
+}
+
+/* Memasukkan file sementara di objdir sebagai objek sha. Dipanggil dengan lock.
+   Mengembalikan fd baca objek jika want_fd, 0 jika tidak, -1 jika gagal */
+static int object_adopt(WINEMATRIX_media* m, const char* tmp_path, const unsigned char* sha, uint64_t size,
+                        int want_fd) {
+    struct object *o = object_find(m, sha);
+    int fd = o ? object_open(m, o) : -1;
+    if (fd >= 0) {
+        /* Isi yang sama sudah ada (dari URI lain) */
+        unlink(tmp_path);
+        if (!want_fd)
+            close(fd);
+        return want_fd ? fd : 0;
+    }
+    char path[4096];
+    object_path(m, sha, path, sizeof(path));
+    o = calloc(1, sizeof(*o));
+    if (!o || rename(tmp_path, path) != 0) {
+        free(o);
+        unlink(tmp_path);
+        return -1;
+    }
+    memcpy(o->sha, sha, SHA_LEN);
+    o->size = size;
+    if (object_insert(m, o) != 0) {
+        free(o);
+        unlink(path);
+        return -1;
+    }
+    lru_push_front(m, o);
+    fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd >= 0)
+        mark_used(fd);
+    evict(m, o);
+    if (fd >= 0 && !want_fd) {
+        close(fd);
+        fd = 0;
+    }
+    return fd;
+}
+
+/* --- Hash dan salin isi --- */
+
+static EVP_MD_CTX* sha_begin(void) {
+    EVP_MD_CTX *ctx = EVP_MD_CTX_new();
+    if (ctx && EVP_DigestInit_ex(ctx, EVP_sha256(), NULL) != 1) {
+        EVP_MD_CTX_free(ctx);
+        return NULL;
+    }
+    return ctx;
+}
+
+static int sha_end(EVP_MD_CTX* ctx, unsigned char* sha) {
+    unsigned int len = 0;
+    int ok = EVP_DigestFinal_ex(ctx, sha, &len) == 1 && len == SHA_LEN;
+    EVP_MD_CTX_free(ctx);
+    return ok ? 0 : -1;
+}
+
+static int write_all(int fd, const char* data, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(fd, data, len);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return -1;
+        data += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+/* SHA-256 seluruh file dari offset 0 */
+static int hash_file(int fd, char* buf, unsigned char* sha, uint64_t* size) {
+    EVP_MD_CTX *ctx = sha_begin();
+    if (!ctx)
+        return -1;
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    uint64_t off = 0;
+    for (;;) {
+        ssize_t n = pread(fd, buf, IO_CHUNK, (off_t)off);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0) {
+            EVP_MD_CTX_free(ctx);
+            return -1;
+        }
+        if (n == 0)
+            break;
+        EVP_DigestUpdate(ctx, buf, (size_t)n);
+        off += (uint64_t)n;
+    }
+    *size = off;
+    return sha_end(ctx, sha);
+}
+
+/* Menyalin sumber yang tidak bisa di-seek ke out_fd sambil di-hash */
+static int stage_stream(int fd, int out_fd, char* buf, unsigned char* sha, uint64_t* size) {
+    EVP_MD_CTX *ctx = sha_begin();
+    if (!ctx)
+        return -1;
+    uint64_t total = 0;
+    for (;;) {
+        ssize_t n = read(fd, buf, IO_CHUNK);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0 || (n > 0 && write_all(out_fd, buf, (size_t)n) != 0)) {
+            EVP_MD_CTX_free(ctx);
+            return -1;
+        }
+        if (n == 0)
+            break;
+        EVP_DigestUpdate(ctx, buf, (size_t)n);
+        total += (uint64_t)n;
+    }
+    *size = total;
+    return sha_end(ctx, sha);
+}
+
+/* Menyalin size byte dari offset 0 fd ke out_fd, di kernel jika bisa */
+static int copy_file(int fd, int out_fd, char* buf, uint64_t size) {
+    loff_t in_off = 0;
+    while ((uint64_t)in_off < size) {
+        ssize_t n = copy_file_range(fd, &in_off, out_fd, NULL, (size_t)(size - (uint64_t)in_off), 0);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n > 0)
+            continue;
+        if (n == 0 || (errno != EXDEV && errno != ENOSYS && errno != EINVAL && errno != EOPNOTSUPP))
+            return -1;
+        /* Fallback read/write (filesystem berbeda pada kernel lama, dll.) */
+        while ((uint64_t)in_off < size) {
+            ssize_t r = pread(fd, buf, IO_CHUNK, in_off);
+            if (r < 0 && errno == EINTR)
+                continue;
+            if (r <= 0 || write_all(out_fd, buf, (size_t)r) != 0)
+                return -1;
+            in_off += r;
+        }
+    }
+    return 0;
+}
+
+/* File sementara baru di direktori objek (dihapus saat dibuka ulang jika tertinggal) */
+static int temp_object(const WINEMATRIX_media* m, char* path, size_t size) {
+    snprintf(path, size, "%s/tmp.XXXXXX", m->objdir);
+    int fd = mkostemp(path, O_CLOEXEC);
+    if (fd < 0)
+        perror("Gagal membuat file sementara media");
+    return fd;
+}
+
+/* --- HTTP --- */
+
+static void sleep_ms(long ms) {
+    struct timespec ts = { ms / 1000, (ms % 1000) * 1000000L };
+    while (nanosleep(&ts, &ts) != 0 && errno == EINTR)
+        ;
+}
+
+/* Waktu tunggu sebelum mencoba ulang, -1 jika kegagalan tidak perlu diulang */
+static long retry_delay(int ret, long status, const struct MemoryStruct* err, unsigned attempt) {
+    if (ret != 0 || status >= 500)
+        return 100L << (attempt < 5 ? attempt : 5);
+    if (status != 429)
+        return -1;
+    json_object *obj = err->size ? json_tokener_parse(err->memory) : NULL, *retry;
+    long wait = obj && json_object_object_get_ex(obj, "retry_after_ms", &retry) ? (long)json_object_get_int64(retry)
+                                                                             : 1000;
+    json_object_put(obj);
+    return wait;
+}
+
+static size_t collect_error(void* data, size_t size, size_t nmemb, void* user) {
+    struct MemoryStruct *err = user;
+    size_t n = size * nmemb, room = MAX_ERROR_BODY - err->size;
+    size_t take = n < room ? n : room;
+    memcpy(err->memory + err->size, data, take);
+    err->size += take;
+    err->memory[err->size] = '\0';
+    return n;
+}
+
+/* Menjalankan request dan mencatat metrik/trace. Mengembalikan 0 jika transport berhasil */
+static int perform_media(WINEMATRIX_handle* handle, CURL* curl, const char* method, const char* url, long* status) {
+    uint64_t start = WINEB2B_trace_current ? WINEB2B_trace_now() : 0;
+    CURLcode res = curl_easy_perform(curl);
+    *status = 0;
+    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, status);
+    record_http_request(handle->metrics, curl, res, *status, method, url, start);
+    if (res != CURLE_OK) {
+        fprintf(stderr, "curl_easy_perform() error: %s\n", curl_easy_strerror(res));
+        return -1;
+    }
+    return 0;
+}
+
+struct upload_source {
+    int fd;
+    uint64_t off, size;
+};
+
+static size_t read_source(char* buf, size_t size, size_t nitems, void* user) {
+    struct upload_source *src = user;
+    size_t want = size * nitems;
+    if (want > src->size - src->off)
+        want = (size_t)(src->size - src->off);
+    ssize_t n;
+    do
+        n = pread(src->fd, buf, want, (off_t)src->off);
+    while (n < 0 && errno == EINTR);
+    if (n < 0)
+        return CURL_READFUNC_ABORT;
+    src->off += (uint64_t)n;
+    return (size_t)n;
+}
+
+static int seek_source(void* user, curl_off_t offset, int origin) {
+    struct upload_source *src = user;
+    if (origin != SEEK_SET || offset < 0 || (uint64_t)offset > src->size)
+        return CURL_SEEKFUNC_CANTSEEK;
+    src->off = (uint64_t)offset;
+    return CURL_SEEKFUNC_OK;
+}
+
+/* POST isi fd ke /upload. Mengembalikan URI mxc (dialokasikan), NULL jika gagal */
+static char* post_upload(WINEMATRIX_handle* handle, int fd, uint64_t size, const char* content_type,
+                         const char* filename) {
+    CURL *curl = curl_easy_init();
+    char *name = filename ? curl_easy_escape(curl, filename, 0) : NULL;
+    size_t url_len = strlen(handle->homeserver) + strlen(handle->access_token) + (name ? strlen(name) : 0) + 64;
+    char *url = malloc(url_len);
+    char type[256];
+    snprintf(type, sizeof(type), "Content-Type: %s", content_type ? content_type : "application/octet-stream");
+    struct curl_slist *headers = curl_slist_append(NULL, type);
+    /* Body langsung dikirim, tanpa menunggu 100 Continue */
+    headers = headers ? curl_slist_append(headers, "Expect:") : NULL;
+    char *uri = NULL;
+    if (!curl || !url || !headers || (filename && !name)) {
+        fprintf(stderr, "Gagal menyiapkan upload media\n");
+        goto out;
+    }
+    int len = snprintf(url, url_len, UPLOAD_URL_FORMAT, handle->homeserver, handle->access_token);
+    if (name)
+        snprintf(url + len, url_len - (size_t)len, "&filename=%s", name);
+
+    struct upload_source src = { fd, 0, size };
+    curl_easy_setopt(curl, CURLOPT_URL, url);
+    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+    curl_easy_setopt(curl, CURLOPT_POST, 1L);
+    curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE_LARGE, (curl_off_t)size);
+    curl_easy_setopt(curl, CURLOPT_READFUNCTION, read_source);
+    curl_easy_setopt(curl, CURLOPT_READDATA, &src);
+    curl_easy_setopt(curl, CURLOPT_SEEKFUNCTION, seek_source);
+    curl_easy_setopt(curl, CURLOPT_SEEKDATA, &src);
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, collect_error);
+    for (unsigned attempt = 0; attempt <= MAX_RETRIES; attempt++) {
+        char body[MAX_ERROR_BODY + 1];
+        struct MemoryStruct resp = { body, 0, 0 };
+        body[0] = '\0';
+        src.off = 0;
+        curl_easy_setopt(curl, CURLOPT_WRITEDATA, &resp);
+        int ret = perform_media(handle, curl, "POST", url, &resp.status);
+        if (ret == 0 && resp.status == 200) {
+            json_object *obj = json_tokener_parse(body), *field;
+            const char *value = obj && json_object_object_get_ex(obj, "content_uri", &field)
+                                    ? json_object_get_string(field) : NULL;
+            if (value && strncmp(value, "mxc://", 6) == 0)
+                uri = strdup(value);
+            else
+                fprintf(stderr, "Gagal upload media. Respons: %s\n", body);
+            json_object_put(obj);
+            break;
+        }
+        long wait = retry_delay(ret, resp.status, &resp, attempt);
+        if (wait < 0) {
+            fprintf(stderr, "Gagal upload media. Respons: %s\n", resp.size ? body : "(kosong)");
+            break;
+        }
+        if (attempt < MAX_RETRIES)
+            sleep_ms(wait);
+    }
+out:
+    curl_slist_free_all(headers);
+    curl_free(name);
+    free(url);
+    if (curl)
+        curl_easy_cleanup(curl);
+    return uri;
+}
+
+/* Mengupload isi fd secara streaming, dengan deduplikasi lewat cache */
+WINEMATRIXcode
+int WINEMATRIX_upload_media(WINEMATRIX_handle* handle, int fd, const char* content_type, const char* filename,
+                            char** content_uri)
+{
+    if (!handle || !handle->access_token || fd < 0 || !content_uri)
+        return -1;
+    *content_uri = NULL;
+    WINEMATRIX_media *m = handle->media;
+    char *buf = malloc(IO_CHUNK);
+    struct stat st;
+    if (!buf || fstat(fd, &st) != 0) {
+        free(buf);
+        return -1;
+    }
+
+    /* Sumber yang tidak bisa di-seek disalin dulu (ke direktori cache jika ada) */
+    unsigned char sha[SHA_LEN];
+    uint64_t size = 0;
+    int src_fd = fd, staged = -1, ret = -1;
+    char staged_path[4096] = "";
+    if (S_ISREG(st.st_mode)) {
+        ret = hash_file(fd, buf, sha, &size);
+    } else {
+        if (m) {
+            staged = temp_object(m, staged_path, sizeof(staged_path));
+        } else {
+            FILE *tmp = tmpfile();
+            staged = tmp ? dup(fileno(tmp)) : -1;
+            if (tmp)
+                fclose(tmp);
+        }
+        if (staged >= 0)
+            ret = stage_stream(fd, staged, buf, sha, &size);
+        src_fd = staged;
+    }
+    if (ret != 0) {
+        fprintf(stderr, "Gagal membaca media untuk upload\n");
+        goto out;
+    }
+
+    char key[HEX_LEN + 2] = "u";
+    struct inflight *flight = NULL;
+    if (m) {
+        to_hex(sha, key + 1);
+        pthread_mutex_lock(&m->lock);
+        inflight_wait(m, key);
+        struct uri *u = uri_find_sha(m, sha);
+        if (u) {
+            *content_uri = strdup(u->text);
+            m->stats.upload_hits++;
+        } else {
+            flight = inflight_add(m, key);
+        }
+        pthread_mutex_unlock(&m->lock);
+        if (u) {
+            ret = *content_uri ? 0 : -1;
+            goto out;
+        }
+    }
+
+    *content_uri = post_upload(handle, src_fd, size, content_type, filename);
+    ret = *content_uri ? 0 : -1;
+    if (ret == 0 && m) {
+        /* Isi yang diupload ikut disimpan, jadi echo event-nya tidak perlu di-download.
+           Seperti jalur download, isi harus sudah di disk sebelum diberi nama hash */
+        char tmp_path[4096];
+        int copied = staged >= 0;
+        if (!copied && size <= m->stats.max_bytes) {
+            int out_fd = temp_object(m, tmp_path, sizeof(tmp_path));
+            copied = out_fd >= 0 && copy_file(fd, out_fd, buf, size) == 0 && fdatasync(out_fd) == 0;
+            if (out_fd >= 0)
+                close(out_fd);
+            if (!copied && out_fd >= 0)
+                unlink(tmp_path);
+        } else if (copied && fdatasync(staged) == 0) {
+            snprintf(tmp_path, sizeof(tmp_path), "%s", staged_path);
+            staged_path[0] = '\0';
+        } else {
+            copied = 0;     /* Salinan staging dihapus di bawah */
+        }
+        pthread_mutex_lock(&m->lock);
+        m->stats.uploads++;
+        m->stats.bytes_uploaded += size;
+        uri_record(m, sha, *content_uri);
+        if (copied)
+            object_adopt(m, tmp_path, sha, size, 0);
+        pthread_mutex_unlock(&m->lock);
+    }
+    if (ret != 0) {
+        free(*content_uri);
+        *content_uri = NULL;
+    }
+    if (m)
+        inflight_done(m, flight);
+
+out:
+    if (staged >= 0)
+        close(staged);
+    if (staged_path[0])
+        unlink(staged_path);
+    free(buf);
+    return ret;
+}
+
+struct download_sink {
+    CURL *curl;
+    int fd;
+    EVP_MD_CTX *sha;
+    uint64_t size;
+    int body;                   /* 1 = respons 200, body ke file; 0 = body error ke err */
+    int failed;
+    struct MemoryStruct err;
+};
+
+static size_t write_sink(void* data, size_t size, size_t nmemb, void* user) {
+    struct download_sink *sink = user;
+    size_t n = size * nmemb;
+    if (sink->body < 0) {
+        long status = 0;
+        curl_easy_getinfo(sink->curl, CURLINFO_RESPONSE_CODE, &status);
+        sink->body = status == 200;
+    }
+    if (!sink->body)
+        return collect_error(data, size, nmemb, &sink->err);
+    if (write_all(sink->fd, data, n) != 0) {
+        sink->failed = 1;
+        return 0;
+    }
+    EVP_DigestUpdate(sink->sha, data, n);
+    sink->size += n;
+    return n;
+}
+
+/* Memisahkan mxc://server/mediaId. 0 jika valid */
+static int parse_mxc(const char* uri, char* server, size_t server_size, char* id, size_t id_size) {
+    if (strncmp(uri, "mxc://", 6) != 0)
+        return -1;
+    const char *s = uri + 6, *slash = strchr(s, '/');
+    if (!slash || slash == s || !slash[1] || strchr(slash + 1, '/') || (size_t)(slash - s) >= server_size ||
+        strlen(slash + 1) >= id_size)
+        return -1;
+    memcpy(server, s, (size_t)(slash - s));
+    server[slash - s] = '\0';
+    strcpy(id, slash + 1);
+    return 0;
+}
+
+/* GET /download ke file sementara. Mengembalikan 0 dan sha/size jika berhasil */
+static int fetch_download(WINEMATRIX_handle* handle, const char* server, const char* id, int out_fd,
+                          unsigned char* sha, uint64_t* size) {
+    CURL *curl = curl_easy_init();
+    char *srv = curl ? curl_easy_escape(curl, server, 0) : NULL;
+    char *mid = curl ? curl_easy_escape(curl, id, 0) : NULL;
+    size_t url_len = strlen(handle->homeserver) + strlen(handle->access_token) + (srv ? strlen(srv) : 0) +
+                     (mid ? strlen(mid) : 0) + 64;
+    char *url = malloc(url_len);
+    char err_body[MAX_ERROR_BODY + 1];
+    int ret = -1;
+    if (!curl || !srv || !mid || !url) {
+        fprintf(stderr, "Gagal menyiapkan download media\n");
+        goto out;
+    }
+    snprintf(url, url_len, DOWNLOAD_URL_FORMAT, handle->homeserver, srv, mid, handle->access_token);
+    curl_easy_setopt(curl, CURLOPT_URL, url);
+    curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_sink);
+    for (unsigned attempt = 0; attempt <= MAX_RETRIES; attempt++) {
+        struct download_sink sink = { curl, out_fd, sha_begin(), 0, -1, 0, { err_body, 0, 0 } };
+        err_body[0] = '\0';
+        if (!sink.sha || ftruncate(out_fd, 0) != 0 || lseek(out_fd, 0, SEEK_SET) != 0) {
+            EVP_MD_CTX_free(sink.sha);
+            break;
+        }
+        curl_easy_setopt(curl, CURLOPT_WRITEDATA, &sink);
+        int rc = perform_media(handle, curl, "GET", url, &sink.err.status);
+        if (rc == 0 && sink.err.status == 200 && !sink.failed) {
+            *size = sink.size;
+            ret = sha_end(sink.sha, sha);
+            break;
+        }
+        EVP_MD_CTX_free(sink.sha);
+        long wait = sink.failed ? -1 : retry_delay(rc, sink.err.status, &sink.err, attempt);
+        if (wait < 0) {
+            fprintf(stderr, "Gagal download media mxc://%s/%s. Respons: %s\n", server, id,
+                    sink.failed ? "(gagal menulis file)" : sink.err.size ? err_body : "(kosong)");
+            break;
+        }
+        if (attempt < MAX_RETRIES)
+            sleep_ms(wait);
+    }
+out:
+    curl_free(srv);
+    curl_free(mid);
+    free(url);
+    if (curl)
+        curl_easy_cleanup(curl);
+    return ret;
+}
+
+/* Mengambil media mxc:// dari cache, atau dari homeserver langsung ke disk */
+WINEMATRIXcode
+int WINEMATRIX_download_media(WINEMATRIX_handle* handle, const char* content_uri, int* fd)
+{
+    if (!handle || !handle->access_token || !content_uri || !fd)
+        return -1;
+    *fd = -1;
+    WINEMATRIX_media *m = handle->media;
+    if (!m) {
+        fprintf(stderr, "Error: cache media belum dibuka (WINEMATRIX_open_media_cache)\n");
+        return -1;
+    }
+    char server[256], id[256];
+    if (parse_mxc(content_uri, server, sizeof(server), id, sizeof(id)) != 0) {
+        fprintf(stderr, "Error: URI media tidak valid: %s\n", content_uri);
+        return -1;
+    }
+
+    size_t key_len = strlen(content_uri) + 2;
+    char *key = malloc(key_len);
+    if (!key)
+        return -1;
+    snprintf(key, key_len, "d%s", content_uri);
+    pthread_mutex_lock(&m->lock);
+    inflight_wait(m, key);
+    struct uri *u = uri_find(m, content_uri);
+    struct object *o = u ? object_find(m, u->sha) : NULL;
+    if (o && (*fd = object_open(m, o)) >= 0) {
+        m->stats.download_hits++;
+        pthread_mutex_unlock(&m->lock);
+        free(key);
+        return 0;
+    }
+    struct inflight *flight = inflight_add(m, key);
+    pthread_mutex_unlock(&m->lock);
+    free(key);
+
+    char tmp_path[4096];
+    int tmp = temp_object(m, tmp_path, sizeof(tmp_path));
+    unsigned char sha[SHA_LEN];
+    uint64_t size = 0;
+    int ret = tmp >= 0 ? fetch_download(handle, server, id, tmp, sha, &size) : -1;
+    /* Objek bernama hash isinya: isi harus sudah di disk sebelum nama itu dipakai */
+    if (ret == 0 && fdatasync(tmp) != 0)
+        ret = -1;
+    if (tmp >= 0)
+        close(tmp);
+    if (ret == 0) {
+        pthread_mutex_lock(&m->lock);
+        m->stats.downloads++;
+        m->stats.bytes_downloaded += size;
+        uri_record(m, sha, content_uri);
+        *fd = object_adopt(m, tmp_path, sha, size, 1);
+        pthread_mutex_unlock(&m->lock);
+        ret = *fd >= 0 ? 0 : -1;
+    } else if (tmp >= 0) {
+        unlink(tmp_path);
+    }
+    inflight_done(m, flight);
+    return ret;
+}
@@ -0,0 +1,301 @@
+#include "matrix_sliding.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <json-c/json.h>
+
+#define DEFAULT_WINDOW      20
+#define DEFAULT_TIMELINE    10
+
+/* State yang cukup untuk relay: nama dan topic room, power level, pinned
+   events (pin_message menambah ke daftar yang ada di cache) dan member
+   pengirim event di timeline saja */
+static const char *const default_required_state[] = {
+    "m.room.create", "",
+    "m.room.name", "",
+    "m.room.topic", "",
+    "m.room.power_levels", "",
+    "m.room.pinned_events", "",
+    "m.room.member", "$LAZY",
+    "m.room.member", "$ME",
+    NULL
+};
+
+static const WINEMATRIX_sliding_list default_lists[] = {
+    { "active", DEFAULT_WINDOW, 0, DEFAULT_TIMELINE, NULL },
+    { "all", 100, 500, 1, NULL },
+};
+
+struct list {
+    char *name;
+    int window, grow, timeline_limit;
+    json_object *required_state;    /* [[type, state_key], ...] */
+    long end;                       /* Indeks terakhir jendela request berikutnya */
+    long covered;                   /* Indeks terakhir jendela yang sudah dijawab server, -1 = belum ada */
+    long count;                     /* Jumlah room menurut server, -1 = belum tahu */
+};
+
+struct _WINEMATRIX_sliding {
+    struct list *lists;
+    size_t nlists;
+    char *pos;
+    /* Himpunan room_id yang sudah pernah diterima (open addressing) */
+    char **rooms;
+    size_t nrooms, rooms_cap;
+    uint64_t responses, resets;
+};
+
+static uint32_t hash_str(const char* s) {
+    uint32_t h = 2166136261u;
+    for (; *s; s++)
+        h = (h ^ (unsigned char)*s) * 16777619u;
+    return h;
+}
+
+static int room_insert(WINEMATRIX_sliding* sl, const char* room_id) {
+    if ((sl->nrooms + 1) * 2 > sl->rooms_cap) {
+        size_t cap = sl->rooms_cap ? sl->rooms_cap * 2 : 256;
+        char **rooms = calloc(cap, sizeof(char*));
+        if (!rooms)
+            return -1;
+        for (size_t i = 0; i < sl->rooms_cap; i++) {
+            if (!sl->rooms[i])
+                continue;
+            size_t j = hash_str(sl->rooms[i]) & (cap - 1);
+            while (rooms[j])
+                j = (j + 1) & (cap - 1);
+            rooms[j] = sl->rooms[i];
+        }
+        free(sl->rooms);
+        sl->rooms = rooms;
+        sl->rooms_cap = cap;
+    }
+    size_t j = hash_str(room_id) & (sl->rooms_cap - 1);
+    for (; sl->rooms[j]; j = (j + 1) & (sl->rooms_cap - 1))
+        if (strcmp(sl->rooms[j], room_id) == 0)
+            return 0;
+    sl->rooms[j] = strdup(room_id);
+    if (!sl->rooms[j])
+        return -1;
+    sl->nrooms++;
+    return 0;
+}
+
+static void list_restart(struct list* l) {
+    l->end = l->window - 1;
+    l->covered = -1;
+    l->count = -1;
+}
+
+/* Membuat status sliding sync */
+WINEMATRIXcode
+WINEMATRIX_sliding* WINEMATRIX_sliding_create(const WINEMATRIX_sliding_list* lists, size_t nlists)
+{
+    if (!lists) {
+        lists = default_lists;
+        nlists = sizeof(default_lists) / sizeof(default_lists[0]);
+    }
+    if (nlists == 0)
+        return NULL;
+    WINEMATRIX_sliding *sl = calloc(1, sizeof(WINEMATRIX_sliding));
+    if (!sl)
+        return NULL;
+    sl->lists = calloc(nlists, sizeof(struct list));
+    if (!sl->lists) {
+        free(sl);
+        return NULL;
+    }
+    sl->nlists = nlists;
+    for (size_t i = 0; i < nlists; i++) {
+        struct list *l = &sl->lists[i];
+        l->name = strdup(lists[i].name ? lists[i].name : "rooms");
+        l->window = lists[i].window > 0 ? lists[i].window : DEFAULT_WINDOW;
+        l->grow = lists[i].grow > 0 ? lists[i].grow : 0;
+        l->timeline_limit = lists[i].timeline_limit > 0 ? lists[i].timeline_limit : DEFAULT_TIMELINE;
+        l->required_state = json_object_new_array();
+        const char *const *rs = lists[i].required_state ? lists[i].required_state : default_required_state;
+        for (; rs[0] && rs[1]; rs += 2) {
+            json_object *pair = json_object_new_array();
+            json_object_array_add(pair, json_object_new_string(rs[0]));
+            json_object_array_add(pair, json_object_new_string(rs[1]));
+            json_object_array_add(l->required_state, pair);
+        }
+        list_restart(l);
+        if (!l->name) {
+            WINEMATRIX_sliding_free(sl);
+            return NULL;
+        }
+    }
+    return sl;
+}
+
+/* Membangun body request berikutnya */
+WINEMATRIXcode
+char* WINEMATRIX_sliding_request(const WINEMATRIX_sliding* sliding)
+{
+    if (!sliding)
+        return NULL;
+    json_object *lists = json_object_new_object();
+    for (size_t i = 0; i < sliding->nlists; i++) {
+        const struct list *l = &sliding->lists[i];
+        json_object *range = json_object_new_array(), *ranges = json_object_new_array();
+        json_object_array_add(range, json_object_new_int(0));
+        json_object_array_add(range, json_object_new_int64(l->end));
+        json_object_array_add(ranges, range);
+        json_object *list = json_object_new_object();
+        json_object_object_add(list, "ranges", ranges);
+        json_object_object_add(list, "required_state", json_object_get(l->required_state));
+        json_object_object_add(list, "timeline_limit", json_object_new_int(l->timeline_limit));
+        json_object_object_add(lists, l->name, list);
+    }
+    json_object *root = json_object_new_object();
+    json_object_object_add(root, "lists", lists);
+    const char *text = json_object_to_json_string_ext(root, JSON_C_TO_STRING_PLAIN);
+    char *body = text ? strdup(text) : NULL;
+    json_object_put(root);
+    return body;
+}
+
+WINEMATRIXcode
+const char* WINEMATRIX_sliding_pos(const WINEMATRIX_sliding* sliding)
+{
+    return sliding ? sliding->pos : NULL;
+}
+
+/* Satu room sliding sync ke bentuk rooms.join.{id} dari /sync biasa */
+static json_object* classic_room(json_object* room)
+{
+    json_object *events, *value, *initial, *prev;
+    json_object *timeline = json_object_new_object(), *state = json_object_new_object();
+    json_object_object_add(timeline, "events",
+                           json_object_object_get_ex(room, "timeline", &events) ? json_object_get(events)
+                                                                                : json_object_new_array());
+    int has_prev = json_object_object_get_ex(room, "prev_batch", &prev);
+    /* Tanpa field limited, room initial dengan prev_batch dianggap masih punya riwayat lama */
+    int limited = json_object_object_get_ex(room, "limited", &value) ? json_object_get_boolean(value) :
+                  json_object_object_get_ex(room, "initial", &initial) && json_object_get_boolean(initial) && has_prev;
+    json_object_object_add(timeline, "limited", json_object_new_boolean(limited));
+    if (has_prev)
+        json_object_object_add(timeline, "prev_batch", json_object_get(prev));
+    json_object_object_add(state, "events",
+                           json_object_object_get_ex(room, "required_state", &events) ? json_object_get(events)
+                                                                                      : json_object_new_array());
+    json_object *out = json_object_new_object();
+    json_object_object_add(out, "timeline", timeline);
+    json_object_object_add(out, "state", state);
+    return out;
+}
+
+/* Menerapkan respons sliding sync */
+WINEMATRIXcode
+int WINEMATRIX_sliding_apply(WINEMATRIX_sliding* sliding, const char* response, char** sync_json)
+{
+    if (sync_json)
+        *sync_json = NULL;
+    if (!sliding || !response)
+        return -1;
+    json_object *root = json_tokener_parse(response), *pos, *lists, *rooms;
+    if (!root || !json_object_object_get_ex(root, "pos", &pos) || !json_object_is_type(pos, json_type_string)) {
+        json_object_put(root);
+        return -1;
+    }
+    char *copy = strdup(json_object_get_string(pos));
+    if (!copy) {
+        json_object_put(root);
+        return -1;
+    }
+    free(sliding->pos);
+    sliding->pos = copy;
+    sliding->responses++;
+
+    /* Jendela berikutnya: tumbuh grow room sampai mencakup count */
+    json_object *list, *count;
+    for (size_t i = 0; i < sliding->nlists; i++) {
+        struct list *l = &sliding->lists[i];
+        if (!json_object_object_get_ex(root, "lists", &lists) ||
+            !json_object_object_get_ex(lists, l->name, &list) ||
+            !json_object_object_get_ex(list, "count", &count))
+            continue;
+        l->count = json_object_get_int64(count);
+        l->covered = l->end;
+        if (l->grow > 0 && l->end < l->count - 1)
+            l->end = l->end + l->grow < l->count - 1 ? l->end + l->grow : l->count - 1;
+    }
+
+    int n = 0;
+    json_object *join = json_object_new_object();
+    if (json_object_object_get_ex(root, "rooms", &rooms) && json_object_is_type(rooms, json_type_object)) {
+        struct json_object_iterator it = json_object_iter_begin(rooms), end = json_object_iter_end(rooms);
+        for (; !json_object_iter_equal(&it, &end); json_object_iter_next(&it), n++) {
+            const char *room_id = json_object_iter_peek_name(&it);
+            room_insert(sliding, room_id);
+            if (sync_json)
+                json_object_object_add(join, room_id, classic_room(json_object_iter_peek_value(&it)));
+        }
+    }
+    if (sync_json) {
+        json_object *out = json_object_new_object(), *out_rooms = json_object_new_object();
+        json_object_object_add(out_rooms, "join", json_object_get(join));
+        json_object_object_add(out, "rooms", out_rooms);
+        const char *text = json_object_to_json_string_ext(out, JSON_C_TO_STRING_PLAIN);
+        *sync_json = text ? strdup(text) : NULL;
+        json_object_put(out);
+    }
+    json_object_put(join);
+    json_object_put(root);
+    if (sync_json && !*sync_json)
+        return -1;
+    return n;
+}
+
+/* Memulai koneksi dari awal */
+WINEMATRIXcode
+void WINEMATRIX_sliding_reset(WINEMATRIX_sliding* sliding)
+{
+    if (!sliding)
+        return;
+    free(sliding->pos);
+    sliding->pos = NULL;
+    for (size_t i = 0; i < sliding->nlists; i++)
+        list_restart(&sliding->lists[i]);
+    sliding->resets++;
+}
+
+WINEMATRIXcode
+void WINEMATRIX_sliding_get_stats(const WINEMATRIX_sliding* sliding, WINEMATRIX_sliding_stats* out)
+{
+    if (!out)
+        return;
+    memset(out, 0, sizeof(*out));
+    if (!sliding)
+        return;
+    out->responses = sliding->responses;
+    out->resets = sliding->resets;
+    out->rooms = sliding->nrooms;
+    out->complete = 1;
+    for (size_t i = 0; i < sliding->nlists; i++) {
+        const struct list *l = &sliding->lists[i];
+        if (l->count > (long)out->total)
+            out->total = (size_t)l->count;
+        if (l->grow > 0 && (l->count < 0 || l->covered < l->count - 1))
+            out->complete = 0;
+    }
+}
+
+WINEMATRIXcode
+void WINEMATRIX_sliding_free(WINEMATRIX_sliding* sliding)
+{
+    if (!sliding)
+        return;
+    for (size_t i = 0; i < sliding->nlists; i++) {
+        free(sliding->lists[i].name);
+        json_object_put(sliding->lists[i].required_state);
+    }
+    for (size_t i = 0; i < sliding->rooms_cap; i++)
+        free(sliding->rooms[i]);
+    free(sliding->rooms);
+    free(sliding->lists);
+    free(sliding->pos);
+    free(sliding);
+}
@@ -0,0 +1,806 @@
+#include "matrix_state.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <json-c/json.h>
+
+#define NONE            0u          /* ID string 0 = tidak ada */
+#define CHUNK_SIZE      65536
+#define SMALL_BATCH     8           /* Di bawah ini perubahan anggota disisipkan langsung */
+
+/* --- Tabel string intern --- */
+
+struct chunk {
+    struct chunk *next;
+    size_t used, size;
+    char data[];
+};
+
+/* Hash disimpan di slot agar probe tidak menyentuh string yang tidak cocok */
+struct slot {
+    uint32_t id;                    /* 0 = kosong */
+    uint32_t hash;
+};
+
+struct strtab {
+    struct chunk *chunks;
+    const char **strs;              /* strs[id], id mulai dari 1 */
+    uint32_t count, cap;
+    struct slot *slots;
+    uint32_t mask;
+    size_t bytes;
+};
+
+/* --- State per room: array datar terurut --- */
+
+struct member {
+    uint32_t user;
+    uint32_t displayname;
+    uint8_t membership;
+};
+
+struct entry {
+    uint32_t type, key;
+    char *content;
+};
+
+struct level {
+    uint32_t user;
+    int32_t level;
+};
+
+struct room {
+    uint32_t id;
+    struct member *members;
+    uint32_t nmembers, members_cap, joined;
+    struct entry *state;
+    uint32_t nstate, state_cap;
+    struct level *levels;
+    uint32_t nlevels;
+    int32_t users_default;
+    /* Perubahan anggota yang belum digabung (selama satu apply_sync) */
+    struct member *pending;
+    uint32_t npending, pending_cap;
+};
+
+/* ID disalin ke array indeks agar binary search tidak menyentuh struct room */
+struct room_ref {
+    uint32_t id;
+    struct room *room;
+};
+
+struct _WINEMATRIX_state {
+    pthread_rwlock_t lock;
+    struct strtab strings;
+    struct room_ref *rooms;         /* Terurut menurut ID room */
+    uint32_t nrooms, rooms_cap;
+    uint32_t member_type;           /* ID intern "m.room.member" */
+    uint32_t power_type;            /* ID intern "m.room.power_levels" */
+    unsigned long events;
+};
+
+static uint32_t hash_str(const char* s) {
+    uint32_t h = 2166136261u;
+    for (; *s; s++)
+        h = (h ^ (unsigned char)*s) * 16777619u;
+    return h;
+}
+
+static uint32_t strtab_find(const struct strtab* t, const char* s) {
+    if (!t->slots || !s)
+        return NONE;
+    uint32_t h = hash_str(s);
+    for (uint32_t i = h & t->mask; t->slots[i].id; i = (i + 1) & t->mask) {
+        const struct slot *sl = &t->slots[i];
+        if (sl->hash == h && strcmp(t->strs[sl->id], s) == 0)
+            return sl->id;
+    }
+    return NONE;
+}
+
+static const char* strtab_copy(struct strtab* t, const char* s, size_t len) {
+    struct chunk *c = t->chunks;
+    if (!c || c->size - c->used < len + 1) {
+        size_t size = len + 1 > CHUNK_SIZE / 4 ? len + 1 : CHUNK_SIZE;
+        c = malloc(sizeof(struct chunk) + size);
+        if (!c)
+            return NULL;
+        c->size = size;
+        c->used = 0;
+        /* Chunk besar khusus tidak menggantikan chunk aktif */
+        if (size != CHUNK_SIZE && t->chunks) {
+            c->next = t->chunks->next;
+            t->chunks->next = c;
+        } else {
+            c->next = t->chunks;
+            t->chunks = c;
+        }
+        t->bytes += sizeof(struct chunk) + size;
+    }
+    char *dst = c->data + c->used;
+    memcpy(dst, s, len + 1);
+    c->used += len + 1;
+    return dst;
+}
+
+static uint32_t strtab_intern(struct strtab* t, const char* s) {
+    uint32_t id = strtab_find(t, s);
+    if (id != NONE || !s)
+        return id;
+    if (t->count + 1 >= t->cap) {
+        uint32_t cap = t->cap ? t->cap * 2 : 1024;
+        const char **strs = realloc(t->strs, cap * sizeof(char*));
+        if (!strs)
+            return NONE;
+        t->strs = strs;
+        t->cap = cap;
+    }
+    if (!t->slots || (t->count + 1) * 4 > (t->mask + 1) * 3) {
+        uint32_t size = t->slots ? (t->mask + 1) * 2 : 2048;
+        struct slot *slots = calloc(size, sizeof(struct slot));
+        if (!slots)
+            return NONE;
+        for (uint32_t k = 0; t->slots && k <= t->mask; k++) {
+            if (!t->slots[k].id)
+                continue;
+            uint32_t i = t->slots[k].hash & (size - 1);
+            while (slots[i].id)
+                i = (i + 1) & (size - 1);
+            slots[i] = t->slots[k];
+        }
+        free(t->slots);
+        t->slots = slots;
+        t->mask = size - 1;
+    }
+    const char *copy = strtab_copy(t, s, strlen(s));
+    if (!copy)
+        return NONE;
+    id = ++t->count;
+    t->strs[id] = copy;
+    uint32_t h = hash_str(s);
+    uint32_t i = h & t->mask;
+    while (t->slots[i].id)
+        i = (i + 1) & t->mask;
+    t->slots[i].id = id;
+    t->slots[i].hash = h;
+    return id;
+}
+
+static void strtab_free(struct strtab* t) {
+    while (t->chunks) {
+        struct chunk *next = t->chunks->next;
+        free(t->chunks);
+        t->chunks = next;
+    }
+    free(t->strs);
+    free(t->slots);
+}
+
+/* --- Room --- */
+
+static long room_pos(const WINEMATRIX_state* st, uint32_t id, int* found) {
+    long lo = 0, hi = (long)st->nrooms;
+    while (lo < hi) {
+        long mid = (lo + hi) / 2;
+        if (st->rooms[mid].id < id)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    *found = lo < (long)st->nrooms && st->rooms[lo].id == id;
+    return lo;
+}
+
+static struct room* room_find(const WINEMATRIX_state* st, const char* room_id) {
+    uint32_t id = strtab_find(&st->strings, room_id);
+    int found;
+    long pos = id == NONE ? 0 : room_pos(st, id, &found);
+    return id != NONE && found ? st->rooms[pos].room : NULL;
+}
+
+static struct room* room_get(WINEMATRIX_state* st, const char* room_id) {
+    uint32_t id = strtab_intern(&st->strings, room_id);
+    if (id == NONE)
+        return NULL;
+    int found;
+    long pos = room_pos(st, id, &found);
+    if (found)
+        return st->rooms[pos].room;
+    if (st->nrooms == st->rooms_cap) {
+        uint32_t cap = st->rooms_cap ? st->rooms_cap * 2 : 16;
+        struct room_ref *rooms = realloc(st->rooms, cap * sizeof(struct room_ref));
+        if (!rooms)
+            return NULL;
+        st->rooms = rooms;
+        st->rooms_cap = cap;
+    }
+    struct room *r = calloc(1, sizeof(struct room));
+    if (!r)
+        return NULL;
+    r->id = id;
+    memmove(st->rooms + pos + 1, st->rooms + pos, (st->nrooms - pos) * sizeof(struct room_ref));
+    st->rooms[pos].id = id;
+    st->rooms[pos].room = r;
+    st->nrooms++;
+    return r;
+}
+
+static void room_free(struct room* r) {
+    for (uint32_t i = 0; i < r->nstate; i++)
+        free(r->state[i].content);
+    free(r->state);
+    free(r->members);
+    free(r->levels);
+    free(r->pending);
+    free(r);
+}
+
+/* --- Anggota --- */
+
+static long member_pos(const struct room* r, uint32_t user, int* found) {
+    long lo = 0, hi = (long)r->nmembers;
+    while (lo < hi) {
+        long mid = (lo + hi) / 2;
+        if (r->members[mid].user < user)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    *found = lo < (long)r->nmembers && r->members[lo].user == user;
+    return lo;
+}
+
+static const struct member* member_find(const struct room* r, uint32_t user) {
+    int found;
+    long pos = member_pos(r, user, &found);
+    return found ? &r->members[pos] : NULL;
+}
+
+static int reserve_members(struct room* r, uint32_t need) {
+    if (need <= r->members_cap)
+        return 0;
+    uint32_t cap = r->members_cap ? r->members_cap : 4;
+    while (cap < need)
+        cap *= 2;
+    struct member *m = realloc(r->members, cap * sizeof(struct member));
+    if (!m)
+        return -1;
+    r->members = m;
+    r->members_cap = cap;
+    return 0;
+}
+
+/* Satu perubahan langsung: binary search lalu sisip/hapus */
+static int member_set(struct room* r, struct member upd) {
+    int found;
+    long pos = member_pos(r, upd.user, &found);
+    if (found) {
+        r->joined -= r->members[pos].membership == WINEMATRIX_MEMBERSHIP_JOIN;
+        if (upd.membership == WINEMATRIX_MEMBERSHIP_NONE) {
+            memmove(r->members + pos, r->members + pos + 1, (r->nmembers - pos - 1) * sizeof(struct member));
+            r->nmembers--;
+            return 0;
+        }
+        r->members[pos] = upd;
+    } else {
+        if (upd.membership == WINEMATRIX_MEMBERSHIP_NONE)
+            return 0;
+        if (reserve_members(r, r->nmembers + 1) != 0)
+            return -1;
+        memmove(r->members + pos + 1, r->members + pos, (r->nmembers - pos) * sizeof(struct member));
+        r->members[pos] = upd;
+        r->nmembers++;
+    }
+    r->joined += upd.membership == WINEMATRIX_MEMBERSHIP_JOIN;
+    return 0;
+}
+
+/* Urutan kedatangan ikut dibandingkan: untuk user yang sama, perubahan terakhir menang */
+struct pending_key {
+    uint32_t user, idx;
+};
+
+static int cmp_pending(const void* a, const void* b) {
+    const struct pending_key *x = a, *y = b;
+    if (x->user != y->user)
+        return x->user < y->user ? -1 : 1;
+    return x->idx < y->idx ? -1 : x->idx > y->idx;
+}
+
+/* Menggabungkan perubahan tertunda ke array anggota dalam satu lintasan */
+static int merge_pending(struct room* r) {
+    if (r->npending == 0)
+        return 0;
+    if (r->npending <= SMALL_BATCH) {
+        int ret = 0;
+        for (uint32_t i = 0; i < r->npending; i++)
+            ret |= member_set(r, r->pending[i]);
+        r->npending = 0;
+        return ret;
+    }
+    uint32_t n = r->npending;
+    struct pending_key *keys = malloc(n * sizeof(struct pending_key));
+    struct member *merged = malloc((r->nmembers + n) * sizeof(struct member));
+    if (!keys || !merged) {
+        free(keys);
+        free(merged);
+        return -1;
+    }
+    for (uint32_t i = 0; i < n; i++) {
+        keys[i].user = r->pending[i].user;
+        keys[i].idx = i;
+    }
+    qsort(keys, n, sizeof(struct pending_key), cmp_pending);
+    uint32_t m = 0;
+    for (uint32_t i = 0; i < n; i++)
+        if (i + 1 == n || keys[i + 1].user != keys[i].user)
+            keys[m++] = keys[i];
+
+    uint32_t a = 0, b = 0, out = 0, joined = 0;
+    while (a < r->nmembers || b < m) {
+        struct member next;
+        if (b == m || (a < r->nmembers && r->members[a].user < keys[b].user)) {
+            next = r->members[a++];
+        } else {
+            if (a < r->nmembers && r->members[a].user == keys[b].user)
+                a++;
+            next = r->pending[keys[b++].idx];
+            if (next.membership == WINEMATRIX_MEMBERSHIP_NONE)
+                continue;
+        }
+        joined += next.membership == WINEMATRIX_MEMBERSHIP_JOIN;
+        merged[out++] = next;
+    }
+    free(keys);
+    free(r->members);
+    r->members = merged;
+    r->members_cap = r->nmembers + n;
+    r->nmembers = out;
+    r->joined = joined;
+    r->npending = 0;
+    free(r->pending);
+    r->pending = NULL;
+    r->pending_cap = 0;
+    /* Kapasitas berlebih dari penggabungan besar dikembalikan */
+    if (r->members_cap > out + out / 4 + 4) {
+        struct member *shrunk = realloc(r->members, (out ? out : 1) * sizeof(struct member));
+        if (shrunk) {
+            r->members = shrunk;
+            r->members_cap = out ? out : 1;
+        }
+    }
+    return 0;
+}
+
+static int queue_member(struct room* r, struct member upd) {
+    if (r->npending == r->pending_cap) {
+        uint32_t cap = r->pending_cap ? r->pending_cap * 2 : 16;
+        struct member *p = realloc(r->pending, cap * sizeof(struct member));
+        if (!p)
+            return member_set(r, upd);
+        r->pending = p;
+        r->pending_cap = cap;
+    }
+    r->pending[r->npending++] = upd;
+    return 0;
+}
+
+static WINEMATRIX_membership parse_membership(const char* s) {
+    if (!s)
+        return WINEMATRIX_MEMBERSHIP_NONE;
+    if (strcmp(s, "join") == 0)
+        return WINEMATRIX_MEMBERSHIP_JOIN;
+    if (strcmp(s, "invite") == 0)
+        return WINEMATRIX_MEMBERSHIP_INVITE;
+    if (strcmp(s, "knock") == 0)
+        return WINEMATRIX_MEMBERSHIP_KNOCK;
+    if (strcmp(s, "ban") == 0)
+        return WINEMATRIX_MEMBERSHIP_BAN;
+    return WINEMATRIX_MEMBERSHIP_NONE;
+}
+
+static const char* get_string(json_object* obj, const char* key) {
+    json_object *v;
+    if (!obj || !json_object_object_get_ex(obj, key, &v) || !json_object_is_type(v, json_type_string))
+        return NULL;
+    return json_object_get_string(v);
+}
+
+/* --- State lain --- */
+
+static long entry_pos(const struct room* r, uint32_t type, uint32_t key, int* found) {
+    long lo = 0, hi = (long)r->nstate;
+    while (lo < hi) {
+        long mid = (lo + hi) / 2;
+        const struct entry *e = &r->state[mid];
+        if (e->type < type || (e->type == type && e->key < key))
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    *found = lo < (long)r->nstate && r->state[lo].type == type && r->state[lo].key == key;
+    return lo;
+}
+
+static int cmp_level(const void* a, const void* b) {
+    const struct level *x = a, *y = b;
+    return x->user < y->user ? -1 : x->user > y->user;
+}
+
+static void set_power_levels(WINEMATRIX_state* st, struct room* r, json_object* content) {
+    free(r->levels);
+    r->levels = NULL;
+    r->nlevels = 0;
+    r->users_default = 0;
+    json_object *v, *users;
+    if (!content)
+        return;
+    if (json_object_object_get_ex(content, "users_default", &v))
+        r->users_default = json_object_get_int(v);
+    if (!json_object_object_get_ex(content, "users", &users) || !json_object_is_type(users, json_type_object))
+        return;
+    int n = json_object_object_length(users);
+    r->levels = n > 0 ? malloc((size_t)n * sizeof(struct level)) : NULL;
+    if (!r->levels)
+        return;
+    struct json_object_iterator it = json_object_iter_begin(users), end = json_object_iter_end(users);
+    for (; !json_object_iter_equal(&it, &end); json_object_iter_next(&it)) {
+        uint32_t user = strtab_intern(&st->strings, json_object_iter_peek_name(&it));
+        if (user == NONE)
+            continue;
+        r->levels[r->nlevels].user = user;
+        r->levels[r->nlevels].level = json_object_get_int(json_object_iter_peek_value(&it));
+        r->nlevels++;
+    }
+    qsort(r->levels, r->nlevels, sizeof(struct level), cmp_level);
+}
+
+static int set_entry(WINEMATRIX_state* st, struct room* r, uint32_t type, uint32_t key, json_object* content) {
+    int found;
+    long pos = entry_pos(r, type, key, &found);
+    if (type == st->power_type && key == strtab_find(&st->strings, ""))
+        set_power_levels(st, r, content);
+    if (!content) {
+        if (found) {
+            free(r->state[pos].content);
+            memmove(r->state + pos, r->state + pos + 1, (r->nstate - pos - 1) * sizeof(struct entry));
+            r->nstate--;
+        }
+        return 0;
+    }
+    char *copy = strdup(json_object_to_json_string_ext(content, JSON_C_TO_STRING_PLAIN));
+    if (!copy)
+        return -1;
+    if (found) {
+        free(r->state[pos].content);
+        r->state[pos].content = copy;
+        return 0;
+    }
+    if (r->nstate == r->state_cap) {
+        uint32_t cap = r->state_cap ? r->state_cap * 2 : 4;
+        struct entry *e = realloc(r->state, cap * sizeof(struct entry));
+        if (!e) {
+            free(copy);
+            return -1;
+        }
+        r->state = e;
+        r->state_cap = cap;
+    }
+    memmove(r->state + pos + 1, r->state + pos, (r->nstate - pos) * sizeof(struct entry));
+    r->state[pos].type = type;
+    r->state[pos].key = key;
+    r->state[pos].content = copy;
+    r->nstate++;
+    return 0;
+}
+
+/* Satu event state. Anggota masuk antrean pending room (digabung oleh pemanggil) */
+static int apply_state(WINEMATRIX_state* st, struct room* r, const char* type, const char* state_key,
+                       json_object* content) {
+    uint32_t type_id = strtab_intern(&st->strings, type);
+    uint32_t key_id = strtab_intern(&st->strings, state_key);
+    if (type_id == NONE || key_id == NONE)
+        return -1;
+    st->events++;
+    if (type_id == st->member_type) {
+        struct member upd = { key_id, NONE, (uint8_t)parse_membership(get_string(content, "membership")) };
+        const char *name = get_string(content, "displayname");
+        if (name && upd.membership != WINEMATRIX_MEMBERSHIP_NONE)
+            upd.displayname = strtab_intern(&st->strings, name);
+        return queue_member(r, upd);
+    }
+    return set_entry(st, r, type_id, key_id, content);
+}
+
+static int apply_events(WINEMATRIX_state* st, struct room* r, json_object* section) {
+    json_object *events;
+    if (!section || !json_object_object_get_ex(section, "events", &events) ||
+        !json_object_is_type(events, json_type_array))
+        return 0;
+    int applied = 0;
+    size_t n = json_object_array_length(events);
+    for (size_t i = 0; i < n; i++) {
+        json_object *ev = json_object_array_get_idx(events, i);
+        const char *type = get_string(ev, "type");
+        const char *state_key = get_string(ev, "state_key");
+        json_object *content = NULL;
+        if (!type || !state_key)
+            continue;
+        json_object_object_get_ex(ev, "content", &content);
+        if (apply_state(st, r, type, state_key, content) == 0)
+            applied++;
+    }
+    return applied;
+}
+
+static void forget(WINEMATRIX_state* st, const char* room_id) {
+    uint32_t id = strtab_find(&st->strings, room_id);
+    int found;
+    long pos = id == NONE ? 0 : room_pos(st, id, &found);
+    if (id == NONE || !found)
+        return;
+    room_free(st->rooms[pos].room);
+    memmove(st->rooms + pos, st->rooms + pos + 1, (st->nrooms - pos - 1) * sizeof(struct room_ref));
+    st->nrooms--;
+}
+
+/* --- API --- */
+
+WINEMATRIXcode
+WINEMATRIX_state* WINEMATRIX_state_create(void)
+{
+    WINEMATRIX_state *st = calloc(1, sizeof(WINEMATRIX_state));
+    if (!st)
+        return NULL;
+    pthread_rwlock_init(&st->lock, NULL);
+    st->member_type = strtab_intern(&st->strings, "m.room.member");
+    st->power_type = strtab_intern(&st->strings, "m.room.power_levels");
+    if (st->member_type == NONE || st->power_type == NONE || strtab_intern(&st->strings, "") == NONE) {
+        WINEMATRIX_state_free(st);
+        return NULL;
+    }
+    return st;
+}
+
+WINEMATRIXcode
+int WINEMATRIX_state_apply_sync(WINEMATRIX_state* st, const char* sync_json)
+{
+    if (!st || !sync_json)
+        return -1;
+    /* Parse di luar lock: pembaca tidak tertahan selama tokenisasi */
+    json_object *root = json_tokener_parse(sync_json);
+    if (!root) {
+        fprintf(stderr, "Error: respons /sync bukan JSON yang valid\n");
+        return -1;
+    }
+    int applied = WINEMATRIX_state_apply_sync_object(st, root);
+    json_object_put(root);
+    return applied;
+}
+
+WINEMATRIXcode
+int WINEMATRIX_state_apply_sync_object(WINEMATRIX_state* st, struct json_object* root)
+{
+    if (!st || !root)
+        return -1;
+    json_object *rooms, *join, *leave;
+    int applied = 0;
+    pthread_rwlock_wrlock(&st->lock);
+    if (json_object_object_get_ex(root, "rooms", &rooms)) {
+        if (json_object_object_get_ex(rooms, "join", &join) && json_object_is_type(join, json_type_object)) {
+            struct json_object_iterator it = json_object_iter_begin(join), end = json_object_iter_end(join);
+            for (; !json_object_iter_equal(&it, &end); json_object_iter_next(&it)) {
+                json_object *room = json_object_iter_peek_value(&it), *section;
+                struct room *r = room_get(st, json_object_iter_peek_name(&it));
+                if (!r)
+                    continue;
+                /* state = state sebelum timeline, lalu event state di timeline berurutan */
+                if (json_object_object_get_ex(room, "state", &section))
+                    applied += apply_events(st, r, section);
+                if (json_object_object_get_ex(room, "timeline", &section))
+                    applied += apply_events(st, r, section);
+                merge_pending(r);
+            }
+        }
+        if (json_object_object_get_ex(rooms, "leave", &leave) && json_object_is_type(leave, json_type_object)) {
+            struct json_object_iterator it = json_object_iter_begin(leave), end = json_object_iter_end(leave);
+            for (; !json_object_iter_equal(&it, &end); json_object_iter_next(&it))
+                forget(st, json_object_iter_peek_name(&it));
+        }
+    }
+    pthread_rwlock_unlock(&st->lock);
+    return applied;
+}
+
+WINEMATRIXcode
+int WINEMATRIX_state_apply_event(WINEMATRIX_state* st, const char* room_id, const char* type,
+                                 const char* state_key, const char* content_json)
+{
+    if (!st || !room_id || !type || !state_key)
+        return -1;
+    json_object *content = NULL;
+    if (content_json && !(content = json_tokener_parse(content_json)))
+        return -1;
+    pthread_rwlock_wrlock(&st->lock);
+    struct room *r = room_get(st, room_id);
+    int ret = r ? apply_state(st, r, type, state_key, content) : -1;
+    if (r && merge_pending(r) != 0)
+        ret = -1;
+    pthread_rwlock_unlock(&st->lock);
+    json_object_put(content);
+    return ret;
+}
+
+WINEMATRIXcode
+void WINEMATRIX_state_forget_room(WINEMATRIX_state* st, const char* room_id)
+{
+    if (!st || !room_id)
+        return;
+    pthread_rwlock_wrlock(&st->lock);
+    forget(st, room_id);
+    pthread_rwlock_unlock(&st->lock);
+}
+
+/* Lock baca untuk query; const dilepas hanya untuk rwlock */
+static void read_lock(const WINEMATRIX_state* st) {
+    pthread_rwlock_rdlock(&((WINEMATRIX_state*)st)->lock);
+}
+
+static void read_unlock(const WINEMATRIX_state* st) {
+    pthread_rwlock_unlock(&((WINEMATRIX_state*)st)->lock);
+}
+
+WINEMATRIXcode
+int WINEMATRIX_state_has_room(const WINEMATRIX_state* st, const char* room_id)
+{
+    if (!st || !room_id)
+        return 0;
+    read_lock(st);
+    int found = room_find(st, room_id) != NULL;
+    read_unlock(st);
+    return found;
+}
+
+WINEMATRIXcode
+WINEMATRIX_membership WINEMATRIX_state_membership(const WINEMATRIX_state* st, const char* room_id,
+                                                  const char* user_id)
+{
+    if (!st || !room_id || !user_id)
+        return WINEMATRIX_MEMBERSHIP_NONE;
+    read_lock(st);
+    const struct room *r = room_find(st, room_id);
+    uint32_t user = r ? strtab_find(&st->strings, user_id) : NONE;
+    const struct member *m = user != NONE ? member_find(r, user) : NULL;
+    WINEMATRIX_membership ret = m ? (WINEMATRIX_membership)m->membership : WINEMATRIX_MEMBERSHIP_NONE;
+    read_unlock(st);
+    return ret;
+}
+
+WINEMATRIXcode
+const char* WINEMATRIX_state_displayname(const WINEMATRIX_state* st, const char* room_id, const char* user_id)
+{
+    if (!st || !room_id || !user_id)
+        return NULL;
+    read_lock(st);
+    const struct room *r = room_find(st, room_id);
+    uint32_t user = r ? strtab_find(&st->strings, user_id) : NONE;
+    const struct member *m = user != NONE ? member_find(r, user) : NULL;
+    /* String intern tidak pernah dipindah, aman dipakai setelah lock dilepas */
+    const char *name = m && m->displayname != NONE ? st->strings.strs[m->displayname] : NULL;
+    read_unlock(st);
+    return name;
+}
+
+WINEMATRIXcode
+long WINEMATRIX_state_power_level(const WINEMATRIX_state* st, const char* room_id, const char* user_id)
+{
+    if (!st || !room_id || !user_id)
+        return 0;
+    read_lock(st);
+    const struct room *r = room_find(st, room_id);
+    long level = r ? r->users_default : 0;
+    uint32_t user = r && r->nlevels ? strtab_find(&st->strings, user_id) : NONE;
+    if (user != NONE) {
+        struct level key = { user, 0 };
+        const struct level *l = bsearch(&key, r->levels, r->nlevels, sizeof(struct level), cmp_level);
+        if (l)
+            level = l->level;
+    }
+    read_unlock(st);
+    return level;
+}
+
+WINEMATRIXcode
+char* WINEMATRIX_state_get(const WINEMATRIX_state* st, const char* room_id, const char* type,
+                           const char* state_key)
+{
+    if (!st || !room_id || !type || !state_key)
+        return NULL;
+    read_lock(st);
+    const struct room *r = room_find(st, room_id);
+    uint32_t type_id = r ? strtab_find(&st->strings, type) : NONE;
+    uint32_t key_id = type_id != NONE ? strtab_find(&st->strings, state_key) : NONE;
+    char *content = NULL;
+    if (key_id != NONE) {
+        int found;
+        long pos = entry_pos(r, type_id, key_id, &found);
+        if (found)
+            content = strdup(r->state[pos].content);
+    }
+    read_unlock(st);
+    return content;
+}
+
+WINEMATRIXcode
+size_t WINEMATRIX_state_joined_count(const WINEMATRIX_state* st, const char* room_id)
+{
+    if (!st || !room_id)
+        return 0;
+    read_lock(st);
+    const struct room *r = room_find(st, room_id);
+    size_t n = r ? r->joined : 0;
+    read_unlock(st);
+    return n;
+}
+
+WINEMATRIXcode
+size_t WINEMATRIX_state_foreach_member(const WINEMATRIX_state* st, const char* room_id,
+                                       void (*cb)(const char* user_id, const char* displayname,
+                                                  WINEMATRIX_membership membership, void* user_data),
+                                       void* user_data)
+{
+    if (!st || !room_id)
+        return 0;
+    read_lock(st);
+    const struct room *r = room_find(st, room_id);
+    size_t n = r ? r->nmembers : 0;
+    for (size_t i = 0; cb && i < n; i++) {
+        const struct member *m = &r->members[i];
+        cb(st->strings.strs[m->user], m->displayname != NONE ? st->strings.strs[m->displayname] : NULL,
+           (WINEMATRIX_membership)m->membership, user_data);
+    }
+    read_unlock(st);
+    return n;
+}
+
+WINEMATRIXcode
+void WINEMATRIX_state_get_stats(const WINEMATRIX_state* st, WINEMATRIX_state_stats* out)
+{
+    memset(out, 0, sizeof(*out));
+    if (!st)
+        return;
+    read_lock(st);
+    const struct strtab *t = &st->strings;
+    out->strings = t->count;
+    out->bytes = sizeof(*st) + t->bytes + (size_t)t->cap * sizeof(char*) +
+                 (t->slots ? (size_t)(t->mask + 1) * sizeof(struct slot) : 0) +
+                 (size_t)st->rooms_cap * sizeof(struct room_ref);
+    out->rooms = st->nrooms;
+    for (uint32_t i = 0; i < st->nrooms; i++) {
+        const struct room *r = st->rooms[i].room;
+        out->members += r->nmembers;
+        out->state_events += r->nstate;
+        out->bytes += sizeof(struct room) + (size_t)r->members_cap * sizeof(struct member) +
+                      (size_t)r->state_cap * sizeof(struct entry) + (size_t)r->nlevels * sizeof(struct level) +
+                      (size_t)r->pending_cap * sizeof(struct member);
+        for (uint32_t k = 0; k < r->nstate; k++)
+            out->bytes += strlen(r->state[k].content) + 1;
+    }
+    out->events = st->events;
+    read_unlock(st);
+}
+
+WINEMATRIXcode
+void WINEMATRIX_state_free(WINEMATRIX_state* st)
+{
+    if (!st)
+        return;
+    for (uint32_t i = 0; i < st->nrooms; i++)
+        room_free(st->rooms[i].room);
+    free(st->rooms);
+    strtab_free(&st->strings);
+    pthread_rwlock_destroy(&st->lock);
+    free(st);
+}
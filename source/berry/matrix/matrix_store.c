@@ -0,0 +1,1166 @@
+#include "matrix_store.h"
+#include "matrix_driver.h"
+#include "matrix_internal.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <curl/curl.h>
+#include <json-c/json.h>
+
+#define SEGMENT_BYTES   ((size_t)64 << 20)
+#define SEGMENT_MAX     ((size_t)1 << 30)       /* Offset record disimpan 32 bit */
+#define ORDER_STEP      ((int64_t)1 << 32)      /* Jarak order antar potongan timeline yang dipisah celah */
+#define ORDER_START     INT64_MIN               /* lo celah awal riwayat room */
+#define MESSAGES_URL_FORMAT "%s/_matrix/client/r0/rooms/%s/messages?access_token=%s&dir=b&limit=%u"
+
+enum { REC_EVENT = 1, REC_GAP = 2, REC_SINCE = 3 };
+
+/* --- Format record di segmen ---
+   Header diikuti string room, key, rel, rel_type dan body, masing-masing
+   diakhiri NUL sehingga bisa dipakai langsung dari mmap. */
+
+struct record {
+    uint32_t len;           /* Panjang record termasuk header, kelipatan 8 */
+    uint32_t sum;           /* Checksum atas byte sesudah field ini */
+    uint8_t kind;
+    uint8_t pad;
+    uint16_t room_len;
+    uint16_t key_len;       /* event_id; token untuk REC_GAP/REC_SINCE ("" = celah tertutup) */
+    uint16_t rel_len;       /* event_id target relasi */
+    uint16_t rel_type_len;
+    uint16_t pad2;
+    uint32_t body_len;      /* JSON event */
+    int64_t order;          /* REC_GAP: hi */
+    int64_t aux;            /* REC_GAP: lo (identitas celah) */
+};
+
+static const char* rec_room(const struct record* r) { return (const char*)(r + 1); }
+static const char* rec_key(const struct record* r) { return rec_room(r) + r->room_len + 1; }
+static const char* rec_rel(const struct record* r) { return rec_key(r) + r->key_len + 1; }
+static const char* rec_rel_type(const struct record* r) { return rec_rel(r) + r->rel_len + 1; }
+static const char* rec_body(const struct record* r) { return rec_rel_type(r) + r->rel_type_len + 1; }
+
+static uint32_t checksum(const unsigned char* p, size_t n) {
+    uint64_t h = 0x9e3779b97f4a7c15ull ^ n;
+    for (; n >= 8; p += 8, n -= 8) {
+        uint64_t w;
+        memcpy(&w, p, 8);
+        h = (h ^ w) * 0x100000001b3ull;
+        h ^= h >> 29;
+    }
+    for (; n; p++, n--)
+        h = (h ^ *p) * 0x100000001b3ull;
+    return (uint32_t)(h ^ (h >> 32));
+}
+
+static uint32_t hash_str(const char* s) {
+    uint32_t h = 2166136261u;
+    for (; *s; s++)
+        h = (h ^ (unsigned char)*s) * 16777619u;
+    return h;
+}
+
+/* --- Struktur di memori --- */
+
+struct segment {
+    int fd;
+    char *base;
+    size_t size;            /* Ukuran mapping */
+    size_t used;
+    int dirty;              /* Ada record yang belum di-msync */
+};
+
+struct ref {
+    int64_t order;
+    uint64_t loc;           /* (segmen + 1) << 32 | offset, tidak pernah 0 */
+};
+
+/* Rentang order (lo, hi) yang eventnya belum diambil; token = rec_key record gap */
+struct gap {
+    int64_t lo, hi;
+    uint64_t loc;
+};
+
+struct room {
+    const char *id;         /* Di mmap */
+    struct ref *refs;       /* Terurut menurut order */
+    size_t nrefs, refs_cap;
+    struct gap *gaps;
+    uint32_t ngaps, gaps_cap;
+    int claimed;            /* Sedang di-backfill oleh satu worker */
+};
+
+struct rel {
+    uint64_t loc;
+    uint32_t next;          /* Relasi sebelumnya ke target yang sama + 1, 0 = akhir */
+};
+
+/* Slot tabel hash terbuka; val 0 = kosong */
+struct slot {
+    uint64_t val;
+    uint32_t hash;
+};
+
+enum { TAB_EVENTS, TAB_ROOMS, TAB_RELS };
+
+struct table {
+    int kind;
+    struct slot *slots;
+    size_t mask, count;
+};
+
+struct _WINEMATRIX_store {
+    pthread_rwlock_t lock;
+    char *dir;
+    size_t segment_bytes;
+    struct segment *segs;
+    size_t nsegs, segs_cap;
+    size_t bytes;
+    struct room **rooms;
+    size_t nrooms, rooms_cap;
+    struct rel *rels;
+    size_t nrels, rels_cap;
+    struct table events;    /* event_id -> loc */
+    struct table room_tab;  /* room_id -> indeks rooms + 1 */
+    struct table rel_tab;   /* event_id target -> relasi terbaru + 1 */
+    size_t nevents, ngaps;
+    uint64_t since_loc;
+};
+
+static const struct record* rec_at(const WINEMATRIX_store* st, uint64_t loc) {
+    return (const struct record*)(st->segs[(loc >> 32) - 1].base + (uint32_t)loc);
+}
+
+static const char* table_key(const WINEMATRIX_store* st, const struct table* t, uint64_t val) {
+    switch (t->kind) {
+    case TAB_EVENTS: return rec_key(rec_at(st, val));
+    case TAB_ROOMS:  return st->rooms[val - 1]->id;
+    default:         return rec_rel(rec_at(st, st->rels[val - 1].loc));
+    }
+}
+
+static struct slot* table_find(const WINEMATRIX_store* st, const struct table* t, const char* key, uint32_t h) {
+    if (!t->slots)
+        return NULL;
+    for (size_t i = h & t->mask; t->slots[i].val; i = (i + 1) & t->mask) {
+        struct slot *sl = &t->slots[i];
+        if (sl->hash == h && strcmp(table_key(st, t, sl->val), key) == 0)
+            return sl;
+    }
+    return NULL;
+}
+
+static uint64_t table_get(const WINEMATRIX_store* st, const struct table* t, const char* key) {
+    const struct slot *sl = table_find(st, t, key, hash_str(key));
+    return sl ? sl->val : 0;
+}
+
+/* Menyimpan val untuk key (menimpa jika sudah ada) */
+static int table_put(WINEMATRIX_store* st, struct table* t, const char* key, uint64_t val) {
+    uint32_t h = hash_str(key);
+    struct slot *sl = table_find(st, t, key, h);
+    if (sl) {
+        sl->val = val;
+        return 0;
+    }
+    if ((t->count + 1) * 4 > (t->mask + 1) * 3 || !t->slots) {
+        size_t cap = t->slots ? (t->mask + 1) * 2 : 1024;
+        struct slot *slots = calloc(cap, sizeof(struct slot));
+        if (!slots)
+            return -1;
+        for (size_t i = 0; t->slots && i <= t->mask; i++) {
+            if (!t->slots[i].val)
+                continue;
+            size_t j = t->slots[i].hash & (cap - 1);
+            while (slots[j].val)
+                j = (j + 1) & (cap - 1);
+            slots[j] = t->slots[i];
+        }
+        free(t->slots);
+        t->slots = slots;
+        t->mask = cap - 1;
+    }
+    size_t i = h & t->mask;
+    while (t->slots[i].val)
+        i = (i + 1) & t->mask;
+    t->slots[i].val = val;
+    t->slots[i].hash = h;
+    t->count++;
+    return 0;
+}
+
+/* --- Room --- */
+
+static struct room* room_find(const WINEMATRIX_store* st, const char* room_id) {
+    uint64_t idx = table_get(st, &st->room_tab, room_id);
+    return idx ? st->rooms[idx - 1] : NULL;
+}
+
+/* room_id harus menunjuk ke string di mmap */
+static struct room* room_get(WINEMATRIX_store* st, const char* room_id) {
+    struct room *r = room_find(st, room_id);
+    if (r)
+        return r;
+    if (st->nrooms == st->rooms_cap) {
+        size_t cap = st->rooms_cap ? st->rooms_cap * 2 : 64;
+        struct room **rooms = realloc(st->rooms, cap * sizeof(struct room*));
+        if (!rooms)
+            return NULL;
+        st->rooms = rooms;
+        st->rooms_cap = cap;
+    }
+    r = calloc(1, sizeof(struct room));
+    if (!r)
+        return NULL;
+    r->id = room_id;
+    st->rooms[st->nrooms] = r;
+    if (table_put(st, &st->room_tab, room_id, st->nrooms + 1) != 0) {
+        free(r);
+        return NULL;
+    }
+    st->nrooms++;
+    return r;
+}
+
+static int reserve_refs(struct room* r, size_t need) {
+    if (r->nrefs + need <= r->refs_cap)
+        return 0;
+    size_t cap = r->refs_cap ? r->refs_cap : 16;
+    while (cap < r->nrefs + need)
+        cap *= 2;
+    struct ref *refs = realloc(r->refs, cap * sizeof(struct ref));
+    if (!refs)
+        return -1;
+    r->refs = refs;
+    r->refs_cap = cap;
+    return 0;
+}
+
+/* Posisi ref pertama dengan order >= order */
+static size_t ref_pos(const struct room* r, int64_t order) {
+    size_t lo = 0, hi = r->nrefs;
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        if (r->refs[mid].order < order)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+/* Menyisipkan ref terurut naik yang semuanya jatuh di satu celah, dengan satu memmove */
+static int insert_refs(struct room* r, const struct ref* refs, size_t n) {
+    if (n == 0)
+        return 0;
+    if (reserve_refs(r, n) != 0)
+        return -1;
+    size_t pos = ref_pos(r, refs[0].order);
+    memmove(r->refs + pos + n, r->refs + pos, (r->nrefs - pos) * sizeof(struct ref));
+    memcpy(r->refs + pos, refs, n * sizeof(struct ref));
+    r->nrefs += n;
+    return 0;
+}
+
+static int cmp_ref(const void* a, const void* b) {
+    int64_t x = ((const struct ref*)a)->order, y = ((const struct ref*)b)->order;
+    return x < y ? -1 : x > y;
+}
+
+/* Celah terbuka di antara order o (lebih lama) dan p (lebih baru) */
+static int gap_between(const struct room* r, int64_t o, int64_t p) {
+    for (uint32_t i = 0; i < r->ngaps; i++)
+        if (o <= r->gaps[i].lo && r->gaps[i].hi <= p)
+            return 1;
+    return 0;
+}
+
+static void room_free(struct room* r) {
+    free(r->refs);
+    free(r->gaps);
+    free(r);
+}
+
+/* --- Indeks dari record --- */
+
+static int index_event(WINEMATRIX_store* st, uint64_t loc) {
+    const struct record *rec = rec_at(st, loc);
+    uint64_t old = table_get(st, &st->events, rec_key(rec));
+    if (table_put(st, &st->events, rec_key(rec), loc) != 0)
+        return -1;
+    if (!old)
+        st->nevents++;
+    if (rec->rel_len == 0)
+        return 0;
+    if (st->nrels == st->rels_cap) {
+        size_t cap = st->rels_cap ? st->rels_cap * 2 : 1024;
+        struct rel *rels = realloc(st->rels, cap * sizeof(struct rel));
+        if (!rels)
+            return -1;
+        st->rels = rels;
+        st->rels_cap = cap;
+    }
+    struct rel *rl = &st->rels[st->nrels];
+    rl->loc = loc;
+    rl->next = (uint32_t)table_get(st, &st->rel_tab, rec_rel(rec));
+    st->nrels++;
+    return table_put(st, &st->rel_tab, rec_rel(rec), st->nrels);
+}
+
+/* Menerapkan record REC_GAP: celah baru, maju (hi turun) atau tertutup */
+static int apply_gap(WINEMATRIX_store* st, struct room* r, uint64_t loc) {
+    const struct record *rec = rec_at(st, loc);
+    uint32_t i = 0;
+    while (i < r->ngaps && r->gaps[i].lo != rec->aux)
+        i++;
+    if (rec->key_len == 0) {
+        if (i < r->ngaps) {
+            r->gaps[i] = r->gaps[--r->ngaps];
+            st->ngaps--;
+        }
+        return 0;
+    }
+    if (i == r->ngaps) {
+        if (r->ngaps == r->gaps_cap) {
+            uint32_t cap = r->gaps_cap ? r->gaps_cap * 2 : 4;
+            struct gap *gaps = realloc(r->gaps, cap * sizeof(struct gap));
+            if (!gaps)
+                return -1;
+            r->gaps = gaps;
+            r->gaps_cap = cap;
+        }
+        r->ngaps++;
+        st->ngaps++;
+    }
+    r->gaps[i].lo = rec->aux;
+    r->gaps[i].hi = rec->order;
+    r->gaps[i].loc = loc;
+    return 0;
+}
+
+/* --- Segmen --- */
+
+static void segment_path(const WINEMATRIX_store* st, size_t idx, char* out, size_t size) {
+    snprintf(out, size, "%s/%08zu.seg", st->dir, idx);
+}
+
+static struct segment* push_segment(WINEMATRIX_store* st) {
+    if (st->nsegs == st->segs_cap) {
+        size_t cap = st->segs_cap ? st->segs_cap * 2 : 8;
+        struct segment *segs = realloc(st->segs, cap * sizeof(struct segment));
+        if (!segs)
+            return NULL;
+        st->segs = segs;
+        st->segs_cap = cap;
+    }
+    struct segment *seg = &st->segs[st->nsegs];
+    memset(seg, 0, sizeof(*seg));
+    seg->fd = -1;
+    return seg;
+}
+
+/* Segmen aktif dipetakan sebesar segment_bytes; file dipotong ke used saat ditutup */
+static int map_active(struct segment* seg, size_t size) {
+    if (ftruncate(seg->fd, (off_t)size) != 0)
+        return -1;
+    void *base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, seg->fd, 0);
+    if (base == MAP_FAILED)
+        return -1;
+    seg->base = base;
+    seg->size = size;
+    return 0;
+}
+
+static int new_segment(WINEMATRIX_store* st, size_t size) {
+    if (st->nsegs > 0) {
+        /* Segmen penuh: dipotong ke isi sebenarnya, mapping tetap untuk dibaca */
+        struct segment *last = &st->segs[st->nsegs - 1];
+        msync(last->base, last->used, MS_ASYNC);
+        if (ftruncate(last->fd, (off_t)last->used) != 0)
+            perror("ftruncate");
+    }
+    struct segment *seg = push_segment(st);
+    if (!seg)
+        return -1;
+    char path[4096];
+    segment_path(st, st->nsegs, path, sizeof(path));
+    seg->fd = open(path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (seg->fd < 0 || map_active(seg, size) != 0) {
+        fprintf(stderr, "Error: gagal membuat segmen %s: %s\n", path, strerror(errno));
+        if (seg->fd >= 0)
+            close(seg->fd);
+        return -1;
+    }
+    st->nsegs++;
+    return 0;
+}
+
+/* Menulis satu record ke segmen aktif. Mengembalikan loc, 0 jika gagal */
+static uint64_t append_record(WINEMATRIX_store* st, int kind, const char* room, const char* key,
+                              const char* rel, const char* rel_type, const char* body, size_t body_len,
+                              int64_t order, int64_t aux) {
+    size_t room_len = strlen(room), key_len = strlen(key);
+    size_t rel_len = rel ? strlen(rel) : 0, rel_type_len = rel_type ? strlen(rel_type) : 0;
+    if (room_len > UINT16_MAX || key_len > UINT16_MAX || rel_len > UINT16_MAX || rel_type_len > UINT16_MAX ||
+        body_len > SEGMENT_MAX / 2)
+        return 0;
+    size_t len = sizeof(struct record) + room_len + key_len + rel_len + rel_type_len + body_len + 5;
+    len = (len + 7) & ~(size_t)7;
+
+    struct segment *seg = st->nsegs ? &st->segs[st->nsegs - 1] : NULL;
+    if (!seg || seg->used + len > seg->size) {
+        if (new_segment(st, len > st->segment_bytes ? len : st->segment_bytes) != 0)
+            return 0;
+        seg = &st->segs[st->nsegs - 1];
+    }
+    char *p = seg->base + seg->used;
+    struct record *rec = (struct record*)p;
+    memset(rec, 0, sizeof(*rec));
+    rec->len = (uint32_t)len;
+    rec->kind = (uint8_t)kind;
+    rec->room_len = (uint16_t)room_len;
+    rec->key_len = (uint16_t)key_len;
+    rec->rel_len = (uint16_t)rel_len;
+    rec->rel_type_len = (uint16_t)rel_type_len;
+    rec->body_len = (uint32_t)body_len;
+    rec->order = order;
+    rec->aux = aux;
+    char *s = (char*)(rec + 1);
+    memcpy(s, room, room_len + 1);
+    s += room_len + 1;
+    memcpy(s, key, key_len + 1);
+    s += key_len + 1;
+    if (rel_len)
+        memcpy(s, rel, rel_len);
+    s[rel_len] = '\0';
+    s += rel_len + 1;
+    if (rel_type_len)
+        memcpy(s, rel_type, rel_type_len);
+    s[rel_type_len] = '\0';
+    s += rel_type_len + 1;
+    if (body_len)
+        memcpy(s, body, body_len);
+    s[body_len] = '\0';
+    s += body_len + 1;
+    memset(s, 0, (size_t)(p + len - s));
+    rec->sum = checksum((const unsigned char*)p + 8, len - 8);
+
+    uint64_t loc = ((uint64_t)st->nsegs << 32) | seg->used;
+    seg->used += len;
+    seg->dirty = 1;
+    st->bytes += len;
+    return loc;
+}
+
+static uint64_t append_gap(WINEMATRIX_store* st, struct room* r, const char* token, int64_t lo, int64_t hi) {
+    uint64_t loc = append_record(st, REC_GAP, r->id, token ? token : "", NULL, NULL, NULL, 0, hi, lo);
+    if (loc && apply_gap(st, r, loc) != 0)
+        return 0;
+    return loc;
+}
+
+/* Record valid: panjang konsisten dan checksum cocok */
+static int record_valid(const char* p, size_t avail) {
+    const struct record *rec = (const struct record*)p;
+    if (avail < sizeof(struct record) || rec->len < sizeof(struct record) || rec->len % 8 || rec->len > avail)
+        return 0;
+    if (rec->kind < REC_EVENT || rec->kind > REC_SINCE)
+        return 0;
+    size_t need = sizeof(struct record) + (size_t)rec->room_len + rec->key_len + rec->rel_len +
+                  rec->rel_type_len + rec->body_len + 5;
+    if (need > rec->len)
+        return 0;
+    return checksum((const unsigned char*)p + 8, rec->len - 8) == rec->sum;
+}
+
+/* Memetakan dan mengindeks satu segmen yang sudah ada. Segmen terakhir
+   dipotong di record rusak pertama lalu disiapkan untuk append */
+static int load_segment(WINEMATRIX_store* st, const char* path, int last) {
+    struct segment *seg = push_segment(st);
+    if (!seg)
+        return -1;
+    seg->fd = open(path, O_RDWR | O_CLOEXEC);
+    struct stat sb;
+    if (seg->fd < 0 || fstat(seg->fd, &sb) != 0) {
+        fprintf(stderr, "Error: gagal membuka segmen %s: %s\n", path, strerror(errno));
+        if (seg->fd >= 0)
+            close(seg->fd);
+        return -1;
+    }
+    size_t size = (size_t)sb.st_size;
+    if (size > SEGMENT_MAX) {
+        fprintf(stderr, "Error: segmen %s terlalu besar\n", path);
+        close(seg->fd);
+        return -1;
+    }
+    if (size > 0) {
+        void *base = mmap(NULL, size, last ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, seg->fd, 0);
+        if (base == MAP_FAILED) {
+            fprintf(stderr, "Error: gagal mmap segmen %s: %s\n", path, strerror(errno));
+            close(seg->fd);
+            return -1;
+        }
+        seg->base = base;
+        seg->size = size;
+    }
+    st->nsegs++;
+
+    size_t off = 0;
+    while (off < size && record_valid(seg->base + off, size - off)) {
+        uint64_t loc = ((uint64_t)st->nsegs << 32) | off;
+        const struct record *rec = rec_at(st, loc);
+        off += rec->len;
+        if (rec->kind == REC_SINCE) {
+            st->since_loc = loc;
+            continue;
+        }
+        struct room *r = room_get(st, rec_room(rec));
+        if (!r)
+            return -1;
+        if (rec->kind == REC_GAP) {
+            if (apply_gap(st, r, loc) != 0)
+                return -1;
+            continue;
+        }
+        /* Ref diurutkan sekali setelah semua segmen dibaca */
+        if (reserve_refs(r, 1) != 0 || index_event(st, loc) != 0)
+            return -1;
+        r->refs[r->nrefs].order = rec->order;
+        r->refs[r->nrefs].loc = loc;
+        r->nrefs++;
+    }
+    seg->used = off;
+    st->bytes += off;
+    if (off < size && !last)
+        fprintf(stderr, "Error: segmen %s rusak setelah byte %zu, sisa segmen dilewati\n", path, off);
+    if (!last)
+        return 0;
+
+    /* Ekor yang terpotong (crash di tengah append) dibuang; area append di-nol-kan oleh ftruncate */
+    if (seg->base)
+        munmap(seg->base, seg->size);
+    seg->base = NULL;
+    if (ftruncate(seg->fd, (off_t)off) != 0 ||
+        map_active(seg, off > st->segment_bytes ? off : st->segment_bytes) != 0) {
+        fprintf(stderr, "Error: gagal menyiapkan segmen %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+static int load_segments(WINEMATRIX_store* st) {
+    size_t count = 0;
+    char path[4096];
+    for (;; count++) {
+        segment_path(st, count, path, sizeof(path));
+        if (access(path, F_OK) != 0)
+            break;
+    }
+    for (size_t i = 0; i < count; i++) {
+        segment_path(st, i, path, sizeof(path));
+        if (load_segment(st, path, i + 1 == count) != 0)
+            return -1;
+    }
+    for (size_t i = 0; i < st->nrooms; i++) {
+        struct room *r = st->rooms[i];
+        qsort(r->refs, r->nrefs, sizeof(struct ref), cmp_ref);
+    }
+    return 0;
+}
+
+/* --- Event masuk (sync dan backfill) --- */
+
+struct incoming {
+    const char *event_id;
+    const char *json;
+    size_t len;
+    const char *rel;
+    const char *rel_type;
+    int create;             /* m.room.create: awal room */
+};
+
+static const char* get_string(json_object* obj, const char* key) {
+    json_object *v;
+    if (!obj || !json_object_object_get_ex(obj, key, &v) || !json_object_is_type(v, json_type_string))
+        return NULL;
+    return json_object_get_string(v);
+}
+
+/* Mengambil ID, relasi dan JSON event. JSON diserialisasi di sini (di luar lock) */
+static int extract_event(json_object* ev, struct incoming* in) {
+    memset(in, 0, sizeof(*in));
+    in->event_id = get_string(ev, "event_id");
+    if (!in->event_id)
+        return -1;
+    const char *type = get_string(ev, "type");
+    json_object *content = NULL, *relates, *reply;
+    json_object_object_get_ex(ev, "content", &content);
+    if (type && strcmp(type, "m.room.redaction") == 0) {
+        in->rel = get_string(ev, "redacts");
+        if (!in->rel)
+            in->rel = get_string(content, "redacts");
+        in->rel_type = "m.room.redaction";
+    } else if (content && json_object_object_get_ex(content, "m.relates_to", &relates)) {
+        in->rel = get_string(relates, "event_id");
+        in->rel_type = get_string(relates, "rel_type");
+        if ((!in->rel || !in->rel_type) && json_object_object_get_ex(relates, "m.in_reply_to", &reply)) {
+            in->rel = get_string(reply, "event_id");
+            in->rel_type = "m.in_reply_to";
+        }
+        if (!in->rel || !in->rel_type)
+            in->rel = in->rel_type = NULL;
+    }
+    in->create = type && strcmp(type, "m.room.create") == 0;
+    in->json = json_object_to_json_string_length(ev, JSON_C_TO_STRING_PLAIN, &in->len);
+    return in->json ? 0 : -1;
+}
+
+static size_t extract_events(json_object* events, struct incoming** out) {
+    *out = NULL;
+    if (!events || !json_object_is_type(events, json_type_array))
+        return 0;
+    size_t n = json_object_array_length(events), count = 0;
+    struct incoming *in = n ? malloc(n * sizeof(struct incoming)) : NULL;
+    if (!in)
+        return 0;
+    for (size_t i = 0; i < n; i++)
+        if (extract_event(json_object_array_get_idx(events, i), &in[count]) == 0)
+            count++;
+    *out = in;
+    return count;
+}
+
+static uint64_t append_event(WINEMATRIX_store* st, const char* room_id, const struct incoming* in, int64_t order) {
+    uint64_t loc = append_record(st, REC_EVENT, room_id, in->event_id, in->rel, in->rel_type, in->json, in->len,
+                                 order, 0);
+    if (!loc || index_event(st, loc) != 0)
+        return 0;
+    return loc;
+}
+
+/* Timeline satu room dari /sync, event terlama dulu. Mengembalikan event baru, -1 jika gagal */
+static int apply_timeline(WINEMATRIX_store* st, const char* room_id, const struct incoming* in, size_t n,
+                          int limited, const char* prev_batch) {
+    size_t first = 0;
+    while (first < n && table_get(st, &st->events, in[first].event_id))
+        first++;
+    if (first == n)
+        return 0;
+
+    /* Room baru: riwayat sebelum prev_batch belum diketahui sampai awal room.
+       Timeline limited yang tidak menyambung: event baru diberi jarak ORDER_STEP
+       dan celah di antaranya diisi backfill dengan order turun dari atas. */
+    struct room *r = room_find(st, room_id);
+    int64_t base = 0, lo = ORDER_START;
+    int gap = prev_batch != NULL;
+    if (r && r->nrefs) {
+        lo = r->refs[r->nrefs - 1].order;
+        gap = gap && limited && first == 0;
+        base = lo + (gap ? ORDER_STEP : 1);
+    }
+
+    struct ref *refs = malloc((n - first) * sizeof(struct ref));
+    if (!refs)
+        return -1;
+    size_t count = 0;
+    int ret = 0;
+    for (size_t i = first; i < n && ret == 0; i++) {
+        if (count && table_get(st, &st->events, in[i].event_id))
+            continue;
+        /* Room pertama kali dicatat memakai ID di record event pertamanya */
+        uint64_t loc = append_event(st, r ? r->id : room_id, &in[i], base + (int64_t)count);
+        if (!loc || (!r && !(r = room_get(st, rec_room(rec_at(st, loc)))))) {
+            ret = -1;
+            break;
+        }
+        refs[count].order = base + (int64_t)count;
+        refs[count].loc = loc;
+        count++;
+    }
+    if (r && insert_refs(r, refs, count) != 0)
+        ret = -1;
+    free(refs);
+    if (ret == 0 && gap && !append_gap(st, r, prev_batch, lo, base))
+        ret = -1;
+    return ret < 0 ? -1 : (int)count;
+}
+
+/* --- API --- */
+
+WINEMATRIXcode
+WINEMATRIX_store* WINEMATRIX_store_open(const char* dir, size_t segment_bytes)
+{
+    if (!dir)
+        return NULL;
+    if (mkdir(dir, 0755) != 0 && errno != EEXIST) {
+        fprintf(stderr, "Error: gagal membuat direktori store %s: %s\n", dir, strerror(errno));
+        return NULL;
+    }
+    WINEMATRIX_store *st = calloc(1, sizeof(WINEMATRIX_store));
+    if (!st)
+        return NULL;
+    pthread_rwlock_init(&st->lock, NULL);
+    st->events.kind = TAB_EVENTS;
+    st->room_tab.kind = TAB_ROOMS;
+    st->rel_tab.kind = TAB_RELS;
+    st->segment_bytes = segment_bytes ? segment_bytes : SEGMENT_BYTES;
+    if (st->segment_bytes > SEGMENT_MAX)
+        st->segment_bytes = SEGMENT_MAX;
+    st->segment_bytes = (st->segment_bytes + 4095) & ~(size_t)4095;
+    st->dir = strdup(dir);
+    if (!st->dir || load_segments(st) != 0) {
+        WINEMATRIX_store_close(st);
+        return NULL;
+    }
+    return st;
+}
+
+WINEMATRIXcode
+int WINEMATRIX_store_apply_sync(WINEMATRIX_store* store, const char* sync_json)
+{
+    if (!store || !sync_json)
+        return -1;
+    json_object *root = json_tokener_parse(sync_json);
+    if (!root) {
+        fprintf(stderr, "Error: respons /sync bukan JSON yang valid\n");
+        return -1;
+    }
+    int added = WINEMATRIX_store_apply_sync_object(store, root);
+    json_object_put(root);
+    return added;
+}
+
+WINEMATRIXcode
+int WINEMATRIX_store_apply_sync_object(WINEMATRIX_store* store, struct json_object* root)
+{
+    if (!store || !root)
+        return -1;
+    int added = 0;
+    json_object *rooms, *join;
+    if (json_object_object_get_ex(root, "rooms", &rooms) && json_object_object_get_ex(rooms, "join", &join) &&
+        json_object_is_type(join, json_type_object)) {
+        struct json_object_iterator it = json_object_iter_begin(join), end = json_object_iter_end(join);
+        for (; !json_object_iter_equal(&it, &end) && added >= 0; json_object_iter_next(&it)) {
+            json_object *timeline, *events = NULL, *limited = NULL;
+            if (!json_object_object_get_ex(json_object_iter_peek_value(&it), "timeline", &timeline))
+                continue;
+            json_object_object_get_ex(timeline, "events", &events);
+            json_object_object_get_ex(timeline, "limited", &limited);
+            struct incoming *in;
+            size_t n = extract_events(events, &in);
+            if (n > 0) {
+                pthread_rwlock_wrlock(&store->lock);
+                int ret = apply_timeline(store, json_object_iter_peek_name(&it), in, n,
+                                         limited && json_object_get_boolean(limited),
+                                         get_string(timeline, "prev_batch"));
+                pthread_rwlock_unlock(&store->lock);
+                added = ret < 0 ? -1 : added + ret;
+            }
+            free(in);
+        }
+    }
+    const char *next_batch = get_string(root, "next_batch");
+    if (added >= 0 && next_batch) {
+        pthread_rwlock_wrlock(&store->lock);
+        uint64_t loc = append_record(store, REC_SINCE, "", next_batch, NULL, NULL, NULL, 0, 0, 0);
+        if (loc)
+            store->since_loc = loc;
+        pthread_rwlock_unlock(&store->lock);
+        if (!loc)
+            added = -1;
+    }
+    if (added < 0)
+        fprintf(stderr, "Error: gagal menulis event ke store %s\n", store->dir);
+    return added;
+}
+
+/* Lock baca untuk query; const dilepas hanya untuk rwlock */
+static void read_lock(const WINEMATRIX_store* st) {
+    pthread_rwlock_rdlock(&((WINEMATRIX_store*)st)->lock);
+}
+
+static void read_unlock(const WINEMATRIX_store* st) {
+    pthread_rwlock_unlock(&((WINEMATRIX_store*)st)->lock);
+}
+
+WINEMATRIXcode
+const char* WINEMATRIX_store_since(const WINEMATRIX_store* store)
+{
+    if (!store)
+        return NULL;
+    read_lock(store);
+    const char *since = store->since_loc ? rec_key(rec_at(store, store->since_loc)) : NULL;
+    read_unlock(store);
+    return since;
+}
+
+WINEMATRIXcode
+const char* WINEMATRIX_store_get(const WINEMATRIX_store* store, const char* event_id)
+{
+    if (!store || !event_id)
+        return NULL;
+    read_lock(store);
+    uint64_t loc = table_get(store, &store->events, event_id);
+    const char *json = loc ? rec_body(rec_at(store, loc)) : NULL;
+    read_unlock(store);
+    return json;
+}
+
+WINEMATRIXcode
+size_t WINEMATRIX_store_messages(const WINEMATRIX_store* store, const char* room_id, const char* before_event_id,
+                                 size_t limit, void (*cb)(const char* event_json, void* user_data),
+                                 void* user_data)
+{
+    if (!store || !room_id || !cb)
+        return 0;
+    size_t count = 0;
+    read_lock(store);
+    const struct room *r = room_find(store, room_id);
+    size_t pos = r ? r->nrefs : 0;
+    int64_t prev = INT64_MAX;
+    if (r && before_event_id) {
+        uint64_t loc = table_get(store, &store->events, before_event_id);
+        const struct record *rec = loc ? rec_at(store, loc) : NULL;
+        if (rec && strcmp(rec_room(rec), room_id) == 0) {
+            prev = rec->order;
+            pos = ref_pos(r, prev);
+        } else {
+            pos = 0;
+        }
+    }
+    for (; pos > 0 && count < limit; pos--, count++) {
+        const struct ref *ref = &r->refs[pos - 1];
+        if (gap_between(r, ref->order, prev))
+            break;
+        cb(rec_body(rec_at(store, ref->loc)), user_data);
+        prev = ref->order;
+    }
+    read_unlock(store);
+    return count;
+}
+
+WINEMATRIXcode
+size_t WINEMATRIX_store_relations(const WINEMATRIX_store* store, const char* event_id, const char* rel_type,
+                                  void (*cb)(const char* event_json, void* user_data), void* user_data)
+{
+    if (!store || !event_id || !cb)
+        return 0;
+    size_t count = 0;
+    read_lock(store);
+    for (uint64_t i = table_get(store, &store->rel_tab, event_id); i; i = store->rels[i - 1].next) {
+        const struct record *rec = rec_at(store, store->rels[i - 1].loc);
+        if (rel_type && strcmp(rec_rel_type(rec), rel_type) != 0)
+            continue;
+        cb(rec_body(rec), user_data);
+        count++;
+    }
+    read_unlock(store);
+    return count;
+}
+
+WINEMATRIXcode
+size_t WINEMATRIX_store_room_events(const WINEMATRIX_store* store, const char* room_id)
+{
+    if (!store || !room_id)
+        return 0;
+    read_lock(store);
+    const struct room *r = room_find(store, room_id);
+    size_t n = r ? r->nrefs : 0;
+    read_unlock(store);
+    return n;
+}
+
+WINEMATRIXcode
+size_t WINEMATRIX_store_room_gaps(const WINEMATRIX_store* store, const char* room_id)
+{
+    if (!store || !room_id)
+        return 0;
+    read_lock(store);
+    const struct room *r = room_find(store, room_id);
+    size_t n = r ? r->ngaps : 0;
+    read_unlock(store);
+    return n;
+}
+
+WINEMATRIXcode
+void WINEMATRIX_store_get_stats(const WINEMATRIX_store* store, WINEMATRIX_store_stats* out)
+{
+    if (!out)
+        return;
+    memset(out, 0, sizeof(*out));
+    if (!store)
+        return;
+    read_lock(store);
+    out->segments = store->nsegs;
+    out->bytes = store->bytes;
+    out->rooms = store->nrooms;
+    out->events = store->nevents;
+    out->relations = store->nrels;
+    out->gaps = store->ngaps;
+    size_t bytes = store->rooms_cap * sizeof(struct room*) + store->rels_cap * sizeof(struct rel) +
+                   (store->events.slots ? store->events.mask + 1 : 0) * sizeof(struct slot) +
+                   (store->room_tab.slots ? store->room_tab.mask + 1 : 0) * sizeof(struct slot) +
+                   (store->rel_tab.slots ? store->rel_tab.mask + 1 : 0) * sizeof(struct slot);
+    for (size_t i = 0; i < store->nrooms; i++) {
+        const struct room *r = store->rooms[i];
+        bytes += sizeof(struct room) + r->refs_cap * sizeof(struct ref) + r->gaps_cap * sizeof(struct gap);
+    }
+    out->index_bytes = bytes;
+    read_unlock(store);
+}
+
+WINEMATRIXcode
+int WINEMATRIX_store_flush(WINEMATRIX_store* store)
+{
+    if (!store)
+        return -1;
+    int ret = 0;
+    pthread_rwlock_wrlock(&store->lock);
+    for (size_t i = 0; i < store->nsegs; i++) {
+        struct segment *seg = &store->segs[i];
+        if (!seg->dirty)
+            continue;
+        if (msync(seg->base, seg->used, MS_SYNC) != 0) {
+            perror("msync");
+            ret = -1;
+            continue;
+        }
+        seg->dirty = 0;
+    }
+    pthread_rwlock_unlock(&store->lock);
+    return ret;
+}
+
+WINEMATRIXcode
+void WINEMATRIX_store_close(WINEMATRIX_store* store)
+{
+    if (!store)
+        return;
+    WINEMATRIX_store_flush(store);
+    for (size_t i = 0; i < store->nsegs; i++) {
+        struct segment *seg = &store->segs[i];
+        if (seg->base)
+            munmap(seg->base, seg->size);
+        /* Segmen aktif berukuran segment_bytes selama dipakai */
+        if (i + 1 == store->nsegs && ftruncate(seg->fd, (off_t)seg->used) != 0)
+            perror("ftruncate");
+        close(seg->fd);
+    }
+    for (size_t i = 0; i < store->nrooms; i++)
+        room_free(store->rooms[i]);
+    free(store->rooms);
+    free(store->rels);
+    free(store->events.slots);
+    free(store->room_tab.slots);
+    free(store->rel_tab.slots);
+    free(store->segs);
+    free(store->dir);
+    pthread_rwlock_destroy(&store->lock);
+    free(store);
+}
+
+/* --- Backfill dari /messages --- */
+
+struct backfill {
+    WINEMATRIX_handle *handle;
+    WINEMATRIX_store *st;
+    const char *const *room_ids;
+    size_t nrooms;
+    size_t next;            /* Room berikutnya, diambil atomik oleh worker */
+    unsigned page_limit, max_pages, max_retries;
+    long added;
+};
+
+static void sleep_ms(long ms) {
+    struct timespec ts = { ms / 1000, (ms % 1000) * 1000000L };
+    while (nanosleep(&ts, &ts) != 0 && errno == EINTR)
+        ;
+}
+
+/* Satu halaman /messages mundur dari token. Mengembalikan body respons, NULL jika gagal */
+static char* fetch_page(struct backfill* b, const char* room_id, const char* token) {
+    WINEMATRIX_handle *h = b->handle;
+    char *room = curl_easy_escape(NULL, room_id, 0);
+    char *from = curl_easy_escape(NULL, token, 0);
+    size_t url_len = strlen(h->homeserver) + strlen(h->access_token) + (room ? strlen(room) : 0) +
+                     (from ? strlen(from) : 0) + 150;
+    char *url = malloc(url_len);
+    if (!room || !from || !url) {
+        curl_free(room);
+        curl_free(from);
+        free(url);
+        return NULL;
+    }
+    int len = snprintf(url, url_len, MESSAGES_URL_FORMAT, h->homeserver, room, h->access_token, b->page_limit);
+    snprintf(url + len, url_len - (size_t)len, "&from=%s", from);
+    curl_free(room);
+    curl_free(from);
+
+    char *body = NULL;
+    for (unsigned attempt = 0; attempt <= b->max_retries; attempt++) {
+        struct MemoryStruct chunk = { malloc(1), 0, 0 };
+        if (!chunk.memory)
+            break;
+        int ret = perform_http_request(h->metrics, url, NULL, "GET", &chunk);
+        if (ret == 0 && chunk.status == 200 && chunk.size > 0) {
+            body = chunk.memory;
+            break;
+        }
+        long wait = 0;
+        if (ret != 0 || chunk.status >= 500) {
+            wait = 100L << (attempt < 5 ? attempt : 5);
+        } else if (chunk.status == 429) {
+            json_object *err = json_tokener_parse(chunk.memory), *retry;
+            wait = err && json_object_object_get_ex(err, "retry_after_ms", &retry) ? json_object_get_int64(retry)
+                                                                                : 1000;
+            json_object_put(err);
+        } else {
+            fprintf(stderr, "Gagal backfill %s. Respons: %s\n", room_id, chunk.size ? chunk.memory : "(kosong)");
+            free(chunk.memory);
+            break;
+        }
+        free(chunk.memory);
+        if (attempt < b->max_retries)
+            sleep_ms(wait);
+    }
+    free(url);
+    return body;
+}
+
+/* Menerapkan satu halaman (terbaru dulu) ke celah (lo, hi) room. Mengembalikan event baru, -1 jika gagal */
+static int apply_page(WINEMATRIX_store* st, struct room* r, int64_t lo, int64_t hi,
+                      const struct incoming* in, size_t n, const char* end) {
+    uint32_t g = 0;
+    while (g < r->ngaps && r->gaps[g].lo != lo)
+        g++;
+    if (g == r->ngaps || r->gaps[g].hi != hi)
+        return 0;
+    struct ref *refs = n ? malloc(n * sizeof(struct ref)) : NULL;
+    if (n && !refs)
+        return -1;
+    size_t count = 0;
+    int closed = 0;
+    for (size_t i = 0; i < n && !closed; i++) {
+        /* Event yang sudah ada berarti celah bertemu riwayat yang tersimpan */
+        if (table_get(st, &st->events, in[i].event_id) || hi - 1 <= lo) {
+            closed = 1;
+            break;
+        }
+        uint64_t loc = append_event(st, r->id, &in[i], hi - 1);
+        if (!loc) {
+            free(refs);
+            return -1;
+        }
+        refs[n - 1 - count].order = --hi;
+        refs[n - 1 - count].loc = loc;
+        count++;
+        closed = in[i].create;
+    }
+    /* Halaman kosong atau tanpa token end: awal room sudah tercapai */
+    closed = closed || n == 0 || !end;
+    int ret = insert_refs(r, refs + n - count, count);
+    free(refs);
+    if (ret != 0 || !append_gap(st, r, closed ? "" : end, lo, hi))
+        return -1;
+    return (int)count;
+}
+
+static void backfill_room(struct backfill* b, const char* room_id) {
+    WINEMATRIX_store *st = b->st;
+    pthread_rwlock_wrlock(&st->lock);
+    struct room *r = room_find(st, room_id);
+    int claimed = r && !r->claimed;
+    if (claimed)
+        r->claimed = 1;
+    pthread_rwlock_unlock(&st->lock);
+    if (!claimed)
+        return;
+
+    for (unsigned page = 0; !b->max_pages || page < b->max_pages; page++) {
+        /* Celah terbaru dulu: scrollback membutuhkannya lebih dulu */
+        pthread_rwlock_rdlock(&st->lock);
+        const struct gap *gap = NULL;
+        for (uint32_t i = 0; i < r->ngaps; i++)
+            if (!gap || r->gaps[i].hi > gap->hi)
+                gap = &r->gaps[i];
+        int64_t lo = gap ? gap->lo : 0, hi = gap ? gap->hi : 0;
+        const char *token = gap ? rec_key(rec_at(st, gap->loc)) : NULL;
+        pthread_rwlock_unlock(&st->lock);
+        if (!gap)
+            break;
+
+        char *body = fetch_page(b, room_id, token);
+        json_object *root = body ? json_tokener_parse(body) : NULL, *chunk = NULL;
+        free(body);
+        if (!root)
+            break;
+        json_object_object_get_ex(root, "chunk", &chunk);
+        struct incoming *in;
+        size_t n = extract_events(chunk, &in);
+        const char *end = get_string(root, "end");
+        /* Token yang tidak maju berarti tidak ada halaman berikutnya */
+        if (end && strcmp(end, token) == 0)
+            end = NULL;
+        pthread_rwlock_wrlock(&st->lock);
+        int added = apply_page(st, r, lo, hi, in, n, end);
+        pthread_rwlock_unlock(&st->lock);
+        free(in);
+        json_object_put(root);
+        if (added < 0) {
+            fprintf(stderr, "Error: gagal menulis backfill %s ke store\n", room_id);
+            break;
+        }
+        __atomic_add_fetch(&b->added, added, __ATOMIC_RELAXED);
+    }
+
+    pthread_rwlock_wrlock(&st->lock);
+    r->claimed = 0;
+    pthread_rwlock_unlock(&st->lock);
+}
+
+static void* backfill_worker(void* arg) {
+    struct backfill *b = arg;
+    size_t i;
+    while ((i = __atomic_fetch_add(&b->next, 1, __ATOMIC_RELAXED)) < b->nrooms)
+        backfill_room(b, b->room_ids[i]);
+    return NULL;
+}
+
+/* Mengisi celah riwayat room dari /messages (lihat matrix_driver.h) */
+WINEMATRIXcode
+long WINEMATRIX_backfill(WINEMATRIX_handle* handle, const char* const* room_ids, size_t nrooms,
+                         const WINEMATRIX_backfill_config* config)
+{
+    if (!handle || !handle->access_token || !handle->store || (nrooms && !room_ids))
+        return -1;
+    struct backfill b = { 0 };
+    b.handle = handle;
+    b.st = handle->store;
+    b.room_ids = room_ids;
+    b.nrooms = nrooms;
+    b.page_limit = config && config->page_limit ? config->page_limit : 100;
+    b.max_pages = config ? config->max_pages : 0;
+    b.max_retries = config && config->max_retries ? config->max_retries : 5;
+    size_t workers = config && config->parallelism ? config->parallelism : 4;
+    if (workers > nrooms)
+        workers = nrooms;
+
+    pthread_t *threads = workers > 1 ? calloc(workers - 1, sizeof(pthread_t)) : NULL;
+    size_t started = 0;
+    for (; threads && started < workers - 1; started++)
+        if (pthread_create(&threads[started], NULL, backfill_worker, &b) != 0)
+            break;
+    /* Thread pemanggil ikut menjadi worker */
+    backfill_worker(&b);
+    for (size_t i = 0; i < started; i++)
+        pthread_join(threads[i], NULL);
+    free(threads);
+    return b.added;
+}
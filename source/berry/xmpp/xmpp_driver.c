@@ -0,0 +1,875 @@
+#include "xmpp_driver.h"
+#include "xmpp_sasl.h"
+#include "log.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <errno.h>
+#include <poll.h>
+#include <time.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+
+#define NEGOTIATE_TIMEOUT_MS 15000
+#define KEEPALIVE_TICK_MS    5000
+#define KEEPALIVE_IDLE_MS    30000
+#define SM_REQUEST_EVERY     10         /* Minta ack setiap N stanza keluar */
+#define SM_REQUEST_IDLE_MS   10000      /* ... atau jika masih ada unacked setelah sekian lama */
+#define SELF_PING_IDLE_MS    (10 * 60 * 1000)   /* Room sepi selama ini di-self-ping */
+#define SELF_PING_TIMEOUT_MS 60000
+#define SELF_PING_ID         "selfping-"
+
+/* State negosiasi stream (RFC 6120) */
+enum {
+    XS_FEATURES,        /* Menunggu <stream:features> pertama */
+    XS_AUTH,            /* <auth> terkirim, menunggu <success>/<failure> */
+    XS_FEATURES_AUTHED, /* Stream di-restart, menunggu features kedua */
+    XS_RESUME,          /* <resume/> terkirim, menunggu <resumed>/<failed> */
+    XS_BIND,            /* Menunggu hasil resource binding */
+    XS_READY,           /* Siap kirim/terima stanza */
+    XS_FAILED,
+    XS_CLOSED
+};
+
+/* Fitur stream setelah autentikasi */
+#define FEAT_BIND 0x1
+#define FEAT_SM   0x2
+
+/* --- Global Init & Cleanup --- */
+WINEXMPPcode WINEXMPP_global_init(void) {
+    return 0;
+}
+
+WINEXMPPcode WINEXMPP_global_cleanup(void) {
+    return 0;
+}
+
+/* --- Fungsi Helper: Membuat koneksi TCP ke server XMPP --- */
+static int create_connection(const char* server, int port) {
+    int sockfd;
+    struct sockaddr_in serv_addr;
+    struct hostent *server_host;
+
+    server_host = gethostbyname(server);
+    if (server_host == NULL) {
+        fprintf(stderr, "Error: host tidak ditemukan: %s\n", server);
+        return -1;
+    }
+    sockfd = socket(AF_INET, SOCK_STREAM, 0);
+    if (sockfd < 0) {
+        perror("Error membuka socket");
+        return -1;
+    }
+    memset(&serv_addr, 0, sizeof(serv_addr));
+    serv_addr.sin_family = AF_INET;
+    memcpy(&serv_addr.sin_addr.s_addr, server_host->h_addr, server_host->h_length);
+    serv_addr.sin_port = htons(port);
+
+    if (connect(sockfd, (struct sockaddr*)&serv_addr, sizeof(serv_addr)) < 0) {
+        perror("Error koneksi");
+        close(sockfd);
+        return -1;
+    }
+    return sockfd;
+}
+
+/* --- Fungsi Helper: escape ke buffer baru (caller free) --- */
+static char* escape_dup(const char* s) {
+    size_t cap = strlen(s) * 6 + 1;
+    char *out = malloc(cap);
+    if (out && WINEXMPP_escape(s, out, cap) < 0) {
+        free(out);
+        return NULL;
+    }
+    return out;
+}
+
+static long now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000L + ts.tv_nsec / 1000000L;
+}
+
+/* --- Menulis data mentah sampai habis (nonza: header, SASL, <r/>, <a/>) --- */
+static int write_all(WINEXMPP_handle* handle, const char* data, size_t len) {
+    if (!handle->is_connected)
+        return -1;
+    size_t off = 0;
+    while (off < len) {
+        ssize_t n = send(handle->socket_fd, data + off, len - off, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            perror("Error mengirim data XMPP");
+            return -1;
+        }
+        off += (size_t)n;
+    }
+    WINEB2B_metrics_add(handle->metrics, WINEB2B_METRIC_BYTES_OUT, len);
+    handle->last_send_ms = now_ms();
+    return 0;
+}
+
+static int write_str(WINEXMPP_handle* handle, const char* data) {
+    return write_all(handle, data, strlen(data));
+}
+
+/* --- Mengirim stanza: dicatat di antrean SM lebih dulu --- */
+static int send_stanza(WINEXMPP_handle* handle, const char* xml) {
+    size_t len = strlen(xml);
+    if (handle->sm_enabled && WINEXMPP_sm_outbound(handle->sm, xml, len) != 0) {
+        /* Antrean penuh: stanza tetap dihitung agar ack server cocok, tapi
+           sesi tidak bisa di-resume tanpa kehilangan stanza */
+        free(handle->sm_id);
+        handle->sm_id = NULL;
+    }
+    if (write_all(handle, xml, len) != 0)
+        return -1;
+    if (handle->sm_enabled && ++handle->sm_since_request >= SM_REQUEST_EVERY)
+        WINEXMPP_request_ack(handle);
+    return 0;
+}
+
+WINEXMPPcode WINEXMPP_send_raw(WINEXMPP_handle* handle, const char* xml) {
+    if (!handle || !xml)
+        return -1;
+    if (!handle->is_connected) {
+        /* Sesi yang bisa di-resume tetap menerima stanza; dikirim setelah <resumed/> */
+        if (handle->sm_enabled && handle->sm_id) {
+            if (WINEXMPP_sm_outbound(handle->sm, xml, strlen(xml)) == 0)
+                return 0;
+            free(handle->sm_id);
+            handle->sm_id = NULL;
+        }
+        return -1;
+    }
+    return send_stanza(handle, xml);
+}
+
+WINEXMPPcode WINEXMPP_request_ack(WINEXMPP_handle* handle) {
+    if (!handle || !handle->sm_enabled)
+        return -1;
+    handle->sm_since_request = 0;
+    handle->sm_request_ms = now_ms();
+    return write_str(handle, "<r xmlns='" WINEXMPP_NS_SM "'/>");
+}
+
+static int send_stream_header(WINEXMPP_handle* handle) {
+    char buffer[512];
+    snprintf(buffer, sizeof(buffer),
+             "<?xml version='1.0'?><stream:stream to='%s' version='1.0' xml:lang='en' "
+             "xmlns='" WINEXMPP_NS_CLIENT "' xmlns:stream='" WINEXMPP_NS_STREAMS "'>",
+             handle->domain);
+    return write_str(handle, buffer);
+}
+
+/* --- MUC --- */
+static WINEXMPP_muc* find_muc(WINEXMPP_handle* handle, const char* room, size_t len) {
+    for (int i = 0; i < handle->muc_count; i++) {
+        if (strlen(handle->mucs[i].room) == len && strncasecmp(handle->mucs[i].room, room, len) == 0)
+            return &handle->mucs[i];
+    }
+    return NULL;
+}
+
+/* MUC asal stanza berdasarkan atribut from (room atau room/nick) */
+static WINEXMPP_muc* muc_from(WINEXMPP_handle* handle, const char* from) {
+    if (!from || handle->muc_count == 0)
+        return NULL;
+    const char *slash = strchr(from, '/');
+    return find_muc(handle, from, slash ? (size_t)(slash - from) : strlen(from));
+}
+
+static int send_muc_presence(WINEXMPP_handle* handle, const WINEXMPP_muc* muc) {
+    char *to = malloc(strlen(muc->room) + strlen(muc->nick) + 2);
+    if (!to)
+        return -1;
+    sprintf(to, "%s/%s", muc->room, muc->nick);
+    char *eto = escape_dup(to);
+    free(to);
+    if (!eto)
+        return -1;
+    size_t cap = strlen(eto) + 160;
+    char *buffer = malloc(cap);
+    if (!buffer) {
+        free(eto);
+        return -1;
+    }
+    snprintf(buffer, cap,
+             "<presence to='%s'><x xmlns='" WINEXMPP_NS_MUC "'><history maxstanzas='0'/></x></presence>", eto);
+    int rc = send_stanza(handle, buffer);
+    free(eto);
+    free(buffer);
+    return rc;
+}
+
+static void rejoin_muc(WINEXMPP_handle* handle, WINEXMPP_muc* muc) {
+    muc->ping_sent_ms = 0;
+    muc->last_seen_ms = now_ms();
+    handle->stats.rejoins++;
+    send_muc_presence(handle, muc);
+}
+
+static int send_self_ping(WINEXMPP_handle* handle, WINEXMPP_muc* muc) {
+    size_t cap = (strlen(muc->room) + strlen(muc->nick)) * 6 + 192;
+    char *buffer = malloc(cap);
+    char *eroom = escape_dup(muc->room), *enick = escape_dup(muc->nick);
+    int rc = -1;
+    if (buffer && eroom && enick) {
+        /* ID memuat indeks room agar jawaban bisa dicocokkan tanpa tabel tambahan */
+        snprintf(buffer, cap, "<iq type='get' id='" SELF_PING_ID "%d' to='%s/%s'><ping xmlns='" WINEXMPP_NS_PING "'/></iq>",
+                 (int)(muc - handle->mucs), eroom, enick);
+        rc = send_stanza(handle, buffer);
+        if (rc == 0) {
+            muc->ping_sent_ms = now_ms();
+            handle->stats.self_pings++;
+        }
+    }
+    free(buffer);
+    free(eroom);
+    free(enick);
+    return rc;
+}
+
+/* Menafsirkan jawaban self-ping sesuai XEP-0410 */
+static void self_ping_result(WINEXMPP_handle* handle, const WINEXMPP_stanza* iq, const char* id) {
+    int index = atoi(id + strlen(SELF_PING_ID));
+    if (index < 0 || index >= handle->muc_count)
+        return;
+    WINEXMPP_muc *muc = &handle->mucs[index];
+    muc->ping_sent_ms = 0;
+    muc->last_seen_ms = now_ms();
+    const char *type = WINEXMPP_stanza_attr(iq, "type");
+    if (type && strcmp(type, "result") == 0)
+        return;
+    WINEXMPP_stanza *error = WINEXMPP_stanza_child(iq, "error", NULL);
+    const char *cond = error && error->children ? error->children->name : "";
+    /* Masih di-join: klien target tidak mendukung ping, atau nick baru saja berubah */
+    if (strcmp(cond, "service-unavailable") == 0 || strcmp(cond, "feature-not-implemented") == 0 ||
+        strcmp(cond, "item-not-found") == 0)
+        return;
+    /* Service MUC tidak terjangkau: jangan rejoin sekarang, coba lagi nanti */
+    if (strcmp(cond, "remote-server-not-found") == 0 || strcmp(cond, "remote-server-timeout") == 0)
+        return;
+    fprintf(stderr, "Self-ping %s gagal (%s), join ulang\n", muc->room, *cond ? cond : "tanpa kondisi");
+    rejoin_muc(handle, muc);
+}
+
+WINEXMPPcode WINEXMPP_muc_self_ping(WINEXMPP_handle* handle, const char* room) {
+    if (!handle || handle->state != XS_READY)
+        return -1;
+    int rc = 0;
+    for (int i = 0; i < handle->muc_count; i++) {
+        if (room && strcasecmp(handle->mucs[i].room, room) != 0)
+            continue;
+        if (send_self_ping(handle, &handle->mucs[i]) != 0)
+            rc = -1;
+    }
+    return rc;
+}
+
+/* --- Langkah negosiasi --- */
+static void start_auth(WINEXMPP_handle* handle, const WINEXMPP_stanza* features) {
+    WINEXMPP_stanza *mechs = WINEXMPP_stanza_child(features, "mechanisms", WINEXMPP_NS_SASL);
+    int has_plain = 0;
+    for (WINEXMPP_stanza *m = mechs ? mechs->children : NULL; m; m = m->next) {
+        if (strcmp(m->name, "mechanism") == 0 && strcmp(m->text, "PLAIN") == 0)
+            has_plain = 1;
+    }
+    if (!has_plain) {
+        fprintf(stderr, "Error: server tidak menawarkan SASL PLAIN%s\n",
+                WINEXMPP_stanza_child(features, "starttls", NULL) ? " (STARTTLS belum didukung)" : "");
+        handle->state = XS_FAILED;
+        return;
+    }
+    char response[1024];
+    if (WINEXMPP_sasl_plain(NULL, handle->username, handle->password, response, sizeof(response)) < 0) {
+        fprintf(stderr, "Error: kredensial terlalu panjang\n");
+        handle->state = XS_FAILED;
+        return;
+    }
+    char buffer[1200];
+    snprintf(buffer, sizeof(buffer),
+             "<auth xmlns='" WINEXMPP_NS_SASL "' mechanism='PLAIN'>%s</auth>", response);
+    memset(response, 0, sizeof(response));
+    handle->state = write_str(handle, buffer) == 0 ? XS_AUTH : XS_FAILED;
+    memset(buffer, 0, sizeof(buffer));
+}
+
+static void start_bind(WINEXMPP_handle* handle) {
+    if (!(handle->features & FEAT_BIND)) {
+        fprintf(stderr, "Error: server tidak menawarkan resource binding\n");
+        handle->state = XS_FAILED;
+        return;
+    }
+    char *resource = escape_dup(handle->resource);
+    if (!resource) {
+        handle->state = XS_FAILED;
+        return;
+    }
+    char buffer[1024];
+    snprintf(buffer, sizeof(buffer),
+             "<iq type='set' id='bind-1'><bind xmlns='" WINEXMPP_NS_BIND "'><resource>%s</resource></bind></iq>",
+             resource);
+    free(resource);
+    handle->state = write_str(handle, buffer) == 0 ? XS_BIND : XS_FAILED;
+}
+
+/* Setelah <stream:features> kedua: lanjutkan sesi lama jika bisa, jika tidak bind baru */
+static void after_auth_features(WINEXMPP_handle* handle, const WINEXMPP_stanza* features) {
+    handle->features = 0;
+    if (WINEXMPP_stanza_child(features, "bind", WINEXMPP_NS_BIND))
+        handle->features |= FEAT_BIND;
+    if (WINEXMPP_stanza_child(features, "sm", WINEXMPP_NS_SM))
+        handle->features |= FEAT_SM;
+
+    if ((handle->features & FEAT_SM) && handle->sm_id) {
+        char *previd = escape_dup(handle->sm_id);
+        if (previd) {
+            char buffer[512];
+            snprintf(buffer, sizeof(buffer), "<resume xmlns='" WINEXMPP_NS_SM "' h='%u' previd='%s'/>",
+                     WINEXMPP_sm_handled(handle->sm), previd);
+            free(previd);
+            handle->state = write_str(handle, buffer) == 0 ? XS_RESUME : XS_FAILED;
+            return;
+        }
+    }
+    start_bind(handle);
+}
+
+static int retransmit_one(const char* xml, size_t len, void* user) {
+    WINEXMPP_handle *handle = user;
+    handle->stats.retransmitted++;
+    return write_all(handle, xml, len) != 0;
+}
+
+static int stash_one(const char* xml, size_t len, void* user) {
+    return WINEXMPP_sm_outbound((WINEXMPP_sm*)user, xml, len) != 0;
+}
+
+static void finish_resume(WINEXMPP_handle* handle, const WINEXMPP_stanza* s) {
+    if (strcmp(s->name, "resumed") == 0) {
+        /* Sesi lama berlanjut: buang yang sudah diterima server, kirim ulang sisanya */
+        const char *h = WINEXMPP_stanza_attr(s, "h");
+        if (h) {
+            int acked = WINEXMPP_sm_ack(handle->sm, (uint32_t)strtoul(h, NULL, 10));
+            if (acked > 0)
+                handle->stats.acked += (unsigned long)acked;
+        }
+        WINEXMPP_sm_foreach_unacked(handle->sm, retransmit_one, handle);
+        handle->stats.resumes++;
+        handle->resumed = 1;
+        handle->state = XS_READY;
+    } else if (strcmp(s->name, "failed") == 0) {
+        /* Sesi sudah kedaluwarsa di server: simpan unacked untuk dikirim setelah join ulang */
+        handle->stats.resume_failures++;
+        if (WINEXMPP_sm_unacked(handle->sm) > 0) {
+            if (!handle->sm_stash)
+                handle->sm_stash = WINEXMPP_sm_create(0);
+            if (handle->sm_stash)
+                WINEXMPP_sm_foreach_unacked(handle->sm, stash_one, handle->sm_stash);
+        }
+        free(handle->sm_id);
+        handle->sm_id = NULL;
+        handle->sm_enabled = 0;
+        handle->sm_active = 0;
+        start_bind(handle);
+    }
+}
+
+static void finish_bind(WINEXMPP_handle* handle, const WINEXMPP_stanza* iq) {
+    const char *type = WINEXMPP_stanza_attr(iq, "type");
+    const char *id = WINEXMPP_stanza_attr(iq, "id");
+    if (!id || strcmp(id, "bind-1") != 0)
+        return;
+    if (!type || strcmp(type, "result") != 0) {
+        fprintf(stderr, "Error: resource binding ditolak server\n");
+        handle->state = XS_FAILED;
+        return;
+    }
+    WINEXMPP_stanza *bind = WINEXMPP_stanza_child(iq, "bind", WINEXMPP_NS_BIND);
+    const char *jid = bind ? WINEXMPP_stanza_child_text(bind, "jid") : NULL;
+    free(handle->bound_jid);
+    handle->bound_jid = strdup(jid && *jid ? jid : handle->jid);
+
+    /* XEP-0198: stanza keluar dihitung sejak <enable/> dikirim */
+    WINEXMPP_sm_reset(handle->sm);
+    handle->sm_enabled = 0;
+    handle->sm_active = 0;
+    if (handle->features & FEAT_SM) {
+        if (write_str(handle, "<enable xmlns='" WINEXMPP_NS_SM "' resume='true'/>") == 0) {
+            handle->sm_enabled = 1;
+            handle->sm_since_request = 0;
+        }
+    }
+    /* Presence awal agar server mulai mengirim pesan */
+    handle->state = send_stanza(handle, "<presence/>") == 0 ? XS_READY : XS_FAILED;
+}
+
+/* --- Nonza stream management yang datang di stream --- */
+static void handle_sm(WINEXMPP_handle* handle, const WINEXMPP_stanza* s) {
+    if (strcmp(s->name, "r") == 0) {
+        char buffer[96];
+        snprintf(buffer, sizeof(buffer), "<a xmlns='" WINEXMPP_NS_SM "' h='%u'/>", WINEXMPP_sm_handled(handle->sm));
+        write_str(handle, buffer);
+    } else if (strcmp(s->name, "a") == 0) {
+        const char *h = WINEXMPP_stanza_attr(s, "h");
+        int acked = h ? WINEXMPP_sm_ack(handle->sm, (uint32_t)strtoul(h, NULL, 10)) : -1;
+        if (acked < 0) {
+            /* Ack tidak konsisten: XEP-0198 mewajibkan stream ditutup */
+            write_str(handle, "<stream:error><undefined-condition xmlns='urn:ietf:params:xml:ns:xmpp-streams'/>"
+                              "<handled-count-too-high xmlns='" WINEXMPP_NS_SM "'/></stream:error></stream:stream>");
+            handle->state = XS_FAILED;
+            return;
+        }
+        handle->stats.acked += (unsigned long)acked;
+    } else if (strcmp(s->name, "enabled") == 0) {
+        const char *id = WINEXMPP_stanza_attr(s, "id");
+        const char *resume = WINEXMPP_stanza_attr(s, "resume");
+        handle->sm_active = 1;
+        free(handle->sm_id);
+        handle->sm_id = NULL;
+        if (id && resume && (strcmp(resume, "true") == 0 || strcmp(resume, "1") == 0) &&
+            WINEXMPP_sm_resumable(handle->sm))
+            handle->sm_id = strdup(id);
+    } else if (strcmp(s->name, "failed") == 0) {
+        /* <enable/> ditolak: lanjut tanpa stream management */
+        handle->sm_enabled = 0;
+        handle->sm_active = 0;
+    }
+}
+
+/* --- Stanza di state READY --- */
+static void handle_iq(WINEXMPP_handle* handle, const WINEXMPP_stanza* iq) {
+    const char *type = WINEXMPP_stanza_attr(iq, "type");
+    const char *id = WINEXMPP_stanza_attr(iq, "id");
+    if (!type)
+        return;
+    if (strcmp(type, "result") == 0 || strcmp(type, "error") == 0) {
+        if (id && strncmp(id, SELF_PING_ID, strlen(SELF_PING_ID)) == 0)
+            self_ping_result(handle, iq, id);
+        return;
+    }
+    if (strcmp(type, "get") != 0 && strcmp(type, "set") != 0)
+        return;
+    const char *from = WINEXMPP_stanza_attr(iq, "from");
+    char *eid = escape_dup(id ? id : "");
+    char *efrom = from ? escape_dup(from) : NULL;
+    if (!eid || (from && !efrom)) {
+        free(eid);
+        free(efrom);
+        return;
+    }
+    char buffer[2048];
+    if (strcmp(type, "get") == 0 && WINEXMPP_stanza_child(iq, "ping", WINEXMPP_NS_PING)) {
+        /* XEP-0199: balas ping dengan result kosong */
+        snprintf(buffer, sizeof(buffer), "<iq type='result' id='%s'%s%s%s/>",
+                 eid, efrom ? " to='" : "", efrom ? efrom : "", efrom ? "'" : "");
+    } else {
+        /* Request yang tidak didukung wajib dijawab dengan error (RFC 6120 8.2.3) */
+        snprintf(buffer, sizeof(buffer),
+                 "<iq type='error' id='%s'%s%s%s><error type='cancel'>"
+                 "<service-unavailable xmlns='urn:ietf:params:xml:ns:xmpp-stanzas'/></error></iq>",
+                 eid, efrom ? " to='" : "", efrom ? efrom : "", efrom ? "'" : "");
+    }
+    free(eid);
+    free(efrom);
+    send_stanza(handle, buffer);
+}
+
+static void handle_ready(WINEXMPP_handle* handle, const WINEXMPP_stanza* s) {
+    WINEXMPP_muc *muc = muc_from(handle, WINEXMPP_stanza_attr(s, "from"));
+    if (muc)
+        muc->last_seen_ms = now_ms();
+    if (strcmp(s->name, "message") == 0) {
+        if (handle->on_message)
+            handle->on_message(handle, WINEXMPP_stanza_attr(s, "from"), WINEXMPP_stanza_attr(s, "type"),
+                               WINEXMPP_stanza_child_text(s, "body"), s, handle->user_data);
+    } else if (strcmp(s->name, "iq") == 0) {
+        handle_iq(handle, s);
+    } else if (strcmp(s->name, "presence") == 0) {
+        const char *type = WINEXMPP_stanza_attr(s, "type");
+        if (type && strcmp(type, "error") == 0)
+            fprintf(stderr, "Presence error dari %s\n", WINEXMPP_stanza_attr(s, "from"));
+    }
+}
+
+/* --- Callback parser --- */
+static void on_stanza(void* user, const WINEXMPP_stanza* s) {
+    WINEXMPP_handle *handle = user;
+    WINEB2B_metrics_add(handle->metrics, WINEB2B_METRIC_LINES, 1);
+    if (strcmp(s->name, "error") == 0 && strcmp(s->ns, WINEXMPP_NS_STREAMS) == 0) {
+        fprintf(stderr, "Stream error dari server: %s\n", s->children ? s->children->name : "(tanpa kondisi)");
+        handle->state = XS_FAILED;
+        return;
+    }
+    switch (handle->state) {
+    case XS_FEATURES:
+        if (strcmp(s->name, "features") == 0)
+            start_auth(handle, s);
+        break;
+    case XS_AUTH:
+        if (strcmp(s->name, "success") == 0) {
+            /* SASL sukses: stream di-restart dari awal (RFC 6120 6.4.6) */
+            WINEXMPP_parser_reset(handle->parser);
+            handle->state = send_stream_header(handle) == 0 ? XS_FEATURES_AUTHED : XS_FAILED;
+        } else if (strcmp(s->name, "failure") == 0) {
+            fprintf(stderr, "Error: autentikasi SASL gagal (%s)\n",
+                    s->children ? s->children->name : "tanpa alasan");
+            handle->state = XS_FAILED;
+        }
+        break;
+    case XS_FEATURES_AUTHED:
+        if (strcmp(s->name, "features") == 0)
+            after_auth_features(handle, s);
+        break;
+    case XS_RESUME:
+        if (strcmp(s->ns, WINEXMPP_NS_SM) == 0)
+            finish_resume(handle, s);
+        break;
+    case XS_BIND:
+        if (strcmp(s->name, "iq") == 0)
+            finish_bind(handle, s);
+        break;
+    case XS_READY:
+        if (strcmp(s->ns, WINEXMPP_NS_SM) == 0) {
+            handle_sm(handle, s);
+            break;
+        }
+        handle_ready(handle, s);
+        /* h menghitung stanza masuk yang sudah ditangani (bukan nonza SM) */
+        if (handle->sm_active)
+            WINEXMPP_sm_inbound(handle->sm);
+        break;
+    }
+}
+
+static void on_stream_end(void* user) {
+    WINEXMPP_handle *handle = user;
+    handle->state = XS_CLOSED;
+}
+
+/* --- Membaca dan memproses data yang tersedia --- */
+int WINEXMPP_poll(WINEXMPP_handle* handle, int timeout_ms) {
+    if (!handle || !handle->is_connected)
+        return -1;
+    struct pollfd pfd = { .fd = handle->socket_fd, .events = POLLIN };
+    int n = poll(&pfd, 1, timeout_ms);
+    if (n < 0) {
+        if (errno == EINTR)
+            return 0;
+        perror("poll error");
+        return -1;
+    }
+    if (n == 0)
+        return 0;
+    char buffer[16384];
+    ssize_t bytes = recv(handle->socket_fd, buffer, sizeof(buffer), 0);
+    if (bytes <= 0)
+        return -1;
+    WINEB2B_metrics_add(handle->metrics, WINEB2B_METRIC_BYTES_IN, (uint64_t)bytes);
+    if (WINEXMPP_parser_feed(handle->parser, buffer, (size_t)bytes) != 0) {
+        fprintf(stderr, "Error: XML dari server tidak valid: %s\n", WINEXMPP_parser_error(handle->parser));
+        /* RFC 6120 4.9: stream ditutup dengan stream error sebelum koneksi diputus */
+        snprintf(buffer, sizeof(buffer), "<stream:error><%s xmlns='urn:ietf:params:xml:ns:xmpp-streams'/>"
+                 "</stream:error></stream:stream>", WINEXMPP_parser_condition(handle->parser));
+        write_str(handle, buffer);
+        handle->state = XS_FAILED;
+        return -1;
+    }
+    if (handle->state == XS_FAILED || handle->state == XS_CLOSED)
+        return -1;
+    return (int)bytes;
+}
+
+/* --- Membuka stream dan menjalankan negosiasi sampai READY --- */
+static int negotiate(WINEXMPP_handle* handle) {
+    WINEXMPP_parser_reset(handle->parser);
+    handle->state = XS_FEATURES;
+    handle->resumed = 0;
+    if (send_stream_header(handle) != 0)
+        return -1;
+    long deadline = now_ms() + NEGOTIATE_TIMEOUT_MS;
+    while (handle->state != XS_READY) {
+        long left = deadline - now_ms();
+        if (left <= 0) {
+            fprintf(stderr, "Error: negosiasi XMPP timeout\n");
+            return -1;
+        }
+        if (WINEXMPP_poll(handle, (int)left) < 0)
+            return -1;
+    }
+    return 0;
+}
+
+static int connect_and_login(WINEXMPP_handle* handle) {
+    handle->socket_fd = create_connection(handle->server, handle->port);
+    if (handle->socket_fd < 0)
+        return -1;
+    handle->is_connected = 1;
+    if (negotiate(handle) != 0) {
+        close(handle->socket_fd);
+        handle->is_connected = 0;
+        return -1;
+    }
+    return 0;
+}
+
+/* --- Membuat Handle XMPP dan Login --- */
+WINEXMPP_handle* WINEXMPP_create(const char* server, int port,
+                                 const char* jid,
+                                 const char* password,
+                                 const char* resource) {
+    if (!server || !jid || !password)
+        return NULL;
+    const char *at = strchr(jid, '@');
+    if (!at || at == jid || !at[1]) {
+        fprintf(stderr, "Error: JID tidak valid: %s\n", jid);
+        return NULL;
+    }
+    WINEXMPP_handle* handle = calloc(1, sizeof(WINEXMPP_handle));
+    if (!handle)
+        return NULL;
+
+    handle->socket_fd = -1;
+    handle->server = strdup(server);
+    handle->port = port;
+    handle->username = strndup(jid, (size_t)(at - jid));
+    const char *slash = strchr(at + 1, '/');
+    handle->domain = slash ? strndup(at + 1, (size_t)(slash - at - 1)) : strdup(at + 1);
+    handle->jid = strndup(jid, slash ? (size_t)(slash - jid) : strlen(jid));
+    handle->password = strdup(password);
+    handle->resource = strdup(resource && *resource ? resource : "wineberry");
+    handle->next_id = 1;
+    handle->metrics = WINEB2B_metrics_create("xmpp", jid);
+
+    WINEXMPP_parser_callbacks cb = { NULL, on_stanza, on_stream_end };
+    handle->parser = WINEXMPP_parser_create(&cb, handle);
+    handle->sm = WINEXMPP_sm_create(0);
+    if (!handle->server || !handle->username || !handle->domain || !handle->jid ||
+        !handle->password || !handle->resource || !handle->parser || !handle->sm) {
+        WINEXMPP_free(handle);
+        return NULL;
+    }
+
+    if (connect_and_login(handle) != 0) {
+        WINEXMPP_free(handle);
+        return NULL;
+    }
+    return handle;
+}
+
+void WINEXMPP_set_message_callback(WINEXMPP_handle* handle, WINEXMPP_message_cb cb, void* user_data) {
+    if (!handle)
+        return;
+    handle->on_message = cb;
+    handle->user_data = user_data;
+}
+
+/* --- Join MUC --- */
+WINEXMPPcode WINEXMPP_join_muc(WINEXMPP_handle* handle, const char* room, const char* nick) {
+    if (!handle || !handle->is_connected || handle->state != XS_READY || !room || !nick)
+        return -1;
+    WINEXMPP_muc *muc = find_muc(handle, room, strlen(room));
+    if (!muc) {
+        WINEXMPP_muc *mucs = realloc(handle->mucs, (handle->muc_count + 1) * sizeof(WINEXMPP_muc));
+        if (!mucs)
+            return -1;
+        handle->mucs = mucs;
+        muc = &mucs[handle->muc_count];
+        memset(muc, 0, sizeof(*muc));
+        muc->room = strdup(room);
+        if (!muc->room)
+            return -1;
+        handle->muc_count++;
+    }
+    char *n = strdup(nick), *r = strdup(room), *dn = strdup(nick);
+    if (!n || !r || !dn) {
+        free(n);
+        free(r);
+        free(dn);
+        return -1;
+    }
+    free(muc->nick);
+    muc->nick = n;
+    muc->last_seen_ms = now_ms();
+    muc->ping_sent_ms = 0;
+    free(handle->room);
+    free(handle->nick);
+    handle->room = r;
+    handle->nick = dn;
+    if (send_muc_presence(handle, muc) != 0) {
+        perror("Error mengirim presence MUC");
+        return -1;
+    }
+    return 0;
+}
+
+/* --- Mengirim Pesan --- */
+WINEXMPPcode WINEXMPP_send_message_to(WINEXMPP_handle* handle, const char* to,
+                                      const char* type, const char* message) {
+    if (!handle || !to || !message)
+        return -1;
+    /* Saat terputus, pesan tetap bisa masuk antrean sesi yang bisa di-resume */
+    if (handle->state != XS_READY && !(handle->sm_enabled && handle->sm_id))
+        return -1;
+    WINEB2B_metrics_add(handle->metrics, WINEB2B_METRIC_SENDS_QUEUED, 1);
+    char *eto = escape_dup(to);
+    char *etype = escape_dup(type ? type : "chat");
+    char *ebody = escape_dup(message);
+    int rc = -1;
+    if (eto && etype && ebody) {
+        size_t cap = strlen(eto) + strlen(etype) + strlen(ebody) + 96;
+        char *buffer = malloc(cap);
+        if (buffer) {
+            snprintf(buffer, cap, "<message to='%s' type='%s' id='wb%lu'><body>%s</body></message>",
+                     eto, etype, handle->next_id++, ebody);
+            rc = WINEXMPP_send_raw(handle, buffer);
+            free(buffer);
+        }
+    }
+    free(eto);
+    free(etype);
+    free(ebody);
+    WINEB2B_metrics_add(handle->metrics, rc == 0 ? WINEB2B_METRIC_SENDS_DONE : WINEB2B_METRIC_SENDS_FAILED, 1);
+    return rc;
+}
+
+WINEXMPPcode WINEXMPP_send_message(WINEXMPP_handle* handle, const char* message) {
+    if (!handle || !handle->room)
+        return -1;
+    return WINEXMPP_send_message_to(handle, handle->room, "groupchat", message);
+}
+
+static int send_stashed(const char* xml, size_t len, void* user) {
+    (void)len;
+    WINEXMPP_handle *handle = user;
+    handle->stats.retransmitted++;
+    return send_stanza(handle, xml) != 0;
+}
+
+/* --- Reconnect: resume sesi XEP-0198 atau login penuh + join ulang --- */
+WINEXMPPcode WINEXMPP_reconnect(WINEXMPP_handle* handle) {
+    if (!handle)
+        return -1;
+    if (handle->is_connected) {
+        close(handle->socket_fd);
+        handle->is_connected = 0;
+    }
+    handle->state = XS_CLOSED;
+    WINEB2B_metrics_add(handle->metrics, WINEB2B_METRIC_RECONNECTS, 1);
+    if (connect_and_login(handle) != 0)
+        return -1;
+    if (handle->resumed)
+        return 0;
+    for (int i = 0; i < handle->muc_count; i++)
+        rejoin_muc(handle, &handle->mucs[i]);
+    if (handle->sm_stash) {
+        /* Stanza sesi lama yang belum di-ack dikirim di sesi baru (bisa duplikat) */
+        WINEXMPP_sm_foreach_unacked(handle->sm_stash, send_stashed, handle);
+        WINEXMPP_sm_free(handle->sm_stash);
+        handle->sm_stash = NULL;
+    }
+    return 0;
+}
+
+/* Tugas periodik saat idle: whitespace ping, permintaan ack, self-ping MUC */
+static void maintenance(WINEXMPP_handle* handle) {
+    long now = now_ms();
+    if (handle->sm_enabled && WINEXMPP_sm_unacked(handle->sm) > 0 &&
+        now - handle->sm_request_ms >= SM_REQUEST_IDLE_MS)
+        WINEXMPP_request_ack(handle);
+    for (int i = 0; i < handle->muc_count; i++) {
+        WINEXMPP_muc *muc = &handle->mucs[i];
+        if (muc->ping_sent_ms && now - muc->ping_sent_ms >= SELF_PING_TIMEOUT_MS) {
+            fprintf(stderr, "Self-ping %s tidak dijawab, join ulang\n", muc->room);
+            rejoin_muc(handle, muc);
+        } else if (!muc->ping_sent_ms && now - muc->last_seen_ms >= SELF_PING_IDLE_MS) {
+            send_self_ping(handle, muc);
+        }
+    }
+    if (now - handle->last_send_ms >= KEEPALIVE_IDLE_MS)
+        write_str(handle, " ");
+}
+
+/* --- Fungsi Keep-Alive ---
+     Memproses stanza masuk terus-menerus. Saat idle dikirim whitespace
+     ping (RFC 6120 4.6.1), permintaan ack untuk stanza unacked, dan
+     self-ping ke room yang lama sepi; jika koneksi hilang dilakukan
+     WINEXMPP_reconnect (resume sesi atau login ulang + join MUC). --- */
+WINEXMPPcode WINEXMPP_keep_alive(WINEXMPP_handle* handle) {
+    if (!handle)
+        return -1;
+    while (1) {
+        int n = handle->is_connected ? WINEXMPP_poll(handle, KEEPALIVE_TICK_MS) : -1;
+        if (n >= 0) {
+            maintenance(handle);
+            continue;
+        }
+        WINEB2B_LOG_WARN("xmpp", "event=disconnected jid=%s action=reconnect", handle->jid);
+        if (WINEXMPP_reconnect(handle) != 0) {
+            WINEB2B_LOG_WARN("xmpp", "event=reconnect_failed jid=%s retry_s=5", handle->jid);
+            sleep(5);
+        }
+    }
+    return 0;
+}
+
+void WINEXMPP_get_stats(const WINEXMPP_handle* handle, WINEXMPP_stats* out) {
+    if (!handle || !out)
+        return;
+    *out = handle->stats;
+}
+
+/* --- Disconnect --- */
+WINEXMPPcode WINEXMPP_disconnect(WINEXMPP_handle* handle) {
+    if (!handle)
+        return -1;
+    if (handle->is_connected) {
+        /* Penutupan bersih: sesi tidak di-resume lagi */
+        write_str(handle, "<presence type='unavailable'/></stream:stream>");
+        close(handle->socket_fd);
+        handle->is_connected = 0;
+        handle->state = XS_CLOSED;
+    }
+    free(handle->sm_id);
+    handle->sm_id = NULL;
+    handle->sm_enabled = 0;
+    handle->sm_active = 0;
+    return 0;
+}
+
+/* --- Membebaskan Resource Handle XMPP --- */
+void WINEXMPP_free(WINEXMPP_handle* handle) {
+    if (!handle)
+        return;
+    if (handle->is_connected)
+        WINEXMPP_disconnect(handle);
+    free(handle->server);
+    free(handle->jid);
+    free(handle->username);
+    free(handle->domain);
+    if (handle->password) {
+        memset(handle->password, 0, strlen(handle->password));
+        free(handle->password);
+    }
+    free(handle->resource);
+    free(handle->bound_jid);
+    free(handle->room);
+    free(handle->nick);
+    for (int i = 0; i < handle->muc_count; i++) {
+        free(handle->mucs[i].room);
+        free(handle->mucs[i].nick);
+    }
+    free(handle->mucs);
+    WINEB2B_metrics_free(handle->metrics);
+    free(handle->sm_id);
+    WINEXMPP_sm_free(handle->sm);
+    WINEXMPP_sm_free(handle->sm_stash);
+    WINEXMPP_parser_free(handle->parser);
+    free(handle);
+}
@@ -0,0 +1,83 @@
+#include "xmpp_sasl.h"
+#include <stdlib.h>
+#include <string.h>
+
+static const char b64[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+int WINEXMPP_base64_encode(const unsigned char* in, size_t len, char* out, size_t out_len) {
+    size_t need = (len + 2) / 3 * 4;
+    if (!out || need + 1 > out_len)
+        return -1;
+    size_t w = 0;
+    for (size_t i = 0; i < len; i += 3) {
+        unsigned v = (unsigned)in[i] << 16;
+        if (i + 1 < len)
+            v |= (unsigned)in[i + 1] << 8;
+        if (i + 2 < len)
+            v |= in[i + 2];
+        out[w++] = b64[(v >> 18) & 63];
+        out[w++] = b64[(v >> 12) & 63];
+        out[w++] = i + 1 < len ? b64[(v >> 6) & 63] : '=';
+        out[w++] = i + 2 < len ? b64[v & 63] : '=';
+    }
+    out[w] = '\0';
+    return (int)w;
+}
+
+static int b64_value(char c) {
+    if (c >= 'A' && c <= 'Z') return c - 'A';
+    if (c >= 'a' && c <= 'z') return c - 'a' + 26;
+    if (c >= '0' && c <= '9') return c - '0' + 52;
+    if (c == '+') return 62;
+    if (c == '/') return 63;
+    return -1;
+}
+
+int WINEXMPP_base64_decode(const char* in, unsigned char* out, size_t out_len) {
+    if (!in || !out)
+        return -1;
+    unsigned v = 0;
+    int bits = 0, pad = 0;
+    size_t w = 0;
+    for (const char *p = in; *p; p++) {
+        if (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n')
+            continue;
+        if (*p == '=') {
+            pad++;
+            continue;
+        }
+        int d = b64_value(*p);
+        if (d < 0 || pad)
+            return -1;
+        v = (v << 6) | (unsigned)d;
+        bits += 6;
+        if (bits >= 8) {
+            bits -= 8;
+            if (w >= out_len)
+                return -1;
+            out[w++] = (unsigned char)(v >> bits);
+        }
+    }
+    return pad > 2 ? -1 : (int)w;
+}
+
+int WINEXMPP_sasl_plain(const char* authzid, const char* authcid, const char* password,
+                        char* out, size_t out_len) {
+    if (!authcid || !password)
+        return -1;
+    size_t zlen = authzid ? strlen(authzid) : 0;
+    size_t clen = strlen(authcid), plen = strlen(password);
+    size_t len = zlen + 1 + clen + 1 + plen;
+    unsigned char *raw = malloc(len);
+    if (!raw)
+        return -1;
+    memcpy(raw, authzid ? authzid : "", zlen);
+    raw[zlen] = '\0';
+    memcpy(raw + zlen + 1, authcid, clen);
+    raw[zlen + 1 + clen] = '\0';
+    memcpy(raw + zlen + 2 + clen, password, plen);
+    int n = WINEXMPP_base64_encode(raw, len, out, out_len);
+    memset(raw, 0, len);
+    free(raw);
+    return n;
+}
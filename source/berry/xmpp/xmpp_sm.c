@@ -0,0 +1,140 @@
+#include "xmpp_sm.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DEFAULT_MAX_BYTES (1u << 20)
+
+struct _WINEXMPP_sm {
+    uint32_t handled;       /* h untuk stanza masuk */
+    uint32_t acked;         /* h terakhir dari server untuk stanza keluar */
+    uint32_t sent;          /* Jumlah stanza keluar sejak sesi dimulai (mod 2^32) */
+    /* Antrean: [uint32 len][xml] berurutan, record pertama = urutan acked+1 */
+    char *buf;
+    size_t head;            /* Offset record tertua yang belum di-ack */
+    size_t tail;
+    size_t cap;
+    size_t max_bytes;
+    int overflow;           /* Antrean pernah penuh: stanza hanya dihitung, tidak disimpan */
+};
+
+WINEXMPP_sm* WINEXMPP_sm_create(size_t max_bytes) {
+    WINEXMPP_sm *sm = calloc(1, sizeof(WINEXMPP_sm));
+    if (!sm)
+        return NULL;
+    sm->max_bytes = max_bytes ? max_bytes : DEFAULT_MAX_BYTES;
+    return sm;
+}
+
+void WINEXMPP_sm_reset(WINEXMPP_sm* sm) {
+    if (!sm)
+        return;
+    sm->handled = 0;
+    sm->acked = 0;
+    sm->sent = 0;
+    sm->head = 0;
+    sm->tail = 0;
+    sm->overflow = 0;
+}
+
+int WINEXMPP_sm_outbound(WINEXMPP_sm* sm, const char* xml, size_t len) {
+    if (!sm || !xml)
+        return -1;
+    size_t need = sizeof(uint32_t) + len;
+    if (!sm->overflow && sm->tail - sm->head + need > sm->max_bytes) {
+        fprintf(stderr, "Error: antrean stream management penuh (%zu stanza unacked)\n",
+                WINEXMPP_sm_unacked(sm));
+        /* Urutan record tidak lagi cocok dengan h server; sisa antrean dibuang */
+        sm->overflow = 1;
+        sm->head = sm->tail = 0;
+    }
+    if (sm->overflow) {
+        /* Server tetap menghitung stanza ini, jadi counter juga harus */
+        sm->sent++;
+        return -1;
+    }
+    if (sm->tail + need > sm->cap) {
+        /* Geser record yang tersisa ke depan sebelum memperbesar buffer */
+        if (sm->head > 0) {
+            memmove(sm->buf, sm->buf + sm->head, sm->tail - sm->head);
+            sm->tail -= sm->head;
+            sm->head = 0;
+        }
+        if (sm->tail + need > sm->cap) {
+            size_t cap = sm->cap ? sm->cap : 4096;
+            while (cap < sm->tail + need)
+                cap *= 2;
+            char *buf = realloc(sm->buf, cap);
+            if (!buf)
+                return -1;
+            sm->buf = buf;
+            sm->cap = cap;
+        }
+    }
+    uint32_t l = (uint32_t)len;
+    memcpy(sm->buf + sm->tail, &l, sizeof(l));
+    memcpy(sm->buf + sm->tail + sizeof(l), xml, len);
+    sm->tail += need;
+    sm->sent++;
+    return 0;
+}
+
+int WINEXMPP_sm_ack(WINEXMPP_sm* sm, uint32_t h) {
+    if (!sm)
+        return -1;
+    /* Aritmetika mod 2^32: server tidak boleh meng-ack lebih dari yang dikirim */
+    uint32_t count = h - sm->acked;
+    if (count > sm->sent - sm->acked) {
+        fprintf(stderr, "Error: ack h=%u melebihi stanza terkirim (%u)\n", h, sm->sent);
+        return -1;
+    }
+    for (uint32_t i = 0; i < count && !sm->overflow; i++) {
+        uint32_t l;
+        memcpy(&l, sm->buf + sm->head, sizeof(l));
+        sm->head += sizeof(l) + l;
+    }
+    sm->acked = h;
+    if (sm->head == sm->tail)
+        sm->head = sm->tail = 0;
+    return (int)count;
+}
+
+void WINEXMPP_sm_inbound(WINEXMPP_sm* sm) {
+    if (sm)
+        sm->handled++;
+}
+
+uint32_t WINEXMPP_sm_handled(const WINEXMPP_sm* sm) {
+    return sm ? sm->handled : 0;
+}
+
+int WINEXMPP_sm_resumable(const WINEXMPP_sm* sm) {
+    return sm && !sm->overflow;
+}
+
+size_t WINEXMPP_sm_unacked(const WINEXMPP_sm* sm) {
+    return sm ? (size_t)(sm->sent - sm->acked) : 0;
+}
+
+size_t WINEXMPP_sm_foreach_unacked(const WINEXMPP_sm* sm, WINEXMPP_sm_cb cb, void* user) {
+    if (!sm || !cb)
+        return 0;
+    size_t n = 0;
+    for (size_t off = sm->head; off < sm->tail; n++) {
+        uint32_t l;
+        memcpy(&l, sm->buf + off, sizeof(l));
+        if (cb(sm->buf + off + sizeof(l), l, user)) {
+            n++;
+            break;
+        }
+        off += sizeof(l) + l;
+    }
+    return n;
+}
+
+void WINEXMPP_sm_free(WINEXMPP_sm* sm) {
+    if (!sm)
+        return;
+    free(sm->buf);
+    free(sm);
+}
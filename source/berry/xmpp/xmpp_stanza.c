@@ -0,0 +1,120 @@
+#include "xmpp_stanza.h"
+#include <stdio.h>
+#include <string.h>
+
+const char* WINEXMPP_stanza_attr(const WINEXMPP_stanza* s, const char* name) {
+    if (!s || !name)
+        return NULL;
+    for (int i = 0; i < s->attr_count; i++) {
+        if (strcmp(s->attrs[i].name, name) == 0)
+            return s->attrs[i].value;
+    }
+    return NULL;
+}
+
+WINEXMPP_stanza* WINEXMPP_stanza_child(const WINEXMPP_stanza* s, const char* name, const char* ns) {
+    if (!s || !name)
+        return NULL;
+    for (WINEXMPP_stanza *c = s->children; c; c = c->next) {
+        if (strcmp(c->name, name) == 0 && (!ns || strcmp(c->ns, ns) == 0))
+            return c;
+    }
+    return NULL;
+}
+
+const char* WINEXMPP_stanza_child_text(const WINEXMPP_stanza* s, const char* name) {
+    WINEXMPP_stanza *c = WINEXMPP_stanza_child(s, name, NULL);
+    return c ? c->text : NULL;
+}
+
+/* --- Serialisasi --- */
+static int escape_n(const char* in, size_t len, char* out, size_t out_len) {
+    size_t w = 0;
+    for (size_t i = 0; i < len; i++) {
+        const char *rep = NULL;
+        switch (in[i]) {
+        case '&':  rep = "&amp;";  break;
+        case '<':  rep = "&lt;";   break;
+        case '>':  rep = "&gt;";   break;
+        case '"':  rep = "&quot;"; break;
+        case '\'': rep = "&apos;"; break;
+        }
+        size_t n = rep ? strlen(rep) : 1;
+        if (w + n >= out_len)
+            return -1;
+        if (rep)
+            memcpy(out + w, rep, n);
+        else
+            out[w] = in[i];
+        w += n;
+    }
+    if (w >= out_len)
+        return -1;
+    out[w] = '\0';
+    return (int)w;
+}
+
+int WINEXMPP_escape(const char* in, char* out, size_t out_len) {
+    if (!in || !out)
+        return -1;
+    return escape_n(in, strlen(in), out, out_len);
+}
+
+/* Menulis string mentah; -1 jika tidak muat */
+static int put(char* out, size_t out_len, size_t* w, const char* s, size_t n) {
+    if (*w + n >= out_len)
+        return -1;
+    memcpy(out + *w, s, n);
+    *w += n;
+    return 0;
+}
+
+static int put_escaped(char* out, size_t out_len, size_t* w, const char* s, size_t n) {
+    int len = escape_n(s, n, out + *w, out_len - *w);
+    if (len < 0)
+        return -1;
+    *w += (size_t)len;
+    return 0;
+}
+
+static int serialize(const WINEXMPP_stanza* s, const char* parent_ns, char* out, size_t out_len, size_t* w) {
+    if (put(out, out_len, w, "<", 1) || put(out, out_len, w, s->name, strlen(s->name)))
+        return -1;
+    if (s->ns && *s->ns && (!parent_ns || strcmp(s->ns, parent_ns) != 0)) {
+        if (put(out, out_len, w, " xmlns='", 8) || put_escaped(out, out_len, w, s->ns, strlen(s->ns)) ||
+            put(out, out_len, w, "'", 1))
+            return -1;
+    }
+    for (int i = 0; i < s->attr_count; i++) {
+        const WINEXMPP_attr *a = &s->attrs[i];
+        if (put(out, out_len, w, " ", 1) || put(out, out_len, w, a->name, strlen(a->name)) ||
+            put(out, out_len, w, "='", 2) || put_escaped(out, out_len, w, a->value, strlen(a->value)) ||
+            put(out, out_len, w, "'", 1))
+            return -1;
+    }
+    if (!s->children && s->text_len == 0)
+        return put(out, out_len, w, "/>", 2);
+    if (put(out, out_len, w, ">", 1))
+        return -1;
+    /* Konten campuran tidak dipertahankan urutannya: teks ditulis sebelum anak */
+    if (s->text_len && put_escaped(out, out_len, w, s->text, s->text_len))
+        return -1;
+    for (const WINEXMPP_stanza *c = s->children; c; c = c->next) {
+        if (serialize(c, s->ns, out, out_len, w) != 0)
+            return -1;
+    }
+    if (put(out, out_len, w, "</", 2) || put(out, out_len, w, s->name, strlen(s->name)) ||
+        put(out, out_len, w, ">", 1))
+        return -1;
+    return 0;
+}
+
+int WINEXMPP_stanza_serialize(const WINEXMPP_stanza* s, char* out, size_t out_len) {
+    if (!s || !out || out_len == 0)
+        return -1;
+    size_t w = 0;
+    if (serialize(s, NULL, out, out_len, &w) != 0)
+        return -1;
+    out[w] = '\0';
+    return (int)w;
+}
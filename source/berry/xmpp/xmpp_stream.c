@@ -0,0 +1,892 @@
+#include "xmpp_stream.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#define ARENA_BLOCK     8192
+#define ARENA_RETAIN    (64 * 1024) /* Blok arena di atas ini dibebaskan setelah stanza besar */
+#define INTERN_BLOCK    4096
+#define MAX_TOKEN       (1 << 20)   /* Batas satu tag/teks agar peer tidak bisa menghabiskan memori */
+#define MAX_ATTRS       64
+#define MAX_INTERN      4096        /* Batas isi tabel intern; nama dari peer di luar itu disalin ke arena */
+#define MAX_INTERN_LEN  256         /* Nama/URI lebih panjang tidak di-intern */
+
+/* Blok arena; dipakai untuk stanza (di-reset per stanza), deklarasi namespace
+   <stream:stream> (di-reset per stream) dan pool intern (permanen) */
+struct arena_block {
+    struct arena_block *next;
+    size_t size;
+    size_t used;
+    char data[];
+};
+
+struct intern_slot {
+    const char *str;
+    size_t len;
+    uint32_t hash;
+};
+
+struct ns_binding {
+    const char *prefix;     /* Di-intern, "" untuk namespace default */
+    const char *uri;        /* Di-intern */
+    int depth;              /* Kedalaman elemen yang mendeklarasikan */
+};
+
+struct raw_attr {
+    char *name;
+    size_t name_len;
+    char *value;
+    size_t value_len;
+};
+
+enum { ST_TEXT, ST_TAG };
+
+struct _WINEXMPP_parser {
+    WINEXMPP_parser_callbacks cb;
+    void *user;
+
+    /* Tabel intern (open addressing) dan pool string-nya */
+    struct intern_slot *itab;
+    size_t icap;
+    size_t icount;
+    struct arena_block *ipool;
+    /* Salinan prefix/URI dari <stream:stream> saat tabel intern penuh */
+    struct arena_block *spool;
+
+    /* Arena stanza: semua blok dipertahankan dan dipakai ulang */
+    struct arena_block *arena_head;
+    struct arena_block *arena_cur;
+
+    /* Buffer token (tag atau teks) yang bisa terpotong di antara feed */
+    char *tok;
+    size_t tok_len;
+    size_t tok_cap;
+    int state;
+    char quote;             /* Kutip yang sedang terbuka di dalam tag */
+    char tag_kind;          /* Byte pertama tag: '!', '?', '/' atau 0 untuk tag biasa */
+
+    int depth;              /* Elemen terbuka termasuk <stream:stream> */
+    size_t max_stanza;      /* Batas byte satu stanza */
+    int max_depth;          /* Batas kedalaman elemen di dalam stanza */
+    size_t stanza_bytes;    /* Byte stanza yang sedang dirakit */
+    size_t *text_cap;       /* Kapasitas buffer teks elemen terbuka per level stanza */
+    int limit_hit;          /* Error terakhir karena batas, bukan XML rusak */
+    WINEXMPP_stanza *cur;   /* Elemen terdalam yang sedang terbuka di stanza */
+    WINEXMPP_stanza *root;  /* Akar stanza yang sedang dirakit */
+
+    struct ns_binding *ns;
+    size_t ns_count;
+    size_t ns_cap;
+    struct raw_attr attrs[MAX_ATTRS];
+
+    const char *s_empty;
+    const char *s_xml;
+
+    int in_feed;
+    int reset_pending;
+    const char *error;
+    WINEXMPP_parser_stats stats;
+};
+
+/* --- Fungsi Helper: alokasi --- */
+static void* counted_malloc(WINEXMPP_parser* p, size_t n) {
+    p->stats.allocations++;
+    return malloc(n);
+}
+
+static struct arena_block* new_block(WINEXMPP_parser* p, size_t min, size_t dflt) {
+    size_t size = min > dflt ? min : dflt;
+    struct arena_block *b = counted_malloc(p, sizeof(struct arena_block) + size);
+    if (!b)
+        return NULL;
+    b->next = NULL;
+    b->size = size;
+    b->used = 0;
+    return b;
+}
+
+static void* arena_alloc(WINEXMPP_parser* p, size_t n) {
+    n = (n + 7) & ~(size_t)7;
+    struct arena_block *b = p->arena_cur;
+    while (b && b->used + n > b->size) {
+        if (!b->next) {
+            b->next = new_block(p, n, ARENA_BLOCK);
+            if (!b->next)
+                return NULL;
+        }
+        b = b->next;
+    }
+    if (!b) {
+        b = p->arena_head = new_block(p, n, ARENA_BLOCK);
+        if (!b)
+            return NULL;
+    }
+    p->arena_cur = b;
+    void *ptr = b->data + b->used;
+    b->used += n;
+    return ptr;
+}
+
+static void free_blocks(struct arena_block* b) {
+    while (b) {
+        struct arena_block *next = b->next;
+        free(b);
+        b = next;
+    }
+}
+
+/* Blok dipakai ulang sampai ARENA_RETAIN; sisa dari stanza besar dibebaskan */
+static void arena_reset(WINEXMPP_parser* p) {
+    size_t kept = 0;
+    for (struct arena_block *b = p->arena_head; b; b = b->next) {
+        b->used = 0;
+        kept += b->size;
+        if (kept >= ARENA_RETAIN) {
+            free_blocks(b->next);
+            b->next = NULL;
+            break;
+        }
+    }
+    p->arena_cur = p->arena_head;
+}
+
+static int tok_reserve(WINEXMPP_parser* p, size_t extra) {
+    if (p->tok_len + extra + 1 <= p->tok_cap)
+        return 0;
+    if (p->tok_len + extra > MAX_TOKEN) {
+        p->error = "token XML terlalu panjang";
+        p->limit_hit = 1;
+        return -1;
+    }
+    size_t cap = p->tok_cap ? p->tok_cap : 1024;
+    while (cap < p->tok_len + extra + 1)
+        cap *= 2;
+    char *t = realloc(p->tok, cap);
+    p->stats.allocations++;
+    if (!t) {
+        p->error = "memori habis";
+        return -1;
+    }
+    p->tok = t;
+    p->tok_cap = cap;
+    return 0;
+}
+
+static int tok_append(WINEXMPP_parser* p, const char* data, size_t len) {
+    if (len == 0)
+        return 0;
+    if (tok_reserve(p, len) != 0)
+        return -1;
+    memcpy(p->tok + p->tok_len, data, len);
+    p->tok_len += len;
+    return 0;
+}
+
+/* --- Intern --- */
+static uint32_t hash_bytes(const char* s, size_t len) {
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        h ^= (unsigned char)s[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static int intern_grow(WINEXMPP_parser* p) {
+    size_t cap = p->icap ? p->icap * 2 : 256;
+    struct intern_slot *tab = calloc(cap, sizeof(struct intern_slot));
+    p->stats.allocations++;
+    if (!tab)
+        return -1;
+    for (size_t i = 0; i < p->icap; i++) {
+        if (!p->itab[i].str)
+            continue;
+        size_t j = p->itab[i].hash & (cap - 1);
+        while (tab[j].str)
+            j = (j + 1) & (cap - 1);
+        tab[j] = p->itab[i];
+    }
+    free(p->itab);
+    p->itab = tab;
+    p->icap = cap;
+    return 0;
+}
+
+static const char* intern_find(WINEXMPP_parser* p, const char* s, size_t len, uint32_t h) {
+    if (!p->icap)
+        return NULL;
+    size_t j = h & (p->icap - 1);
+    while (p->itab[j].str) {
+        if (p->itab[j].hash == h && p->itab[j].len == len && memcmp(p->itab[j].str, s, len) == 0)
+            return p->itab[j].str;
+        j = (j + 1) & (p->icap - 1);
+    }
+    return NULL;
+}
+
+/* Menyalin string ke daftar blok; blok baru disisipkan di depan */
+static char* pool_copy(WINEXMPP_parser* p, struct arena_block** pool, const char* s, size_t len) {
+    struct arena_block *b = *pool;
+    if (!b || b->used + len + 1 > b->size) {
+        b = new_block(p, len + 1, INTERN_BLOCK);
+        if (!b)
+            return NULL;
+        b->next = *pool;
+        *pool = b;
+    }
+    char *str = b->data + b->used;
+    memcpy(str, s, len);
+    str[len] = '\0';
+    b->used += len + 1;
+    return str;
+}
+
+static const char* intern_add(WINEXMPP_parser* p, const char* s, size_t len, uint32_t h) {
+    if ((p->icount + 1) * 2 > p->icap && intern_grow(p) != 0)
+        return NULL;
+    char *str = pool_copy(p, &p->ipool, s, len);
+    if (!str)
+        return NULL;
+    size_t j = h & (p->icap - 1);
+    while (p->itab[j].str)
+        j = (j + 1) & (p->icap - 1);
+    p->itab[j].str = str;
+    p->itab[j].len = len;
+    p->itab[j].hash = h;
+    p->icount++;
+    return str;
+}
+
+const char* WINEXMPP_parser_intern(WINEXMPP_parser* p, const char* s, size_t len) {
+    if (!p || !s)
+        return NULL;
+    uint32_t h = hash_bytes(s, len);
+    const char *str = intern_find(p, s, len, h);
+    if (str)
+        return str;
+    if (p->icount >= MAX_INTERN)
+        return NULL;
+    return intern_add(p, s, len, h);
+}
+
+/* Nama dari peer: di-intern selama tabel belum penuh, sisanya disalin ke
+   arena stanza atau, untuk deklarasi di <stream:stream> yang hidup sampai
+   stream berakhir, ke pool stream. Peer yang terus mengirim nama unik
+   tidak bisa menumbuhkan memori tanpa batas. */
+static const char* store_name(WINEXMPP_parser* p, const char* s, size_t len, int stream_level) {
+    uint32_t h = hash_bytes(s, len);
+    const char *str = intern_find(p, s, len, h);
+    if (str)
+        return str;
+    if (p->icount < MAX_INTERN && len <= MAX_INTERN_LEN)
+        return intern_add(p, s, len, h);
+    if (stream_level)
+        return pool_copy(p, &p->spool, s, len);
+    char *copy = arena_alloc(p, len + 1);
+    if (!copy)
+        return NULL;
+    memcpy(copy, s, len);
+    copy[len] = '\0';
+    return copy;
+}
+
+/* --- Entity --- */
+static size_t put_utf8(char* out, unsigned long cp) {
+    if (cp < 0x80) {
+        out[0] = (char)cp;
+        return 1;
+    } else if (cp < 0x800) {
+        out[0] = (char)(0xC0 | (cp >> 6));
+        out[1] = (char)(0x80 | (cp & 0x3F));
+        return 2;
+    } else if (cp < 0x10000) {
+        out[0] = (char)(0xE0 | (cp >> 12));
+        out[1] = (char)(0x80 | ((cp >> 6) & 0x3F));
+        out[2] = (char)(0x80 | (cp & 0x3F));
+        return 3;
+    }
+    out[0] = (char)(0xF0 | (cp >> 18));
+    out[1] = (char)(0x80 | ((cp >> 12) & 0x3F));
+    out[2] = (char)(0x80 | ((cp >> 6) & 0x3F));
+    out[3] = (char)(0x80 | (cp & 0x3F));
+    return 4;
+}
+
+/* Decode entity di tempat (hasil tidak pernah lebih panjang). -1 jika entity tidak dikenal */
+static long decode_entities(WINEXMPP_parser* p, char* s, size_t len) {
+    char *amp = memchr(s, '&', len);
+    if (!amp)
+        return (long)len;
+    size_t r = (size_t)(amp - s), w = r;
+    while (r < len) {
+        if (s[r] != '&') {
+            s[w++] = s[r++];
+            continue;
+        }
+        char *semi = memchr(s + r, ';', len - r);
+        if (!semi || semi - (s + r) > 10) {
+            p->error = "entity XML tidak valid";
+            return -1;
+        }
+        const char *e = s + r + 1;
+        size_t elen = (size_t)(semi - e);
+        if (elen == 2 && memcmp(e, "lt", 2) == 0)
+            s[w++] = '<';
+        else if (elen == 2 && memcmp(e, "gt", 2) == 0)
+            s[w++] = '>';
+        else if (elen == 3 && memcmp(e, "amp", 3) == 0)
+            s[w++] = '&';
+        else if (elen == 4 && memcmp(e, "quot", 4) == 0)
+            s[w++] = '"';
+        else if (elen == 4 && memcmp(e, "apos", 4) == 0)
+            s[w++] = '\'';
+        else if (elen >= 2 && e[0] == '#') {
+            char *end;
+            unsigned long cp = (e[1] == 'x') ? strtoul(e + 2, &end, 16) : strtoul(e + 1, &end, 10);
+            if (end != semi || cp == 0 || cp > 0x10FFFF || (cp >= 0xD800 && cp <= 0xDFFF)) {
+                p->error = "referensi karakter tidak valid";
+                return -1;
+            }
+            /* Referensi numerik minimal 4 byte ("&#N;") sehingga UTF-8 (maks 4) muat */
+            w += put_utf8(s + w, cp);
+        } else {
+            p->error = "entity XML tidak dikenal";
+            return -1;
+        }
+        r = (size_t)(semi - s) + 1;
+    }
+    return (long)w;
+}
+
+/* --- Namespace --- */
+static const char* ns_lookup(WINEXMPP_parser* p, const char* prefix) {
+    for (size_t i = p->ns_count; i > 0; i--) {
+        /* Prefix yang tidak ter-intern berupa salinan: bandingkan isinya */
+        if (p->ns[i - 1].prefix == prefix || strcmp(p->ns[i - 1].prefix, prefix) == 0)
+            return p->ns[i - 1].uri;
+    }
+    if (prefix == p->s_empty)
+        return p->s_empty;
+    if (prefix == p->s_xml)
+        return WINEXMPP_parser_intern(p, "http://www.w3.org/XML/1998/namespace", 36);
+    return NULL;
+}
+
+static int ns_push(WINEXMPP_parser* p, const char* prefix, const char* uri, int depth) {
+    if (!prefix || !uri) {
+        p->error = "memori habis";
+        return -1;
+    }
+    if (p->ns_count == p->ns_cap) {
+        size_t cap = p->ns_cap ? p->ns_cap * 2 : 16;
+        struct ns_binding *ns = realloc(p->ns, cap * sizeof(struct ns_binding));
+        p->stats.allocations++;
+        if (!ns) {
+            p->error = "memori habis";
+            return -1;
+        }
+        p->ns = ns;
+        p->ns_cap = cap;
+    }
+    p->ns[p->ns_count].prefix = prefix;
+    p->ns[p->ns_count].uri = uri;
+    p->ns[p->ns_count].depth = depth;
+    p->ns_count++;
+    return 0;
+}
+
+static void ns_pop(WINEXMPP_parser* p, int depth) {
+    while (p->ns_count > 0 && p->ns[p->ns_count - 1].depth >= depth)
+        p->ns_count--;
+}
+
+/* Memisahkan "prefix:local"; mengembalikan prefix ter-intern dan mengisi local */
+static const char* split_qname(WINEXMPP_parser* p, const char* name, size_t len,
+                               const char** local, size_t* local_len) {
+    const char *colon = memchr(name, ':', len);
+    if (!colon) {
+        *local = name;
+        *local_len = len;
+        return p->s_empty;
+    }
+    *local = colon + 1;
+    *local_len = len - (size_t)(colon - name) - 1;
+    return store_name(p, name, (size_t)(colon - name), 0);
+}
+
+/* --- Pembentukan pohon stanza --- */
+/* Menambah teks ke elemen terdalam (p->cur). Teks yang terpecah komentar,
+   CDATA atau anak elemen tidak disalin ulang setiap kali: buffer tumbuh
+   dua kali lipat sehingga arena tetap linear terhadap ukuran stanza. */
+static int append_text(WINEXMPP_parser* p, const char* text, size_t len) {
+    if (len == 0)
+        return 0;
+    WINEXMPP_stanza *node = p->cur;
+    size_t *cap = &p->text_cap[p->depth - 2];
+    size_t need = node->text_len + len + 1;
+    char *buf = (char*)node->text;
+    if (need > *cap) {
+        size_t size = *cap ? *cap * 2 : need;
+        if (size < need)
+            size = need;
+        buf = arena_alloc(p, size);
+        if (!buf) {
+            p->error = "memori habis";
+            return -1;
+        }
+        memcpy(buf, node->text, node->text_len);
+        *cap = size;
+        node->text = buf;
+    }
+    memcpy(buf + node->text_len, text, len);
+    buf[node->text_len + len] = '\0';
+    node->text_len += len;
+    return 0;
+}
+
+/* Menghitung byte stanza yang sedang dirakit terhadap max_stanza */
+static int stanza_account(WINEXMPP_parser* p, size_t n) {
+    p->stanza_bytes += n;
+    if (p->stanza_bytes <= p->max_stanza)
+        return 0;
+    p->error = "stanza terlalu besar";
+    p->limit_hit = 1;
+    return -1;
+}
+
+static void do_reset(WINEXMPP_parser* p) {
+    p->state = ST_TEXT;
+    p->tok_len = 0;
+    p->quote = 0;
+    p->tag_kind = 0;
+    p->depth = 0;
+    p->stanza_bytes = 0;
+    p->cur = NULL;
+    p->root = NULL;
+    p->ns_count = 0;
+    p->error = NULL;
+    p->limit_hit = 0;
+    p->reset_pending = 0;
+    arena_reset(p);
+    free_blocks(p->spool);
+    p->spool = NULL;
+}
+
+static int is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+static int close_element(WINEXMPP_parser* p) {
+    ns_pop(p, p->depth);
+    p->depth--;
+    if (p->depth == 0) {
+        /* </stream:stream> */
+        if (p->cb.stream_end)
+            p->cb.stream_end(p->user);
+        return 0;
+    }
+    p->cur = p->cur ? p->cur->parent : NULL;
+    if (p->depth == 1) {
+        p->stats.stanzas++;
+        if (p->cb.stanza)
+            p->cb.stanza(p->user, p->root);
+        p->root = NULL;
+        p->cur = NULL;
+        p->stanza_bytes = 0;
+        arena_reset(p);
+    }
+    return 0;
+}
+
+static int handle_end_tag(WINEXMPP_parser* p, char* s, size_t len) {
+    while (len > 0 && is_space(s[len - 1]))
+        len--;
+    if (p->depth == 0) {
+        p->error = "tag penutup tanpa pembuka";
+        return -1;
+    }
+    if (p->depth >= 2) {
+        const char *local;
+        size_t local_len;
+        split_qname(p, s, len, &local, &local_len);
+        if (!p->cur || strlen(p->cur->name) != local_len || memcmp(p->cur->name, local, local_len) != 0) {
+            p->error = "tag penutup tidak cocok";
+            return -1;
+        }
+    }
+    return close_element(p);
+}
+
+static int handle_start_tag(WINEXMPP_parser* p, char* s, size_t len) {
+    int self_closing = 0;
+    while (len > 0 && is_space(s[len - 1]))
+        len--;
+    if (len > 0 && s[len - 1] == '/') {
+        self_closing = 1;
+        len--;
+    }
+
+    /* Nama elemen */
+    size_t i = 0;
+    while (i < len && !is_space(s[i]))
+        i++;
+    if (i == 0) {
+        p->error = "nama elemen kosong";
+        return -1;
+    }
+    char *name = s;
+    size_t name_len = i;
+
+    /* Atribut: name = 'value' atau "value" */
+    int nattrs = 0;
+    int depth = p->depth + 1;
+    if (depth - 1 > p->max_depth) {
+        p->error = "elemen bersarang terlalu dalam";
+        p->limit_hit = 1;
+        return -1;
+    }
+    while (i < len) {
+        while (i < len && is_space(s[i]))
+            i++;
+        if (i >= len)
+            break;
+        size_t a = i;
+        while (i < len && s[i] != '=' && !is_space(s[i]))
+            i++;
+        size_t alen = i - a;
+        while (i < len && is_space(s[i]))
+            i++;
+        if (i >= len || s[i] != '=' || alen == 0) {
+            p->error = "atribut tanpa nilai";
+            return -1;
+        }
+        i++;
+        while (i < len && is_space(s[i]))
+            i++;
+        if (i >= len || (s[i] != '"' && s[i] != '\'')) {
+            p->error = "nilai atribut tanpa kutip";
+            return -1;
+        }
+        char q = s[i++];
+        size_t v = i;
+        while (i < len && s[i] != q)
+            i++;
+        if (i >= len) {
+            p->error = "kutip atribut tidak ditutup";
+            return -1;
+        }
+        long vlen = decode_entities(p, s + v, i - v);
+        if (vlen < 0)
+            return -1;
+        s[v + (size_t)vlen] = '\0';
+        i++;
+
+        if (alen == 5 && memcmp(s + a, "xmlns", 5) == 0) {
+            if (ns_push(p, p->s_empty, store_name(p, s + v, (size_t)vlen, depth == 1), depth) != 0)
+                return -1;
+        } else if (alen > 6 && memcmp(s + a, "xmlns:", 6) == 0) {
+            const char *prefix = store_name(p, s + a + 6, alen - 6, depth == 1);
+            if (ns_push(p, prefix, store_name(p, s + v, (size_t)vlen, depth == 1), depth) != 0)
+                return -1;
+        } else {
+            if (nattrs == MAX_ATTRS) {
+                p->error = "atribut terlalu banyak";
+                p->limit_hit = 1;
+                return -1;
+            }
+            p->attrs[nattrs].name = s + a;
+            p->attrs[nattrs].name_len = alen;
+            p->attrs[nattrs].value = s + v;
+            p->attrs[nattrs].value_len = (size_t)vlen;
+            nattrs++;
+        }
+    }
+
+    const char *local;
+    size_t local_len;
+    const char *prefix = split_qname(p, name, name_len, &local, &local_len);
+    if (!prefix) {
+        p->error = "memori habis";
+        return -1;
+    }
+    const char *uri = ns_lookup(p, prefix);
+    if (!uri) {
+        p->error = "prefix namespace tidak dikenal";
+        return -1;
+    }
+
+    WINEXMPP_stanza *node = arena_alloc(p, sizeof(WINEXMPP_stanza));
+    WINEXMPP_attr *attrs = nattrs ? arena_alloc(p, nattrs * sizeof(WINEXMPP_attr)) : NULL;
+    if (!node || (nattrs && !attrs)) {
+        p->error = "memori habis";
+        return -1;
+    }
+    memset(node, 0, sizeof(*node));
+    node->name = store_name(p, local, local_len, 0);
+    if (!node->name) {
+        p->error = "memori habis";
+        return -1;
+    }
+    node->ns = uri;
+    node->text = p->s_empty;
+    node->attrs = attrs;
+    node->attr_count = nattrs;
+    for (int k = 0; k < nattrs; k++) {
+        char *val = arena_alloc(p, p->attrs[k].value_len + 1);
+        if (!val) {
+            p->error = "memori habis";
+            return -1;
+        }
+        memcpy(val, p->attrs[k].value, p->attrs[k].value_len + 1);
+        attrs[k].name = store_name(p, p->attrs[k].name, p->attrs[k].name_len, 0);
+        if (!attrs[k].name) {
+            p->error = "memori habis";
+            return -1;
+        }
+        attrs[k].value = val;
+    }
+    p->depth = depth;
+
+    if (depth == 1) {
+        /* <stream:stream>: diserahkan langsung, isinya stanza-stanza berikutnya */
+        if (p->cb.stream_start)
+            p->cb.stream_start(p->user, node);
+        arena_reset(p);
+        if (self_closing)
+            return close_element(p);
+        return 0;
+    }
+
+    if (depth == 2) {
+        p->root = node;
+    } else {
+        node->parent = p->cur;
+        if (p->cur->last_child)
+            p->cur->last_child->next = node;
+        else
+            p->cur->children = node;
+        p->cur->last_child = node;
+    }
+    p->cur = node;
+    p->text_cap[depth - 2] = 0;
+    if (self_closing)
+        return close_element(p);
+    return 0;
+}
+
+/* Memproses satu tag lengkap di p->tok (tanpa '<' dan '>') */
+static int process_tag(WINEXMPP_parser* p) {
+    char *s = p->tok;
+    size_t len = p->tok_len;
+    s[len] = '\0';
+    if (len == 0) {
+        p->error = "tag kosong";
+        return -1;
+    }
+    switch (s[0]) {
+    case '?':
+        return 0;   /* Deklarasi XML / processing instruction diabaikan */
+    case '!':
+        if (len >= 10 && memcmp(s, "![CDATA[", 8) == 0) {
+            if (p->depth >= 2)
+                return append_text(p, s + 8, len - 10);
+            return 0;
+        }
+        if (len >= 5 && memcmp(s, "!--", 3) == 0)
+            return 0;
+        p->error = "DTD tidak diizinkan di stream XMPP";
+        return -1;
+    case '/':
+        return handle_end_tag(p, s + 1, len - 1);
+    default:
+        return handle_start_tag(p, s, len);
+    }
+}
+
+/* Tag komentar/CDATA hanya selesai pada "-->" atau "]]>" */
+static int tag_complete(const WINEXMPP_parser* p) {
+    if (p->tag_kind != '!')
+        return 1;
+    const char *s = p->tok;
+    size_t n = p->tok_len;
+    if (n >= 3 && memcmp(s, "!--", 3) == 0)
+        return n >= 5 && s[n - 1] == '-' && s[n - 2] == '-';
+    if (n >= 8 && memcmp(s, "![CDATA[", 8) == 0)
+        return n >= 10 && s[n - 1] == ']' && s[n - 2] == ']';
+    /* Awalan belum lengkap: tunggu lebih banyak data jika masih mungkin komentar/CDATA */
+    if ((n < 3 && memcmp(s, "!--", n) == 0) || (n < 8 && memcmp(s, "![CDATA[", n) == 0))
+        return 0;
+    return 1;
+}
+
+static int flush_text(WINEXMPP_parser* p) {
+    if (p->tok_len == 0)
+        return 0;
+    long n = decode_entities(p, p->tok, p->tok_len);
+    if (n < 0)
+        return -1;
+    p->tok_len = 0;
+    return append_text(p, p->tok, (size_t)n);
+}
+
+/* --- API --- */
+WINEXMPP_parser* WINEXMPP_parser_create(const WINEXMPP_parser_callbacks* cb, void* user) {
+    WINEXMPP_parser *p = calloc(1, sizeof(WINEXMPP_parser));
+    if (!p)
+        return NULL;
+    if (cb)
+        p->cb = *cb;
+    p->user = user;
+    p->s_empty = WINEXMPP_parser_intern(p, "", 0);
+    p->s_xml = WINEXMPP_parser_intern(p, "xml", 3);
+    if (!p->s_empty || !p->s_xml || WINEXMPP_parser_set_limits(p, 0, 0) != 0) {
+        WINEXMPP_parser_free(p);
+        return NULL;
+    }
+    return p;
+}
+
+int WINEXMPP_parser_feed(WINEXMPP_parser* p, const char* data, size_t len) {
+    if (!p || (!data && len))
+        return -1;
+    if (p->error)
+        return -1;
+    p->in_feed = 1;
+    p->stats.bytes += len;
+    size_t i = 0;
+    while (i < len) {
+        if (p->state == ST_TEXT) {
+            const char *lt = memchr(data + i, '<', len - i);
+            size_t end = lt ? (size_t)(lt - data) : len;
+            if (p->depth >= 2 && stanza_account(p, end - i + (lt ? 1 : 0)) != 0)
+                break;
+            /* Teks hanya disimpan di dalam stanza; whitespace keepalive di level stream dibuang */
+            if (p->depth >= 2 && tok_append(p, data + i, end - i) != 0)
+                break;
+            i = end;
+            if (!lt)
+                break;
+            if (p->depth >= 2 && flush_text(p) != 0)
+                break;
+            p->tok_len = 0;
+            p->state = ST_TAG;
+            p->tag_kind = 0;
+            p->quote = 0;
+            i++;
+            continue;
+        }
+
+        /* ST_TAG: kumpulkan sampai '>' di luar kutip */
+        size_t from = i, start = i;
+        int done = 0;
+        if (p->tok_len == 0 && p->tag_kind == 0) {
+            char c = data[i];
+            p->tag_kind = (c == '!' || c == '?' || c == '/') ? c : 1;
+        }
+        while (i < len) {
+            char c = data[i];
+            if (p->quote) {
+                if (c == p->quote)
+                    p->quote = 0;
+            } else if (c == '>') {
+                if (tok_append(p, data + start, i - start) != 0)
+                    break;
+                i++;
+                start = i;
+                if (tag_complete(p)) {
+                    done = 1;
+                    break;
+                }
+                if (tok_append(p, ">", 1) != 0)
+                    break;
+                continue;
+            } else if ((c == '"' || c == '\'') && p->tag_kind != '!') {
+                p->quote = c;
+            }
+            i++;
+        }
+        /* Tag pembuka stanza (depth 1) ikut dihitung; tag penutup dihitung sebelum stanza selesai */
+        if (!p->error && p->depth >= 1)
+            stanza_account(p, i - from);
+        if (p->error)
+            break;
+        if (!done) {
+            tok_append(p, data + start, i - start);
+            break;
+        }
+        int rc = process_tag(p);
+        p->tok_len = 0;
+        p->state = ST_TEXT;
+        /* Komentar/PI di antara stanza tidak menumpuk ke stanza berikutnya */
+        if (p->depth <= 1)
+            p->stanza_bytes = 0;
+        if (rc != 0)
+            break;
+        if (p->reset_pending)
+            do_reset(p);
+    }
+    p->in_feed = 0;
+    if (p->reset_pending)
+        do_reset(p);
+    return p->error ? -1 : 0;
+}
+
+void WINEXMPP_parser_reset(WINEXMPP_parser* p) {
+    if (!p)
+        return;
+    /* Dipanggil dari dalam callback: tunda sampai tag saat ini selesai diproses */
+    if (p->in_feed)
+        p->reset_pending = 1;
+    else
+        do_reset(p);
+}
+
+int WINEXMPP_parser_set_limits(WINEXMPP_parser* p, size_t max_stanza, int max_depth) {
+    if (!p || max_depth < 0)
+        return -1;
+    if (max_depth == 0)
+        max_depth = WINEXMPP_MAX_DEPTH;
+    /* Hanya di antara stanza: text_cap milik stanza yang sedang dirakit */
+    if (p->depth >= 2)
+        return -1;
+    size_t *cap = realloc(p->text_cap, (size_t)max_depth * sizeof(size_t));
+    p->stats.allocations++;
+    if (!cap)
+        return -1;
+    p->text_cap = cap;
+    p->max_stanza = max_stanza ? max_stanza : WINEXMPP_MAX_STANZA;
+    p->max_depth = max_depth;
+    return 0;
+}
+
+const char* WINEXMPP_parser_error(const WINEXMPP_parser* p) {
+    return p ? p->error : NULL;
+}
+
+const char* WINEXMPP_parser_condition(const WINEXMPP_parser* p) {
+    if (!p || !p->error)
+        return NULL;
+    return p->limit_hit ? "policy-violation" : "not-well-formed";
+}
+
+void WINEXMPP_parser_get_stats(const WINEXMPP_parser* p, WINEXMPP_parser_stats* out) {
+    if (!p || !out)
+        return;
+    *out = p->stats;
+    out->interned = p->icount;
+}
+
+
+void WINEXMPP_parser_free(WINEXMPP_parser* p) {
+    if (!p)
+        return;
+    free_blocks(p->arena_head);
+    free_blocks(p->ipool);
+    free_blocks(p->spool);
+    free(p->itab);
+    free(p->text_cap);
+    free(p->tok);
+    free(p->ns);
+    free(p);
+}
@@ -0,0 +1,711 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/sendfile.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include "irc_driver.h"
+#include "irc_dcc.h"
+#include "matrix_driver.h"
+#include "mock_ircd.h"
+#include "mock_homeserver.h"
+
+/* Benchmark transfer file DCC (irc_dcc.h) dan jembatannya ke media Matrix.
+
+   - ctcp: SEND aktif, SEND pasif dengan token, RESUME dan ACCEPT dibuat
+     dengan WINEIRC_dcc_format lalu dibaca ulang; nama file berspasi tetap
+     utuh dan nama dengan direktori hanya menyisakan basename.
+   - throughput: peer pengganti di proses anak mengirim/menerima file
+     THROUGHPUT_MB MB (argumen pertama mengganti ukuran dalam MB) lewat
+     localhost. Penerimaan splice dibandingkan dengan recv/write biasa dan
+     pengiriman sendfile dengan read/send biasa: MB/s, CPU proses ini per
+     GB dan jumlah syscall. Isi hasil terima harus sama dengan file asal.
+   - negosiasi: klien "peer" dan "bridge" di mock IRCd bernegosiasi lewat
+     PRIVMSG: SEND aktif, RESUME dari file yang sudah setengah diterima
+     (ACCEPT dari pengirim) dan DCC pasif (bridge yang listen). Isi file
+     akhir harus sama dengan file peer.
+   - matrix: file MATRIX_MB MB diterima bridge ke file sementara lalu
+     di-upload ke homeserver pengganti dengan WINEMATRIX_upload_media.
+     Kenaikan RSS puncak (disampel thread terpisah) harus tetap kecil dan
+     isi yang di-download handle lain harus sama. */
+
+#define MB              (1024 * 1024)
+#define THROUGHPUT_MB   256
+#define NEGOTIATE_SIZE  (8 * MB + 123)
+#define MATRIX_MB       128
+#define FLAT_RSS_MB     8.0     /* Batas kenaikan RSS puncak terima + upload */
+#define COPY_BUF        (256 * 1024)
+#define ROUNDS          3
+#define TIMEOUT_MS      10000
+#define LOCALHOST       0x7f000001u
+
+static char work_dir[] = "/tmp/bench_dcc_XXXXXX";
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static double cpu_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* --- RSS puncak --- */
+
+static volatile long rss_peak;
+static volatile int sampling = 1;
+static long page_kb;
+
+static long rss_kb(void) {
+    FILE *fp = fopen("/proc/self/statm", "r");
+    long size = 0, resident = 0;
+    if (fp) {
+        if (fscanf(fp, "%ld %ld", &size, &resident) != 2)
+            resident = 0;
+        fclose(fp);
+    }
+    return resident * page_kb;
+}
+
+static void* rss_sampler(void* arg) {
+    (void)arg;
+    while (sampling) {
+        long rss = rss_kb();
+        if (rss > rss_peak)
+            rss_peak = rss;
+        usleep(500);
+    }
+    return NULL;
+}
+
+static long rss_begin(void) {
+    long rss = rss_kb();
+    rss_peak = rss;
+    return rss;
+}
+
+static double rss_delta_mb(long start) {
+    long rss = rss_kb();
+    long peak = rss_peak > rss ? rss_peak : rss;
+    return (peak - start) / 1024.0;
+}
+
+/* --- File uji --- */
+
+/* Isi acak deterministik dari seed */
+static int make_file(const char* path, size_t size, uint64_t seed) {
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0600);
+    char *buf = malloc(MB);
+    if (fd < 0 || !buf) {
+        if (fd >= 0)
+            close(fd);
+        free(buf);
+        return -1;
+    }
+    uint64_t x = seed * 0x9e3779b97f4a7c15ULL + 1;
+    int ret = 0;
+    for (size_t done = 0; done < size && ret == 0;) {
+        size_t n = size - done < MB ? size - done : MB;
+        for (size_t i = 0; i + 8 <= MB; i += 8) {
+            x ^= x << 13;
+            x ^= x >> 7;
+            x ^= x << 17;
+            memcpy(buf + i, &x, 8);
+        }
+        ret = write(fd, buf, n) == (ssize_t)n ? 0 : -1;
+        done += n;
+    }
+    free(buf);
+    return ret == 0 ? fd : (close(fd), -1);
+}
+
+/* 1 jika isi kedua fd (dari offset 0) sama */
+static int same_content(int a, int b) {
+    char *x = malloc(MB), *y = malloc(MB);
+    int same = x && y;
+    for (off_t off = 0; same;) {
+        ssize_t n = pread(a, x, MB, off), m = pread(b, y, MB, off);
+        if (n != m || n < 0 || memcmp(x, y, (size_t)n) != 0)
+            same = 0;
+        if (n <= 0)
+            break;
+        off += n;
+    }
+    free(x);
+    free(y);
+    return same;
+}
+
+/* --- CTCP --- */
+
+/* 0 jika msg dibaca ulang dari hasil format tanpa berubah */
+static int roundtrip(const WINEIRC_dcc_message* msg) {
+    char line[600];
+    WINEIRC_dcc_message back;
+    if (WINEIRC_dcc_format(msg, "bridge", line, sizeof(line)) < 0)
+        return -1;
+    const char *text = strstr(line, " :");
+    if (!text || WINEIRC_dcc_parse(text + 2, &back) != 0)
+        return -1;
+    return back.type == msg->type && strcmp(back.filename, msg->filename) == 0 &&
+           (msg->type != WINEIRC_DCC_SEND || back.ip == msg->ip) && back.port == msg->port &&
+           back.size == msg->size && strcmp(back.token, msg->token) == 0 ? 0 : -1;
+}
+
+static int run_ctcp(void) {
+    WINEIRC_dcc_message send = { WINEIRC_DCC_SEND, "laporan akhir.pdf", LOCALHOST, 5000, 5000000000ULL, "" };
+    WINEIRC_dcc_message passive = { WINEIRC_DCC_SEND, "foto.png", LOCALHOST, 0, 1234, "42" };
+    WINEIRC_dcc_message resume = { WINEIRC_DCC_RESUME, "laporan akhir.pdf", 0, 5000, 4096, "" };
+    WINEIRC_dcc_message accept = { WINEIRC_DCC_ACCEPT, "foto.png", 0, 0, 4096, "42" };
+    const WINEIRC_dcc_message *all[] = { &send, &passive, &resume, &accept };
+    int ok = 1;
+    for (int i = 0; i < 4; i++)
+        ok = ok && roundtrip(all[i]) == 0;
+    WINEIRC_dcc_message m;
+    int base = WINEIRC_dcc_parse("\001DCC SEND ../../etc/passwd 2130706433 5000 10\001", &m) == 0 &&
+               strcmp(m.filename, "passwd") == 0;
+    int dotted = WINEIRC_dcc_parse("DCC SEND a.txt 127.0.0.1 5000 10", &m) == 0 && m.ip == LOCALHOST;
+    int reject = WINEIRC_dcc_parse("DCC SEND .. 2130706433 5000 10", &m) != 0 &&
+                 WINEIRC_dcc_parse("DCC SEND a.txt 2130706433 0 10", &m) != 0 &&
+                 WINEIRC_dcc_parse("DCC CHAT chat 2130706433 5000", &m) != 0;
+    ok = ok && base && dotted && reject;
+    printf("ctcp         : SEND aktif/pasif, RESUME, ACCEPT bolak-balik, direktori dibuang %s, "
+           "pasif tanpa token ditolak %s -> %s\n", base ? "ya" : "TIDAK", reject ? "ya" : "TIDAK", ok ? "OK" : "GAGAL");
+    return !ok;
+}
+
+/* --- Throughput dengan peer di proses anak --- */
+
+enum { PEER_SEND, PEER_RECV };
+
+/* Peer pengganti: terhubung ke port lalu mengirim src (sendfile) atau
+   menerima dan mengirim ack seperti klien DCC biasa */
+static pid_t peer_spawn(int role, int port, int src, uint64_t size) {
+    pid_t pid = fork();
+    if (pid != 0)
+        return pid;
+    struct sockaddr_in addr = { .sin_family = AF_INET, .sin_port = htons((uint16_t)port) };
+    addr.sin_addr.s_addr = htonl(LOCALHOST);
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0 || connect(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0)
+        _exit(1);
+    uint64_t done = 0;
+    uint32_t ack = 0;
+    if (role == PEER_SEND) {
+        off_t off = 0;
+        while (done < size) {
+            ssize_t n = sendfile(fd, src, &off, size - done > 16 * MB ? 16 * MB : (size_t)(size - done));
+            if (n <= 0)
+                _exit(1);
+            done += (uint64_t)n;
+            while (recv(fd, &ack, sizeof(ack), MSG_DONTWAIT) > 0)
+                ;
+        }
+        /* Ack terakhir: penerima sudah menulis semua */
+        while (ntohl(ack) != (uint32_t)size)
+            if (recv(fd, &ack, sizeof(ack), MSG_WAITALL) != sizeof(ack))
+                _exit(1);
+    } else {
+        char *buf = malloc(MB);
+        while (buf && done < size) {
+            ssize_t n = recv(fd, buf, MB, 0);
+            if (n <= 0)
+                _exit(1);
+            done += (uint64_t)n;
+            ack = htonl((uint32_t)done);
+            if (send(fd, &ack, sizeof(ack), MSG_NOSIGNAL) != sizeof(ack))
+                _exit(1);
+        }
+        /* Pengirim menutup setelah ack terakhir */
+        char c;
+        if (recv(fd, &c, 1, 0) != 0)
+            _exit(1);
+    }
+    close(fd);
+    _exit(0);
+}
+
+static int peer_wait(pid_t pid) {
+    int status;
+    return waitpid(pid, &status, 0) == pid && WIFEXITED(status) && WEXITSTATUS(status) == 0 ? 0 : -1;
+}
+
+/* Socket listen biasa untuk cara userspace */
+static int listen_local(int* port) {
+    struct sockaddr_in addr = { .sin_family = AF_INET };
+    addr.sin_addr.s_addr = htonl(LOCALHOST);
+    socklen_t len = sizeof(addr);
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0 || bind(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0 || listen(fd, 1) != 0 ||
+        getsockname(fd, (struct sockaddr*)&addr, &len) != 0) {
+        if (fd >= 0)
+            close(fd);
+        return -1;
+    }
+    *port = ntohs(addr.sin_port);
+    return fd;
+}
+
+typedef struct {
+    double mbps, cpu_per_gb;
+    unsigned long syscalls;
+} Result;
+
+static void finish(Result* r, uint64_t size, double t0, double c0, unsigned long syscalls) {
+    double gb = size / (1024.0 * MB);
+    r->mbps = size / (double)MB / (now_sec() - t0);
+    r->cpu_per_gb = (cpu_sec() - c0) / gb;
+    r->syscalls = syscalls;
+}
+
+/* recv ke buffer lalu write ke file, ack setiap blok */
+static int64_t copy_receive(int sock, int out, uint64_t size, unsigned long* syscalls) {
+    char *buf = malloc(COPY_BUF);
+    uint64_t done = 0;
+    while (buf && done < size) {
+        ssize_t n = recv(sock, buf, COPY_BUF, 0);
+        if (n <= 0 || pwrite(out, buf, (size_t)n, (off_t)done) != n)
+            break;
+        done += (uint64_t)n;
+        uint32_t ack = htonl((uint32_t)done);
+        if (send(sock, &ack, sizeof(ack), MSG_NOSIGNAL) != sizeof(ack))
+            break;
+        *syscalls += 3;
+    }
+    free(buf);
+    return done == size ? (int64_t)done : -1;
+}
+
+/* read dari file lalu send, ack dibaca di sela blok */
+static int64_t copy_send(int sock, int src, uint64_t size, unsigned long* syscalls) {
+    char *buf = malloc(COPY_BUF);
+    uint64_t done = 0;
+    uint32_t ack = 0;
+    while (buf && done < size) {
+        ssize_t n = pread(src, buf, COPY_BUF, (off_t)done);
+        if (n <= 0 || send(sock, buf, (size_t)n, MSG_NOSIGNAL) != n)
+            break;
+        done += (uint64_t)n;
+        *syscalls += 2;
+        while (recv(sock, &ack, sizeof(ack), MSG_DONTWAIT) > 0)
+            (*syscalls)++;
+        (*syscalls)++;
+    }
+    free(buf);
+    while (done == size && ntohl(ack) != (uint32_t)size)
+        if (recv(sock, &ack, sizeof(ack), MSG_WAITALL) != sizeof(ack))
+            return -1;
+    return done == size ? (int64_t)done : -1;
+}
+
+enum { RECV_SPLICE, RECV_COPY, SEND_SENDFILE, SEND_COPY };
+
+/* Satu transfer dengan peer baru; hasil disimpan di best jika CPU-nya
+   lebih kecil. 0 jika transfer lengkap (dan isi sama untuk penerimaan) */
+static int measure(int kind, int src, int out, uint64_t size, Result* best) {
+    int receiving = kind == RECV_SPLICE || kind == RECV_COPY;
+    int role = receiving ? PEER_SEND : PEER_RECV;
+    WINEIRC_dcc *dcc = NULL;
+    int port = -1, lfd = -1, sock = -1;
+    if (receiving && ftruncate(out, 0) != 0)
+        return -1;
+    if (kind == RECV_SPLICE || kind == SEND_SENDFILE) {
+        dcc = WINEIRC_dcc_listen("127.0.0.1", 0);
+        port = WINEIRC_dcc_port(dcc);
+    } else {
+        lfd = listen_local(&port);
+    }
+    pid_t pid = port > 0 ? peer_spawn(role, port, src, size) : -1;
+    if (pid > 0 && lfd >= 0)
+        sock = accept(lfd, NULL, NULL);
+    unsigned long calls = 1;
+    double t0 = now_sec(), c0 = cpu_sec();
+    int64_t moved = -1;
+    if (pid > 0) {
+        if (kind == RECV_SPLICE)
+            moved = WINEIRC_dcc_receive_file(dcc, out, 0, size, TIMEOUT_MS);
+        else if (kind == SEND_SENDFILE)
+            moved = WINEIRC_dcc_send_file(dcc, src, 0, size, TIMEOUT_MS);
+        else if (sock >= 0)
+            moved = receiving ? copy_receive(sock, out, size, &calls) : copy_send(sock, src, size, &calls);
+    }
+    Result r;
+    WINEIRC_dcc_stats st = { 0 };
+    if (dcc) {
+        WINEIRC_dcc_get_stats(dcc, &st);
+        calls = st.syscalls;
+    }
+    finish(&r, size, t0, c0, calls);
+    WINEIRC_dcc_free(dcc);
+    if (sock >= 0)
+        close(sock);
+    if (lfd >= 0)
+        close(lfd);
+    int ok = pid > 0 && peer_wait(pid) == 0 && moved == (int64_t)size && (!dcc || st.zero_copy) &&
+             (!receiving || same_content(src, out));
+    if (ok && (best->mbps == 0 || r.cpu_per_gb < best->cpu_per_gb))
+        *best = r;
+    return ok ? 0 : -1;
+}
+
+static int run_throughput(size_t size) {
+    char src_path[300], out_path[300];
+    snprintf(src_path, sizeof(src_path), "%s/sumber", work_dir);
+    snprintf(out_path, sizeof(out_path), "%s/hasil", work_dir);
+    int src = make_file(src_path, size, 1);
+    int out = open(out_path, O_RDWR | O_CREAT | O_TRUNC, 0600);
+    if (src < 0 || out < 0)
+        return 1;
+
+    /* Cara zero-copy dan userspace bergantian; yang dilaporkan adalah
+       putaran dengan CPU terkecil (mesin kecil berbagi CPU dengan peer) */
+    Result best[4];
+    memset(best, 0, sizeof(best));
+    int ok = 1;
+    for (int round = 0; round < ROUNDS && ok; round++)
+        for (int kind = RECV_SPLICE; kind <= SEND_COPY && ok; kind++)
+            ok = measure(kind, src, out, size, &best[kind]) == 0;
+    printf("terima       : %zu MB splice %6.0f MB/s, CPU %.2f s/GB, %lu syscall (recv/write %6.0f MB/s, "
+           "CPU %.2f s/GB, %lu syscall), isi %s -> %s\n", size / MB, best[RECV_SPLICE].mbps,
+           best[RECV_SPLICE].cpu_per_gb, best[RECV_SPLICE].syscalls, best[RECV_COPY].mbps,
+           best[RECV_COPY].cpu_per_gb, best[RECV_COPY].syscalls, ok ? "sama" : "BEDA", ok ? "OK" : "GAGAL");
+    printf("kirim        : %zu MB sendfile %6.0f MB/s, CPU %.2f s/GB, %lu syscall (read/send %6.0f MB/s, "
+           "CPU %.2f s/GB, %lu syscall) -> %s\n", size / MB, best[SEND_SENDFILE].mbps,
+           best[SEND_SENDFILE].cpu_per_gb, best[SEND_SENDFILE].syscalls, best[SEND_COPY].mbps,
+           best[SEND_COPY].cpu_per_gb, best[SEND_COPY].syscalls, ok ? "OK" : "GAGAL");
+
+    close(src);
+    close(out);
+    unlink(src_path);
+    unlink(out_path);
+    return !ok;
+}
+
+/* --- Negosiasi lewat IRC --- */
+
+typedef struct {
+    WINEIRC_handle *irc;
+    char buf[8192];
+    size_t len;
+} Reader;
+
+static int send_line(WINEIRC_handle* h, const char* line) {
+    size_t len = strlen(line);
+    return send(h->socket_fd, line, len, MSG_NOSIGNAL) == (ssize_t)len ? 0 : -1;
+}
+
+static int send_dcc(WINEIRC_handle* h, const WINEIRC_dcc_message* msg, const char* target) {
+    char line[600];
+    return WINEIRC_dcc_format(msg, target, line, sizeof(line)) < 0 ? -1 : send_line(h, line);
+}
+
+/* Baris berikutnya dari server (tanpa \r\n), -1 jika timeout */
+static int next_line(Reader* r, char* line, size_t len) {
+    double deadline = now_sec() + TIMEOUT_MS / 1000.0;
+    for (;;) {
+        char *end = strstr(r->buf, "\r\n");
+        if (end) {
+            size_t n = (size_t)(end - r->buf) < len ? (size_t)(end - r->buf) : len - 1;
+            memcpy(line, r->buf, n);
+            line[n] = '\0';
+            size_t used = (size_t)(end + 2 - r->buf);
+            memmove(r->buf, end + 2, r->len - used + 1);
+            r->len -= used;
+            return 0;
+        }
+        struct pollfd pfd = { r->irc->socket_fd, POLLIN, 0 };
+        int wait_ms = (int)((deadline - now_sec()) * 1000);
+        if (wait_ms <= 0 || poll(&pfd, 1, wait_ms) <= 0 || r->len + 1 >= sizeof(r->buf))
+            return -1;
+        ssize_t n = WINEIRC_recv(r->irc, r->buf + r->len, sizeof(r->buf) - r->len - 1, 0);
+        if (n <= 0)
+            return -1;
+        r->len += (size_t)n;
+        r->buf[r->len] = '\0';
+    }
+}
+
+/* Menunggu akhir NAMES dari JOIN sendiri: registrasi sudah selesai di
+   server, jadi PRIVMSG dari dan ke klien ini tidak ditolak */
+static int wait_joined(Reader* r) {
+    char line[1024];
+    while (next_line(r, line, sizeof(line)) == 0)
+        if (strstr(line, " 366 "))
+            return 0;
+    return -1;
+}
+
+/* Menunggu PRIVMSG berisi DCC dengan tipe type */
+static int read_dcc(Reader* r, WINEIRC_dcc_type type, WINEIRC_dcc_message* msg) {
+    char line[1024];
+    while (next_line(r, line, sizeof(line)) == 0) {
+        char *cmd = strstr(line, " PRIVMSG "), *text = cmd ? strstr(cmd, " :") : NULL;
+        if (text && WINEIRC_dcc_parse(text + 2, msg) == 0 && msg->type == type)
+            return 0;
+    }
+    return -1;
+}
+
+enum { MODE_ACTIVE, MODE_RESUME, MODE_PASSIVE };
+
+typedef struct {
+    Reader *reader;
+    int mode;
+    int fd;
+    uint64_t size;
+    const char *filename;
+    int64_t sent;
+} Peer;
+
+/* Klien IRC biasa yang menawarkan file ke bridge */
+static void* peer_thread(void* arg) {
+    Peer *p = arg;
+    WINEIRC_handle *irc = p->reader->irc;
+    WINEIRC_dcc_message offer = { WINEIRC_DCC_SEND, "", LOCALHOST, 0, p->size, "" };
+    snprintf(offer.filename, sizeof(offer.filename), "%s", p->filename);
+    WINEIRC_dcc *dcc = NULL;
+    uint64_t offset = 0;
+    p->sent = -1;
+    if (p->mode == MODE_PASSIVE) {
+        snprintf(offer.token, sizeof(offer.token), "77");
+        WINEIRC_dcc_message reply;
+        if (send_dcc(irc, &offer, "bridge") != 0 || read_dcc(p->reader, WINEIRC_DCC_SEND, &reply) != 0 ||
+            strcmp(reply.token, offer.token) != 0 || reply.port == 0)
+            return NULL;
+        dcc = WINEIRC_dcc_connect(reply.ip, reply.port, TIMEOUT_MS);
+    } else {
+        dcc = WINEIRC_dcc_listen("127.0.0.1", 0);
+        offer.port = WINEIRC_dcc_port(dcc);
+        if (!dcc || send_dcc(irc, &offer, "bridge") != 0) {
+            WINEIRC_dcc_free(dcc);
+            return NULL;
+        }
+        WINEIRC_dcc_message resume;
+        if (p->mode == MODE_RESUME) {
+            if (read_dcc(p->reader, WINEIRC_DCC_RESUME, &resume) != 0 || resume.port != offer.port ||
+                strcmp(resume.filename, offer.filename) != 0 || resume.size > p->size) {
+                WINEIRC_dcc_free(dcc);
+                return NULL;
+            }
+            resume.type = WINEIRC_DCC_ACCEPT;
+            offset = resume.size;
+            send_dcc(irc, &resume, "bridge");
+        }
+    }
+    if (dcc)
+        p->sent = WINEIRC_dcc_send_file(dcc, p->fd, offset, p->size, TIMEOUT_MS);
+    WINEIRC_dcc_free(dcc);
+    return NULL;
+}
+
+/* Sisi bridge: menerima offer dari peer ke out. Mengembalikan byte yang
+   diterima lewat DCC */
+static int64_t bridge_receive(Reader* r, int mode, int out) {
+    WINEIRC_dcc_message offer, accept;
+    if (read_dcc(r, WINEIRC_DCC_SEND, &offer) != 0)
+        return -1;
+    WINEIRC_dcc *dcc = NULL;
+    uint64_t offset = 0;
+    struct stat st;
+    if (mode == MODE_PASSIVE) {
+        dcc = WINEIRC_dcc_listen("127.0.0.1", 0);
+        WINEIRC_dcc_message reply = offer;
+        reply.ip = LOCALHOST;
+        reply.port = WINEIRC_dcc_port(dcc);
+        if (!dcc || offer.port != 0 || send_dcc(r->irc, &reply, "peer") != 0) {
+            WINEIRC_dcc_free(dcc);
+            return -1;
+        }
+    } else {
+        if (mode == MODE_RESUME) {
+            /* Lanjut dari isi yang sudah ada di out */
+            WINEIRC_dcc_message resume = { WINEIRC_DCC_RESUME, "", 0, offer.port, 0, "" };
+            memcpy(resume.filename, offer.filename, sizeof(resume.filename));
+            if (fstat(out, &st) != 0 || (resume.size = (uint64_t)st.st_size) > offer.size ||
+                send_dcc(r->irc, &resume, "peer") != 0 || read_dcc(r, WINEIRC_DCC_ACCEPT, &accept) != 0 ||
+                accept.port != offer.port)
+                return -1;
+            offset = accept.size;
+        }
+        dcc = WINEIRC_dcc_connect(offer.ip, offer.port, TIMEOUT_MS);
+    }
+    int64_t got = dcc ? WINEIRC_dcc_receive_file(dcc, out, offset, offer.size, TIMEOUT_MS) : -1;
+    WINEIRC_dcc_free(dcc);
+    return got;
+}
+
+static int run_negotiate(Reader* peer, Reader* bridge) {
+    static const char *names[] = { "aktif", "resume", "pasif" };
+    static const char *files[] = { "catatan rapat.txt", "arsip.tar", "foto.png" };
+    int ok = 1;
+    for (int mode = MODE_ACTIVE; mode <= MODE_PASSIVE && ok; mode++) {
+        char src_path[300], out_path[300];
+        snprintf(src_path, sizeof(src_path), "%s/peer%d", work_dir, mode);
+        snprintf(out_path, sizeof(out_path), "%s/bridge%d", work_dir, mode);
+        int src = make_file(src_path, NEGOTIATE_SIZE, 10 + (uint64_t)mode);
+        int out = open(out_path, O_RDWR | O_CREAT | O_TRUNC, 0600);
+        if (src < 0 || out < 0)
+            return 1;
+        uint64_t half = 0;
+        if (mode == MODE_RESUME) {
+            /* Transfer sebelumnya terputus di tengah */
+            half = NEGOTIATE_SIZE / 2;
+            char *buf = malloc(half);
+            ok = buf && pread(src, buf, half, 0) == (ssize_t)half && write(out, buf, half) == (ssize_t)half;
+            free(buf);
+        }
+        Peer p = { .reader = peer, .mode = mode, .fd = src, .size = NEGOTIATE_SIZE, .filename = files[mode] };
+        pthread_t t;
+        pthread_create(&t, NULL, peer_thread, &p);
+        int64_t got = bridge_receive(bridge, mode, out);
+        pthread_join(t, NULL);
+        struct stat st;
+        int same = fstat(out, &st) == 0 && st.st_size == NEGOTIATE_SIZE && same_content(src, out);
+        ok = ok && same && got == (int64_t)(NEGOTIATE_SIZE - half) && p.sent == got;
+        printf("negosiasi    : %-6s \"%s\" %llu byte lewat DCC (mulai %llu), isi %s -> %s\n", names[mode],
+               files[mode], (unsigned long long)(got > 0 ? got : 0), (unsigned long long)half,
+               same ? "sama" : "BEDA", ok ? "OK" : "GAGAL");
+        close(src);
+        close(out);
+        unlink(src_path);
+        unlink(out_path);
+    }
+    return !ok;
+}
+
+/* --- Jembatan ke media Matrix --- */
+
+static int run_matrix(Reader* peer, Reader* bridge, WINEMATRIX_handle* h, WINEMATRIX_handle* other) {
+    size_t size = (size_t)MATRIX_MB * MB;
+    char src_path[300], spool_path[300];
+    snprintf(src_path, sizeof(src_path), "%s/video", work_dir);
+    snprintf(spool_path, sizeof(spool_path), "%s/spool", work_dir);
+    int src = make_file(src_path, size, 99);
+    /* File sementara bridge: dihapus dari direktori, hanya fd yang tersisa */
+    int spool = open(spool_path, O_RDWR | O_CREAT | O_TRUNC, 0600);
+    unlink(spool_path);
+    if (src < 0 || spool < 0)
+        return 1;
+
+    Peer p = { .reader = peer, .mode = MODE_ACTIVE, .fd = src, .size = size, .filename = "video liburan.mp4" };
+    pthread_t t;
+    long start = rss_begin();
+    double t0 = now_sec();
+    pthread_create(&t, NULL, peer_thread, &p);
+    int64_t got = bridge_receive(bridge, MODE_ACTIVE, spool);
+    pthread_join(t, NULL);
+    double recv_sec = now_sec() - t0;
+    char *uri = NULL;
+    t0 = now_sec();
+    int up = got == (int64_t)size ? WINEMATRIX_upload_media(h, spool, "video/mp4", "video liburan.mp4", &uri) : -1;
+    double up_sec = now_sec() - t0, rss = rss_delta_mb(start);
+
+    /* Handle lain mengambil URI dari homeserver */
+    int dl = -1;
+    int same = up == 0 && WINEMATRIX_download_media(other, uri, &dl) == 0 && same_content(src, dl);
+    int ok = same && rss < FLAT_RSS_MB;
+    printf("matrix       : %zu MB DCC -> file %.0f MB/s, upload %.0f MB/s, RSS puncak +%.1f MB (batas %.0f MB), "
+           "download %s -> %s\n", size / MB, size / (double)MB / recv_sec, size / (double)MB / up_sec, rss,
+           FLAT_RSS_MB, same ? "sama" : "BEDA", ok ? "OK" : "GAGAL");
+    if (dl >= 0)
+        close(dl);
+    free(uri);
+    close(src);
+    close(spool);
+    unlink(src_path);
+    return !ok;
+}
+
+static void remove_tree(const char* dir) {
+    DIR *d = opendir(dir);
+    struct dirent *e;
+    char path[512];
+    while (d && (e = readdir(d)) != NULL) {
+        if (e->d_name[0] == '.')
+            continue;
+        snprintf(path, sizeof(path), "%s/%s", dir, e->d_name);
+        struct stat st;
+        if (lstat(path, &st) == 0 && S_ISDIR(st.st_mode))
+            remove_tree(path);
+        else
+            unlink(path);
+    }
+    if (d)
+        closedir(d);
+    rmdir(dir);
+}
+
+int main(int argc, char** argv) {
+    size_t size = (argc > 1 ? (size_t)atol(argv[1]) : THROUGHPUT_MB) * MB;
+    if (size < MB)
+        size = MB;
+    page_kb = sysconf(_SC_PAGESIZE) / 1024;
+    if (WINEIRC_global_init() != 0 || WINEMATRIX_global_init() != 0 || !mkdtemp(work_dir))
+        return 1;
+
+    int failed = run_ctcp();
+    if (!failed)
+        failed |= run_throughput(size);
+
+    char media_dir[300], cache_a[300], cache_b[300];
+    snprintf(media_dir, sizeof(media_dir), "%s/server", work_dir);
+    snprintf(cache_a, sizeof(cache_a), "%s/cache_a", work_dir);
+    snprintf(cache_b, sizeof(cache_b), "%s/cache_b", work_dir);
+    mkdir(media_dir, 0700);
+    mock_ircd_options iopt = { 0 };
+    mock_homeserver_options mopt = { .media_dir = media_dir };
+    pid_t ircd = -1, homeserver = -1;
+    int iport = failed ? -1 : mock_ircd_start(&iopt, &ircd);
+    int mport = iport < 0 ? -1 : mock_homeserver_start(&mopt, &homeserver);
+    WINEIRC_handle *bridge_irc = NULL, *peer_irc = NULL;
+    WINEMATRIX_handle *h = NULL, *other = NULL;
+    if (mport > 0) {
+        char url[64];
+        snprintf(url, sizeof(url), "http://127.0.0.1:%d", mport);
+        bridge_irc = WINEIRC_create("127.0.0.1", iport, "bridge", "bridge", "#dcc");
+        peer_irc = WINEIRC_create("127.0.0.1", iport, "peer", "peer", "#dcc");
+        h = WINEMATRIX_create(url, "bridge", "rahasia");
+        other = WINEMATRIX_create(url, "pembaca", "rahasia");
+    }
+    failed |= !bridge_irc || !peer_irc || !h || !other || WINEMATRIX_open_media_cache(h, cache_a, 0) != 0 ||
+              WINEMATRIX_open_media_cache(other, cache_b, 0) != 0;
+
+    static Reader peer, bridge;
+    peer.irc = peer_irc;
+    bridge.irc = bridge_irc;
+    failed |= !failed && (wait_joined(&peer) != 0 || wait_joined(&bridge) != 0);
+    pthread_t sampler;
+    pthread_create(&sampler, NULL, rss_sampler, NULL);
+    if (!failed)
+        failed |= run_negotiate(&peer, &bridge);
+    if (!failed)
+        failed |= run_matrix(&peer, &bridge, h, other);
+    sampling = 0;
+    pthread_join(sampler, NULL);
+
+    WINEIRC_free(peer_irc);
+    WINEIRC_free(bridge_irc);
+    WINEMATRIX_free(h);
+    WINEMATRIX_free(other);
+    if (ircd > 0 && mock_ircd_stop(ircd) != 0)
+        failed = 1;
+    if (homeserver > 0 && mock_homeserver_stop(homeserver) != 0)
+        failed = 1;
+    remove_tree(work_dir);
+    WINEMATRIX_global_cleanup();
+    WINEIRC_global_cleanup();
+    return failed;
+}
@@ -0,0 +1,349 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include "irc_driver.h"
+#include "irc_loop.h"
+#include "irc_handover.h"
+#include "mock_ircd.h"
+
+/* Benchmark handover koneksi IRC ke proses pengganti (irc_handover.h),
+   untuk backend poll dan io_uring.
+
+   - sisa: satu koneksi socketpair. Proses lama sudah membaca setengah
+     baris (dengan blok tag lebih dari 8192 byte, masih di bawah batas
+     IRCv3) dan punya satu pesan di antrean saat menyerahkan koneksi;
+     proses baru harus menerima baris utuh setelah sisanya datang dan
+     "server" harus menerima pesan antrean.
+   - handover: proses lama memegang PUPPETS puppet di satu channel mock
+     IRCd sementara watcher mengirim MESSAGES pesan bernomor, satu per
+     milidetik. Setelah pesan HANDOVER_AT, proses lama mengantrekan satu
+     pesan per puppet lalu menyerahkan semua koneksi ke proses baru yang
+     sudah menunggu. Setiap puppet harus menerima setiap pesan tepat
+     sekali (di proses lama atau baru), watcher harus menerima setiap
+     pesan antrean tepat sekali, dan server tidak boleh melihat QUIT, PART
+     atau JOIN tambahan. Blackout adalah waktu dari awal handover sampai
+     proses baru memegang semua koneksi. */
+
+#define PUPPETS      200
+#define MESSAGES     1500
+#define HANDOVER_AT  500
+#define CHANNEL      "#handover"
+#define PARTIAL      ":a!a@localhost PRIVMSG #sisa :sat"
+#define PARTIAL_TAGS 8300       /* Panjang nilai tag di depan PARTIAL */
+
+typedef struct {
+    unsigned char seen[PUPPETS][MESSAGES + 1];  /* Penerimaan per puppet per nomor pesan */
+    int old_ready;
+    int new_done;
+    int finish;                 /* Watcher selesai menghitung: proses baru boleh QUIT */
+    int handed, received;
+    double handover_start, handover_end;
+} Shared;
+
+static Shared *shared;
+static int joined, max_seq;
+static char partial[WINEIRC_LINE_MAX], partial_line[WINEIRC_LINE_MAX];
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static const char* backend_name(WINEIRC_backend backend) {
+    return backend == WINEIRC_BACKEND_URING ? "io_uring" : "poll";
+}
+
+/* --- sisa --- */
+
+static void partial_on_line(WINEIRC_handle* handle, char* line, void* user_data) {
+    (void)handle;
+    (void)user_data;
+    snprintf(partial_line, sizeof(partial_line), "%s", line);
+}
+
+static int run_partial(WINEIRC_backend backend, const char* path) {
+    int sv[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) != 0)
+        return -1;
+    memcpy(partial, "@+x=", 4);
+    memset(partial + 4, 'a', PARTIAL_TAGS);
+    snprintf(partial + 4 + PARTIAL_TAGS, sizeof(partial) - 4 - PARTIAL_TAGS, " %s", PARTIAL);
+    size_t partial_len = strlen(partial);
+    if (write(sv[0], partial, partial_len) != (ssize_t)partial_len)
+        return -1;
+    WINEIRC_loop_callbacks cb = { partial_on_line, NULL };
+    pid_t pid = fork();
+    if (pid == 0) {
+        close(sv[0]);
+        WINEIRC_handle *h = WINEIRC_create_fd(sv[1], "local", 6667, "sisa", "sisa", "#sisa", NULL, NULL);
+        WINEIRC_loop *loop = WINEIRC_loop_create(backend, &cb, NULL);
+        if (!h || !loop || WINEIRC_loop_add(loop, h) != 0)
+            _exit(1);
+        WINEIRC_loop_stats stats;
+        do {
+            WINEIRC_loop_run(loop, 100);
+            WINEIRC_loop_get_stats(loop, &stats);
+        } while (stats.bytes_in < partial_len);
+        const char *queued = "PRIVMSG #sisa :antre\r\n";
+        WINEIRC_loop_send(loop, h, queued, strlen(queued));
+        int n = WINEIRC_handover_send(path, loop, &h, 1, 5000);
+        WINEIRC_loop_free(loop);
+        WINEIRC_free(h);
+        _exit(n == 1 ? 0 : 1);
+    }
+    close(sv[1]);
+
+    partial_line[0] = '\0';
+    WINEIRC_loop *loop = WINEIRC_loop_create(backend, &cb, NULL);
+    WINEIRC_handle **handles = NULL;
+    int n = loop ? WINEIRC_handover_receive(path, loop, &handles, 5000) : -1;
+    int status = -1;
+    waitpid(pid, &status, 0);
+    if (write(sv[0], "u\r\n", 3) != 3)
+        return -1;
+    char out[64] = "";
+    size_t out_len = 0;
+    double deadline = now_sec() + 2;
+    while ((!partial_line[0] || out_len < 22) && now_sec() < deadline) {
+        WINEIRC_loop_run(loop, 10);
+        ssize_t r = recv(sv[0], out + out_len, sizeof(out) - 1 - out_len, MSG_DONTWAIT);
+        if (r > 0)
+            out_len += (size_t)r;
+    }
+    out[out_len] = '\0';
+    size_t line_len = strlen(partial_line);
+    int ok = n == 1 && WIFEXITED(status) && WEXITSTATUS(status) == 0 && line_len == partial_len + 1 &&
+             strncmp(partial_line, partial, partial_len) == 0 && partial_line[partial_len] == 'u' &&
+             strcmp(out, "PRIVMSG #sisa :antre\r\n") == 0;
+    printf("sisa     : %s, baris terpotong %zu byte \"...%s\", antrean %s -> %s\n", backend_name(backend),
+           line_len, line_len > 20 ? partial_line + line_len - 20 : partial_line, out_len ? "terkirim" : "hilang",
+           ok ? "OK" : "GAGAL");
+    for (int i = 0; i < n; i++) {
+        WINEIRC_loop_remove(loop, handles[i]);
+        WINEIRC_free(handles[i]);
+    }
+    free(handles);
+    WINEIRC_loop_free(loop);
+    close(sv[0]);
+    return ok ? 0 : -1;
+}
+
+/* --- handover --- */
+
+static void puppet_on_line(WINEIRC_handle* handle, char* line, void* user_data) {
+    (void)user_data;
+    int i = atoi(handle->nick + 2);
+    const char *seq = strstr(line, " PRIVMSG " CHANNEL " :seq ");
+    if (seq) {
+        int n = atoi(seq + sizeof(" PRIVMSG " CHANNEL " :seq ") - 1);
+        if (n >= 1 && n <= MESSAGES && i >= 0 && i < PUPPETS && shared->seen[i][n] < 255)
+            shared->seen[i][n]++;
+        if (n > max_seq)
+            max_seq = n;
+    } else if (strstr(line, " 366 ")) {
+        joined++;
+    }
+}
+
+static void puppet_handles_free(WINEIRC_loop* loop, WINEIRC_handle** handles, int n) {
+    for (int i = 0; i < n; i++) {
+        if (!handles[i])
+            continue;
+        WINEIRC_loop_remove(loop, handles[i]);
+        WINEIRC_free(handles[i]);
+    }
+}
+
+static void old_main(int port, const char* path, WINEIRC_backend backend) {
+    WINEIRC_loop_callbacks cb = { puppet_on_line, NULL };
+    WINEIRC_loop *loop = WINEIRC_loop_create(backend, &cb, NULL);
+    WINEIRC_handle *handles[PUPPETS];
+    if (!loop)
+        _exit(1);
+    WINEIRC_loop_set_keepalive(loop, 0);
+    for (int i = 0; i < PUPPETS; i++) {
+        char nick[16];
+        snprintf(nick, sizeof(nick), "hp%03d", i);
+        handles[i] = WINEIRC_create("127.0.0.1", port, nick, nick, CHANNEL);
+        if (!handles[i] || WINEIRC_loop_add(loop, handles[i]) != 0)
+            _exit(1);
+    }
+    double deadline = now_sec() + 10;
+    while (joined < PUPPETS && now_sec() < deadline)
+        WINEIRC_loop_run(loop, 100);
+    shared->old_ready = joined == PUPPETS;
+    while (max_seq < HANDOVER_AT && now_sec() < deadline + 10)
+        WINEIRC_loop_run(loop, 100);
+
+    for (int i = 0; i < PUPPETS; i++) {
+        char line[64];
+        int len = snprintf(line, sizeof(line), "PRIVMSG " CHANNEL " :pending %d\r\n", i);
+        WINEIRC_loop_send(loop, handles[i], line, (size_t)len);
+    }
+    shared->handover_start = now_sec();
+    shared->handed = WINEIRC_handover_send(path, loop, handles, PUPPETS, 5000);
+    puppet_handles_free(loop, handles, PUPPETS);
+    WINEIRC_loop_free(loop);
+    _exit(0);
+}
+
+static void new_main(const char* path, WINEIRC_backend backend) {
+    WINEIRC_loop_callbacks cb = { puppet_on_line, NULL };
+    WINEIRC_loop *loop = WINEIRC_loop_create(backend, &cb, NULL);
+    WINEIRC_handle **handles = NULL;
+    if (!loop)
+        _exit(1);
+    WINEIRC_loop_set_keepalive(loop, 0);
+    int n = WINEIRC_handover_receive(path, loop, &handles, 30000);
+    shared->handover_end = now_sec();
+    shared->received = n;
+    double deadline = now_sec() + 10;
+    while (n > 0 && max_seq < MESSAGES && now_sec() < deadline)
+        WINEIRC_loop_run(loop, 100);
+    /* Sisa pesan terakhir ke puppet lain */
+    for (double end = now_sec() + 0.2; now_sec() < end; )
+        WINEIRC_loop_run(loop, 50);
+    shared->new_done = 1;
+    while (!shared->finish)
+        usleep(10000);
+    puppet_handles_free(loop, handles, n);
+    free(handles);
+    WINEIRC_loop_free(loop);
+    _exit(0);
+}
+
+typedef struct {
+    int joins, leaves;          /* JOIN dan QUIT/PART puppet yang dilihat watcher */
+    int pending[PUPPETS];
+    int joined;                 /* 366 watcher sendiri: JOIN puppet sesudahnya terlihat */
+    int counting;
+} Watcher;
+
+static void watcher_on_line(WINEIRC_handle* handle, char* line, void* user_data) {
+    (void)handle;
+    Watcher *w = user_data;
+    if (strstr(line, " 366 watcher "))
+        w->joined = 1;
+    if (*line == '@' && (line = strchr(line, ' ')) != NULL)
+        line++;
+    if (!line || !w->counting || strncmp(line, ":hp", 3) != 0)
+        return;
+    const char *pending = strstr(line, " :pending ");
+    if (strstr(line, " JOIN "))
+        w->joins++;
+    else if (strstr(line, " QUIT ") || strstr(line, " PART "))
+        w->leaves++;
+    else if (pending) {
+        int i = atoi(pending + 10);
+        if (i >= 0 && i < PUPPETS)
+            w->pending[i]++;
+    }
+}
+
+static int run_handover(WINEIRC_backend backend, const char* path) {
+    mock_ircd_options opt = { 0 };
+    pid_t ircd;
+    int port = mock_ircd_start(&opt, &ircd);
+    if (port < 0)
+        return -1;
+    memset(shared, 0, sizeof(*shared));
+
+    Watcher w;
+    memset(&w, 0, sizeof(w));
+    w.counting = 1;
+    WINEIRC_loop_callbacks cb = { watcher_on_line, NULL };
+    WINEIRC_loop *loop = WINEIRC_loop_create(WINEIRC_BACKEND_POLL, &cb, &w);
+    WINEIRC_handle *watcher = WINEIRC_create("127.0.0.1", port, "watcher", "watcher", CHANNEL);
+    if (!loop || !watcher || WINEIRC_loop_add(loop, watcher) != 0)
+        return -1;
+    WINEIRC_loop_set_keepalive(loop, 0);
+    double deadline = now_sec() + 5;
+    while (!w.joined && now_sec() < deadline)
+        WINEIRC_loop_run(loop, 10);
+
+    /* Proses baru sudah menunggu sebelum proses lama siap */
+    pid_t new_pid = fork();
+    if (new_pid == 0)
+        new_main(path, backend);
+    pid_t old_pid = fork();
+    if (old_pid == 0)
+        old_main(port, path, backend);
+
+    deadline = now_sec() + 15;
+    while (!shared->old_ready && now_sec() < deadline)
+        WINEIRC_loop_run(loop, 10);
+    double start = now_sec();
+    for (int seq = 1; seq <= MESSAGES && shared->old_ready; seq++) {
+        char line[64];
+        int len = snprintf(line, sizeof(line), "PRIVMSG " CHANNEL " :seq %d\r\n", seq);
+        WINEIRC_loop_send(loop, watcher, line, (size_t)len);
+        /* Satu pesan per milidetik */
+        while (now_sec() < start + seq / 1000.0)
+            WINEIRC_loop_run(loop, 1);
+    }
+    deadline = now_sec() + 15;
+    while (!shared->new_done && now_sec() < deadline)
+        WINEIRC_loop_run(loop, 10);
+    for (double end = now_sec() + 0.2; now_sec() < end; )
+        WINEIRC_loop_run(loop, 10);
+    w.counting = 0;
+    shared->finish = 1;
+    int status_old = -1, status_new = -1;
+    waitpid(old_pid, &status_old, 0);
+    waitpid(new_pid, &status_new, 0);
+
+    long lost = 0, duplicated = 0, pending_bad = 0;
+    for (int i = 0; i < PUPPETS; i++) {
+        for (int n = 1; n <= MESSAGES; n++) {
+            lost += shared->seen[i][n] == 0;
+            duplicated += shared->seen[i][n] > 1 ? shared->seen[i][n] - 1 : 0;
+        }
+        pending_bad += w.pending[i] != 1;
+    }
+    int ok = shared->old_ready && shared->handed == PUPPETS && shared->received == PUPPETS &&
+             lost == 0 && duplicated == 0 && pending_bad == 0 && w.joins == PUPPETS && w.leaves == 0 &&
+             WIFEXITED(status_old) && WEXITSTATUS(status_old) == 0 &&
+             WIFEXITED(status_new) && WEXITSTATUS(status_new) == 0;
+    printf("handover : %s, %d/%d puppet diserahkan, blackout %.2f ms\n", backend_name(backend),
+           shared->received, PUPPETS, (shared->handover_end - shared->handover_start) * 1000);
+    printf("           %d pesan x %d puppet: %ld hilang, %ld ganda; antrean %d/%d pesan terkirim sekali; "
+           "JOIN %d, QUIT/PART %d -> %s\n", MESSAGES, PUPPETS, lost, duplicated, PUPPETS - (int)pending_bad,
+           PUPPETS, w.joins, w.leaves, ok ? "OK" : "GAGAL");
+
+    WINEIRC_loop_remove(loop, watcher);
+    WINEIRC_free(watcher);
+    WINEIRC_loop_free(loop);
+    if (mock_ircd_stop(ircd) != 0)
+        return -1;
+    return ok ? 0 : -1;
+}
+
+int main(void) {
+    signal(SIGPIPE, SIG_IGN);
+    if (WINEIRC_global_init() != 0)
+        return 1;
+    shared = mmap(NULL, sizeof(Shared), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (shared == MAP_FAILED)
+        return 1;
+    char path[64];
+    snprintf(path, sizeof(path), "/tmp/bench_handover_%d.sock", (int)getpid());
+
+    WINEIRC_backend backends[2] = { WINEIRC_BACKEND_POLL, WINEIRC_BACKEND_URING };
+    int count = WINEIRC_loop_uring_supported() ? 2 : 1;
+    if (count == 1)
+        printf("io_uring tidak didukung kernel, hanya backend poll\n");
+    int rc = 0;
+    for (int i = 0; i < count; i++)
+        if (run_partial(backends[i], path) != 0 || run_handover(backends[i], path) != 0)
+            rc = 1;
+    munmap(shared, sizeof(Shared));
+    WINEIRC_global_cleanup();
+    return rc;
+}
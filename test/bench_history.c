@@ -0,0 +1,513 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <curl/curl.h>
+#include <json-c/json.h>
+#include "irc_driver.h"
+#include "irc_loop.h"
+#include "irc_parser.h"
+#include "matrix_driver.h"
+#include "mock_ircd.h"
+#include "mock_homeserver.h"
+
+/* Benchmark catch-up setelah reconnect: IRCv3 CHATHISTORY (irc_history.h)
+   lalu import ke Matrix dengan pipelining (WINEMATRIX_import_messages).
+
+   - catchup: handle "bridge" di WINEIRC_loop melacak history di mock IRCd
+     dengan CHATHISTORY. LIVE pesan diterima live, koneksi bridge diputus,
+     OUTAGE pesan dikirim selama putus, lalu bridge reconnect
+     (WINEIRC_reconnect + WINEIRC_loop_add) sementara CONCURRENT pesan lagi
+     dikirim selama catch-up berjalan. Urutan pesan yang dilihat bridge
+     (live, on_batch, live sesudahnya) harus 0..N-1 tanpa celah dan tanpa
+     duplikat, dengan satu on_batch.
+   - import: isi on_batch dikirim ke homeserver pengganti sebagai
+     appservice (puppet @irc_alice, ts dari server-time IRC). Timeline room
+     harus memuat semua pesan itu berurutan dengan sender dan
+     origin_server_ts asli; import ulang batch yang sama tidak menambah
+     event (txnId dari msgid).
+   - throughput: PIPELINE_N pesan dikirim satu per satu dengan
+     WINEMATRIX_send_message dibandingkan dengan import window 1 (satu
+     koneksi, tanpa pipelining) dan window WINDOW.
+   - gangguan: homeserver pengganti kedua menjawab 429 dan 500 secara
+     acak. Import window 1 harus tetap berurutan; dengan window WINDOW
+     setiap pesan tetap tersimpan tepat sekali dan jumlah pesan yang
+     terlambat sama dengan stats.reordered. */
+
+#define LIVE            200
+#define OUTAGE          2000
+#define CONCURRENT      100
+#define TOTAL           (LIVE + OUTAGE + CONCURRENT)
+#define PIPELINE_N      2000
+#define WINDOW          32
+#define TIMEOUT_MS      20000
+#define CHANNEL         "#history"
+#define AS_TOKEN        "as_rahasia_bench"
+#define PUPPET          "@irc_alice:localhost"
+#define FAULT_N         500
+#define FAULT_PERMILLE  20
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* --- Klien pengirim --- */
+
+typedef struct {
+    WINEIRC_handle *irc;
+    char buf[8192];
+    size_t len;
+} Reader;
+
+static int send_raw(WINEIRC_handle* h, const char* line) {
+    size_t len = strlen(line);
+    return send(h->socket_fd, line, len, MSG_NOSIGNAL) == (ssize_t)len ? 0 : -1;
+}
+
+/* Baris berikutnya dari server (tanpa \r\n), -1 jika timeout */
+static int next_line(Reader* r, char* line, size_t len) {
+    double deadline = now_sec() + TIMEOUT_MS / 1000.0;
+    for (;;) {
+        char *end = strstr(r->buf, "\r\n");
+        if (end) {
+            size_t n = (size_t)(end - r->buf) < len ? (size_t)(end - r->buf) : len - 1;
+            memcpy(line, r->buf, n);
+            line[n] = '\0';
+            size_t used = (size_t)(end + 2 - r->buf);
+            memmove(r->buf, end + 2, r->len - used + 1);
+            r->len -= used;
+            return 0;
+        }
+        struct pollfd pfd = { r->irc->socket_fd, POLLIN, 0 };
+        int wait_ms = (int)((deadline - now_sec()) * 1000);
+        if (wait_ms <= 0 || poll(&pfd, 1, wait_ms) <= 0 || r->len + 1 >= sizeof(r->buf))
+            return -1;
+        ssize_t n = WINEIRC_recv(r->irc, r->buf + r->len, sizeof(r->buf) - r->len - 1, 0);
+        if (n <= 0)
+            return -1;
+        r->len += (size_t)n;
+        r->buf[r->len] = '\0';
+    }
+}
+
+static int wait_for(Reader* r, const char* needle) {
+    char line[1024];
+    while (next_line(r, line, sizeof(line)) == 0)
+        if (strstr(line, needle))
+            return 0;
+    return -1;
+}
+
+/* Mengirim pesan "m <from>".."m <to-1>" */
+static int send_range(Reader* r, int from, int to) {
+    char line[64];
+    for (int i = from; i < to; i++) {
+        snprintf(line, sizeof(line), "PRIVMSG " CHANNEL " :m %d\r\n", i);
+        if (send_raw(r->irc, line) != 0)
+            return -1;
+    }
+    return 0;
+}
+
+/* Menunggu server selesai memproses semua perintah sebelumnya */
+static int sync_server(Reader* r) {
+    return send_raw(r->irc, "PING :sync\r\n") == 0 ? wait_for(r, "PONG") : -1;
+}
+
+/* --- Bridge --- */
+
+typedef struct {
+    int *seq;                   /* Nomor pesan sesuai urutan diterima bridge */
+    int nseq;
+    int64_t ts[TOTAL];          /* server-time tiap pesan, dari on_batch */
+    int joined, closed;
+    int batches;
+    int batch_first, batch_count;
+    double reconnect_at, batch_at;
+    WINEMATRIX_handle *matrix;
+    const char *room;
+    WINEMATRIX_import_message *imported;    /* Salinan batch untuk import ulang */
+    char (*keys)[WINEIRC_HISTORY_MSGID_MAX];
+    char (*bodies)[32];
+    long import_result;
+    WINEMATRIX_import_stats import_stats;
+} Bridge;
+
+/* Nomor dari teks "m <n>", -1 jika bukan pesan uji */
+static int message_number(const char* text) {
+    return strncmp(text, "m ", 2) == 0 ? atoi(text + 2) : -1;
+}
+
+static void on_line(WINEIRC_handle* handle, char* line, void* user_data) {
+    (void)handle;
+    Bridge *b = user_data;
+    WINEIRC_message msg;
+    if (WINEIRC_parse_line(line, &msg) != 0)
+        return;
+    if (strcmp(msg.command, "366") == 0)
+        b->joined = 1;
+    if (strcmp(msg.command, "PRIVMSG") == 0 && msg.param_count >= 2 && b->nseq < TOTAL * 2) {
+        int n = message_number(msg.params[1]);
+        if (n >= 0)
+            b->seq[b->nseq++] = n;
+    }
+}
+
+static void on_close(WINEIRC_handle* handle, void* user_data) {
+    (void)handle;
+    ((Bridge*)user_data)->closed = 1;
+}
+
+static void on_batch(const char* channel, const WINEIRC_history_message* messages, size_t count, void* user_data) {
+    (void)channel;
+    Bridge *b = user_data;
+    b->batch_at = now_sec();
+    b->batches++;
+    b->batch_first = b->nseq;
+    b->batch_count = (int)count;
+    free(b->imported);
+    free(b->keys);
+    free(b->bodies);
+    b->imported = calloc(count, sizeof(*b->imported));
+    b->keys = calloc(count, sizeof(*b->keys));
+    b->bodies = calloc(count, sizeof(*b->bodies));
+    if (!b->imported || !b->keys || !b->bodies)
+        return;
+    for (size_t i = 0; i < count; i++) {
+        int n = message_number(messages[i].text);
+        if (b->nseq < TOTAL * 2)
+            b->seq[b->nseq++] = n;
+        if (n >= 0 && n < TOTAL)
+            b->ts[n] = messages[i].time_ms;
+        snprintf(b->keys[i], sizeof(b->keys[i]), "%s", messages[i].msgid);
+        snprintf(b->bodies[i], sizeof(b->bodies[i]), "%s", messages[i].text);
+        b->imported[i] = (WINEMATRIX_import_message){ PUPPET, b->bodies[i], NULL, messages[i].time_ms, b->keys[i] };
+    }
+    WINEMATRIX_import_config cfg = { .as_token = AS_TOKEN, .window = WINDOW, .join_puppets = 1 };
+    b->import_result = WINEMATRIX_import_messages(b->matrix, b->room, b->imported, count, &cfg, &b->import_stats);
+}
+
+/* Menjalankan loop sampai *flag tidak 0 atau timeout */
+static int run_until(WINEIRC_loop* loop, volatile int* flag) {
+    double deadline = now_sec() + TIMEOUT_MS / 1000.0;
+    while (!*flag && now_sec() < deadline)
+        if (WINEIRC_loop_run(loop, 10) < 0)
+            return -1;
+    return *flag ? 0 : -1;
+}
+
+static int run_catchup(WINEIRC_loop* loop, WINEIRC_handle* bridge, Reader* alice, Bridge* b) {
+    /* Pesan live sebelum putus */
+    if (send_range(alice, 0, LIVE) != 0)
+        return 1;
+    double deadline = now_sec() + TIMEOUT_MS / 1000.0;
+    while (b->nseq < LIVE && now_sec() < deadline)
+        WINEIRC_loop_run(loop, 10);
+
+    /* Koneksi bridge putus tanpa QUIT; pesan berikutnya hanya ada di history server */
+    shutdown(bridge->socket_fd, SHUT_RDWR);
+    if (run_until(loop, &b->closed) != 0 || send_range(alice, LIVE, LIVE + OUTAGE) != 0 || sync_server(alice) != 0)
+        return 1;
+
+    b->reconnect_at = now_sec();
+    if (WINEIRC_reconnect(bridge) != 0 || WINEIRC_loop_add(loop, bridge) != 0)
+        return 1;
+    /* Pesan baru selama reconnect dan catch-up: sebagian tiba live sebelum
+       CHATHISTORY dijawab dan juga ada di history */
+    int sent = LIVE + OUTAGE;
+    deadline = now_sec() + TIMEOUT_MS / 1000.0;
+    while (b->nseq < TOTAL && now_sec() < deadline) {
+        if (sent < TOTAL) {
+            int next = sent + 5 < TOTAL ? sent + 5 : TOTAL;
+            if (send_range(alice, sent, next) != 0)
+                return 1;
+            sent = next;
+        }
+        WINEIRC_loop_run(loop, 2);
+    }
+    /* Duplikat yang mungkin tertinggal */
+    for (int i = 0; i < 20; i++)
+        WINEIRC_loop_run(loop, 5);
+
+    int ordered = b->nseq == TOTAL;
+    for (int i = 0; ordered && i < TOTAL; i++)
+        ordered = b->seq[i] == i;
+    WINEIRC_history_stats hs;
+    WINEIRC_history_get_stats(bridge->history, &hs);
+    int ok = ordered && b->batches == 1 && b->batch_count >= OUTAGE;
+    printf("catchup      : %d pesan live, %d saat putus, %d selama catch-up; diterima %d urut tanpa celah=%s\n",
+           LIVE, OUTAGE, CONCURRENT, b->nseq, ordered ? "ya" : "tidak");
+    printf("               on_batch %d x (%d pesan) %.1f ms setelah reconnect, %lu CHATHISTORY, "
+           "%lu ditahan, %lu duplikat dibuang -> %s\n",
+           b->batches, b->batch_count, (b->batch_at - b->reconnect_at) * 1000, hs.requests, hs.held, hs.duplicates,
+           ok ? "OK" : "GAGAL");
+    return !ok;
+}
+
+/* --- Verifikasi timeline Matrix --- */
+
+static size_t collect(void* data, size_t size, size_t nmemb, void* user) {
+    size_t n = size * nmemb;
+    struct { char *p; size_t len; } *buf = user;
+    char *p = realloc(buf->p, buf->len + n + 1);
+    if (!p)
+        return 0;
+    memcpy(p + buf->len, data, n);
+    buf->p = p;
+    buf->len += n;
+    buf->p[buf->len] = '\0';
+    return n;
+}
+
+/* Event m.room.message room (urutan stream) ke array json baru, NULL jika gagal */
+static json_object* fetch_timeline(WINEMATRIX_handle* h, const char* room) {
+    json_object *events = json_object_new_array();
+    char from[32] = "s0";
+    CURL *curl = curl_easy_init();
+    for (int page = 0; curl && page < 1000; page++) {
+        char url[512];
+        snprintf(url, sizeof(url), "%s/_matrix/client/v3/rooms/%s/messages?dir=f&limit=1000&from=%s&access_token=%s",
+                 h->homeserver, room, from, h->access_token);
+        struct { char *p; size_t len; } buf = { NULL, 0 };
+        curl_easy_setopt(curl, CURLOPT_URL, url);
+        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, collect);
+        curl_easy_setopt(curl, CURLOPT_WRITEDATA, &buf);
+        json_object *obj = curl_easy_perform(curl) == CURLE_OK && buf.p ? json_tokener_parse(buf.p) : NULL;
+        free(buf.p);
+        json_object *chunk, *end;
+        if (!obj || !json_object_object_get_ex(obj, "chunk", &chunk)) {
+            json_object_put(obj);
+            json_object_put(events);
+            events = NULL;
+            break;
+        }
+        for (size_t i = 0; i < json_object_array_length(chunk); i++) {
+            json_object *ev = json_object_array_get_idx(chunk, i), *type;
+            if (json_object_object_get_ex(ev, "type", &type) &&
+                strcmp(json_object_get_string(type), "m.room.message") == 0)
+                json_object_array_add(events, json_object_get(ev));
+        }
+        int more = json_object_object_get_ex(obj, "end", &end);
+        if (more)
+            snprintf(from, sizeof(from), "%s", json_object_get_string(end));
+        json_object_put(obj);
+        if (!more)
+            break;
+    }
+    if (curl)
+        curl_easy_cleanup(curl);
+    return events;
+}
+
+static const char* field(json_object* ev, const char* a, const char* b) {
+    json_object *v;
+    if (!json_object_object_get_ex(ev, a, &v))
+        return "";
+    if (b && !json_object_object_get_ex(v, b, &v))
+        return "";
+    return json_object_get_string(v);
+}
+
+static int run_import(Bridge* b) {
+    json_object *events = fetch_timeline(b->matrix, b->room);
+    size_t count = events ? json_object_array_length(events) : 0;
+    int ok = b->import_result == b->batch_count && (int)count == b->batch_count;
+    int first = b->batch_count > 0 ? b->seq[b->batch_first] : 0;
+    for (size_t i = 0; ok && i < count; i++) {
+        json_object *ev = json_object_array_get_idx(events, i), *ts;
+        int n = message_number(field(ev, "content", "body"));
+        ok = n == first + (int)i && strcmp(field(ev, "sender", NULL), PUPPET) == 0 &&
+             json_object_object_get_ex(ev, "origin_server_ts", &ts) && json_object_get_int64(ts) == b->ts[n];
+    }
+    json_object_put(events);
+    const WINEMATRIX_import_stats *st = &b->import_stats;
+    printf("import       : %zu event berurutan dengan sender puppet dan ts asli, %zu request (%zu join) di %zu koneksi, "
+           "%.1f ms -> %s\n",
+           count, st->requests, st->joins, st->connections, st->seconds * 1000, ok ? "OK" : "GAGAL");
+
+    /* Import ulang: txnId sama, homeserver menjawab dengan event lama */
+    WINEMATRIX_import_config cfg = { .as_token = AS_TOKEN, .window = WINDOW, .join_puppets = 1 };
+    WINEMATRIX_import_stats again;
+    long sent = WINEMATRIX_import_messages(b->matrix, b->room, b->imported, (size_t)b->batch_count, &cfg, &again);
+    events = fetch_timeline(b->matrix, b->room);
+    size_t after = events ? json_object_array_length(events) : 0;
+    json_object_put(events);
+    int idem = sent == b->batch_count && after == count;
+    printf("idempoten    : import ulang %ld pesan, timeline tetap %zu event -> %s\n", sent, after,
+           idem ? "OK" : "GAGAL");
+    return !(ok && idem);
+}
+
+/* --- Throughput --- */
+
+static int run_throughput(WINEMATRIX_handle* h) {
+    static WINEMATRIX_import_message msgs[PIPELINE_N];
+    static char bodies[PIPELINE_N][32];
+    const char *rooms[3] = { "!seq:localhost", "!win1:localhost", "!pipe:localhost" };
+    for (int i = 0; i < PIPELINE_N; i++) {
+        snprintf(bodies[i], sizeof(bodies[i]), "m %d", i);
+        msgs[i] = (WINEMATRIX_import_message){ PUPPET, bodies[i], NULL, 1700000000000LL + i, NULL };
+    }
+    for (int r = 0; r < 3; r++)
+        if (WINEMATRIX_join_room(h, rooms[r]) != 0)
+            return 1;
+
+    double start = now_sec();
+    int failures = 0;
+    for (int i = 0; i < PIPELINE_N; i++)
+        failures += WINEMATRIX_send_message(h, rooms[0], bodies[i]) != 0;
+    double sequential = now_sec() - start;
+
+    WINEMATRIX_import_stats st[2];
+    long sent[2];
+    for (int k = 0; k < 2; k++) {
+        WINEMATRIX_import_config cfg = { .as_token = AS_TOKEN, .window = k == 0 ? 1 : WINDOW, .join_puppets = 1 };
+        sent[k] = WINEMATRIX_import_messages(h, rooms[1 + k], msgs, PIPELINE_N, &cfg, &st[k]);
+    }
+    int ordered = 1;
+    for (int r = 0; r < 3; r++) {
+        json_object *events = fetch_timeline(h, rooms[r]);
+        ordered &= events && json_object_array_length(events) == PIPELINE_N;
+        for (int i = 0; ordered && i < PIPELINE_N; i++)
+            ordered = message_number(field(json_object_array_get_idx(events, (size_t)i), "content", "body")) == i;
+        json_object_put(events);
+    }
+    int ok = failures == 0 && sent[0] == PIPELINE_N && sent[1] == PIPELINE_N && ordered &&
+             st[1].seconds < sequential;
+    printf("throughput   : %d pesan; send_message %.0f msg/s, import window 1 %.0f msg/s, window %d %.0f msg/s "
+           "(%.1fx) urut=%s -> %s\n",
+           PIPELINE_N, PIPELINE_N / sequential, PIPELINE_N / st[0].seconds, WINDOW, PIPELINE_N / st[1].seconds,
+           sequential / st[1].seconds, ordered ? "ya" : "tidak", ok ? "OK" : "GAGAL");
+    return !ok;
+}
+
+/* --- Gangguan 429/5xx --- */
+
+static json_object* fetch_timeline_retry(WINEMATRIX_handle* h, const char* room) {
+    json_object *events = NULL;
+    for (int i = 0; !events && i < 50; i++)
+        events = fetch_timeline(h, room);
+    return events;
+}
+
+static int run_faults(void) {
+    mock_homeserver_options mopt = { .as_token = AS_TOKEN, .rate_limit_permille = FAULT_PERMILLE,
+                                     .error_permille = FAULT_PERMILLE, .retry_after_ms = 20 };
+    pid_t pid = -1;
+    int port = mock_homeserver_start(&mopt, &pid);
+    if (port < 0)
+        return 1;
+    char url[64];
+    snprintf(url, sizeof(url), "http://127.0.0.1:%d", port);
+    WINEMATRIX_handle *h = WINEMATRIX_create(url, "bridge", "rahasia");
+    static WINEMATRIX_import_message msgs[FAULT_N];
+    static char bodies[FAULT_N][32];
+    for (int i = 0; i < FAULT_N; i++) {
+        snprintf(bodies[i], sizeof(bodies[i]), "m %d", i);
+        msgs[i] = (WINEMATRIX_import_message){ PUPPET, bodies[i], NULL, 1700000000000LL + i, NULL };
+    }
+    const char *rooms[2] = { "!fault1:localhost", "!faultn:localhost" };
+    WINEMATRIX_import_stats st[2] = { { 0 } };
+    long sent[2] = { 0, 0 };
+    int late[2] = { 0, 0 }, stored[2] = { 0, 0 }, ok = h != NULL;
+    for (int k = 0; ok && k < 2; k++) {
+        int joined = -1;
+        for (int i = 0; joined != 0 && i < 50; i++)
+            joined = WINEMATRIX_join_room(h, rooms[k]);
+        WINEMATRIX_import_config cfg = { .as_token = AS_TOKEN, .window = k == 0 ? 1 : WINDOW, .join_puppets = 1,
+                                         .max_retries = 20 };
+        sent[k] = WINEMATRIX_import_messages(h, rooms[k], msgs, FAULT_N, &cfg, &st[k]);
+        /* Terlambat: nomornya lebih kecil dari pesan yang sudah tampil sebelumnya */
+        json_object *events = fetch_timeline_retry(h, rooms[k]);
+        static char seen[FAULT_N];
+        memset(seen, 0, sizeof(seen));
+        int max = -1, unique = 1;
+        for (size_t i = 0; events && i < json_object_array_length(events); i++) {
+            int n = message_number(field(json_object_array_get_idx(events, i), "content", "body"));
+            if (n < 0 || n >= FAULT_N || seen[n]) {
+                unique = 0;
+                continue;
+            }
+            seen[n] = 1;
+            stored[k]++;
+            if (n < max)
+                late[k]++;
+            else
+                max = n;
+        }
+        json_object_put(events);
+        ok = joined == 0 && events && unique && sent[k] == FAULT_N && stored[k] == FAULT_N &&
+             (size_t)late[k] == st[k].reordered;
+    }
+    ok = ok && late[0] == 0 && st[0].retries > 0 && st[1].retries > 0;
+    printf("gangguan     : %d pesan dengan %d%% 429 + %d%% 500; window 1: %zu diulang, %d terlambat; window %d: "
+           "%zu diulang, %d terlambat (reordered %zu), %zu request, tersimpan %d/%d sekali -> %s\n",
+           FAULT_N, FAULT_PERMILLE / 10, FAULT_PERMILLE / 10, st[0].retries, late[0], WINDOW, st[1].retries,
+           late[1], st[1].reordered, st[1].requests, stored[0], stored[1], ok ? "OK" : "GAGAL");
+    WINEMATRIX_free(h);
+    if (mock_homeserver_stop(pid) != 0)
+        ok = 0;
+    return !ok;
+}
+
+int main(void) {
+    if (WINEIRC_global_init() != 0 || WINEMATRIX_global_init() != 0)
+        return 1;
+    mock_ircd_options iopt = { .history_lines = TOTAL * 2 };
+    mock_homeserver_options mopt = { .as_token = AS_TOKEN };
+    pid_t ircd = -1, homeserver = -1;
+    int iport = mock_ircd_start(&iopt, &ircd);
+    int mport = iport < 0 ? -1 : mock_homeserver_start(&mopt, &homeserver);
+    int failed = mport < 0;
+
+    static Bridge b;
+    b.seq = calloc(TOTAL * 2, sizeof(int));
+    b.room = "!history:localhost";
+    WINEIRC_handle *bridge = NULL, *alice_irc = NULL;
+    WINEIRC_loop *loop = NULL;
+    if (!failed) {
+        char url[64];
+        snprintf(url, sizeof(url), "http://127.0.0.1:%d", mport);
+        b.matrix = WINEMATRIX_create(url, "bridge", "rahasia");
+        bridge = WINEIRC_create("127.0.0.1", iport, "bridge", "bridge", CHANNEL);
+        alice_irc = WINEIRC_create("127.0.0.1", iport, "alice", "alice", CHANNEL);
+        WINEIRC_history_callbacks hcb = { on_batch };
+        WINEIRC_loop_callbacks lcb = { on_line, on_close };
+        loop = WINEIRC_loop_create(WINEIRC_BACKEND_POLL, &lcb, &b);
+        failed = !b.seq || !b.matrix || !bridge || !alice_irc || !loop ||
+                 WINEMATRIX_join_room(b.matrix, b.room) != 0 ||
+                 WINEIRC_track_history(bridge, NULL, &hcb, &b) != 0 || WINEIRC_loop_add(loop, bridge) != 0;
+    }
+    static Reader alice;
+    alice.irc = alice_irc;
+    failed |= !failed && (wait_for(&alice, " 366 ") != 0 || run_until(loop, &b.joined) != 0);
+    if (!failed)
+        failed |= run_catchup(loop, bridge, &alice, &b);
+    if (!failed)
+        failed |= run_import(&b);
+    if (!failed)
+        failed |= run_throughput(b.matrix);
+    if (!failed)
+        failed |= run_faults();
+
+    WINEIRC_loop_free(loop);
+    WINEIRC_free(alice_irc);
+    WINEIRC_free(bridge);
+    WINEMATRIX_free(b.matrix);
+    free(b.seq);
+    free(b.imported);
+    free(b.keys);
+    free(b.bodies);
+    if (ircd > 0 && mock_ircd_stop(ircd) != 0)
+        failed = 1;
+    if (homeserver > 0 && mock_homeserver_stop(homeserver) != 0)
+        failed = 1;
+    WINEMATRIX_global_cleanup();
+    WINEIRC_global_cleanup();
+    return failed;
+}
@@ -0,0 +1,272 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <time.h>
+#include "irc_driver.h"
+#include "irc_loop.h"
+#include "mock_ircd.h"
+
+/* Benchmark driver IRC terhadap mock IRCd lokal (test/mock_ircd.c).
+
+   - connect: CLIENTS handle dibuat dengan WINEIRC_create; latensi dihitung
+     dari awal create sampai 366 (akhir NAMES untuk JOIN sendiri).
+   - pesan: setiap klien mengirim MESSAGES PRIVMSG lewat WINEIRC_send_message
+     ke channel berisi CHANNEL_SIZE klien; penerimaan lewat WINEIRC_loop.
+     Setiap pesan membawa waktu kirim sehingga latensi end-to-end
+     (kirim -> relay server -> callback) diukur per penerimaan.
+   - flood: server dengan penalti flood; pesan yang melebihi burst harus
+     ditahan server sesuai rate, bukan diputus. */
+
+#define CLIENTS        200
+#define CHANNEL_SIZE   8
+#define MESSAGES       250
+#define FLOOD_BURST    10
+#define FLOOD_RATE     50
+#define FLOOD_MESSAGES 40
+#define REG_COMMANDS   5        /* CAP REQ, NICK, USER, CAP END, JOIN */
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static double cpu_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int cmp_double(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return x < y ? -1 : x > y;
+}
+
+static double percentile(const double* sorted, long n, double p) {
+    if (n <= 0)
+        return 0;
+    long i = (long)(p * (n - 1) + 0.5);
+    return sorted[i];
+}
+
+typedef struct {
+    WINEIRC_handle **handles;
+    double *started;            /* Awal create per klien */
+    double *joined;             /* Waktu 366 diterima, 0 jika belum */
+    int joined_count;
+    double *latency;            /* Latensi end-to-end per penerimaan (detik) */
+    long received;
+    long capacity;
+    double last_rx;
+    int closed;
+} Bench;
+
+static Bench bench;
+
+static int client_index(const WINEIRC_handle* handle) {
+    for (int i = 0; i < CLIENTS; i++)
+        if (bench.handles[i] == handle)
+            return i;
+    return -1;
+}
+
+static void on_line(WINEIRC_handle* handle, char* line, void* user_data) {
+    (void)user_data;
+    const char *privmsg = strstr(line, " PRIVMSG ");
+    if (privmsg) {
+        /* Teks: "<pengirim> <detik kirim>" */
+        const char *text = strstr(privmsg, " :");
+        const char *space = text ? strchr(text + 2, ' ') : NULL;
+        if (space && bench.received < bench.capacity) {
+            double now = now_sec();
+            bench.latency[bench.received++] = now - strtod(space + 1, NULL);
+            bench.last_rx = now;
+        }
+        return;
+    }
+    if (strstr(line, " 366 ")) {
+        int i = client_index(handle);
+        if (i >= 0 && bench.joined[i] == 0) {
+            bench.joined[i] = now_sec();
+            bench.joined_count++;
+        }
+    }
+}
+
+static void on_close(WINEIRC_handle* handle, void* user_data) {
+    (void)handle;
+    (void)user_data;
+    bench.closed++;
+}
+
+static int run_until(WINEIRC_loop* loop, const int* counter, int target, double timeout) {
+    double deadline = now_sec() + timeout;
+    while (*counter < target && now_sec() < deadline)
+        if (WINEIRC_loop_run(loop, 100) < 0)
+            return -1;
+    return *counter >= target ? 0 : -1;
+}
+
+static int run_main(void) {
+    mock_ircd_options opt = { 0 };
+    pid_t pid;
+    int port = mock_ircd_start(&opt, &pid);
+    if (port < 0)
+        return -1;
+
+    bench.handles = calloc(CLIENTS, sizeof(WINEIRC_handle*));
+    bench.started = calloc(CLIENTS, sizeof(double));
+    bench.joined = calloc(CLIENTS, sizeof(double));
+    bench.capacity = (long)CLIENTS * MESSAGES * (CHANNEL_SIZE - 1);
+    bench.latency = malloc((size_t)bench.capacity * sizeof(double));
+    WINEIRC_loop_callbacks cb = { on_line, on_close };
+    WINEIRC_loop *loop = WINEIRC_loop_create(WINEIRC_BACKEND_AUTO, &cb, NULL);
+    if (!bench.handles || !bench.started || !bench.joined || !bench.latency || !loop)
+        return -1;
+    WINEIRC_loop_set_keepalive(loop, 0);
+
+    /* --- connect --- */
+    double cpu = cpu_sec(), wall = now_sec();
+    for (int i = 0; i < CLIENTS; i++) {
+        char nick[32], channel[32];
+        snprintf(nick, sizeof(nick), "bot%d", i);
+        snprintf(channel, sizeof(channel), "#bench%d", i / CHANNEL_SIZE);
+        bench.started[i] = now_sec();
+        bench.handles[i] = WINEIRC_create("127.0.0.1", port, nick, nick, channel);
+        if (!bench.handles[i] || WINEIRC_loop_add(loop, bench.handles[i]) != 0) {
+            fprintf(stderr, "Klien %d gagal terhubung\n", i);
+            return -1;
+        }
+    }
+    if (run_until(loop, &bench.joined_count, CLIENTS, 10) != 0) {
+        fprintf(stderr, "Hanya %d/%d klien selesai JOIN\n", bench.joined_count, CLIENTS);
+        return -1;
+    }
+    wall = now_sec() - wall;
+    cpu = cpu_sec() - cpu;
+    double *conn_lat = malloc(CLIENTS * sizeof(double));
+    for (int i = 0; i < CLIENTS; i++)
+        conn_lat[i] = bench.joined[i] - bench.started[i];
+    qsort(conn_lat, CLIENTS, sizeof(double), cmp_double);
+    printf("backend loop: %s\n", WINEIRC_loop_backend(loop) == WINEIRC_BACKEND_URING ? "io_uring" : "poll");
+    printf("connect  : %d klien dalam %.1f ms = %.0f klien/s, CPU %.1f us/klien, "
+           "sampai JOIN p50 %.2f ms p99 %.2f ms\n",
+           CLIENTS, wall * 1000, CLIENTS / wall, cpu * 1e6 / CLIENTS,
+           percentile(conn_lat, CLIENTS, 0.50) * 1000, percentile(conn_lat, CLIENTS, 0.99) * 1000);
+    free(conn_lat);
+
+    /* --- pesan --- */
+    long expected = bench.capacity;
+    cpu = cpu_sec();
+    wall = now_sec();
+    for (int r = 0; r < MESSAGES; r++) {
+        for (int i = 0; i < CLIENTS; i++) {
+            char text[64];
+            snprintf(text, sizeof(text), "%d %.9f", i, now_sec());
+            if (WINEIRC_send_message(bench.handles[i], text) != 0)
+                return -1;
+        }
+        WINEIRC_loop_run(loop, 0);
+    }
+    double deadline = now_sec() + 30;
+    while (bench.received < expected && now_sec() < deadline)
+        WINEIRC_loop_run(loop, 100);
+    cpu = cpu_sec() - cpu;
+    wall = bench.last_rx - wall;
+    if (bench.received != expected) {
+        fprintf(stderr, "Hanya %ld/%ld pesan diterima\n", bench.received, expected);
+        return -1;
+    }
+    long sent = (long)CLIENTS * MESSAGES;
+    WINEIRC_loop_stats stats;
+    WINEIRC_loop_get_stats(loop, &stats);
+    qsort(bench.latency, (size_t)bench.received, sizeof(double), cmp_double);
+    printf("pesan    : %ld kirim, %ld terima (channel %d klien) dalam %.2f s\n",
+           sent, bench.received, CHANNEL_SIZE, wall);
+    printf("           %.0f kirim/s, %.0f terima/s, CPU %.2f us/pesan terima, %.2f us/pesan kirim\n",
+           sent / wall, bench.received / wall, cpu * 1e6 / bench.received, cpu * 1e6 / sent);
+    printf("           latensi end-to-end p50 %.3f ms p90 %.3f ms p99 %.3f ms max %.3f ms\n",
+           percentile(bench.latency, bench.received, 0.50) * 1000,
+           percentile(bench.latency, bench.received, 0.90) * 1000,
+           percentile(bench.latency, bench.received, 0.99) * 1000,
+           bench.latency[bench.received - 1] * 1000);
+    printf("           loop: %.3f syscall/pesan terima\n", (double)stats.syscalls / bench.received);
+
+    for (int i = 0; i < CLIENTS; i++) {
+        WINEIRC_loop_remove(loop, bench.handles[i]);
+        WINEIRC_free(bench.handles[i]);
+    }
+    WINEIRC_loop_free(loop);
+    free(bench.handles);
+    free(bench.started);
+    free(bench.joined);
+    free(bench.latency);
+    int closed = bench.closed;
+    memset(&bench, 0, sizeof(bench));
+    if (mock_ircd_stop(pid) != 0 || closed != 0)
+        return -1;
+    return 0;
+}
+
+/* Satu pengirim membanjiri channel; penerima mengukur kapan pesan terakhir tiba */
+static int run_flood(void) {
+    mock_ircd_options opt = { .flood_burst = FLOOD_BURST, .flood_rate = FLOOD_RATE, .verbose = 1 };
+    pid_t pid;
+    int port = mock_ircd_start(&opt, &pid);
+    if (port < 0)
+        return -1;
+
+    bench.handles = calloc(CLIENTS, sizeof(WINEIRC_handle*));
+    bench.joined = calloc(CLIENTS, sizeof(double));
+    bench.capacity = FLOOD_MESSAGES;
+    bench.latency = malloc(FLOOD_MESSAGES * sizeof(double));
+    WINEIRC_loop_callbacks cb = { on_line, on_close };
+    WINEIRC_loop *loop = WINEIRC_loop_create(WINEIRC_BACKEND_AUTO, &cb, NULL);
+    WINEIRC_handle *receiver = WINEIRC_create("127.0.0.1", port, "penerima", "penerima", "#flood");
+    bench.handles[0] = receiver;
+    if (!loop || !receiver || WINEIRC_loop_add(loop, receiver) != 0 ||
+        run_until(loop, &bench.joined_count, 1, 5) != 0)
+        return -1;
+
+    WINEIRC_handle *sender = WINEIRC_create("127.0.0.1", port, "pembanjir", "pembanjir", "#flood");
+    if (!sender)
+        return -1;
+    double start = now_sec();
+    for (int i = 0; i < FLOOD_MESSAGES; i++) {
+        char text[64];
+        snprintf(text, sizeof(text), "%d %.9f", i, now_sec());
+        WINEIRC_send_message(sender, text);
+    }
+    double deadline = start + 10;
+    while (bench.received < FLOOD_MESSAGES && now_sec() < deadline)
+        WINEIRC_loop_run(loop, 100);
+    double elapsed = bench.last_rx - start;
+    double expected = (double)(FLOOD_MESSAGES + REG_COMMANDS - FLOOD_BURST) / FLOOD_RATE;
+    int ok = bench.received == FLOOD_MESSAGES && elapsed >= expected * 0.8;
+    printf("flood    : %d pesan (burst %d, %d/s) tiba dalam %.0f ms, perkiraan %.0f ms -> %s\n",
+           FLOOD_MESSAGES, FLOOD_BURST, FLOOD_RATE, elapsed * 1000, expected * 1000, ok ? "OK" : "GAGAL");
+
+    WINEIRC_loop_remove(loop, receiver);
+    WINEIRC_free(receiver);
+    WINEIRC_free(sender);
+    WINEIRC_loop_free(loop);
+    free(bench.handles);
+    free(bench.joined);
+    free(bench.latency);
+    memset(&bench, 0, sizeof(bench));
+    if (mock_ircd_stop(pid) != 0)
+        return -1;
+    return ok ? 0 : -1;
+}
+
+int main(void) {
+    signal(SIGPIPE, SIG_IGN);
+    if (WINEIRC_global_init() != 0)
+        return 1;
+    printf("%d klien, channel %d klien, %d pesan per klien\n", CLIENTS, CHANNEL_SIZE, MESSAGES);
+    int rc = run_main() == 0 && run_flood() == 0 ? 0 : 1;
+    WINEIRC_global_cleanup();
+    return rc;
+}
@@ -0,0 +1,178 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <pthread.h>
+#include "log.h"
+
+/* Benchmark biaya per panggilan logger asinkron (source/berry/b2b/log.c).
+
+   Setiap skenario dijalankan dalam batch BATCH panggilan yang diukur; di
+   antara batch ring dikosongkan dengan WINEB2B_log_flush (tidak diukur),
+   sehingga yang terukur adalah biaya pemanggil, bukan pemformatan.
+   Pembanding: fprintf ke FILE ber-buffer, fprintf + fflush per baris
+   (perilaku stdout ke terminal / pipe yang di-flush) dan snprintf + write
+   per baris (perilaku stderr tanpa buffer). Output ke /dev/null.
+
+   Terakhir output logger ke file diperiksa: jumlah baris, quoting nilai
+   dan laporan sampling. */
+
+#define CALLS   200000
+#define BATCH   1000
+#define THREADS 4
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static const char body[] =
+    "{\"event_id\":\"$Gv3xq8mD2Xhz1n4VQ1aV7nYb5oR0c2pLkz7uE9wT1aQ\"}";
+
+static char big_body[1024];
+
+enum { S_LOG, S_LOG_BIG, S_FILTERED, S_COMPILED_OUT, S_SAMPLED, S_FPRINTF, S_FPRINTF_FLUSH, S_WRITE, S_CLOCK };
+
+static void one_call(int scenario, FILE* devnull, int fd, long i) {
+    char line[2048];
+    switch (scenario) {
+    case S_LOG:
+        WINEB2B_LOG_INFO("matrix", "op=send room=%s status=%ld seq=%ld body=%s", "!room:localhost", 200L, i, body);
+        break;
+    case S_LOG_BIG:
+        WINEB2B_LOG_INFO("matrix", "op=sync status=%ld seq=%ld body=%s", 200L, i, big_body);
+        break;
+    case S_FILTERED:
+        /* WINEB2B_log_level dinaikkan ke WARN: hanya satu perbandingan */
+        WINEB2B_LOG_INFO("matrix", "op=send room=%s status=%ld seq=%ld body=%s", "!room:localhost", 200L, i, body);
+        break;
+    case S_COMPILED_OUT:
+        WINEB2B_LOG_DEBUG("matrix", "op=send room=%s status=%ld seq=%ld body=%s", "!room:localhost", 200L, i, body);
+        break;
+    case S_SAMPLED:
+        WINEB2B_LOG_INFO("irc.rx", "server=%s seq=%ld data=%s", "irc.localhost", i, body);
+        break;
+    case S_FPRINTF:
+        fprintf(devnull, "Respons pengiriman (%ld): %s\n", i, body);
+        break;
+    case S_FPRINTF_FLUSH:
+        fprintf(devnull, "Respons pengiriman (%ld): %s\n", i, body);
+        fflush(devnull);
+        break;
+    case S_CLOCK: {
+        /* Timestamp record: bagian terbesar biaya log di VM tanpa vDSO cepat */
+        struct timespec ts;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        __asm__ volatile("" : : "r"(&ts) : "memory");
+        break;
+    }
+    case S_WRITE: {
+        int n = snprintf(line, sizeof(line), "Respons pengiriman (%ld): %s\n", i, body);
+        if (write(fd, line, (size_t)n) < 0)
+            return;
+        break;
+    }
+    }
+}
+
+static double run(int scenario, FILE* devnull, int fd) {
+    double total = 0;
+    for (long done = 0; done < CALLS; done += BATCH) {
+        double start = now_sec();
+        for (long i = done; i < done + BATCH; i++)
+            one_call(scenario, devnull, fd, i);
+        total += now_sec() - start;
+        WINEB2B_log_flush();
+    }
+    return total * 1e9 / CALLS;
+}
+
+static void* worker(void* arg) {
+    long id = (long)arg;
+    for (long i = 0; i < CALLS / THREADS; i++)
+        WINEB2B_LOG_INFO("bench", "thread=%ld seq=%ld body=%s", id, i, body);
+    return NULL;
+}
+
+static int count_lines(const char* path, const char* needle, long* lines) {
+    FILE *f = fopen(path, "r");
+    if (!f)
+        return -1;
+    char line[4096];
+    long hits = 0;
+    *lines = 0;
+    while (fgets(line, sizeof(line), f)) {
+        (*lines)++;
+        if (needle && strstr(line, needle))
+            hits++;
+    }
+    fclose(f);
+    return (int)hits;
+}
+
+int main(void) {
+    int failed = 0;
+    memset(big_body, 'x', sizeof(big_body) - 1);
+    FILE *devnull = fopen("/dev/null", "w");
+    int fd = fileno(devnull);
+    if (!devnull || WINEB2B_log_open("/dev/null") != 0)
+        return 1;
+    WINEB2B_log_set_sampling("irc.rx", 100, 0);
+
+    printf("%-28s %10s\n", "skenario", "ns/panggil");
+    printf("%-28s %10.1f\n", "log (4 argumen)", run(S_LOG, devnull, fd));
+    printf("%-28s %10.1f\n", "log (body 1 KB)", run(S_LOG_BIG, devnull, fd));
+    printf("%-28s %10.1f\n", "log sampling 1/100", run(S_SAMPLED, devnull, fd));
+    WINEB2B_log_level = WINEB2B_LOG_LEVEL_WARN;
+    printf("%-28s %10.1f\n", "log di bawah level runtime", run(S_FILTERED, devnull, fd));
+    WINEB2B_log_level = WINEB2B_LOG_LEVEL_INFO;
+    printf("%-28s %10.1f\n", "log DEBUG (dikompilasi out)", run(S_COMPILED_OUT, devnull, fd));
+    printf("%-28s %10.1f\n", "fprintf ber-buffer", run(S_FPRINTF, devnull, fd));
+    printf("%-28s %10.1f\n", "fprintf + fflush", run(S_FPRINTF_FLUSH, devnull, fd));
+    printf("%-28s %10.1f\n", "snprintf + write", run(S_WRITE, devnull, fd));
+    printf("%-28s %10.1f\n", "(clock_gettime saja)", run(S_CLOCK, devnull, fd));
+
+    /* Beberapa thread sekaligus: tiap thread punya ring sendiri */
+    pthread_t threads[THREADS];
+    double start = now_sec();
+    for (long i = 0; i < THREADS; i++)
+        pthread_create(&threads[i], NULL, worker, (void*)i);
+    for (int i = 0; i < THREADS; i++)
+        pthread_join(threads[i], NULL);
+    double elapsed = now_sec() - start;
+    WINEB2B_log_flush();
+    WINEB2B_log_stats stats;
+    WINEB2B_log_get_stats(&stats);
+    printf("%d thread: %.1f ns/panggil (dinding), record %llu, ditulis %llu, ring penuh %llu, disampling %llu\n",
+           THREADS, elapsed * 1e9 / CALLS, (unsigned long long)stats.records, (unsigned long long)stats.written,
+           (unsigned long long)stats.dropped, (unsigned long long)stats.suppressed);
+
+    /* Isi output */
+    char path[] = "/tmp/bench_log_XXXXXX";
+    int tmp = mkstemp(path);
+    if (tmp < 0)
+        return 1;
+    close(tmp);
+    WINEB2B_log_open(path);
+    WINEB2B_LOG_INFO("bench", "event=check text=%s n=%d ratio=%.2f", "dua kata \"kutip\"\n", 42, 0.5);
+    for (int i = 0; i < 1000; i++)
+        WINEB2B_LOG_INFO("irc.rx", "server=%s seq=%d", "irc.localhost", i);
+    WINEB2B_log_flush();
+    long lines = 0;
+    int quoted = count_lines(path, "cat=bench event=check text=\"dua kata \\\"kutip\\\"\\n\" n=42 ratio=0.50", &lines);
+    long sampled_lines = 0;
+    int sampled = count_lines(path, "cat=irc.rx ", &sampled_lines);
+    int report = count_lines(path, "event=suppressed category=irc.rx count=990", &sampled_lines);
+    int ok = quoted == 1 && sampled == 10 && report == 1 && lines == 12;
+    printf("output   : %ld baris, quoting %s, sampling %d/1000 + laporan %s -> %s\n", lines,
+           quoted == 1 ? "OK" : "GAGAL", sampled, report == 1 ? "OK" : "GAGAL", ok ? "OK" : "GAGAL");
+    if (!ok)
+        failed = 1;
+    unlink(path);
+
+    WINEB2B_log_shutdown();
+    fclose(devnull);
+    return failed;
+}
@@ -0,0 +1,414 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <time.h>
+#include <json-c/json.h>
+#include "matrix_driver.h"
+#include "mock_homeserver.h"
+
+/* Benchmark driver Matrix terhadap homeserver pengganti lokal
+   (test/mock_homeserver.c).
+
+   - operasi: login, join, send, pin (state) dan redact lewat API
+     WINEMATRIX_*; latensi p50/p99, operasi/s dan alokasi per operasi
+     (semua malloc/calloc/realloc di proses klien, termasuk libcurl).
+   - sync: initial sync memutar ulang test/data/sync_recorded.json yang
+     diperbesar ke beberapa ukuran; MB/s untuk WINEMATRIX_sync (transfer +
+     salin) dan untuk json_tokener_parse atas body yang sama.
+   - gangguan: latensi, 429 dan 500 tersuntik; dibandingkan jumlah kirim
+     yang dilaporkan berhasil dengan event yang benar-benar tersimpan. */
+
+#define LOGINS       200
+#define JOINS        200
+#define SENDS        2000
+#define PINS         500
+#define REDACTS      500
+#define FAULT_SENDS  300
+#define SYNC_BYTES   (64L << 20)    /* Total byte sync per ukuran payload */
+#define ROOM         "!bench:localhost"
+#define REPLAY_FILE  "test/data/sync_recorded.json"
+
+/* --- Penghitung alokasi --- */
+
+#ifndef __SANITIZE_ADDRESS__
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t nmemb, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+
+static unsigned long allocations;
+
+void *malloc(size_t size) {
+    __atomic_add_fetch(&allocations, 1, __ATOMIC_RELAXED);
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t nmemb, size_t size) {
+    __atomic_add_fetch(&allocations, 1, __ATOMIC_RELAXED);
+    return __libc_calloc(nmemb, size);
+}
+
+void *realloc(void *ptr, size_t size) {
+    __atomic_add_fetch(&allocations, 1, __ATOMIC_RELAXED);
+    return __libc_realloc(ptr, size);
+}
+
+static unsigned long alloc_count(void) {
+    return __atomic_load_n(&allocations, __ATOMIC_RELAXED);
+}
+#else
+/* ASan memasang malloc sendiri; jumlah alokasi tidak diukur */
+static unsigned long alloc_count(void) {
+    return 0;
+}
+#endif
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int cmp_double(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return x < y ? -1 : x > y;
+}
+
+static double percentile(const double* sorted, long n, double p) {
+    if (n <= 0)
+        return 0;
+    long i = (long)(p * (n - 1) + 0.5);
+    return sorted[i];
+}
+
+/* Driver mencetak setiap respons ke stdout; dibuang selama pengukuran */
+static int saved_stdout = -1;
+
+static void quiet_begin(void) {
+    fflush(stdout);
+    saved_stdout = dup(STDOUT_FILENO);
+    int null = open("/dev/null", O_WRONLY);
+    if (null >= 0) {
+        dup2(null, STDOUT_FILENO);
+        close(null);
+    }
+}
+
+static void quiet_end(void) {
+    fflush(stdout);
+    if (saved_stdout >= 0) {
+        dup2(saved_stdout, STDOUT_FILENO);
+        close(saved_stdout);
+        saved_stdout = -1;
+    }
+}
+
+/* --- Operasi --- */
+
+typedef struct {
+    const char *name;
+    double *latency;
+    long count;
+    long failed;
+    double wall;
+    unsigned long allocs;
+} OpStats;
+
+typedef struct {
+    WINEMATRIX_handle *handle;
+    const char *homeserver;
+    char **event_ids;
+    long nevent_ids;
+} Ctx;
+
+static int op_login(Ctx* ctx, long i) {
+    (void)i;
+    WINEMATRIX_handle *h = WINEMATRIX_create(ctx->homeserver, "bench", "rahasia");
+    if (!h)
+        return -1;
+    WINEMATRIX_free(h);
+    return 0;
+}
+
+static int op_join(Ctx* ctx, long i) {
+    (void)i;
+    return WINEMATRIX_join_room(ctx->handle, ROOM);
+}
+
+static int op_send(Ctx* ctx, long i) {
+    char text[64];
+    snprintf(text, sizeof(text), "pesan benchmark %ld", i);
+    return WINEMATRIX_send_message(ctx->handle, ROOM, text);
+}
+
+static int op_pin(Ctx* ctx, long i) {
+    return WINEMATRIX_pin_message(ctx->handle, ROOM, ctx->event_ids[i % ctx->nevent_ids]);
+}
+
+static int op_redact(Ctx* ctx, long i) {
+    return WINEMATRIX_redact_message(ctx->handle, ROOM, ctx->event_ids[i % ctx->nevent_ids], "benchmark");
+}
+
+static int run_op(Ctx* ctx, OpStats* st, long n, int (*op)(Ctx*, long)) {
+    st->latency = malloc((size_t)n * sizeof(double));
+    if (!st->latency)
+        return -1;
+    quiet_begin();
+    unsigned long allocs = alloc_count();
+    double start = now_sec();
+    for (long i = 0; i < n; i++) {
+        double t = now_sec();
+        if (op(ctx, i) != 0)
+            st->failed++;
+        st->latency[st->count++] = now_sec() - t;
+    }
+    st->wall = now_sec() - start;
+    st->allocs = alloc_count() - allocs;
+    quiet_end();
+    return 0;
+}
+
+static void print_op(OpStats* st) {
+    qsort(st->latency, (size_t)st->count, sizeof(double), cmp_double);
+    printf("%-10s %8ld %8ld %10.0f %10.3f %10.3f %12.1f\n", st->name, st->count, st->failed,
+           st->count / st->wall, percentile(st->latency, st->count, 0.50) * 1000,
+           percentile(st->latency, st->count, 0.99) * 1000, (double)st->allocs / st->count);
+    fflush(stdout);
+    free(st->latency);
+    st->latency = NULL;
+}
+
+/* Mengumpulkan event m.room.message dari room pada respons sync. Mengembalikan jumlahnya */
+static long collect_messages(const char* response, const char* room_id, const char* sender, char*** ids) {
+    json_object *root = json_tokener_parse(response), *rooms, *join, *room, *timeline, *events;
+    long count = 0;
+    if (!root || !json_object_object_get_ex(root, "rooms", &rooms) ||
+        !json_object_object_get_ex(rooms, "join", &join) ||
+        !json_object_object_get_ex(join, room_id, &room) ||
+        !json_object_object_get_ex(room, "timeline", &timeline) ||
+        !json_object_object_get_ex(timeline, "events", &events)) {
+        json_object_put(root);
+        return 0;
+    }
+    size_t n = json_object_array_length(events);
+    if (ids)
+        *ids = calloc(n, sizeof(char*));
+    for (size_t i = 0; i < n; i++) {
+        json_object *ev = json_object_array_get_idx(events, i), *type, *from, *id;
+        if (!json_object_object_get_ex(ev, "type", &type) ||
+            strcmp(json_object_get_string(type), "m.room.message") != 0 ||
+            !json_object_object_get_ex(ev, "sender", &from) ||
+            strcmp(json_object_get_string(from), sender) != 0)
+            continue;
+        if (ids && *ids && json_object_object_get_ex(ev, "event_id", &id))
+            (*ids)[count] = strdup(json_object_get_string(id));
+        count++;
+    }
+    json_object_put(root);
+    return count;
+}
+
+/* Pesan milik sender yang tersimpan server sejak awal (sync dari "s0") */
+static long stored_messages(WINEMATRIX_handle* handle, const char* sender, char*** ids) {
+    char *response = NULL;
+    if (WINEMATRIX_sync(handle, "s0", 0, &response, NULL) != 0)
+        return -1;
+    long count = collect_messages(response, ROOM, sender, ids);
+    free(response);
+    return count;
+}
+
+static int run_ops(void) {
+    mock_homeserver_options opt = { .sync_replay_file = REPLAY_FILE, .verbose = 1 };
+    pid_t pid;
+    int port = mock_homeserver_start(&opt, &pid);
+    if (port < 0)
+        return -1;
+    char homeserver[64];
+    snprintf(homeserver, sizeof(homeserver), "http://127.0.0.1:%d", port);
+    Ctx ctx = { .homeserver = homeserver };
+
+    printf("%-10s %8s %8s %10s %10s %10s %12s\n", "operasi", "jumlah", "gagal", "op/s", "p50 ms",
+           "p99 ms", "alokasi/op");
+    OpStats login = { .name = "login" };
+    if (run_op(&ctx, &login, LOGINS, op_login) != 0)
+        return -1;
+    print_op(&login);
+
+    ctx.handle = WINEMATRIX_create(homeserver, "bench", "rahasia");
+    if (!ctx.handle)
+        return -1;
+    OpStats join = { .name = "join" };
+    OpStats send = { .name = "send" };
+    if (run_op(&ctx, &join, JOINS, op_join) != 0 || run_op(&ctx, &send, SENDS, op_send) != 0)
+        return -1;
+    print_op(&join);
+    print_op(&send);
+
+    /* Setiap kirim harus menjadi satu event (txnId unik) */
+    long stored = stored_messages(ctx.handle, "@bench:localhost", &ctx.event_ids);
+    ctx.nevent_ids = stored;
+    if (stored != SENDS) {
+        fprintf(stderr, "Tersimpan %ld dari %d pesan terkirim\n", stored, SENDS);
+        return -1;
+    }
+
+    OpStats pin = { .name = "pin" };
+    OpStats redact = { .name = "redact" };
+    if (run_op(&ctx, &pin, PINS, op_pin) != 0 || run_op(&ctx, &redact, REDACTS, op_redact) != 0)
+        return -1;
+    print_op(&pin);
+    print_op(&redact);
+
+    int failed = login.failed || join.failed || send.failed || pin.failed || redact.failed;
+    for (long i = 0; i < ctx.nevent_ids; i++)
+        free(ctx.event_ids[i]);
+    free(ctx.event_ids);
+    WINEMATRIX_free(ctx.handle);
+    if (mock_homeserver_stop(pid) != 0 || failed)
+        return -1;
+    return 0;
+}
+
+/* --- Sync --- */
+
+static int run_sync(size_t target) {
+    mock_homeserver_options opt = { .sync_replay_file = REPLAY_FILE, .sync_replay_bytes = target };
+    pid_t pid;
+    int port = mock_homeserver_start(&opt, &pid);
+    if (port < 0)
+        return -1;
+    char homeserver[64];
+    snprintf(homeserver, sizeof(homeserver), "http://127.0.0.1:%d", port);
+    WINEMATRIX_handle *handle = WINEMATRIX_create(homeserver, "bench", "rahasia");
+    if (!handle)
+        return -1;
+
+    long rounds = SYNC_BYTES / (long)target;
+    if (rounds < 8)
+        rounds = 8;
+    double *latency = malloc((size_t)rounds * sizeof(double));
+    double sync_time = 0, parse_time = 0;
+    unsigned long sync_allocs = 0, parse_allocs = 0;
+    size_t bytes = 0;
+    int ok = latency != NULL;
+    for (long i = 0; ok && i < rounds; i++) {
+        char *response = NULL, *next_batch = NULL;
+        unsigned long a = alloc_count();
+        double t = now_sec();
+        if (WINEMATRIX_sync(handle, NULL, 0, &response, &next_batch) != 0 ||
+            !next_batch || strcmp(next_batch, "s0") != 0) {
+            ok = 0;
+        } else {
+            latency[i] = now_sec() - t;
+            sync_time += latency[i];
+            sync_allocs += alloc_count() - a;
+            size_t len = strlen(response);
+            bytes += len;
+
+            a = alloc_count();
+            t = now_sec();
+            json_object *root = json_tokener_parse(response);
+            parse_time += now_sec() - t;
+            parse_allocs += alloc_count() - a;
+            ok = root != NULL;
+            json_object_put(root);
+        }
+        free(response);
+        free(next_batch);
+    }
+    if (ok) {
+        qsort(latency, (size_t)rounds, sizeof(double), cmp_double);
+        double mb = bytes / 1048576.0;
+        printf("%8.0f KB %6ld %10.3f %10.3f %10.1f %10.0f %10.1f %10.0f\n", bytes / 1024.0 / rounds, rounds,
+               percentile(latency, rounds, 0.50) * 1000, percentile(latency, rounds, 0.99) * 1000,
+               mb / sync_time, (double)sync_allocs / rounds, mb / parse_time, (double)parse_allocs / rounds);
+    }
+    free(latency);
+    WINEMATRIX_free(handle);
+    if (mock_homeserver_stop(pid) != 0 || !ok)
+        return -1;
+    return 0;
+}
+
+/* --- Gangguan --- */
+
+static int run_faults(void) {
+    mock_homeserver_options opt = { .latency_ms = 5, .jitter_ms = 2, .rate_limit_permille = 100,
+                                    .error_permille = 50, .retry_after_ms = 50, .seed = 42, .verbose = 1 };
+    pid_t pid;
+    int port = mock_homeserver_start(&opt, &pid);
+    if (port < 0)
+        return -1;
+    char homeserver[64];
+    snprintf(homeserver, sizeof(homeserver), "http://127.0.0.1:%d", port);
+    Ctx ctx = { .homeserver = homeserver };
+    ctx.handle = WINEMATRIX_create(homeserver, "bench", "rahasia");
+    if (!ctx.handle)
+        return -1;
+
+    /* Join diulang sampai lolos gangguan; driver melaporkan 429/500 sebagai errcode */
+    quiet_begin();
+    int joined = 0;
+    for (int i = 0; i < 20 && !joined; i++)
+        joined = WINEMATRIX_join_room(ctx.handle, ROOM) == 0;
+    quiet_end();
+    if (!joined)
+        return -1;
+
+    OpStats send = { .name = "send" };
+    if (run_op(&ctx, &send, FAULT_SENDS, op_send) != 0)
+        return -1;
+    long reported = send.count - send.failed;
+    print_op(&send);
+
+    long stored = -1;
+    quiet_begin();
+    for (int i = 0; i < 20 && stored < 0; i++)
+        stored = stored_messages(ctx.handle, "@bench:localhost", NULL);
+    quiet_end();
+    printf("           dilaporkan berhasil %ld, tersimpan %ld, hilang tanpa error %ld\n",
+           reported, stored, reported - stored);
+    /* Metrik handle menghitung status HTTP, jadi 429/500 terlihat di sana */
+    WINEB2B_metrics_values metrics;
+    WINEB2B_metrics_snapshot(ctx.handle->metrics, &metrics);
+    printf("           metrik: sends done %llu failed %llu, http error %llu/%llu, total p50 %.3f ms p99 %.3f ms\n",
+           (unsigned long long)metrics.counters[WINEB2B_METRIC_SENDS_DONE],
+           (unsigned long long)metrics.counters[WINEB2B_METRIC_SENDS_FAILED],
+           (unsigned long long)metrics.counters[WINEB2B_METRIC_HTTP_ERRORS],
+           (unsigned long long)metrics.counters[WINEB2B_METRIC_HTTP_REQUESTS],
+           WINEB2B_metrics_percentile(&metrics, WINEB2B_METRIC_HTTP_TOTAL, 0.5) / 1e3,
+           WINEB2B_metrics_percentile(&metrics, WINEB2B_METRIC_HTTP_TOTAL, 0.99) / 1e3);
+    WINEMATRIX_free(ctx.handle);
+    if (mock_homeserver_stop(pid) != 0 || stored < 0)
+        return -1;
+    return 0;
+}
+
+int main(void) {
+    signal(SIGPIPE, SIG_IGN);
+    if (WINEMATRIX_global_init() != 0)
+        return 1;
+    int rc = 1;
+    if (run_ops() != 0)
+        goto out;
+
+    printf("\n%11s %6s %10s %10s %10s %10s %10s %10s\n", "payload", "kali", "p50 ms", "p99 ms",
+           "sync MB/s", "alok/sync", "parse MB/s", "alok/parse");
+    size_t sizes[] = { 64 << 10, 1 << 20, 8 << 20 };
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+        if (run_sync(sizes[i]) != 0)
+            goto out;
+
+    printf("\ngangguan: latensi 5+-2 ms, 429 10%%, 500 5%%\n");
+    printf("%-10s %8s %8s %10s %10s %10s %12s\n", "operasi", "jumlah", "gagal", "op/s", "p50 ms",
+           "p99 ms", "alokasi/op");
+    if (run_faults() != 0)
+        goto out;
+    rc = 0;
+out:
+    WINEMATRIX_global_cleanup();
+    return rc;
+}
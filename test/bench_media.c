@@ -0,0 +1,543 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <curl/curl.h>
+#include "matrix_driver.h"
+#include "matrix_media.h"
+#include "mock_homeserver.h"
+
+/* Benchmark media streaming Matrix (source/berry/matrix/matrix_media.c).
+
+   Homeserver pengganti menyimpan media di direktori sementara, lalu:
+   - streaming: file acak 1 MB, 16 MB, 128 MB dan 512 MB (argumen pertama
+     mengganti ukuran terbesar dalam MB, minimal 256) di-upload dari fd dan di-download
+     ke cache. Kenaikan RSS puncak tiap operasi (disampel thread terpisah)
+     dibandingkan dengan cara lama: file dibaca utuh ke memori untuk
+     POSTFIELDS, download ditampung dengan realloc seperti
+     WriteMemoryCallback. Isi hasil download harus sama dengan file asal.
+   - dedup: upload ulang file yang sama, isi yang sama dari pipe dan
+     download URI yang diupload sendiri tidak membuat request HTTP; 4 thread
+     yang men-download URI baru bersamaan hanya membuat 1 request.
+   - LRU: cache 32 MB diisi objek 4 MB; total tidak pernah melewati batas
+     dan objek yang baru dipakai bertahan.
+   - restart: cache dibuka ulang dengan pemetaan dan urutan LRU yang sama;
+     baris pemetaan yang terpotong (crash) dibuang. */
+
+#define MB             (1024 * 1024)
+#define SIZES          4
+#define LRU_LIMIT      (32 * MB)
+#define LRU_OBJECT     (4 * MB)
+#define LRU_FILES      16
+#define FLAT_RSS_MB    8.0      /* Batas kenaikan RSS puncak upload/download streaming */
+#define THREADS        4
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* --- RSS puncak --- */
+
+static volatile long rss_peak;
+static volatile int sampling = 1;
+static long page_kb;
+
+static long rss_kb(void) {
+    FILE *fp = fopen("/proc/self/statm", "r");
+    long size = 0, resident = 0;
+    if (fp) {
+        if (fscanf(fp, "%ld %ld", &size, &resident) != 2)
+            resident = 0;
+        fclose(fp);
+    }
+    return resident * page_kb;
+}
+
+static void* rss_sampler(void* arg) {
+    (void)arg;
+    while (sampling) {
+        long rss = rss_kb();
+        if (rss > rss_peak)
+            rss_peak = rss;
+        usleep(500);
+    }
+    return NULL;
+}
+
+/* Memulai pengukuran; mengembalikan RSS awal */
+static long rss_begin(void) {
+    long rss = rss_kb();
+    rss_peak = rss;
+    return rss;
+}
+
+static double rss_delta_mb(long start) {
+    long rss = rss_kb();
+    long peak = rss_peak > rss ? rss_peak : rss;
+    return (peak - start) / 1024.0;
+}
+
+/* --- File uji --- */
+
+static char work_dir[] = "/tmp/bench_media_XXXXXX";
+
+/* Isi acak deterministik dari seed */
+static int make_file(const char* path, size_t size, uint64_t seed) {
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0600);
+    char *buf = malloc(MB);
+    if (fd < 0 || !buf) {
+        if (fd >= 0)
+            close(fd);
+        free(buf);
+        return -1;
+    }
+    uint64_t x = seed * 0x9e3779b97f4a7c15ULL + 1;
+    int ret = 0;
+    for (size_t done = 0; done < size && ret == 0;) {
+        size_t n = size - done < MB ? size - done : MB;
+        for (size_t i = 0; i + 8 <= MB; i += 8) {
+            x ^= x << 13;
+            x ^= x >> 7;
+            x ^= x << 17;
+            memcpy(buf + i, &x, 8);
+        }
+        ret = write(fd, buf, n) == (ssize_t)n ? 0 : -1;
+        done += n;
+    }
+    free(buf);
+    return ret == 0 ? fd : (close(fd), -1);
+}
+
+/* 1 jika isi kedua fd (dari offset 0) sama */
+static int same_content(int a, int b) {
+    char *x = malloc(MB), *y = malloc(MB);
+    int same = x && y;
+    for (off_t off = 0; same;) {
+        ssize_t n = pread(a, x, MB, off), m = pread(b, y, MB, off);
+        if (n != m || n < 0 || memcmp(x, y, (size_t)n) != 0)
+            same = 0;
+        if (n <= 0)
+            break;
+        off += n;
+    }
+    free(x);
+    free(y);
+    return same;
+}
+
+static uint64_t requests(WINEMATRIX_handle* h) {
+    WINEB2B_metrics_values v;
+    WINEB2B_metrics_snapshot(h->metrics, &v);
+    return v.counters[WINEB2B_METRIC_HTTP_REQUESTS];
+}
+
+/* --- Cara lama: seluruh isi di memori --- */
+
+struct buffer {
+    char *data;
+    size_t len;
+};
+
+static size_t collect(void* ptr, size_t size, size_t nmemb, void* user) {
+    struct buffer *b = user;
+    size_t n = size * nmemb;
+    char *p = realloc(b->data, b->len + n + 1);
+    if (!p)
+        return 0;
+    memcpy(p + b->len, ptr, n);
+    b->data = p;
+    b->len += n;
+    b->data[b->len] = '\0';
+    return n;
+}
+
+static char* memory_upload(WINEMATRIX_handle* h, int fd, size_t size) {
+    char *data = malloc(size ? size : 1);
+    size_t got = 0;
+    while (data && got < size) {
+        ssize_t n = pread(fd, data + got, size - got, (off_t)got);
+        if (n <= 0)
+            break;
+        got += (size_t)n;
+    }
+    char url[512];
+    snprintf(url, sizeof(url), "%s/_matrix/media/v3/upload?access_token=%s", h->homeserver, h->access_token);
+    CURL *curl = curl_easy_init();
+    struct curl_slist *headers = curl_slist_append(NULL, "Content-Type: application/octet-stream");
+    struct buffer resp = { NULL, 0 };
+    char *uri = NULL;
+    if (data && got == size && curl) {
+        curl_easy_setopt(curl, CURLOPT_URL, url);
+        curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+        curl_easy_setopt(curl, CURLOPT_POSTFIELDS, data);
+        curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE_LARGE, (curl_off_t)size);
+        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, collect);
+        curl_easy_setopt(curl, CURLOPT_WRITEDATA, &resp);
+        if (curl_easy_perform(curl) == CURLE_OK && resp.data) {
+            char *start = strstr(resp.data, "mxc://"), *end = start ? strchr(start, '"') : NULL;
+            if (end)
+                uri = strndup(start, (size_t)(end - start));
+        }
+    }
+    free(resp.data);
+    free(data);
+    curl_slist_free_all(headers);
+    if (curl)
+        curl_easy_cleanup(curl);
+    return uri;
+}
+
+static size_t memory_download(WINEMATRIX_handle* h, const char* uri) {
+    char url[512];
+    snprintf(url, sizeof(url), "%s/_matrix/media/v3/download/%s?access_token=%s", h->homeserver, uri + 6,
+             h->access_token);
+    CURL *curl = curl_easy_init();
+    struct buffer b = { NULL, 0 };
+    if (curl) {
+        curl_easy_setopt(curl, CURLOPT_URL, url);
+        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, collect);
+        curl_easy_setopt(curl, CURLOPT_WRITEDATA, &b);
+        if (curl_easy_perform(curl) != CURLE_OK)
+            b.len = 0;
+        curl_easy_cleanup(curl);
+    }
+    free(b.data);
+    return b.len;
+}
+
+/* --- Streaming vs memori --- */
+
+static int run_streaming(WINEMATRIX_handle* h, size_t largest) {
+    size_t sizes[SIZES] = { 1 * (size_t)MB, 16 * (size_t)MB, 128 * (size_t)MB, largest };
+    int ok = 1;
+    double worst_stream = 0;
+    for (int i = 0; i < SIZES && ok; i++) {
+        size_t size = sizes[i];
+        char path[256];
+        snprintf(path, sizeof(path), "%s/stream%d", work_dir, i);
+        int fd = make_file(path, size, (uint64_t)i + 1);
+        if (fd < 0)
+            return 1;
+
+        char *uri = NULL;
+        long start = rss_begin();
+        double t0 = now_sec();
+        int ret = WINEMATRIX_upload_media(h, fd, "application/octet-stream", "stream.bin", &uri);
+        double up_sec = now_sec() - t0, up_rss = rss_delta_mb(start);
+
+        start = rss_begin();
+        char *old_uri = memory_upload(h, fd, size);
+        double old_up_rss = rss_delta_mb(start);
+
+        /* URI dari upload lama belum dikenal cache: download benar-benar lewat HTTP */
+        int dl = -1;
+        uint64_t before = requests(h);
+        start = rss_begin();
+        t0 = now_sec();
+        int dret = old_uri ? WINEMATRIX_download_media(h, old_uri, &dl) : -1;
+        double down_sec = now_sec() - t0, down_rss = rss_delta_mb(start);
+        int fetched = requests(h) - before == 1;
+
+        start = rss_begin();
+        size_t old_len = old_uri ? memory_download(h, old_uri) : 0;
+        double old_down_rss = rss_delta_mb(start);
+
+        /* URI dari upload streaming dilayani dari disk */
+        int own = -1;
+        before = requests(h);
+        int hit = uri && WINEMATRIX_download_media(h, uri, &own) == 0 && requests(h) == before;
+
+        int same = dret == 0 && same_content(fd, dl) && hit && same_content(fd, own);
+        int flat = up_rss < FLAT_RSS_MB && down_rss < FLAT_RSS_MB;
+        ok = ret == 0 && fetched && same && old_len == size && flat;
+        worst_stream = up_rss > worst_stream ? up_rss : worst_stream;
+        worst_stream = down_rss > worst_stream ? down_rss : worst_stream;
+        printf("%4zu MB       : upload %6.0f MB/s RSS +%.1f MB (di memori +%.1f MB), "
+               "download %6.0f MB/s RSS +%.1f MB (di memori +%.1f MB), isi %s -> %s\n",
+               size / MB, size / (double)MB / up_sec, up_rss, old_up_rss, size / (double)MB / down_sec, down_rss,
+               old_down_rss, same ? "sama" : "BEDA", ok ? "OK" : "GAGAL");
+        if (dl >= 0)
+            close(dl);
+        if (own >= 0)
+            close(own);
+        free(uri);
+        free(old_uri);
+        close(fd);
+        unlink(path);
+    }
+    printf("RSS flat     : kenaikan puncak streaming terbesar %.1f MB (batas %.0f MB) -> %s\n", worst_stream,
+           FLAT_RSS_MB, ok ? "OK" : "GAGAL");
+    return !ok;
+}
+
+/* --- Deduplikasi --- */
+
+struct pipe_writer {
+    int src, out;
+};
+
+static void* feed_pipe(void* arg) {
+    struct pipe_writer *w = arg;
+    char buf[65536];
+    ssize_t n;
+    off_t off = 0;
+    while ((n = pread(w->src, buf, sizeof(buf), off)) > 0) {
+        if (write(w->out, buf, (size_t)n) != n)
+            break;
+        off += n;
+    }
+    close(w->out);
+    return NULL;
+}
+
+/* Upload dari pipe yang diisi isi file src */
+static int upload_pipe(WINEMATRIX_handle* h, int src, char** uri) {
+    int p[2];
+    if (pipe(p) != 0)
+        return -1;
+    struct pipe_writer w = { src, p[1] };
+    pthread_t t;
+    pthread_create(&t, NULL, feed_pipe, &w);
+    int ret = WINEMATRIX_upload_media(h, p[0], "image/png", NULL, uri);
+    pthread_join(t, NULL);
+    close(p[0]);
+    return ret;
+}
+
+struct racer {
+    WINEMATRIX_handle *h;
+    const char *uri;
+    pthread_barrier_t *barrier;
+    int fd;
+};
+
+static void* race_download(void* arg) {
+    struct racer *r = arg;
+    pthread_barrier_wait(r->barrier);
+    if (WINEMATRIX_download_media(r->h, r->uri, &r->fd) != 0)
+        r->fd = -1;
+    return NULL;
+}
+
+static int run_dedup(WINEMATRIX_handle* h) {
+    char path[256], other[256];
+    snprintf(path, sizeof(path), "%s/dedup", work_dir);
+    snprintf(other, sizeof(other), "%s/dedup2", work_dir);
+    int fd = make_file(path, 16 * MB, 100), fd2 = make_file(other, 3 * MB + 17, 101);
+    if (fd < 0 || fd2 < 0)
+        return 1;
+    char *first = NULL, *again = NULL, *piped = NULL, *fresh = NULL;
+    uint64_t before = requests(h);
+    int ok = WINEMATRIX_upload_media(h, fd, NULL, "a.bin", &first) == 0 && requests(h) == before + 1;
+    before = requests(h);
+    ok = ok && WINEMATRIX_upload_media(h, fd, NULL, "b.bin", &again) == 0 && strcmp(first, again) == 0;
+    ok = ok && upload_pipe(h, fd, &piped) == 0 && strcmp(first, piped) == 0 && requests(h) == before;
+    int reuse_ok = ok;
+
+    /* Isi baru dari pipe: disalin ke cache, lalu download-nya dari disk */
+    before = requests(h);
+    int dl = -1;
+    ok = ok && upload_pipe(h, fd2, &fresh) == 0 && requests(h) == before + 1 &&
+         WINEMATRIX_download_media(h, fresh, &dl) == 0 && requests(h) == before + 1 && same_content(fd2, dl);
+    if (dl >= 0)
+        close(dl);
+    printf("dedup        : upload ulang %s, isi sama dari pipe %s, upload pipe baru lalu download %s -> %s\n",
+           reuse_ok ? "tanpa request" : "GAGAL", reuse_ok ? "tanpa request" : "GAGAL",
+           ok ? "1 request" : "GAGAL", ok ? "OK" : "GAGAL");
+
+    /* Beberapa thread meminta URI yang sama: satu request, sisanya menunggu */
+    char *uri = memory_upload(h, fd2, 3 * MB + 17);
+    pthread_barrier_t barrier;
+    pthread_barrier_init(&barrier, NULL, THREADS);
+    struct racer racers[THREADS];
+    pthread_t threads[THREADS];
+    before = requests(h);
+    for (int i = 0; i < THREADS; i++) {
+        racers[i] = (struct racer){ h, uri, &barrier, -1 };
+        pthread_create(&threads[i], NULL, race_download, &racers[i]);
+    }
+    int same = uri != NULL;
+    for (int i = 0; i < THREADS; i++) {
+        pthread_join(threads[i], NULL);
+        same = same && racers[i].fd >= 0 && same_content(fd2, racers[i].fd);
+        if (racers[i].fd >= 0)
+            close(racers[i].fd);
+    }
+    pthread_barrier_destroy(&barrier);
+    uint64_t made = requests(h) - before;
+    int race_ok = same && made == 1;
+    printf("bersamaan    : %d thread download URI baru -> %llu request, isi %s -> %s\n", THREADS,
+           (unsigned long long)made, same ? "sama" : "BEDA", race_ok ? "OK" : "GAGAL");
+
+    free(uri);
+    free(first);
+    free(again);
+    free(piped);
+    free(fresh);
+    close(fd);
+    close(fd2);
+    unlink(path);
+    unlink(other);
+    return !(ok && race_ok);
+}
+
+/* --- LRU dan restart --- */
+
+static int lru_fds[LRU_FILES];
+static char *lru_uris[LRU_FILES];
+
+/* 1 jika download URI dilayani dari cache (tanpa request) */
+static int cached(WINEMATRIX_handle* h, int i) {
+    uint64_t before = requests(h);
+    int fd = -1;
+    int ok = WINEMATRIX_download_media(h, lru_uris[i], &fd) == 0 && same_content(lru_fds[i], fd);
+    if (fd >= 0)
+        close(fd);
+    return ok && requests(h) == before;
+}
+
+static int upload_lru(WINEMATRIX_handle* h, int i, uint64_t* max_seen) {
+    int ok = WINEMATRIX_upload_media(h, lru_fds[i], NULL, NULL, &lru_uris[i]) == 0;
+    WINEMATRIX_media_stats st;
+    WINEMATRIX_media_get_stats(h->media, &st);
+    if (st.bytes > *max_seen)
+        *max_seen = st.bytes;
+    return ok;
+}
+
+static int run_lru(WINEMATRIX_handle* h, const char* dir) {
+    WINEMATRIX_media_close(h->media);
+    h->media = NULL;
+    if (WINEMATRIX_open_media_cache(h, dir, LRU_LIMIT) != 0)
+        return 1;
+    int ok = 1;
+    for (int i = 0; i < LRU_FILES && ok; i++) {
+        char path[256];
+        snprintf(path, sizeof(path), "%s/lru%d", work_dir, i);
+        lru_fds[i] = make_file(path, LRU_OBJECT, 200 + (uint64_t)i);
+        ok = lru_fds[i] >= 0;
+        unlink(path);
+    }
+    uint64_t max_seen = 0;
+    for (int i = 0; i < 8 && ok; i++)
+        ok = upload_lru(h, i, &max_seen);
+    /* Objek 0 dipakai lagi, lalu 4 objek baru membuang 1..4 */
+    ok = ok && cached(h, 0);
+    for (int i = 8; i < 12 && ok; i++)
+        ok = upload_lru(h, i, &max_seen);
+    WINEMATRIX_media_stats st;
+    WINEMATRIX_media_get_stats(h->media, &st);
+    int kept = ok && cached(h, 0) && cached(h, 5) && !cached(h, 1);
+    ok = ok && kept && max_seen <= LRU_LIMIT && st.evictions == 4;
+    printf("LRU          : batas %d MB, terbesar %.1f MB, %llu dibuang, objek yang baru dipakai bertahan -> %s\n",
+           LRU_LIMIT / MB, max_seen / (double)MB, (unsigned long long)st.evictions, ok ? "OK" : "GAGAL");
+    if (!ok)
+        return 1;
+
+    /* Restart: objek 7 dipakai terakhir, pemetaan terakhir terpotong */
+    ok = cached(h, 7);
+    WINEMATRIX_media_get_stats(h->media, &st);
+    WINEMATRIX_media_close(h->media);
+    h->media = NULL;
+    char uris[512];
+    snprintf(uris, sizeof(uris), "%s/uris", dir);
+    int ufd = open(uris, O_WRONLY | O_APPEND);
+    ok = ok && ufd >= 0 && write(ufd, "0123abcd mxc://local", 20) == 20;
+    if (ufd >= 0)
+        close(ufd);
+    WINEMATRIX_media_stats re;
+    ok = ok && WINEMATRIX_open_media_cache(h, dir, LRU_LIMIT) == 0;
+    if (ok)
+        WINEMATRIX_media_get_stats(h->media, &re);
+    ok = ok && re.uris == st.uris && re.objects == st.objects && re.bytes == st.bytes;
+
+    /* Upload ulang isi lama tanpa request walaupun objeknya sudah dibuang */
+    uint64_t before = requests(h);
+    char *uri = NULL;
+    int reuse = ok && WINEMATRIX_upload_media(h, lru_fds[2], NULL, NULL, &uri) == 0 &&
+                strcmp(uri, lru_uris[2]) == 0 && requests(h) == before;
+    free(uri);
+    /* 4 objek baru membuang 8..11 (paling lama dipakai menurut mtime), bukan 7 dan 0 */
+    for (int i = 12; i < LRU_FILES && ok; i++)
+        ok = upload_lru(h, i, &max_seen);
+    int order = ok && cached(h, 7) && cached(h, 0) && !cached(h, 11);
+    ok = ok && reuse && order && max_seen <= LRU_LIMIT;
+    printf("restart      : %zu pemetaan dan %zu objek dimuat ulang, baris terpotong dibuang, upload ulang %s, "
+           "urutan LRU %s -> %s\n",
+           re.uris, re.objects, reuse ? "tanpa request" : "GAGAL", order ? "tetap" : "GAGAL", ok ? "OK" : "GAGAL");
+    for (int i = 0; i < LRU_FILES; i++) {
+        if (lru_fds[i] >= 0)
+            close(lru_fds[i]);
+        free(lru_uris[i]);
+    }
+    return !ok;
+}
+
+static void remove_tree(const char* dir) {
+    DIR *d = opendir(dir);
+    struct dirent *e;
+    char path[512];
+    while (d && (e = readdir(d)) != NULL) {
+        if (e->d_name[0] == '.')
+            continue;
+        snprintf(path, sizeof(path), "%s/%s", dir, e->d_name);
+        struct stat st;
+        if (lstat(path, &st) == 0 && S_ISDIR(st.st_mode))
+            remove_tree(path);
+        else
+            unlink(path);
+    }
+    if (d)
+        closedir(d);
+    rmdir(dir);
+}
+
+int main(int argc, char** argv) {
+    size_t largest = (argc > 1 ? (size_t)atol(argv[1]) : 512) * MB;
+    if (largest < 256 * (size_t)MB)
+        largest = 256 * (size_t)MB;
+    page_kb = sysconf(_SC_PAGESIZE) / 1024;
+    if (WINEMATRIX_global_init() != 0 || !mkdtemp(work_dir))
+        return 1;
+    char media_dir[300], cache_dir[300], lru_dir[300];
+    snprintf(media_dir, sizeof(media_dir), "%s/server", work_dir);
+    snprintf(cache_dir, sizeof(cache_dir), "%s/cache", work_dir);
+    snprintf(lru_dir, sizeof(lru_dir), "%s/lru", work_dir);
+    mkdir(media_dir, 0700);
+
+    mock_homeserver_options opt = { .media_dir = media_dir };
+    pid_t pid;
+    int port = mock_homeserver_start(&opt, &pid);
+    if (port < 0)
+        return 1;
+    char homeserver[64];
+    snprintf(homeserver, sizeof(homeserver), "http://127.0.0.1:%d", port);
+    WINEMATRIX_handle *h = WINEMATRIX_create(homeserver, "bench", "rahasia");
+    pthread_t sampler;
+    pthread_create(&sampler, NULL, rss_sampler, NULL);
+
+    int failed = !h || WINEMATRIX_open_media_cache(h, cache_dir, 4 * largest) != 0;
+    if (!failed)
+        failed |= run_streaming(h, largest);
+    if (!failed)
+        failed |= run_dedup(h);
+    if (!failed)
+        failed |= run_lru(h, lru_dir);
+
+    sampling = 0;
+    pthread_join(sampler, NULL);
+    WINEMATRIX_free(h);
+    if (mock_homeserver_stop(pid) != 0)
+        failed = 1;
+    remove_tree(work_dir);
+    WINEMATRIX_global_cleanup();
+    return failed;
+}
@@ -0,0 +1,326 @@
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "irc_members.h"
+
+/* Benchmark daftar anggota channel (source/berry/irc/irc_members.c).
+
+   1. Seed: channel 10k anggota dari baris 353 sintetis (prefix acak,
+      sebagian userhost-in-names), lalu NAMES ulang tanpa 100 nick untuk
+      memeriksa sweep 366.
+   2. Churn acak JOIN/PART/KICK/NICK/MODE/QUIT di tiga channel kecil,
+      dibandingkan dengan model referensi sederhana (termasuk lookup
+      dengan huruf besar untuk casemapping rfc1459).
+   3. Biaya per operasi di channel 10k.
+   4. Netsplit: QUIT dalam BATCH IRCv3 dan QUIT beruntun tanpa batch, harus
+      sampai sebagai satu on_quit_batch masing-masing. */
+
+#define BIG        10000
+#define PER_LINE   40
+#define POOL       300
+#define CHANS      3
+#define CHURN_OPS  200000
+#define TIMED_OPS  200000
+#define SPLIT      5000
+#define SPLIT_RAW  3000
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static unsigned long events[WINEIRC_MEMBER_SYNCED + 1];
+static unsigned long batches, batch_nicks;
+
+static void on_change(WINEIRC_member_event ev, const char* channel, const char* nick, const char* old_nick,
+                      void* user_data) {
+    (void)channel; (void)nick; (void)old_nick; (void)user_data;
+    events[ev]++;
+}
+
+static void on_quit_batch(const char* const* nicks, size_t count, void* user_data) {
+    (void)nicks; (void)user_data;
+    batches++;
+    batch_nicks += count;
+}
+
+static void feed(WINEIRC_members* m, const char* fmt, ...) __attribute__((format(printf, 2, 3)));
+static void feed(WINEIRC_members* m, const char* fmt, ...) {
+    char line[8192];
+    va_list ap;
+    va_start(ap, fmt);
+    vsnprintf(line, sizeof(line), fmt, ap);
+    va_end(ap);
+    WINEIRC_members_feed_line(m, line);
+}
+
+/* NAMES untuk #big: nick n<i>, dilewati jika skip_mod > 0 dan i % skip_mod == 0 */
+static void send_names(WINEIRC_members* m, int skip_mod) {
+    char line[8192];
+    int n = 0, len = 0;
+    for (int i = 0; i < BIG; i++) {
+        if (skip_mod && i % skip_mod == 0)
+            continue;
+        if (n == 0)
+            len = snprintf(line, sizeof(line), ":irc.localhost 353 bridge = #big :");
+        const char *prefix = i % 50 == 0 ? "@" : i % 10 == 0 ? "@+" : i % 7 == 0 ? "+" : "";
+        if (i % 3 == 0)
+            len += snprintf(line + len, sizeof(line) - len, "%sn%d!user@host%d.example ", prefix, i, i);
+        else
+            len += snprintf(line + len, sizeof(line) - len, "%sn%d ", prefix, i);
+        if (++n == PER_LINE) {
+            WINEIRC_members_feed_line(m, line);
+            n = 0;
+        }
+    }
+    if (n)
+        WINEIRC_members_feed_line(m, line);
+    feed(m, ":irc.localhost 366 bridge #big :End of /NAMES list.");
+}
+
+/* --- Model referensi untuk churn --- */
+
+struct model {
+    char name[POOL][32];
+    int in[CHANS][POOL];
+    unsigned modes[CHANS][POOL];
+    int renames;
+};
+
+static int in_any(const struct model* md, int id) {
+    for (int c = 0; c < CHANS; c++)
+        if (md->in[c][id])
+            return 1;
+    return 0;
+}
+
+static int check_model(const WINEIRC_members* m, const struct model* md) {
+    static const char *chans[CHANS] = { "#a", "#b", "#c" };
+    static const char *upper[CHANS] = { "#A", "#B", "#C" };
+    for (int c = 0; c < CHANS; c++) {
+        size_t expect = 1;  /* bridge sendiri */
+        for (int id = 0; id < POOL; id++) {
+            char up[32];
+            for (int k = 0; k < 32; k++)
+                up[k] = md->name[id][k] >= 'a' && md->name[id][k] <= 'z' ? md->name[id][k] - 32 : md->name[id][k];
+            unsigned modes = 0;
+            int got = WINEIRC_members_get(m, c % 2 ? upper[c] : chans[c], id % 2 ? up : md->name[id], &modes);
+            if (md->in[c][id]) {
+                expect++;
+                if (got != 0 || modes != md->modes[c][id])
+                    return -1;
+            } else if (got == 0) {
+                return -1;
+            }
+            if (WINEIRC_members_nick_known(m, md->name[id]) != in_any(md, id))
+                return -1;
+        }
+        if (WINEIRC_members_count(m, chans[c]) != expect)
+            return -1;
+    }
+    return 0;
+}
+
+static int churn(WINEIRC_members* m) {
+    static const char *chans[CHANS] = { "#a", "#b", "#c" };
+    struct model md;
+    memset(&md, 0, sizeof(md));
+    for (int id = 0; id < POOL; id++)
+        snprintf(md.name[id], sizeof(md.name[id]), "u%d[x]", id);
+    for (int c = 0; c < CHANS; c++) {
+        feed(m, ":bridge!b@h JOIN %s", chans[c]);
+        feed(m, ":irc.localhost 353 bridge = %s :@bridge", chans[c]);
+        feed(m, ":irc.localhost 366 bridge %s :End of /NAMES list.", chans[c]);
+    }
+    int bad = 0;
+    srand(42);
+    for (long op = 0; op < CHURN_OPS; op++) {
+        int id = rand() % POOL, c = rand() % CHANS;
+        const char *nick = md.name[id];
+        switch (rand() % 7) {
+        case 0:
+        case 1:
+            if (!md.in[c][id]) {
+                feed(m, ":%s!u@h JOIN %s", nick, chans[c]);
+                md.in[c][id] = 1;
+                md.modes[c][id] = 0;
+            }
+            break;
+        case 2:
+            if (md.in[c][id]) {
+                feed(m, ":%s!u@h PART %s :bye", nick, chans[c]);
+                md.in[c][id] = 0;
+            }
+            break;
+        case 3:
+            if (md.in[c][id]) {
+                feed(m, ":bridge!b@h KICK %s %s :out", chans[c], nick);
+                md.in[c][id] = 0;
+            }
+            break;
+        case 4:
+            if (in_any(&md, id)) {
+                char fresh[32];
+                snprintf(fresh, sizeof(fresh), "u%d_%d{x}", id, ++md.renames);
+                feed(m, ":%s!u@h NICK :%s", nick, fresh);
+                strcpy(md.name[id], fresh);
+            }
+            break;
+        case 5:
+            if (md.in[c][id]) {
+                int plus = rand() % 2, bit = rand() % 2;
+                /* Mode biasa ber-parameter (+b, +l; -l tanpa parameter) ikut diselipkan */
+                if (plus)
+                    feed(m, ":bridge!b@h MODE %s +bl%c *!*@spam 50 %s", chans[c], bit ? 'v' : 'o', nick);
+                else
+                    feed(m, ":bridge!b@h MODE %s -l%c %s", chans[c], bit ? 'v' : 'o', nick);
+                md.modes[c][id] = plus ? md.modes[c][id] | (1u << bit) : md.modes[c][id] & ~(1u << bit);
+            }
+            break;
+        case 6:
+            if (in_any(&md, id) && rand() % 4 == 0) {
+                feed(m, ":%s!u@h QUIT :Quit: bye", nick);
+                for (int k = 0; k < CHANS; k++)
+                    md.in[k][id] = 0;
+            }
+            break;
+        }
+        if (op % 10000 == 0 && check_model(m, &md) != 0)
+            bad++;
+    }
+    if (check_model(m, &md) != 0)
+        bad++;
+    return bad;
+}
+
+int main(void) {
+    int failed = 0;
+    WINEIRC_members_callbacks cb = { on_change, on_quit_batch };
+    WINEIRC_members *m = WINEIRC_members_create("bridge", &cb, NULL);
+    if (!m)
+        return 1;
+
+    /* --- Seed dari NAMES --- */
+    feed(m, ":irc.localhost 001 bridge :Welcome");
+    feed(m, ":irc.localhost 005 bridge PREFIX=(ov)@+ CHANMODES=beI,k,l,imnpst CASEMAPPING=rfc1459 :are supported by this server");
+    feed(m, ":bridge!b@h JOIN #big");
+    double t0 = now_sec();
+    send_names(m, 0);
+    double seed = now_sec() - t0;
+    unsigned modes = 0;
+    int prefix_ok = WINEIRC_members_get(m, "#big", "n10", &modes) == 0 && WINEIRC_members_prefix(m, modes) == '@' &&
+                    modes == 3 && WINEIRC_members_get(m, "#BIG", "N7", &modes) == 0 && modes == 2;
+    int seed_ok = WINEIRC_members_count(m, "#big") == BIG && WINEIRC_members_synced(m, "#big") && prefix_ok;
+    printf("seed NAMES   : %d anggota, %.0f ns/nick, prefix %s -> %s\n", (int)WINEIRC_members_count(m, "#big"),
+           seed * 1e9 / BIG, prefix_ok ? "OK" : "GAGAL", seed_ok ? "OK" : "GAGAL");
+    failed |= !seed_ok;
+
+    t0 = now_sec();
+    send_names(m, 100);
+    double refresh = now_sec() - t0;
+    int sweep_ok = WINEIRC_members_count(m, "#big") == BIG - BIG / 100 &&
+                   WINEIRC_members_get(m, "#big", "n100", NULL) != 0 && WINEIRC_members_get(m, "#big", "n101", NULL) == 0;
+    printf("NAMES ulang  : %d anggota setelah sweep, %.0f ns/nick -> %s\n", (int)WINEIRC_members_count(m, "#big"),
+           refresh * 1e9 / BIG, sweep_ok ? "OK" : "GAGAL");
+    failed |= !sweep_ok;
+
+    /* --- Churn vs model --- */
+    int bad = churn(m);
+    printf("churn        : %d operasi acak di 3 channel, selisih dengan model %d -> %s\n", CHURN_OPS, bad,
+           bad ? "GAGAL" : "OK");
+    failed |= bad != 0;
+
+    /* --- Biaya per operasi di channel 10k --- */
+    static const char *names[] = { "JOIN", "PART", "NICK", "MODE" };
+    double cost[4] = { 0 };
+    for (int kind = 0; kind < 4; kind++) {
+        t0 = now_sec();
+        for (long i = 0; i < TIMED_OPS / 2; i++) {
+            int n = (int)(i % 1000) * 10 + 1;
+            switch (kind) {
+            case 0:
+                feed(m, ":j%ld!u@h JOIN #big", i % 5000);
+                feed(m, ":j%ld!u@h PART #big", i % 5000);
+                break;
+            case 1:
+                feed(m, ":n%d!u@h PART #big", n);
+                feed(m, ":n%d!u@h JOIN #big", n);
+                break;
+            case 2:
+                feed(m, ":n%d!u@h NICK :m%d", n, n);
+                feed(m, ":m%d!u@h NICK :n%d", n, n);
+                break;
+            case 3:
+                feed(m, ":bridge!b@h MODE #big +v n%d", n);
+                feed(m, ":bridge!b@h MODE #big -v n%d", n);
+                break;
+            }
+        }
+        cost[kind] = (now_sec() - t0) * 1e9 / TIMED_OPS;
+    }
+    printf("per operasi  :");
+    for (int kind = 0; kind < 4; kind++)
+        printf(" %s %.0f ns%s", names[kind], cost[kind], kind < 3 ? "," : "\n");
+    int stable = WINEIRC_members_count(m, "#big") == BIG - BIG / 100;
+    failed |= !stable;
+
+    /* --- Netsplit --- */
+    size_t before = WINEIRC_members_count(m, "#big");
+    unsigned long quit_events = events[WINEIRC_MEMBER_QUIT];
+    t0 = now_sec();
+    feed(m, ":irc.localhost BATCH +ns1 netsplit hub.example leaf.example");
+    for (int i = 1, sent = 0; sent < SPLIT; i++) {
+        if (i % 100 == 0)
+            continue;
+        feed(m, "@batch=ns1 :n%d!u@h QUIT :hub.example leaf.example", i);
+        sent++;
+        /* Baris lain di tengah batch tidak memicu penerapan */
+        if (sent == SPLIT / 2)
+            feed(m, ":x!u@h PRIVMSG #big :halo");
+    }
+    int held = WINEIRC_members_count(m, "#big") == before && batches == 0;
+    feed(m, ":irc.localhost BATCH -ns1");
+    double split = now_sec() - t0;
+    int batch_ok = held && batches == 1 && batch_nicks == SPLIT && WINEIRC_members_count(m, "#big") == before - SPLIT &&
+                   events[WINEIRC_MEMBER_QUIT] == quit_events;
+    printf("netsplit     : %d QUIT dalam BATCH, %lu callback, %.0f ns/QUIT -> %s\n", SPLIT, batches,
+           split * 1e9 / SPLIT, batch_ok ? "OK" : "GAGAL");
+    failed |= !batch_ok;
+
+    before = WINEIRC_members_count(m, "#big");
+    int sent = 0;
+    t0 = now_sec();
+    for (int i = BIG - 1; sent < SPLIT_RAW && i > 0; i--) {
+        if (i % 100 == 0)
+            continue;
+        char nick[32];
+        snprintf(nick, sizeof(nick), "n%d", i);
+        if (WINEIRC_members_get(m, "#big", nick, NULL) != 0)
+            continue;
+        feed(m, ":%s!u@h QUIT :*.net *.split", nick);
+        sent++;
+    }
+    feed(m, ":x!u@h PRIVMSG #big :split selesai");
+    split = now_sec() - t0;
+    int raw_ok = batches == 2 && batch_nicks == SPLIT + (unsigned long)sent &&
+                 WINEIRC_members_count(m, "#big") == before - (size_t)sent;
+    printf("netsplit     : %d QUIT tanpa BATCH, %lu callback total -> %s\n", sent, batches, raw_ok ? "OK" : "GAGAL");
+    failed |= !raw_ok;
+
+    /* --- Memori --- */
+    WINEIRC_members_stats st;
+    WINEIRC_members_get_stats(m, &st);
+    printf("memori       : %zu channel, %zu nick, %zu keanggotaan, %zu byte (%.1f byte/keanggotaan)\n", st.channels,
+           st.nicks, st.memberships, st.bytes, st.memberships ? (double)st.bytes / st.memberships : 0.0);
+
+    WINEIRC_members_reset(m);
+    WINEIRC_members_get_stats(m, &st);
+    int reset_ok = st.channels == 0 && st.nicks == 0 && st.memberships == 0;
+    printf("reset        : %s\n", reset_ok ? "OK" : "GAGAL");
+    failed |= !reset_ok;
+    WINEIRC_members_free(m);
+    return failed;
+}
@@ -0,0 +1,275 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <pthread.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include "metrics.h"
+#include "irc_parser.h"
+
+/* Benchmark overhead metrik di jalur panas.
+
+   - counter: WINEB2B_metrics_add dari 1 thread dibanding increment biasa,
+     dan dari THREADS thread ke handle yang sama dibanding satu counter
+     atomic bersama (false sharing + RMW). Total harus tepat THREADS * N.
+   - histogram: WINEB2B_metrics_record, serta galat kuantil terhadap nilai
+     sebenarnya (batas HDR: <= 12.5%).
+   - per baris: biaya instrumentasi satu baris IRC masuk (bytes_in + lines)
+     dibanding biaya parse baris itu sendiri.
+   - ekspor: render teks Prometheus untuk HANDLES handle dan GET /metrics
+     lewat endpoint HTTP. */
+
+#define OPS     20000000L
+#define THREADS 4
+#define SAMPLES 1000000
+#define LINES   2000000
+#define HANDLES 1000
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static volatile uint64_t sink;
+
+static double bench_plain(void) {
+    uint64_t counter = 0;
+    double start = now_sec();
+    for (long i = 0; i < OPS; i++) {
+        counter++;
+        __asm__ volatile("" : "+r"(counter));
+    }
+    sink = counter;
+    return (now_sec() - start) * 1e9 / OPS;
+}
+
+static double bench_add(WINEB2B_metrics* m) {
+    double start = now_sec();
+    for (long i = 0; i < OPS; i++)
+        WINEB2B_metrics_add(m, WINEB2B_METRIC_BYTES_IN, 1);
+    return (now_sec() - start) * 1e9 / OPS;
+}
+
+typedef struct {
+    WINEB2B_metrics *m;
+    uint64_t *shared;
+} Worker;
+
+static void* worker_shared(void* arg) {
+    Worker *w = arg;
+    for (long i = 0; i < OPS / THREADS; i++)
+        __atomic_fetch_add(w->shared, 1, __ATOMIC_RELAXED);
+    return NULL;
+}
+
+static void* worker_metrics(void* arg) {
+    Worker *w = arg;
+    for (long i = 0; i < OPS / THREADS; i++)
+        WINEB2B_metrics_add(w->m, WINEB2B_METRIC_LINES, 1);
+    return NULL;
+}
+
+/* ns per operasi (waktu dinding, dibagi total operasi semua thread) */
+static double run_threads(void* (*fn)(void*), Worker* w) {
+    pthread_t threads[THREADS];
+    double start = now_sec();
+    for (int i = 0; i < THREADS; i++)
+        pthread_create(&threads[i], NULL, fn, w);
+    for (int i = 0; i < THREADS; i++)
+        pthread_join(threads[i], NULL);
+    return (now_sec() - start) * 1e9 / OPS;
+}
+
+static int cmp_u64(const void* a, const void* b) {
+    uint64_t x = *(const uint64_t*)a, y = *(const uint64_t*)b;
+    return x < y ? -1 : x > y;
+}
+
+/* Sebaran latensi mirip jaringan: log-normal kasar 100 us .. beberapa detik */
+static uint64_t sample_us(unsigned* seed) {
+    double u = 0;
+    for (int i = 0; i < 4; i++)
+        u += rand_r(seed) / (double)RAND_MAX;
+    double e = 2.0 + u * 1.2;   /* 10^2 .. 10^6.8 us */
+    double v = 1;
+    for (int i = 0; i < 10; i++)
+        v *= 1.0 + (e * 2.302585093 / 10);
+    return (uint64_t)v;
+}
+
+static int bench_histogram(WINEB2B_metrics* m) {
+    uint64_t *values = malloc(SAMPLES * sizeof(uint64_t));
+    if (!values)
+        return -1;
+    unsigned seed = 42;
+    for (int i = 0; i < SAMPLES; i++)
+        values[i] = sample_us(&seed);
+    double start = now_sec();
+    for (int i = 0; i < SAMPLES; i++)
+        WINEB2B_metrics_record(m, WINEB2B_METRIC_HTTP_TOTAL, values[i]);
+    double ns = (now_sec() - start) * 1e9 / SAMPLES;
+
+    WINEB2B_metrics_values v;
+    WINEB2B_metrics_snapshot(m, &v);
+    qsort(values, SAMPLES, sizeof(uint64_t), cmp_u64);
+    static const double qs[] = { 0.5, 0.9, 0.99, 0.999 };
+    double worst = 0;
+    printf("histogram: %.1f ns/record, %llu sampel\n", ns, (unsigned long long)v.hist[WINEB2B_METRIC_HTTP_TOTAL].count);
+    for (size_t i = 0; i < sizeof(qs) / sizeof(qs[0]); i++) {
+        uint64_t exact = values[(size_t)(qs[i] * SAMPLES + 0.5) - 1];
+        uint64_t approx = WINEB2B_metrics_percentile(&v, WINEB2B_METRIC_HTTP_TOTAL, qs[i]);
+        double err = exact ? ((double)approx - (double)exact) / (double)exact : 0;
+        if (err < 0)
+            err = -err;
+        if (err > worst)
+            worst = err;
+        printf("           p%-5g sebenarnya %9llu us, histogram %9llu us, galat %.2f%%\n", qs[i] * 100,
+               (unsigned long long)exact, (unsigned long long)approx, err * 100);
+    }
+    free(values);
+    int ok = v.hist[WINEB2B_METRIC_HTTP_TOTAL].count == SAMPLES && worst <= 0.125;
+    printf("           galat terbesar %.2f%% -> %s\n", worst * 100, ok ? "OK" : "GAGAL");
+    return ok ? 0 : -1;
+}
+
+/* Biaya instrumentasi per baris (bytes_in + lines) relatif terhadap parse */
+static void bench_lines(WINEB2B_metrics* m) {
+    static const char sample[] =
+        "@time=2024-01-01T00:00:00.000Z;msgid=abc123 :nick!user@host.example PRIVMSG #channel :halo semua, apa kabar?";
+    char line[sizeof(sample)];
+    WINEIRC_message msg;
+
+    double start = now_sec();
+    for (long i = 0; i < LINES; i++) {
+        memcpy(line, sample, sizeof(sample));
+        WINEIRC_parse_line(line, &msg);
+        __asm__ volatile("" : : "r"(&msg) : "memory");
+    }
+    double parse = (now_sec() - start) * 1e9 / LINES;
+
+    start = now_sec();
+    for (long i = 0; i < LINES; i++) {
+        memcpy(line, sample, sizeof(sample));
+        WINEB2B_metrics_add(m, WINEB2B_METRIC_BYTES_IN, sizeof(sample) + 1);
+        WINEIRC_parse_line(line, &msg);
+        WINEB2B_metrics_add(m, WINEB2B_METRIC_LINES, 1);
+        __asm__ volatile("" : : "r"(&msg) : "memory");
+    }
+    double both = (now_sec() - start) * 1e9 / LINES;
+    double overhead = both - parse;
+    if (overhead < 0)
+        overhead = 0;
+    printf("per baris: parse %.1f ns, parse+metrik %.1f ns, overhead %.1f ns (%.1f%%)\n",
+           parse, both, overhead, overhead * 100 / parse);
+}
+
+static int bench_export(void) {
+    WINEB2B_metrics **handles = calloc(HANDLES, sizeof(WINEB2B_metrics*));
+    if (!handles)
+        return -1;
+    for (int i = 0; i < HANDLES; i++) {
+        char instance[64];
+        snprintf(instance, sizeof(instance), "irc.example:6697/puppet%d", i);
+        handles[i] = WINEB2B_metrics_create("irc", instance);
+        WINEB2B_metrics_add(handles[i], WINEB2B_METRIC_BYTES_IN, 1000 + i);
+        WINEB2B_metrics_record(handles[i], WINEB2B_METRIC_LAG, 1000 + i * 10);
+        WINEB2B_metrics_set(handles[i], WINEB2B_METRIC_LAG_MS, 1 + i / 100);
+    }
+
+    double start = now_sec();
+    size_t len = 0;
+    char *text = WINEB2B_metrics_prometheus(&len);
+    double render = now_sec() - start;
+    int ok = text && strstr(text, "wineberry_handle_bytes_in_total{protocol=\"irc\",instance=\"irc.example:6697/puppet999\"} 1999") &&
+             strstr(text, "wineberry_lag_seconds_bucket{protocol=\"irc\",le=\"+Inf\"} 1000");
+    printf("ekspor   : %d handle, %zu byte teks dalam %.2f ms -> %s\n", HANDLES, len, render * 1e3, ok ? "OK" : "GAGAL");
+    free(text);
+
+    /* Endpoint HTTP */
+    int port = WINEB2B_metrics_serve(0);
+    int served = 0;
+    if (port > 0) {
+        int fd = socket(AF_INET, SOCK_STREAM, 0);
+        struct sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = htons((unsigned short)port);
+        if (fd >= 0 && connect(fd, (struct sockaddr*)&addr, sizeof(addr)) == 0) {
+            static const char req[] = "GET /metrics HTTP/1.1\r\nHost: localhost\r\n\r\n";
+            start = now_sec();
+            if (send(fd, req, sizeof(req) - 1, 0) == (ssize_t)(sizeof(req) - 1)) {
+                size_t cap = len + 65536, got = 0;
+                char *resp = malloc(cap + 1);
+                ssize_t n;
+                while (resp && got < cap && (n = recv(fd, resp + got, cap - got, 0)) > 0)
+                    got += (size_t)n;
+                if (resp) {
+                    resp[got] = '\0';
+                    served = strncmp(resp, "HTTP/1.1 200", 12) == 0 &&
+                             strstr(resp, "text/plain; version=0.0.4") &&
+                             strstr(resp, "# TYPE wineberry_bytes_in_total counter");
+                }
+                printf("endpoint : GET /metrics %zu byte dalam %.2f ms -> %s\n", got,
+                       (now_sec() - start) * 1e3, served ? "OK" : "GAGAL");
+                free(resp);
+            }
+        }
+        if (fd >= 0)
+            close(fd);
+        WINEB2B_metrics_serve_stop();
+    }
+    if (!served)
+        ok = 0;
+
+    for (int i = 0; i < HANDLES; i++)
+        WINEB2B_metrics_free(handles[i]);
+    free(handles);
+
+    /* Handle yang dibebaskan tetap terhitung di total per proses */
+    WINEB2B_metrics_values proc;
+    WINEB2B_metrics_process("irc", &proc);
+    uint64_t expected = (uint64_t)HANDLES * 1000 + (uint64_t)HANDLES * (HANDLES - 1) / 2;
+    int kept = proc.counters[WINEB2B_METRIC_BYTES_IN] == expected;
+    printf("retensi  : bytes_in per proses setelah free %llu (harus %llu) -> %s\n",
+           (unsigned long long)proc.counters[WINEB2B_METRIC_BYTES_IN], (unsigned long long)expected,
+           kept ? "OK" : "GAGAL");
+    return ok && kept ? 0 : -1;
+}
+
+int main(void) {
+    int failed = 0;
+
+    WINEB2B_metrics *m = WINEB2B_metrics_create("bench", "counter");
+    double plain = bench_plain();
+    double add = bench_add(m);
+    printf("counter  : increment biasa %.2f ns, metrics_add %.2f ns (1 thread)\n", plain, add);
+
+    uint64_t shared = 0;
+    Worker w = { m, &shared };
+    double atomic_ns = run_threads(worker_shared, &w);
+    double sharded_ns = run_threads(worker_metrics, &w);
+    WINEB2B_metrics_values v;
+    WINEB2B_metrics_snapshot(m, &v);
+    int exact = shared == (uint64_t)OPS && v.counters[WINEB2B_METRIC_LINES] == (uint64_t)OPS;
+    printf("           %d thread: atomic bersama %.2f ns/op, metrics_add %.2f ns/op (%.1fx), total %llu -> %s\n",
+           THREADS, atomic_ns, sharded_ns, atomic_ns / sharded_ns,
+           (unsigned long long)v.counters[WINEB2B_METRIC_LINES], exact ? "OK" : "GAGAL");
+    if (!exact)
+        failed = 1;
+    WINEB2B_metrics_free(m);
+
+    m = WINEB2B_metrics_create("bench", "histogram");
+    if (bench_histogram(m) != 0)
+        failed = 1;
+    bench_lines(m);
+    WINEB2B_metrics_free(m);
+
+    if (bench_export() != 0)
+        failed = 1;
+    return failed;
+}
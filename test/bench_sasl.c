@@ -0,0 +1,170 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <openssl/evp.h>
+#include <openssl/hmac.h>
+#include <openssl/rand.h>
+#include <openssl/sha.h>
+#include "irc_sasl.h"
+
+/* Benchmark biaya CPU login SASL SCRAM-SHA-256 saat reconnect massal:
+   ACCOUNTS puppet login ulang ROUNDS kali (misal setelah netsplit),
+   dengan dan tanpa cache kunci turunan. Sisi server disimulasikan di
+   proses yang sama dan memverifikasi setiap proof, sehingga hasilnya
+   juga menguji kebenaran pertukaran SCRAM. */
+
+#define ACCOUNTS   200
+#define ROUNDS     5
+#define ITERATIONS 4096
+
+typedef struct {
+    char name[32];
+    char password[32];
+    char salt_b64[32];
+    unsigned char stored_key[SHA256_DIGEST_LENGTH];
+    unsigned char server_key[SHA256_DIGEST_LENGTH];
+} Account;
+
+static double cpu_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void hmac(const unsigned char* key, const char* data, unsigned char* out) {
+    unsigned int len = SHA256_DIGEST_LENGTH;
+    HMAC(EVP_sha256(), key, SHA256_DIGEST_LENGTH, (const unsigned char*)data, strlen(data), out, &len);
+}
+
+/* Data server untuk satu akun: salt acak, StoredKey dan ServerKey */
+static void setup_account(Account* a, int i) {
+    unsigned char salt[16], salted[SHA256_DIGEST_LENGTH], client_key[SHA256_DIGEST_LENGTH];
+    snprintf(a->name, sizeof(a->name), "puppet%d", i);
+    snprintf(a->password, sizeof(a->password), "rahasia-%08x", (unsigned)(i * 2654435761u));
+    RAND_bytes(salt, sizeof(salt));
+    WINEIRC_base64_encode(salt, sizeof(salt), a->salt_b64, sizeof(a->salt_b64));
+    PKCS5_PBKDF2_HMAC(a->password, (int)strlen(a->password), salt, sizeof(salt), ITERATIONS,
+                      EVP_sha256(), sizeof(salted), salted);
+    hmac(salted, "Client Key", client_key);
+    hmac(salted, "Server Key", a->server_key);
+    SHA256(client_key, sizeof(client_key), a->stored_key);
+}
+
+/* Satu login lengkap. 0 jika server menerima proof dan klien menerima server */
+static int login(const Account* a, const char* fixed_nonce) {
+    char first[256], server_first[256], final[512], auth[1024], server_final[128];
+    WINEIRC_scram *scram = WINEIRC_scram_create(a->name, a->password, fixed_nonce);
+    if (!scram || WINEIRC_scram_client_first(scram, first, sizeof(first)) < 0)
+        goto fail;
+
+    /* Server: nonce gabungan, salt dan iterasi */
+    const char *cnonce = strstr(first, ",r=") + 3;
+    snprintf(server_first, sizeof(server_first), "r=%sSRV%04x,s=%s,i=%d",
+             cnonce, (unsigned)(rand() & 0xffff), a->salt_b64, ITERATIONS);
+    if (WINEIRC_scram_client_final(scram, server_first, final, sizeof(final)) < 0)
+        goto fail;
+
+    /* Server: verifikasi proof dari client-final */
+    char *p = strstr(final, ",p=");
+    if (!p)
+        goto fail;
+    snprintf(auth, sizeof(auth), "%s,%s,%.*s", first + 3, server_first, (int)(p - final), final);
+    unsigned char proof[SHA256_DIGEST_LENGTH + 4], sig[SHA256_DIGEST_LENGTH], key[SHA256_DIGEST_LENGTH];
+    if (WINEIRC_base64_decode(p + 3, strlen(p + 3), proof, sizeof(proof)) != SHA256_DIGEST_LENGTH)
+        goto fail;
+    hmac(a->stored_key, auth, sig);
+    for (int i = 0; i < SHA256_DIGEST_LENGTH; i++)
+        proof[i] ^= sig[i];
+    SHA256(proof, SHA256_DIGEST_LENGTH, key);
+    if (memcmp(key, a->stored_key, sizeof(key)) != 0)
+        goto fail;
+
+    hmac(a->server_key, auth, sig);
+    memcpy(server_final, "v=", 2);
+    WINEIRC_base64_encode(sig, sizeof(sig), server_final + 2, sizeof(server_final) - 2);
+    if (WINEIRC_scram_verify_server(scram, server_final) != 0)
+        goto fail;
+    WINEIRC_scram_free(scram);
+    return 0;
+fail:
+    WINEIRC_scram_free(scram);
+    return -1;
+}
+
+/* Vektor uji RFC 7677 */
+static int check_rfc7677(void) {
+    char first[128], final[256];
+    WINEIRC_scram *scram = WINEIRC_scram_create("user", "pencil", "rOprNGfwEbeRWgbNEkqO");
+    int ok = scram &&
+        WINEIRC_scram_client_first(scram, first, sizeof(first)) > 0 &&
+        strcmp(first, "n,,n=user,r=rOprNGfwEbeRWgbNEkqO") == 0 &&
+        WINEIRC_scram_client_final(scram, "r=rOprNGfwEbeRWgbNEkqO%hvYDpWUa2RaTCAfuxFIlj)hNlF$k0,"
+                                   "s=W22ZaJ0SNY7soEsUEjb6gQ==,i=4096", final, sizeof(final)) > 0 &&
+        strcmp(final, "c=biws,r=rOprNGfwEbeRWgbNEkqO%hvYDpWUa2RaTCAfuxFIlj)hNlF$k0,"
+                      "p=dHzbZapWIk4jUhN+Ute9ytag9zjfMHgsqmmiz7AndVQ=") == 0 &&
+        WINEIRC_scram_verify_server(scram, "v=6rriTRBi23WpRR/wtup+mMhUZUn/dB5nLTJRsjl95G4=") == 0;
+    WINEIRC_scram_free(scram);
+    return ok ? 0 : -1;
+}
+
+static int run(const char* label, const Account* accounts) {
+    for (int round = 0; round < ROUNDS; round++) {
+        double cpu = cpu_sec(), wall = now_sec();
+        for (int i = 0; i < ACCOUNTS; i++) {
+            if (login(&accounts[i], NULL) != 0) {
+                fprintf(stderr, "Login %s gagal diverifikasi\n", accounts[i].name);
+                return -1;
+            }
+        }
+        cpu = cpu_sec() - cpu;
+        wall = now_sec() - wall;
+        printf("%-10s %-6d %14.1f %14.0f\n", label, round + 1,
+               cpu * 1e6 / ACCOUNTS, ACCOUNTS / wall);
+    }
+    return 0;
+}
+
+int main(void) {
+    if (check_rfc7677() != 0) {
+        fprintf(stderr, "Vektor uji RFC 7677 gagal\n");
+        return 1;
+    }
+    printf("Vektor uji RFC 7677: OK\n");
+
+    Account *accounts = calloc(ACCOUNTS, sizeof(Account));
+    if (!accounts)
+        return 1;
+    for (int i = 0; i < ACCOUNTS; i++)
+        setup_account(&accounts[i], i);
+
+    printf("%d akun x %d ronde reconnect, i=%d\n", ACCOUNTS, ROUNDS, ITERATIONS);
+    printf("%-10s %-6s %14s %14s\n", "cache", "ronde", "CPU us/login", "login/s");
+
+    WINEIRC_scram_cache_configure(0);
+    if (run("mati", accounts) != 0)
+        return 1;
+
+    WINEIRC_scram_cache_configure(8192);
+    if (run("aktif", accounts) != 0)
+        return 1;
+
+    WINEIRC_scram_cache_stats stats;
+    WINEIRC_scram_cache_get_stats(&stats);
+    printf("cache: %lu hit, %lu miss, %lu/%lu entri\n",
+           stats.hits, stats.misses, stats.entries, stats.capacity);
+    if (stats.misses != ACCOUNTS || stats.hits != (unsigned long)ACCOUNTS * (ROUNDS - 1)) {
+        fprintf(stderr, "Statistik cache tidak sesuai\n");
+        return 1;
+    }
+
+    WINEIRC_scram_cache_clear();
+    free(accounts);
+    return 0;
+}
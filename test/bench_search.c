@@ -0,0 +1,519 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include "search_index.h"
+
+/* Benchmark indeks full-text (source/berry/b2b/search_index.c).
+
+   - ketepatan: 200k pesan sintetis (kosakata Zipf, kata beraksen dan
+     Sirilik dengan huruf besar/kecil campur, kata CJK, kode warna IRC,
+     emoji) ke indeks dengan buffer kecil supaya banyak segmen dan merge.
+     Query term, AND, frasa, CJK, filter channel dan network dibandingkan
+     dengan pencarian brute force atas kata-kata sumbernya, sebelum dan
+     sesudah commit serta setelah indeks dibuka ulang.
+   - ingest: N pesan (default 10 juta, argumen pertama mengubahnya) ke
+     indeks dengan konfigurasi default; throughput dan ukuran di disk.
+   - query: latensi p50/p99 dengan limit 50 untuk term jarang, term umum,
+     AND, frasa dari pesan acak, term + channel dan channel saja, plus
+     menghitung semua hasil term umum tanpa limit. */
+
+#define VOCAB        50000
+#define SYLLABLES    40
+#define CJK_WORDS    40
+#define CHANNELS     300
+#define SMALL_DOCS   200000
+#define DEFAULT_DOCS 10000000L
+#define QUERIES      300
+#define LIMIT        50
+#define BATCH        65536
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static uint64_t mix(uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return x;
+}
+
+struct rng {
+    uint64_t s;
+};
+
+static uint32_t rnd(struct rng* r) {
+    r->s += 0x9e3779b97f4a7c15ULL;
+    return (uint32_t)(mix(r->s) >> 32);
+}
+
+static double rnd_unit(struct rng* r) {
+    return rnd(r) / 4294967296.0;
+}
+
+/* --- Kosakata --- */
+
+static double zipf_cdf[VOCAB];
+static double channel_cdf[CHANNELS];
+
+static void zipf_init(double* cdf, int n) {
+    double sum = 0;
+    for (int i = 0; i < n; i++)
+        sum += 1.0 / (i + 1);
+    double acc = 0;
+    for (int i = 0; i < n; i++) {
+        acc += 1.0 / (i + 1) / sum;
+        cdf[i] = acc;
+    }
+    cdf[n - 1] = 1.0;
+}
+
+static int zipf_pick(const double* cdf, int n, struct rng* r) {
+    double u = rnd_unit(r);
+    int lo = 0, hi = n - 1;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (cdf[mid] < u)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+static int is_cjk_word(int w) {
+    return w % 53 == 11 && w / 53 < CJK_WORDS;
+}
+
+static size_t put_cp(char* out, uint32_t c) {
+    if (c < 0x80) {
+        out[0] = (char)c;
+        return 1;
+    } else if (c < 0x800) {
+        out[0] = (char)(0xc0 | (c >> 6));
+        out[1] = (char)(0x80 | (c & 0x3f));
+        return 2;
+    } else if (c < 0x10000) {
+        out[0] = (char)(0xe0 | (c >> 12));
+        out[1] = (char)(0x80 | ((c >> 6) & 0x3f));
+        out[2] = (char)(0x80 | (c & 0x3f));
+        return 3;
+    }
+    out[0] = (char)(0xf0 | (c >> 18));
+    out[1] = (char)(0x80 | ((c >> 12) & 0x3f));
+    out[2] = (char)(0x80 | ((c >> 6) & 0x3f));
+    out[3] = (char)(0x80 | (c & 0x3f));
+    return 4;
+}
+
+/* Menulis kata w. Kata umum satu suku kata, lalu dua, lalu tiga (suku kata
+   KV dua huruf, jadi setiap kata unik). Sebagian kata memakai é atau huruf
+   Sirilik; upper 1 = huruf pertama besar, 2 = semua besar */
+static size_t render_word(int w, int upper, char* out) {
+    static const char cons[] = "bdgklmst", vow[] = "aeiou";
+    size_t len = 0;
+    if (is_cjk_word(w)) {
+        int k = w / 53;
+        len += put_cp(out + len, 0x4e00 + 2 * k);
+        len += put_cp(out + len, 0x4e00 + 2 * k + 1);
+        return len;
+    }
+    char base[8];
+    int n = w < SYLLABLES ? 1 : w < SYLLABLES * SYLLABLES ? 2 : 3;
+    for (int i = 0, x = w; i < n; i++, x /= SYLLABLES) {
+        base[2 * i] = cons[(x % SYLLABLES) / 5];
+        base[2 * i + 1] = vow[(x % SYLLABLES) % 5];
+    }
+    int script = w % 97 == 5 ? 1 : w % 97 == 7 ? 2 : 0;   /* 1 = beraksen, 2 = Sirilik */
+    for (int i = 0; i < 2 * n; i++) {
+        int big = upper == 2 || (upper == 1 && i == 0);
+        char c = base[i];
+        if (script == 2)
+            len += put_cp(out + len, (uint32_t)((big ? 0x410 : 0x430) + (c - 'a')));
+        else if (script == 1 && c == 'e')
+            len += put_cp(out + len, big ? 0xc9 : 0xe9);
+        else
+            out[len++] = big ? (char)(c - 32) : c;
+    }
+    return len;
+}
+
+/* --- Pesan sintetis (fungsi murni dari nomor pesan) --- */
+
+struct msg {
+    int words[24];
+    int nwords;
+    int channel;
+};
+
+static void gen_msg(long k, struct msg* m) {
+    struct rng r = { mix((uint64_t)k + 1) };
+    m->nwords = 3 + (int)(rnd(&r) % 18);
+    for (int i = 0; i < m->nwords; i++)
+        m->words[i] = zipf_pick(zipf_cdf, VOCAB, &r);
+    m->channel = zipf_pick(channel_cdf, CHANNELS, &r);
+}
+
+static const char* channel_network(int c) {
+    static const char *nets[] = { "irc:irc.libera.chat", "irc:irc.oftc.net", "matrix:example.org" };
+    return nets[c % 3];
+}
+
+static void channel_name(int c, char* out, size_t len) {
+    if (c % 3 == 2)
+        snprintf(out, len, "!room%d:example.org", c);
+    else
+        snprintf(out, len, "#chan%d", c);
+}
+
+/* Teks pesan dengan huruf besar/kecil campur, tanda baca, emoji dan kode format IRC */
+static void render_msg(long k, const struct msg* m, char* out) {
+    struct rng r = { mix((uint64_t)k * 31 + 7) };
+    size_t len = 0;
+    for (int i = 0; i < m->nwords; i++) {
+        uint32_t x = rnd(&r);
+        if (i) {
+            switch (x % 16) {
+            case 0: memcpy(out + len, ", ", 2); len += 2; break;
+            case 1: memcpy(out + len, ". ", 2); len += 2; break;
+            case 2: len += put_cp(out + len, 0x1f600); out[len++] = ' '; break;
+            case 3: memcpy(out + len, " \xe2\x80\x94 ", 5); len += 5; break;    /* em dash */
+            default: out[len++] = ' '; break;
+            }
+        }
+        int fmt = (x >> 8) % 32;
+        if (fmt == 0) {
+            memcpy(out + len, "\x03" "04", 3);
+            len += 3;
+        } else if (fmt == 1) {
+            out[len++] = '\x02';
+        }
+        int upper = (x >> 16) % 8 == 0 ? 1 : (x >> 16) % 50 == 1 ? 2 : 0;
+        len += render_word(m->words[i], upper, out + len);
+        if (fmt == 0)
+            out[len++] = '\x03';
+        else if (fmt == 1)
+            out[len++] = '\x02';
+    }
+    out[len] = '\0';
+}
+
+/* Pesan yang sudah dirender, supaya waktu ingest tidak termasuk pembuatan teks */
+struct rendered {
+    char text[512], channel[64], sender[32];
+    const char *network;
+};
+
+static void prepare_msg(long k, struct rendered* out) {
+    struct msg m;
+    gen_msg(k, &m);
+    render_msg(k, &m, out->text);
+    channel_name(m.channel, out->channel, sizeof(out->channel));
+    snprintf(out->sender, sizeof(out->sender), "user%ld", k % 5000);
+    out->network = channel_network(m.channel);
+}
+
+static int64_t add_prepared(WINEB2B_search* s, long k, const struct rendered* p) {
+    WINEB2B_search_doc doc = { p->network, p->channel, p->sender, 1700000000000LL + k * 10, p->text };
+    return WINEB2B_search_add(s, &doc);
+}
+
+static int64_t add_msg(WINEB2B_search* s, long k) {
+    struct rendered p;
+    prepare_msg(k, &p);
+    return add_prepared(s, k, &p);
+}
+
+/* --- Query acak --- */
+
+enum qkind { Q_RARE, Q_COMMON, Q_AND, Q_PHRASE, Q_CHANNEL_TERM, Q_CHANNEL, Q_CJK, Q_NETWORK, Q_KINDS };
+
+static const char *kind_names[Q_KINDS] = {
+    "term jarang", "term umum", "AND", "frasa", "term+channel", "channel", "CJK", "term+network"
+};
+
+struct query {
+    enum qkind kind;
+    int words[3];
+    int nwords;
+    int phrase;
+    int channel;        /* -1 = tanpa filter channel */
+    int network;        /* -1 = tanpa filter network; jika tidak, indeks ke channel_network() */
+    char text[256];
+    char channel_buf[64];
+};
+
+static void make_query(enum qkind kind, struct rng* r, long ndocs, struct query* q) {
+    memset(q, 0, sizeof(*q));
+    q->kind = kind;
+    q->channel = q->network = -1;
+    switch (kind) {
+    case Q_RARE:
+        q->words[q->nwords++] = 5000 + (int)(rnd(r) % 40000);
+        break;
+    case Q_COMMON:
+        q->words[q->nwords++] = (int)(rnd(r) % 10);
+        break;
+    case Q_AND:
+        q->words[q->nwords++] = 20 + (int)(rnd(r) % 500);
+        q->words[q->nwords++] = 20 + (int)(rnd(r) % 500);
+        break;
+    case Q_PHRASE: {
+        struct msg m;
+        gen_msg((long)(rnd(r) % (uint32_t)ndocs), &m);
+        int len = 2 + (int)(rnd(r) % 2);
+        int at = (int)(rnd(r) % (uint32_t)(m.nwords - len + 1));
+        for (int i = 0; i < len; i++)
+            q->words[q->nwords++] = m.words[at + i];
+        q->phrase = 1;
+        break;
+    }
+    case Q_CHANNEL_TERM:
+        q->words[q->nwords++] = (int)(rnd(r) % 2000);
+        q->channel = (int)(rnd(r) % 100);
+        break;
+    case Q_CHANNEL:
+        q->channel = (int)(rnd(r) % CHANNELS);
+        break;
+    case Q_CJK:
+        q->words[q->nwords++] = 11 + 53 * (int)(rnd(r) % CJK_WORDS);
+        break;
+    case Q_NETWORK:
+        q->words[q->nwords++] = 100 + (int)(rnd(r) % 1000);
+        q->network = (int)(rnd(r) % 3);
+        break;
+    default:
+        break;
+    }
+    /* Query ditulis dengan huruf besar/kecil acak: indeks harus menyamakannya */
+    size_t len = 0;
+    if (q->phrase)
+        q->text[len++] = '"';
+    for (int i = 0; i < q->nwords; i++) {
+        if (i)
+            q->text[len++] = ' ';
+        len += render_word(q->words[i], (int)(rnd(r) % 3), q->text + len);
+    }
+    if (q->phrase)
+        q->text[len++] = '"';
+    q->text[len] = '\0';
+    if (q->channel >= 0)
+        channel_name(q->channel, q->channel_buf, sizeof(q->channel_buf));
+}
+
+static const char* query_network(const struct query* q) {
+    return q->network >= 0 ? channel_network(q->network) : NULL;
+}
+
+static int msg_matches(const struct query* q, const struct msg* m) {
+    if (q->channel >= 0 && m->channel != q->channel)
+        return 0;
+    if (q->network >= 0 && m->channel % 3 != q->network)
+        return 0;
+    if (q->phrase) {
+        for (int at = 0; at + q->nwords <= m->nwords; at++) {
+            int i = 0;
+            while (i < q->nwords && m->words[at + i] == q->words[i])
+                i++;
+            if (i == q->nwords)
+                return 1;
+        }
+        return 0;
+    }
+    for (int i = 0; i < q->nwords; i++) {
+        int found = 0;
+        for (int j = 0; j < m->nwords && !found; j++)
+            found = m->words[j] == q->words[i];
+        if (!found)
+            return 0;
+    }
+    return 1;
+}
+
+struct collect {
+    int64_t *ids;
+    size_t n, cap;
+    int bad_text;
+};
+
+static int collect_hit(const WINEB2B_search_hit* hit, void* user) {
+    struct collect *c = user;
+    if (c->n == c->cap) {
+        c->cap = c->cap ? c->cap * 2 : 1024;
+        c->ids = realloc(c->ids, c->cap * sizeof(int64_t));
+    }
+    c->ids[c->n++] = (int64_t)hit->id;
+    if (hit->doc.timestamp != 1700000000000LL + (int64_t)hit->id * 10 || !hit->doc.text[0])
+        c->bad_text = 1;
+    return 0;
+}
+
+/* Membandingkan hasil indeks (terbaru dulu) dengan brute force atas ndocs pesan */
+static int check_query(WINEB2B_search* s, const struct query* q, const struct msg* corpus, long ndocs) {
+    struct collect c = { 0 };
+    long hits = WINEB2B_search_query(s, q->text, query_network(q), q->channel >= 0 ? q->channel_buf : NULL, 0,
+                                     collect_hit, &c);
+    int ok = hits == (long)c.n && !c.bad_text;
+    size_t k = 0;
+    for (long d = ndocs - 1; d >= 0 && ok; d--) {
+        if (!msg_matches(q, &corpus[d]))
+            continue;
+        ok = k < c.n && c.ids[k] == d;
+        k++;
+    }
+    ok = ok && k == c.n;
+    /* Dengan limit: prefiks yang sama */
+    struct collect top = { 0 };
+    long lim = WINEB2B_search_query(s, q->text, query_network(q), q->channel >= 0 ? q->channel_buf : NULL, 20,
+                                    collect_hit, &top);
+    ok = ok && lim == (long)(c.n < 20 ? c.n : 20);
+    for (long i = 0; i < lim && ok; i++)
+        ok = top.ids[i] == c.ids[i];
+    if (!ok)
+        fprintf(stderr, "  query %s [%s] salah: %ld hasil, brute force %zu\n", kind_names[q->kind], q->text,
+                hits, k);
+    free(c.ids);
+    free(top.ids);
+    return ok;
+}
+
+static int check_all(WINEB2B_search* s, const struct msg* corpus, long ndocs, unsigned seed) {
+    struct rng r = { seed };
+    int ok = 1;
+    for (int i = 0; i < 80; i++) {
+        struct query q;
+        make_query((enum qkind)(i % Q_KINDS), &r, ndocs, &q);
+        ok &= check_query(s, &q, corpus, ndocs);
+    }
+    return ok;
+}
+
+static void remove_dir(const char* dir) {
+    char cmd[256];
+    snprintf(cmd, sizeof(cmd), "rm -rf %s", dir);
+    if (system(cmd) != 0)
+        fprintf(stderr, "Gagal menghapus %s\n", dir);
+}
+
+static int bench_correctness(void) {
+    const char *dir = "bench_search_small";
+    remove_dir(dir);
+    struct msg *corpus = malloc(SMALL_DOCS * sizeof(*corpus));
+    WINEB2B_search_config config = { 2048, 4 };
+    WINEB2B_search *s = WINEB2B_search_open(dir, &config);
+    if (!corpus || !s)
+        return 0;
+    int ok = 1;
+    for (long k = 0; k < SMALL_DOCS; k++) {
+        gen_msg(k, &corpus[k]);
+        ok &= add_msg(s, k) == k;
+        /* Di tengah ingest: sebagian masih di buffer dan sedang di-merge */
+        if (k == SMALL_DOCS / 2 + 1000)
+            ok &= check_all(s, corpus, k + 1, 1);
+    }
+    int buffered_ok = ok;
+    ok &= WINEB2B_search_commit(s) == 0;
+    ok &= check_all(s, corpus, SMALL_DOCS, 2);
+    WINEB2B_search_stats st;
+    WINEB2B_search_get_stats(s, &st);
+    WINEB2B_search_close(s);
+
+    s = WINEB2B_search_open(dir, &config);
+    int reopen_ok = s && check_all(s, corpus, SMALL_DOCS, 3);
+    /* ID berlanjut setelah dibuka ulang */
+    reopen_ok = reopen_ok && add_msg(s, SMALL_DOCS) == SMALL_DOCS;
+    WINEB2B_search_close(s);
+    ok &= reopen_ok;
+    printf("ketepatan    : %d pesan, %zu segmen setelah %llu merge, 240 query vs brute force "
+           "(buffer %s, commit, buka ulang %s) -> %s\n",
+           SMALL_DOCS, st.segments, (unsigned long long)st.merges, buffered_ok ? "OK" : "GAGAL",
+           reopen_ok ? "OK" : "GAGAL", ok ? "OK" : "GAGAL");
+    free(corpus);
+    remove_dir(dir);
+    return ok;
+}
+
+static int cmp_double(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return x < y ? -1 : x > y;
+}
+
+int main(int argc, char** argv) {
+    long ndocs = argc > 1 ? atol(argv[1]) : DEFAULT_DOCS;
+    if (ndocs < 1000)
+        ndocs = 1000;
+    zipf_init(zipf_cdf, VOCAB);
+    zipf_init(channel_cdf, CHANNELS);
+    int ok = bench_correctness();
+
+    const char *dir = "bench_search_index";
+    remove_dir(dir);
+    WINEB2B_search *s = WINEB2B_search_open(dir, NULL);
+    if (!s)
+        return 1;
+    struct rendered *batch = malloc(BATCH * sizeof(*batch));
+    if (!batch)
+        return 1;
+    double ingest = 0, total = 0;
+    for (long k = 0; k < ndocs; k += BATCH) {
+        long n = ndocs - k < BATCH ? ndocs - k : BATCH;
+        for (long i = 0; i < n; i++)
+            prepare_msg(k + i, &batch[i]);
+        double t0 = now_sec();
+        for (long i = 0; i < n; i++)
+            add_prepared(s, k + i, &batch[i]);
+        ingest += now_sec() - t0;
+    }
+    free(batch);
+    double t0 = now_sec();
+    int commit_ok = WINEB2B_search_commit(s) == 0;
+    total = ingest + now_sec() - t0;
+    WINEB2B_search_stats st;
+    WINEB2B_search_get_stats(s, &st);
+    ok &= commit_ok && st.docs == (uint64_t)ndocs;
+    printf("ingest       : %ld pesan, %.0f pesan/s (%.1f s, %.1f s sampai commit), %zu segmen, %llu merge, "
+           "%.0f MB di disk (posting %.1f byte/pesan) -> %s\n",
+           ndocs, ndocs / ingest, ingest, total, st.segments, (unsigned long long)st.merges,
+           st.disk_bytes / 1e6, (double)st.postings_bytes / ndocs, commit_ok ? "OK" : "GAGAL");
+
+    struct rng r = { 42 };
+    double worst_p99 = 0;
+    for (int kind = 0; kind < Q_KINDS; kind++) {
+        if (kind == Q_CJK || kind == Q_NETWORK)
+            continue;
+        double lat[QUERIES];
+        long hits = 0;
+        for (int i = 0; i < QUERIES; i++) {
+            struct query q;
+            make_query((enum qkind)kind, &r, ndocs, &q);
+            double t0 = now_sec();
+            long n = WINEB2B_search_query(s, q.text, query_network(&q), q.channel >= 0 ? q.channel_buf : NULL, LIMIT,
+                                          NULL, NULL);
+            lat[i] = (now_sec() - t0) * 1e3;
+            hits += n > 0 ? n : 0;
+        }
+        qsort(lat, QUERIES, sizeof(double), cmp_double);
+        double p99 = lat[QUERIES * 99 / 100];
+        if (p99 > worst_p99)
+            worst_p99 = p99;
+        printf("query        : %-12s p50 %.3f ms, p99 %.3f ms, rata-rata %.1f hasil\n", kind_names[kind],
+               lat[QUERIES / 2], p99, (double)hits / QUERIES);
+    }
+    double start = now_sec();
+    long all = WINEB2B_search_query(s, "ba", NULL, NULL, 0, NULL, NULL);
+    double count_ms = (now_sec() - start) * 1e3;
+    printf("tanpa limit  : term paling umum, %ld hasil dalam %.0f ms (%.0f juta posting/s)\n", all, count_ms,
+           all / count_ms / 1e3);
+    int query_ok = worst_p99 < 50.0;
+    printf("query        : p99 terburuk %.1f ms dengan limit %d -> %s\n", worst_p99, LIMIT, query_ok ? "OK" : "GAGAL");
+    ok &= query_ok;
+    WINEB2B_search_close(s);
+    remove_dir(dir);
+    return ok ? 0 : 1;
+}
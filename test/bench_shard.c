@@ -0,0 +1,679 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <time.h>
+#include <poll.h>
+#include <sys/wait.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <json-c/json.h>
+#include "irc_driver.h"
+#include "irc_loop.h"
+#include "irc_parser.h"
+#include "matrix_driver.h"
+#include "shard.h"
+#include "log.h"
+#include "mock_ircd.h"
+#include "mock_homeserver.h"
+
+/* Benchmark sharding route bridge (source/berry/b2b/shard.c).
+
+   - ring: 100000 route dibagi ke 4 shard (64 vnode), dicatat beban
+     terbesar terhadap rata-rata dan waktu lookup. Shard kelima masuk:
+     route yang pindah harus sekitar 1/5 dan semuanya ke shard baru.
+   - cluster: koordinator (socket Unix), mock IRCd dan homeserver
+     pengganti masing-masing di proses sendiri, ditambah 3 proses bridge.
+     Setiap bridge punya satu koneksi IRC (WINEIRC_loop) dan satu akun
+     Matrix; route milik shard di-JOIN di IRC dan di Matrix, pesan IRC
+     dengan tag msgid di-relay ke room. Pengirim mengirim pesan bernomor
+     ke 32 channel tanpa henti sementara shard keempat masuk lalu shard
+     pertama keluar dengan tertib. Setiap pesan harus sampai di room tepat
+     sekali dan berurutan per room.
+   - gagal: satu proses bridge di-SIGKILL. Setelah route-nya diambil alih,
+     gelombang pesan berikutnya juga harus sampai tepat sekali.
+   - auth: koordinator TCP tanpa secret ditolak. Anggota dengan secret
+     benar masuk ring; secret salah dan HELLO mentah tanpa AUTH ditolak
+     dan tidak pernah menjadi anggota. */
+
+#define RING_ROUTES     100000
+#define RING_SHARDS     4
+#define CHANNELS        32
+#define BATCH_A         6000
+#define BATCH_B         2000
+#define BURST           3       /* Pesan per jeda */
+#define PACE_US         1000
+#define SETTLE_SEC      0.2
+#define MAX_WORKERS     8
+#define NETWORK         "mock"
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* --- Ring --- */
+
+static int run_ring(void) {
+    WINEB2B_ring *ring = WINEB2B_ring_create();
+    char id[16], chan[32];
+    for (int i = 0; i < RING_SHARDS; i++) {
+        snprintf(id, sizeof(id), "s%d", i);
+        WINEB2B_ring_add(ring, id, 0);
+    }
+    char (*owner)[16] = malloc(RING_ROUTES * sizeof(*owner));
+    int load[RING_SHARDS + 1] = { 0 };
+    double start = now_sec();
+    for (int i = 0; i < RING_ROUTES; i++) {
+        snprintf(chan, sizeof(chan), "#chan%d", i);
+        const char *o = WINEB2B_ring_owner(ring, "libera", chan);
+        snprintf(owner[i], sizeof(owner[i]), "%s", o);
+        load[o[1] - '0']++;
+    }
+    double lookup_ns = (now_sec() - start) * 1e9 / RING_ROUTES;
+    int max = 0;
+    for (int i = 0; i < RING_SHARDS; i++)
+        if (load[i] > max)
+            max = load[i];
+    double imbalance = (double)max / (RING_ROUTES / RING_SHARDS);
+
+    snprintf(id, sizeof(id), "s%d", RING_SHARDS);
+    WINEB2B_ring_add(ring, id, 0);
+    int moved = 0, wrong = 0;
+    for (int i = 0; i < RING_ROUTES; i++) {
+        snprintf(chan, sizeof(chan), "#chan%d", i);
+        const char *o = WINEB2B_ring_owner(ring, "libera", chan);
+        if (strcmp(o, owner[i]) != 0) {
+            moved++;
+            if (strcmp(o, id) != 0)
+                wrong++;
+        }
+    }
+    double fraction = (double)moved / RING_ROUTES;
+    int ok = imbalance < 1.35 && fraction > 0.12 && fraction < 0.28 && wrong == 0;
+    printf("ring     : %d route ke %d shard, beban terbesar %.2fx rata-rata, lookup %.0f ns; shard ke-%d masuk: "
+           "%.1f%% route pindah (ideal %.1f%%), %d ke shard lama -> %s\n",
+           RING_ROUTES, RING_SHARDS, imbalance, lookup_ns, RING_SHARDS + 1, fraction * 100,
+           100.0 / (RING_SHARDS + 1), wrong, ok ? "OK" : "GAGAL");
+    free(owner);
+    WINEB2B_ring_free(ring);
+    return ok ? 0 : -1;
+}
+
+/* --- Proses bridge --- */
+
+typedef struct {
+    char id[16];
+    int coord;                  /* Laporan koordinator, bukan bridge */
+    long failed;                /* Kirim ke Matrix gagal */
+    WINEB2B_shard_stats shard;
+    WINEB2B_shard_coord_stats coord_stats;
+} Report;
+
+typedef struct {
+    char id[16], nick[32];
+    WINEIRC_loop *loop;
+    WINEIRC_handle *irc;
+    WINEMATRIX_handle *matrix;
+    WINEB2B_shard *shard;
+    long failed;
+} Worker;
+
+static volatile sig_atomic_t leave_requested, stop_requested;
+
+static void on_leave(int sig) {
+    (void)sig;
+    leave_requested = 1;
+}
+
+static void on_stop(int sig) {
+    (void)sig;
+    stop_requested = 1;
+}
+
+/* "#shard7" -> "!shard7:localhost" */
+static void room_for(const char* channel, char* out, size_t len) {
+    snprintf(out, len, "!%s:localhost", channel + 1);
+}
+
+static void send_line(Worker* w, const char* cmd, const char* channel) {
+    char line[96];
+    int len = snprintf(line, sizeof(line), "%s %s\r\n", cmd, channel);
+    WINEIRC_loop_send(w->loop, w->irc, line, (size_t)len);
+}
+
+static int worker_acquire(const char* network, const char* channel, void* user) {
+    (void)network;
+    Worker *w = user;
+    char room[64];
+    room_for(channel, room, sizeof(room));
+    WINEMATRIX_join_room(w->matrix, room);
+    send_line(w, "JOIN", channel);
+    return 1;   /* Selesai saat JOIN kita sendiri terlihat */
+}
+
+static int worker_release(const char* network, const char* channel, void* user) {
+    (void)network;
+    send_line(user, "PART", channel);
+    return 1;
+}
+
+static void worker_deliver(const char* network, const char* channel, const char* key,
+                           const void* data, size_t len, void* user) {
+    (void)network;
+    (void)key;
+    Worker *w = user;
+    char room[64], text[256];
+    room_for(channel, room, sizeof(room));
+    snprintf(text, sizeof(text), "%.*s", (int)len, (const char*)data);
+    if (WINEMATRIX_send_message(w->matrix, room, text) != 0)
+        w->failed++;
+}
+
+static void worker_line(WINEIRC_handle* handle, char* line, void* user_data) {
+    (void)handle;
+    Worker *w = user_data;
+    WINEIRC_message msg;
+    char nick[32];
+    if (WINEIRC_parse_line(line, &msg) != 0 || !msg.prefix || msg.param_count < 1 ||
+        WINEIRC_prefix_nick(msg.prefix, nick, sizeof(nick)) != 0)
+        return;
+    int mine = strcmp(nick, w->nick) == 0;
+    if (mine && strcmp(msg.command, "JOIN") == 0)
+        WINEB2B_shard_acquired(w->shard, NETWORK, msg.params[0]);
+    else if (mine && strcmp(msg.command, "PART") == 0)
+        WINEB2B_shard_released(w->shard, NETWORK, msg.params[0]);
+    else if (strcmp(msg.command, "PRIVMSG") == 0 && msg.param_count == 2 && msg.params[0][0] == '#')
+        WINEB2B_shard_submit(w->shard, NETWORK, msg.params[0], WINEIRC_message_tag(&msg, "msgid"),
+                             msg.params[1], strlen(msg.params[1]));
+}
+
+static void worker_close(WINEIRC_handle* handle, void* user_data) {
+    (void)handle;
+    (void)user_data;
+    stop_requested = 1;
+}
+
+static void worker_main(int n, const char* address, int irc_port, const char* homeserver, int report_fd) {
+    signal(SIGUSR1, on_leave);
+    signal(SIGTERM, on_stop);
+    Worker w;
+    memset(&w, 0, sizeof(w));
+    snprintf(w.id, sizeof(w.id), "w%d", n);
+    snprintf(w.nick, sizeof(w.nick), "relay%d", n);
+    WINEIRC_loop_callbacks cb = { worker_line, worker_close };
+    WINEB2B_shard_callbacks scb = { worker_acquire, worker_release, worker_deliver };
+    w.loop = WINEIRC_loop_create(WINEIRC_BACKEND_POLL, &cb, &w);
+    w.irc = WINEIRC_create("127.0.0.1", irc_port, w.nick, w.nick, "#lobby");
+    w.matrix = WINEMATRIX_create(homeserver, w.nick, "rahasia");
+    if (!w.loop || !w.irc || !w.matrix || WINEIRC_loop_add(w.loop, w.irc) != 0)
+        _exit(1);
+    w.shard = WINEB2B_shard_join(address, w.id, 0, NULL, &scb, &w);
+    if (!w.shard)
+        _exit(1);
+    char chan[32];
+    for (int i = 0; i < CHANNELS; i++) {
+        snprintf(chan, sizeof(chan), "#shard%d", i);
+        WINEB2B_shard_add_route(w.shard, NETWORK, chan);
+    }
+    int leaving = 0;
+    while (!stop_requested) {
+        if (leave_requested && !leaving) {
+            WINEB2B_shard_leave(w.shard);
+            leaving = 1;
+        }
+        if (leaving && WINEB2B_shard_left(w.shard))
+            break;
+        WINEIRC_loop_run(w.loop, 2);
+        if (WINEB2B_shard_run(w.shard, 0) != 0)
+            break;
+    }
+    Report r;
+    memset(&r, 0, sizeof(r));
+    snprintf(r.id, sizeof(r.id), "%s", w.id);
+    r.failed = w.failed;
+    WINEB2B_shard_get_stats(w.shard, &r.shard);
+    if (write(report_fd, &r, sizeof(r)) != (ssize_t)sizeof(r))
+        _exit(1);
+    _exit(0);
+}
+
+static void coord_main(const char* address, int report_fd) {
+    signal(SIGTERM, on_stop);
+    WINEB2B_shard_coord *coord = WINEB2B_shard_coord_create(address, 1000, NULL);
+    if (!coord)
+        _exit(1);
+    while (!stop_requested)
+        WINEB2B_shard_coord_run(coord, 20);
+    Report r;
+    memset(&r, 0, sizeof(r));
+    snprintf(r.id, sizeof(r.id), "coord");
+    r.coord = 1;
+    WINEB2B_shard_coord_get_stats(coord, &r.coord_stats);
+    WINEB2B_shard_coord_free(coord);
+    WINEB2B_log_flush();
+    if (write(report_fd, &r, sizeof(r)) != (ssize_t)sizeof(r))
+        _exit(1);
+    _exit(0);
+}
+
+/* --- Autentikasi --- */
+
+/* HELLO tanpa HMAC langsung ke port koordinator; 1 jika dibalas ERR lalu ditutup */
+static int raw_hello_rejected(const char* address) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in sa = { 0 };
+    sa.sin_family = AF_INET;
+    sa.sin_port = htons((uint16_t)atoi(strrchr(address, ':') + 1));
+    inet_pton(AF_INET, "127.0.0.1", &sa.sin_addr);
+    if (fd < 0 || connect(fd, (struct sockaddr*)&sa, sizeof(sa)) != 0) {
+        if (fd >= 0)
+            close(fd);
+        return 0;
+    }
+    const char hello[] = "HELLO penyusup 64\n";
+    char buf[1024];
+    size_t len = 0;
+    int closed = 0;
+    if (write(fd, hello, sizeof(hello) - 1) == (ssize_t)(sizeof(hello) - 1)) {
+        double deadline = now_sec() + 2;
+        while (len < sizeof(buf) - 1 && now_sec() < deadline) {
+            struct pollfd pfd = { fd, POLLIN, 0 };
+            if (poll(&pfd, 1, 100) <= 0)
+                continue;
+            ssize_t n = read(fd, buf + len, sizeof(buf) - 1 - len);
+            if (n <= 0) {
+                closed = 1;
+                break;
+            }
+            len += (size_t)n;
+        }
+    }
+    buf[len] = '\0';
+    close(fd);
+    return closed && strstr(buf, "ERR auth") && !strstr(buf, "VIEW");
+}
+
+static int run_auth(void) {
+    int open_tcp = WINEB2B_shard_coord_create("tcp:127.0.0.1:0", 1000, NULL) != NULL;
+    WINEB2B_shard_coord *coord = WINEB2B_shard_coord_create("tcp:127.0.0.1:0", 1000, "rahasia-shard");
+    if (!coord)
+        return -1;
+    char address[64];
+    snprintf(address, sizeof(address), "%s", WINEB2B_shard_coord_address(coord));
+    pid_t pid = fork();
+    if (pid == 0) {
+        signal(SIGTERM, on_stop);
+        while (!stop_requested)
+            WINEB2B_shard_coord_run(coord, 20);
+        _exit(0);
+    }
+    WINEB2B_shard_coord_free(coord);
+
+    WINEB2B_shard *good = WINEB2B_shard_join(address, "a", 0, "rahasia-shard", NULL, NULL);
+    WINEB2B_shard *bad = WINEB2B_shard_join(address, "b", 0, "salah", NULL, NULL);
+    WINEB2B_shard *plain = WINEB2B_shard_join(address, "c", 0, NULL, NULL, NULL);
+    int raw = raw_hello_rejected(address);
+    WINEB2B_shard_stats st = { 0 };
+    double deadline = now_sec() + 2;
+    while (good && now_sec() < deadline) {
+        if (WINEB2B_shard_run(good, 20) != 0)
+            break;
+        WINEB2B_shard_get_stats(good, &st);
+        if (st.epoch > 0 && now_sec() > deadline - 1.5)
+            break;
+    }
+    kill(pid, SIGTERM);
+    waitpid(pid, NULL, 0);
+
+    int ok = !open_tcp && good && st.epoch > 0 && st.members == 1 && !bad && !plain && raw;
+    printf("auth     : tcp tanpa secret %s, secret benar %s (%zu anggota), secret salah %s, "
+           "tanpa secret %s, HELLO mentah %s -> %s\n",
+           open_tcp ? "diterima" : "ditolak", good && st.epoch > 0 ? "masuk" : "gagal", st.members,
+           bad ? "masuk" : "ditolak", plain ? "masuk" : "ditolak", raw ? "ditolak" : "diterima",
+           ok ? "OK" : "GAGAL");
+    WINEB2B_shard_free(good);
+    WINEB2B_shard_free(bad);
+    WINEB2B_shard_free(plain);
+    return ok ? 0 : -1;
+}
+
+/* --- Pengirim dan pemeriksa --- */
+
+typedef struct {
+    WINEIRC_loop *loop;
+    WINEIRC_handle *gen;
+    unsigned relays[CHANNELS];  /* Bit per bridge yang sedang ada di channel */
+    int joined;                 /* Channel yang sudah di-JOIN pengirim */
+    long moves;                 /* JOIN bridge setelah start */
+    double changed;             /* Waktu JOIN/PART/QUIT bridge terakhir */
+} Sender;
+
+static int channel_index(const char* channel) {
+    return strncmp(channel, "#shard", 6) == 0 ? atoi(channel + 6) : -1;
+}
+
+static void sender_line(WINEIRC_handle* handle, char* line, void* user_data) {
+    (void)handle;
+    Sender *s = user_data;
+    WINEIRC_message msg;
+    char nick[32];
+    if (WINEIRC_parse_line(line, &msg) != 0 || !msg.prefix ||
+        WINEIRC_prefix_nick(msg.prefix, nick, sizeof(nick)) != 0)
+        return;
+    int relay = strncmp(nick, "relay", 5) == 0 ? atoi(nick + 5) : 0;
+    int c = msg.param_count > 0 ? channel_index(msg.params[0]) : -1;
+    if (relay)
+        s->changed = now_sec();
+    if (strcmp(msg.command, "JOIN") == 0 && c >= 0 && c < CHANNELS) {
+        if (relay) {
+            s->relays[c] |= 1u << relay;
+            s->moves++;
+        } else {
+            s->joined++;
+        }
+    } else if (strcmp(msg.command, "PART") == 0 && relay && c >= 0 && c < CHANNELS) {
+        s->relays[c] &= ~(1u << relay);
+    } else if (strcmp(msg.command, "QUIT") == 0 && relay) {
+        /* Bridge yang mati keluar dari semua channel-nya */
+        for (int i = 0; i < CHANNELS; i++)
+            s->relays[i] &= ~(1u << relay);
+    }
+}
+
+static void sender_close(WINEIRC_handle* handle, void* user_data) {
+    (void)handle;
+    (void)user_data;
+}
+
+/* Setiap channel punya tepat satu bridge dan tidak ada JOIN/PART selama
+   SETTLE_SEC: bridge yang masih PART bukan pemilik route */
+static int settled(const Sender* s) {
+    for (int i = 0; i < CHANNELS; i++)
+        if (!s->relays[i] || (s->relays[i] & (s->relays[i] - 1)))
+            return 0;
+    return now_sec() - s->changed >= SETTLE_SEC;
+}
+
+/* QUIT w2 (relay2) sudah terlihat */
+static int relay2_gone(const Sender* s) {
+    for (int i = 0; i < CHANNELS; i++)
+        if (s->relays[i] & (1u << 2))
+            return 0;
+    return 1;
+}
+
+static int pump_until(Sender* s, int (*done)(const Sender*), double timeout) {
+    double deadline = now_sec() + timeout;
+    WINEIRC_loop_run(s->loop, 0);
+    while (!done(s)) {
+        if (now_sec() > deadline)
+            return -1;
+        WINEIRC_loop_run(s->loop, 10);
+    }
+    return 0;
+}
+
+static void send_seq(Sender* s, long seq) {
+    char line[64];
+    int len = snprintf(line, sizeof(line), "PRIVMSG #shard%ld :seq %ld\r\n", seq % CHANNELS, seq);
+    WINEIRC_loop_send(s->loop, s->gen, line, (size_t)len);
+}
+
+typedef struct {
+    WINEMATRIX_handle *matrix;
+    char *since;
+    int *count;                 /* Kemunculan per nomor pesan */
+    long last[CHANNELS];        /* Nomor terakhir per room */
+    long out_of_order;
+} Checker;
+
+/* Mengambil event baru dari homeserver dan menghitung nomor pesan */
+static void check_sync(Checker* k) {
+    char *response = NULL, *next = NULL;
+    if (WINEMATRIX_sync(k->matrix, k->since, 0, &response, &next) != 0) {
+        free(response);
+        free(next);
+        return;
+    }
+    json_object *root = json_tokener_parse(response), *rooms, *join;
+    if (root && json_object_object_get_ex(root, "rooms", &rooms) &&
+        json_object_object_get_ex(rooms, "join", &join)) {
+        struct json_object_iterator it = json_object_iter_begin(join), end = json_object_iter_end(join);
+        for (; !json_object_iter_equal(&it, &end); json_object_iter_next(&it)) {
+            int c = atoi(json_object_iter_peek_name(&it) + 6);
+            json_object *timeline, *events, *content, *body;
+            if (c < 0 || c >= CHANNELS ||
+                !json_object_object_get_ex(json_object_iter_peek_value(&it), "timeline", &timeline) ||
+                !json_object_object_get_ex(timeline, "events", &events))
+                continue;
+            for (size_t i = 0; i < json_object_array_length(events); i++) {
+                json_object *ev = json_object_array_get_idx(events, i);
+                const char *text;
+                if (!json_object_object_get_ex(ev, "content", &content) ||
+                    !json_object_object_get_ex(content, "body", &body) ||
+                    !(text = json_object_get_string(body)) || strncmp(text, "seq ", 4) != 0)
+                    continue;
+                long seq = atol(text + 4);
+                if (seq < 0 || seq >= BATCH_A + BATCH_B)
+                    continue;
+                k->count[seq]++;
+                if (seq < k->last[c])
+                    k->out_of_order++;
+                k->last[c] = seq;
+            }
+        }
+    }
+    json_object_put(root);
+    free(response);
+    free(k->since);
+    k->since = next;
+}
+
+/* Menunggu semua pesan [from, to) sampai; lalu menghitung yang hilang dan ganda */
+static void check_range(Checker* k, long from, long to, double timeout, long* missing, long* duplicates) {
+    double deadline = now_sec() + timeout;
+    for (;;) {
+        check_sync(k);
+        *missing = *duplicates = 0;
+        for (long i = from; i < to; i++) {
+            if (k->count[i] == 0)
+                (*missing)++;
+            else if (k->count[i] > 1)
+                *duplicates += k->count[i] - 1;
+        }
+        if (*missing == 0 || now_sec() > deadline)
+            break;
+        usleep(50000);
+    }
+    /* Salinan ganda yang datang terlambat */
+    usleep(300000);
+    check_sync(k);
+    *duplicates = 0;
+    for (long i = from; i < to; i++)
+        if (k->count[i] > 1)
+            *duplicates += k->count[i] - 1;
+}
+
+static pid_t spawn_worker(int n, const char* address, int irc_port, const char* homeserver, int report_fd) {
+    pid_t pid = fork();
+    if (pid == 0)
+        worker_main(n, address, irc_port, homeserver, report_fd);
+    return pid;
+}
+
+static int run_cluster(void) {
+    mock_ircd_options iopt = { 0 };
+    mock_homeserver_options mopt = { 0 };
+    pid_t ircd_pid, hs_pid, coord_pid, workers[MAX_WORKERS];
+    int irc_port = mock_ircd_start(&iopt, &ircd_pid);
+    int hs_port = mock_homeserver_start(&mopt, &hs_pid);
+    if (irc_port < 0 || hs_port < 0)
+        return -1;
+    char homeserver[64], address[64];
+    snprintf(homeserver, sizeof(homeserver), "http://127.0.0.1:%d", hs_port);
+    snprintf(address, sizeof(address), "unix:/tmp/bench_shard_%d.sock", (int)getpid());
+
+    int report[2];
+    if (pipe(report) != 0)
+        return -1;
+    coord_pid = fork();
+    if (coord_pid == 0) {
+        close(report[0]);
+        coord_main(address, report[1]);
+    }
+    usleep(100000);
+
+    /* Pemeriksa ikut semua room sejak awal */
+    Checker k;
+    memset(&k, 0, sizeof(k));
+    k.count = calloc(BATCH_A + BATCH_B, sizeof(int));
+    for (int i = 0; i < CHANNELS; i++)
+        k.last[i] = -1;
+    k.matrix = WINEMATRIX_create(homeserver, "checker", "rahasia");
+    if (!k.matrix)
+        return -1;
+    char room[64], chan[32];
+    for (int i = 0; i < CHANNELS; i++) {
+        snprintf(chan, sizeof(chan), "#shard%d", i);
+        room_for(chan, room, sizeof(room));
+        WINEMATRIX_join_room(k.matrix, room);
+    }
+    check_sync(&k);
+
+    Sender s;
+    memset(&s, 0, sizeof(s));
+    WINEIRC_loop_callbacks cb = { sender_line, sender_close };
+    s.loop = WINEIRC_loop_create(WINEIRC_BACKEND_POLL, &cb, &s);
+    s.gen = WINEIRC_create("127.0.0.1", irc_port, "gen", "gen", "#lobby");
+    if (!s.loop || !s.gen || WINEIRC_loop_add(s.loop, s.gen) != 0)
+        return -1;
+    for (int i = 0; i < CHANNELS; i++) {
+        char line[48];
+        int len = snprintf(line, sizeof(line), "JOIN #shard%d\r\n", i);
+        WINEIRC_loop_send(s.loop, s.gen, line, (size_t)len);
+    }
+    double deadline = now_sec() + 5;
+    while (s.joined < CHANNELS && now_sec() < deadline)
+        WINEIRC_loop_run(s.loop, 10);
+
+    double start = now_sec();
+    for (int i = 0; i < 3; i++)
+        workers[i] = spawn_worker(i + 1, address, irc_port, homeserver, report[1]);
+    int ready = pump_until(&s, settled, 10) == 0;
+    double ready_ms = (s.changed - start) * 1000;
+    printf("start    : 3 bridge, %d channel terbagi dalam %.0f ms -> %s\n", CHANNELS, ready_ms,
+           ready ? "OK" : "GAGAL");
+
+    /* Gelombang A: shard keempat masuk, lalu shard pertama keluar */
+    long moves_before = s.moves;
+    start = now_sec();
+    for (long seq = 0; seq < BATCH_A; seq++) {
+        if (seq == BATCH_A / 5)
+            workers[3] = spawn_worker(4, address, irc_port, homeserver, report[1]);
+        if (seq == BATCH_A * 3 / 5)
+            kill(workers[0], SIGUSR1);
+        send_seq(&s, seq);
+        if (seq % BURST == BURST - 1) {
+            WINEIRC_loop_run(s.loop, 0);
+            usleep(PACE_US);
+        }
+    }
+    WINEIRC_loop_run(s.loop, 0);
+    double send_ms = (now_sec() - start) * 1000;
+    long missing, duplicates;
+    check_range(&k, 0, BATCH_A, 10, &missing, &duplicates);
+    pump_until(&s, settled, 2);
+    long moved = s.moves - moves_before;
+    int status;
+    int left = waitpid(workers[0], &status, WNOHANG) == workers[0];
+    int ok_a = ready && missing == 0 && duplicates == 0 && k.out_of_order == 0 && left;
+    printf("skala    : %d pesan dalam %.0f ms sambil w4 masuk dan w1 keluar (%ld JOIN route pindah): "
+           "%ld hilang, %ld ganda, %ld tidak urut, w1 %s -> %s\n",
+           BATCH_A, send_ms, moved, missing, duplicates, k.out_of_order, left ? "selesai" : "belum selesai",
+           ok_a ? "OK" : "GAGAL");
+
+    /* Gelombang B: w2 mati mendadak, route-nya diambil alih */
+    start = now_sec();
+    kill(workers[1], SIGKILL);
+    waitpid(workers[1], &status, 0);
+    int recovered = pump_until(&s, relay2_gone, 5) == 0 && pump_until(&s, settled, 5) == 0;
+    double recover_ms = (s.changed - start) * 1000;
+    for (long seq = BATCH_A; seq < BATCH_A + BATCH_B; seq++) {
+        send_seq(&s, seq);
+        if (seq % BURST == BURST - 1) {
+            WINEIRC_loop_run(s.loop, 0);
+            usleep(PACE_US);
+        }
+    }
+    WINEIRC_loop_run(s.loop, 0);
+    long missing_b, duplicates_b;
+    check_range(&k, BATCH_A, BATCH_A + BATCH_B, 10, &missing_b, &duplicates_b);
+    int ok_b = recovered && missing_b == 0 && duplicates_b == 0;
+    printf("gagal    : w2 di-SIGKILL, route diambil alih dalam %.0f ms; %d pesan berikutnya: %ld hilang, "
+           "%ld ganda -> %s\n", recover_ms, BATCH_B, missing_b, duplicates_b, ok_b ? "OK" : "GAGAL");
+
+    /* Laporan semua proses */
+    kill(workers[2], SIGTERM);
+    kill(workers[3], SIGTERM);
+    waitpid(workers[2], &status, 0);
+    waitpid(workers[3], &status, 0);
+    kill(coord_pid, SIGTERM);
+    waitpid(coord_pid, &status, 0);
+    close(report[1]);
+    Report r;
+    uint64_t queued = 0, dropped = 0, max_queue = 0, forwarded = 0;
+    long failed = 0;
+    while (read(report[0], &r, sizeof(r)) == (ssize_t)sizeof(r)) {
+        if (r.coord) {
+            printf("koord    : epoch %llu, %llu masuk, %llu keluar, %llu gagal, COMMIT terlama %llu ms\n",
+                   (unsigned long long)r.coord_stats.epoch, (unsigned long long)r.coord_stats.joins,
+                   (unsigned long long)r.coord_stats.leaves, (unsigned long long)r.coord_stats.failures,
+                   (unsigned long long)r.coord_stats.max_commit_ms);
+            continue;
+        }
+        printf("  %-6s : %llu dikirim, %llu antre (terlama %llu ms), %llu salinan dibuang, %llu acquire, "
+               "%llu release\n", r.id, (unsigned long long)r.shard.delivered, (unsigned long long)r.shard.queued,
+               (unsigned long long)r.shard.max_queue_ms, (unsigned long long)r.shard.duplicates,
+               (unsigned long long)r.shard.acquired, (unsigned long long)r.shard.released);
+        queued += r.shard.queued;
+        dropped += r.shard.duplicates;
+        forwarded += r.shard.forwarded;
+        failed += r.failed;
+        if (r.shard.max_queue_ms > max_queue)
+            max_queue = r.shard.max_queue_ms;
+    }
+    close(report[0]);
+    printf("handover : %llu pesan sempat antre, terlama %llu ms, %llu salinan dibuang, %llu diteruskan, "
+           "%ld gagal ke Matrix\n", (unsigned long long)queued, (unsigned long long)max_queue,
+           (unsigned long long)dropped, (unsigned long long)forwarded, failed);
+
+    WINEIRC_loop_remove(s.loop, s.gen);
+    WINEIRC_free(s.gen);
+    WINEIRC_loop_free(s.loop);
+    WINEMATRIX_free(k.matrix);
+    free(k.since);
+    free(k.count);
+    mock_ircd_stop(ircd_pid);
+    mock_homeserver_stop(hs_pid);
+    return ok_a && ok_b ? 0 : -1;
+}
+
+int main(void) {
+    WINEB2B_log_level = WINEB2B_LOG_LEVEL_WARN;
+    WINEMATRIX_global_init();
+    int fail = 0;
+    if (run_ring() != 0)
+        fail = 1;
+    if (run_auth() != 0)
+        fail = 1;
+    if (run_cluster() != 0)
+        fail = 1;
+    WINEMATRIX_global_cleanup();
+    return fail;
+}
@@ -0,0 +1,336 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <json-c/json.h>
+#include "matrix_driver.h"
+#include "matrix_sliding.h"
+#include "mock_homeserver.h"
+
+/* Benchmark sliding sync Matrix (source/berry/matrix/matrix_sliding.c).
+
+   Homeserver pengganti diisi akun dengan 5000 room (argumen pertama
+   mengganti jumlahnya), masing-masing 8 anggota lain dan rata-rata 12
+   pesan, lalu:
+   - sliding: WINEMATRIX_sync dengan list default ("active" 20 room
+     teratas timeline 10, "all" tumbuh 500 room per request timeline 1).
+     Dicatat waktu sampai respons pertama (room pertama bisa di-relay),
+     waktu sampai semua room masuk cache state, jumlah request, byte dan
+     kenaikan RSS puncak.
+   - klasik: initial sync /sync tanpa filter seperti listen_and_respond,
+     dengan ukuran yang sama dicatat. Room di respons sliding pertama harus
+     20 room dengan event terakhir paling baru menurut respons klasik.
+   - live: pesan baru di room paling sepi masuk di long-poll berikutnya;
+     long-poll tanpa event kembali kosong setelah timeout.
+   - reset: pos yang tidak dikenal server (M_UNKNOWN_POS) memulai koneksi
+     dari awal tanpa error ke pemanggil. */
+
+#define ROOMS           5000
+#define MEMBERS         8
+#define MESSAGES        12
+#define ACTIVE          20
+#define FIRST_LIMIT_S   1.0     /* Batas waktu respons sliding pertama */
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* --- RSS puncak --- */
+
+static volatile long rss_peak;
+static volatile int sampling = 1;
+static long page_kb;
+
+static long rss_kb(void) {
+    FILE *fp = fopen("/proc/self/statm", "r");
+    long size = 0, resident = 0;
+    if (fp) {
+        if (fscanf(fp, "%ld %ld", &size, &resident) != 2)
+            resident = 0;
+        fclose(fp);
+    }
+    return resident * page_kb;
+}
+
+static void* rss_sampler(void* arg) {
+    (void)arg;
+    while (sampling) {
+        long rss = rss_kb();
+        if (rss > rss_peak)
+            rss_peak = rss;
+        usleep(500);
+    }
+    return NULL;
+}
+
+static long rss_begin(void) {
+    long rss = rss_kb();
+    rss_peak = rss;
+    return rss;
+}
+
+static double rss_delta_mb(long start) {
+    long rss = rss_kb();
+    long peak = rss_peak > rss ? rss_peak : rss;
+    return (peak - start) / 1024.0;
+}
+
+/* --- Respons --- */
+
+static json_object* joined_rooms(json_object* root) {
+    json_object *rooms, *join;
+    if (json_object_object_get_ex(root, "rooms", &rooms) && json_object_object_get_ex(rooms, "join", &join))
+        return join;
+    return NULL;
+}
+
+/* Posisi stream dari event_id homeserver pengganti: "$<posisi><8 hex>:server" */
+static long event_pos(json_object* ev) {
+    json_object *id;
+    if (!json_object_object_get_ex(ev, "event_id", &id))
+        return -1;
+    const char *s = json_object_get_string(id), *colon = strchr(s, ':');
+    if (!colon || colon - s < 10)
+        return -1;
+    char digits[32];
+    snprintf(digits, sizeof(digits), "%.*s", (int)(colon - s - 9), s + 1);
+    return strtol(digits, NULL, 10);
+}
+
+struct bump {
+    long last;
+    const char *room_id;
+};
+
+static int cmp_bump(const void* a, const void* b) {
+    const struct bump *x = a, *y = b;
+    return (x->last < y->last) - (x->last > y->last);
+}
+
+static char first_rooms[ACTIVE * 2][128];
+static int nfirst;
+
+/* 1 jika semua room teratas menurut respons klasik ada di respons sliding pertama */
+static int first_are_most_active(json_object* join) {
+    size_t n = 0, cap = (size_t)json_object_object_length(join);
+    struct bump *bumps = malloc((cap + 1) * sizeof(struct bump));
+    if (!bumps)
+        return 0;
+    struct json_object_iterator it = json_object_iter_begin(join), end = json_object_iter_end(join);
+    for (; !json_object_iter_equal(&it, &end); json_object_iter_next(&it)) {
+        json_object *timeline, *events;
+        if (!json_object_object_get_ex(json_object_iter_peek_value(&it), "timeline", &timeline) ||
+            !json_object_object_get_ex(timeline, "events", &events) || json_object_array_length(events) == 0)
+            continue;
+        json_object *last = json_object_array_get_idx(events, json_object_array_length(events) - 1);
+        bumps[n++] = (struct bump){ event_pos(last), json_object_iter_peek_name(&it) };
+    }
+    qsort(bumps, n, sizeof(struct bump), cmp_bump);
+    int ok = n >= ACTIVE;
+    for (size_t i = 0; i < ACTIVE && i < n && ok; i++) {
+        int found = 0;
+        for (int j = 0; j < nfirst && !found; j++)
+            found = strcmp(first_rooms[j], bumps[i].room_id) == 0;
+        ok = found;
+    }
+    free(bumps);
+    return ok;
+}
+
+/* --- Fase --- */
+
+static char quiet_room[128];
+
+static int run_sliding(WINEMATRIX_handle* h, int rooms) {
+    if (WINEMATRIX_track_state(h) != 0 || WINEMATRIX_use_sliding_sync(h, NULL, 0) != 0)
+        return 1;
+    long rss = rss_begin();
+    double start = now_sec(), first = 0;
+    size_t bytes = 0;
+    int requests = 0, first_count = 0;
+    WINEMATRIX_sliding_stats st;
+    do {
+        char *response = NULL;
+        if (WINEMATRIX_sync(h, NULL, 30000, &response, NULL) != 0) {
+            printf("sliding      : sync gagal -> GAGAL\n");
+            return 1;
+        }
+        bytes += strlen(response);
+        requests++;
+        json_object *root = json_tokener_parse(response), *join = root ? joined_rooms(root) : NULL;
+        if (requests == 1 && join) {
+            first = now_sec() - start;
+            first_count = json_object_object_length(join);
+            struct json_object_iterator it = json_object_iter_begin(join), end = json_object_iter_end(join);
+            for (; !json_object_iter_equal(&it, &end) && nfirst < ACTIVE * 2; json_object_iter_next(&it))
+                snprintf(first_rooms[nfirst++], sizeof(first_rooms[0]), "%s", json_object_iter_peek_name(&it));
+        }
+        json_object_put(root);
+        free(response);
+        WINEMATRIX_sliding_get_stats(h->sliding, &st);
+    } while (!st.complete && requests < 1000);
+    double total = now_sec() - start;
+    double rss_mb = rss_delta_mb(rss);
+
+    WINEMATRIX_state_stats ss;
+    WINEMATRIX_state_get_stats(h->state, &ss);
+    int named = 0;
+    char room_id[128];
+    for (int r = 0; r < rooms; r++) {
+        snprintf(room_id, sizeof(room_id), "!seed%d:localhost", r);
+        char *name = WINEMATRIX_state_get(h->state, room_id, "m.room.name", "");
+        named += name != NULL;
+        free(name);
+    }
+    int ok = first < FIRST_LIMIT_S && first_count >= ACTIVE && (int)st.rooms == rooms &&
+             (int)st.total == rooms && (int)ss.rooms == rooms && named == rooms;
+    printf("sliding      : respons pertama %.0f ms (%d room), %d room lengkap dalam %.0f ms, "
+           "%d request, %.1f MB, RSS +%.1f MB -> %s\n",
+           first * 1e3, first_count, (int)st.rooms, total * 1e3, requests, bytes / 1048576.0, rss_mb,
+           ok ? "OK" : "GAGAL");
+    if (!ok)
+        printf("               state %zu room, %d dengan nama, total %zu\n", ss.rooms, named, st.total);
+    return !ok;
+}
+
+static int run_classic(WINEMATRIX_handle* h, int rooms) {
+    long rss = rss_begin();
+    double start = now_sec();
+    char *response = NULL;
+    if (WINEMATRIX_sync(h, NULL, 0, &response, NULL) != 0) {
+        printf("klasik       : sync gagal -> GAGAL\n");
+        return 1;
+    }
+    double dt = now_sec() - start;
+    double rss_mb = rss_delta_mb(rss);
+    size_t bytes = strlen(response);
+    json_object *root = json_tokener_parse(response), *join = root ? joined_rooms(root) : NULL;
+    free(response);
+    int count = join ? json_object_object_length(join) : 0;
+    int ranked = join && first_are_most_active(join);
+
+    /* Room paling sepi untuk uji live */
+    long quietest = -1;
+    if (join) {
+        struct json_object_iterator it = json_object_iter_begin(join), end = json_object_iter_end(join);
+        for (; !json_object_iter_equal(&it, &end); json_object_iter_next(&it)) {
+            json_object *timeline, *events;
+            if (!json_object_object_get_ex(json_object_iter_peek_value(&it), "timeline", &timeline) ||
+                !json_object_object_get_ex(timeline, "events", &events))
+                continue;
+            long last = event_pos(json_object_array_get_idx(events, json_object_array_length(events) - 1));
+            if (quietest < 0 || last < quietest) {
+                quietest = last;
+                snprintf(quiet_room, sizeof(quiet_room), "%s", json_object_iter_peek_name(&it));
+            }
+        }
+    }
+    json_object_put(root);
+    printf("klasik       : initial sync %d room dalam %.0f ms, %.1f MB, RSS +%.1f MB -> %s\n",
+           count, dt * 1e3, bytes / 1048576.0, rss_mb, count == rooms ? "OK" : "GAGAL");
+    printf("peringkat    : %d room teratas menurut event terakhir ada di respons sliding pertama -> %s\n",
+           ACTIVE, ranked ? "OK" : "GAGAL");
+    return count != rooms || !ranked;
+}
+
+static int run_live(WINEMATRIX_handle* h) {
+    /* Long-poll kosong kembali setelah timeout */
+    char *response = NULL;
+    double start = now_sec();
+    int ret = WINEMATRIX_sync(h, NULL, 300, &response, NULL);
+    double idle = now_sec() - start;
+    json_object *root = response ? json_tokener_parse(response) : NULL, *join = root ? joined_rooms(root) : NULL;
+    int idle_ok = ret == 0 && join && json_object_object_length(join) == 0 && idle >= 0.25;
+    json_object_put(root);
+    free(response);
+
+    if (WINEMATRIX_send_message(h, quiet_room, "halo dari room sepi") != 0)
+        return 1;
+    start = now_sec();
+    ret = WINEMATRIX_sync(h, NULL, 30000, &response, NULL);
+    double dt = now_sec() - start;
+    int live_ok = 0;
+    root = ret == 0 ? json_tokener_parse(response) : NULL;
+    join = root ? joined_rooms(root) : NULL;
+    json_object *room, *timeline, *events;
+    if (join && json_object_object_get_ex(join, quiet_room, &room) &&
+        json_object_object_get_ex(room, "timeline", &timeline) &&
+        json_object_object_get_ex(timeline, "events", &events) && json_object_array_length(events) == 1) {
+        json_object *content, *body;
+        live_ok = json_object_object_get_ex(json_object_array_get_idx(events, 0), "content", &content) &&
+                  json_object_object_get_ex(content, "body", &body) &&
+                  strcmp(json_object_get_string(body), "halo dari room sepi") == 0;
+    }
+    json_object_put(root);
+    free(response);
+    printf("live         : long-poll kosong %.0f ms, pesan di room paling sepi diterima dalam %.1f ms -> %s\n",
+           idle * 1e3, dt * 1e3, idle_ok && live_ok ? "OK" : "GAGAL");
+    return !(idle_ok && live_ok);
+}
+
+static int run_reset(WINEMATRIX_handle* h, WINEMATRIX_handle* other) {
+    /* Token session lain: server tidak mengenal pos milik koneksi ini */
+    char *token = h->access_token;
+    h->access_token = other->access_token;
+    char *response = NULL;
+    int ret = WINEMATRIX_sync(h, NULL, 0, &response, NULL);
+    h->access_token = token;
+    WINEMATRIX_sliding_stats st;
+    WINEMATRIX_sliding_get_stats(h->sliding, &st);
+    json_object *root = response ? json_tokener_parse(response) : NULL, *join = root ? joined_rooms(root) : NULL;
+    int count = join ? json_object_object_length(join) : 0;
+    json_object_put(root);
+    free(response);
+    int ok = ret == 0 && st.resets == 1 && count >= ACTIVE && !st.complete;
+    printf("reset        : M_UNKNOWN_POS -> koneksi baru, %d room di jendela awal -> %s\n", count,
+           ok ? "OK" : "GAGAL");
+    return !ok;
+}
+
+int main(int argc, char** argv) {
+    int rooms = argc > 1 ? atoi(argv[1]) : ROOMS;
+    if (rooms < ACTIVE * 2)
+        rooms = ACTIVE * 2;
+    page_kb = sysconf(_SC_PAGESIZE) / 1024;
+    if (WINEMATRIX_global_init() != 0)
+        return 1;
+
+    mock_homeserver_options opt = {
+        .seed_user = "bench", .seed_rooms = rooms, .seed_members = MEMBERS, .seed_messages = MESSAGES
+    };
+    pid_t pid;
+    int port = mock_homeserver_start(&opt, &pid);
+    if (port < 0)
+        return 1;
+    char homeserver[64];
+    snprintf(homeserver, sizeof(homeserver), "http://127.0.0.1:%d", port);
+    WINEMATRIX_handle *sliding = WINEMATRIX_create(homeserver, "bench", "rahasia");
+    WINEMATRIX_handle *classic = WINEMATRIX_create(homeserver, "bench", "rahasia");
+    printf("akun         : %d room x (%d anggota, ~%d pesan)\n", rooms, MEMBERS + 1, MESSAGES);
+    pthread_t sampler;
+    pthread_create(&sampler, NULL, rss_sampler, NULL);
+
+    /* Sliding lebih dulu agar heap belum dibesarkan initial sync klasik */
+    int failed = !sliding || !classic;
+    if (!failed)
+        failed |= run_sliding(sliding, rooms);
+    if (!failed)
+        failed |= run_classic(classic, rooms);
+    if (!failed)
+        failed |= run_live(sliding);
+    if (!failed)
+        failed |= run_reset(sliding, classic);
+
+    sampling = 0;
+    pthread_join(sampler, NULL);
+    WINEMATRIX_free(sliding);
+    WINEMATRIX_free(classic);
+    if (mock_homeserver_stop(pid) != 0)
+        failed = 1;
+    WINEMATRIX_global_cleanup();
+    return failed;
+}
@@ -0,0 +1,327 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <time.h>
+#include <malloc.h>
+#include <json-c/json.h>
+#include "matrix_driver.h"
+#include "matrix_state.h"
+#include "mock_homeserver.h"
+
+/* Benchmark cache state room Matrix (source/berry/matrix/matrix_state.c).
+
+   - memori: initial sync sintetis 5000 room dengan total 500k keanggotaan
+     (10 room besar, sisanya ~80 anggota), display name, power level,
+     nama room dan pinned events; waktu apply dan byte per keanggotaan
+     dibandingkan dengan pohon json-c dari payload yang sama.
+   - inkremental: sync berikutnya dengan leave, ban, ganti display name,
+     join baru dan room di rooms.leave.
+   - query: membership, display name dan power level acak, harus di bawah
+     satu mikrodetik per query.
+   - pin: WINEMATRIX_pin_message terhadap homeserver pengganti menambah ke
+     daftar pinned yang sudah ada, baik dari cache maupun lewat GET state,
+     termasuk saat room ada di cache tapi pinned events-nya tidak. */
+
+#define ROOMS        5000
+#define BIG_ROOMS    10
+#define BIG_SIZE     10080
+#define SMALL_SIZE   80
+#define USERS        (BIG_ROOMS * BIG_SIZE)
+#define ROOMS_PER_SYNC 50
+#define QUERIES      1000000
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* --- Buffer JSON --- */
+
+struct buf {
+    char *data;
+    size_t len, cap;
+};
+
+static void appendf(struct buf* b, const char* fmt, ...) __attribute__((format(printf, 2, 3)));
+static void appendf(struct buf* b, const char* fmt, ...) {
+    for (;;) {
+        va_list ap;
+        va_start(ap, fmt);
+        int n = vsnprintf(b->data + b->len, b->cap - b->len, fmt, ap);
+        va_end(ap);
+        if (n >= 0 && (size_t)n < b->cap - b->len) {
+            b->len += (size_t)n;
+            return;
+        }
+        b->cap = b->cap ? b->cap * 2 : 1 << 20;
+        b->data = realloc(b->data, b->cap);
+        if (!b->data) {
+            fprintf(stderr, "Error: kehabisan memori\n");
+            exit(1);
+        }
+    }
+}
+
+/* --- Room sintetis --- */
+
+static int room_size(int r) {
+    return r < BIG_ROOMS ? BIG_SIZE : SMALL_SIZE;
+}
+
+/* Anggota ke-k room r; distinct untuk k < room_size(r) */
+static int room_member(int r, int k) {
+    if (r < BIG_ROOMS)
+        return r * BIG_SIZE + k;
+    return (int)(((long)r * 7919 + (long)k * 4729) % USERS);
+}
+
+/* Satu dari sepuluh room memakai display name khusus room */
+static void displayname(int r, int u, char* out, size_t len) {
+    if (r % 10 == 3)
+        snprintf(out, len, "U%d di r%d", u, r);
+    else
+        snprintf(out, len, "User %d", u);
+}
+
+static void member_event(struct buf* b, int r, int u, const char* membership, int first) {
+    char name[64];
+    displayname(r, u, name, sizeof(name));
+    appendf(b, "%s{\"type\":\"m.room.member\",\"state_key\":\"@u%d:example.org\",\"sender\":\"@u%d:example.org\","
+            "\"event_id\":\"$m%d_%d\",\"content\":{\"membership\":\"%s\",\"displayname\":\"%s\","
+            "\"avatar_url\":\"mxc://example.org/a%d\"}}",
+            first ? "" : ",", u, u, r, u, membership, name, u);
+}
+
+static void room_json(struct buf* b, int r) {
+    appendf(b, "\"!r%d:example.org\":{\"state\":{\"events\":[", r);
+    appendf(b, "{\"type\":\"m.room.create\",\"state_key\":\"\",\"sender\":\"@u%d:example.org\",\"event_id\":\"$c%d\","
+            "\"content\":{\"creator\":\"@u%d:example.org\",\"room_version\":\"10\"}}",
+            room_member(r, 0), r, room_member(r, 0));
+    appendf(b, ",{\"type\":\"m.room.name\",\"state_key\":\"\",\"sender\":\"@u%d:example.org\",\"event_id\":\"$n%d\","
+            "\"content\":{\"name\":\"Room %d\"}}", room_member(r, 0), r, r);
+    appendf(b, ",{\"type\":\"m.room.power_levels\",\"state_key\":\"\",\"sender\":\"@u%d:example.org\","
+            "\"event_id\":\"$p%d\",\"content\":{\"users_default\":0,\"events_default\":0,\"state_default\":50,"
+            "\"users\":{\"@u%d:example.org\":100,\"@u%d:example.org\":50}}}",
+            room_member(r, 0), r, room_member(r, 0), room_member(r, 1));
+    appendf(b, ",{\"type\":\"m.room.pinned_events\",\"state_key\":\"\",\"sender\":\"@u%d:example.org\","
+            "\"event_id\":\"$pin%d\",\"content\":{\"pinned\":[\"$x%d:example.org\"]}}", room_member(r, 0), r, r);
+    for (int k = 0; k < room_size(r); k++)
+        member_event(b, r, room_member(r, k), "join", 0);
+    appendf(b, "]},\"timeline\":{\"events\":[],\"limited\":false}}");
+}
+
+static size_t heap_bytes(void) {
+    struct mallinfo2 mi = mallinfo2();
+    return mi.uordblks + mi.hblkhd;
+}
+
+/* --- Memori dan query --- */
+
+static int run_cache(void) {
+    int failed = 0;
+    WINEMATRIX_state *st = WINEMATRIX_state_create();
+    if (!st)
+        return 1;
+    struct buf b = { 0 };
+    double apply = 0, parse = 0;
+    size_t payload = 0, tree = 0, heap = heap_bytes();
+    for (int r0 = 0; r0 < ROOMS; r0 += ROOMS_PER_SYNC) {
+        b.len = 0;
+        appendf(&b, "{\"next_batch\":\"s%d\",\"rooms\":{\"join\":{", r0);
+        for (int r = r0; r < r0 + ROOMS_PER_SYNC; r++) {
+            if (r > r0)
+                appendf(&b, ",");
+            room_json(&b, r);
+        }
+        appendf(&b, "}}}");
+        payload += b.len;
+        double t = now_sec();
+        if (WINEMATRIX_state_apply_sync(st, b.data) < 0)
+            failed = 1;
+        apply += now_sec() - t;
+        /* Pembanding: biaya parse saja dan memori jika pohon json-c disimpan */
+        size_t before = heap_bytes();
+        t = now_sec();
+        json_object *obj = json_tokener_parse(b.data);
+        parse += now_sec() - t;
+        tree += heap_bytes() - before;
+        json_object_put(obj);
+    }
+    heap = heap_bytes() - heap - b.cap;
+    WINEMATRIX_state_stats s;
+    WINEMATRIX_state_get_stats(st, &s);
+    int count_ok = s.rooms == ROOMS && s.members == (size_t)BIG_ROOMS * BIG_SIZE + (size_t)(ROOMS - BIG_ROOMS) * SMALL_SIZE;
+    printf("initial sync : %zu room, %zu keanggotaan, %.1f MB payload, apply %.0f ms (%.0f ms parse json-c) -> %s\n",
+           s.rooms, s.members, payload / 1048576.0, apply * 1e3, parse * 1e3, count_ok ? "OK" : "GAGAL");
+    printf("memori       : %.1f MB cache (%.1f MB heap, %.1f byte/keanggotaan, %zu string unik), pohon json-c %.0f MB\n",
+           s.bytes / 1048576.0, heap / 1048576.0, (double)heap / s.members, s.strings, tree / 1048576.0);
+    failed |= !count_ok;
+
+    /* --- Sync inkremental --- */
+    b.len = 0;
+    int r = 42, leaver = room_member(r, 2), banned = room_member(r, 3), renamed = room_member(r, 4);
+    int newcomer = room_member(0, 5);
+    appendf(&b, "{\"next_batch\":\"s9\",\"rooms\":{\"join\":{\"!r%d:example.org\":{\"timeline\":{\"events\":[", r);
+    appendf(&b, "{\"type\":\"m.room.member\",\"state_key\":\"@u%d:example.org\",\"content\":{\"membership\":\"leave\"}},",
+            leaver);
+    appendf(&b, "{\"type\":\"m.room.member\",\"state_key\":\"@u%d:example.org\",\"content\":{\"membership\":\"ban\"}},",
+            banned);
+    appendf(&b, "{\"type\":\"m.room.member\",\"state_key\":\"@u%d:example.org\","
+            "\"content\":{\"membership\":\"join\",\"displayname\":\"Baru\"}},", renamed);
+    appendf(&b, "{\"type\":\"m.room.message\",\"content\":{\"body\":\"halo\"}},");
+    appendf(&b, "{\"type\":\"m.room.member\",\"state_key\":\"@u%d:example.org\",\"content\":{\"membership\":\"join\"}},",
+            newcomer);
+    appendf(&b, "{\"type\":\"m.room.power_levels\",\"state_key\":\"\",\"content\":{\"users_default\":10,"
+            "\"users\":{\"@u%d:example.org\":75}}}", newcomer);
+    appendf(&b, "]}}},\"leave\":{\"!r7:example.org\":{}}}}");
+    char room[64], user[64];
+    snprintf(room, sizeof(room), "!r%d:example.org", r);
+    size_t joined_before = WINEMATRIX_state_joined_count(st, room);
+    WINEMATRIX_state_apply_sync(st, b.data);
+    snprintf(user, sizeof(user), "@u%d:example.org", leaver);
+    int inc_ok = WINEMATRIX_state_membership(st, room, user) == WINEMATRIX_MEMBERSHIP_NONE;
+    snprintf(user, sizeof(user), "@u%d:example.org", banned);
+    inc_ok &= WINEMATRIX_state_membership(st, room, user) == WINEMATRIX_MEMBERSHIP_BAN;
+    snprintf(user, sizeof(user), "@u%d:example.org", renamed);
+    const char *name = WINEMATRIX_state_displayname(st, room, user);
+    inc_ok &= name && strcmp(name, "Baru") == 0;
+    snprintf(user, sizeof(user), "@u%d:example.org", newcomer);
+    inc_ok &= WINEMATRIX_state_membership(st, room, user) == WINEMATRIX_MEMBERSHIP_JOIN &&
+              WINEMATRIX_state_displayname(st, room, user) == NULL && WINEMATRIX_state_power_level(st, room, user) == 75;
+    snprintf(user, sizeof(user), "@u%d:example.org", room_member(r, 0));
+    inc_ok &= WINEMATRIX_state_power_level(st, room, user) == 10;
+    inc_ok &= WINEMATRIX_state_joined_count(st, room) == joined_before - 1 &&
+              !WINEMATRIX_state_has_room(st, "!r7:example.org");
+    char *pinned = WINEMATRIX_state_get(st, room, "m.room.pinned_events", "");
+    inc_ok &= pinned && strstr(pinned, "$x42:example.org") != NULL;
+    free(pinned);
+    printf("inkremental  : leave, ban, ganti nama, join, power level, rooms.leave -> %s\n", inc_ok ? "OK" : "GAGAL");
+    failed |= !inc_ok;
+
+    /* --- Query --- */
+    struct query {
+        char room[32], user[32], name[48];
+        long level;
+    } *q = malloc(QUERIES * sizeof(struct query));
+    if (!q)
+        return 1;
+    srand(7);
+    for (long i = 0; i < QUERIES; i++) {
+        int qr;
+        do
+            qr = BIG_ROOMS + rand() % (ROOMS - BIG_ROOMS);
+        while (qr == r || qr == 7);
+        int qu = room_member(qr, rand() % SMALL_SIZE);
+        snprintf(q[i].room, sizeof(q[i].room), "!r%d:example.org", qr);
+        snprintf(q[i].user, sizeof(q[i].user), "@u%d:example.org", qu);
+        displayname(qr, qu, q[i].name, sizeof(q[i].name));
+        q[i].level = qu == room_member(qr, 0) ? 100 : qu == room_member(qr, 1) ? 50 : 0;
+    }
+    long wrong = 0;
+    double t = now_sec();
+    for (long i = 0; i < QUERIES; i++) {
+        switch (i % 3) {
+        case 0:
+            wrong += WINEMATRIX_state_membership(st, q[i].room, q[i].user) != WINEMATRIX_MEMBERSHIP_JOIN;
+            break;
+        case 1: {
+            const char *got = WINEMATRIX_state_displayname(st, q[i].room, q[i].user);
+            wrong += !got || strcmp(got, q[i].name) != 0;
+            break;
+        }
+        case 2:
+            wrong += WINEMATRIX_state_power_level(st, q[i].room, q[i].user) != q[i].level;
+            break;
+        }
+    }
+    double per_query = (now_sec() - t) * 1e9 / QUERIES;
+    free(q);
+    int query_ok = wrong == 0 && per_query < 1000;
+    printf("query        : %.0f ns/query (membership, display name, power level), %ld salah -> %s\n", per_query,
+           wrong, query_ok ? "OK" : "GAGAL");
+    failed |= !query_ok;
+
+    free(b.data);
+    WINEMATRIX_state_free(st);
+    return failed;
+}
+
+/* --- Pin terhadap homeserver pengganti --- */
+
+static int pinned_matches(const char* content, const char* const* expect, size_t n) {
+    json_object *obj = content ? json_tokener_parse(content) : NULL, *list;
+    int ok = obj && json_object_object_get_ex(obj, "pinned", &list) && json_object_array_length(list) == n;
+    for (size_t i = 0; ok && i < n; i++)
+        ok = strcmp(json_object_get_string(json_object_array_get_idx(list, i)), expect[i]) == 0;
+    json_object_put(obj);
+    return ok;
+}
+
+static int run_pin(void) {
+    mock_homeserver_options opt = { 0 };
+    pid_t pid;
+    int port = mock_homeserver_start(&opt, &pid);
+    if (port < 0)
+        return 1;
+    char homeserver[64];
+    snprintf(homeserver, sizeof(homeserver), "http://127.0.0.1:%d", port);
+    const char *room = "!pin:localhost";
+    WINEMATRIX_handle *cached = WINEMATRIX_create(homeserver, "bench", "rahasia");
+    WINEMATRIX_handle *plain = WINEMATRIX_create(homeserver, "other", "rahasia");
+    int ok = cached && plain && WINEMATRIX_join_room(cached, room) == 0 && WINEMATRIX_join_room(plain, room) == 0 &&
+             WINEMATRIX_track_state(cached) == 0;
+    char *response = NULL, *next = NULL;
+    /* Initial sync mengisi cache; room sudah ada walau belum punya pinned events */
+    ok = ok && WINEMATRIX_sync(cached, "s0", 0, &response, &next) == 0 && WINEMATRIX_state_has_room(cached->state, room);
+    free(response);
+    const char *ids[] = { "$a:localhost", "$b:localhost", "$c:localhost", "$d:localhost" };
+    /* a dan b lewat cache, c lewat handle tanpa cache (GET state dulu) */
+    ok = ok && WINEMATRIX_pin_message(cached, room, ids[0]) == 0 && WINEMATRIX_pin_message(cached, room, ids[1]) == 0 &&
+         WINEMATRIX_pin_message(cached, room, ids[1]) == 0;
+    char *content = ok ? WINEMATRIX_state_get(cached->state, room, "m.room.pinned_events", "") : NULL;
+    int cache_ok = pinned_matches(content, ids, 2);
+    free(content);
+    ok = ok && WINEMATRIX_pin_message(plain, room, ids[2]) == 0;
+    /* Sync berikutnya membawa event pin dari handle lain ke cache */
+    ok = ok && WINEMATRIX_sync(cached, next, 0, &response, NULL) == 0;
+    free(response);
+    content = ok ? WINEMATRIX_state_get(cached->state, room, "m.room.pinned_events", "") : NULL;
+    int server_ok = pinned_matches(content, ids, 3);
+    free(content);
+    /* Cache mengenal room tapi tidak membawa pinned events (seperti sliding
+       sync tanpa state itu): daftar lama harus diambil lewat GET, bukan dianggap kosong */
+    WINEMATRIX_handle *partial = WINEMATRIX_create(homeserver, "partial", "rahasia");
+    ok = ok && partial && WINEMATRIX_join_room(partial, room) == 0 && WINEMATRIX_track_state(partial) == 0 &&
+         WINEMATRIX_state_apply_event(partial->state, room, "m.room.name", "", "{\"name\":\"pin\"}") == 0 &&
+         WINEMATRIX_pin_message(partial, room, ids[3]) == 0;
+    /* Handle baru membaca daftar di server dari initial sync */
+    WINEMATRIX_handle *reader = WINEMATRIX_create(homeserver, "reader", "rahasia");
+    ok = ok && reader && WINEMATRIX_join_room(reader, room) == 0 && WINEMATRIX_track_state(reader) == 0 &&
+         WINEMATRIX_sync(reader, "s0", 0, &response, NULL) == 0;
+    free(response);
+    content = ok ? WINEMATRIX_state_get(reader->state, room, "m.room.pinned_events", "") : NULL;
+    int partial_ok = pinned_matches(content, ids, 4);
+    free(content);
+    ok = ok && cache_ok && server_ok && partial_ok;
+    printf("pin          : cache %s, tanpa cache (GET state) %s, cache tanpa pinned events %s, daftar akhir 4 event -> %s\n",
+           cache_ok ? "OK" : "GAGAL", server_ok ? "OK" : "GAGAL", partial_ok ? "OK" : "GAGAL", ok ? "OK" : "GAGAL");
+    free(next);
+    WINEMATRIX_free(cached);
+    WINEMATRIX_free(plain);
+    WINEMATRIX_free(partial);
+    WINEMATRIX_free(reader);
+    if (mock_homeserver_stop(pid) != 0)
+        ok = 0;
+    return !ok;
+}
+
+int main(void) {
+    if (WINEMATRIX_global_init() != 0)
+        return 1;
+    int failed = run_cache();
+    failed |= run_pin();
+    WINEMATRIX_global_cleanup();
+    return failed;
+}
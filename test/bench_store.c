@@ -0,0 +1,436 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <curl/curl.h>
+#include <json-c/json.h>
+#include "matrix_driver.h"
+#include "matrix_store.h"
+#include "mock_homeserver.h"
+
+/* Benchmark event store lokal Matrix (source/berry/matrix/matrix_store.c).
+
+   Homeserver pengganti diisi 64 room x 400 pesan yang saling berselang
+   (tiap pesan ke-10 reply, tiap ke-25 edit), lalu:
+   - backfill: initial sync dengan timeline limit 20 meninggalkan celah di
+     awal setiap room; WINEMATRIX_backfill mengisinya dari /messages (latensi
+     tersuntik 10 ms per halaman) dengan parallelism 1 dan 8. Riwayat setiap
+     room harus lengkap dan berurutan sampai m.room.create.
+   - downtime: pesan baru melebihi limit di 16 room, sync berikutnya limited;
+     scrollback berhenti di celah sampai backfill menutupnya.
+   - restart: store dibuka ulang dari disk dengan indeks dan token since yang
+     sama; ekor segmen yang terpotong (crash) dibuang.
+   - query: get per event_id, scrollback 50 event dan relasi edit/reply dari
+     mmap, dibandingkan dengan satu halaman /messages lewat HTTP. */
+
+#define ROOMS          64
+#define MESSAGES       400
+#define SYNC_LIMIT     20
+#define PAGE_LATENCY   10
+#define GAP_ROOMS      16
+#define GAP_MESSAGES   150
+#define SEGMENT        (1 << 20)
+#define QUERIES        1000000
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* --- HTTP langsung ke homeserver pengganti (satu koneksi keep-alive) --- */
+
+struct body {
+    char *data;
+    size_t len;
+};
+
+static size_t collect(void* ptr, size_t size, size_t nmemb, void* user) {
+    struct body *b = user;
+    size_t n = size * nmemb;
+    char *p = realloc(b->data, b->len + n + 1);
+    if (!p)
+        return 0;
+    memcpy(p + b->len, ptr, n);
+    b->data = p;
+    b->len += n;
+    b->data[b->len] = '\0';
+    return n;
+}
+
+static CURL *http;
+
+/* json NULL = GET */
+static char* http_request(const char* method, const char* url, const char* json) {
+    struct body b = { NULL, 0 };
+    curl_easy_setopt(http, CURLOPT_URL, url);
+    if (json) {
+        curl_easy_setopt(http, CURLOPT_POSTFIELDS, json);
+        curl_easy_setopt(http, CURLOPT_CUSTOMREQUEST, method);
+    } else {
+        curl_easy_setopt(http, CURLOPT_HTTPGET, 1L);
+        curl_easy_setopt(http, CURLOPT_CUSTOMREQUEST, NULL);
+    }
+    curl_easy_setopt(http, CURLOPT_WRITEFUNCTION, collect);
+    curl_easy_setopt(http, CURLOPT_WRITEDATA, &b);
+    if (curl_easy_perform(http) != CURLE_OK) {
+        free(b.data);
+        return NULL;
+    }
+    return b.data;
+}
+
+/* Mengirim satu pesan; event_id disalin ke out */
+static int send_event(const WINEMATRIX_handle* h, const char* room, long txn, const char* content,
+                      char* out, size_t size) {
+    char url[512];
+    snprintf(url, sizeof(url), "%s/_matrix/client/r0/rooms/%s/send/m.room.message/b%ld?access_token=%s",
+             h->homeserver, room, txn, h->access_token);
+    char *resp = http_request("PUT", url, content);
+    const char *id = resp ? strstr(resp, "\"event_id\":\"") : NULL;
+    int ok = id != NULL;
+    if (ok) {
+        id += 12;
+        size_t len = strcspn(id, "\"");
+        snprintf(out, size, "%.*s", (int)(len < size ? len : size - 1), id);
+    }
+    free(resp);
+    return ok ? 0 : -1;
+}
+
+/* /sync dengan timeline limit, diterapkan ke store handle */
+static int sync_limited(WINEMATRIX_handle* h, const char* since) {
+    char *filter = curl_easy_escape(http, "{\"room\":{\"timeline\":{\"limit\":20}}}", 0);
+    char url[1024];
+    int len = snprintf(url, sizeof(url), "%s/_matrix/client/r0/sync?access_token=%s&filter=%s",
+                       h->homeserver, h->access_token, filter);
+    if (since)
+        snprintf(url + len, sizeof(url) - (size_t)len, "&since=%s", since);
+    curl_free(filter);
+    char *resp = http_request("GET", url, NULL);
+    int ret = resp ? WINEMATRIX_store_apply_sync(h->store, resp) : -1;
+    free(resp);
+    return ret;
+}
+
+/* --- Store di direktori sementara --- */
+
+static void remove_dir(const char* dir) {
+    DIR *d = opendir(dir);
+    struct dirent *e;
+    char path[512];
+    while (d && (e = readdir(d)) != NULL) {
+        if (e->d_name[0] == '.')
+            continue;
+        snprintf(path, sizeof(path), "%s/%s", dir, e->d_name);
+        unlink(path);
+    }
+    if (d)
+        closedir(d);
+    rmdir(dir);
+}
+
+static int reopen(WINEMATRIX_handle* h, const char* dir) {
+    WINEMATRIX_store_close(h->store);
+    h->store = WINEMATRIX_store_open(dir, SEGMENT);
+    return h->store ? 0 : -1;
+}
+
+/* --- Verifikasi riwayat --- */
+
+static char room_ids[ROOMS][32];
+static const char *room_list[ROOMS];
+static int expected[ROOMS];         /* Pesan yang dikirim per room */
+
+struct walk {
+    int room;
+    int next;                       /* Nomor pesan berikutnya yang diharapkan (menurun) */
+    int create;                     /* m.room.create ditemukan */
+    int bad;
+    char last[128];
+};
+
+static void check_event(const char* json, void* user) {
+    struct walk *w = user;
+    json_object *ev = json_tokener_parse(json), *v, *content;
+    const char *type = ev && json_object_object_get_ex(ev, "type", &v) ? json_object_get_string(v) : "";
+    if (ev && json_object_object_get_ex(ev, "event_id", &v))
+        snprintf(w->last, sizeof(w->last), "%s", json_object_get_string(v));
+    if (strcmp(type, "m.room.message") == 0 && json_object_object_get_ex(ev, "content", &content) &&
+        json_object_object_get_ex(content, "body", &v)) {
+        int room, msg;
+        if (sscanf(json_object_get_string(v), "r%d m%d", &room, &msg) != 2 || room != w->room || msg != w->next ||
+            w->create)
+            w->bad++;
+        w->next--;
+    } else if (strcmp(type, "m.room.create") == 0) {
+        w->create++;
+    }
+    json_object_put(ev);
+}
+
+/* Scrollback seluruh riwayat per halaman 50: urutan menurun tanpa lompatan sampai m.room.create */
+static int history_complete(const WINEMATRIX_store* st, int room) {
+    struct walk w = { room, expected[room] - 1, 0, 0, "" };
+    size_t total = 0, n;
+    do {
+        n = WINEMATRIX_store_messages(st, room_ids[room], total ? w.last : NULL, 50, check_event, &w);
+        total += n;
+    } while (n == 50);
+    return !w.bad && w.create == 1 && w.next == -1 && total == (size_t)expected[room] + 2 &&
+           WINEMATRIX_store_room_gaps(st, room_ids[room]) == 0;
+}
+
+static int all_complete(const WINEMATRIX_store* st) {
+    int complete = 0;
+    for (int r = 0; r < ROOMS; r++)
+        complete += history_complete(st, r);
+    return complete;
+}
+
+static void count_cb(const char* json, void* user) {
+    (void)json;
+    ++*(size_t*)user;
+}
+
+/* --- Skenario --- */
+
+static char event_ids[ROOMS][MESSAGES][64];
+
+static int populate(WINEMATRIX_handle* h) {
+    double t0 = now_sec();
+    long txn = 0;
+    char content[512];
+    for (int m = 0; m < MESSAGES; m++) {
+        for (int r = 0; r < ROOMS; r++) {
+            if (m % 25 == 24)
+                snprintf(content, sizeof(content),
+                         "{\"msgtype\":\"m.text\",\"body\":\"r%d m%d\",\"m.relates_to\":{\"rel_type\":\"m.replace\","
+                         "\"event_id\":\"%s\"}}", r, m, event_ids[r][m - 1]);
+            else if (m % 10 == 9)
+                snprintf(content, sizeof(content),
+                         "{\"msgtype\":\"m.text\",\"body\":\"r%d m%d\",\"m.relates_to\":{\"m.in_reply_to\":"
+                         "{\"event_id\":\"%s\"}}}", r, m, event_ids[r][m - 1]);
+            else
+                snprintf(content, sizeof(content), "{\"msgtype\":\"m.text\",\"body\":\"r%d m%d\"}", r, m);
+            if (send_event(h, room_ids[r], ++txn, content, event_ids[r][m], sizeof(event_ids[r][m])) != 0)
+                return -1;
+            expected[r]++;
+        }
+    }
+    double dt = now_sec() - t0;
+    printf("isi server   : %d room x %d pesan dalam %.1f s\n", ROOMS, MESSAGES, dt);
+    return 0;
+}
+
+/* Initial sync limited lalu backfill; mengembalikan waktu backfill, < 0 jika gagal */
+static double run_backfill(WINEMATRIX_handle* h, const char* dir, unsigned parallelism, int* ok) {
+    remove_dir(dir);
+    h->store = WINEMATRIX_store_open(dir, SEGMENT);
+    if (!h->store || sync_limited(h, NULL) < 0)
+        return -1;
+    WINEMATRIX_store_stats before;
+    WINEMATRIX_store_get_stats(h->store, &before);
+    WINEMATRIX_backfill_config cfg = { .parallelism = parallelism };
+    double t0 = now_sec();
+    long added = WINEMATRIX_backfill(h, room_list, ROOMS, &cfg);
+    double dt = now_sec() - t0;
+    int complete = all_complete(h->store);
+    *ok = added == (long)(ROOMS * (MESSAGES + 2) - before.events) && complete == ROOMS;
+    printf("backfill x%-3u: %ld event dari /messages dalam %.0f ms (%.0f event/s), %d/%d room lengkap -> %s\n",
+           parallelism, added, dt * 1000, added / dt, complete, ROOMS, *ok ? "OK" : "GAGAL");
+    return dt;
+}
+
+static int run_downtime(WINEMATRIX_handle* h) {
+    char *since = strdup(WINEMATRIX_store_since(h->store));
+    long txn = 1000000;
+    char content[128], id[64];
+    for (int m = 0; m < GAP_MESSAGES; m++) {
+        for (int r = 0; r < GAP_ROOMS; r++) {
+            snprintf(content, sizeof(content), "{\"msgtype\":\"m.text\",\"body\":\"r%d m%d\"}", r, expected[r]);
+            if (send_event(h, room_ids[r], ++txn, content, id, sizeof(id)) != 0) {
+                free(since);
+                return 1;
+            }
+            expected[r]++;
+        }
+    }
+    /* Satu room dengan sedikit pesan baru: timeline tidak limited, tidak ada celah */
+    int quiet = GAP_ROOMS;
+    for (int m = 0; m < 5; m++) {
+        snprintf(content, sizeof(content), "{\"msgtype\":\"m.text\",\"body\":\"r%d m%d\"}", quiet, expected[quiet]);
+        send_event(h, room_ids[quiet], ++txn, content, id, sizeof(id));
+        expected[quiet]++;
+    }
+    int added = sync_limited(h, since);
+    free(since);
+    WINEMATRIX_store_stats st;
+    WINEMATRIX_store_get_stats(h->store, &st);
+    size_t visible = 0;
+    WINEMATRIX_store_messages(h->store, room_ids[0], NULL, 1000, count_cb, &visible);
+    int gaps_ok = added == GAP_ROOMS * SYNC_LIMIT + 5 && st.gaps == GAP_ROOMS && visible == SYNC_LIMIT &&
+                  history_complete(h->store, quiet);
+
+    WINEMATRIX_backfill_config cfg = { .parallelism = 8 };
+    long filled = WINEMATRIX_backfill(h, room_list, ROOMS, &cfg);
+    int complete = all_complete(h->store);
+    int ok = gaps_ok && filled == GAP_ROOMS * (GAP_MESSAGES - SYNC_LIMIT) && complete == ROOMS;
+    printf("downtime     : sync limited +%d event, %zu celah, scrollback berhenti di celah (%zu event) %s; "
+           "backfill +%ld, %d/%d room lengkap -> %s\n",
+           added, st.gaps, visible, gaps_ok ? "OK" : "GAGAL", filled, complete, ROOMS, ok ? "OK" : "GAGAL");
+    return !ok;
+}
+
+static int run_restart(WINEMATRIX_handle* h, const char* dir) {
+    WINEMATRIX_store_stats before, after;
+    WINEMATRIX_store_get_stats(h->store, &before);
+    char *since = strdup(WINEMATRIX_store_since(h->store));
+    double t0 = now_sec();
+    int ok = reopen(h, dir) == 0;
+    double dt = now_sec() - t0;
+    WINEMATRIX_store_get_stats(h->store, &after);
+    ok = ok && after.events == before.events && after.gaps == 0 && after.relations == before.relations &&
+         strcmp(WINEMATRIX_store_since(h->store), since) == 0 && all_complete(h->store) == ROOMS;
+    printf("restart      : %zu segmen, %.1f MB, %zu event, %zu relasi dibaca ulang dalam %.0f ms -> %s\n",
+           after.segments, after.bytes / 1e6, after.events, after.relations, dt * 1000, ok ? "OK" : "GAGAL");
+
+    /* Crash di tengah append: sampah di ekor segmen terakhir dibuang saat dibuka */
+    char path[512];
+    snprintf(path, sizeof(path), "%s/%08zu.seg", dir, after.segments - 1);
+    WINEMATRIX_store_close(h->store);
+    h->store = NULL;
+    int fd = open(path, O_WRONLY | O_APPEND);
+    static const char junk[] = "\x40\x00\x00\x00\xde\xad\xbe\xef\x01\x00 torn record";
+    int torn = fd >= 0 && write(fd, junk, sizeof(junk)) == (ssize_t)sizeof(junk);
+    if (fd >= 0)
+        close(fd);
+    torn = torn && reopen(h, dir) == 0;
+    WINEMATRIX_store_get_stats(h->store, &after);
+    torn = torn && after.events == before.events && strcmp(WINEMATRIX_store_since(h->store), since) == 0;
+    /* Record baru setelah pemulihan tetap terbaca setelah dibuka lagi */
+    torn = torn && sync_limited(h, since) >= 0 && reopen(h, dir) == 0;
+    WINEMATRIX_store_get_stats(h->store, &after);
+    torn = torn && after.events == before.events && all_complete(h->store) == ROOMS;
+    printf("crash        : ekor terpotong dibuang, append dan buka ulang -> %s\n", torn ? "OK" : "GAGAL");
+    free(since);
+    return !(ok && torn);
+}
+
+struct relation_check {
+    const char *body;
+    int found;
+};
+
+static void find_body(const char* json, void* user) {
+    struct relation_check *c = user;
+    c->found += strstr(json, c->body) != NULL;
+}
+
+static int run_queries(WINEMATRIX_handle* h) {
+    const WINEMATRIX_store *st = h->store;
+    unsigned rng = 12345;
+    long missing = 0;
+    double t0 = now_sec();
+    for (int i = 0; i < QUERIES; i++) {
+        rng = rng * 1103515245u + 12345u;
+        int r = (int)(rng >> 8) % ROOMS, m = (int)(rng >> 16) % MESSAGES;
+        missing += WINEMATRIX_store_get(st, event_ids[r][m]) == NULL;
+    }
+    double get_ns = (now_sec() - t0) / QUERIES * 1e9;
+
+    size_t returned = 0, seen = 0;
+    int pages = 10000;
+    t0 = now_sec();
+    for (int i = 0; i < pages; i++) {
+        rng = rng * 1103515245u + 12345u;
+        int r = (int)(rng >> 8) % ROOMS, m = 50 + (int)(rng >> 16) % (MESSAGES - 50);
+        returned += WINEMATRIX_store_messages(st, room_ids[r], event_ids[r][m], 50, count_cb, &seen);
+    }
+    double page_us = (now_sec() - t0) / pages * 1e6;
+    int pages_ok = returned == (size_t)pages * 50 && seen == returned;
+
+    /* Edit (m.replace) dan reply (m.in_reply_to) terhadap pesan ke-23 dan ke-8 room 3 */
+    char edit_body[32], reply_body[32];
+    snprintf(edit_body, sizeof(edit_body), "\"r3 m24\"");
+    snprintf(reply_body, sizeof(reply_body), "\"r3 m9\"");
+    struct relation_check edit = { edit_body, 0 }, reply = { reply_body, 0 };
+    size_t nedit = WINEMATRIX_store_relations(st, event_ids[3][23], "m.replace", find_body, &edit);
+    size_t nreply = WINEMATRIX_store_relations(st, event_ids[3][8], "m.in_reply_to", find_body, &reply);
+    size_t none = WINEMATRIX_store_relations(st, event_ids[3][8], "m.replace", count_cb, &seen);
+    int rel_ok = nedit == 1 && edit.found == 1 && nreply == 1 && reply.found == 1 && none == 0;
+
+    /* Halaman yang sama lewat HTTP /messages */
+    char url[512];
+    snprintf(url, sizeof(url), "%s/_matrix/client/r0/rooms/%s/messages?access_token=%s&dir=b&limit=50",
+             h->homeserver, room_ids[0], h->access_token);
+    t0 = now_sec();
+    char *resp = http_request("GET", url, NULL);
+    double http_ms = (now_sec() - t0) * 1000;
+    free(resp);
+
+    int ok = missing == 0 && get_ns < 2000 && pages_ok && page_us < 100 && rel_ok;
+    printf("query        : get %.0f ns, scrollback 50 event %.1f us (HTTP /messages %.1f ms), "
+           "relasi edit/reply %s, %ld hilang -> %s\n",
+           get_ns, page_us, http_ms, rel_ok ? "OK" : "GAGAL", missing, ok ? "OK" : "GAGAL");
+    return !ok;
+}
+
+int main(void) {
+    if (WINEMATRIX_global_init() != 0)
+        return 1;
+    mock_homeserver_options opt = { .messages_latency_ms = PAGE_LATENCY };
+    pid_t pid;
+    int port = mock_homeserver_start(&opt, &pid);
+    if (port < 0)
+        return 1;
+    char homeserver[64];
+    snprintf(homeserver, sizeof(homeserver), "http://127.0.0.1:%d", port);
+    http = curl_easy_init();
+    WINEMATRIX_handle *h = WINEMATRIX_create(homeserver, "bench", "rahasia");
+    int failed = !http || !h;
+    for (int r = 0; r < ROOMS && !failed; r++) {
+        snprintf(room_ids[r], sizeof(room_ids[r]), "!bf%d:localhost", r);
+        room_list[r] = room_ids[r];
+        failed = WINEMATRIX_join_room(h, room_ids[r]) != 0;
+    }
+    failed = failed || populate(h) != 0;
+
+    char serial_dir[] = "/tmp/bench_store_XXXXXX", dir[] = "/tmp/bench_store_XXXXXX";
+    if (!failed && (!mkdtemp(serial_dir) || !mkdtemp(dir)))
+        failed = 1;
+    if (!failed) {
+        int serial_ok = 0, parallel_ok = 0;
+        double serial = run_backfill(h, serial_dir, 1, &serial_ok);
+        WINEMATRIX_store_close(h->store);
+        h->store = NULL;
+        remove_dir(serial_dir);
+        double parallel = run_backfill(h, dir, 8, &parallel_ok);
+        int speedup_ok = serial > 0 && parallel > 0 && serial / parallel >= 3;
+        printf("parallelism  : %.1fx lebih cepat dengan 8 request bersamaan -> %s\n",
+               parallel > 0 ? serial / parallel : 0, speedup_ok ? "OK" : "GAGAL");
+        failed = !serial_ok || !parallel_ok || !speedup_ok;
+    }
+    if (!failed) {
+        failed |= run_downtime(h);
+        failed |= run_restart(h, dir);
+        failed |= run_queries(h);
+    }
+
+    if (h) {
+        WINEMATRIX_store_close(h->store);
+        h->store = NULL;
+        WINEMATRIX_free(h);
+    }
+    remove_dir(dir);
+    if (http)
+        curl_easy_cleanup(http);
+    if (mock_homeserver_stop(pid) != 0)
+        failed = 1;
+    WINEMATRIX_global_cleanup();
+    return failed;
+}
@@ -0,0 +1,323 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <time.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <openssl/evp.h>
+#include <openssl/ssl.h>
+#include <openssl/x509v3.h>
+#include "irc_tls.h"
+
+/* Benchmark transport TLS IRC terhadap server TLS pengganti lokal:
+   - waktu handshake penuh vs resumption dari cache sesi bersama
+   - throughput kirim (MB/s per core CPU klien) untuk TCP biasa,
+     TLS di userspace dan kTLS (jika kernel mendukung).
+   Sertifikat self-signed untuk "localhost" dibuat saat benchmark jalan. */
+
+#define HANDSHAKES   200
+#define STREAM_BYTES (256u << 20)
+#define BATCH        16384
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static double cpu_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int cmp_double(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return x < y ? -1 : x > y;
+}
+
+/* --- Sertifikat self-signed (EC P-256) --- */
+static int make_cert(EVP_PKEY** key_out, X509** cert_out) {
+    EVP_PKEY *key = EVP_EC_gen("P-256");
+    X509 *cert = X509_new();
+    if (!key || !cert)
+        return -1;
+    ASN1_INTEGER_set(X509_get_serialNumber(cert), 1);
+    X509_gmtime_adj(X509_getm_notBefore(cert), -60);
+    X509_gmtime_adj(X509_getm_notAfter(cert), 3600);
+    X509_set_pubkey(cert, key);
+    X509_NAME *name = X509_get_subject_name(cert);
+    X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC, (const unsigned char*)"localhost", -1, -1, 0);
+    X509_set_issuer_name(cert, name);
+    X509V3_CTX v3;
+    X509V3_set_ctx_nodb(&v3);
+    X509V3_set_ctx(&v3, cert, cert, NULL, NULL, 0);
+    X509_EXTENSION *san = X509V3_EXT_conf_nid(NULL, &v3, NID_subject_alt_name, "DNS:localhost,IP:127.0.0.1");
+    X509_EXTENSION *bc = X509V3_EXT_conf_nid(NULL, &v3, NID_basic_constraints, "critical,CA:TRUE");
+    if (!san || !bc)
+        return -1;
+    X509_add_ext(cert, san, -1);
+    X509_add_ext(cert, bc, -1);
+    X509_EXTENSION_free(san);
+    X509_EXTENSION_free(bc);
+    if (!X509_sign(cert, key, EVP_sha256()))
+        return -1;
+    *key_out = key;
+    *cert_out = cert;
+    return 0;
+}
+
+/* --- Server pengganti: sapaan satu baris, lalu membuang semua data ---
+     Byte pertama 0x16 (ClientHello) = TLS, selain itu TCP biasa. */
+static void run_server(int listen_fd, EVP_PKEY* key, X509* cert) {
+    SSL_CTX *ctx = SSL_CTX_new(TLS_server_method());
+    SSL_CTX_use_certificate(ctx, cert);
+    SSL_CTX_use_PrivateKey(ctx, key);
+    SSL_CTX_set_options(ctx, SSL_OP_IGNORE_UNEXPECTED_EOF);
+#ifdef SSL_OP_ENABLE_KTLS
+    SSL_CTX_set_options(ctx, SSL_OP_ENABLE_KTLS);
+#endif
+    static char buf[65536];
+    const char *greeting = ":irc.local NOTICE * :*** bench\r\n";
+    while (1) {
+        int fd = accept(listen_fd, NULL, NULL);
+        if (fd < 0)
+            continue;
+        /* Tanpa ini ticket dan sapaan tertahan Nagle + delayed ACK (~40 ms) */
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        unsigned char first;
+        if (recv(fd, &first, 1, MSG_PEEK) != 1) {
+            close(fd);
+            continue;
+        }
+        if (first == 0x16) {
+            SSL *ssl = SSL_new(ctx);
+            SSL_set_fd(ssl, fd);
+            if (SSL_accept(ssl) == 1) {
+                SSL_write(ssl, greeting, (int)strlen(greeting));
+                while (SSL_read(ssl, buf, sizeof(buf)) > 0)
+                    ;
+                SSL_shutdown(ssl);
+            }
+            SSL_free(ssl);
+        } else {
+            send(fd, greeting, strlen(greeting), MSG_NOSIGNAL);
+            while (recv(fd, buf, sizeof(buf), 0) > 0)
+                ;
+        }
+        close(fd);
+    }
+}
+
+static int tcp_connect(int port) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr = { 0 };
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+        close(fd);
+        return -1;
+    }
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    return fd;
+}
+
+/* Satu koneksi TLS sampai sapaan server terbaca (ticket TLS 1.3 ikut diproses) */
+static WINEIRC_tls* tls_open(int port, const WINEIRC_tls_options* opts, int* fd_out) {
+    int fd = tcp_connect(port);
+    if (fd < 0)
+        return NULL;
+    WINEIRC_tls *tls = WINEIRC_tls_connect(fd, "localhost", port, opts);
+    char line[128];
+    if (!tls || WINEIRC_tls_recv(tls, line, sizeof(line), 0) <= 0) {
+        WINEIRC_tls_close(tls);
+        close(fd);
+        return NULL;
+    }
+    *fd_out = fd;
+    return tls;
+}
+
+static int bench_handshakes(const char* label, int port, const WINEIRC_tls_options* opts, int resume) {
+    static double ms[HANDSHAKES];
+    int resumed = 0;
+    double cpu = cpu_sec();
+    for (int i = 0; i < HANDSHAKES; i++) {
+        if (!resume)
+            WINEIRC_tls_flush_sessions();
+        int fd;
+        double t = now_sec();
+        WINEIRC_tls *tls = tls_open(port, opts, &fd);
+        ms[i] = (now_sec() - t) * 1e3;
+        if (!tls)
+            return -1;
+        resumed += WINEIRC_tls_resumed(tls);
+        WINEIRC_tls_close(tls);
+        close(fd);
+    }
+    cpu = cpu_sec() - cpu;
+    if (resume && resumed < HANDSHAKES - 1) {
+        fprintf(stderr, "Sesi TLS tidak dipakai ulang (%d/%d)\n", resumed, HANDSHAKES);
+        return -1;
+    }
+    qsort(ms, HANDSHAKES, sizeof(double), cmp_double);
+    printf("%-22s %9.3f %9.3f %11.1f %9d/%d\n", label, ms[HANDSHAKES / 2], ms[HANDSHAKES * 99 / 100],
+           cpu * 1e6 / HANDSHAKES, resumed, HANDSHAKES);
+    return 0;
+}
+
+/* Sesi dari handshake tanpa verifikasi (atau dengan CA lain) tidak boleh
+   di-resume oleh handle yang memverifikasi sertifikat */
+static int check_session_isolation(int port, const WINEIRC_tls_options* opts) {
+    /* CA lain: sertifikat baru yang bukan penerbit sertifikat server */
+    EVP_PKEY *other_key;
+    X509 *other_cert;
+    char other_path[] = "/tmp/bench_tls_ca2_XXXXXX";
+    int other_fd = mkstemp(other_path);
+    FILE *other = other_fd >= 0 ? fdopen(other_fd, "w") : NULL;
+    if (!other || make_cert(&other_key, &other_cert) != 0 || !PEM_write_X509(other, other_cert))
+        return -1;
+    fclose(other);
+    X509_free(other_cert);
+    EVP_PKEY_free(other_key);
+
+    WINEIRC_tls_options insecure = { .insecure = 1 };
+    WINEIRC_tls_options other_ca = *opts;
+    other_ca.ca_file = other_path;
+    const WINEIRC_tls_options *order[5] = { &insecure, &insecure, opts, opts, &other_ca };
+    int results[5];
+    WINEIRC_tls_flush_sessions();
+    for (int i = 0; i < 5; i++) {
+        int fd;
+        WINEIRC_tls *tls = tls_open(port, order[i], &fd);
+        results[i] = tls ? WINEIRC_tls_resumed(tls) : -1;
+        if (tls) {
+            WINEIRC_tls_close(tls);
+            close(fd);
+        }
+    }
+    unlink(other_path);
+    /* Tiap mode me-resume sesinya sendiri; CA lain harus handshake penuh dan ditolak */
+    int ok = results[0] == 0 && results[1] == 1 && results[2] == 0 && results[3] == 1 && results[4] == -1;
+    printf("%-22s insecure %d/%d, terverifikasi %d/%d, CA lain %s -> %s\n", "isolasi sesi", results[0], results[1],
+           results[2], results[3], results[4] < 0 ? "ditolak" : "diterima", ok ? "OK" : "GAGAL");
+    return ok ? 0 : -1;
+}
+
+/* Kirim STREAM_BYTES baris PRIVMSG dalam batch 16KB */
+static int bench_stream(const char* label, int port, const WINEIRC_tls_options* opts) {
+    static char batch[BATCH];
+    size_t used = 0;
+    for (int i = 0; used + 128 < sizeof(batch); i++)
+        used += snprintf(batch + used, sizeof(batch) - used,
+                         "PRIVMSG #bench :pesan relay nomor %06d dari bridge matrix ke irc\r\n", i);
+
+    int fd = -1;
+    WINEIRC_tls *tls = NULL;
+    if (opts) {
+        tls = tls_open(port, opts, &fd);
+        if (!tls)
+            return -1;
+    } else {
+        /* Server menunggu byte pertama untuk membedakan TCP biasa dari TLS */
+        fd = tcp_connect(port);
+        char line[128];
+        if (fd < 0 || send(fd, "NICK bench\r\n", 12, 0) != 12 || recv(fd, line, sizeof(line), 0) <= 0)
+            return -1;
+    }
+    int ktls = WINEIRC_tls_ktls_tx(tls);
+    double wall = now_sec(), cpu = cpu_sec();
+    size_t total = 0;
+    while (total < STREAM_BYTES) {
+        ssize_t n = tls ? WINEIRC_tls_send(tls, batch, used) : send(fd, batch, used, MSG_NOSIGNAL);
+        if (n != (ssize_t)used)
+            return -1;
+        total += used;
+    }
+    wall = now_sec() - wall;
+    cpu = cpu_sec() - cpu;
+    WINEIRC_tls_close(tls);
+    close(fd);
+    printf("%-22s %10.1f %14.1f %6s\n", label, total / wall / 1e6, total / cpu / 1e6,
+           tls ? (ktls ? "ya" : "tidak") : "-");
+    return 0;
+}
+
+int main(void) {
+    signal(SIGPIPE, SIG_IGN);
+    EVP_PKEY *key;
+    X509 *cert;
+    if (make_cert(&key, &cert) != 0) {
+        fprintf(stderr, "Gagal membuat sertifikat\n");
+        return 1;
+    }
+    char ca_path[] = "/tmp/bench_tls_ca_XXXXXX";
+    int ca_fd = mkstemp(ca_path);
+    FILE *ca = ca_fd >= 0 ? fdopen(ca_fd, "w") : NULL;
+    if (!ca || !PEM_write_X509(ca, cert)) {
+        fprintf(stderr, "Gagal menulis CA sementara\n");
+        return 1;
+    }
+    fclose(ca);
+
+    int listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr = { 0 };
+    socklen_t addr_len = sizeof(addr);
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(listen_fd, (struct sockaddr*)&addr, sizeof(addr)) != 0 || listen(listen_fd, 64) != 0 ||
+        getsockname(listen_fd, (struct sockaddr*)&addr, &addr_len) != 0) {
+        perror("Gagal membuka server lokal");
+        return 1;
+    }
+    int port = ntohs(addr.sin_port);
+    pid_t pid = fork();
+    if (pid == 0) {
+        run_server(listen_fd, key, cert);
+        _exit(0);
+    }
+    close(listen_fd);
+
+    WINEIRC_tls_options opts = { 0 };
+    opts.ca_file = ca_path;
+    WINEIRC_tls_options no_ktls = opts;
+    no_ktls.no_ktls = 1;
+
+    int rc = 0;
+    printf("Handshake (%d koneksi ke server lokal)\n", HANDSHAKES);
+    printf("%-22s %9s %9s %11s %11s\n", "mode", "p50 ms", "p99 ms", "CPU us/hs", "resumed");
+    if (bench_handshakes("penuh", port, &opts, 0) != 0 ||
+        bench_handshakes("resumption", port, &opts, 1) != 0 ||
+        check_session_isolation(port, &opts) != 0)
+        rc = 1;
+
+    printf("\nThroughput kirim (%u MB baris PRIVMSG, batch %d byte)\n", STREAM_BYTES >> 20, BATCH);
+    printf("%-22s %10s %14s %6s\n", "transport", "MB/s", "MB/s per core", "kTLS");
+    if (rc == 0 && (bench_stream("tcp", port, NULL) != 0 ||
+                    bench_stream("tls (userspace)", port, &no_ktls) != 0 ||
+                    bench_stream("tls (kTLS jika ada)", port, &opts) != 0))
+        rc = 1;
+
+    WINEIRC_tls_stats stats;
+    WINEIRC_tls_get_stats(&stats);
+    printf("\n%lu handshake, %lu resumed, %lu koneksi kTLS tx, %lu kTLS rx\n",
+           stats.handshakes, stats.resumed, stats.ktls_tx, stats.ktls_rx);
+    if (rc != 0)
+        fprintf(stderr, "Benchmark TLS gagal\n");
+
+    kill(pid, SIGTERM);
+    waitpid(pid, NULL, 0);
+    unlink(ca_path);
+    WINEIRC_tls_cleanup();
+    X509_free(cert);
+    EVP_PKEY_free(key);
+    return rc;
+}
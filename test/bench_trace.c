@@ -0,0 +1,400 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <time.h>
+#include <pthread.h>
+#include <json-c/json.h>
+#include "irc_driver.h"
+#include "irc_loop.h"
+#include "matrix_driver.h"
+#include "echo_filter.h"
+#include "trigger.h"
+#include "trace.h"
+#include "mock_ircd.h"
+#include "mock_homeserver.h"
+
+/* Benchmark trace per pesan (source/berry/b2b/trace.c).
+
+   - overhead: biaya titik instrumentasi tanpa tracing, dengan sampling
+     1/100 dan untuk pesan yang ditrace (begin + span + end).
+   - relay: bridge mini IRC -> Matrix terhadap mock IRCd dan homeserver
+     pengganti lokal. Pesan diterima lewat WINEIRC_loop, diperiksa filter
+     echo (WINEIRC_filter_echoes) dan trigger, diteruskan ke thread worker (WINEB2B_trace_adopt)
+     yang mengirim ke Matrix, dan salinannya diantrekan ke channel IRC lain.
+     Hasil ekspor diparse ulang dengan json-c: setiap trace harus memuat
+     semua hop, lalu hanya relay paling lambat (>= p90) yang diekspor. */
+
+#define CALLS       10000000
+#define MESSAGES    200
+#define SAMPLE      4
+#define ROOM        "!bench:localhost"
+#define JOBS        256
+#define PACE_US     3000    /* Jeda antar pesan, mendekati laju worker Matrix */
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* --- Overhead --- */
+
+static double run_overhead(int record) {
+    double start = now_sec();
+    for (long i = 0; i < CALLS; i++) {
+        uint64_t trace = WINEB2B_trace_begin();
+        if (record && trace) {
+            uint64_t t = WINEB2B_trace_now();
+            WINEB2B_trace_span(trace, "bench", "bench.span", t, t + 1000, "detail");
+        }
+        WINEB2B_trace_end();
+    }
+    return (now_sec() - start) * 1e9 / CALLS;
+}
+
+/* --- Relay --- */
+
+typedef struct {
+    char text[128];
+    uint64_t trace;
+    uint64_t queued_ns;
+} Job;
+
+typedef struct {
+    WINEIRC_handle *receiver, *copy;
+    WINEIRC_loop *loop;
+    WINEMATRIX_handle *matrix;
+    WINEB2B_echo_filter *echo;
+    WINEB2B_trigger_set *triggers;
+    int joined;
+    long received;
+    /* Antrean ke thread worker Matrix */
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    Job jobs[JOBS];
+    unsigned head, tail;
+    int stop;
+    long sent, failed;
+} Relay;
+
+static void on_line(WINEIRC_handle* handle, char* line, void* user_data) {
+    Relay *r = user_data;
+    if (strstr(line, " 366 ")) {
+        r->joined++;
+        return;
+    }
+    const char *privmsg = strstr(line, " PRIVMSG ");
+    const char *text = privmsg ? strstr(privmsg, " :") : NULL;
+    if (!text || handle != r->receiver)
+        return;
+    text += 2;
+    r->received++;
+    WINEB2B_trigger_first(r->triggers, text, strlen(text));
+
+    pthread_mutex_lock(&r->lock);
+    Job *job = &r->jobs[r->head++ % JOBS];
+    snprintf(job->text, sizeof(job->text), "%s", text);
+    job->trace = WINEB2B_trace_current;
+    job->queued_ns = job->trace ? WINEB2B_trace_now() : 0;
+    pthread_cond_signal(&r->cond);
+    pthread_mutex_unlock(&r->lock);
+
+    char copy[192];
+    int len = snprintf(copy, sizeof(copy), "PRIVMSG #salinan :%s\r\n", text);
+    WINEIRC_loop_send(r->loop, r->copy, copy, (size_t)len);
+}
+
+static void on_close(WINEIRC_handle* handle, void* user_data) {
+    (void)handle;
+    (void)user_data;
+}
+
+static void* matrix_worker(void* arg) {
+    Relay *r = arg;
+    pthread_setname_np(pthread_self(), "matrix-worker");
+    pthread_mutex_lock(&r->lock);
+    while (!r->stop || r->tail != r->head) {
+        if (r->tail == r->head) {
+            pthread_cond_wait(&r->cond, &r->lock);
+            continue;
+        }
+        Job job = r->jobs[r->tail++ % JOBS];
+        pthread_mutex_unlock(&r->lock);
+        /* Pesan berpindah thread: trace ikut pindah */
+        WINEB2B_trace_adopt(job.trace);
+        if (job.trace)
+            WINEB2B_trace_span(job.trace, "b2b", "b2b.handoff", job.queued_ns, WINEB2B_trace_now(), NULL);
+        int ret = WINEMATRIX_send_message(r->matrix, ROOM, job.text);
+        WINEB2B_trace_end();
+        pthread_mutex_lock(&r->lock);
+        if (ret == 0)
+            r->sent++;
+        else
+            r->failed++;
+    }
+    pthread_mutex_unlock(&r->lock);
+    return NULL;
+}
+
+static int run_until(Relay* r, int* counter, int target, double seconds) {
+    double deadline = now_sec() + seconds;
+    while (*counter < target && now_sec() < deadline)
+        WINEIRC_loop_run(r->loop, 50);
+    return *counter >= target ? 0 : -1;
+}
+
+static int cmp_u64(const void* a, const void* b) {
+    uint64_t x = *(const uint64_t*)a, y = *(const uint64_t*)b;
+    return x < y ? -1 : x > y;
+}
+
+/* Nama span yang wajib ada di setiap trace relay */
+static const char *const hops[] = {
+    "irc.recv", "b2b.echo_check", "b2b.trigger", "irc.dispatch", "b2b.handoff", "matrix.http",
+    "http.connect", "http.wait"
+};
+#define NHOPS (sizeof(hops) / sizeof(hops[0]))
+
+typedef struct {
+    char id[17];
+    unsigned hops;              /* Bit per elemen hops[] */
+    double start, end;          /* Mikrodetik */
+    int threads;
+    uint32_t last_tid;
+} TraceInfo;
+
+/* Memparse ekspor; mengisi info per trace. Mengembalikan jumlah trace, -1 jika JSON rusak */
+static int parse_export(const char* path, TraceInfo* info, int cap, int* flows, int* queue_spans) {
+    FILE *f = fopen(path, "r");
+    if (!f)
+        return -1;
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    char *data = malloc((size_t)size + 1);
+    size_t got = fread(data, 1, (size_t)size, f);
+    fclose(f);
+    data[got] = '\0';
+    json_object *root = json_tokener_parse(data);
+    free(data);
+    json_object *events;
+    if (!root || !json_object_object_get_ex(root, "traceEvents", &events)) {
+        json_object_put(root);
+        return -1;
+    }
+    int n = 0;
+    *flows = *queue_spans = 0;
+    for (size_t i = 0; i < json_object_array_length(events); i++) {
+        json_object *ev = json_object_array_get_idx(events, i);
+        json_object *ph, *name, *args, *trace, *ts, *dur, *tid;
+        if (!json_object_object_get_ex(ev, "ph", &ph))
+            continue;
+        if (strcmp(json_object_get_string(ph), "f") == 0)
+            (*flows)++;
+        if (strcmp(json_object_get_string(ph), "X") != 0 || !json_object_object_get_ex(ev, "name", &name) ||
+            !json_object_object_get_ex(ev, "args", &args) || !json_object_object_get_ex(args, "trace", &trace) ||
+            !json_object_object_get_ex(ev, "ts", &ts) || !json_object_object_get_ex(ev, "dur", &dur) ||
+            !json_object_object_get_ex(ev, "tid", &tid))
+            continue;
+        const char *id = json_object_get_string(trace);
+        int t = 0;
+        while (t < n && strcmp(info[t].id, id) != 0)
+            t++;
+        if (t == n) {
+            if (n == cap)
+                continue;
+            memset(&info[n], 0, sizeof(info[n]));
+            snprintf(info[n].id, sizeof(info[n].id), "%s", id);
+            info[n].start = 1e300;
+            n++;
+        }
+        const char *nm = json_object_get_string(name);
+        for (unsigned h = 0; h < NHOPS; h++)
+            if (strcmp(nm, hops[h]) == 0)
+                info[t].hops |= 1u << h;
+        if (strcmp(nm, "irc.queue") == 0)
+            (*queue_spans)++;
+        double start = json_object_get_double(ts), end = start + json_object_get_double(dur);
+        if (start < info[t].start)
+            info[t].start = start;
+        if (end > info[t].end)
+            info[t].end = end;
+        uint32_t tv = (uint32_t)json_object_get_int64(tid);
+        if (info[t].last_tid != tv) {
+            info[t].threads++;
+            info[t].last_tid = tv;
+        }
+    }
+    json_object_put(root);
+    return n;
+}
+
+static int run_relay(void) {
+    mock_ircd_options iopt = { 0 };
+    mock_homeserver_options mopt = { .latency_ms = 2, .jitter_ms = 2 };
+    pid_t ircd_pid, hs_pid;
+    int irc_port = mock_ircd_start(&iopt, &ircd_pid);
+    int hs_port = mock_homeserver_start(&mopt, &hs_pid);
+    if (irc_port < 0 || hs_port < 0)
+        return -1;
+
+    Relay r;
+    memset(&r, 0, sizeof(r));
+    pthread_mutex_init(&r.lock, NULL);
+    pthread_cond_init(&r.cond, NULL);
+    char homeserver[64];
+    snprintf(homeserver, sizeof(homeserver), "http://127.0.0.1:%d", hs_port);
+    r.matrix = WINEMATRIX_create(homeserver, "bench", "rahasia");
+    if (!r.matrix || WINEMATRIX_join_room(r.matrix, ROOM) != 0)
+        return -1;
+    r.echo = WINEB2B_echo_create("bench-trace", 60000, 1024);
+    WINEB2B_trigger_def defs[] = { { "!relay", 1, 0 }, { "halo", 2, WINEB2B_TRIGGER_NOCASE } };
+    r.triggers = WINEB2B_trigger_compile(defs, 2);
+
+    WINEIRC_loop_callbacks cb = { on_line, on_close };
+    r.loop = WINEIRC_loop_create(WINEIRC_BACKEND_AUTO, &cb, &r);
+    r.receiver = WINEIRC_create("127.0.0.1", irc_port, "penerima", "penerima", "#relay");
+    r.copy = WINEIRC_create("127.0.0.1", irc_port, "penyalin", "penyalin", "#salinan");
+    if (!r.echo || !r.triggers || !r.loop || !r.receiver || !r.copy ||
+        WINEIRC_filter_echoes(r.receiver, r.echo) != 0 ||
+        WINEIRC_loop_add(r.loop, r.receiver) != 0 || WINEIRC_loop_add(r.loop, r.copy) != 0 ||
+        run_until(&r, &r.joined, 2, 5) != 0)
+        return -1;
+    WINEIRC_handle *sender = WINEIRC_create("127.0.0.1", irc_port, "pengirim", "pengirim", "#relay");
+    if (!sender)
+        return -1;
+
+    pthread_t worker;
+    pthread_create(&worker, NULL, matrix_worker, &r);
+    WINEB2B_trace_reset();
+    WINEB2B_trace_set_sampling(SAMPLE);
+    double start = now_sec();
+    for (int i = 0; i < MESSAGES; i++) {
+        char text[64];
+        snprintf(text, sizeof(text), "halo dunia %d", i);
+        WINEIRC_send_message(sender, text);
+        WINEIRC_loop_run(r.loop, 0);
+        usleep(PACE_US);
+    }
+    long target = MESSAGES;
+    double deadline = now_sec() + 10;
+    while (r.received < target && now_sec() < deadline)
+        WINEIRC_loop_run(r.loop, 50);
+    pthread_mutex_lock(&r.lock);
+    r.stop = 1;
+    pthread_cond_signal(&r.cond);
+    pthread_mutex_unlock(&r.lock);
+    pthread_join(worker, NULL);
+    /* Salinan yang masih antre di loop */
+    for (int i = 0; i < 5; i++)
+        WINEIRC_loop_run(r.loop, 10);
+    double elapsed = now_sec() - start;
+    WINEB2B_trace_set_sampling(0);
+
+    WINEB2B_trace_stats stats;
+    WINEB2B_trace_get_stats(&stats);
+    printf("relay    : %ld/%d diterima, %ld ke Matrix (%ld gagal) dalam %.0f ms; %llu trace, %llu span\n",
+           r.received, MESSAGES, r.sent, r.failed, elapsed * 1000, (unsigned long long)stats.traces,
+           (unsigned long long)stats.spans);
+
+    int failed = r.received != MESSAGES || r.sent != MESSAGES;
+    char path[] = "/tmp/bench_trace_XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0)
+        return -1;
+    close(fd);
+    int exported = WINEB2B_trace_export(path, 0);
+    TraceInfo info[MESSAGES];
+    int flows = 0, queue_spans = 0;
+    int parsed = parse_export(path, info, MESSAGES, &flows, &queue_spans);
+    int complete = 0, cross_thread = 0;
+    uint64_t extents[MESSAGES];
+    for (int i = 0; i < parsed; i++) {
+        if (info[i].hops == (1u << NHOPS) - 1)
+            complete++;
+        if (info[i].threads > 1)
+            cross_thread++;
+        extents[i] = (uint64_t)(info[i].end - info[i].start);
+    }
+    int ok = parsed == exported && parsed == (int)stats.traces && complete == parsed && parsed > 0 &&
+             flows >= cross_thread && queue_spans >= parsed / 2;
+    printf("ekspor   : %d trace, %d lengkap (%zu hop), %d lintas thread, %d flow, %d irc.queue -> %s\n",
+           parsed, complete, NHOPS, cross_thread, flows, queue_spans, ok ? "OK" : "GAGAL");
+    if (!ok)
+        failed = 1;
+
+    /* Hanya relay paling lambat */
+    if (parsed > 0) {
+        qsort(extents, (size_t)parsed, sizeof(uint64_t), cmp_u64);
+        uint64_t p90 = extents[(parsed - 1) * 9 / 10];
+        int slow = WINEB2B_trace_export(path, p90);
+        int slow_parsed = parse_export(path, info, MESSAGES, &flows, &queue_spans);
+        double worst = 0;
+        for (int i = 0; i < slow_parsed; i++)
+            if (info[i].end - info[i].start > worst)
+                worst = info[i].end - info[i].start;
+        int slow_ok = slow >= 1 && slow == slow_parsed && slow <= parsed / 5 + 1;
+        printf("lambat   : p50 %.2f ms, p90 %.2f ms; ekspor >= p90: %d trace, terlama %.2f ms -> %s\n",
+               extents[(parsed - 1) / 2] / 1e3, p90 / 1e3, slow, worst / 1e3, slow_ok ? "OK" : "GAGAL");
+        if (!slow_ok)
+            failed = 1;
+    }
+    unlink(path);
+
+    /* Pesan yang dikirim bridge ke IRC lalu dipantulkan kembali harus
+       dibuang oleh loop sebelum sampai ke callback */
+    long before = r.received;
+    WINEIRC_send_message(r.receiver, "gema dari matrix");
+    WINEIRC_send_message(sender, "gema dari matrix");
+    WINEIRC_send_message(sender, "bukan gema");
+    deadline = now_sec() + 5;
+    while (r.received < before + 1 && now_sec() < deadline)
+        WINEIRC_loop_run(r.loop, 50);
+    uint64_t suppressed = WINEB2B_echo_suppressed(r.echo, "irc:127.0.0.1", "#relay");
+    int echo_ok = r.received == before + 1 && suppressed == 1;
+    printf("echo     : %ld diteruskan, %llu dibuang -> %s\n", r.received - before,
+           (unsigned long long)suppressed, echo_ok ? "OK" : "GAGAL");
+    if (!echo_ok)
+        failed = 1;
+
+    WINEIRC_free(sender);
+    WINEIRC_loop_remove(r.loop, r.receiver);
+    WINEIRC_loop_remove(r.loop, r.copy);
+    WINEIRC_free(r.receiver);
+    WINEIRC_free(r.copy);
+    WINEIRC_loop_free(r.loop);
+    WINEMATRIX_free(r.matrix);
+    WINEB2B_echo_free(r.echo);
+    WINEB2B_trigger_free(r.triggers);
+    pthread_mutex_destroy(&r.lock);
+    pthread_cond_destroy(&r.cond);
+    if (mock_ircd_stop(ircd_pid) != 0 || mock_homeserver_stop(hs_pid) != 0)
+        return -1;
+    return failed ? -1 : 0;
+}
+
+int main(void) {
+    signal(SIGPIPE, SIG_IGN);
+    if (WINEIRC_global_init() != 0 || WINEMATRIX_global_init() != 0)
+        return 1;
+
+    printf("%-28s %10s\n", "skenario", "ns/pesan");
+    printf("%-28s %10.1f\n", "tracing mati", run_overhead(1));
+    WINEB2B_trace_set_sampling(100);
+    printf("%-28s %10.1f\n", "sampling 1/100", run_overhead(1));
+    WINEB2B_trace_set_sampling(1);
+    printf("%-28s %10.1f\n", "semua ditrace (1 span)", run_overhead(1));
+    WINEB2B_trace_set_sampling(0);
+    WINEB2B_trace_stats stats;
+    WINEB2B_trace_get_stats(&stats);
+    printf("ring     : %d span per thread, %llu span ditimpa\n", WINEB2B_TRACE_SPANS,
+           (unsigned long long)stats.overwritten);
+
+    int rc = run_relay() == 0 ? 0 : 1;
+    WINEMATRIX_global_cleanup();
+    WINEIRC_global_cleanup();
+    return rc;
+}
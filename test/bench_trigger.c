@@ -0,0 +1,116 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include "trigger.h"
+
+/* Benchmark matcher trigger: automaton Aho-Corasick vs rantai strstr
+   untuk 10/100/1000 pattern di atas korpus pesan chat sintetis. */
+
+#define MESSAGES 20000
+#define ROUNDS   5
+
+static uint64_t rng_state = 0x9e3779b97f4a7c15ULL;
+
+static uint64_t rng(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+static void random_word(char* out, int min_len, int max_len) {
+    int len = min_len + (int)(rng() % (uint64_t)(max_len - min_len + 1));
+    for (int i = 0; i < len; i++)
+        out[i] = (char)('a' + rng() % 26);
+    out[len] = '\0';
+}
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(void) {
+    /* Korpus: pesan 5-25 kata, sebagian menyisipkan salah satu pattern */
+    static char patterns[1000][16];
+    for (int i = 0; i < 1000; i++)
+        random_word(patterns[i], 4, 10);
+
+    char **messages = malloc(MESSAGES * sizeof(char*));
+    size_t *lengths = malloc(MESSAGES * sizeof(size_t));
+    size_t total_bytes = 0;
+    for (int m = 0; m < MESSAGES; m++) {
+        char buf[512] = "";
+        size_t len = 0;
+        int words = 5 + (int)(rng() % 21);
+        for (int w = 0; w < words; w++) {
+            char word[16];
+            if (rng() % 50 == 0)
+                strcpy(word, patterns[rng() % 1000]);
+            else
+                random_word(word, 2, 9);
+            len += snprintf(buf + len, sizeof(buf) - len, "%s%s", w ? " " : "", word);
+        }
+        messages[m] = strdup(buf);
+        lengths[m] = len;
+        total_bytes += len;
+    }
+
+    printf("Korpus: %d pesan, %.2f MB\n", MESSAGES, total_bytes / 1e6);
+    printf("%-9s %-12s %12s %12s %12s %10s\n", "pattern", "metode", "MB/s", "ns/pesan", "match", "state");
+
+    int counts[] = { 10, 100, 1000 };
+    for (int c = 0; c < 3; c++) {
+        int n = counts[c];
+        WINEB2B_trigger_def *defs = malloc(n * sizeof(WINEB2B_trigger_def));
+        for (int i = 0; i < n; i++) {
+            defs[i].pattern = patterns[i];
+            defs[i].id = i;
+            defs[i].flags = WINEB2B_TRIGGER_NOCASE;
+        }
+        double t0 = now_sec();
+        WINEB2B_trigger_set *set = WINEB2B_trigger_compile(defs, n);
+        double build = now_sec() - t0;
+        if (!set) {
+            fprintf(stderr, "Gagal kompilasi trigger\n");
+            return 1;
+        }
+
+        /* Aho-Corasick: satu lintasan per pesan */
+        long ac_matches = 0;
+        t0 = now_sec();
+        for (int r = 0; r < ROUNDS; r++)
+            for (int m = 0; m < MESSAGES; m++)
+                ac_matches += WINEB2B_trigger_scan(set, messages[m], lengths[m], NULL, NULL);
+        double ac = now_sec() - t0;
+
+        /* Rantai strstr seperti listen_and_respond lama */
+        long naive_matches = 0;
+        t0 = now_sec();
+        for (int r = 0; r < ROUNDS; r++)
+            for (int m = 0; m < MESSAGES; m++)
+                for (int i = 0; i < n; i++)
+                    if (strstr(messages[m], patterns[i]))
+                        naive_matches++;
+        double naive = now_sec() - t0;
+
+        double mb = (double)total_bytes * ROUNDS / 1e6;
+        printf("%-9d %-12s %12.1f %12.1f %12ld %10zu\n", n, "aho-corasick",
+               mb / ac, ac * 1e9 / (MESSAGES * ROUNDS), ac_matches / ROUNDS, WINEB2B_trigger_states(set));
+        printf("%-9d %-12s %12.1f %12.1f %12ld %10s\n", n, "strstr",
+               mb / naive, naive * 1e9 / (MESSAGES * ROUNDS), naive_matches / ROUNDS, "-");
+        printf("%-9d %-12s %12.3f ms\n", n, "kompilasi", build * 1e3);
+
+        WINEB2B_trigger_free(set);
+        free(defs);
+    }
+
+    for (int m = 0; m < MESSAGES; m++)
+        free(messages[m]);
+    free(messages);
+    free(lengths);
+    return 0;
+}
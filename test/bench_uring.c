@@ -0,0 +1,296 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <errno.h>
+#include <poll.h>
+#include <time.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include "irc_driver.h"
+#include "irc_loop.h"
+
+/* Benchmark event loop IRC: backend poll() vs io_uring.
+
+   Generator beban (proses terpisah) menerima CONNS koneksi dari
+   WINEIRC_create, lalu mengirim MESSAGES PRIVMSG per koneksi dengan
+   maksimal WINDOW pesan belum dibalas. Bot membalas setiap PRIVMSG lewat
+   WINEIRC_loop_send. Yang diukur hanya proses bot: syscall per pesan
+   (dari statistik loop) dan pesan per detik per core CPU.
+
+   Sebelum beban, keepalive diuji: server yang diam harus menerima PING
+   dan koneksinya dianggap mati setelah interval berikutnya. */
+
+#define CONNS     128
+#define MESSAGES  4000
+#define WINDOW    32
+#define KEEPALIVE_MS 100
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static double cpu_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* --- Generator beban --- */
+
+typedef struct {
+    int fd;
+    int sent, acked, pongs;
+    char in[4096];
+    size_t in_len;
+} GenConn;
+
+static void write_all(int fd, const char* p, size_t len) {
+    while (len > 0) {
+        ssize_t n = send(fd, p, len, MSG_NOSIGNAL);
+        if (n <= 0) {
+            if (n < 0 && errno == EINTR)
+                continue;
+            _exit(3);
+        }
+        p += n;
+        len -= (size_t)n;
+    }
+}
+
+/* Mengirim PRIVMSG hingga jendela penuh dalam satu write */
+static void refill(GenConn* g, int messages) {
+    char buf[WINDOW * 64];
+    size_t len = 0;
+    while (g->sent < messages && g->sent - g->acked < WINDOW) {
+        len += (size_t)snprintf(buf + len, sizeof(buf) - len,
+                                ":gen!g@localhost PRIVMSG #bench :pesan %d\r\n", g->sent);
+        g->sent++;
+    }
+    if (len)
+        write_all(g->fd, buf, len);
+}
+
+static int accept_conns(int lfd, GenConn* gc, int n) {
+    for (int i = 0; i < n; i++) {
+        memset(&gc[i], 0, sizeof(GenConn));
+        gc[i].fd = accept(lfd, NULL, NULL);
+        if (gc[i].fd < 0)
+            return -1;
+    }
+    return 0;
+}
+
+/* Exit 0 jika semua pesan dibalas dan setiap PING server dijawab PONG */
+static void generator_load(int lfd, int conns, int messages) {
+    GenConn *gc = calloc((size_t)conns, sizeof(GenConn));
+    struct pollfd *pfds = calloc((size_t)conns, sizeof(struct pollfd));
+    if (!gc || !pfds || accept_conns(lfd, gc, conns) != 0)
+        _exit(2);
+    for (int i = 0; i < conns; i++) {
+        write_all(gc[i].fd, "PING :gen\r\n", 11);
+        refill(&gc[i], messages);
+        pfds[i].fd = gc[i].fd;
+        pfds[i].events = POLLIN;
+    }
+
+    long total = (long)conns * messages, acked = 0;
+    while (acked < total) {
+        if (poll(pfds, (nfds_t)conns, 10000) <= 0)
+            _exit(4);
+        for (int i = 0; i < conns; i++) {
+            if (!pfds[i].revents)
+                continue;
+            GenConn *g = &gc[i];
+            ssize_t n = recv(g->fd, g->in + g->in_len, sizeof(g->in) - g->in_len, 0);
+            if (n <= 0)
+                _exit(5);
+            g->in_len += (size_t)n;
+            char *start = g->in, *end = g->in + g->in_len, *nl;
+            while ((nl = memchr(start, '\n', (size_t)(end - start))) != NULL) {
+                if (strncmp(start, "PRIVMSG ", 8) == 0) {
+                    g->acked++;
+                    acked++;
+                } else if (strncmp(start, "PONG :gen", 9) == 0) {
+                    g->pongs++;
+                }
+                start = nl + 1;
+            }
+            g->in_len = (size_t)(end - start);
+            memmove(g->in, start, g->in_len);
+            refill(g, messages);
+        }
+    }
+    int ok = 1;
+    for (int i = 0; i < conns; i++) {
+        ok &= gc[i].pongs == 1;
+        close(gc[i].fd);
+    }
+    _exit(ok ? 0 : 6);
+}
+
+/* Server yang tidak pernah menjawab: membaca sampai klien menutup koneksi */
+static void generator_silent(int lfd) {
+    GenConn g;
+    if (accept_conns(lfd, &g, 1) != 0)
+        _exit(2);
+    char buf[512];
+    int pings = 0;
+    ssize_t n;
+    while ((n = recv(g.fd, buf, sizeof(buf) - 1, 0)) > 0) {
+        buf[n] = '\0';
+        if (strstr(buf, "PING "))
+            pings++;
+    }
+    _exit(pings > 0 ? 0 : 6);
+}
+
+static int start_generator(int silent, pid_t* pid) {
+    int lfd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr;
+    socklen_t alen = sizeof(addr);
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (lfd < 0 || bind(lfd, (struct sockaddr*)&addr, sizeof(addr)) != 0 ||
+        listen(lfd, CONNS) != 0 || getsockname(lfd, (struct sockaddr*)&addr, &alen) != 0)
+        return -1;
+    *pid = fork();
+    if (*pid < 0)
+        return -1;
+    if (*pid == 0) {
+        if (silent)
+            generator_silent(lfd);
+        generator_load(lfd, CONNS, MESSAGES);
+    }
+    close(lfd);
+    return ntohs(addr.sin_port);
+}
+
+static int wait_generator(pid_t pid) {
+    int status;
+    if (waitpid(pid, &status, 0) != pid || !WIFEXITED(status))
+        return -1;
+    return WEXITSTATUS(status);
+}
+
+/* --- Bot --- */
+
+typedef struct {
+    WINEIRC_loop *loop;
+    int closed;
+    long received;
+} Bot;
+
+static void on_line(WINEIRC_handle* handle, char* line, void* user_data) {
+    Bot *bot = user_data;
+    if (strstr(line, " PRIVMSG ")) {
+        static const char ack[] = "PRIVMSG #bench :ack\r\n";
+        WINEIRC_loop_send(bot->loop, handle, ack, sizeof(ack) - 1);
+        bot->received++;
+    }
+}
+
+static void on_close(WINEIRC_handle* handle, void* user_data) {
+    Bot *bot = user_data;
+    bot->closed++;
+    WINEIRC_free(handle);
+}
+
+static const char* backend_name(WINEIRC_backend b) {
+    return b == WINEIRC_BACKEND_URING ? "io_uring" : "poll";
+}
+
+static int check_keepalive(WINEIRC_backend backend) {
+    pid_t pid;
+    int port = start_generator(1, &pid);
+    Bot bot = { 0 };
+    WINEIRC_loop_callbacks cb = { on_line, on_close };
+    bot.loop = WINEIRC_loop_create(backend, &cb, &bot);
+    WINEIRC_handle *h = WINEIRC_create("127.0.0.1", port, "diam", "diam", "#bench");
+    if (port < 0 || !bot.loop || !h || WINEIRC_loop_add(bot.loop, h) != 0)
+        return -1;
+    WINEIRC_loop_set_keepalive(bot.loop, KEEPALIVE_MS);
+
+    double start = now_sec();
+    while (!bot.closed && now_sec() - start < 2.0)
+        WINEIRC_loop_run(bot.loop, 50);
+    double elapsed = now_sec() - start;
+    WINEIRC_loop_stats stats;
+    WINEIRC_loop_get_stats(bot.loop, &stats);
+    WINEIRC_loop_free(bot.loop);
+    int gen = wait_generator(pid);
+
+    printf("keepalive %-8s: %lu PING, %lu mati setelah %.0f ms -> %s\n", backend_name(backend),
+           stats.pings, stats.dead, elapsed * 1000,
+           bot.closed && stats.dead == 1 && gen == 0 ? "OK" : "GAGAL");
+    return bot.closed && stats.dead == 1 && gen == 0 ? 0 : -1;
+}
+
+static int run_load(WINEIRC_backend backend) {
+    pid_t pid;
+    int port = start_generator(0, &pid);
+    Bot bot = { 0 };
+    WINEIRC_loop_callbacks cb = { on_line, on_close };
+    bot.loop = WINEIRC_loop_create(backend, &cb, &bot);
+    if (port < 0 || !bot.loop)
+        return -1;
+    WINEIRC_loop_set_keepalive(bot.loop, 0);
+    for (int i = 0; i < CONNS; i++) {
+        char nick[32];
+        snprintf(nick, sizeof(nick), "bot%d", i);
+        WINEIRC_handle *h = WINEIRC_create("127.0.0.1", port, nick, nick, "#bench");
+        if (!h || WINEIRC_loop_add(bot.loop, h) != 0)
+            return -1;
+    }
+
+    double cpu = cpu_sec(), wall = now_sec();
+    while (bot.closed < CONNS) {
+        if (WINEIRC_loop_run(bot.loop, 10000) < 0)
+            break;
+        if (now_sec() - wall > 60)
+            break;
+    }
+    cpu = cpu_sec() - cpu;
+    wall = now_sec() - wall;
+
+    WINEIRC_loop_stats stats;
+    WINEIRC_loop_get_stats(bot.loop, &stats);
+    WINEIRC_loop_free(bot.loop);
+    int gen = wait_generator(pid);
+    long expected = (long)CONNS * MESSAGES;
+    if (gen != 0 || bot.received != expected) {
+        fprintf(stderr, "Beban %s gagal: %ld/%ld pesan, generator %d\n",
+                backend_name(backend), bot.received, expected, gen);
+        return -1;
+    }
+    printf("%-10s %10ld %10.0f %12.0f %12.2f %12.2f\n", backend_name(backend), bot.received,
+           bot.received / wall, bot.received / cpu,
+           (double)stats.syscalls / bot.received, (double)stats.sends / bot.received);
+    return 0;
+}
+
+int main(void) {
+    signal(SIGPIPE, SIG_IGN);
+    WINEIRC_backend backends[2] = { WINEIRC_BACKEND_POLL, WINEIRC_BACKEND_URING };
+    int nbackends = WINEIRC_loop_uring_supported() ? 2 : 1;
+    if (nbackends == 1)
+        printf("io_uring tidak didukung kernel ini; hanya backend poll\n");
+
+    for (int i = 0; i < nbackends; i++)
+        if (check_keepalive(backends[i]) != 0)
+            return 1;
+
+    printf("%d koneksi x %d pesan, jendela %d\n", CONNS, MESSAGES, WINDOW);
+    printf("%-10s %10s %10s %12s %12s %12s\n", "backend", "pesan", "pesan/s", "pesan/s/core",
+           "syscall/psn", "send/psn");
+    for (int i = 0; i < nbackends; i++)
+        if (run_load(backends[i]) != 0)
+            return 1;
+    return 0;
+}
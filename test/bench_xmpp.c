@@ -0,0 +1,297 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include "xmpp_stream.h"
+
+/* Benchmark parser stream XMPP di atas rekaman trafik MUC
+   (test/data/muc_traffic.xml). Data yang sama dimasukkan dengan berbagai
+   ukuran potongan untuk memastikan hasilnya tidak bergantung pada batas
+   recv(), lalu dilaporkan throughput dan alokasi per stanza. Terakhir,
+   peer yang mengirim nama elemen/atribut/namespace unik di setiap stanza
+   tidak boleh menumbuhkan tabel intern melewati batasnya, dan stanza yang
+   terlalu besar atau bersarang terlalu dalam harus ditolak dengan kondisi
+   policy-violation tanpa menghabiskan memori. */
+
+#define ROUNDS 50
+#define UNIQUE_STREAMS  20
+#define UNIQUE_STANZAS  2000
+#define MIXED_PIECES    20000
+
+typedef struct {
+    uint64_t stanzas;
+    uint64_t body_bytes;
+    uint64_t elements;
+} Tally;
+
+static uint64_t rng_state = 0x9e3779b97f4a7c15ULL;
+
+static uint64_t rng(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void count_elements(const WINEXMPP_stanza *s, Tally *t) {
+    for (; s; s = s->next) {
+        t->elements++;
+        count_elements(s->children, t);
+    }
+}
+
+static void on_stanza(void *user, const WINEXMPP_stanza *s) {
+    Tally *t = user;
+    t->stanzas++;
+    const char *body = WINEXMPP_stanza_child_text(s, "body");
+    if (body)
+        t->body_bytes += strlen(body);
+    count_elements(s, t);
+}
+
+static char *load_file(const char *path, size_t *len) {
+    FILE *fp = fopen(path, "rb");
+    if (!fp)
+        return NULL;
+    fseek(fp, 0, SEEK_END);
+    long size = ftell(fp);
+    rewind(fp);
+    char *data = malloc(size);
+    if (data && fread(data, 1, size, fp) != (size_t)size) {
+        free(data);
+        data = NULL;
+    }
+    fclose(fp);
+    *len = (size_t)size;
+    return data;
+}
+
+/* chunk 0 = ukuran acak 1..512 byte */
+static int feed_all(WINEXMPP_parser *p, const char *data, size_t len, size_t chunk) {
+    size_t off = 0;
+    while (off < len) {
+        size_t n = chunk ? chunk : 1 + (size_t)(rng() % 512);
+        if (n > len - off)
+            n = len - off;
+        if (WINEXMPP_parser_feed(p, data + off, n) != 0)
+            return -1;
+        off += n;
+    }
+    return 0;
+}
+
+/* --- Nama unik dari peer --- */
+
+typedef struct {
+    int stream;
+    int index;
+    int wrong;
+} Unique;
+
+static void on_unique(void *user, const WINEXMPP_stanza *s) {
+    Unique *u = user;
+    char name[32], ns[48], child_ns[48], attr[32];
+    snprintf(name, sizeof(name), "x%d_%d", u->stream, u->index);
+    snprintf(ns, sizeof(ns), "urn:unik:%d:%d", u->stream, u->index);
+    snprintf(child_ns, sizeof(child_ns), "urn:stream:%d", u->stream);
+    snprintf(attr, sizeof(attr), "a%d", u->index);
+    const WINEXMPP_stanza *child = s->children;
+    if (strcmp(s->name, name) != 0 || strcmp(s->ns, ns) != 0 || s->attr_count != 1 ||
+        strcmp(s->attrs[0].name, attr) != 0 || !child || strcmp(child->ns, child_ns) != 0)
+        u->wrong++;
+    u->index++;
+}
+
+static int run_unique_names(void) {
+    Unique u = {0};
+    WINEXMPP_parser_callbacks cb = { NULL, on_unique, NULL };
+    WINEXMPP_parser *p = WINEXMPP_parser_create(&cb, &u);
+    if (!p)
+        return 1;
+    WINEXMPP_parser_stats half = {0}, end;
+    char buf[512];
+    int failed = 0;
+    for (int st = 0; st < UNIQUE_STREAMS && !failed; st++) {
+        u.stream = st;
+        u.index = 0;
+        WINEXMPP_parser_reset(p);
+        /* Prefix di <stream:stream> harus tetap bisa dipakai semua stanza */
+        int n = snprintf(buf, sizeof(buf),
+                         "<stream:stream xmlns='jabber:client' xmlns:stream='http://etherx.jabber.org/streams'"
+                         " xmlns:s%d='urn:stream:%d'>", st, st);
+        failed |= WINEXMPP_parser_feed(p, buf, (size_t)n) != 0;
+        for (int i = 0; i < UNIQUE_STANZAS && !failed; i++) {
+            n = snprintf(buf, sizeof(buf), "<p%d:x%d_%d xmlns:p%d='urn:unik:%d:%d' a%d='v'><s%d:y%d/></p%d:x%d_%d>",
+                         i, st, i, i, st, i, i, st, i, i, st, i);
+            failed |= WINEXMPP_parser_feed(p, buf, (size_t)n) != 0;
+        }
+        if (st == UNIQUE_STREAMS / 2 - 1)
+            WINEXMPP_parser_get_stats(p, &half);
+    }
+    WINEXMPP_parser_get_stats(p, &end);
+    uint64_t total = (uint64_t)UNIQUE_STREAMS * UNIQUE_STANZAS;
+    /* Paruh kedua: tabel sudah penuh, nama baru hanya memakai arena yang ada */
+    double late = (double)(end.allocations - half.allocations) / (total / 2);
+    int ok = !failed && u.wrong == 0 && end.stanzas == total && end.interned <= 4096 && late < 0.01;
+    printf("nama unik: %llu stanza, %llu string ter-intern, %d salah, %.4f alokasi/stanza di paruh kedua -> %s\n",
+           (unsigned long long)end.stanzas, (unsigned long long)end.interned, u.wrong, late, ok ? "OK" : "GAGAL");
+    if (failed)
+        fprintf(stderr, "Parse gagal: %s\n", WINEXMPP_parser_error(p));
+    WINEXMPP_parser_free(p);
+    return ok ? 0 : 1;
+}
+
+/* --- Batas stanza --- */
+
+static const char stream_open[] =
+    "<stream:stream xmlns='jabber:client' xmlns:stream='http://etherx.jabber.org/streams'>";
+
+static int feed_str(WINEXMPP_parser *p, const char *xml) {
+    return WINEXMPP_parser_feed(p, xml, strlen(xml));
+}
+
+/* Membuka stream baru; 0 jika stream dan satu stanza biasa diterima */
+static int open_stream(WINEXMPP_parser *p, Tally *t) {
+    WINEXMPP_parser_reset(p);
+    uint64_t before = t->stanzas;
+    if (feed_str(p, stream_open) != 0 || feed_str(p, "<message><body>hai</body></message>") != 0)
+        return -1;
+    return t->stanzas == before + 1 ? 0 : -1;
+}
+
+static int is_condition(WINEXMPP_parser *p, const char *cond) {
+    const char *c = WINEXMPP_parser_condition(p);
+    return c && strcmp(c, cond) == 0;
+}
+
+static int run_limits(void) {
+    Tally t = {0};
+    WINEXMPP_parser_callbacks cb = { NULL, on_stanza, NULL };
+    WINEXMPP_parser *p = WINEXMPP_parser_create(&cb, &t);
+    if (!p || WINEXMPP_parser_set_limits(p, 4096, 8) != 0)
+        return 1;
+    char buf[4096];
+
+    /* Body tanpa akhir dalam potongan 100 byte: ditolak begitu lewat 4 KB */
+    int big = open_stream(p, &t) == 0 && feed_str(p, "<message><body>") == 0;
+    size_t fed = 0;
+    memset(buf, 'a', 100);
+    while (big && fed < 1 << 20 && WINEXMPP_parser_feed(p, buf, 100) == 0)
+        fed += 100;
+    big = big && fed < 4096 && is_condition(p, "policy-violation");
+
+    /* 8 level diterima, 9 level ditolak */
+    int depth = open_stream(p, &t) == 0;
+    for (int levels = 8; depth && levels <= 9; levels++) {
+        size_t n = 0;
+        for (int i = 0; i < levels; i++)
+            n += (size_t)snprintf(buf + n, sizeof(buf) - n, "<e%d>", i);
+        for (int i = levels - 1; i >= 0; i--)
+            n += (size_t)snprintf(buf + n, sizeof(buf) - n, "</e%d>", i);
+        int rc = WINEXMPP_parser_feed(p, buf, n);
+        depth = levels == 8 ? rc == 0 : rc != 0 && is_condition(p, "policy-violation");
+    }
+
+    /* Batas per stanza, bukan per stream; XML rusak tetap not-well-formed */
+    int total = open_stream(p, &t) == 0;
+    for (int i = 0; total && i < 200; i++)
+        total = feed_str(p, "<message><body>stanza kecil di stream yang sama</body></message>") == 0 &&
+                feed_str(p, "<!-- komentar di antara stanza -->") == 0;
+    int broken = open_stream(p, &t) == 0 && feed_str(p, "<a></b>") != 0 && is_condition(p, "not-well-formed");
+
+    /* Teks terpecah komentar: arena harus tumbuh linear, bukan kuadratik */
+    int mixed = open_stream(p, &t) == 0 && WINEXMPP_parser_set_limits(p, 0, 0) == 0 &&
+                feed_str(p, "<message><body>") == 0;
+    WINEXMPP_parser_stats before, after;
+    WINEXMPP_parser_get_stats(p, &before);
+    uint64_t body_before = t.body_bytes;
+    for (int i = 0; mixed && i < MIXED_PIECES; i++)
+        mixed = feed_str(p, "x<!---->") == 0;
+    mixed = mixed && feed_str(p, "</body></message>") == 0;
+    WINEXMPP_parser_get_stats(p, &after);
+    uint64_t allocs = after.allocations - before.allocations;
+    mixed = mixed && t.body_bytes - body_before == MIXED_PIECES && allocs < 64;
+
+    int ok = big && depth && total && broken && mixed;
+    printf("batas stanza: body %zu byte ditolak %s, kedalaman 9 %s, 200 stanza kecil %s, XML rusak %s,"
+           " %d potongan teks %llu alokasi -> %s\n", fed, big ? "ya" : "TIDAK", depth ? "ditolak" : "TIDAK",
+           total ? "diterima" : "DITOLAK", broken ? "not-well-formed" : "SALAH", MIXED_PIECES,
+           (unsigned long long)allocs, ok ? "OK" : "GAGAL");
+    WINEXMPP_parser_free(p);
+    return ok ? 0 : 1;
+}
+
+int main(int argc, char **argv) {
+    const char *path = argc > 1 ? argv[1] : "test/data/muc_traffic.xml";
+    size_t len;
+    char *data = load_file(path, &len);
+    if (!data) {
+        fprintf(stderr, "Gagal membaca %s\n", path);
+        return 1;
+    }
+
+    printf("Rekaman: %s, %.1f KB\n", path, len / 1024.0);
+    printf("%-10s %10s %12s %10s %12s %10s\n", "potongan", "MB/s", "stanza/s", "ns/stanza", "alokasi/st", "elemen");
+
+    size_t chunks[] = { 65536, 1460, 64, 7, 0 };
+    Tally reference = {0};
+    int ok = 1;
+    for (size_t c = 0; c < sizeof(chunks) / sizeof(chunks[0]); c++) {
+        Tally tally = {0};
+        WINEXMPP_parser_callbacks cb = { NULL, on_stanza, NULL };
+        WINEXMPP_parser *p = WINEXMPP_parser_create(&cb, &tally);
+
+        /* Putaran pemanasan: arena, tabel intern dan buffer token terisi */
+        if (feed_all(p, data, len, chunks[c]) != 0) {
+            fprintf(stderr, "Parse gagal: %s\n", WINEXMPP_parser_error(p));
+            return 1;
+        }
+        Tally once = tally;
+        WINEXMPP_parser_stats before, after;
+        WINEXMPP_parser_get_stats(p, &before);
+
+        memset(&tally, 0, sizeof(tally));
+        double t0 = now_sec();
+        for (int r = 0; r < ROUNDS; r++) {
+            WINEXMPP_parser_reset(p);
+            feed_all(p, data, len, chunks[c]);
+        }
+        double elapsed = now_sec() - t0;
+        WINEXMPP_parser_get_stats(p, &after);
+
+        if (c == 0)
+            reference = once;
+        else if (once.stanzas != reference.stanzas || once.body_bytes != reference.body_bytes ||
+                 once.elements != reference.elements)
+            ok = 0;
+
+        char label[24];
+        if (chunks[c])
+            snprintf(label, sizeof(label), "%zu", chunks[c]);
+        else
+            snprintf(label, sizeof(label), "acak");
+        printf("%-10s %10.1f %12.0f %10.1f %12.4f %10llu\n", label,
+               (double)len * ROUNDS / 1e6 / elapsed,
+               tally.stanzas / elapsed,
+               elapsed * 1e9 / tally.stanzas,
+               (double)(after.allocations - before.allocations) / tally.stanzas,
+               (unsigned long long)once.elements);
+        WINEXMPP_parser_free(p);
+    }
+    printf("Stanza per putaran: %llu, byte body: %llu, konsisten antar potongan: %s\n",
+           (unsigned long long)reference.stanzas, (unsigned long long)reference.body_bytes,
+           ok ? "ya" : "TIDAK");
+    free(data);
+    if (run_unique_names() != 0)
+        ok = 0;
+    if (run_limits() != 0)
+        ok = 0;
+    return ok ? 0 : 1;
+}
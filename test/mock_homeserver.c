@@ -0,0 +1,1870 @@
+#define _GNU_SOURCE
+#include "mock_homeserver.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <unistd.h>
+#include <signal.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/sendfile.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <json-c/json.h>
+
+#define HASH_SIZE    4096
+#define MAX_REQUEST  (1 << 20)  /* Header + body satu request */
+#define MAX_SEGS     8
+#define SLIDING_SYNC_PREFIX "org.matrix.simplified_msc3575"
+
+/* --- Peta string -> long --- */
+
+typedef struct Entry {
+    char *key;
+    long value;
+    struct Entry *next;
+} Entry;
+
+typedef struct {
+    Entry *buckets[HASH_SIZE];
+} Map;
+
+typedef struct {
+    char *room_id;
+    char **members;         /* user_id anggota */
+    int nmembers, members_cap;
+    json_object *state;     /* "type\tstate_key" -> event state terakhir */
+    long *timeline;         /* Indeks event room ini, urut stream */
+    long ntimeline, timeline_cap;
+} Room;
+
+typedef struct {
+    int active;             /* Sudah ada request tanpa pos untuk session ini */
+    long *sent;             /* Per room: posisi stream saat terakhir dikirim, 0 = belum pernah */
+    int sent_cap;
+} Sliding;
+
+typedef struct {
+    int fd;
+    char *in;
+    size_t in_len, in_cap;
+    char *out;
+    size_t out_len, out_off, out_cap;
+    int continued;          /* "100 Continue" sudah dikirim untuk request ini */
+    int responding;         /* Respons di out, dikirim setelah ready_ms */
+    long ready_ms;
+    int want_out;
+    int close_after;
+    int dead;
+    int parked;             /* Long-poll /sync menunggu event baru */
+    long park_deadline;
+    long park_since;
+    int park_session;
+    int park_limit;
+    json_object *park_body; /* Request sliding sync yang di-park, NULL untuk /sync biasa */
+    int body_fd;            /* Upload media: body ditulis langsung ke file, -1 jika tidak */
+    size_t body_left;
+    char *body_path;        /* File sementara upload */
+    int file_fd;            /* Download media: file dikirim dengan sendfile setelah header, -1 jika tidak */
+    off_t file_off, file_left;
+} Conn;
+
+typedef struct {
+    char *method;
+    char *path;             /* Sesudah prefiks /_matrix/client/{r0,v3,unstable}/ */
+    char *query;            /* Tanpa '?', "" jika tidak ada */
+    char *token;            /* Bearer, NULL jika tidak ada */
+    char *body;
+    size_t body_len;
+} Request;
+
+typedef struct {
+    mock_homeserver_options opt;
+    const char *name;
+    int epfd, lfd;
+    Conn **by_fd;
+    int by_fd_cap;
+    unsigned rng;
+    char *replay;           /* Payload initial sync, NULL = bangun dari event */
+    size_t replay_len;
+    Map sessions;           /* access_token -> indeks users */
+    char **users;
+    int nusers, users_cap;
+    int as_session;         /* Indeks users milik as_token, -1 jika tidak ada */
+    Map room_index;         /* room_id -> indeks rooms */
+    Room *rooms;
+    int nrooms, rooms_cap;
+    Map txns;               /* user \n room \n txnId -> indeks event */
+    Map event_index;        /* event_id -> indeks event */
+    json_object **events;   /* Posisi stream = indeks + 1 */
+    int *event_room;
+    long nevents, events_cap;
+    char **filters;
+    int nfilters, filters_cap;
+    Sliding *sliding;       /* Per session */
+    int sliding_cap;
+    int nparked;
+    long media_next;        /* ID media berikutnya */
+    unsigned long uploads, downloads;
+    unsigned long long media_in;
+    unsigned long requests, logins, sends, syncs, sliding_syncs, states, redacts, messages, limited, failed, dedup;
+    unsigned long typing, read_markers, presence;
+    unsigned long long bytes_out;
+    json_object *presence_by_user;  /* user_id -> content presence terakhir */
+} Server;
+
+static volatile sig_atomic_t stop_requested;
+
+static void on_sigterm(int sig) {
+    (void)sig;
+    stop_requested = 1;
+}
+
+static long now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000L + ts.tv_nsec / 1000000;
+}
+
+static long wall_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return ts.tv_sec * 1000L + ts.tv_nsec / 1000000;
+}
+
+static unsigned next_rand(Server* s) {
+    unsigned x = s->rng;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return s->rng = x;
+}
+
+static unsigned hash_str(const char* k) {
+    unsigned h = 2166136261u;
+    for (; *k; k++)
+        h = (h ^ (unsigned char)*k) * 16777619u;
+    return h & (HASH_SIZE - 1);
+}
+
+static long map_get(const Map* m, const char* key) {
+    for (const Entry *e = m->buckets[hash_str(key)]; e; e = e->next)
+        if (strcmp(e->key, key) == 0)
+            return e->value;
+    return -1;
+}
+
+static int map_put(Map* m, const char* key, long value) {
+    Entry *e = malloc(sizeof(Entry));
+    if (!e || !(e->key = strdup(key))) {
+        free(e);
+        return -1;
+    }
+    unsigned h = hash_str(key);
+    e->value = value;
+    e->next = m->buckets[h];
+    m->buckets[h] = e;
+    return 0;
+}
+
+static void map_clear(Map* m) {
+    for (int h = 0; h < HASH_SIZE; h++) {
+        for (Entry *e = m->buckets[h], *next; e; e = next) {
+            next = e->next;
+            free(e->key);
+            free(e);
+        }
+        m->buckets[h] = NULL;
+    }
+}
+
+static int push_ptr(void*** arr, int* n, int* cap, void* p) {
+    if (*n == *cap) {
+        int ncap = *cap ? *cap * 2 : 16;
+        void **a = realloc(*arr, (size_t)ncap * sizeof(void*));
+        if (!a)
+            return -1;
+        *arr = a;
+        *cap = ncap;
+    }
+    (*arr)[(*n)++] = p;
+    return 0;
+}
+
+/* Decode %XX dan '+' di tempat */
+static void url_decode(char* s) {
+    char *out = s;
+    for (; *s; s++) {
+        if (*s == '%' && isxdigit((unsigned char)s[1]) && isxdigit((unsigned char)s[2])) {
+            char hex[3] = { s[1], s[2], 0 };
+            *out++ = (char)strtol(hex, NULL, 16);
+            s += 2;
+        } else {
+            *out++ = *s == '+' ? ' ' : *s;
+        }
+    }
+    *out = '\0';
+}
+
+/* Mengambil parameter query (sudah di-decode). 1 jika ada */
+static int query_param(const char* query, const char* name, char* out, size_t size) {
+    size_t nlen = strlen(name);
+    for (const char *p = query; p && *p; ) {
+        const char *end = strchr(p, '&');
+        size_t len = end ? (size_t)(end - p) : strlen(p);
+        if (len > nlen && strncmp(p, name, nlen) == 0 && p[nlen] == '=') {
+            size_t vlen = len - nlen - 1;
+            if (vlen >= size)
+                vlen = size - 1;
+            memcpy(out, p + nlen + 1, vlen);
+            out[vlen] = '\0';
+            url_decode(out);
+            return 1;
+        }
+        p = end ? end + 1 : NULL;
+    }
+    return 0;
+}
+
+/* --- Output --- */
+
+static void append_out(Conn* c, const char* data, size_t len) {
+    if (c->out_len + len > c->out_cap) {
+        size_t cap = c->out_cap ? c->out_cap : 4096;
+        while (cap < c->out_len + len)
+            cap *= 2;
+        char *p = realloc(c->out, cap);
+        if (!p) {
+            c->dead = 1;
+            return;
+        }
+        c->out = p;
+        c->out_cap = cap;
+    }
+    memcpy(c->out + c->out_len, data, len);
+    c->out_len += len;
+}
+
+static void update_events(Server* s, Conn* c, int want_out) {
+    if (c->want_out == want_out)
+        return;
+    struct epoll_event ev = { .events = EPOLLIN | (want_out ? EPOLLOUT : 0), .data.fd = c->fd };
+    epoll_ctl(s->epfd, EPOLL_CTL_MOD, c->fd, &ev);
+    c->want_out = want_out;
+}
+
+static void process_input(Server* s, Conn* c);
+
+static void flush_conn(Server* s, Conn* c) {
+    while (!c->dead && c->out_off < c->out_len) {
+        ssize_t n = send(c->fd, c->out + c->out_off, c->out_len - c->out_off, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                update_events(s, c, 1);
+                return;
+            }
+            c->dead = 1;
+            return;
+        }
+        c->out_off += (size_t)n;
+        s->bytes_out += (unsigned long long)n;
+    }
+    c->out_len = c->out_off = 0;
+    while (!c->dead && c->file_fd >= 0 && c->file_left > 0) {
+        ssize_t n = sendfile(c->fd, c->file_fd, &c->file_off, (size_t)c->file_left);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            update_events(s, c, 1);
+            return;
+        }
+        if (n <= 0) {
+            c->dead = 1;
+            return;
+        }
+        c->file_left -= n;
+        s->bytes_out += (unsigned long long)n;
+    }
+    if (c->file_fd >= 0) {
+        close(c->file_fd);
+        c->file_fd = -1;
+    }
+    update_events(s, c, 0);
+    if (!c->responding)
+        return;
+    c->responding = 0;
+    if (c->close_after)
+        c->dead = 1;
+    else
+        process_input(s, c);    /* Request berikutnya yang sudah diterima */
+}
+
+static const char* status_text(int status) {
+    switch (status) {
+    case 200: return "OK";
+    case 400: return "Bad Request";
+    case 401: return "Unauthorized";
+    case 403: return "Forbidden";
+    case 404: return "Not Found";
+    case 411: return "Length Required";
+    case 413: return "Payload Too Large";
+    case 429: return "Too Many Requests";
+    default:  return "Internal Server Error";
+    }
+}
+
+static void append_head(Conn* c, int status, const char* content_type, size_t len) {
+    char head[256];
+    int hlen = snprintf(head, sizeof(head), "HTTP/1.1 %d %s\r\nContent-Type: %s\r\nContent-Length: %zu\r\n%s\r\n",
+                        status, status_text(status), content_type, len,
+                        c->close_after ? "Connection: close\r\n" : "");
+    append_out(c, head, (size_t)hlen);
+}
+
+/* Respons di out dikirim setelah latensi tersuntik (ditambah extra_ms) berlalu */
+static void schedule_response(Server* s, Conn* c, long extra_ms) {
+    c->responding = 1;
+    long delay = s->opt.latency_ms + extra_ms;
+    if (s->opt.jitter_ms > 0)
+        delay += (long)(next_rand(s) % (unsigned)(2 * s->opt.jitter_ms + 1)) - s->opt.jitter_ms;
+    c->ready_ms = delay > 0 ? now_ms() + delay : 0;
+    if (!c->ready_ms)
+        flush_conn(s, c);
+}
+
+static void respond_after(Server* s, Conn* c, int status, const char* body, size_t len, long extra_ms) {
+    append_head(c, status, "application/json", len);
+    append_out(c, body, len);
+    schedule_response(s, c, extra_ms);
+}
+
+static void respond(Server* s, Conn* c, int status, const char* body, size_t len) {
+    respond_after(s, c, status, body, len, 0);
+}
+
+static void respond_json(Server* s, Conn* c, int status, json_object* obj) {
+    size_t len;
+    const char *body = json_object_to_json_string_length(obj, JSON_C_TO_STRING_PLAIN, &len);
+    respond(s, c, status, body, len);
+    json_object_put(obj);
+}
+
+static void respond_error(Server* s, Conn* c, int status, const char* errcode, const char* error) {
+    char body[256];
+    int len = snprintf(body, sizeof(body), "{\"errcode\":\"%s\",\"error\":\"%s\"}", errcode, error);
+    respond(s, c, status, body, (size_t)len);
+}
+
+static void respond_event_id(Server* s, Conn* c, long idx) {
+    json_object *id;
+    json_object_object_get_ex(s->events[idx], "event_id", &id);
+    json_object *obj = json_object_new_object();
+    json_object_object_add(obj, "event_id", json_object_get(id));
+    respond_json(s, c, 200, obj);
+}
+
+/* --- Room dan event --- */
+
+static Room* find_room(Server* s, const char* room_id, int create) {
+    long idx = map_get(&s->room_index, room_id);
+    if (idx >= 0)
+        return &s->rooms[idx];
+    if (!create)
+        return NULL;
+    if (s->nrooms == s->rooms_cap) {
+        int cap = s->rooms_cap ? s->rooms_cap * 2 : 16;
+        Room *r = realloc(s->rooms, (size_t)cap * sizeof(Room));
+        if (!r)
+            return NULL;
+        s->rooms = r;
+        s->rooms_cap = cap;
+    }
+    Room *room = &s->rooms[s->nrooms];
+    memset(room, 0, sizeof(Room));
+    room->room_id = strdup(room_id);
+    room->state = json_object_new_object();
+    if (!room->room_id || map_put(&s->room_index, room_id, s->nrooms) != 0)
+        return NULL;
+    s->nrooms++;
+    return room;
+}
+
+static int is_member(const Room* room, const char* user_id) {
+    for (int i = 0; i < room->nmembers; i++)
+        if (strcmp(room->members[i], user_id) == 0)
+            return 1;
+    return 0;
+}
+
+static int room_has_events(const Server* s, int session, long since) {
+    const char *user = s->users[session];
+    for (long i = since; i < s->nevents; i++)
+        if (is_member(&s->rooms[s->event_room[i]], user))
+            return 1;
+    return 0;
+}
+
+static void respond_sync(Server* s, Conn* c, int session, long since, int limit);
+static void respond_sliding(Server* s, Conn* c, int session, json_object* body);
+
+/* Menjawab long-poll yang di-park (event baru atau habis waktu) */
+static void respond_parked(Server* s, Conn* c) {
+    c->parked = 0;
+    s->nparked--;
+    if (c->park_body) {
+        json_object *body = c->park_body;
+        c->park_body = NULL;
+        respond_sliding(s, c, c->park_session, body);
+        json_object_put(body);
+    } else {
+        respond_sync(s, c, c->park_session, c->park_since, c->park_limit);
+    }
+}
+
+/* Membangunkan long-poll yang menunggu event di room anggota */
+static void wake_parked(Server* s) {
+    for (int fd = 0; fd < s->by_fd_cap && s->nparked > 0; fd++) {
+        Conn *c = s->by_fd[fd];
+        if (!c || c->dead || !c->parked || !room_has_events(s, c->park_session, c->park_since))
+            continue;
+        respond_parked(s, c);
+    }
+}
+
+/* Menambah event ke stream. content diambil alih. Mengembalikan indeks */
+static long append_event(Server* s, Room* room, const char* sender, const char* type,
+                         const char* state_key, json_object* content) {
+    if (s->nevents == s->events_cap) {
+        long cap = s->events_cap ? s->events_cap * 2 : 1024;
+        json_object **e = realloc(s->events, (size_t)cap * sizeof(json_object*));
+        if (!e)
+            return -1;
+        s->events = e;
+        int *r = realloc(s->event_room, (size_t)cap * sizeof(int));
+        if (!r)
+            return -1;
+        s->event_room = r;
+        s->events_cap = cap;
+    }
+    char event_id[128];
+    snprintf(event_id, sizeof(event_id), "$%ld%08x:%s", s->nevents + 1, next_rand(s), s->name);
+    json_object *ev = json_object_new_object();
+    json_object_object_add(ev, "type", json_object_new_string(type));
+    json_object_object_add(ev, "room_id", json_object_new_string(room->room_id));
+    json_object_object_add(ev, "sender", json_object_new_string(sender));
+    json_object_object_add(ev, "event_id", json_object_new_string(event_id));
+    json_object_object_add(ev, "origin_server_ts", json_object_new_int64(wall_ms()));
+    if (state_key) {
+        char key[512];
+        snprintf(key, sizeof(key), "%s\t%s", type, state_key);
+        json_object_object_add(ev, "state_key", json_object_new_string(state_key));
+        json_object_object_add(room->state, key, json_object_get(ev));
+    }
+    json_object_object_add(ev, "content", content);
+
+    if (room->ntimeline == room->timeline_cap) {
+        long cap = room->timeline_cap ? room->timeline_cap * 2 : 16;
+        long *t = realloc(room->timeline, (size_t)cap * sizeof(long));
+        if (!t)
+            return -1;
+        room->timeline = t;
+        room->timeline_cap = cap;
+    }
+    long idx = s->nevents++;
+    s->events[idx] = ev;
+    s->event_room[idx] = (int)(room - s->rooms);
+    room->timeline[room->ntimeline++] = idx;
+    map_put(&s->event_index, event_id, idx);
+    wake_parked(s);
+    return idx;
+}
+
+static void join_member(Server* s, Room* room, const char* user_id) {
+    if (is_member(room, user_id))
+        return;
+    char *copy = strdup(user_id);
+    if (!copy || push_ptr((void***)&room->members, &room->nmembers, &room->members_cap, copy) != 0) {
+        free(copy);
+        return;
+    }
+    json_object *content = json_object_new_object();
+    json_object_object_add(content, "membership", json_object_new_string("join"));
+    append_event(s, room, user_id, "m.room.member", user_id, content);
+}
+
+/* --- /sync --- */
+
+static json_object* empty_events(void) {
+    json_object *obj = json_object_new_object();
+    json_object_object_add(obj, "events", json_object_new_array());
+    return obj;
+}
+
+/* Event sejak posisi since di room tempat user menjadi anggota, dikelompokkan per room */
+static void respond_sync(Server* s, Conn* c, int session, long since, int limit) {
+    const char *user = s->users[session];
+    json_object **timelines = calloc((size_t)s->nrooms + 1, sizeof(json_object*));
+    if (!timelines) {
+        respond_error(s, c, 500, "M_UNKNOWN", "Out of memory");
+        return;
+    }
+    json_object *join = json_object_new_object();
+    for (long i = since; i < s->nevents; i++) {
+        int r = s->event_room[i];
+        if (!is_member(&s->rooms[r], user))
+            continue;
+        if (!timelines[r])
+            timelines[r] = json_object_new_array();
+        json_object_array_add(timelines[r], json_object_get(s->events[i]));
+    }
+    for (int r = 0; r < s->nrooms; r++) {
+        if (!timelines[r])
+            continue;
+        size_t count = json_object_array_length(timelines[r]);
+        int limited = limit > 0 && count > (size_t)limit;
+        if (limited)
+            json_object_array_del_idx(timelines[r], 0, count - (size_t)limit);
+        /* prev_batch = posisi stream event pertama yang dikirim di room ini */
+        long first = since;
+        for (long i = s->nevents - 1, seen = 0; limited && i >= since; i--)
+            if (s->event_room[i] == r && ++seen == limit)
+                first = i;
+        char prev[32];
+        snprintf(prev, sizeof(prev), "s%ld", first);
+        json_object *timeline = json_object_new_object();
+        json_object_object_add(timeline, "events", timelines[r]);
+        json_object_object_add(timeline, "limited", json_object_new_boolean(limited));
+        json_object_object_add(timeline, "prev_batch", json_object_new_string(prev));
+        json_object *room = json_object_new_object();
+        json_object_object_add(room, "timeline", timeline);
+        json_object_object_add(room, "state", empty_events());
+        json_object_object_add(room, "ephemeral", empty_events());
+        json_object_object_add(room, "account_data", empty_events());
+        json_object_object_add(join, s->rooms[r].room_id, room);
+    }
+    free(timelines);
+
+    char next[32];
+    snprintf(next, sizeof(next), "s%ld", s->nevents);
+    json_object *rooms = json_object_new_object();
+    json_object_object_add(rooms, "join", join);
+    json_object *obj = json_object_new_object();
+    json_object_object_add(obj, "next_batch", json_object_new_string(next));
+    json_object_object_add(obj, "rooms", rooms);
+    json_object_object_add(obj, "presence", empty_events());
+    json_object_object_add(obj, "account_data", empty_events());
+    respond_json(s, c, 200, obj);
+}
+
+/* room.timeline.limit dari filter inline atau filter_id tersimpan */
+static int filter_limit(const Server* s, const char* filter) {
+    if (!*filter)
+        return 0;
+    const char *text = filter;
+    if (*filter != '{') {
+        char *end;
+        long id = strtol(filter, &end, 10);
+        if (*end || id < 0 || id >= s->nfilters)
+            return -1;
+        text = s->filters[id];
+    }
+    json_object *obj = json_tokener_parse(text), *room, *timeline, *limit;
+    if (!obj)
+        return -1;
+    int value = 0;
+    if (json_object_object_get_ex(obj, "room", &room) &&
+        json_object_object_get_ex(room, "timeline", &timeline) &&
+        json_object_object_get_ex(timeline, "limit", &limit))
+        value = json_object_get_int(limit);
+    json_object_put(obj);
+    return value;
+}
+
+static void handle_sync(Server* s, Conn* c, int session, const char* query) {
+    char since[32] = "", timeout[16] = "0", filter[1024] = "";
+    query_param(query, "since", since, sizeof(since));
+    query_param(query, "timeout", timeout, sizeof(timeout));
+    query_param(query, "filter", filter, sizeof(filter));
+    int limit = filter_limit(s, filter);
+    if (limit < 0) {
+        respond_error(s, c, 400, "M_INVALID_PARAM", "Invalid filter");
+        return;
+    }
+    s->syncs++;
+
+    if (!*since) {
+        if (s->replay)
+            respond(s, c, 200, s->replay, s->replay_len);
+        else
+            respond_sync(s, c, session, 0, limit);
+        return;
+    }
+    char *end;
+    long pos = since[0] == 's' ? strtol(since + 1, &end, 10) : -1;
+    if (pos < 0 || pos > s->nevents || *end) {
+        respond_error(s, c, 400, "M_INVALID_PARAM", "Invalid since token");
+        return;
+    }
+    long wait = strtol(timeout, NULL, 10);
+    if (wait > 0 && !room_has_events(s, session, pos)) {
+        c->parked = 1;
+        c->park_deadline = now_ms() + wait;
+        c->park_since = pos;
+        c->park_session = session;
+        c->park_limit = limit;
+        s->nparked++;
+        return;
+    }
+    respond_sync(s, c, session, pos, limit);
+}
+
+/* --- Sliding sync (MSC4186, org.matrix.simplified_msc3575) --- */
+
+typedef struct {
+    long last;              /* Indeks event terakhir room (bump) */
+    int room;
+} Bump;
+
+static int cmp_bump(const void* a, const void* b) {
+    const Bump *x = a, *y = b;
+    return (x->last < y->last) - (x->last > y->last);
+}
+
+/* Cocok dengan salah satu pasangan [type, state_key] di required_state.
+   "*" cocok dengan apa saja, "$LAZY" hanya member pengirim event timeline,
+   "$ME" member user sendiri */
+static int state_wanted(json_object* required, const char* type, const char* key, const char* user,
+                        json_object* senders) {
+    size_t n = required ? json_object_array_length(required) : 0;
+    for (size_t i = 0; i < n; i++) {
+        json_object *pair = json_object_array_get_idx(required, i);
+        if (!json_object_is_type(pair, json_type_array) || json_object_array_length(pair) != 2)
+            continue;
+        const char *want_type = json_object_get_string(json_object_array_get_idx(pair, 0));
+        const char *want_key = json_object_get_string(json_object_array_get_idx(pair, 1));
+        if (!want_type || !want_key || (strcmp(want_type, "*") != 0 && strcmp(want_type, type) != 0))
+            continue;
+        if (strcmp(want_key, "*") == 0 || strcmp(want_key, key) == 0)
+            return 1;
+        if (strcmp(want_key, "$ME") == 0 && strcmp(key, user) == 0)
+            return 1;
+        if (strcmp(want_key, "$LAZY") == 0 && json_object_object_get_ex(senders, key, NULL))
+            return 1;
+    }
+    return 0;
+}
+
+/* Data satu room: event sesudah indeks from (paling banyak limit terakhir),
+   ditambah required_state jika room baru pertama kali dikirim (from == 0) */
+static json_object* sliding_room(Server* s, const Room* room, const char* user, long from, int limit,
+                                 json_object* required) {
+    long first = room->ntimeline;
+    while (first > 0 && room->timeline[first - 1] >= from && room->ntimeline - first < limit)
+        first--;
+    int limited = first > 0 && room->timeline[first - 1] >= from;
+    json_object *timeline = json_object_new_array(), *senders = json_object_new_object(), *sender;
+    for (long i = first; i < room->ntimeline; i++) {
+        json_object *ev = s->events[room->timeline[i]];
+        json_object_array_add(timeline, json_object_get(ev));
+        if (json_object_object_get_ex(ev, "sender", &sender))
+            json_object_object_add(senders, json_object_get_string(sender), json_object_new_boolean(1));
+    }
+
+    json_object *obj = json_object_new_object();
+    if (from == 0) {
+        json_object *state = json_object_new_array(), *content, *name;
+        struct json_object_iterator it = json_object_iter_begin(room->state), end = json_object_iter_end(room->state);
+        for (; !json_object_iter_equal(&it, &end); json_object_iter_next(&it)) {
+            const char *key = json_object_iter_peek_name(&it), *tab = strchr(key, '\t');
+            char type[256];
+            snprintf(type, sizeof(type), "%.*s", (int)(tab - key), key);
+            if (state_wanted(required, type, tab + 1, user, senders))
+                json_object_array_add(state, json_object_get(json_object_iter_peek_value(&it)));
+        }
+        json_object_object_add(obj, "initial", json_object_new_boolean(1));
+        json_object_object_add(obj, "required_state", state);
+        if (json_object_object_get_ex(room->state, "m.room.name\t", &name) &&
+            json_object_object_get_ex(name, "content", &content) &&
+            json_object_object_get_ex(content, "name", &name))
+            json_object_object_add(obj, "name", json_object_get(name));
+    }
+    json_object_put(senders);
+    json_object_object_add(obj, "timeline", timeline);
+    json_object_object_add(obj, "limited", json_object_new_boolean(limited));
+    if (first < room->ntimeline) {
+        char prev[32];
+        snprintf(prev, sizeof(prev), "s%ld", room->timeline[first]);
+        json_object_object_add(obj, "prev_batch", json_object_new_string(prev));
+    }
+    json_object_object_add(obj, "bump_stamp", json_object_new_int64(room->timeline[room->ntimeline - 1] + 1));
+    json_object_object_add(obj, "joined_count", json_object_new_int(room->nmembers));
+    return obj;
+}
+
+/* Status koneksi sliding sync session, array sent diperbesar sesuai jumlah room */
+static Sliding* sliding_get(Server* s, int session) {
+    if (session >= s->sliding_cap) {
+        int cap = s->users_cap > session ? s->users_cap : session + 1;
+        Sliding *sl = realloc(s->sliding, (size_t)cap * sizeof(Sliding));
+        if (!sl)
+            return NULL;
+        memset(sl + s->sliding_cap, 0, (size_t)(cap - s->sliding_cap) * sizeof(Sliding));
+        s->sliding = sl;
+        s->sliding_cap = cap;
+    }
+    Sliding *sl = &s->sliding[session];
+    if (sl->sent_cap < s->nrooms) {
+        long *sent = realloc(sl->sent, (size_t)s->rooms_cap * sizeof(long));
+        if (!sent)
+            return NULL;
+        memset(sent + sl->sent_cap, 0, (size_t)(s->rooms_cap - sl->sent_cap) * sizeof(long));
+        sl->sent = sent;
+        sl->sent_cap = s->rooms_cap;
+    }
+    return sl;
+}
+
+/* Room di jendela list yang belum pernah dikirim atau punya event baru sejak
+   dikirim terakhir. Room yang ada di beberapa list memakai list pertama.
+   rooms_out NULL hanya menghitung tanpa mengubah status koneksi.
+   Mengembalikan jumlah room, -1 jika kehabisan memori */
+static int sliding_collect(Server* s, Sliding* sl, int session, json_object* body, json_object* lists_out,
+                           json_object* rooms_out) {
+    const char *user = s->users[session];
+    Bump *bumps = malloc(((size_t)s->nrooms + 1) * sizeof(Bump));
+    char *done = calloc((size_t)s->nrooms + 1, 1);
+    if (!bumps || !done) {
+        free(bumps);
+        free(done);
+        return -1;
+    }
+    int n = 0;
+    for (int r = 0; r < s->nrooms; r++)
+        if (s->rooms[r].ntimeline > 0 && is_member(&s->rooms[r], user))
+            bumps[n++] = (Bump){ s->rooms[r].timeline[s->rooms[r].ntimeline - 1], r };
+    qsort(bumps, (size_t)n, sizeof(Bump), cmp_bump);
+
+    int count = 0;
+    json_object *lists = NULL;
+    if (body && json_object_object_get_ex(body, "lists", &lists) && json_object_is_type(lists, json_type_object)) {
+        struct json_object_iterator it = json_object_iter_begin(lists), end = json_object_iter_end(lists);
+        for (; !json_object_iter_equal(&it, &end); json_object_iter_next(&it)) {
+            json_object *list = json_object_iter_peek_value(&it), *ranges = NULL, *limit, *required = NULL;
+            json_object_object_get_ex(list, "ranges", &ranges);
+            json_object_object_get_ex(list, "required_state", &required);
+            int timeline_limit = json_object_object_get_ex(list, "timeline_limit", &limit) ?
+                                 json_object_get_int(limit) : 0;
+            size_t nranges = ranges ? json_object_array_length(ranges) : 0;
+            for (size_t k = 0; k < nranges; k++) {
+                json_object *range = json_object_array_get_idx(ranges, k);
+                if (!json_object_is_type(range, json_type_array) || json_object_array_length(range) != 2)
+                    continue;
+                long lo = json_object_get_int64(json_object_array_get_idx(range, 0));
+                long hi = json_object_get_int64(json_object_array_get_idx(range, 1));
+                for (long i = lo < 0 ? 0 : lo; i <= hi && i < n; i++) {
+                    int r = bumps[i].room;
+                    if (done[r] || (sl->sent[r] > 0 && bumps[i].last < sl->sent[r]))
+                        continue;
+                    done[r] = 1;
+                    count++;
+                    if (!rooms_out)
+                        continue;
+                    json_object_object_add(rooms_out, s->rooms[r].room_id,
+                                           sliding_room(s, &s->rooms[r], user, sl->sent[r], timeline_limit, required));
+                    sl->sent[r] = s->nevents;
+                }
+            }
+            if (!lists_out)
+                continue;
+            json_object *out = json_object_new_object();
+            json_object_object_add(out, "count", json_object_new_int(n));
+            json_object_object_add(lists_out, json_object_iter_peek_name(&it), out);
+        }
+    }
+    free(bumps);
+    free(done);
+    return count;
+}
+
+static void respond_sliding(Server* s, Conn* c, int session, json_object* body) {
+    Sliding *sl = sliding_get(s, session);
+    json_object *lists = json_object_new_object(), *rooms = json_object_new_object();
+    if (!sl || sliding_collect(s, sl, session, body, lists, rooms) < 0) {
+        json_object_put(lists);
+        json_object_put(rooms);
+        respond_error(s, c, 500, "M_UNKNOWN", "Out of memory");
+        return;
+    }
+    char pos[32];
+    snprintf(pos, sizeof(pos), "s%ld", s->nevents);
+    json_object *obj = json_object_new_object();
+    json_object_object_add(obj, "pos", json_object_new_string(pos));
+    json_object_object_add(obj, "lists", lists);
+    json_object_object_add(obj, "rooms", rooms);
+    json_object_object_add(obj, "extensions", json_object_new_object());
+    respond_json(s, c, 200, obj);
+}
+
+/* Status koneksi per session: request tanpa pos memulai dari awal (semua room
+   dikirim lagi sebagai initial), pos yang tidak dikenal dijawab M_UNKNOWN_POS */
+static void handle_sliding_sync(Server* s, Conn* c, int session, const char* query, json_object* body) {
+    char pos[32] = "", timeout[16] = "0";
+    query_param(query, "pos", pos, sizeof(pos));
+    query_param(query, "timeout", timeout, sizeof(timeout));
+    if (!body) {
+        respond_error(s, c, 400, "M_NOT_JSON", "Content not JSON.");
+        return;
+    }
+    Sliding *sl = sliding_get(s, session);
+    if (!sl) {
+        respond_error(s, c, 500, "M_UNKNOWN", "Out of memory");
+        return;
+    }
+    char *end;
+    long since = pos[0] == 's' ? strtol(pos + 1, &end, 10) : -1;
+    if (!*pos) {
+        if (sl->sent_cap > 0)
+            memset(sl->sent, 0, (size_t)sl->sent_cap * sizeof(long));
+        sl->active = 1;
+    } else if (!sl->active || since < 0 || since > s->nevents || *end) {
+        respond_error(s, c, 400, "M_UNKNOWN_POS", "Unknown position");
+        return;
+    }
+    s->sliding_syncs++;
+
+    long wait = strtol(timeout, NULL, 10);
+    if (*pos && wait > 0) {
+        /* Hanya di-park jika tidak ada yang perlu dikirim sekarang */
+        int count = sliding_collect(s, sl, session, body, NULL, NULL);
+        if (count == 0) {
+            c->parked = 1;
+            c->park_deadline = now_ms() + wait;
+            c->park_since = s->nevents;
+            c->park_session = session;
+            c->park_body = json_object_get(body);
+            s->nparked++;
+            return;
+        }
+    }
+    respond_sliding(s, c, session, body);
+}
+
+/* --- Endpoint --- */
+
+static void handle_login(Server* s, Conn* c, json_object* body) {
+    json_object *user = NULL, *password = NULL, *identifier;
+    json_object_object_get_ex(body, "user", &user);
+    if (!user && json_object_object_get_ex(body, "identifier", &identifier))
+        json_object_object_get_ex(identifier, "user", &user);
+    json_object_object_get_ex(body, "password", &password);
+    const char *name = user ? json_object_get_string(user) : NULL;
+    if (!name || !*name || !password || !*json_object_get_string(password)) {
+        respond_error(s, c, 403, "M_FORBIDDEN", "Invalid username or password");
+        return;
+    }
+
+    char user_id[256], token[64], device[32];
+    if (name[0] == '@')
+        snprintf(user_id, sizeof(user_id), "%s", name);
+    else
+        snprintf(user_id, sizeof(user_id), "@%s:%s", name, s->name);
+    snprintf(token, sizeof(token), "mhs_%d_%08x%08x", s->nusers, next_rand(s), next_rand(s));
+    snprintf(device, sizeof(device), "MOCK%d", s->nusers);
+    char *copy = strdup(user_id);
+    if (!copy || map_put(&s->sessions, token, s->nusers) != 0 ||
+        push_ptr((void***)&s->users, &s->nusers, &s->users_cap, copy) != 0) {
+        free(copy);
+        respond_error(s, c, 500, "M_UNKNOWN", "Out of memory");
+        return;
+    }
+    s->logins++;
+    json_object *obj = json_object_new_object();
+    json_object_object_add(obj, "user_id", json_object_new_string(user_id));
+    json_object_object_add(obj, "access_token", json_object_new_string(token));
+    json_object_object_add(obj, "device_id", json_object_new_string(device));
+    json_object_object_add(obj, "home_server", json_object_new_string(s->name));
+    respond_json(s, c, 200, obj);
+}
+
+static void handle_join(Server* s, Conn* c, const char* user, const char* room_id) {
+    Room *room = find_room(s, room_id, 0);
+    if (!room) {
+        /* Room baru dibuat oleh user pertama yang join */
+        room = find_room(s, room_id, 1);
+        if (!room) {
+            respond_error(s, c, 500, "M_UNKNOWN", "Out of memory");
+            return;
+        }
+        json_object *content = json_object_new_object();
+        json_object_object_add(content, "creator", json_object_new_string(user));
+        append_event(s, room, user, "m.room.create", "", content);
+    }
+    join_member(s, room, user);
+    json_object *obj = json_object_new_object();
+    json_object_object_add(obj, "room_id", json_object_new_string(room->room_id));
+    respond_json(s, c, 200, obj);
+}
+
+/* Mengembalikan event lama jika txnId sudah pernah dipakai user di room ini */
+static int replay_txn(Server* s, Conn* c, const char* kind, const char* user, const Room* room,
+                      const char* txn, char* key, size_t size) {
+    snprintf(key, size, "%s\n%s\n%s\n%s", kind, user, room->room_id, txn);
+    long idx = map_get(&s->txns, key);
+    if (idx < 0)
+        return 0;
+    s->dedup++;
+    respond_event_id(s, c, idx);
+    return 1;
+}
+
+/* ts > 0 (appservice) menggantikan origin_server_ts */
+static void handle_send(Server* s, Conn* c, const char* user, Room* room, const char* type,
+                        const char* txn, json_object* body, long ts) {
+    char key[1024];
+    if (replay_txn(s, c, "send", user, room, txn, key, sizeof(key)))
+        return;
+    long idx = append_event(s, room, user, type, NULL, json_object_get(body));
+    if (idx < 0) {
+        respond_error(s, c, 500, "M_UNKNOWN", "Out of memory");
+        return;
+    }
+    if (ts > 0)
+        json_object_object_add(s->events[idx], "origin_server_ts", json_object_new_int64(ts));
+    map_put(&s->txns, key, idx);
+    s->sends++;
+    respond_event_id(s, c, idx);
+}
+
+static void handle_state(Server* s, Conn* c, const char* method, const char* user, Room* room,
+                         const char* type, const char* state_key, json_object* body) {
+    char key[512];
+    snprintf(key, sizeof(key), "%s\t%s", type, state_key);
+    s->states++;
+    if (strcmp(method, "GET") == 0) {
+        json_object *ev, *content;
+        if (!json_object_object_get_ex(room->state, key, &ev) ||
+            !json_object_object_get_ex(ev, "content", &content)) {
+            respond_error(s, c, 404, "M_NOT_FOUND", "Event not found.");
+            return;
+        }
+        size_t len;
+        const char *text = json_object_to_json_string_length(content, JSON_C_TO_STRING_PLAIN, &len);
+        respond(s, c, 200, text, len);
+        return;
+    }
+    long idx = append_event(s, room, user, type, state_key, json_object_get(body));
+    if (idx < 0) {
+        respond_error(s, c, 500, "M_UNKNOWN", "Out of memory");
+        return;
+    }
+    respond_event_id(s, c, idx);
+}
+
+static void handle_redact(Server* s, Conn* c, const char* user, Room* room, const char* event_id,
+                          const char* txn, json_object* body) {
+    char key[1024];
+    if (replay_txn(s, c, "redact", user, room, txn, key, sizeof(key)))
+        return;
+    long target = map_get(&s->event_index, event_id);
+    if (target < 0 || &s->rooms[s->event_room[target]] != room) {
+        respond_error(s, c, 404, "M_NOT_FOUND", "Event not found.");
+        return;
+    }
+    json_object *content = json_object_new_object();
+    json_object *reason;
+    if (body && json_object_object_get_ex(body, "reason", &reason))
+        json_object_object_add(content, "reason", json_object_get(reason));
+    long idx = append_event(s, room, user, "m.room.redaction", NULL, content);
+    if (idx < 0) {
+        respond_error(s, c, 500, "M_UNKNOWN", "Out of memory");
+        return;
+    }
+    json_object_object_add(s->events[idx], "redacts", json_object_new_string(event_id));
+    /* Isi event asli dihapus seperti aturan redaction */
+    json_object_object_add(s->events[target], "content", json_object_new_object());
+    map_put(&s->txns, key, idx);
+    s->redacts++;
+    respond_event_id(s, c, idx);
+}
+
+/* /messages: event room mundur (dir=b) atau maju (dir=f) dari posisi stream token from */
+static void handle_messages(Server* s, Conn* c, Room* room, const char* query) {
+    char dir[4] = "b", from[32] = "", limit_text[16] = "10";
+    query_param(query, "dir", dir, sizeof(dir));
+    query_param(query, "from", from, sizeof(from));
+    query_param(query, "limit", limit_text, sizeof(limit_text));
+    int back = strcmp(dir, "f") != 0;
+    long limit = strtol(limit_text, NULL, 10);
+    if (limit <= 0 || limit > 1000)
+        limit = 10;
+    char *end;
+    long pos = back ? s->nevents : 0;
+    if (*from && (from[0] != 's' || (pos = strtol(from + 1, &end, 10)) < 0 || pos > s->nevents || *end)) {
+        respond_error(s, c, 400, "M_INVALID_PARAM", "Invalid from token");
+        return;
+    }
+    s->messages++;
+    int r = (int)(room - s->rooms);
+    json_object *chunk = json_object_new_array();
+    long count = 0, i = pos;
+    if (back) {
+        for (; i > 0 && count < limit; i--)
+            if (s->event_room[i - 1] == r && ++count)
+                json_object_array_add(chunk, json_object_get(s->events[i - 1]));
+    } else {
+        for (; i < s->nevents && count < limit; i++)
+            if (s->event_room[i] == r && ++count)
+                json_object_array_add(chunk, json_object_get(s->events[i]));
+    }
+    char start_token[32], end_token[32];
+    snprintf(start_token, sizeof(start_token), "s%ld", pos);
+    snprintf(end_token, sizeof(end_token), "s%ld", i);
+    json_object *obj = json_object_new_object();
+    json_object_object_add(obj, "chunk", chunk);
+    json_object_object_add(obj, "start", json_object_new_string(start_token));
+    /* end tidak ada jika tidak ada event lagi ke arah itu */
+    if (back ? i > 0 : i < s->nevents)
+        json_object_object_add(obj, "end", json_object_new_string(end_token));
+    size_t len;
+    const char *body = json_object_to_json_string_length(obj, JSON_C_TO_STRING_PLAIN, &len);
+    respond_after(s, c, 200, body, len, s->opt.messages_latency_ms);
+    json_object_put(obj);
+}
+
+static void handle_filter(Server* s, Conn* c, const char* method, const char* filter_id, const Request* req) {
+    if (strcmp(method, "POST") == 0) {
+        char *copy = strndup(req->body, req->body_len);
+        if (!copy || push_ptr((void***)&s->filters, &s->nfilters, &s->filters_cap, copy) != 0) {
+            free(copy);
+            respond_error(s, c, 500, "M_UNKNOWN", "Out of memory");
+            return;
+        }
+        char body[64];
+        int len = snprintf(body, sizeof(body), "{\"filter_id\":\"%d\"}", s->nfilters - 1);
+        respond(s, c, 200, body, (size_t)len);
+        return;
+    }
+    char *end;
+    long id = filter_id ? strtol(filter_id, &end, 10) : -1;
+    if (id < 0 || id >= s->nfilters || *end) {
+        respond_error(s, c, 404, "M_NOT_FOUND", "No such filter");
+        return;
+    }
+    respond(s, c, 200, s->filters[id], strlen(s->filters[id]));
+}
+
+static int is_method(const char* method, const char* a, const char* b) {
+    return strcmp(method, a) == 0 || (b && strcmp(method, b) == 0);
+}
+
+/* PUT menyimpan presence user sendiri, GET mengembalikannya.
+   target boleh berupa localpart seperti username login */
+static void handle_presence(Server* s, Conn* c, const char* method, const char* user, const char* target,
+                            json_object* body) {
+    char user_id[256];
+    if (target[0] == '@')
+        snprintf(user_id, sizeof(user_id), "%s", target);
+    else
+        snprintf(user_id, sizeof(user_id), "@%s:%s", target, s->name);
+    target = user_id;
+    if (!s->presence_by_user && !(s->presence_by_user = json_object_new_object())) {
+        respond_error(s, c, 500, "M_UNKNOWN", "Out of memory");
+        return;
+    }
+    json_object *stored = NULL;
+    if (strcmp(method, "GET") == 0) {
+        if (!json_object_object_get_ex(s->presence_by_user, target, &stored)) {
+            respond_error(s, c, 404, "M_NOT_FOUND", "Presence not found");
+            return;
+        }
+        const char *text = json_object_to_json_string_ext(stored, JSON_C_TO_STRING_PLAIN);
+        respond(s, c, 200, text, strlen(text));
+        return;
+    }
+    json_object *presence = NULL;
+    if (strcmp(user, target) != 0) {
+        respond_error(s, c, 403, "M_FORBIDDEN", "Cannot set presence of another user");
+    } else if (!body || !json_object_object_get_ex(body, "presence", &presence) ||
+               !json_object_is_type(presence, json_type_string)) {
+        respond_error(s, c, 400, "M_BAD_JSON", "Missing presence");
+    } else {
+        json_object_object_add(s->presence_by_user, target, json_object_get(body));
+        s->presence++;
+        respond(s, c, 200, "{}", 2);
+    }
+}
+
+/* Gangguan tersuntik: 1 jika request dijawab 429/500 dan tidak diproses */
+static int inject_fault(Server* s, Conn* c) {
+    unsigned roll = next_rand(s) % 1000;
+    if (roll < (unsigned)s->opt.rate_limit_permille) {
+        char err[160];
+        int retry = s->opt.retry_after_ms > 0 ? s->opt.retry_after_ms : 100;
+        int len = snprintf(err, sizeof(err),
+                           "{\"errcode\":\"M_LIMIT_EXCEEDED\",\"error\":\"Too many requests\",\"retry_after_ms\":%d}",
+                           retry);
+        s->limited++;
+        respond(s, c, 429, err, (size_t)len);
+        return 1;
+    }
+    if (roll < (unsigned)(s->opt.rate_limit_permille + s->opt.error_permille)) {
+        s->failed++;
+        respond_error(s, c, 500, "M_UNKNOWN", "Internal server error");
+        return 1;
+    }
+    return 0;
+}
+
+/* Sesi dari header Bearer atau query access_token. -1 (sudah dijawab 401) jika tidak valid */
+static long authenticate(Server* s, Conn* c, const char* bearer, const char* query) {
+    char token[128] = "";
+    if (bearer)
+        snprintf(token, sizeof(token), "%s", bearer);
+    else
+        query_param(query, "access_token", token, sizeof(token));
+    if (!*token) {
+        respond_error(s, c, 401, "M_MISSING_TOKEN", "Missing access token");
+        return -1;
+    }
+    long session = map_get(&s->sessions, token);
+    if (session < 0)
+        respond_error(s, c, 401, "M_UNKNOWN_TOKEN", "Unrecognised access token");
+    return session;
+}
+
+static void dispatch(Server* s, Conn* c, Request* req) {
+    char *seg[MAX_SEGS];
+    int nseg = 0;
+    for (char *p = req->path, *save = NULL, *t; nseg < MAX_SEGS && (t = strtok_r(p, "/", &save)); p = NULL) {
+        url_decode(t);
+        seg[nseg++] = t;
+    }
+    const char *m = req->method;
+    json_object *body = req->body_len ? json_tokener_parse(req->body) : NULL;
+
+    if (nseg == 1 && strcmp(seg[0], "login") == 0 && is_method(m, "POST", NULL)) {
+        if (!body)
+            respond_error(s, c, 400, "M_NOT_JSON", "Content not JSON.");
+        else
+            handle_login(s, c, body);
+        json_object_put(body);
+        return;
+    }
+
+    long session = inject_fault(s, c) ? -1 : authenticate(s, c, req->token, req->query);
+    if (session < 0) {
+        json_object_put(body);
+        return;
+    }
+    const char *user = s->users[session];
+    /* Appservice: menyamar sebagai puppet dan menentukan timestamp event */
+    char masquerade[256], ts_value[32];
+    long ts = 0;
+    if (session == s->as_session) {
+        if (query_param(req->query, "user_id", masquerade, sizeof(masquerade)) && masquerade[0] == '@')
+            user = masquerade;
+        if (query_param(req->query, "ts", ts_value, sizeof(ts_value)))
+            ts = strtol(ts_value, NULL, 10);
+    }
+
+    if (nseg == 1 && strcmp(seg[0], "sync") == 0 && is_method(m, "GET", NULL)) {
+        handle_sync(s, c, (int)session, req->query);
+    } else if (nseg == 2 && strcmp(seg[0], SLIDING_SYNC_PREFIX) == 0 && strcmp(seg[1], "sync") == 0 &&
+               is_method(m, "POST", NULL)) {
+        handle_sliding_sync(s, c, (int)session, req->query, body);
+    } else if (nseg == 2 && strcmp(seg[0], "join") == 0 && is_method(m, "POST", NULL)) {
+        handle_join(s, c, user, seg[1]);
+    } else if (nseg >= 3 && strcmp(seg[0], "user") == 0 && strcmp(seg[2], "filter") == 0 &&
+               ((nseg == 3 && is_method(m, "POST", NULL)) || (nseg == 4 && is_method(m, "GET", NULL)))) {
+        handle_filter(s, c, m, nseg == 4 ? seg[3] : NULL, req);
+    } else if (nseg == 3 && strcmp(seg[0], "presence") == 0 && strcmp(seg[2], "status") == 0 &&
+               is_method(m, "PUT", "GET")) {
+        handle_presence(s, c, m, user, seg[1], body);
+    } else if (nseg >= 3 && strcmp(seg[0], "rooms") == 0) {
+        Room *room = find_room(s, seg[1], 0);
+        const char *what = seg[2];
+        if (nseg == 3 && strcmp(what, "join") == 0 && is_method(m, "POST", NULL)) {
+            handle_join(s, c, user, seg[1]);
+        } else if (!room || !is_member(room, user)) {
+            respond_error(s, c, 403, "M_FORBIDDEN", "User not in room");
+        } else if (nseg == 5 && strcmp(what, "send") == 0 && is_method(m, "PUT", NULL)) {
+            if (!body)
+                respond_error(s, c, 400, "M_NOT_JSON", "Content not JSON.");
+            else
+                handle_send(s, c, user, room, seg[3], seg[4], body, ts);
+        } else if ((nseg == 4 || nseg == 5) && strcmp(what, "state") == 0 && is_method(m, "GET", "PUT")) {
+            if (m[0] == 'P' && !body)
+                respond_error(s, c, 400, "M_NOT_JSON", "Content not JSON.");
+            else
+                handle_state(s, c, m, user, room, seg[3], nseg == 5 ? seg[4] : "", body);
+        } else if (nseg == 3 && strcmp(what, "messages") == 0 && is_method(m, "GET", NULL)) {
+            handle_messages(s, c, room, req->query);
+        } else if (nseg == 5 && strcmp(what, "redact") == 0 && is_method(m, "PUT", "POST")) {
+            handle_redact(s, c, user, room, seg[3], seg[4], body);
+        } else if ((strcmp(what, "typing") == 0 && is_method(m, "PUT", NULL)) ||
+                   (strcmp(what, "read_markers") == 0 && is_method(m, "POST", NULL)) ||
+                   (strcmp(what, "receipt") == 0 && is_method(m, "POST", NULL))) {
+            if (!body) {
+                respond_error(s, c, 400, "M_NOT_JSON", "Content not JSON.");
+            } else {
+                if (what[0] == 't')
+                    s->typing++;
+                else
+                    s->read_markers++;
+                respond(s, c, 200, "{}", 2);
+            }
+        } else {
+            respond_error(s, c, 404, "M_UNRECOGNIZED", "Unrecognized request");
+        }
+    } else {
+        respond_error(s, c, 404, "M_UNRECOGNIZED", "Unrecognized request");
+    }
+    json_object_put(body);
+}
+
+/* --- Media --- */
+
+static int valid_media_id(const char* id) {
+    if (!*id)
+        return 0;
+    for (; *id; id++)
+        if (!isalnum((unsigned char)*id) && *id != '_' && *id != '-')
+            return 0;
+    return 1;
+}
+
+/* Body upload lengkap: file sementara menjadi media baru, atau dibuang jika request ditolak */
+static void finish_upload(Server* s, Conn* c) {
+    close(c->body_fd);
+    c->body_fd = -1;
+    if (!c->body_path) {
+        process_input(s, c);
+        return;
+    }
+    char id[32], path[4096];
+    snprintf(id, sizeof(id), "m%ld", ++s->media_next);
+    snprintf(path, sizeof(path), "%s/%s", s->opt.media_dir, id);
+    if (rename(c->body_path, path) != 0) {
+        unlink(c->body_path);
+        respond_error(s, c, 500, "M_UNKNOWN", "Cannot store media");
+    } else {
+        char body[256];
+        int len = snprintf(body, sizeof(body), "{\"content_uri\":\"mxc://%s/%s\"}", s->name, id);
+        s->uploads++;
+        respond(s, c, 200, body, (size_t)len);
+    }
+    free(c->body_path);
+    c->body_path = NULL;
+}
+
+/* Menulis body upload yang sudah diterima di c->in ke file */
+static void drain_upload(Server* s, Conn* c) {
+    size_t n = c->in_len < c->body_left ? c->in_len : c->body_left;
+    for (size_t off = 0; off < n;) {
+        ssize_t w = write(c->body_fd, c->in + off, n - off);
+        if (w < 0 && errno == EINTR)
+            continue;
+        if (w <= 0) {
+            c->dead = 1;
+            return;
+        }
+        off += (size_t)w;
+    }
+    memmove(c->in, c->in + n, c->in_len - n);
+    c->in_len -= n;
+    c->body_left -= n;
+    s->media_in += n;
+    if (c->body_left == 0)
+        finish_upload(s, c);
+}
+
+/* Upload (body langsung ke file, tanpa batas MAX_REQUEST) dan download (sendfile).
+   path sesudah prefiks /_matrix/media/{r0,v3}/ */
+static void handle_media(Server* s, Conn* c, const char* method, char* path, const char* query,
+                         const char* bearer, size_t content_length, int expect) {
+    if (strcmp(path, "upload") == 0 && strcmp(method, "POST") == 0) {
+        int accepted = 0;
+        if (!inject_fault(s, c) && authenticate(s, c, bearer, query) >= 0) {
+            char tmp[4096];
+            snprintf(tmp, sizeof(tmp), "%s/upload.XXXXXX", s->opt.media_dir);
+            c->body_fd = mkstemp(tmp);
+            if (c->body_fd >= 0 && (c->body_path = strdup(tmp)) != NULL)
+                accepted = 1;
+            else
+                respond_error(s, c, 500, "M_UNKNOWN", "Cannot store media");
+        }
+        if (!accepted) {
+            /* Body yang sudah dikirim dibuang, koneksi ditutup setelah respons */
+            if (c->body_fd >= 0)
+                close(c->body_fd);
+            c->body_fd = open("/dev/null", O_WRONLY | O_CLOEXEC);
+            c->close_after = 1;
+            if (c->body_fd < 0) {
+                c->dead = 1;
+                return;
+            }
+        }
+        c->body_left = content_length;
+        if (accepted && expect && content_length > c->in_len) {
+            static const char cont[] = "HTTP/1.1 100 Continue\r\n\r\n";
+            send(c->fd, cont, sizeof(cont) - 1, MSG_NOSIGNAL);
+        }
+        drain_upload(s, c);
+        return;
+    }
+
+    char *seg[4];
+    int nseg = 0;
+    for (char *p = path, *save = NULL, *t; nseg < 4 && (t = strtok_r(p, "/", &save)); p = NULL) {
+        url_decode(t);
+        seg[nseg++] = t;
+    }
+    if (nseg < 3 || strcmp(seg[0], "download") != 0 || strcmp(method, "GET") != 0) {
+        respond_error(s, c, 404, "M_UNRECOGNIZED", "Unrecognized request");
+        return;
+    }
+    if (inject_fault(s, c))
+        return;
+    char file[4096];
+    snprintf(file, sizeof(file), "%s/%s", s->opt.media_dir, seg[2]);
+    struct stat st;
+    int fd = strcmp(seg[1], s->name) == 0 && valid_media_id(seg[2]) ? open(file, O_RDONLY | O_CLOEXEC) : -1;
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        if (fd >= 0)
+            close(fd);
+        respond_error(s, c, 404, "M_NOT_FOUND", "Media not found");
+        return;
+    }
+    append_head(c, 200, "application/octet-stream", (size_t)st.st_size);
+    c->file_fd = fd;
+    c->file_off = 0;
+    c->file_left = st.st_size;
+    s->downloads++;
+    schedule_response(s, c, 0);
+}
+
+/* --- Parsing HTTP --- */
+
+/* Memproses satu request jika header dan body sudah lengkap. 1 jika diproses */
+static int handle_request(Server* s, Conn* c) {
+    char *end = memmem(c->in, c->in_len, "\r\n\r\n", 4);
+    if (!end)
+        return 0;
+    size_t head_len = (size_t)(end - c->in) + 4;
+    char *head = strndup(c->in, head_len - 2);
+    if (!head) {
+        c->dead = 1;
+        return 0;
+    }
+
+    Request req = { 0 };
+    size_t content_length = 0;
+    int expect = 0, chunked = 0;
+    char *save = NULL, *words = NULL;
+    char *line = strtok_r(head, "\r\n", &save);
+    char *target = NULL;
+    if (line) {
+        req.method = strtok_r(line, " ", &words);
+        target = strtok_r(NULL, " ", &words);
+    }
+    while ((line = strtok_r(NULL, "\r\n", &save)) != NULL) {
+        char *colon = strchr(line, ':');
+        if (!colon)
+            continue;
+        *colon = '\0';
+        char *value = colon + 1;
+        while (*value == ' ')
+            value++;
+        if (strcasecmp(line, "Content-Length") == 0)
+            content_length = strtoul(value, NULL, 10);
+        else if (strcasecmp(line, "Expect") == 0)
+            expect = strcasecmp(value, "100-continue") == 0;
+        else if (strcasecmp(line, "Transfer-Encoding") == 0)
+            chunked = 1;
+        else if (strcasecmp(line, "Connection") == 0 && strcasecmp(value, "close") == 0)
+            c->close_after = 1;
+        else if (strcasecmp(line, "Authorization") == 0 && strncasecmp(value, "Bearer ", 7) == 0)
+            req.token = value + 7;
+    }
+
+    if (req.method && target && !chunked && s->opt.media_dir &&
+        (strncmp(target, "/_matrix/media/r0/", 18) == 0 || strncmp(target, "/_matrix/media/v3/", 18) == 0)) {
+        memmove(c->in, c->in + head_len, c->in_len - head_len);
+        c->in_len -= head_len;
+        req.query = strchr(target, '?');
+        if (req.query)
+            *req.query++ = '\0';
+        else
+            req.query = "";
+        s->requests++;
+        handle_media(s, c, req.method, target + 18, req.query, req.token, content_length, expect);
+        free(head);
+        return 1;
+    }
+    if (!req.method || !target || chunked || head_len + content_length > MAX_REQUEST) {
+        c->close_after = 1;
+        c->in_len = 0;
+        respond_error(s, c, chunked ? 411 : 413, "M_UNKNOWN", "Unsupported request");
+        free(head);
+        return 1;
+    }
+    if (c->in_len < head_len + content_length) {
+        if (expect && !c->continued) {
+            static const char cont[] = "HTTP/1.1 100 Continue\r\n\r\n";
+            send(c->fd, cont, sizeof(cont) - 1, MSG_NOSIGNAL);
+            c->continued = 1;
+        }
+        free(head);
+        return 0;
+    }
+
+    /* Input dikonsumsi dulu: respons tanpa latensi langsung memproses request berikutnya */
+    req.body = strndup(c->in + head_len, content_length);
+    req.body_len = content_length;
+    size_t used = head_len + content_length;
+    memmove(c->in, c->in + used, c->in_len - used);
+    c->in_len -= used;
+    req.query = strchr(target, '?');
+    if (req.query)
+        *req.query++ = '\0';
+    else
+        req.query = "";
+    s->requests++;
+    c->continued = 0;
+    if (strncmp(target, "/_matrix/client/r0/", 19) == 0 || strncmp(target, "/_matrix/client/v3/", 19) == 0) {
+        req.path = target + 19;
+        dispatch(s, c, &req);
+    } else if (strncmp(target, "/_matrix/client/unstable/", 25) == 0) {
+        req.path = target + 25;
+        dispatch(s, c, &req);
+    } else if (strcmp(target, "/_mock/stats") == 0 && strcmp(req.method, "GET") == 0) {
+        char stats[256];
+        int len = snprintf(stats, sizeof(stats),
+                           "{\"requests\":%lu,\"send\":%lu,\"dedup\":%lu,\"typing\":%lu,\"read_markers\":%lu,"
+                           "\"presence\":%lu}",
+                           s->requests, s->sends, s->dedup, s->typing, s->read_markers, s->presence);
+        respond(s, c, 200, stats, (size_t)len);
+    } else {
+        respond_error(s, c, 404, "M_UNRECOGNIZED", "Unrecognized request");
+    }
+    free(req.body);
+    free(head);
+    return 1;
+}
+
+static void process_input(Server* s, Conn* c) {
+    /* Satu request per koneksi pada satu waktu, sisanya menunggu respons terkirim */
+    while (!c->dead && !c->responding && !c->parked && c->body_fd < 0 && c->in_len > 0)
+        if (!handle_request(s, c))
+            break;
+}
+
+static void read_conn(Server* s, Conn* c) {
+    for (;;) {
+        /* Buffer penuh: header upload media mungkin sudah lengkap dan body bisa dialihkan ke file */
+        if (c->in_len == c->in_cap && c->body_fd < 0)
+            process_input(s, c);
+        if (c->body_fd >= 0 && c->in_len > 0) {
+            drain_upload(s, c);
+            if (c->dead)
+                return;
+        }
+        if (c->in_len == c->in_cap) {
+            if (c->in_cap >= MAX_REQUEST + 4096) {
+                c->dead = 1;
+                return;
+            }
+            size_t cap = c->in_cap ? c->in_cap * 2 : 4096;
+            char *p = realloc(c->in, cap);
+            if (!p) {
+                c->dead = 1;
+                return;
+            }
+            c->in = p;
+            c->in_cap = cap;
+        }
+        ssize_t n = recv(c->fd, c->in + c->in_len, c->in_cap - c->in_len, 0);
+        if (n > 0) {
+            c->in_len += (size_t)n;
+            continue;
+        }
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            break;
+        c->dead = 1;
+        return;
+    }
+    if (c->body_fd >= 0 && c->in_len > 0)
+        drain_upload(s, c);
+    process_input(s, c);
+}
+
+static void close_conn(Server* s, Conn* c) {
+    if (c->parked)
+        s->nparked--;
+    json_object_put(c->park_body);
+    s->by_fd[c->fd] = NULL;
+    close(c->fd);
+    if (c->body_fd >= 0)
+        close(c->body_fd);
+    if (c->body_path)
+        unlink(c->body_path);
+    if (c->file_fd >= 0)
+        close(c->file_fd);
+    free(c->body_path);
+    free(c->in);
+    free(c->out);
+    free(c);
+}
+
+static void accept_conns(Server* s) {
+    for (;;) {
+        int fd = accept4(s->lfd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0)
+            return;
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        if (fd >= s->by_fd_cap) {
+            int cap = s->by_fd_cap ? s->by_fd_cap : 256;
+            while (cap <= fd)
+                cap *= 2;
+            Conn **p = realloc(s->by_fd, (size_t)cap * sizeof(Conn*));
+            if (!p) {
+                close(fd);
+                continue;
+            }
+            memset(p + s->by_fd_cap, 0, (size_t)(cap - s->by_fd_cap) * sizeof(Conn*));
+            s->by_fd = p;
+            s->by_fd_cap = cap;
+        }
+        Conn *c = calloc(1, sizeof(Conn));
+        struct epoll_event ev = { .events = EPOLLIN, .data.fd = fd };
+        if (!c || epoll_ctl(s->epfd, EPOLL_CTL_ADD, fd, &ev) != 0) {
+            free(c);
+            close(fd);
+            continue;
+        }
+        c->fd = fd;
+        c->body_fd = c->file_fd = -1;
+        s->by_fd[fd] = c;
+    }
+}
+
+/* Respons tertunda yang jatuh tempo, long-poll yang habis waktu, koneksi mati.
+   Mengembalikan timeout epoll berikutnya */
+static int service_timers(Server* s) {
+    long now = now_ms(), next = -1;
+    for (int fd = 0; fd < s->by_fd_cap; fd++) {
+        Conn *c = s->by_fd[fd];
+        if (!c)
+            continue;
+        if (!c->dead && c->parked && c->park_deadline <= now)
+            respond_parked(s, c);
+        if (!c->dead && c->responding && c->ready_ms && c->ready_ms <= now) {
+            c->ready_ms = 0;
+            flush_conn(s, c);
+        }
+        if (c->dead) {
+            close_conn(s, c);
+            continue;
+        }
+        long due = c->parked ? c->park_deadline : c->responding && c->ready_ms ? c->ready_ms : -1;
+        if (due >= 0 && (next < 0 || due < next))
+            next = due;
+    }
+    return next < 0 ? -1 : (int)(next > now ? next - now : 0);
+}
+
+/* --- Replay /sync --- */
+
+/* Memuat payload rekaman dan menggandakan event timeline sampai ukuran target */
+static int load_replay(Server* s) {
+    const char *path = s->opt.sync_replay_file;
+    FILE *fp = fopen(path, "rb");
+    if (!fp) {
+        perror("mock-homeserver: replay");
+        return -1;
+    }
+    fseek(fp, 0, SEEK_END);
+    long size = ftell(fp);
+    rewind(fp);
+    char *data = malloc((size_t)size + 1);
+    size_t got = data ? fread(data, 1, (size_t)size, fp) : 0;
+    fclose(fp);
+    if (!data || got != (size_t)size) {
+        free(data);
+        return -1;
+    }
+    data[size] = '\0';
+    json_object *root = json_tokener_parse(data);
+    free(data);
+    json_object *rooms, *join;
+    if (!root || !json_object_object_get_ex(root, "rooms", &rooms) ||
+        !json_object_object_get_ex(rooms, "join", &join)) {
+        fprintf(stderr, "Error: payload replay %s tidak valid\n", path);
+        json_object_put(root);
+        return -1;
+    }
+    json_object_object_add(root, "next_batch", json_object_new_string("s0"));
+
+    size_t total;
+    json_object_to_json_string_length(root, JSON_C_TO_STRING_PLAIN, &total);
+    long copies = 0;
+    while (s->opt.sync_replay_bytes > total) {
+        size_t before = total;
+        struct json_object_iterator it = json_object_iter_begin(join);
+        struct json_object_iterator it_end = json_object_iter_end(join);
+        for (; !json_object_iter_equal(&it, &it_end); json_object_iter_next(&it)) {
+            json_object *room = json_object_iter_peek_value(&it), *timeline, *events;
+            if (!json_object_object_get_ex(room, "timeline", &timeline) ||
+                !json_object_object_get_ex(timeline, "events", &events))
+                continue;
+            size_t n = json_object_array_length(events);
+            for (size_t i = 0; i < n && s->opt.sync_replay_bytes > total; i++) {
+                json_object *copy = NULL, *id;
+                if (json_object_deep_copy(json_object_array_get_idx(events, i), &copy, NULL) != 0)
+                    break;
+                if (json_object_object_get_ex(copy, "event_id", &id)) {
+                    char new_id[256];
+                    snprintf(new_id, sizeof(new_id), "$r%ld_%s", copies, json_object_get_string(id) + 1);
+                    json_object_object_add(copy, "event_id", json_object_new_string(new_id));
+                }
+                size_t len;
+                json_object_to_json_string_length(copy, JSON_C_TO_STRING_PLAIN, &len);
+                json_object_array_add(events, copy);
+                total += len + 1;
+            }
+        }
+        if (total == before)
+            break;
+        copies++;
+    }
+
+    size_t len;
+    const char *text = json_object_to_json_string_length(root, JSON_C_TO_STRING_PLAIN, &len);
+    s->replay = malloc(len + 1);
+    if (s->replay) {
+        memcpy(s->replay, text, len + 1);
+        s->replay_len = len;
+    }
+    json_object_put(root);
+    return s->replay ? 0 : -1;
+}
+
+/* Room awal untuk akun besar: seed_user anggota semua room, pesan disebar
+   acak sehingga urutan aktivitas room berbeda-beda */
+static int seed_rooms(Server* s) {
+    const mock_homeserver_options *o = &s->opt;
+    char user[256], id[300], member[300], text[64];
+    if (o->seed_user[0] == '@')
+        snprintf(user, sizeof(user), "%s", o->seed_user);
+    else
+        snprintf(user, sizeof(user), "@%s:%s", o->seed_user, s->name);
+    for (int r = 0; r < o->seed_rooms; r++) {
+        snprintf(id, sizeof(id), "!seed%d:%s", r, s->name);
+        Room *room = find_room(s, id, 1);
+        if (!room)
+            return -1;
+        json_object *content = json_object_new_object();
+        json_object_object_add(content, "creator", json_object_new_string(user));
+        append_event(s, room, user, "m.room.create", "", content);
+        join_member(s, room, user);
+        for (int m = 0; m < o->seed_members; m++) {
+            snprintf(member, sizeof(member), "@seed%d_%d:%s", r, m, s->name);
+            join_member(s, room, member);
+        }
+        snprintf(text, sizeof(text), "Seed room %d", r);
+        content = json_object_new_object();
+        json_object_object_add(content, "name", json_object_new_string(text));
+        append_event(s, room, user, "m.room.name", "", content);
+    }
+    long total = (long)o->seed_rooms * o->seed_messages;
+    for (long i = 0; i < total; i++) {
+        int r = (int)(next_rand(s) % (unsigned)o->seed_rooms);
+        Room *room = &s->rooms[s->nrooms - o->seed_rooms + r];
+        if (o->seed_members > 0)
+            snprintf(member, sizeof(member), "@seed%d_%u:%s", r, next_rand(s) % (unsigned)o->seed_members, s->name);
+        else
+            snprintf(member, sizeof(member), "%s", user);
+        snprintf(text, sizeof(text), "seed message %ld", i);
+        json_object *content = json_object_new_object();
+        json_object_object_add(content, "msgtype", json_object_new_string("m.text"));
+        json_object_object_add(content, "body", json_object_new_string(text));
+        if (append_event(s, room, member, "m.room.message", NULL, content) < 0)
+            return -1;
+    }
+    return 0;
+}
+
+static void free_server(Server* s) {
+    for (int fd = 0; fd < s->by_fd_cap; fd++)
+        if (s->by_fd[fd])
+            close_conn(s, s->by_fd[fd]);
+    for (long i = 0; i < s->nevents; i++)
+        json_object_put(s->events[i]);
+    for (int i = 0; i < s->nrooms; i++) {
+        for (int j = 0; j < s->rooms[i].nmembers; j++)
+            free(s->rooms[i].members[j]);
+        free(s->rooms[i].members);
+        free(s->rooms[i].room_id);
+        free(s->rooms[i].timeline);
+        json_object_put(s->rooms[i].state);
+    }
+    for (int i = 0; i < s->sliding_cap; i++)
+        free(s->sliding[i].sent);
+    free(s->sliding);
+    for (int i = 0; i < s->nusers; i++)
+        free(s->users[i]);
+    for (int i = 0; i < s->nfilters; i++)
+        free(s->filters[i]);
+    json_object_put(s->presence_by_user);
+    map_clear(&s->sessions);
+    map_clear(&s->room_index);
+    map_clear(&s->txns);
+    map_clear(&s->event_index);
+    if (s->epfd >= 0)
+        close(s->epfd);
+    free(s->events);
+    free(s->event_room);
+    free(s->rooms);
+    free(s->users);
+    free(s->filters);
+    free(s->replay);
+    free(s->by_fd);
+    free(s);
+}
+
+int mock_homeserver_run(int listen_fd, const mock_homeserver_options* options) {
+    Server *s = calloc(1, sizeof(Server));
+    if (!s)
+        return 1;
+    if (options)
+        s->opt = *options;
+    s->name = s->opt.server_name ? s->opt.server_name : "localhost";
+    s->rng = s->opt.seed ? s->opt.seed : 1;
+    s->lfd = listen_fd;
+    s->epfd = -1;
+    s->as_session = -1;
+    if (s->opt.as_token) {
+        char user_id[256];
+        snprintf(user_id, sizeof(user_id), "@appservice:%s", s->name);
+        char *copy = strdup(user_id);
+        if (!copy || map_put(&s->sessions, s->opt.as_token, s->nusers) != 0 ||
+            push_ptr((void***)&s->users, &s->nusers, &s->users_cap, copy) != 0) {
+            free(copy);
+            free_server(s);
+            return 1;
+        }
+        s->as_session = s->nusers - 1;
+    }
+    if (s->opt.sync_replay_file && load_replay(s) != 0) {
+        free_server(s);
+        return 1;
+    }
+    if (s->opt.seed_user && s->opt.seed_rooms > 0 && seed_rooms(s) != 0) {
+        free_server(s);
+        return 1;
+    }
+    fcntl(listen_fd, F_SETFL, fcntl(listen_fd, F_GETFL) | O_NONBLOCK);
+    s->epfd = epoll_create1(EPOLL_CLOEXEC);
+    struct epoll_event lev = { .events = EPOLLIN, .data.fd = listen_fd };
+    if (s->epfd < 0 || epoll_ctl(s->epfd, EPOLL_CTL_ADD, listen_fd, &lev) != 0) {
+        perror("mock-homeserver: epoll");
+        free_server(s);
+        return 1;
+    }
+
+    /* SIGTERM hanya diterima di dalam epoll_pwait agar tidak terlewat */
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = on_sigterm;
+    sigaction(SIGTERM, &sa, NULL);
+    signal(SIGPIPE, SIG_IGN);
+    sigset_t block, wait_mask;
+    sigemptyset(&block);
+    sigaddset(&block, SIGTERM);
+    sigprocmask(SIG_BLOCK, &block, &wait_mask);
+    sigdelset(&wait_mask, SIGTERM);
+
+    struct epoll_event events[256];
+    int timeout = -1;
+    while (!stop_requested) {
+        int n = epoll_pwait(s->epfd, events, 256, timeout, &wait_mask);
+        if (n < 0 && errno != EINTR) {
+            perror("mock-homeserver: epoll_wait");
+            break;
+        }
+        for (int i = 0; i < n; i++) {
+            int fd = events[i].data.fd;
+            if (fd == listen_fd) {
+                accept_conns(s);
+                continue;
+            }
+            Conn *c = fd < s->by_fd_cap ? s->by_fd[fd] : NULL;
+            if (!c || c->dead)
+                continue;
+            if ((events[i].events & EPOLLOUT) && !c->ready_ms)
+                flush_conn(s, c);
+            if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR))
+                read_conn(s, c);
+        }
+        timeout = service_timers(s);
+    }
+
+    if (s->opt.verbose)
+        printf("[mock-homeserver] request=%lu login=%lu send=%lu dedup=%lu sync=%lu sliding=%lu state=%lu redact=%lu "
+               "messages=%lu typing=%lu read_markers=%lu presence=%lu upload=%lu download=%lu 429=%lu 500=%lu "
+               "event=%ld masuk media=%llu keluar=%llu byte\n",
+               s->requests, s->logins, s->sends, s->dedup, s->syncs, s->sliding_syncs, s->states, s->redacts, s->messages,
+               s->typing, s->read_markers, s->presence, s->uploads, s->downloads, s->limited, s->failed, s->nevents,
+               s->media_in, s->bytes_out);
+    free_server(s);
+    return 0;
+}
+
+int mock_homeserver_start(const mock_homeserver_options* options, pid_t* pid) {
+    int lfd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    struct sockaddr_in addr;
+    socklen_t alen = sizeof(addr);
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (lfd < 0 || bind(lfd, (struct sockaddr*)&addr, sizeof(addr)) != 0 || listen(lfd, 1024) != 0 ||
+        getsockname(lfd, (struct sockaddr*)&addr, &alen) != 0) {
+        perror("mock-homeserver: listen");
+        if (lfd >= 0)
+            close(lfd);
+        return -1;
+    }
+    fflush(stdout);
+    *pid = fork();
+    if (*pid < 0) {
+        close(lfd);
+        return -1;
+    }
+    if (*pid == 0) {
+        int rc = mock_homeserver_run(lfd, options);
+        fflush(stdout);
+        _exit(rc);
+    }
+    close(lfd);
+    return ntohs(addr.sin_port);
+}
+
+int mock_homeserver_stop(pid_t pid) {
+    int status;
+    if (pid <= 0 || kill(pid, SIGTERM) != 0 || waitpid(pid, &status, 0) != pid || !WIFEXITED(status))
+        return -1;
+    return WEXITSTATUS(status);
+}
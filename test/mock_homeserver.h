@@ -0,0 +1,85 @@
+#ifndef MOCK_HOMESERVER_H
+#define MOCK_HOMESERVER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <sys/types.h>
+
+/* Homeserver Matrix pengganti untuk test dan benchmark di localhost.
+
+   HTTP/1.1 (keep-alive, body Content-Length) dengan prefiks
+   /_matrix/client/r0 dan /_matrix/client/v3. Endpoint: login, join,
+   send (idempoten per user+room+txnId seperti spec), state GET/PUT,
+   redact, messages (dir b/f, token posisi stream "sN" yang sama dengan
+   since/prev_batch), sync (long-poll, since, filter dengan timeline limit),
+   filter POST/GET, typing, read_markers dan presence (PUT disimpan per
+   user, GET mengembalikannya). Token diterima lewat query access_token
+   atau header Authorization: Bearer. GET /_mock/stats (tanpa token)
+   mengembalikan jumlah request, send, dedup, typing, read_markers dan presence
+   sebagai JSON untuk diperiksa test.
+
+   Jika media_dir diberikan, /_matrix/media/{r0,v3}/upload dan
+   download/{server}/{mediaId} juga dilayani: body upload ditulis langsung
+   ke file di media_dir (tidak dibatasi ukuran request biasa) dan download
+   dikirim dengan sendfile, jadi ukuran media tidak memengaruhi memori
+   server.
+
+   Sliding sync sederhana (MSC4186) di /_matrix/client/unstable/
+   org.matrix.simplified_msc3575/sync: list dengan ranges atas room yang
+   diurutkan menurut event terakhir, timeline_limit dan required_state
+   (termasuk "*", "$LAZY" dan "$ME") per list, pos "sN" dan long-poll.
+   Room pertama kali masuk jendela dikirim sebagai initial, sesudahnya
+   hanya event baru. Status koneksi per session; pos tanpa koneksi dijawab
+   400 M_UNKNOWN_POS.
+
+   Initial sync (tanpa since) memutar ulang payload /sync rekaman dengan
+   next_batch "s0", jadi sync berikutnya membawa semua event sejak server
+   mulai. Payload bisa diperbesar sampai sync_replay_bytes dengan
+   menggandakan event timeline (event_id baru).
+
+   Jika as_token diberikan, token itu milik appservice (@appservice:<name>):
+   parameter query user_id menyamar sebagai user mana pun (puppet) dan ts
+   menjadi origin_server_ts event yang dikirim, seperti API appservice.
+
+   Gangguan disuntikkan ke semua endpoint kecuali login: latensi (ditahan
+   dengan timer, server tidak berhenti melayani koneksi lain), 429
+   M_LIMIT_EXCEEDED dengan retry_after_ms dan 500 M_UNKNOWN. */
+
+typedef struct {
+    const char *server_name;    /* NULL = "localhost" */
+    int latency_ms;             /* Tambahan waktu sebelum setiap respons */
+    int messages_latency_ms;    /* Tambahan khusus /messages (backfill dari server jauh) */
+    int jitter_ms;              /* Variasi acak +- pada latensi */
+    int rate_limit_permille;    /* Peluang 429 per request (per seribu) */
+    int error_permille;         /* Peluang 500 per request (per seribu) */
+    int retry_after_ms;         /* retry_after_ms pada 429, 0 = 100 */
+    const char *sync_replay_file;   /* NULL = initial sync kosong */
+    size_t sync_replay_bytes;   /* Ukuran target payload replay, 0 = apa adanya */
+    const char *as_token;       /* Token appservice (user_id= dan ts=), NULL = tanpa appservice */
+    const char *media_dir;      /* Penyimpanan media upload, NULL = endpoint media tidak ada */
+    const char *seed_user;      /* Anggota semua room awal (localpart atau user_id), NULL = tanpa room awal */
+    int seed_rooms;             /* Jumlah room awal */
+    int seed_members;           /* Anggota lain per room awal */
+    int seed_messages;          /* Rata-rata pesan per room awal */
+    unsigned seed;              /* Seed gangguan acak, 0 = 1 */
+    int verbose;                /* Cetak statistik ke stdout saat berhenti */
+} mock_homeserver_options;
+
+/* Menjalankan server di proses anak pada 127.0.0.1 port acak.
+   Mengembalikan port, -1 jika gagal */
+int mock_homeserver_start(const mock_homeserver_options* options, pid_t* pid);
+
+/* Menghentikan server (SIGTERM). Mengembalikan exit status anak */
+int mock_homeserver_stop(pid_t pid);
+
+/* Loop server pada listen_fd di proses saat ini sampai SIGTERM */
+int mock_homeserver_run(int listen_fd, const mock_homeserver_options* options);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MOCK_HOMESERVER_H
@@ -0,0 +1,1031 @@
+#define _GNU_SOURCE
+#include "mock_ircd.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <stdarg.h>
+#include <unistd.h>
+#include <signal.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+
+#define RECVQ      8192     /* Buffer masuk per klien; penuh saat tertahan = Excess Flood */
+#define HASH_SIZE  4096
+#define MAX_PARAMS 15
+#define HOST       "localhost"
+#define HISTORY_PAGE 100    /* CHATHISTORY=N di 005 */
+
+enum { CAP_MESSAGE_TAGS = 1, CAP_ECHO_MESSAGE = 2, CAP_SERVER_TIME = 4, CAP_BATCH = 8, CAP_CHATHISTORY = 16 };
+
+static const struct { const char *name; unsigned bit; } supported_caps[] = {
+    { "message-tags", CAP_MESSAGE_TAGS },
+    { "echo-message", CAP_ECHO_MESSAGE },
+    { "server-time",  CAP_SERVER_TIME },
+    { "batch",        CAP_BATCH },              /* Hanya dengan history_lines */
+    { "draft/chathistory", CAP_CHATHISTORY },
+};
+
+typedef struct Channel Channel;
+
+typedef struct Client {
+    int fd;
+    char nick[32];
+    char user[32];
+    int registered;
+    int cap_negotiating;
+    unsigned caps;
+    char in[RECVQ];
+    size_t in_len;
+    char *out;
+    size_t out_len, out_off, out_cap;
+    int dirty;              /* Ada di daftar flush */
+    int want_out;           /* EPOLLOUT terdaftar */
+    int throttled;          /* Tertahan penalti flood */
+    int closing;            /* Tutup setelah output terkirim */
+    int dead;
+    double tokens;
+    long refill_ms;
+    long last_ping_ms;
+    unsigned mark;          /* Untuk broadcast tanpa duplikat */
+    Channel **chans;
+    int nchans, chans_cap;
+    struct Client *nick_next;
+} Client;
+
+/* Pesan channel yang disimpan untuk CHATHISTORY */
+typedef struct {
+    char msgid[48];
+    char time[64];          /* Nilai tag time */
+    long long time_ms;
+    char source[80];        /* nick!user@host */
+    char cmd[8];
+    char text[512];
+} HistoryLine;
+
+struct Channel {
+    char name[64];
+    Client **members;
+    int count, cap;
+    HistoryLine *history;   /* Ring history_lines entri, dialokasikan saat pesan pertama */
+    int hist_head, hist_len;
+    Channel *next;
+};
+
+typedef struct {
+    const char *tags;       /* Tanpa '@', NULL jika tidak ada */
+    char *cmd;
+    char *params[MAX_PARAMS];
+    int np;
+} Msg;
+
+typedef struct {
+    mock_ircd_options opt;
+    const char *name;
+    int epfd, lfd;
+    Client **by_fd;
+    int by_fd_cap;
+    Client *nick_hash[HASH_SIZE];
+    Channel *chan_hash[HASH_SIZE];
+    Client **dirty;
+    int ndirty, dirty_cap;
+    Client **dead;
+    int ndead, dead_cap;
+    int nthrottled;
+    unsigned mark;
+    unsigned long clients, lines, relayed, throttle_events, killed;
+    unsigned long msgids;
+    unsigned long batches;
+} Server;
+
+static volatile sig_atomic_t stop_requested;
+
+static void on_sigterm(int sig) {
+    (void)sig;
+    stop_requested = 1;
+}
+
+static long now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000L + ts.tv_nsec / 1000000;
+}
+
+static unsigned hash_name(const char* s) {
+    unsigned h = 2166136261u;
+    for (; *s; s++) {
+        unsigned char ch = (unsigned char)*s;
+        if (ch >= 'A' && ch <= 'Z')
+            ch += 32;
+        h = (h ^ ch) * 16777619u;
+    }
+    return h & (HASH_SIZE - 1);
+}
+
+static int push_ptr(void*** arr, int* n, int* cap, void* p) {
+    if (*n == *cap) {
+        int ncap = *cap ? *cap * 2 : 16;
+        void **a = realloc(*arr, (size_t)ncap * sizeof(void*));
+        if (!a)
+            return -1;
+        *arr = a;
+        *cap = ncap;
+    }
+    (*arr)[(*n)++] = p;
+    return 0;
+}
+
+/* --- Output --- */
+
+static void append_out(Server* s, Client* c, const char* data, size_t len) {
+    if (c->dead)
+        return;
+    if (c->out_len + len > c->out_cap) {
+        if (c->out_off > 0) {
+            memmove(c->out, c->out + c->out_off, c->out_len - c->out_off);
+            c->out_len -= c->out_off;
+            c->out_off = 0;
+        }
+        if (c->out_len + len > c->out_cap) {
+            size_t cap = c->out_cap ? c->out_cap : 4096;
+            while (cap < c->out_len + len)
+                cap *= 2;
+            char *p = realloc(c->out, cap);
+            if (!p)
+                return;
+            c->out = p;
+            c->out_cap = cap;
+        }
+    }
+    memcpy(c->out + c->out_len, data, len);
+    c->out_len += len;
+    if (!c->dirty) {
+        c->dirty = 1;
+        push_ptr((void***)&s->dirty, &s->ndirty, &s->dirty_cap, c);
+    }
+}
+
+static void sendf(Server* s, Client* c, const char* fmt, ...) {
+    char buf[1024];
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(buf, sizeof(buf) - 2, fmt, ap);
+    va_end(ap);
+    if (n < 0)
+        return;
+    if (n > (int)sizeof(buf) - 3)
+        n = (int)sizeof(buf) - 3;
+    buf[n++] = '\r';
+    buf[n++] = '\n';
+    append_out(s, c, buf, (size_t)n);
+}
+
+static void numeric(Server* s, Client* c, const char* code, const char* fmt, ...) {
+    char text[900];
+    va_list ap;
+    va_start(ap, fmt);
+    vsnprintf(text, sizeof(text), fmt, ap);
+    va_end(ap);
+    sendf(s, c, ":%s %s %s %s", s->name, code, c->nick[0] ? c->nick : "*", text);
+}
+
+/* --- Nick dan channel --- */
+
+static Client* find_nick(Server* s, const char* nick) {
+    for (Client *c = s->nick_hash[hash_name(nick)]; c; c = c->nick_next)
+        if (strcasecmp(c->nick, nick) == 0)
+            return c;
+    return NULL;
+}
+
+static void unlink_nick(Server* s, Client* c) {
+    if (!c->nick[0])
+        return;
+    Client **pp = &s->nick_hash[hash_name(c->nick)];
+    for (; *pp; pp = &(*pp)->nick_next) {
+        if (*pp == c) {
+            *pp = c->nick_next;
+            break;
+        }
+    }
+    c->nick_next = NULL;
+}
+
+static void link_nick(Server* s, Client* c) {
+    unsigned h = hash_name(c->nick);
+    c->nick_next = s->nick_hash[h];
+    s->nick_hash[h] = c;
+}
+
+static Channel* find_channel(Server* s, const char* name, int create) {
+    unsigned h = hash_name(name);
+    for (Channel *ch = s->chan_hash[h]; ch; ch = ch->next)
+        if (strcasecmp(ch->name, name) == 0)
+            return ch;
+    if (!create)
+        return NULL;
+    Channel *ch = calloc(1, sizeof(Channel));
+    if (!ch)
+        return NULL;
+    snprintf(ch->name, sizeof(ch->name), "%s", name);
+    ch->next = s->chan_hash[h];
+    s->chan_hash[h] = ch;
+    return ch;
+}
+
+static int is_member(const Client* c, const Channel* ch) {
+    for (int i = 0; i < c->nchans; i++)
+        if (c->chans[i] == ch)
+            return 1;
+    return 0;
+}
+
+static void remove_member(Client* c, Channel* ch) {
+    for (int i = 0; i < ch->count; i++) {
+        if (ch->members[i] == c) {
+            ch->members[i] = ch->members[--ch->count];
+            break;
+        }
+    }
+    for (int i = 0; i < c->nchans; i++) {
+        if (c->chans[i] == ch) {
+            c->chans[i] = c->chans[--c->nchans];
+            break;
+        }
+    }
+}
+
+/* Mengirim baris ke semua anggota channel c (dan c sendiri jika include_self), sekali per klien */
+static void broadcast_peers(Server* s, Client* c, int include_self, const char* fmt, ...) {
+    char buf[1024];
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(buf, sizeof(buf) - 2, fmt, ap);
+    va_end(ap);
+    if (n < 0)
+        return;
+    if (n > (int)sizeof(buf) - 3)
+        n = (int)sizeof(buf) - 3;
+    buf[n++] = '\r';
+    buf[n++] = '\n';
+    unsigned mark = ++s->mark;
+    c->mark = mark;
+    if (include_self)
+        append_out(s, c, buf, (size_t)n);
+    for (int i = 0; i < c->nchans; i++) {
+        Channel *ch = c->chans[i];
+        for (int j = 0; j < ch->count; j++) {
+            Client *m = ch->members[j];
+            if (m->mark != mark) {
+                m->mark = mark;
+                append_out(s, m, buf, (size_t)n);
+            }
+        }
+    }
+}
+
+/* --- Siklus hidup klien --- */
+
+static void update_events(Server* s, Client* c, int want_out) {
+    if (c->want_out == want_out)
+        return;
+    struct epoll_event ev = { .events = EPOLLIN | (want_out ? EPOLLOUT : 0), .data.fd = c->fd };
+    epoll_ctl(s->epfd, EPOLL_CTL_MOD, c->fd, &ev);
+    c->want_out = want_out;
+}
+
+static void kill_client(Server* s, Client* c, const char* reason) {
+    if (c->dead)
+        return;
+    if (c->registered)
+        broadcast_peers(s, c, 0, ":%s!%s@" HOST " QUIT :%s", c->nick, c->user, reason);
+    while (c->nchans > 0) {
+        Channel *ch = c->chans[0];
+        remove_member(c, ch);
+    }
+    unlink_nick(s, c);
+    if (c->throttled)
+        s->nthrottled--;
+    c->throttled = 0;
+    c->dead = 1;
+    push_ptr((void***)&s->dead, &s->ndead, &s->dead_cap, c);
+}
+
+/* Mengirim ERROR lalu menutup koneksi setelah output terkirim */
+static void close_client(Server* s, Client* c, const char* reason) {
+    if (c->dead || c->closing)
+        return;
+    sendf(s, c, "ERROR :Closing Link: " HOST " (%s)", reason);
+    c->closing = 1;
+}
+
+static void reap_dead(Server* s) {
+    for (int i = 0; i < s->ndead; i++) {
+        Client *c = s->dead[i];
+        s->by_fd[c->fd] = NULL;
+        close(c->fd);
+        free(c->out);
+        free(c->chans);
+        free(c);
+    }
+    s->ndead = 0;
+}
+
+static void flush_client(Server* s, Client* c) {
+    while (!c->dead && c->out_off < c->out_len) {
+        ssize_t n = send(c->fd, c->out + c->out_off, c->out_len - c->out_off, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                update_events(s, c, 1);
+                return;
+            }
+            kill_client(s, c, "Write error");
+            return;
+        }
+        c->out_off += (size_t)n;
+    }
+    c->out_len = c->out_off = 0;
+    update_events(s, c, 0);
+    if (c->closing)
+        kill_client(s, c, "Client Quit");
+}
+
+static void flush_all(Server* s) {
+    /* Daftar bisa bertambah selama flush (QUIT ke anggota channel) */
+    for (int i = 0; i < s->ndirty; i++) {
+        Client *c = s->dirty[i];
+        c->dirty = 0;
+        if (!c->dead)
+            flush_client(s, c);
+    }
+    s->ndirty = 0;
+}
+
+/* --- Perintah --- */
+
+static int parse_msg(char* line, Msg* m) {
+    memset(m, 0, sizeof(*m));
+    char *p = line;
+    if (*p == '@') {
+        m->tags = p + 1;
+        p = strchr(p, ' ');
+        if (!p)
+            return -1;
+        *p++ = '\0';
+    }
+    while (*p == ' ')
+        p++;
+    if (*p == ':') {
+        p = strchr(p, ' ');
+        if (!p)
+            return -1;
+    }
+    while (*p == ' ')
+        p++;
+    if (!*p)
+        return -1;
+    m->cmd = p;
+    while (*p && *p != ' ')
+        p++;
+    while (*p) {
+        *p++ = '\0';
+        while (*p == ' ')
+            p++;
+        if (!*p)
+            break;
+        if (*p == ':' || m->np == MAX_PARAMS - 1) {
+            m->params[m->np++] = *p == ':' ? p + 1 : p;
+            break;
+        }
+        m->params[m->np++] = p;
+        while (*p && *p != ' ')
+            p++;
+    }
+    for (char *q = m->cmd; *q; q++)
+        if (*q >= 'a' && *q <= 'z')
+            *q -= 32;
+    return 0;
+}
+
+static void try_register(Server* s, Client* c) {
+    if (c->registered || c->cap_negotiating || !c->nick[0] || !c->user[0])
+        return;
+    c->registered = 1;
+    c->last_ping_ms = now_ms();
+    numeric(s, c, "001", ":Welcome to the mock IRC network %s!%s@" HOST, c->nick, c->user);
+    numeric(s, c, "002", ":Your host is %s, running mock-ircd", s->name);
+    numeric(s, c, "003", ":This server was created today");
+    numeric(s, c, "004", "%s mock-ircd io ntk", s->name);
+    if (s->opt.history_lines > 0)
+        numeric(s, c, "005", "CHANTYPES=# NICKLEN=30 CASEMAPPING=ascii NETWORK=Mock CHATHISTORY=%d "
+                "MSGREFTYPES=msgid,timestamp :are supported by this server", HISTORY_PAGE);
+    else
+        numeric(s, c, "005", "CHANTYPES=# NICKLEN=30 CASEMAPPING=ascii NETWORK=Mock :are supported by this server");
+    numeric(s, c, "375", ":- %s Message of the day -", s->name);
+    numeric(s, c, "372", ":- Server pengganti untuk test lokal");
+    numeric(s, c, "376", ":End of /MOTD command.");
+}
+
+static void cmd_cap(Server* s, Client* c, Msg* m) {
+    if (m->np < 1)
+        return;
+    if (strcasecmp(m->params[0], "LS") == 0) {
+        if (!c->registered)
+            c->cap_negotiating = 1;
+        sendf(s, c, ":%s CAP %s LS :message-tags echo-message server-time%s", s->name, c->nick[0] ? c->nick : "*",
+              s->opt.history_lines > 0 ? " batch draft/chathistory" : "");
+    } else if (strcasecmp(m->params[0], "REQ") == 0 && m->np >= 2) {
+        if (!c->registered)
+            c->cap_negotiating = 1;
+        char list[512];
+        snprintf(list, sizeof(list), "%s", m->params[1]);
+        unsigned add = 0;
+        int ok = 1;
+        for (char *save = NULL, *tok = strtok_r(list, " ", &save); tok; tok = strtok_r(NULL, " ", &save)) {
+            unsigned bit = 0;
+            for (size_t i = 0; i < sizeof(supported_caps) / sizeof(supported_caps[0]); i++)
+                if (strcmp(tok, supported_caps[i].name) == 0)
+                    bit = supported_caps[i].bit;
+            if ((bit & (CAP_BATCH | CAP_CHATHISTORY)) && s->opt.history_lines <= 0)
+                bit = 0;
+            if (!bit)
+                ok = 0;
+            add |= bit;
+        }
+        if (ok)
+            c->caps |= add;
+        sendf(s, c, ":%s CAP %s %s :%s", s->name, c->nick[0] ? c->nick : "*", ok ? "ACK" : "NAK", m->params[1]);
+    } else if (strcasecmp(m->params[0], "END") == 0) {
+        c->cap_negotiating = 0;
+        try_register(s, c);
+    }
+}
+
+static void cmd_nick(Server* s, Client* c, Msg* m) {
+    if (m->np < 1 || !m->params[0][0]) {
+        numeric(s, c, "431", ":No nickname given");
+        return;
+    }
+    const char *nick = m->params[0];
+    if (strlen(nick) >= sizeof(c->nick) || strchr(nick, '#') || strchr(nick, ',')) {
+        numeric(s, c, "432", "%s :Erroneous nickname", nick);
+        return;
+    }
+    Client *other = find_nick(s, nick);
+    if (other && other != c) {
+        numeric(s, c, "433", "%s :Nickname is already in use", nick);
+        return;
+    }
+    if (c->registered)
+        broadcast_peers(s, c, 1, ":%s!%s@" HOST " NICK :%s", c->nick, c->user, nick);
+    unlink_nick(s, c);
+    snprintf(c->nick, sizeof(c->nick), "%s", nick);
+    link_nick(s, c);
+    try_register(s, c);
+}
+
+static void send_names(Server* s, Client* c, Channel* ch) {
+    char line[400];
+    size_t len = 0;
+    for (int i = 0; i < ch->count; i++) {
+        size_t n = strlen(ch->members[i]->nick);
+        if (len + n + 2 > sizeof(line)) {
+            numeric(s, c, "353", "= %s :%s", ch->name, line);
+            len = 0;
+        }
+        len += (size_t)snprintf(line + len, sizeof(line) - len, "%s%s", len ? " " : "", ch->members[i]->nick);
+    }
+    if (len)
+        numeric(s, c, "353", "= %s :%s", ch->name, line);
+    numeric(s, c, "366", "%s :End of /NAMES list.", ch->name);
+}
+
+static void cmd_join(Server* s, Client* c, Msg* m) {
+    if (m->np < 1) {
+        numeric(s, c, "461", "JOIN :Not enough parameters");
+        return;
+    }
+    char list[512];
+    snprintf(list, sizeof(list), "%s", m->params[0]);
+    for (char *save = NULL, *name = strtok_r(list, ",", &save); name; name = strtok_r(NULL, ",", &save)) {
+        if (name[0] != '#' || strlen(name) >= sizeof(((Channel*)0)->name)) {
+            numeric(s, c, "403", "%s :No such channel", name);
+            continue;
+        }
+        Channel *ch = find_channel(s, name, 1);
+        if (!ch || is_member(c, ch))
+            continue;
+        if (push_ptr((void***)&ch->members, &ch->count, &ch->cap, c) != 0 ||
+            push_ptr((void***)&c->chans, &c->nchans, &c->chans_cap, ch) != 0)
+            continue;
+        char join[256];
+        int n = snprintf(join, sizeof(join), ":%s!%s@" HOST " JOIN %s\r\n", c->nick, c->user, ch->name);
+        for (int i = 0; i < ch->count; i++)
+            append_out(s, ch->members[i], join, (size_t)n);
+        send_names(s, c, ch);
+    }
+}
+
+static void cmd_part(Server* s, Client* c, Msg* m) {
+    if (m->np < 1)
+        return;
+    Channel *ch = find_channel(s, m->params[0], 0);
+    if (!ch || !is_member(c, ch)) {
+        numeric(s, c, "442", "%s :You're not on that channel", m->params[0]);
+        return;
+    }
+    char part[600];
+    int n = snprintf(part, sizeof(part), ":%s!%s@" HOST " PART %s :%s\r\n", c->nick, c->user, ch->name,
+                     m->np > 1 ? m->params[1] : "");
+    if (n > (int)sizeof(part) - 1)
+        n = (int)sizeof(part) - 1;
+    for (int i = 0; i < ch->count; i++)
+        append_out(s, ch->members[i], part, (size_t)n);
+    remove_member(c, ch);
+}
+
+/* Baris relay untuk satu kombinasi cap penerima (msgid dan tag klien, server-time) */
+static int build_relay(char* out, size_t size, unsigned variant, const Client* from, const char* cmd,
+                       const char* target, const char* text, const char* client_tags, const char* time_tag,
+                       const char* msgid_tag) {
+    size_t len = 0;
+    int tagged = 0;
+    if ((variant & CAP_SERVER_TIME) && time_tag) {
+        len += (size_t)snprintf(out + len, size - len, "@%s", time_tag);
+        tagged = 1;
+    }
+    if ((variant & CAP_MESSAGE_TAGS) && msgid_tag && len < size)
+        len += (size_t)snprintf(out + len, size - len, "%s%s", tagged++ ? ";" : "@", msgid_tag);
+    if ((variant & CAP_MESSAGE_TAGS) && client_tags && *client_tags && len < size)
+        len += (size_t)snprintf(out + len, size - len, "%s%s", tagged++ ? ";" : "@", client_tags);
+    if (len < size)
+        len += (size_t)snprintf(out + len, size - len, "%s:%s!%s@" HOST " %s %s :%s\r\n",
+                                tagged ? " " : "", from->nick, from->user, cmd, target, text);
+    if (len >= size - 1) {
+        len = size - 1;
+        out[len - 2] = '\r';
+        out[len - 1] = '\n';
+    }
+    return (int)len;
+}
+
+static void store_history(Server* s, Channel* ch, const Client* from, const char* cmd, const char* text,
+                          const char* time, long long time_ms, const char* msgid) {
+    int size = s->opt.history_lines;
+    if (size <= 0)
+        return;
+    if (!ch->history && !(ch->history = calloc((size_t)size, sizeof(HistoryLine))))
+        return;
+    HistoryLine *h = &ch->history[(ch->hist_head + ch->hist_len) % size];
+    if (ch->hist_len == size)
+        ch->hist_head = (ch->hist_head + 1) % size;
+    else
+        ch->hist_len++;
+    snprintf(h->msgid, sizeof(h->msgid), "%s", msgid);
+    snprintf(h->time, sizeof(h->time), "%s", time);
+    h->time_ms = time_ms;
+    snprintf(h->source, sizeof(h->source), "%s!%s@" HOST, from->nick, from->user);
+    snprintf(h->cmd, sizeof(h->cmd), "%s", cmd);
+    snprintf(h->text, sizeof(h->text), "%s", text);
+}
+
+static long long parse_timestamp(const char* value) {
+    struct tm tm = { 0 };
+    int ms = 0;
+    if (sscanf(value, "%d-%d-%dT%d:%d:%d.%dZ", &tm.tm_year, &tm.tm_mon, &tm.tm_mday, &tm.tm_hour, &tm.tm_min,
+               &tm.tm_sec, &ms) < 6)
+        return -1;
+    tm.tm_year -= 1900;
+    tm.tm_mon -= 1;
+    return (long long)timegm(&tm) * 1000 + ms;
+}
+
+/* CHATHISTORY AFTER <target> msgid=<id>|timestamp=<waktu> <limit>: pesan
+   setelah titik acuan dalam satu BATCH chathistory */
+static void cmd_chathistory(Server* s, Client* c, Msg* m) {
+    if (!(c->caps & CAP_CHATHISTORY)) {
+        numeric(s, c, "421", "CHATHISTORY :Unknown command");
+        return;
+    }
+    if (m->np < 4 || strcasecmp(m->params[0], "AFTER") != 0) {
+        sendf(s, c, ":%s FAIL CHATHISTORY INVALID_PARAMS %s :Only AFTER is supported", s->name,
+              m->np ? m->params[0] : "*");
+        return;
+    }
+    const char *target = m->params[1], *ref = m->params[2];
+    Channel *ch = find_channel(s, target, 0);
+    if (!ch || !is_member(c, ch)) {
+        sendf(s, c, ":%s FAIL CHATHISTORY INVALID_TARGET AFTER %s :Messages could not be retrieved", s->name,
+              target);
+        return;
+    }
+    int limit = atoi(m->params[3]);
+    if (limit <= 0 || limit > HISTORY_PAGE)
+        limit = HISTORY_PAGE;
+    int size = s->opt.history_lines, start = -1;
+    if (strncmp(ref, "msgid=", 6) == 0) {
+        for (int i = ch->hist_len - 1; i >= 0 && start < 0; i--)
+            if (strcmp(ch->history[(ch->hist_head + i) % size].msgid, ref + 6) == 0)
+                start = i + 1;
+        if (start < 0) {
+            sendf(s, c, ":%s FAIL CHATHISTORY INVALID_MSGREFID AFTER %s %s :Unknown msgid", s->name, target, ref);
+            return;
+        }
+    } else if (strncmp(ref, "timestamp=", 10) == 0) {
+        long long t = parse_timestamp(ref + 10);
+        if (t < 0) {
+            sendf(s, c, ":%s FAIL CHATHISTORY INVALID_PARAMS AFTER %s :Invalid timestamp", s->name, target);
+            return;
+        }
+        for (start = 0; start < ch->hist_len && ch->history[(ch->hist_head + start) % size].time_ms <= t; start++)
+            ;
+    } else {
+        sendf(s, c, ":%s FAIL CHATHISTORY INVALID_PARAMS AFTER %s :Invalid message reference", s->name, target);
+        return;
+    }
+    unsigned long batch = ++s->batches;
+    sendf(s, c, ":%s BATCH +h%lu chathistory %s", s->name, batch, ch->name);
+    for (int i = start; i < ch->hist_len && i < start + limit; i++) {
+        const HistoryLine *h = &ch->history[(ch->hist_head + i) % size];
+        char line[800];
+        int n = snprintf(line, sizeof(line), "@batch=h%lu;time=%s;msgid=%s :%s %s %s :%s\r\n", batch, h->time,
+                         h->msgid, h->source, h->cmd, ch->name, h->text);
+        if (n > (int)sizeof(line) - 1) {
+            n = (int)sizeof(line) - 1;
+            line[n - 2] = '\r';
+            line[n - 1] = '\n';
+        }
+        append_out(s, c, line, (size_t)n);
+    }
+    sendf(s, c, ":%s BATCH -h%lu", s->name, batch);
+}
+
+static void cmd_privmsg(Server* s, Client* c, Msg* m) {
+    int notice = strcmp(m->cmd, "NOTICE") == 0;
+    if (m->np < 2 || !m->params[1][0]) {
+        if (!notice)
+            numeric(s, c, "412", ":No text to send");
+        return;
+    }
+    const char *target = m->params[0], *text = m->params[1];
+
+    /* Tag klien yang diteruskan: hanya yang diawali '+' */
+    char client_tags[1024] = "";
+    if (m->tags) {
+        char tags[1024];
+        snprintf(tags, sizeof(tags), "%s", m->tags);
+        size_t len = 0;
+        for (char *save = NULL, *t = strtok_r(tags, ";", &save); t; t = strtok_r(NULL, ";", &save))
+            if (t[0] == '+' && len < sizeof(client_tags))
+                len += (size_t)snprintf(client_tags + len, sizeof(client_tags) - len, "%s%s", len ? ";" : "", t);
+    }
+    char time_tag[64];
+    struct timeval tv;
+    struct tm tm;
+    gettimeofday(&tv, NULL);
+    gmtime_r(&tv.tv_sec, &tm);
+    snprintf(time_tag, sizeof(time_tag), "time=%04d-%02d-%02dT%02d:%02d:%02d.%03dZ", tm.tm_year + 1900,
+             tm.tm_mon + 1, tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec, (int)(tv.tv_usec / 1000));
+    /* msgid sama untuk semua penerima pesan ini, sehingga penerima ganda bisa dedup */
+    char msgid_tag[48];
+    snprintf(msgid_tag, sizeof(msgid_tag), "msgid=%s-%lu", s->name, ++s->msgids);
+
+    char lines[4][1600];
+    int lens[4] = { -1, -1, -1, -1 };
+#define RELAY_TO(r) do { \
+        unsigned v_ = (r)->caps & (CAP_MESSAGE_TAGS | CAP_SERVER_TIME); \
+        unsigned i_ = (v_ & CAP_MESSAGE_TAGS ? 1 : 0) | (v_ & CAP_SERVER_TIME ? 2 : 0); \
+        if (lens[i_] < 0) \
+            lens[i_] = build_relay(lines[i_], sizeof(lines[i_]), v_, c, m->cmd, target, text, \
+                                   client_tags, time_tag, msgid_tag); \
+        append_out(s, (r), lines[i_], (size_t)lens[i_]); \
+        s->relayed++; \
+    } while (0)
+
+    if (target[0] == '#') {
+        Channel *ch = find_channel(s, target, 0);
+        if (!ch || !is_member(c, ch)) {
+            if (!notice)
+                numeric(s, c, "404", "%s :Cannot send to channel", target);
+            return;
+        }
+        store_history(s, ch, c, m->cmd, text, time_tag + 5, (long long)tv.tv_sec * 1000 + tv.tv_usec / 1000,
+                      msgid_tag + 6);
+        for (int i = 0; i < ch->count; i++) {
+            Client *r = ch->members[i];
+            if (r != c || (c->caps & CAP_ECHO_MESSAGE))
+                RELAY_TO(r);
+        }
+    } else {
+        Client *r = find_nick(s, target);
+        if (!r || !r->registered) {
+            if (!notice)
+                numeric(s, c, "401", "%s :No such nick/channel", target);
+            return;
+        }
+        RELAY_TO(r);
+        if (r != c && (c->caps & CAP_ECHO_MESSAGE))
+            RELAY_TO(c);
+    }
+#undef RELAY_TO
+}
+
+static void handle_line(Server* s, Client* c, char* line) {
+    Msg m;
+    if (parse_msg(line, &m) != 0)
+        return;
+    s->lines++;
+    const char *cmd = m.cmd;
+
+    if (strcmp(cmd, "CAP") == 0)
+        cmd_cap(s, c, &m);
+    else if (strcmp(cmd, "NICK") == 0)
+        cmd_nick(s, c, &m);
+    else if (strcmp(cmd, "USER") == 0) {
+        if (c->registered)
+            numeric(s, c, "462", ":You may not reregister");
+        else if (m.np < 4)
+            numeric(s, c, "461", "USER :Not enough parameters");
+        else {
+            snprintf(c->user, sizeof(c->user), "%s", m.params[0]);
+            try_register(s, c);
+        }
+    } else if (strcmp(cmd, "PING") == 0)
+        sendf(s, c, ":%s PONG %s :%s", s->name, s->name, m.np ? m.params[0] : "");
+    else if (strcmp(cmd, "PONG") == 0)
+        ;
+    else if (strcmp(cmd, "QUIT") == 0) {
+        if (c->registered)
+            broadcast_peers(s, c, 0, ":%s!%s@" HOST " QUIT :Quit: %s", c->nick, c->user, m.np ? m.params[0] : "");
+        while (c->nchans > 0)
+            remove_member(c, c->chans[0]);
+        close_client(s, c, "Client Quit");
+    } else if (!c->registered)
+        numeric(s, c, "451", ":You have not registered");
+    else if (strcmp(cmd, "JOIN") == 0)
+        cmd_join(s, c, &m);
+    else if (strcmp(cmd, "PART") == 0)
+        cmd_part(s, c, &m);
+    else if (strcmp(cmd, "PRIVMSG") == 0 || strcmp(cmd, "NOTICE") == 0)
+        cmd_privmsg(s, c, &m);
+    else if (strcmp(cmd, "CHATHISTORY") == 0)
+        cmd_chathistory(s, c, &m);
+    else
+        numeric(s, c, "421", "%s :Unknown command", cmd);
+}
+
+/* Memproses baris lengkap selama token flood masih ada */
+static void process_input(Server* s, Client* c) {
+    char *start = c->in, *end = c->in + c->in_len, *nl;
+    long now = s->opt.flood_burst > 0 ? now_ms() : 0;
+    int stalled = 0;
+    while (!c->dead && !c->closing && (nl = memchr(start, '\n', (size_t)(end - start))) != NULL) {
+        if (s->opt.flood_burst > 0) {
+            c->tokens += (now - c->refill_ms) * (double)s->opt.flood_rate / 1000.0;
+            if (c->tokens > s->opt.flood_burst)
+                c->tokens = s->opt.flood_burst;
+            c->refill_ms = now;
+            if (c->tokens < 1.0) {
+                if (!c->throttled) {
+                    c->throttled = 1;
+                    s->nthrottled++;
+                    s->throttle_events++;
+                }
+                stalled = 1;
+                break;
+            }
+            c->tokens -= 1.0;
+        }
+        *nl = '\0';
+        if (nl > start && nl[-1] == '\r')
+            nl[-1] = '\0';
+        handle_line(s, c, start);
+        start = nl + 1;
+    }
+    if (c->dead)
+        return;
+    if (c->throttled && !stalled) {
+        c->throttled = 0;
+        s->nthrottled--;
+    }
+    c->in_len = (size_t)(end - start);
+    memmove(c->in, start, c->in_len);
+    if (c->in_len == sizeof(c->in)) {
+        if (c->throttled) {
+            s->killed++;
+            kill_client(s, c, "Excess Flood");
+        } else {
+            c->in_len = 0;      /* Satu baris melebihi recvq: dibuang */
+        }
+    }
+}
+
+static void read_client(Server* s, Client* c) {
+    while (!c->dead && c->in_len < sizeof(c->in)) {
+        ssize_t n = recv(c->fd, c->in + c->in_len, sizeof(c->in) - c->in_len, 0);
+        if (n > 0) {
+            c->in_len += (size_t)n;
+            process_input(s, c);
+            continue;
+        }
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            return;
+        kill_client(s, c, n == 0 ? "Connection closed" : "Read error");
+        return;
+    }
+}
+
+static void accept_clients(Server* s) {
+    for (;;) {
+        int fd = accept4(s->lfd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0)
+            return;
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        if (fd >= s->by_fd_cap) {
+            int cap = s->by_fd_cap ? s->by_fd_cap : 256;
+            while (cap <= fd)
+                cap *= 2;
+            Client **p = realloc(s->by_fd, (size_t)cap * sizeof(Client*));
+            if (!p) {
+                close(fd);
+                continue;
+            }
+            memset(p + s->by_fd_cap, 0, (size_t)(cap - s->by_fd_cap) * sizeof(Client*));
+            s->by_fd = p;
+            s->by_fd_cap = cap;
+        }
+        Client *c = calloc(1, sizeof(Client));
+        struct epoll_event ev = { .events = EPOLLIN, .data.fd = fd };
+        if (!c || epoll_ctl(s->epfd, EPOLL_CTL_ADD, fd, &ev) != 0) {
+            free(c);
+            close(fd);
+            continue;
+        }
+        c->fd = fd;
+        c->tokens = s->opt.flood_burst;
+        c->refill_ms = now_ms();
+        s->by_fd[fd] = c;
+        s->clients++;
+    }
+}
+
+/* Timeout epoll: isi ulang token klien yang tertahan dan jadwal PING */
+static int next_timeout(const Server* s) {
+    int timeout = -1;
+    if (s->nthrottled > 0)
+        timeout = s->opt.flood_rate > 0 ? 1000 / s->opt.flood_rate + 1 : 100;
+    if (s->opt.ping_interval_ms > 0) {
+        int t = s->opt.ping_interval_ms / 4 + 1;
+        if (timeout < 0 || t < timeout)
+            timeout = t;
+    }
+    return timeout;
+}
+
+static void periodic(Server* s) {
+    long now = s->opt.ping_interval_ms > 0 ? now_ms() : 0;
+    if (s->nthrottled == 0 && !now)
+        return;
+    for (int fd = 0; fd < s->by_fd_cap; fd++) {
+        Client *c = s->by_fd[fd];
+        if (!c || c->dead)
+            continue;
+        if (c->throttled)
+            process_input(s, c);
+        if (now && c->registered && now - c->last_ping_ms >= s->opt.ping_interval_ms) {
+            sendf(s, c, "PING :%s", s->name);
+            c->last_ping_ms = now;
+        }
+    }
+}
+
+int mock_ircd_run(int listen_fd, const mock_ircd_options* options) {
+    Server *s = calloc(1, sizeof(Server));
+    if (!s)
+        return 1;
+    if (options)
+        s->opt = *options;
+    s->name = s->opt.server_name ? s->opt.server_name : "mock.localhost";
+    s->lfd = listen_fd;
+    fcntl(listen_fd, F_SETFL, fcntl(listen_fd, F_GETFL) | O_NONBLOCK);
+    s->epfd = epoll_create1(EPOLL_CLOEXEC);
+    struct epoll_event lev = { .events = EPOLLIN, .data.fd = listen_fd };
+    if (s->epfd < 0 || epoll_ctl(s->epfd, EPOLL_CTL_ADD, listen_fd, &lev) != 0) {
+        perror("mock-ircd: epoll");
+        free(s);
+        return 1;
+    }
+
+    /* SIGTERM hanya diterima di dalam epoll_pwait agar tidak terlewat */
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = on_sigterm;
+    sigaction(SIGTERM, &sa, NULL);
+    signal(SIGPIPE, SIG_IGN);
+    sigset_t block, wait_mask;
+    sigemptyset(&block);
+    sigaddset(&block, SIGTERM);
+    sigprocmask(SIG_BLOCK, &block, &wait_mask);
+    sigdelset(&wait_mask, SIGTERM);
+
+    struct epoll_event events[256];
+    while (!stop_requested) {
+        int n = epoll_pwait(s->epfd, events, 256, next_timeout(s), &wait_mask);
+        if (n < 0 && errno != EINTR) {
+            perror("mock-ircd: epoll_wait");
+            break;
+        }
+        for (int i = 0; i < n; i++) {
+            int fd = events[i].data.fd;
+            if (fd == listen_fd) {
+                accept_clients(s);
+                continue;
+            }
+            Client *c = fd < s->by_fd_cap ? s->by_fd[fd] : NULL;
+            if (!c || c->dead)
+                continue;
+            if (events[i].events & EPOLLOUT)
+                flush_client(s, c);
+            if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR))
+                read_client(s, c);
+        }
+        periodic(s);
+        flush_all(s);
+        reap_dead(s);
+    }
+
+    if (s->opt.verbose)
+        printf("[mock-ircd] klien=%lu baris=%lu relay=%lu tertahan=%lu excess-flood=%lu\n",
+               s->clients, s->lines, s->relayed, s->throttle_events, s->killed);
+    for (int fd = 0; fd < s->by_fd_cap; fd++) {
+        Client *c = s->by_fd[fd];
+        if (c && !c->dead) {
+            c->dead = 1;
+            push_ptr((void***)&s->dead, &s->ndead, &s->dead_cap, c);
+        }
+    }
+    reap_dead(s);
+    for (int h = 0; h < HASH_SIZE; h++) {
+        for (Channel *ch = s->chan_hash[h], *next; ch; ch = next) {
+            next = ch->next;
+            free(ch->members);
+            free(ch->history);
+            free(ch);
+        }
+    }
+    close(s->epfd);
+    free(s->by_fd);
+    free(s->dirty);
+    free(s->dead);
+    free(s);
+    return 0;
+}
+
+int mock_ircd_start(const mock_ircd_options* options, pid_t* pid) {
+    int lfd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    struct sockaddr_in addr;
+    socklen_t alen = sizeof(addr);
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (lfd < 0 || bind(lfd, (struct sockaddr*)&addr, sizeof(addr)) != 0 || listen(lfd, 1024) != 0 ||
+        getsockname(lfd, (struct sockaddr*)&addr, &alen) != 0) {
+        perror("mock-ircd: listen");
+        if (lfd >= 0)
+            close(lfd);
+        return -1;
+    }
+    fflush(stdout);
+    *pid = fork();
+    if (*pid < 0) {
+        close(lfd);
+        return -1;
+    }
+    if (*pid == 0) {
+        int rc = mock_ircd_run(lfd, options);
+        fflush(stdout);
+        _exit(rc);
+    }
+    close(lfd);
+    return ntohs(addr.sin_port);
+}
+
+int mock_ircd_stop(pid_t pid) {
+    int status;
+    if (pid <= 0 || kill(pid, SIGTERM) != 0 || waitpid(pid, &status, 0) != pid || !WIFEXITED(status))
+        return -1;
+    return WEXITSTATUS(status);
+}
@@ -0,0 +1,47 @@
+#ifndef MOCK_IRCD_H
+#define MOCK_IRCD_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <sys/types.h>
+
+/* IRCd pengganti untuk test dan benchmark di localhost.
+
+   Mendukung registrasi (CAP LS/REQ/END, NICK, USER, 001-005, MOTD),
+   JOIN/PART dengan NAMES, PRIVMSG/NOTICE ke channel dan nick (tag klien
+   "+..." diteruskan ke klien dengan message-tags), echo-message,
+   server-time, PING/PONG dua arah dan QUIT. Dengan history_lines, pesan
+   channel disimpan dan CHATHISTORY AFTER (draft/chathistory, dijawab
+   dalam BATCH dengan tag time dan msgid) didukung.
+
+   Penalti flood meniru ircd sungguhan: setiap perintah memakai satu token
+   dari bucket (burst, isi ulang rate per detik). Klien yang kehabisan
+   token tidak diproses sampai token terisi (fakelag); jika recvq-nya
+   penuh saat tertahan, koneksi diputus dengan "Excess Flood". */
+
+typedef struct {
+    const char *server_name;    /* NULL = "mock.localhost" */
+    int flood_burst;            /* 0 = tanpa penalti flood */
+    int flood_rate;             /* Token per detik setelah burst habis */
+    int ping_interval_ms;       /* Server mengirim PING ke klien, 0 = mati */
+    int verbose;                /* Cetak statistik ke stdout saat berhenti */
+    int history_lines;          /* Pesan terakhir yang disimpan per channel, 0 = tanpa CHATHISTORY */
+} mock_ircd_options;
+
+/* Menjalankan server di proses anak pada 127.0.0.1 port acak.
+   Mengembalikan port, -1 jika gagal */
+int mock_ircd_start(const mock_ircd_options* options, pid_t* pid);
+
+/* Menghentikan server (SIGTERM). Mengembalikan exit status anak */
+int mock_ircd_stop(pid_t pid);
+
+/* Loop server pada listen_fd di proses saat ini sampai SIGTERM */
+int mock_ircd_run(int listen_fd, const mock_ircd_options* options);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MOCK_IRCD_H
@@ -0,0 +1,267 @@
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <future>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include "berry_coro.hpp"
+#include "mock_homeserver.h"
+
+/* Test lapisan coroutine berry_coro.hpp: task (nilai, exception, task
+   kosong), schedule() dari banyak coroutine, channel, stop() yang
+   menghancurkan frame tersisa, lalu awaiter driver IRC (socketpair) dan
+   Matrix (send + matrix_sync) terhadap homeserver pengganti lokal. */
+
+static int failures = 0;
+
+static void check(bool ok, const char* what) {
+    std::printf("[%s] %s\n", ok ? "+" : "-", what);
+    if (!ok)
+        failures++;
+}
+
+static berry::task<> finish(berry::task<> t, std::shared_ptr<std::promise<void>> done) {
+    try {
+        co_await std::move(t);
+        done->set_value();
+    } catch (...) {
+        done->set_exception(std::current_exception());
+    }
+}
+
+/* Menjalankan task di executor dan menunggu selesai; false jika gagal/timeout */
+static bool run(berry::executor& ex, berry::task<> t, int timeout_sec = 10) {
+    auto done = std::make_shared<std::promise<void>>();
+    std::future<void> f = done->get_future();
+    berry::spawn(ex, finish(std::move(t), done));
+    if (f.wait_for(std::chrono::seconds(timeout_sec)) != std::future_status::ready)
+        return false;
+    try {
+        f.get();
+        return true;
+    } catch (const std::exception& e) {
+        std::fprintf(stderr, "Task gagal: %s\n", e.what());
+        return false;
+    }
+}
+
+static berry::task<int> add(int a, int b) {
+    co_return a + b;
+}
+
+static berry::task<int> fail() {
+    throw std::runtime_error("gagal");
+    co_return 0;
+}
+
+static void test_task(berry::executor& ex) {
+    int sum = 0;
+    bool thrown = false, empty = false;
+    check(run(ex, [&]() -> berry::task<> {
+        for (int i = 0; i < 100; i++)
+            sum += co_await add(i, 1);
+        try {
+            co_await fail();
+        } catch (const std::runtime_error&) {
+            thrown = true;
+        }
+        try {
+            co_await berry::task<int>{};
+        } catch (const std::logic_error&) {
+            empty = true;
+        }
+    }()), "task berjalan sampai selesai");
+    check(sum == 5050, "nilai co_return task bersarang");
+    check(thrown, "exception task diteruskan ke pemanggil");
+    check(empty, "co_await task kosong melempar logic_error");
+}
+
+static void test_schedule(berry::executor& ex) {
+    const int tasks = 2000, hops = 20;
+    std::atomic<int> done{0}, off_worker{0};
+    std::thread::id main_id = std::this_thread::get_id();
+    auto hop = [&]() -> berry::task<> {
+        for (int i = 0; i < hops; i++) {
+            co_await ex.schedule();
+            if (std::this_thread::get_id() == main_id)
+                off_worker++;
+        }
+        done++;
+    };
+    for (int i = 0; i < tasks; i++)
+        berry::spawn(ex, hop());
+    for (int i = 0; i < 1000 && done.load() < tasks; i++)
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    check(done.load() == tasks, "schedule() dari ribuan coroutine selesai semua");
+    check(off_worker.load() == 0, "coroutine dilanjutkan di thread worker");
+
+    berry::channel<int> ch(ex);
+    long got = 0;
+    bool closed = false;
+    std::thread producer;
+    check(run(ex, [&]() -> berry::task<> {
+        producer = std::thread([&] {
+            for (int i = 1; i <= 1000; i++)
+                ch.push(i);
+            ch.close();
+        });
+        for (;;) {
+            std::optional<int> v = co_await ch.next();
+            if (!v)
+                break;
+            got += *v;
+        }
+        closed = true;
+    }()) && closed, "channel berakhir dengan nullopt setelah close");
+    if (producer.joinable())
+        producer.join();
+    check(got == 500500, "channel mengantar semua item");
+}
+
+static berry::task<> hold(std::shared_ptr<int> token) {
+    (void)token;
+    co_return;
+}
+
+/* Menahan worker sampai release diset */
+static berry::task<> block(std::atomic<bool>* release, std::atomic<bool>* busy) {
+    *busy = true;
+    while (!release->load())
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    *busy = false;
+    co_return;
+}
+
+/* Frame yang masih mengantri saat stop() (atau di-post sesudahnya) dihancurkan */
+static void test_stop(void) {
+    auto token = std::make_shared<int>(0);
+    std::atomic<bool> busy{false}, release{false};
+    {
+        berry::executor ex(1);
+        /* Worker satu-satunya ditahan sampai stop() sudah dimulai */
+        berry::spawn(ex, block(&release, &busy));
+        for (int i = 0; i < 100; i++)
+            berry::spawn(ex, hold(token));
+        for (int i = 0; i < 1000 && !busy.load(); i++)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        check(busy.load() && token.use_count() == 101, "frame mengantri memegang token");
+        std::thread releaser([&] {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            release = true;
+        });
+        ex.stop();
+        releaser.join();
+        check(!busy.load() && token.use_count() == 1, "stop() menghancurkan frame yang masih mengantri");
+        berry::spawn(ex, hold(token));
+        check(token.use_count() == 1, "post setelah stop() menghancurkan frame");
+    }
+}
+
+static void test_irc(berry::executor& ex, berry::event_loop& io) {
+    int sv[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) != 0) {
+        check(false, "socketpair IRC");
+        return;
+    }
+    WINEIRC_handle *h = WINEIRC_create_fd(sv[0], "irc.local", 6667, "bridge", "bridge", "#coro", NULL, NULL);
+    if (!h) {
+        check(false, "handle IRC dari fd");
+        close(sv[0]);
+        close(sv[1]);
+        return;
+    }
+    const int n = 200;
+    int failed = 0;
+    {
+        berry::irc_client irc(ex, io, h);
+        check(run(ex, [&]() -> berry::task<> {
+            failed += co_await irc.join() != 0;
+            for (int i = 0; i < n; i++)
+                failed += co_await irc.send("pesan " + std::to_string(i)) != 0;
+            failed += co_await irc.send_tagged("+draft/reply=abc", "balasan") != 0;
+        }()), "awaiter IRC selesai");
+    }
+    check(failed == 0, "join/send/send_tagged mengembalikan 0");
+
+    std::string out;
+    char buf[4096];
+    fcntl(sv[1], F_SETFL, O_NONBLOCK);
+    for (ssize_t r; (r = read(sv[1], buf, sizeof(buf))) > 0;)
+        out.append(buf, (size_t)r);
+    size_t pos = out.find("JOIN #coro\r\n");
+    bool ordered = pos != std::string::npos;
+    for (int i = 0; ordered && i < n; i++) {
+        pos = out.find("PRIVMSG #coro :pesan " + std::to_string(i) + "\r\n", pos);
+        ordered = pos != std::string::npos;
+    }
+    check(ordered, "kiriman IRC tiba berurutan lewat strand");
+    check(out.find("@+draft/reply=abc PRIVMSG #coro :balasan\r\n") != std::string::npos, "kiriman bertag sampai");
+    WINEIRC_free(h);
+    close(sv[1]);
+}
+
+static void test_matrix(berry::executor& ex, berry::event_loop& io) {
+    mock_homeserver_options opt = {};
+    pid_t pid = -1;
+    int port = mock_homeserver_start(&opt, &pid);
+    check(port > 0, "homeserver pengganti berjalan");
+    if (port <= 0)
+        return;
+    std::string url = "http://127.0.0.1:" + std::to_string(port);
+    const std::string room = "!coro:localhost";
+    WINEMATRIX_handle *h = WINEMATRIX_create(url.c_str(), "bridge", "rahasia");
+    if (!h) {
+        check(false, "handle Matrix");
+        mock_homeserver_stop(pid);
+        return;
+    }
+    const int n = 20;
+    int failed = 0;
+    bool seen = false;
+    {
+        berry::matrix_client matrix(ex, io, h);
+        berry::matrix_sync sync(ex, h, 500);
+        check(run(ex, [&]() -> berry::task<> {
+            failed += co_await matrix.join_room(room) != 0;
+            for (int i = 0; i < n; i++)
+                failed += co_await matrix.send_message(room, "coro " + std::to_string(i), "test") != 0;
+            /* Pesan terakhir harus muncul di salah satu hasil /sync */
+            for (int i = 0; i < 10 * n && !seen; i++) {
+                std::optional<berry::sync_event> ev = co_await sync.next_event();
+                if (!ev)
+                    break;
+                seen = ev->body.find("coro " + std::to_string(n - 1)) != std::string::npos;
+            }
+        }(), 30), "awaiter Matrix selesai");
+    }
+    check(failed == 0, "join_room/send_message mengembalikan 0");
+    check(seen, "sync.next_event() memuat pesan yang dikirim");
+    WINEMATRIX_free(h);
+    mock_homeserver_stop(pid);
+}
+
+int main(void) {
+    if (WINEMATRIX_global_init() != 0) {
+        std::fprintf(stderr, "Gagal menyiapkan test\n");
+        return 1;
+    }
+    test_stop();
+    {
+        berry::executor ex(4);
+        berry::event_loop io(2);
+        test_task(ex);
+        test_schedule(ex);
+        test_irc(ex, io);
+        test_matrix(ex, io);
+    }
+    WINEMATRIX_global_cleanup();
+    std::printf("%s: %d gagal\n", failures ? "GAGAL" : "OK", failures);
+    return failures != 0;
+}
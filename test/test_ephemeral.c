@@ -0,0 +1,177 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <curl/curl.h>
+#include <json-c/json.h>
+#include "matrix_driver.h"
+#include "matrix_ephemeral.h"
+#include "mock_homeserver.h"
+
+/* Test pipeline ephemeral (matrix_ephemeral.h) terhadap homeserver
+   pengganti lokal: burst typing, read receipt dan presence didorong lewat
+   WINEMATRIX_ephemeral_* sambil di-poll seperti loop sync, lalu jumlah
+   PUT/POST yang sampai di server dihitung dari /_mock/stats. Presence
+   dengan kutip dan backslash di status_msg harus tersimpan apa adanya. */
+
+#define ROOM "!ephemeral:localhost"
+
+static int failures = 0;
+
+static void check(int ok, const char* what) {
+    printf("[%s] %s\n", ok ? "+" : "-", what);
+    if (!ok)
+        failures++;
+}
+
+static void sleep_ms(long ms) {
+    struct timespec ts = { ms / 1000, (ms % 1000) * 1000000L };
+    nanosleep(&ts, NULL);
+}
+
+/* Memanggil WINEMATRIX_ephemeral_poll setiap 10 ms selama ms */
+static void poll_for(WINEMATRIX_ephemeral* eph, long ms) {
+    for (long t = 0; t < ms; t += 10) {
+        WINEMATRIX_ephemeral_poll(eph);
+        sleep_ms(10);
+    }
+}
+
+static size_t collect(void* data, size_t size, size_t nmemb, void* user) {
+    size_t n = size * nmemb;
+    struct { char *p; size_t len; } *buf = user;
+    char *p = realloc(buf->p, buf->len + n + 1);
+    if (!p)
+        return 0;
+    memcpy(p + buf->len, data, n);
+    buf->p = p;
+    buf->len += n;
+    buf->p[buf->len] = '\0';
+    return n;
+}
+
+static json_object* get_json(const char* url) {
+    struct { char *p; size_t len; } buf = { NULL, 0 };
+    CURL *curl = curl_easy_init();
+    if (!curl)
+        return NULL;
+    curl_easy_setopt(curl, CURLOPT_URL, url);
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, collect);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &buf);
+    json_object *obj = curl_easy_perform(curl) == CURLE_OK && buf.p ? json_tokener_parse(buf.p) : NULL;
+    curl_easy_cleanup(curl);
+    free(buf.p);
+    return obj;
+}
+
+/* Counter server dari /_mock/stats, -1 jika gagal */
+static long server_count(const char* homeserver, const char* name) {
+    char url[256];
+    snprintf(url, sizeof(url), "%s/_mock/stats", homeserver);
+    json_object *stats = get_json(url), *v = NULL;
+    long n = stats && json_object_object_get_ex(stats, name, &v) ? (long)json_object_get_int64(v) : -1;
+    json_object_put(stats);
+    return n;
+}
+
+static void test_typing(WINEMATRIX_ephemeral* eph, const char* url) {
+    /* Start/stop bolak-balik lebih cepat dari debounce: hanya state akhir yang dikirim */
+    for (int i = 0; i < 100; i++)
+        WINEMATRIX_ephemeral_typing(eph, ROOM, NULL, i % 2 == 0);
+    WINEMATRIX_ephemeral_typing(eph, ROOM, NULL, 1);
+    check(WINEMATRIX_ephemeral_poll(eph) == 0, "typing belum dikirim sebelum debounce");
+    poll_for(eph, 300);
+    check(server_count(url, "typing") == 1, "burst typing menjadi satu PUT typing=true");
+
+    /* Sinyal typing berulang selama masih mengetik tidak menambah request */
+    for (int i = 0; i < 50; i++) {
+        WINEMATRIX_ephemeral_typing(eph, ROOM, NULL, 1);
+        WINEMATRIX_ephemeral_poll(eph);
+    }
+    check(server_count(url, "typing") == 1, "typing berulang digabung");
+
+    WINEMATRIX_ephemeral_typing(eph, ROOM, NULL, 0);
+    WINEMATRIX_ephemeral_typing(eph, ROOM, NULL, 1);
+    WINEMATRIX_ephemeral_typing(eph, ROOM, NULL, 0);
+    poll_for(eph, 300);
+    check(server_count(url, "typing") == 2, "stop/start/stop menjadi satu PUT typing=false");
+}
+
+static void test_receipts(WINEMATRIX_ephemeral* eph, const char* url) {
+    char event_id[64];
+    for (int i = 0; i < 200; i++) {
+        snprintf(event_id, sizeof(event_id), "$baca%d:localhost", i);
+        WINEMATRIX_ephemeral_read(eph, ROOM, event_id);
+        if (i % 20 == 0)
+            WINEMATRIX_ephemeral_poll(eph);
+    }
+    poll_for(eph, 400);
+    long markers = server_count(url, "read_markers");
+    /* Interval 200 ms: burst di atas paling banyak melewati satu-dua batas interval */
+    check(markers >= 1 && markers <= 2, "200 receipt digabung menjadi paling banyak 2 POST read_markers");
+    poll_for(eph, 300);
+    check(server_count(url, "read_markers") == markers, "tidak ada POST ulang tanpa receipt baru");
+}
+
+static void test_presence(WINEMATRIX_ephemeral* eph, WINEMATRIX_handle* h, const char* url) {
+    const char *status = "di \"rapat\" \\ kembali\", \"presence\": \"offline";
+    long before = server_count(url, "presence");
+    char msg[128];
+    /* 40 update dengan jarak 10 ms (400 ms) dan interval presence 250 ms */
+    for (int i = 0; i < 40; i++) {
+        snprintf(msg, sizeof(msg), "update %d", i);
+        WINEMATRIX_ephemeral_presence(eph, i % 2 ? "online" : "unavailable", i == 39 ? status : msg);
+        WINEMATRIX_ephemeral_poll(eph);
+        sleep_ms(10);
+    }
+    long sent = server_count(url, "presence") - before;
+    check(sent >= 1 && sent <= 3, "presence dibatasi laju (paling banyak 3 PUT untuk 40 update)");
+    WINEMATRIX_ephemeral_flush(eph);
+
+    char get_url[512];
+    snprintf(get_url, sizeof(get_url), "%s/_matrix/client/v3/presence/%s/status?access_token=%s",
+             url, h->username, h->access_token);
+    json_object *stored = get_json(get_url), *v = NULL;
+    const char *presence = stored && json_object_object_get_ex(stored, "presence", &v) ? json_object_get_string(v) : "";
+    const char *status_msg = stored && json_object_object_get_ex(stored, "status_msg", &v) ? json_object_get_string(v) : "";
+    check(strcmp(presence, "online") == 0 && strcmp(status_msg, status) == 0,
+          "status_msg dengan kutip dan backslash tersimpan apa adanya");
+    json_object_put(stored);
+}
+
+int main(void) {
+    if (WINEMATRIX_global_init() != 0) {
+        fprintf(stderr, "Gagal menyiapkan test\n");
+        return 1;
+    }
+    mock_homeserver_options opt = { 0 };
+    pid_t pid = -1;
+    int port = mock_homeserver_start(&opt, &pid);
+    check(port > 0, "homeserver pengganti berjalan");
+    if (port <= 0)
+        return 1;
+    char url[64];
+    snprintf(url, sizeof(url), "http://127.0.0.1:%d", port);
+    WINEMATRIX_handle *h = WINEMATRIX_create(url, "bridge", "rahasia");
+    WINEMATRIX_ephemeral_config cfg = { 0 };
+    cfg.typing_debounce_ms = 100;
+    cfg.receipt_interval_ms = 200;
+    cfg.presence_interval_ms = 250;
+    WINEMATRIX_ephemeral *eph = h ? WINEMATRIX_ephemeral_create(h, &cfg) : NULL;
+    if (!eph || WINEMATRIX_join_room(h, ROOM) != 0) {
+        check(0, "persiapan pipeline ephemeral");
+    } else {
+        test_typing(eph, url);
+        test_receipts(eph, url);
+        test_presence(eph, h, url);
+        WINEMATRIX_ephemeral_stats st;
+        WINEMATRIX_ephemeral_get_stats(eph, &st);
+        check(st.failed == 0 && st.coalesced > 0, "tidak ada request gagal, update digabung tercatat");
+    }
+    WINEMATRIX_ephemeral_free(eph);
+    WINEMATRIX_free(h);
+    mock_homeserver_stop(pid);
+    WINEMATRIX_global_cleanup();
+    printf("%s: %d gagal\n", failures ? "GAGAL" : "OK", failures);
+    return failures != 0;
+}
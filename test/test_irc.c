@@ -6,6 +6,10 @@
 #include <json-c/json.h>
 #include <sys/socket.h>
 #include "irc_driver.h"  // Pastikan path header sesuai
+#include "irc_parser.h"
+#include "echo_filter.h"
+#include "trigger.h"
+#include "mock_ircd.h"
 
 /* Struktur konfigurasi untuk IRC */
 typedef struct {
@@ -14,6 +18,9 @@ typedef struct {
     char *nick;
     char *user;
     char *channel;
+    int   tls;              /* Opsional: koneksi TLS (port 6697) */
+    char *sasl_account;     /* Opsional: login SASL SCRAM-SHA-256 */
+    char *sasl_password;
 } Config;
 
 /* Fungsi untuk memuat konfigurasi dari file JSON */
@@ -53,12 +60,18 @@ Config *load_config(const char *filename) {
     json_object *jnick   = json_object_object_get(jobj, "nick");
     json_object *juser   = json_object_object_get(jobj, "user");
     json_object *jchannel= json_object_object_get(jobj, "channel");
+    json_object *jtls    = json_object_object_get(jobj, "tls");
+    json_object *jsacc   = json_object_object_get(jobj, "sasl_account");
+    json_object *jspass  = json_object_object_get(jobj, "sasl_password");
     
     cfg->server  = strdup(json_object_get_string(jserver));
     cfg->port    = json_object_get_int(jport);
     cfg->nick    = strdup(json_object_get_string(jnick));
     cfg->user    = strdup(json_object_get_string(juser));
     cfg->channel = strdup(json_object_get_string(jchannel));
+    cfg->tls     = jtls ? json_object_get_boolean(jtls) : 0;
+    cfg->sasl_account  = jsacc ? strdup(json_object_get_string(jsacc)) : NULL;
+    cfg->sasl_password = jspass ? strdup(json_object_get_string(jspass)) : NULL;
     
     json_object_put(jobj);
     return cfg;
@@ -71,19 +84,117 @@ void free_config(Config *cfg) {
     free(cfg->nick);
     free(cfg->user);
     free(cfg->channel);
+    free(cfg->sasl_account);
+    free(cfg->sasl_password);
     free(cfg);
 }
 
-/* Fungsi utama test IRC */
-int main(void) {
+/* Trigger bot, sama dengan jalur Matrix di test_matrix.c */
+enum { TRIG_PING, TRIG_PONG };
+
+static const WINEB2B_trigger_def bot_triggers[] = {
+    { "ping", TRIG_PING, WINEB2B_TRIGGER_NOCASE | WINEB2B_TRIGGER_WORD },
+    { "pong", TRIG_PONG, WINEB2B_TRIGGER_NOCASE | WINEB2B_TRIGGER_WORD },
+};
+
+/* Memproses satu baris dari server: PRIVMSG dicek terhadap trigger */
+static void handle_line(WINEIRC_handle *handle, const WINEB2B_trigger_set *triggers, char *line) {
+    WINEIRC_message msg;
+    if (WINEIRC_parse_line(line, &msg) != 0 || strcmp(msg.command, "PRIVMSG") != 0 || msg.param_count < 2)
+        return;
+    /* Pesan hasil relay bridge tidak dibalas */
+    if (WINEIRC_message_tag(&msg, WINEB2B_ORIGIN_TAG))
+        return;
+    const char *text = msg.params[1];
+    switch (WINEB2B_trigger_first(triggers, text, strlen(text))) {
+    case TRIG_PING:
+        WINEIRC_send_message(handle, "pong");
+        break;
+    case TRIG_PONG:
+        WINEIRC_send_message(handle, "ping");
+        break;
+    }
+}
+
+/* Membaca data yang tersedia dan memproses baris lengkap; sisa baris yang
+   belum lengkap disimpan di buffer. 1 jika akhir NAMES (366) ikut terbaca,
+   yaitu JOIN bot sudah diproses server */
+static int process_input(WINEIRC_handle *handle, const WINEB2B_trigger_set *triggers,
+                         char *buffer, size_t size, size_t *used) {
+    /* Menggunakan MSG_DONTWAIT agar tidak blocking */
+    int bytes = WINEIRC_recv(handle, buffer + *used, size - 1 - *used, MSG_DONTWAIT);
+    if (bytes <= 0)
+        return 0;
+    int joined = 0;
+    *used += bytes;
+    buffer[*used] = '\0';
+    char *line = buffer, *eol;
+    while ((eol = strstr(line, "\r\n")) != NULL) {
+        *eol = '\0';
+        printf("[Received] %s\n", line);
+        WINEIRC_message msg;
+        char copy[1024];
+        snprintf(copy, sizeof(copy), "%s", line);
+        if (WINEIRC_parse_line(copy, &msg) == 0 && strcmp(msg.command, "366") == 0)
+            joined = 1;
+        handle_line(handle, triggers, line);
+        line = eol + 2;
+    }
+    *used -= line - buffer;
+    memmove(buffer, line, *used);
+    if (*used == size - 1)
+        *used = 0;   /* Baris terlalu panjang, buang */
+    return joined;
+}
+
+/* Mode --local: klien kedua di channel yang sama mengirim "ping" dan
+   menunggu balasan "pong" dari bot. 1 jika balasan sudah diterima */
+static int peer_got_pong(WINEIRC_handle *peer, char *buffer, size_t size, size_t *used) {
+    ssize_t n = WINEIRC_recv(peer, buffer + *used, size - 1 - *used, MSG_DONTWAIT);
+    if (n <= 0)
+        return 0;
+    *used += (size_t)n;
+    buffer[*used] = '\0';
+    if (strstr(buffer, " PRIVMSG ") && strstr(buffer, " :pong\r\n"))
+        return 1;
+    if (*used > size / 2) {
+        /* Simpan hanya baris terakhir yang belum lengkap */
+        char *last = strrchr(buffer, '\n');
+        size_t keep = last ? *used - (size_t)(last + 1 - buffer) : 0;
+        memmove(buffer, buffer + *used - keep, keep);
+        *used = keep;
+    }
+    return 0;
+}
+
+/* Fungsi utama test IRC. Argumen --local menjalankan mock IRCd lokal */
+int main(int argc, char **argv) {
     const char *config_filename = "config_irc.json";
+    int local = argc > 1 && strcmp(argv[1], "--local") == 0;
+    pid_t child = -1;
+    Config *cfg = NULL;
     
     if (WINEIRC_global_init() != 0) {
         fprintf(stderr, "Global init gagal\n");
         return -1;
     }
     
-    Config *cfg = load_config(config_filename);
+    if (local) {
+        mock_ircd_options opt = { .verbose = 1 };
+        int port = mock_ircd_start(&opt, &child);
+        if (port < 0) {
+            fprintf(stderr, "Gagal menjalankan mock IRCd\n");
+            return -1;
+        }
+        cfg = calloc(1, sizeof(Config));
+        cfg->server = strdup("127.0.0.1");
+        cfg->port = port;
+        cfg->nick = strdup("berry");
+        cfg->user = strdup("berry");
+        cfg->channel = strdup("#test");
+    } else {
+        cfg = load_config(config_filename);
+    }
     if (!cfg) {
         fprintf(stderr, "Gagal memuat konfigurasi\n");
         WINEIRC_global_cleanup();
@@ -94,15 +205,45 @@ int main(void) {
            cfg->server, cfg->port, cfg->nick, cfg->channel);
     
     /* Membuat handle koneksi IRC */
-    WINEIRC_handle *handle = WINEIRC_create(cfg->server, cfg->port, cfg->nick, cfg->user, cfg->channel);
+    WINEIRC_tls_options tls = { 0 };
+    WINEIRC_sasl sasl = { WINEIRC_SASL_SCRAM_SHA_256, cfg->sasl_account, cfg->sasl_password };
+    WINEIRC_handle *handle = WINEIRC_create_tls(cfg->server, cfg->port, cfg->nick, cfg->user, cfg->channel,
+                                                cfg->tls ? &tls : NULL,
+                                                cfg->sasl_account && cfg->sasl_password ? &sasl : NULL);
     if (!handle) {
         fprintf(stderr, "[-] Gagal membuat koneksi IRC\n");
         free_config(cfg);
+        mock_ircd_stop(child);
         WINEIRC_global_cleanup();
         return -1;
     }
     
     printf("[+] Terhubung dan join ke channel %s\n", cfg->channel);
+
+    WINEB2B_trigger_set *triggers = WINEB2B_trigger_compile(bot_triggers,
+                                        sizeof(bot_triggers) / sizeof(bot_triggers[0]));
+    char buffer[4096];
+    size_t used = 0;
+    WINEIRC_handle *peer = NULL;
+    char peer_buffer[4096];
+    size_t peer_used = 0;
+    int got_pong = 0;
+    if (local) {
+        /* Peer baru boleh mengirim setelah JOIN bot diproses server;
+           kalau tidak, "ping" bisa sampai ke channel sebelum bot ada di sana */
+        int joined = 0;
+        time_t wait_start = time(NULL);
+        while (!joined && time(NULL) - wait_start < 5) {
+            joined = process_input(handle, triggers, buffer, sizeof(buffer), &used);
+            if (!joined)
+                usleep(10000);
+        }
+        if (!joined)
+            fprintf(stderr, "[-] Bot belum join ke %s\n", cfg->channel);
+        peer = WINEIRC_create(cfg->server, cfg->port, "peer", "peer", cfg->channel);
+        if (!peer || WINEIRC_send_message(peer, "ping") != 0)
+            fprintf(stderr, "[-] Klien peer gagal\n");
+    }
     
     /* Kirim pesan test ke channel */
     if (WINEIRC_send_message(handle, "Hello from IRC test!") != 0) {
@@ -111,25 +252,29 @@ int main(void) {
         printf("[+] Pesan test terkirim\n");
     }
     
-    /* Loop mendengarkan pesan selama 30 detik */
-    printf("[+] Menerima pesan selama 30 detik...\n");
-    char buffer[512];
-    int bytes;
+    /* Mode lokal selesai begitu peer menerima "pong"; mode server nyata mendengarkan 30 detik */
+    int duration = local ? 5 : 30;
+    printf("[+] Menerima pesan selama %d detik...\n", duration);
     time_t start = time(NULL);
-    while (time(NULL) - start < 30) {
-        /* Menggunakan MSG_DONTWAIT agar tidak blocking */
-        bytes = recv(handle->socket_fd, buffer, sizeof(buffer) - 1, MSG_DONTWAIT);
-        if (bytes > 0) {
-            buffer[bytes] = '\0';
-            printf("[Received] %s", buffer);
-        }
-        usleep(100000); // Delay 100 ms
+    while (time(NULL) - start < duration && !got_pong) {
+        process_input(handle, triggers, buffer, sizeof(buffer), &used);
+        if (peer)
+            got_pong = peer_got_pong(peer, peer_buffer, sizeof(peer_buffer), &peer_used);
+        usleep(local ? 10000 : 100000); // Delay 10/100 ms
     }
+    WINEB2B_trigger_free(triggers);
     
     printf("[+] Selesai mendengarkan pesan. Disconnect...\n");
     WINEIRC_disconnect(handle);
     WINEIRC_free(handle);
+    WINEIRC_free(peer);
     free_config(cfg);
+    int rc = 0;
+    if (local) {
+        printf("[%s] Balasan pong diterima peer\n", got_pong ? "+" : "-");
+        if (mock_ircd_stop(child) != 0 || !got_pong)
+            rc = -1;
+    }
     WINEIRC_global_cleanup();
-    return 0;
+    return rc;
 }
\ No newline at end of file
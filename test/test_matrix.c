@@ -6,6 +6,9 @@
 #include <json-c/json.h>
 #include <time.h>
 #include "matrix_driver.h"
+#include "echo_filter.h"
+#include "matrix_ephemeral.h"
+#include "trigger.h"
 
 /* Struktur untuk menyimpan konfigurasi yang dibaca dari file JSON */
 typedef struct {
@@ -14,6 +17,7 @@ typedef struct {
     char *password;
     char *room_id;
     char *access_token;
+    int sliding_sync;   /* Opsional: 1 = sliding sync (room teraktif lebih dulu) */
 } Config;
 
 /* Fungsi untuk memuat konfigurasi dari file config.json */
@@ -53,6 +57,9 @@ Config *load_config(const char *filename) {
         cfg->access_token = strdup(json_object_get_string(jtoken));
     else
         cfg->access_token = strdup("");
+    json_object *jsliding = NULL;
+    cfg->sliding_sync = json_object_object_get_ex(jobj, "sliding_sync", &jsliding) &&
+                        json_object_get_boolean(jsliding);
 
     json_object_put(jobj);
     return cfg;
@@ -66,6 +73,8 @@ int save_config(const char *filename, Config *cfg) {
     json_object_object_add(jobj, "password", json_object_new_string(cfg->password));
     json_object_object_add(jobj, "room_id", json_object_new_string(cfg->room_id));
     json_object_object_add(jobj, "access_token", json_object_new_string(cfg->access_token));
+    if (cfg->sliding_sync)
+        json_object_object_add(jobj, "sliding_sync", json_object_new_boolean(1));
 
     const char *json_str = json_object_to_json_string_ext(jobj, JSON_C_TO_STRING_PRETTY);
     FILE *fp = fopen(filename, "w");
@@ -113,42 +122,90 @@ void send_reaction(WINEMATRIX_handle *h, const char *room_id, const char *event_
     WINEMATRIX_send_reaction(h, room_id, event_id, emoji);
 }
 
+/* Tabel trigger bot; dikompilasi sekali menjadi satu automaton */
+enum { TRIG_PING, TRIG_PONG, TRIG_ARCHANA, TRIG_BERRY };
+
+static const WINEB2B_trigger_def bot_triggers[] = {
+    { "ping",    TRIG_PING,    0 },
+    { "pong",    TRIG_PONG,    0 },
+    { "archana", TRIG_ARCHANA, 0 },
+    { "berry",   TRIG_BERRY,   0 },
+};
+
+/* Mengumpulkan trigger yang cocok sebagai bitmask */
+static int collect_trigger(int id, size_t start, size_t end, void *user) {
+    (void)start;
+    (void)end;
+    *(unsigned *)user |= 1u << id;
+    return 0;
+}
+
+/* Mengirim respons dengan penanda origin dan mencatatnya di filter echo */
+static void send_tracked(WINEMATRIX_handle *h, WINEB2B_echo_filter *echo, const char *room_id, const char *text) {
+    if (WINEMATRIX_send_message_origin(h, room_id, text, WINEB2B_echo_origin(echo)) == 0)
+        WINEB2B_echo_note(echo, "matrix", room_id, text);
+}
+
 /* Fungsi untuk mendengarkan pesan dan meresponnya */
-void listen_and_respond(WINEMATRIX_handle *h, const char *room_id, const char *username) {
+void listen_and_respond(WINEMATRIX_handle *h, WINEB2B_echo_filter *echo, WINEMATRIX_ephemeral *eph,
+                        const char *room_id, const char *username) {
     char sync_token[1024] = {0};
+    /* Lanjut dari token since tersimpan: pesan selama bot mati ikut diterima,
+       celah yang terlalu panjang diisi backfill */
+    const char *saved = h->store ? WINEMATRIX_store_since(h->store) : NULL;
+    if (saved)
+        strncpy(sync_token, saved, sizeof(sync_token) - 1);
+    int backfilled = 0;
+    WINEB2B_trigger_set *triggers = WINEB2B_trigger_compile(bot_triggers,
+                                        sizeof(bot_triggers) / sizeof(bot_triggers[0]));
     while (1) {
-        CURL *curl = curl_easy_init();
-        if (!curl) {
-            sleep(2);
-            continue;
-        }
-
-        char url[2048];
-        if (strlen(sync_token) > 0) {
-            snprintf(url, sizeof(url), "%s/_matrix/client/r0/sync?access_token=%s&since=%s&timeout=30000",
-                     h->homeserver, h->access_token, sync_token);
+        struct buffer buf = {0};
+        if (h->sliding) {
+            /* Sliding sync: room teraktif datang lebih dulu, sisanya menyusul di
+               putaran berikutnya. Respons sudah berbentuk /sync dan sudah masuk store */
+            if (WINEMATRIX_sync(h, NULL, 30000, &buf.data, NULL) != 0) {
+                sleep(2);
+                continue;
+            }
         } else {
-            snprintf(url, sizeof(url), "%s/_matrix/client/r0/sync?access_token=%s&timeout=30000",
-                     h->homeserver, h->access_token);
-        }
+            CURL *curl = curl_easy_init();
+            if (!curl) {
+                sleep(2);
+                continue;
+            }
 
-        struct buffer buf = {0};
-        curl_easy_setopt(curl, CURLOPT_URL, url);
-        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, buffer_callback);
-        curl_easy_setopt(curl, CURLOPT_WRITEDATA, &buf);
-        CURLcode res = curl_easy_perform(curl);
-        curl_easy_cleanup(curl);
-
-        if (res != CURLE_OK || buf.size == 0) {
-            free(buf.data);
-            sleep(2);
-            continue;
+            char url[2048];
+            if (strlen(sync_token) > 0) {
+                snprintf(url, sizeof(url), "%s/_matrix/client/r0/sync?access_token=%s&since=%s&timeout=30000",
+                         h->homeserver, h->access_token, sync_token);
+            } else {
+                snprintf(url, sizeof(url), "%s/_matrix/client/r0/sync?access_token=%s&timeout=30000",
+                         h->homeserver, h->access_token);
+            }
+
+            curl_easy_setopt(curl, CURLOPT_URL, url);
+            curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, buffer_callback);
+            curl_easy_setopt(curl, CURLOPT_WRITEDATA, &buf);
+            CURLcode res = curl_easy_perform(curl);
+            curl_easy_cleanup(curl);
+
+            if (res != CURLE_OK || buf.size == 0) {
+                free(buf.data);
+                sleep(2);
+                continue;
+            }
+            if (h->store)
+                WINEMATRIX_store_apply_sync(h->store, buf.data);
         }
 
         json_object *root = json_tokener_parse(buf.data);
         free(buf.data);
         if (!root)
             continue;
+        if (h->store && !backfilled) {
+            WINEMATRIX_backfill(h, &room_id, 1, NULL);
+            backfilled = 1;
+        }
 
         json_object *next_batch;
         if (json_object_object_get_ex(root, "next_batch", &next_batch)) {
@@ -177,18 +234,35 @@ void listen_and_respond(WINEMATRIX_handle *h, const char *room_id, const char *u
                     const char *from = json_object_get_string(sender);
                     const char *eid  = json_object_get_string(event_id);
 
-                    if (strcmp(from, username) != 0) {
+                    /* Penanda origin dari bridge (jika ada) di content */
+                    json_object *jorigin = NULL;
+                    const char *origin = NULL;
+                    if (json_object_object_get_ex(content, WINEB2B_ORIGIN_FIELD, &jorigin))
+                        origin = json_object_get_string(jorigin);
+
+                    if (strcmp(from, username) == 0) {
+                        continue;
+                    } else if (WINEB2B_echo_check(echo, "matrix", room_id, msg, origin)) {
+                        printf("[~] Echo dibuang (%llu pesan di route ini)\n",
+                               (unsigned long long)WINEB2B_echo_suppressed(echo, "matrix", room_id));
+                    } else {
                         printf("[+] Dapat pesan: %s\n", msg);
+                        /* Read receipt digabung dan dikirim berkala oleh pipeline ephemeral */
+                        WINEMATRIX_ephemeral_read(eph, room_id, eid);
+
+                        /* Semua trigger dicek dalam satu lintasan atas body pesan */
+                        unsigned hits = 0;
+                        WINEB2B_trigger_scan(triggers, msg, strlen(msg), collect_trigger, &hits);
 
                         /* Contoh respons: jika pesan mengandung "ping" atau "pong" */
-                        if (strstr(msg, "ping") != NULL) {
-                            WINEMATRIX_send_message(h, room_id, "pong");
-                        } else if (strstr(msg, "pong") != NULL) {
-                            WINEMATRIX_send_message(h, room_id, "ping");
+                        if (hits & (1u << TRIG_PING)) {
+                            send_tracked(h, echo, room_id, "pong");
+                        } else if (hits & (1u << TRIG_PONG)) {
+                            send_tracked(h, echo, room_id, "ping");
                         }
 
                         /* Jika pesan mengandung kata kunci tertentu, kirim reaction */
-                        if (strstr(msg, "archana") != NULL || strstr(msg, "berry") != NULL) {
+                        if (hits & ((1u << TRIG_ARCHANA) | (1u << TRIG_BERRY))) {
                             send_reaction(h, room_id, eid, "🫐");
                         }
                     }
@@ -197,6 +271,7 @@ void listen_and_respond(WINEMATRIX_handle *h, const char *room_id, const char *u
         }
 
         json_object_put(root);
+        WINEMATRIX_ephemeral_poll(eph);
         usleep(100000);
     }
 }
@@ -218,7 +293,7 @@ int main(void) {
     WINEMATRIX_handle *handle = NULL;
     /* Jika access_token sudah ada dan tidak kosong, gunakan token tersebut */
     if (cfg->access_token && strlen(cfg->access_token) > 0) {
-        handle = malloc(sizeof(WINEMATRIX_handle));
+        handle = calloc(1, sizeof(WINEMATRIX_handle));
         handle->homeserver   = strdup(cfg->homeserver);
         handle->username     = strdup(cfg->username);
         handle->password     = strdup(cfg->password);
@@ -241,12 +316,33 @@ int main(void) {
     }
 
     printf("[+] Login sukses. Access token: %s\n", handle->access_token);
+    if (cfg->sliding_sync && WINEMATRIX_use_sliding_sync(handle, NULL, 0) != 0)
+        fprintf(stderr, "[-] Gagal mengaktifkan sliding sync, memakai /sync biasa\n");
+    /* Riwayat room disimpan lokal untuk reply, edit dan scrollback */
+    if (WINEMATRIX_open_store(handle, "matrix_store") != 0)
+        fprintf(stderr, "[-] Gagal membuka event store, riwayat tidak disimpan\n");
+
     /* Join ke room */
     if (WINEMATRIX_join_room(handle, cfg->room_id) != 0)
         fprintf(stderr, "[-] Gagal join room %s\n", cfg->room_id);
 
+    /* Filter echo: origin instance ini diturunkan dari hostname */
+    char host[128] = "localhost";
+    char origin[160];
+    gethostname(host, sizeof(host) - 1);
+    snprintf(origin, sizeof(origin), "wineberry.%s", host);
+    WINEB2B_echo_filter *echo = WINEB2B_echo_create(origin, 60000, 4096);
+    if (!echo)
+        echo = WINEB2B_echo_create("wineberry", 60000, 4096);
+
+    WINEMATRIX_ephemeral *eph = WINEMATRIX_ephemeral_create(handle, NULL);
+    WINEMATRIX_ephemeral_presence(eph, "online", NULL);
+
     /* Mulai loop untuk mendengarkan dan merespon pesan */
-    listen_and_respond(handle, cfg->room_id, cfg->username);
+    listen_and_respond(handle, echo, eph, cfg->room_id, cfg->username);
+    WINEMATRIX_ephemeral_flush(eph);
+    WINEMATRIX_ephemeral_free(eph);
+    WINEB2B_echo_free(echo);
 
     /* Sebelum keluar, hapus access token pada file konfigurasi */
     free(cfg->access_token);
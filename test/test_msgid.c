@@ -0,0 +1,355 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <curl/curl.h>
+#include <json-c/json.h>
+#include "msgid_index.h"
+#include "irc_driver.h"
+#include "irc_parser.h"
+#include "matrix_driver.h"
+#include "echo_filter.h"
+#include "mock_homeserver.h"
+
+/* Test indeks msgid IRC <-> event_id Matrix (msgid_index.h) dan jalur relay
+   WINEMATRIX_relay_* terhadap homeserver pengganti lokal:
+   put/get dua arah, pemetaan ulang (reverse lama harus hilang, juga dari
+   disk setelah eviction), buka ulang store (termasuk log terpotong), lalu
+   relay pesan, reply, reaction dan redaction dengan ID pesan IRC, dan
+   txnId yang tidak berulang antar thread maupun antar proses (restart). */
+
+static int failures = 0;
+
+static void check(int ok, const char* what) {
+    printf("[%s] %s\n", ok ? "+" : "-", what);
+    if (!ok)
+        failures++;
+}
+
+/* 1 jika lookup id menghasilkan expect (expect NULL: harus tidak ditemukan) */
+static int maps_to(WINEB2B_msgid_index* idx, int from_irc, const char* id, const char* expect) {
+    char out[WINEB2B_MSGID_MAX + 1];
+    int ret = from_irc ? WINEB2B_msgid_index_get_matrix(idx, id, out, sizeof(out))
+                       : WINEB2B_msgid_index_get_irc(idx, id, out, sizeof(out));
+    return expect ? ret == 0 && strcmp(out, expect) == 0 : ret != 0;
+}
+
+static void test_memory(void) {
+    WINEB2B_msgid_index *idx = WINEB2B_msgid_index_create(16, NULL);
+    check(idx != NULL, "indeks memori dibuat");
+    if (!idx)
+        return;
+    WINEB2B_msgid_index_put(idx, "abc", "$1:localhost");
+    check(maps_to(idx, 1, "abc", "$1:localhost") && maps_to(idx, 0, "$1:localhost", "abc"), "put/get dua arah");
+
+    /* msgid yang sama dipetakan ke event baru (misal dikirim ulang) */
+    WINEB2B_msgid_index_put(idx, "abc", "$2:localhost");
+    check(maps_to(idx, 1, "abc", "$2:localhost") && maps_to(idx, 0, "$2:localhost", "abc") &&
+          maps_to(idx, 0, "$1:localhost", NULL), "remap sisi IRC membuang reverse lama");
+
+    /* event yang sama dipetakan ke msgid lain */
+    WINEB2B_msgid_index_put(idx, "def", "$2:localhost");
+    check(maps_to(idx, 0, "$2:localhost", "def") && maps_to(idx, 1, "abc", NULL), "remap sisi Matrix membuang forward lama");
+    WINEB2B_msgid_index_free(idx);
+}
+
+static void test_disk(const char* store) {
+    char irc[32], mx[32];
+    /* Kapasitas kecil: pemetaan awal hanya ada di disk saat di-remap */
+    WINEB2B_msgid_index *idx = WINEB2B_msgid_index_create(4, store);
+    check(idx != NULL, "indeks dengan store dibuat");
+    if (!idx)
+        return;
+    for (int i = 0; i < 100; i++) {
+        snprintf(irc, sizeof(irc), "m%d", i);
+        snprintf(mx, sizeof(mx), "$old%d:localhost", i);
+        WINEB2B_msgid_index_put(idx, irc, mx);
+    }
+    for (int i = 0; i < 10; i++) {
+        snprintf(irc, sizeof(irc), "m%d", i);
+        snprintf(mx, sizeof(mx), "$new%d:localhost", i);
+        WINEB2B_msgid_index_put(idx, irc, mx);
+    }
+    /* Isi memori digeser supaya lookup berikut dijawab dari disk */
+    for (int i = 90; i < 100; i++) {
+        snprintf(irc, sizeof(irc), "m%d", i);
+        maps_to(idx, 1, irc, NULL);
+    }
+    check(maps_to(idx, 1, "m50", "$old50:localhost") && maps_to(idx, 0, "$old50:localhost", "m50"),
+          "lookup dari disk setelah eviction");
+    check(maps_to(idx, 0, "$old3:localhost", NULL) && maps_to(idx, 0, "$new3:localhost", "m3") &&
+          maps_to(idx, 1, "m3", "$new3:localhost"), "reverse lama di disk tidak berlaku setelah remap");
+    WINEB2B_msgid_stats st;
+    WINEB2B_msgid_index_stats(idx, &st);
+    check(st.disk_hits > 0 && st.mem_entries <= 4, "statistik memori dan disk");
+    WINEB2B_msgid_index_free(idx);
+
+    /* Buka ulang, dengan record terpotong di akhir log (crash saat menulis) */
+    char log_path[512];
+    snprintf(log_path, sizeof(log_path), "%s.log", store);
+    int fd = open(log_path, O_WRONLY | O_APPEND);
+    if (fd >= 0) {
+        if (write(fd, "BMI", 3) != 3)
+            perror("write");
+        close(fd);
+    }
+    idx = WINEB2B_msgid_index_create(4, store);
+    check(idx && maps_to(idx, 1, "m77", "$old77:localhost") && maps_to(idx, 0, "$new9:localhost", "m9") &&
+          maps_to(idx, 0, "$old9:localhost", NULL), "buka ulang: pemetaan terbaru tetap, reverse lama tetap hilang");
+    if (idx) {
+        WINEB2B_msgid_index_put(idx, "m100", "$old100:localhost");
+        check(maps_to(idx, 1, "m100", "$old100:localhost"), "put setelah log terpotong");
+    }
+    WINEB2B_msgid_index_free(idx);
+}
+
+/* --- Relay lewat driver Matrix --- */
+
+static size_t collect(void* data, size_t size, size_t nmemb, void* user) {
+    size_t n = size * nmemb;
+    struct { char *p; size_t len; } *buf = user;
+    char *p = realloc(buf->p, buf->len + n + 1);
+    if (!p)
+        return 0;
+    memcpy(p + buf->len, data, n);
+    buf->p = p;
+    buf->len += n;
+    buf->p[buf->len] = '\0';
+    return n;
+}
+
+/* Event room (urutan stream), NULL jika gagal */
+static json_object* fetch_events(WINEMATRIX_handle* h, const char* room) {
+    char url[512];
+    snprintf(url, sizeof(url), "%s/_matrix/client/v3/rooms/%s/messages?dir=f&limit=100&access_token=%s",
+             h->homeserver, room, h->access_token);
+    struct { char *p; size_t len; } buf = { NULL, 0 };
+    CURL *curl = curl_easy_init();
+    if (!curl)
+        return NULL;
+    curl_easy_setopt(curl, CURLOPT_URL, url);
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, collect);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &buf);
+    json_object *obj = curl_easy_perform(curl) == CURLE_OK && buf.p ? json_tokener_parse(buf.p) : NULL;
+    curl_easy_cleanup(curl);
+    free(buf.p);
+    json_object *chunk = NULL;
+    if (obj && json_object_object_get_ex(obj, "chunk", &chunk))
+        json_object_get(chunk);
+    json_object_put(obj);
+    return chunk;
+}
+
+static const char* field(json_object* ev, const char* path) {
+    char key[64];
+    json_object *v = ev;
+    for (const char *p = path; v && *p;) {
+        size_t n = strcspn(p, "/");
+        snprintf(key, sizeof(key), "%.*s", (int)n, p);
+        if (!json_object_object_get_ex(v, key, &v))
+            return "";
+        p += n + (p[n] == '/');
+    }
+    return v ? json_object_get_string(v) : "";
+}
+
+/* --- txnId unik antar thread dan proses --- */
+
+#define TXN_THREADS 8
+#define TXN_SENDS 25
+
+struct txn_sender {
+    WINEMATRIX_handle *h;
+    int failed;
+};
+
+static void* txn_send_thread(void* arg) {
+    struct txn_sender *t = arg;
+    for (int i = 0; i < TXN_SENDS; i++)
+        if (WINEMATRIX_send_message(t->h, "!txn:localhost", "txn") != 0)
+            t->failed++;
+    return NULL;
+}
+
+/* Proses baru (txnId belum pernah dibuat) mengirim dari beberapa thread sekaligus */
+static int txn_burst_process(const char* url) {
+    pid_t pid = fork();
+    if (pid < 0)
+        return -1;
+    if (pid == 0) {
+        WINEMATRIX_handle *h = WINEMATRIX_create(url, "bridge", "rahasia");
+        if (!h || WINEMATRIX_join_room(h, "!txn:localhost") != 0)
+            _exit(1);
+        struct txn_sender senders[TXN_THREADS];
+        pthread_t threads[TXN_THREADS];
+        int failed = 0;
+        for (int i = 0; i < TXN_THREADS; i++) {
+            senders[i].h = h;
+            senders[i].failed = 0;
+            pthread_create(&threads[i], NULL, txn_send_thread, &senders[i]);
+        }
+        for (int i = 0; i < TXN_THREADS; i++) {
+            pthread_join(threads[i], NULL);
+            failed += senders[i].failed;
+        }
+        WINEMATRIX_free(h);
+        _exit(failed ? 1 : 0);
+    }
+    int status = 0;
+    if (waitpid(pid, &status, 0) != pid)
+        return -1;
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0 ? 0 : -1;
+}
+
+static long mock_stat(const char* url, const char* name) {
+    char stats_url[128];
+    snprintf(stats_url, sizeof(stats_url), "%s/_mock/stats", url);
+    struct { char *p; size_t len; } buf = { NULL, 0 };
+    CURL *curl = curl_easy_init();
+    if (!curl)
+        return -1;
+    curl_easy_setopt(curl, CURLOPT_URL, stats_url);
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, collect);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &buf);
+    json_object *obj = curl_easy_perform(curl) == CURLE_OK && buf.p ? json_tokener_parse(buf.p) : NULL, *v = NULL;
+    curl_easy_cleanup(curl);
+    free(buf.p);
+    long n = obj && json_object_object_get_ex(obj, name, &v) ? (long)json_object_get_int64(v) : -1;
+    json_object_put(obj);
+    return n;
+}
+
+static void test_txn_ids(void) {
+    mock_homeserver_options opt = { 0 };
+    pid_t pid = -1;
+    int port = mock_homeserver_start(&opt, &pid);
+    if (port <= 0) {
+        check(0, "homeserver pengganti untuk txnId");
+        return;
+    }
+    char url[64];
+    snprintf(url, sizeof(url), "http://127.0.0.1:%d", port);
+    /* Dua proses berturut-turut, seperti bridge yang di-restart segera. Keduanya
+       hasil fork dari proses ini, yang sudah membuat txnId di test_relay */
+    check(txn_burst_process(url) == 0 && txn_burst_process(url) == 0, "kiriman dari banyak thread di dua proses berhasil");
+    check(mock_stat(url, "dedup") == 0 && mock_stat(url, "send") == 2 * TXN_THREADS * TXN_SENDS,
+          "tidak ada txnId yang dianggap retry oleh homeserver");
+    mock_homeserver_stop(pid);
+}
+
+static void test_relay(const char* store) {
+    mock_homeserver_options opt = { 0 };
+    pid_t pid = -1;
+    int port = mock_homeserver_start(&opt, &pid);
+    check(port > 0, "homeserver pengganti berjalan");
+    if (port <= 0)
+        return;
+    char url[64];
+    snprintf(url, sizeof(url), "http://127.0.0.1:%d", port);
+    const char *room = "!relay:localhost";
+    WINEMATRIX_handle *h = WINEMATRIX_create(url, "bridge", "rahasia");
+    /* Handle IRC hanya untuk WINEIRC_message_id; socket tidak dipakai */
+    int sv[2] = { -1, -1 };
+    WINEIRC_handle *irc = socketpair(AF_UNIX, SOCK_STREAM, 0, sv) == 0 ?
+        WINEIRC_create_fd(sv[0], "irc.local", 6667, "bridge", "bridge", "#relay", NULL, NULL) : NULL;
+    WINEB2B_msgid_index *idx = WINEB2B_msgid_index_create(64, store);
+    if (!h || !irc || !idx || WINEMATRIX_join_room(h, room) != 0 || WINEMATRIX_map_message_ids(h, idx) != 0) {
+        check(0, "persiapan relay");
+        goto out;
+    }
+
+    /* Pesan IRC dengan tag msgid dan tanpa msgid (ID sintetis stabil) */
+    char line1[] = "@msgid=Xa1;time=2026-10-19T10:00:00.000Z :alice!a@h PRIVMSG #relay :halo";
+    char line2[] = "@time=2026-10-19T10:00:01.000Z :bob!b@h PRIVMSG #relay :tanpa msgid";
+    char line2b[] = "@time=2026-10-19T10:00:01.000Z :bob!b@h PRIVMSG #relay :tanpa msgid";
+    WINEIRC_message m1, m2, m2b;
+    char id1[WINEB2B_MSGID_MAX + 1], id2[WINEB2B_MSGID_MAX + 1], id2b[WINEB2B_MSGID_MAX + 1];
+    WINEIRC_parse_line(line1, &m1);
+    WINEIRC_parse_line(line2, &m2);
+    WINEIRC_parse_line(line2b, &m2b);
+    check(WINEIRC_message_id(irc, &m1, id1, sizeof(id1)) == 0 && strcmp(id1, "Xa1") == 0 &&
+          WINEIRC_message_id(irc, &m2, id2, sizeof(id2)) == 0 && id2[0] == '~' &&
+          WINEIRC_message_id(irc, &m2b, id2b, sizeof(id2b)) == 0 && strcmp(id2, id2b) == 0,
+          "ID pesan IRC dari tag msgid dan ID sintetis");
+
+    char ev1[WINEB2B_MSGID_MAX + 1] = "", ev2[WINEB2B_MSGID_MAX + 1] = "";
+    check(WINEMATRIX_relay_message(h, room, m1.params[1], "test", id1) == 0 &&
+          WINEMATRIX_relay_message(h, room, m2.params[1], "test", id2) == 0 &&
+          WINEB2B_msgid_index_get_matrix(idx, id1, ev1, sizeof(ev1)) == 0 &&
+          WINEB2B_msgid_index_get_matrix(idx, id2, ev2, sizeof(ev2)) == 0 && maps_to(idx, 0, ev1, id1),
+          "relay pesan mencatat event_id");
+    /* Teks IRC dengan kutip dan backslash tidak boleh menambah key ke content */
+    const char *evil = "a\\\", \"" WINEB2B_ORIGIN_FIELD "\": \"palsu\", \"m.relates_to\": {\"x\": \"";
+    check(WINEMATRIX_relay_message(h, room, evil, "test", "Xa3") == 0 &&
+          WINEMATRIX_relay_reply(h, room, "tidak-dikenal", "halo", evil, "test", "Xa4") == 0,
+          "relay teks dengan kutip dan backslash");
+    check(WINEMATRIX_relay_reply(h, room, id1, "halo", "balasan", "test", "Xa2") == 0 &&
+          WINEMATRIX_relay_reaction(h, room, id2, "+1") == 0 &&
+          WINEMATRIX_relay_redact(h, room, id1, "dihapus di IRC") == 0,
+          "relay reply, reaction dan redaction dengan ID IRC");
+    check(WINEMATRIX_relay_redact(h, room, "tidak-dikenal", "x") != 0, "redaction ID yang tidak dikenal ditolak");
+
+    json_object *events = fetch_events(h, room);
+    int reply = 0, reaction = 0, redaction = 0, verbatim = 0, injected = 0;
+    for (size_t i = 0; events && i < json_object_array_length(events); i++) {
+        json_object *ev = json_object_array_get_idx(events, i);
+        const char *type = field(ev, "type");
+        /* Event yang sudah di-redact tidak punya content lagi */
+        if (strcmp(type, "m.room.message") == 0 && field(ev, "content/body")[0]) {
+            if (strcmp(field(ev, "content/" WINEB2B_ORIGIN_FIELD), "test") != 0 ||
+                field(ev, "content/m.relates_to/x")[0])
+                injected++;
+            if (strcmp(field(ev, "content/body"), evil) == 0)
+                verbatim++;
+        }
+        if (strcmp(type, "m.room.message") == 0 &&
+            strcmp(field(ev, "content/m.relates_to/m.in_reply_to/event_id"), ev1) == 0)
+            reply = 1;
+        else if (strcmp(type, "m.reaction") == 0 && strcmp(field(ev, "content/m.relates_to/event_id"), ev2) == 0)
+            reaction = 1;
+        else if (strcmp(type, "m.room.redaction") == 0 && strcmp(field(ev, "redacts"), ev1) == 0)
+            redaction = 1;
+    }
+    json_object_put(events);
+    check(reply && reaction && redaction, "timeline Matrix memuat relasi ke event yang benar");
+    check(verbatim == 2 && injected == 0, "teks relay utuh, semua pesan dan reply membawa origin bridge");
+
+out:
+    WINEB2B_msgid_index_free(idx);
+    WINEIRC_free(irc);
+    if (sv[1] >= 0)
+        close(sv[1]);
+    WINEMATRIX_free(h);
+    mock_homeserver_stop(pid);
+}
+
+int main(void) {
+    char dir[] = "/tmp/berry_msgid_XXXXXX";
+    if (!mkdtemp(dir) || WINEMATRIX_global_init() != 0) {
+        fprintf(stderr, "Gagal menyiapkan test\n");
+        return 1;
+    }
+    char store[256], relay_store[256];
+    snprintf(store, sizeof(store), "%s/msgid", dir);
+    snprintf(relay_store, sizeof(relay_store), "%s/relay", dir);
+
+    test_memory();
+    test_disk(store);
+    test_relay(relay_store);
+    test_txn_ids();
+
+    const char *suffix[] = { "msgid.log", "msgid.idx", "relay.log", "relay.idx" };
+    for (size_t i = 0; i < sizeof(suffix) / sizeof(suffix[0]); i++) {
+        char path[300];
+        snprintf(path, sizeof(path), "%s/%s", dir, suffix[i]);
+        unlink(path);
+    }
+    rmdir(dir);
+    WINEMATRIX_global_cleanup();
+    printf("%s: %d gagal\n", failures ? "GAGAL" : "OK", failures);
+    return failures != 0;
+}
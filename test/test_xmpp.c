@@ -0,0 +1,493 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <poll.h>
+#include <json-c/json.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include "xmpp_driver.h"
+#include "xmpp_sasl.h"
+#include "xmpp_sm.h"
+#include "trigger.h"
+
+/* Struktur konfigurasi untuk XMPP */
+typedef struct {
+    char *server;
+    int   port;
+    char *jid;
+    char *password;
+    char *resource;
+    char *room;
+    char *nick;
+} Config;
+
+/* Fungsi untuk memuat konfigurasi dari file JSON */
+Config *load_config(const char *filename) {
+    FILE *fp = fopen(filename, "r");
+    if (!fp) {
+        perror("Gagal membuka file konfigurasi");
+        return NULL;
+    }
+    fseek(fp, 0, SEEK_END);
+    long fsize = ftell(fp);
+    rewind(fp);
+    char *data = malloc(fsize + 1);
+    if (!data) {
+        fclose(fp);
+        return NULL;
+    }
+    fread(data, 1, fsize, fp);
+    data[fsize] = '\0';
+    fclose(fp);
+
+    json_object *jobj = json_tokener_parse(data);
+    free(data);
+    if (!jobj) {
+        fprintf(stderr, "Gagal parse JSON\n");
+        return NULL;
+    }
+
+    Config *cfg = malloc(sizeof(Config));
+    if (!cfg) {
+        json_object_put(jobj);
+        return NULL;
+    }
+
+    cfg->server   = strdup(json_object_get_string(json_object_object_get(jobj, "server")));
+    cfg->port     = json_object_get_int(json_object_object_get(jobj, "port"));
+    cfg->jid      = strdup(json_object_get_string(json_object_object_get(jobj, "jid")));
+    cfg->password = strdup(json_object_get_string(json_object_object_get(jobj, "password")));
+    cfg->resource = strdup(json_object_get_string(json_object_object_get(jobj, "resource")));
+    cfg->room     = strdup(json_object_get_string(json_object_object_get(jobj, "room")));
+    cfg->nick     = strdup(json_object_get_string(json_object_object_get(jobj, "nick")));
+
+    json_object_put(jobj);
+    return cfg;
+}
+
+/* Fungsi untuk membebaskan konfigurasi */
+void free_config(Config *cfg) {
+    if (!cfg) return;
+    free(cfg->server);
+    free(cfg->jid);
+    free(cfg->password);
+    free(cfg->resource);
+    free(cfg->room);
+    free(cfg->nick);
+    free(cfg);
+}
+
+/* ------------------------------------------------------------------
+   Server XMPP pengganti untuk mode --local: SASL PLAIN (bot/secret),
+   bind, stream management (XEP-0198) dengan resume, MUC dengan
+   self-presence, ping ke klien, jawaban self-ping, dan memantulkan pesan
+   groupchat. Pesan "lost-N" sengaja tidak dihitung lalu koneksi diputus,
+   sehingga klien harus me-resume sesi dan mengirim ulang pesan tersebut.
+   Ditulis dengan parser yang sama, dan setiap kiriman dipecah dua agar
+   tag terpotong di antara recv().
+   ------------------------------------------------------------------ */
+#define LOCAL_DOMAIN "localhost"
+#define LOCAL_ROOM   "room@conference.localhost"
+#define LOCAL_SM_ID  "standin-sm-1"
+
+typedef struct {
+    int fd;
+    WINEXMPP_parser *parser;
+    int authed;             /* Per koneksi */
+    int bound;
+    int ping_ok;
+    int echoed;
+    int self_pinged;
+    int resumed;
+    int lost_seen;          /* Pesan lost-N pada koneksi pertama */
+    int lost_echoed;        /* Pesan lost-N yang diterima ulang setelah resume */
+    int drop;               /* Putuskan koneksi setelah kiriman ini */
+    int done;
+    int sm_on;
+    unsigned h_in;          /* Stanza dari klien yang sudah ditangani */
+    char occupant[256];
+} StandIn;
+
+static void stand_in_send(StandIn *s, const char *xml) {
+    size_t len = strlen(xml), half = len / 2;
+    send(s->fd, xml, half, MSG_NOSIGNAL);
+    usleep(2000);
+    send(s->fd, xml + half, len - half, MSG_NOSIGNAL);
+}
+
+static void stand_in_stream_start(void *user, const WINEXMPP_stanza *stream) {
+    StandIn *s = user;
+    (void)stream;
+    stand_in_send(s, "<?xml version='1.0'?><stream:stream from='" LOCAL_DOMAIN "' id='standin' version='1.0' "
+                     "xmlns='jabber:client' xmlns:stream='http://etherx.jabber.org/streams'>");
+    if (!s->authed)
+        stand_in_send(s, "<stream:features><mechanisms xmlns='" WINEXMPP_NS_SASL "'>"
+                         "<mechanism>SCRAM-SHA-1</mechanism><mechanism>PLAIN</mechanism>"
+                         "</mechanisms></stream:features>");
+    else
+        stand_in_send(s, "<stream:features><bind xmlns='" WINEXMPP_NS_BIND "'/>"
+                         "<sm xmlns='" WINEXMPP_NS_SM "'/></stream:features>");
+}
+
+static void stand_in_sm(StandIn *s, const WINEXMPP_stanza *st) {
+    char buffer[256];
+    if (strcmp(st->name, "enable") == 0) {
+        s->sm_on = 1;
+        s->h_in = 0;
+        stand_in_send(s, "<enabled xmlns='" WINEXMPP_NS_SM "' id='" LOCAL_SM_ID "' resume='true' max='300'/>");
+    } else if (strcmp(st->name, "r") == 0) {
+        snprintf(buffer, sizeof(buffer), "<a xmlns='" WINEXMPP_NS_SM "' h='%u'/>", s->h_in);
+        stand_in_send(s, buffer);
+    } else if (strcmp(st->name, "resume") == 0) {
+        const char *previd = WINEXMPP_stanza_attr(st, "previd");
+        if (s->sm_on && previd && strcmp(previd, LOCAL_SM_ID) == 0) {
+            s->resumed = 1;
+            snprintf(buffer, sizeof(buffer), "<resumed xmlns='" WINEXMPP_NS_SM "' h='%u' previd='%s'/>",
+                     s->h_in, LOCAL_SM_ID);
+            stand_in_send(s, buffer);
+        } else {
+            stand_in_send(s, "<failed xmlns='" WINEXMPP_NS_SM "'><item-not-found xmlns='urn:ietf:params:xml:ns:xmpp-stanzas'/></failed>");
+        }
+    }
+}
+
+static void stand_in_stanza(void *user, const WINEXMPP_stanza *st) {
+    StandIn *s = user;
+    char buffer[2048];
+    const char *type = WINEXMPP_stanza_attr(st, "type");
+    int counted = 1;
+
+    if (strcmp(st->ns, WINEXMPP_NS_SM) == 0) {
+        stand_in_sm(s, st);
+        return;
+    }
+    if (strcmp(st->name, "auth") == 0) {
+        unsigned char raw[256];
+        int n = WINEXMPP_base64_decode(st->text, raw, sizeof(raw));
+        if (n == 11 && memcmp(raw, "\0bot\0secret", 11) == 0) {
+            s->authed = 1;
+            stand_in_send(s, "<success xmlns='" WINEXMPP_NS_SASL "'/>");
+            WINEXMPP_parser_reset(s->parser);
+        } else {
+            stand_in_send(s, "<failure xmlns='" WINEXMPP_NS_SASL "'><not-authorized/></failure>");
+        }
+        return;
+    } else if (strcmp(st->name, "iq") == 0 && type && strcmp(type, "set") == 0 &&
+               WINEXMPP_stanza_child(st, "bind", WINEXMPP_NS_BIND)) {
+        const char *res = WINEXMPP_stanza_child_text(WINEXMPP_stanza_child(st, "bind", NULL), "resource");
+        snprintf(buffer, sizeof(buffer),
+                 "<iq type='result' id='%s'><bind xmlns='" WINEXMPP_NS_BIND "'><jid>bot@" LOCAL_DOMAIN "/%s</jid></bind></iq>",
+                 WINEXMPP_stanza_attr(st, "id"), res ? res : "x");
+        s->bound = 1;
+        stand_in_send(s, buffer);
+        return;     /* Dikirim sebelum <enable/>, tidak dihitung */
+    } else if (strcmp(st->name, "iq") == 0 && type && strcmp(type, "result") == 0) {
+        const char *id = WINEXMPP_stanza_attr(st, "id");
+        if (id && strcmp(id, "standin-ping") == 0)
+            s->ping_ok = 1;
+    } else if (strcmp(st->name, "iq") == 0 && type && strcmp(type, "get") == 0 &&
+               WINEXMPP_stanza_child(st, "ping", WINEXMPP_NS_PING)) {
+        /* Self-ping (XEP-0410) ke occupant sendiri: MUC menjawab result */
+        const char *to = WINEXMPP_stanza_attr(st, "to");
+        if (to && strcmp(to, s->occupant) == 0) {
+            snprintf(buffer, sizeof(buffer), "<iq type='result' id='%s' from='%s'/>",
+                     WINEXMPP_stanza_attr(st, "id"), s->occupant);
+            stand_in_send(s, buffer);
+            s->self_pinged = 1;
+        }
+    } else if (strcmp(st->name, "presence") == 0 && WINEXMPP_stanza_child(st, "x", WINEXMPP_NS_MUC)) {
+        const char *to = WINEXMPP_stanza_attr(st, "to");
+        snprintf(s->occupant, sizeof(s->occupant), "%s", to ? to : "");
+        snprintf(buffer, sizeof(buffer),
+                 "<presence from='%s'><x xmlns='" WINEXMPP_NS_MUC_USER "'>"
+                 "<item affiliation='none' role='participant'/><status code='110'/></x></presence>",
+                 s->occupant);
+        stand_in_send(s, buffer);
+        stand_in_send(s, "<iq type='get' id='standin-ping' from='" LOCAL_DOMAIN "'><ping xmlns='" WINEXMPP_NS_PING "'/></iq>");
+    } else if (strcmp(st->name, "message") == 0 && type && strcmp(type, "groupchat") == 0) {
+        const char *body = WINEXMPP_stanza_child_text(st, "body");
+        char escaped[1024];
+        if (!body || WINEXMPP_escape(body, escaped, sizeof(escaped)) < 0)
+            return;
+        if (strncmp(body, "lost-", 5) == 0 && !s->resumed) {
+            /* "Hilang" di jaringan: tidak dihitung di h, koneksi diputus setelah dua pesan */
+            counted = 0;
+            if (++s->lost_seen == 2)
+                s->drop = 1;
+        } else {
+            /* Komentar ikut dikirim untuk menguji tokenizer klien */
+            snprintf(buffer, sizeof(buffer),
+                     "<message from='%s' type='groupchat' id='%s'><!-- echo --><body>%s</body>"
+                     "<stanza-id xmlns='urn:xmpp:sid:0' id='standin-1' by='" LOCAL_ROOM "'/></message>",
+                     s->occupant, WINEXMPP_stanza_attr(st, "id"), escaped);
+            stand_in_send(s, buffer);
+            if (strncmp(body, "lost-", 5) == 0)
+                s->lost_echoed++;
+            else
+                s->echoed = 1;
+        }
+    }
+    if (s->sm_on && counted)
+        s->h_in++;
+}
+
+static void stand_in_stream_end(void *user) {
+    StandIn *s = user;
+    stand_in_send(s, "</stream:stream>");
+    s->done = 1;
+}
+
+static int stand_in_server(int listen_fd) {
+    StandIn s = {0};
+    WINEXMPP_parser_callbacks cb = { stand_in_stream_start, stand_in_stanza, stand_in_stream_end };
+    s.parser = WINEXMPP_parser_create(&cb, &s);
+    time_t start = time(NULL);
+    char buffer[4096];
+    /* Koneksi pertama diputus paksa, koneksi kedua me-resume sesi */
+    for (int conn = 0; conn < 2 && !s.done; conn++) {
+        s.fd = accept(listen_fd, NULL, NULL);
+        if (s.fd < 0)
+            break;
+        s.authed = 0;
+        s.drop = 0;
+        WINEXMPP_parser_reset(s.parser);
+        while (!s.done && !s.drop && time(NULL) - start < 10) {
+            struct pollfd pfd = { .fd = s.fd, .events = POLLIN };
+            if (poll(&pfd, 1, 200) <= 0)
+                continue;
+            ssize_t n = recv(s.fd, buffer, sizeof(buffer), 0);
+            if (n <= 0)
+                break;
+            if (WINEXMPP_parser_feed(s.parser, buffer, (size_t)n) != 0) {
+                fprintf(stderr, "[standin] XML tidak valid: %s\n", WINEXMPP_parser_error(s.parser));
+                break;
+            }
+        }
+        close(s.fd);
+    }
+    WINEXMPP_parser_free(s.parser);
+    printf("[standin] auth=%d bind=%d ping=%d echo=%d self-ping=%d resume=%d lost-resent=%d stream_end=%d\n",
+           s.authed, s.bound, s.ping_ok, s.echoed, s.self_pinged, s.resumed, s.lost_echoed, s.done);
+    return (s.authed && s.bound && s.ping_ok && s.echoed && s.self_pinged && s.resumed &&
+            s.lost_echoed == 2 && s.done) ? 0 : 1;
+}
+
+/* ------------------------------------------------------------------ */
+
+/* Trigger bot, sama dengan jalur IRC dan Matrix */
+enum { TRIG_PING, TRIG_PONG };
+
+static const WINEB2B_trigger_def bot_triggers[] = {
+    { "ping", TRIG_PING, WINEB2B_TRIGGER_NOCASE | WINEB2B_TRIGGER_WORD },
+    { "pong", TRIG_PONG, WINEB2B_TRIGGER_NOCASE | WINEB2B_TRIGGER_WORD },
+};
+
+typedef struct {
+    WINEB2B_trigger_set *triggers;
+    const char *expect;     /* Body yang ditunggu kembali di mode --local */
+    int got_echo;
+    int lost_echoes;        /* Pantulan pesan lost-N setelah resume */
+} BotState;
+
+/* Callback pesan: pesan dari nick sendiri (pantulan MUC) tidak dibalas */
+static void on_message(WINEXMPP_handle *handle, const char *from, const char *type,
+                       const char *body, const WINEXMPP_stanza *stanza, void *user_data) {
+    BotState *bot = user_data;
+    (void)stanza;
+    if (!body)
+        return;
+    printf("[Received] %s (%s): %s\n", from ? from : "?", type ? type : "normal", body);
+    const char *slash = from ? strchr(from, '/') : NULL;
+    if (slash && handle->nick && strcmp(slash + 1, handle->nick) == 0) {
+        if (bot->expect && strcmp(body, bot->expect) == 0)
+            bot->got_echo = 1;
+        if (strncmp(body, "lost-", 5) == 0)
+            bot->lost_echoes++;
+        return;
+    }
+    switch (WINEB2B_trigger_first(bot->triggers, body, strlen(body))) {
+    case TRIG_PING:
+        WINEXMPP_send_message(handle, "pong");
+        break;
+    case TRIG_PONG:
+        WINEXMPP_send_message(handle, "ping");
+        break;
+    }
+}
+
+static void poll_until(WINEXMPP_handle *handle, int *flag, int want, int seconds) {
+    time_t start = time(NULL);
+    while (*flag < want && time(NULL) - start < seconds) {
+        if (WINEXMPP_poll(handle, 100) < 0)
+            break;
+    }
+}
+
+/* Mode --local: self-ping MUC, lalu koneksi diputus server di tengah
+   pengiriman dan sesi harus di-resume tanpa join ulang */
+static void run_local_session_checks(WINEXMPP_handle *handle, BotState *bot) {
+    WINEXMPP_muc_self_ping(handle, NULL);
+    time_t start = time(NULL);
+    while (handle->mucs[0].ping_sent_ms && time(NULL) - start < 5)
+        WINEXMPP_poll(handle, 100);
+    printf("[%c] Self-ping MUC %s\n", handle->mucs[0].ping_sent_ms ? '-' : '+',
+           handle->mucs[0].ping_sent_ms ? "tidak dijawab" : "dijawab");
+
+    WINEXMPP_send_message(handle, "lost-1");
+    WINEXMPP_send_message(handle, "lost-2");
+    start = time(NULL);
+    while (WINEXMPP_poll(handle, 100) >= 0 && time(NULL) - start < 5)
+        ;
+    printf("[+] Koneksi diputus server, %zu stanza belum di-ack\n", WINEXMPP_sm_unacked(handle->sm));
+    if (WINEXMPP_reconnect(handle) != 0) {
+        fprintf(stderr, "[-] Reconnect gagal\n");
+        return;
+    }
+    poll_until(handle, &bot->lost_echoes, 2, 5);
+
+    WINEXMPP_stats stats;
+    WINEXMPP_get_stats(handle, &stats);
+    printf("[+] Resume=%lu, dikirim ulang=%lu, join ulang=%lu, ack=%lu\n",
+           stats.resumes, stats.retransmitted, stats.rejoins, stats.acked);
+}
+
+/* Antrean SM yang meluap: stanza yang tidak muat tetap dihitung, sehingga
+   ack server untuk semua stanza yang benar-benar terkirim tetap diterima */
+static int check_sm_overflow(void) {
+    WINEXMPP_sm *sm = WINEXMPP_sm_create(256);
+    if (!sm)
+        return -1;
+    char xml[64];
+    int queued = 0, sent = 0;
+    for (int i = 0; i < 20; i++, sent++) {
+        snprintf(xml, sizeof(xml), "<message id='m%d'><body>isi %d</body></message>", i, i);
+        if (WINEXMPP_sm_outbound(sm, xml, strlen(xml)) == 0)
+            queued++;
+    }
+    int partial = WINEXMPP_sm_ack(sm, (uint32_t)(sent / 2));
+    int rest = WINEXMPP_sm_ack(sm, (uint32_t)sent);
+    int too_high = WINEXMPP_sm_ack(sm, (uint32_t)sent + 1);
+    int ok = queued > 0 && queued < sent && !WINEXMPP_sm_resumable(sm) &&
+             partial == sent / 2 && rest == sent - sent / 2 && too_high < 0 && WINEXMPP_sm_unacked(sm) == 0;
+    WINEXMPP_sm_reset(sm);
+    ok = ok && WINEXMPP_sm_resumable(sm) && WINEXMPP_sm_outbound(sm, xml, strlen(xml)) == 0 &&
+         WINEXMPP_sm_unacked(sm) == 1;
+    printf("[%c] Antrean SM penuh: %d/%d stanza tersimpan, ack h=%d %s\n", ok ? '+' : '-', queued, sent,
+           sent, ok ? "diterima" : "ditolak");
+    WINEXMPP_sm_free(sm);
+    return ok ? 0 : -1;
+}
+
+/* Fungsi utama test XMPP. Argumen --local menjalankan server pengganti lokal */
+int main(int argc, char **argv) {
+    const char *config_filename = "config_xmpp.json";
+    int local = argc > 1 && strcmp(argv[1], "--local") == 0;
+    pid_t child = -1;
+    Config *cfg = NULL;
+
+    if (WINEXMPP_global_init() != 0) {
+        fprintf(stderr, "Global init gagal\n");
+        return -1;
+    }
+
+    if (local) {
+        if (check_sm_overflow() != 0) {
+            WINEXMPP_global_cleanup();
+            return 1;
+        }
+        int lfd = socket(AF_INET, SOCK_STREAM, 0);
+        struct sockaddr_in addr = { .sin_family = AF_INET, .sin_addr.s_addr = htonl(INADDR_LOOPBACK) };
+        socklen_t alen = sizeof(addr);
+        if (lfd < 0 || bind(lfd, (struct sockaddr*)&addr, sizeof(addr)) != 0 || listen(lfd, 1) != 0 ||
+            getsockname(lfd, (struct sockaddr*)&addr, &alen) != 0) {
+            perror("Gagal membuka server lokal");
+            return -1;
+        }
+        fflush(stdout);
+        child = fork();
+        if (child == 0) {
+            int rc = stand_in_server(lfd);
+            fflush(stdout);
+            _exit(rc);
+        }
+        close(lfd);
+        cfg = calloc(1, sizeof(Config));
+        cfg->server = strdup("127.0.0.1");
+        cfg->port = ntohs(addr.sin_port);
+        cfg->jid = strdup("bot@" LOCAL_DOMAIN);
+        cfg->password = strdup("secret");
+        cfg->resource = strdup("test");
+        cfg->room = strdup(LOCAL_ROOM);
+        cfg->nick = strdup("berry");
+    } else {
+        cfg = load_config(config_filename);
+    }
+    if (!cfg) {
+        fprintf(stderr, "Gagal memuat konfigurasi\n");
+        WINEXMPP_global_cleanup();
+        return -1;
+    }
+
+    printf("[+] Konfigurasi dimuat: Server=%s, Port=%d, JID=%s, Room=%s\n",
+           cfg->server, cfg->port, cfg->jid, cfg->room);
+
+    /* Membuat handle koneksi XMPP */
+    WINEXMPP_handle *handle = WINEXMPP_create(cfg->server, cfg->port, cfg->jid, cfg->password, cfg->resource);
+    if (!handle) {
+        fprintf(stderr, "[-] Gagal membuat koneksi XMPP\n");
+        free_config(cfg);
+        if (child > 0)
+            waitpid(child, NULL, 0);
+        WINEXMPP_global_cleanup();
+        return -1;
+    }
+    printf("[+] Login sebagai %s\n", handle->bound_jid);
+
+    const char *test_message = "Hello from XMPP test! <&> \"quoted\"";
+    BotState bot = { WINEB2B_trigger_compile(bot_triggers, sizeof(bot_triggers) / sizeof(bot_triggers[0])),
+                     test_message, 0, 0 };
+    WINEXMPP_set_message_callback(handle, on_message, &bot);
+
+    if (WINEXMPP_join_muc(handle, cfg->room, cfg->nick) == 0)
+        printf("[+] Join ke MUC %s sebagai %s\n", cfg->room, cfg->nick);
+
+    /* Kirim pesan test ke MUC */
+    if (WINEXMPP_send_message(handle, test_message) != 0) {
+        fprintf(stderr, "[-] Gagal mengirim pesan\n");
+    } else {
+        printf("[+] Pesan test terkirim\n");
+    }
+
+    /* Mode lokal selesai begitu pesan kembali; mode server nyata mendengarkan 30 detik */
+    int duration = local ? 5 : 30;
+    printf("[+] Menerima pesan selama %d detik...\n", duration);
+    time_t start = time(NULL);
+    while (time(NULL) - start < duration && !(local && bot.got_echo)) {
+        if (WINEXMPP_poll(handle, 100) < 0) {
+            fprintf(stderr, "[-] Koneksi terputus\n");
+            break;
+        }
+    }
+
+    if (local)
+        run_local_session_checks(handle, &bot);
+
+    printf("[+] Selesai mendengarkan pesan. Disconnect...\n");
+    WINEXMPP_disconnect(handle);
+    WINEXMPP_free(handle);
+    WINEB2B_trigger_free(bot.triggers);
+    free_config(cfg);
+    WINEXMPP_global_cleanup();
+
+    if (local) {
+        int status = 1;
+        waitpid(child, &status, 0);
+        int ok = bot.got_echo && bot.lost_echoes == 2 && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+        printf("[%c] Test lokal %s\n", ok ? '+' : '-', ok ? "berhasil" : "gagal");
+        return ok ? 0 : 1;
+    }
+    return 0;
+}